@@ -0,0 +1,840 @@
+/*
+ * Copyright (C) 2017 Robert Mueller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Contact: Robert Mueller <romueller@techfak.uni-bielefeld.de>
+ * Faculty of Technology, Bielefeld University,
+ * PO box 100131, DE-33501 Bielefeld, Germany
+ */
+
+#ifndef K2TREES_DYNAMICK2TREE_HPP
+#define K2TREES_DYNAMICK2TREE_HPP
+
+#include <chrono>
+#include <future>
+#include <map>
+#include <set>
+
+#include "K2Tree.hpp"
+#include "Utility.hpp"
+
+/**
+ * Dynamic wrapper around an arbitrary (static) implementation of K2Tree.
+ *
+ * New or changed pairs are collected in a small sorted buffer and removed pairs in a set of tombstones,
+ * queries merge them with the results of the static K2Tree. As soon as the buffered changes comprise
+ * maxBufferSize entries, they are folded into a fresh static K2Tree built by the given builder
+ * (e.g. one of the list-of-pairs-based constructors, which use buildFromListsInplace()).
+ *
+ * With background compaction, the buffered changes are frozen and the new K2Tree is built by a separate thread,
+ * while later changes are collected in a new buffer. The new K2Tree is installed by the first modifying call
+ * after its construction has been completed (or by finishCompaction()).
+ *
+ * The pairs of a single row are visited in ascending column order, otherwise the pairs of the static K2Tree
+ * are visited first (in its order), followed by the buffered ones (in row-major order).
+ */
+template<typename E>
+class DynamicK2Tree : public virtual K2Tree<E> {
+
+public:
+    typedef E elem_type;
+
+    typedef typename K2Tree<elem_type>::matrix_type matrix_type;
+    typedef typename K2Tree<elem_type>::list_type list_type;
+    typedef typename K2Tree<elem_type>::positions_type positions_type;
+    typedef typename K2Tree<elem_type>::pairs_type pairs_type;
+
+    // output-buffer and limited variants of the query methods (see K2Tree)
+    using K2Tree<elem_type>::getSuccessorPositions;
+    using K2Tree<elem_type>::getPredecessorPositions;
+    using K2Tree<elem_type>::getPositionsInRange;
+    using K2Tree<elem_type>::getAllValuedPositions;
+    using K2Tree<elem_type>::getSuccessors;
+    using K2Tree<elem_type>::getRange;
+
+    // creates a new static K2Tree (on the heap) from the given pairs (which may be reordered)
+    typedef std::function<K2Tree<elem_type>*(pairs_type&)> builder_type;
+
+
+    /**
+     * Wrapping constructor
+     *
+     * Takes ownership of tree. The static K2Trees created by builder replace tree during compaction
+     * (in a separate thread, if background is true, so that builder has to be safe for concurrent use in this case).
+     */
+    DynamicK2Tree(K2Tree<elem_type>* tree, const builder_type& builder, const size_type maxBufferSize = 1024, const bool background = true) {
+
+        tree_ = tree;
+        builder_ = builder;
+        maxBufferSize_ = std::max(maxBufferSize, (size_type) 1);
+        background_ = background;
+
+        numRows_ = tree_->getNumRows();
+        numCols_ = tree_->getNumCols();
+        numElems_ = tree_->countElements();
+        null_ = tree_->getNull();
+
+    }
+
+    DynamicK2Tree(const DynamicK2Tree& other) {
+
+        tree_ = other.tree_->clone();
+        builder_ = other.builder_;
+        maxBufferSize_ = other.maxBufferSize_;
+        background_ = other.background_;
+
+        numRows_ = other.numRows_;
+        numCols_ = other.numCols_;
+        numElems_ = other.numElems_;
+        null_ = other.null_;
+
+        // the copy does not take part in a running compaction of other
+        delta_ = other.delta_;
+        absorb(delta_, other.frozen_);
+
+    }
+
+    DynamicK2Tree& operator=(const DynamicK2Tree& other) {
+
+        // check for self-assignment
+        if (&other == this) {
+            return *this;
+        }
+
+        cancelCompaction();
+        delete tree_;
+
+        tree_ = other.tree_->clone();
+        builder_ = other.builder_;
+        maxBufferSize_ = other.maxBufferSize_;
+        background_ = other.background_;
+
+        numRows_ = other.numRows_;
+        numCols_ = other.numCols_;
+        numElems_ = other.numElems_;
+        null_ = other.null_;
+
+        frozen_.clear();
+        delta_ = other.delta_;
+        absorb(delta_, other.frozen_);
+
+        return *this;
+
+    }
+
+    ~DynamicK2Tree() {
+
+        cancelCompaction();
+        delete tree_;
+
+    }
+
+
+    // returns the number of buffered changes (including those currently folded into a new static K2Tree)
+    size_type getBufferSize() const {
+        return delta_.size() + frozen_.size();
+    }
+
+    // returns the maximum number of buffered changes before a compaction is started
+    size_type getMaxBufferSize() const {
+        return maxBufferSize_;
+    }
+
+    // returns the current static K2Tree (without the buffered changes)
+    const K2Tree<elem_type>& getStaticTree() const {
+        return *tree_;
+    }
+
+    // sets the value of the pair (i,j) to val, i.e. adds it to the relation (or removes it if val is the null element),
+    // the relation matrix grows if necessary
+    void insert(size_type i, size_type j, const elem_type val) {
+
+        this->checkWritable("insert");
+
+        set(i, j, val);
+
+    }
+
+    void setNull(size_type i, size_type j) override {
+
+        this->checkWritable("setNull");
+
+        set(i, j, null_);
+
+    }
+
+    // folds all buffered changes into a new static K2Tree in the calling thread
+    // (a running background compaction is finished first)
+    void compact() override {
+
+        this->checkWritable("compact");
+
+        finishCompaction(true);
+
+        if (delta_.empty()) {
+            return;
+        }
+
+        std::swap(frozen_, delta_);
+
+        K2Tree<elem_type>* tree;
+        try {
+            tree = mergeFrozen();
+        } catch (...) {
+
+            unfreeze();
+            throw;
+
+        }
+
+        install(tree);
+
+    }
+
+    // the buffered changes are estimated from the number of entries (and the typical size of a node of the std::map / std::set)
+    SizeBreakdown sizeInBytes() const override {
+
+        SizeBreakdown s = tree_->sizeInBytes();
+
+        size_type numBuffered = delta_.buffer.size() + frozen_.buffer.size();
+        size_type numTombstones = delta_.tombstones.size() + frozen_.tombstones.size();
+        s.other += sizeof(*this)
+                + numBuffered * (sizeof(std::pair<const std::pair<size_type, size_type>, elem_type>) + 4 * sizeof(void*))
+                + numTombstones * (sizeof(std::pair<size_type, size_type>) + 4 * sizeof(void*));
+
+        return s;
+
+    }
+
+    // freezes the buffered changes and starts folding them into a new static K2Tree in a separate thread
+    // (nothing happens if a compaction is already running or there are no buffered changes)
+    void startCompaction() {
+
+        this->checkWritable("startCompaction");
+
+        if (compaction_.valid() || delta_.empty()) {
+            return;
+        }
+
+        std::swap(frozen_, delta_);
+
+        // the thread only reads tree_ and frozen_, which remain unchanged until its result is installed
+        compaction_ = std::async(std::launch::async, [this]() { return mergeFrozen(); });
+
+    }
+
+    // installs the static K2Tree built by a running background compaction (waiting for its completion if wait is true),
+    // returns true iff a new K2Tree has been installed
+    // (if the construction has failed, the frozen changes are buffered again and the exception is rethrown)
+    bool finishCompaction(const bool wait = true) {
+
+        this->checkWritable("finishCompaction");
+
+        if (!compaction_.valid()) {
+            return false;
+        }
+
+        if (!wait && (compaction_.wait_for(std::chrono::seconds(0)) != std::future_status::ready)) {
+            return false;
+        }
+
+        K2Tree<elem_type>* tree;
+        try {
+            tree = compaction_.get();
+        } catch (...) {
+
+            unfreeze();
+            throw;
+
+        }
+
+        install(tree);
+
+        return true;
+
+    }
+
+
+    size_type getNumRows() const override {
+        return numRows_;
+    }
+
+    size_type getNumCols() const override {
+        return numCols_;
+    }
+
+    elem_type getNull() const override {
+        return null_;
+    }
+
+
+    bool isNotNull(size_type i, size_type j) const override {
+        return getElement(i, j) != null_;
+    }
+
+    elem_type getElement(size_type i, size_type j) const override {
+
+        elem_type val;
+        return lookup(i, j, val) ? val : staticElement(i, j);
+
+    }
+
+    std::vector<elem_type> getSuccessorElements(size_type i) const override {
+
+        std::vector<elem_type> succs;
+        forEachValuedPositionInRange(i, i, 0, lastCol(), [&succs](size_type, size_type, elem_type val) { succs.push_back(val); return true; });
+
+        return succs;
+
+    }
+
+    std::vector<size_type> getSuccessorPositions(size_type i) const override {
+
+        std::vector<size_type> succs;
+        forEachSuccessorPosition(i, [&succs](size_type j) { succs.push_back(j); return true; });
+
+        return succs;
+
+    }
+
+    pairs_type getSuccessorValuedPositions(size_type i) const override {
+
+        pairs_type succs;
+        forEachValuedPositionInRange(i, i, 0, lastCol(), [&succs](size_type i, size_type j, elem_type val) { succs.push_back(ValuedPosition<elem_type>(i, j, val)); return true; });
+
+        return succs;
+
+    }
+
+    std::vector<elem_type> getPredecessorElements(size_type j) const override {
+
+        std::vector<elem_type> preds;
+        forEachValuedPositionInRange(0, lastRow(), j, j, [&preds](size_type, size_type, elem_type val) { preds.push_back(val); return true; });
+
+        return preds;
+
+    }
+
+    std::vector<size_type> getPredecessorPositions(size_type j) const override {
+
+        std::vector<size_type> preds;
+        forEachPredecessorPosition(j, [&preds](size_type i) { preds.push_back(i); return true; });
+
+        return preds;
+
+    }
+
+    pairs_type getPredecessorValuedPositions(size_type j) const override {
+
+        pairs_type preds;
+        forEachValuedPositionInRange(0, lastRow(), j, j, [&preds](size_type i, size_type j, elem_type val) { preds.push_back(ValuedPosition<elem_type>(i, j, val)); return true; });
+
+        return preds;
+
+    }
+
+    std::vector<elem_type> getElementsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
+
+        std::vector<elem_type> elements;
+        forEachValuedPositionInRange(i1, i2, j1, j2, [&elements](size_type, size_type, elem_type val) { elements.push_back(val); return true; });
+
+        return elements;
+
+    }
+
+    positions_type getPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
+
+        positions_type pairs;
+        forEachValuedPositionInRange(i1, i2, j1, j2, [&pairs](size_type i, size_type j, elem_type) { pairs.push_back(std::make_pair(i, j)); return true; });
+
+        return pairs;
+
+    }
+
+    pairs_type getValuedPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
+
+        pairs_type pairs;
+        forEachValuedPositionInRange(i1, i2, j1, j2, [&pairs](size_type i, size_type j, elem_type val) { pairs.push_back(ValuedPosition<elem_type>(i, j, val)); return true; });
+
+        return pairs;
+
+    }
+
+    std::vector<elem_type> getAllElements() const override {
+        return getElementsInRange(0, lastRow(), 0, lastCol());
+    }
+
+    positions_type getAllPositions() const override {
+        return getPositionsInRange(0, lastRow(), 0, lastCol());
+    }
+
+    pairs_type getAllValuedPositions() const override {
+        return getValuedPositionsInRange(0, lastRow(), 0, lastCol());
+    }
+
+    bool forEachSuccessorPosition(size_type i, const std::function<bool(size_type)>& visitor) const override {
+        return forEachValuedPositionInRange(i, i, 0, lastCol(), [&visitor](size_type, size_type j, elem_type) { return visitor(j); });
+    }
+
+    bool forEachPredecessorPosition(size_type j, const std::function<bool(size_type)>& visitor) const override {
+        return forEachValuedPositionInRange(0, lastRow(), j, j, [&visitor](size_type i, size_type, elem_type) { return visitor(i); });
+    }
+
+    bool forEachValuedPositionInRange(size_type i1, size_type i2, size_type j1, size_type j2, const std::function<bool(size_type, size_type, elem_type)>& visitor) const override {
+
+        auto buffered = bufferedInRange(i1, i2, j1, j2);
+        size_type next = 0; // next buffered pair to be visited
+
+        if ((i1 < tree_->getNumRows()) && (j1 < tree_->getNumCols())) {
+
+            bool completed = tree_->forEachValuedPositionInRange(i1, std::min(i2, tree_->getNumRows() - 1), j1, std::min(j2, tree_->getNumCols() - 1), [&](size_type i, size_type j, elem_type val) {
+
+                elem_type changed;
+                if (lookup(i, j, changed)) {
+                    return true;
+                }
+
+                // pairs of a single row are visited in ascending column order
+                for (; (i1 == i2) && (next < buffered.size()) && (buffered[next].col < j); next++) {
+                    if (!visitor(buffered[next].row, buffered[next].col, buffered[next].val)) return false;
+                }
+
+                return visitor(i, j, val);
+
+            });
+
+            if (!completed) {
+                return false;
+            }
+
+        }
+
+        for (; next < buffered.size(); next++) {
+            if (!visitor(buffered[next].row, buffered[next].col, buffered[next].val)) return false;
+        }
+
+        return true;
+
+    }
+
+    bool containsElement(size_type i1, size_type i2, size_type j1, size_type j2) const override {
+        return !forEachValuedPositionInRange(i1, i2, j1, j2, [](size_type, size_type, elem_type) { return false; });
+    }
+
+    size_type countElements() const override {
+        return numElems_;
+    }
+
+    size_type countElementsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
+
+        size_type cnt = 0;
+        if ((i1 < tree_->getNumRows()) && (j1 < tree_->getNumCols())) {
+            cnt = tree_->countElementsInRange(i1, std::min(i2, tree_->getNumRows() - 1), j1, std::min(j2, tree_->getNumCols() - 1));
+        }
+
+        // replace the contributions of the static pairs by those of the buffered changes
+        for (auto& pos : changedInRange(i1, i2, j1, j2)) {
+
+            elem_type val;
+            lookup(pos.first, pos.second, val);
+            cnt = cnt + (val != null_) - (staticElement(pos.first, pos.second) != null_);
+
+        }
+
+        return cnt;
+
+    }
+
+
+    K2Tree<elem_type>* clone() const override {
+        return new DynamicK2Tree<elem_type>(*this);
+    }
+
+    void print(bool all = false) const override {
+
+        std::cout << "### Parameters ###" << std::endl;
+        std::cout << "numRows  = " << numRows_ << std::endl;
+        std::cout << "numCols  = " << numCols_ << std::endl;
+        std::cout << "numElems  = " << numElems_ << std::endl;
+        std::cout << "null = " << null_ << std::endl;
+        std::cout << "bufferSize  = " << getBufferSize() << " (max. " << maxBufferSize_ << ")" << std::endl;
+
+        std::cout << "### Static K2Tree ###" << std::endl;
+        tree_->print(all);
+
+        if (all) {
+
+            std::cout << "### Buffered changes ###" << std::endl;
+            for (auto& pos : changedInRange(0, lastRow(), 0, lastCol())) {
+                std::cout << "(" << pos.first << ", " << pos.second << ", " << getElement(pos.first, pos.second) << ") ";
+            }
+            std::cout << std::endl << std::endl;
+
+        }
+
+    }
+
+    // note: the buffered changes are written separately, i.e. serialize() does not compact the K2Tree
+    void serialize(std::ostream& out) const override {
+
+        writeHeader(out, "DynamicK2Tree", sizeof(elem_type));
+
+        writeValue(out, numRows_);
+        writeValue(out, numCols_);
+        writeValue(out, numElems_);
+        writeValue(out, null_);
+
+        tree_->serialize(out);
+
+        Delta changes = delta_;
+        absorb(changes, frozen_);
+
+        writeValue(out, (size_type) changes.buffer.size());
+        for (auto& e : changes.buffer) {
+
+            writeValue(out, e.first);
+            writeValue(out, e.second);
+
+        }
+
+        writeVector(out, std::vector<std::pair<size_type, size_type>>(changes.tombstones.begin(), changes.tombstones.end()));
+
+    }
+
+    // note: the static K2Tree is loaded via its current implementation, which therefore has to match the serialised one
+    void load(std::istream& in) override {
+
+        this->checkWritable("load");
+
+        readHeader(in, "DynamicK2Tree", sizeof(elem_type));
+
+        cancelCompaction();
+
+        readValue(in, numRows_);
+        readValue(in, numCols_);
+        readValue(in, numElems_);
+        readValue(in, null_);
+
+        tree_->load(in);
+
+        delta_.clear();
+        frozen_.clear();
+
+        size_type numBuffered;
+        readValue(in, numBuffered);
+        for (size_type k = 0; k < numBuffered; k++) {
+
+            std::pair<size_type, size_type> pos;
+            elem_type val;
+            readValue(in, pos);
+            readValue(in, val);
+
+            delta_.buffer[pos] = val;
+
+        }
+
+        std::vector<std::pair<size_type, size_type>> tombstones;
+        readVector(in, tombstones);
+        delta_.tombstones.insert(tombstones.begin(), tombstones.end());
+
+    }
+
+    size_type getFirstSuccessor(size_type i) const override {
+
+        size_type first = numCols_;
+        forEachSuccessorPosition(i, [&first](size_type j) { first = j; return false; });
+
+        return first;
+
+    }
+
+
+
+    bool areRelated(size_type i, size_type j) const override {
+        return isNotNull(i, j);
+    }
+
+    std::vector<size_type> getSuccessors(size_type i) const override {
+        return getSuccessorPositions(i);
+    }
+
+    std::vector<size_type> getPredecessors(size_type j) const override {
+        return getPredecessorPositions(j);
+    }
+
+    positions_type getRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
+        return getPositionsInRange(i1, i2, j1, j2);
+    }
+
+    bool containsLink(size_type i1, size_type i2, size_type j1, size_type j2) const override {
+        return containsElement(i1, i2, j1, j2);
+    }
+
+    size_type countLinks() const override {
+        return countElements();
+    }
+
+private:
+    // buffered changes: new values of pairs (a position is contained in at most one of both collections)
+    struct Delta {
+
+        std::map<std::pair<size_type, size_type>, elem_type> buffer; // inserted / changed pairs (sorted by row and column)
+        std::set<std::pair<size_type, size_type>> tombstones; // removed pairs
+
+        size_type size() const {
+            return buffer.size() + tombstones.size();
+        }
+
+        bool empty() const {
+            return buffer.empty() && tombstones.empty();
+        }
+
+        void clear() {
+
+            buffer.clear();
+            tombstones.clear();
+
+        }
+
+    };
+
+    K2Tree<elem_type>* tree_; // static K2Tree
+    builder_type builder_; // creates the static K2Trees during compaction
+
+    Delta delta_; // changes not yet considered by a compaction
+    Delta frozen_; // (older) changes currently folded into a new static K2Tree by a background compaction
+    std::future<K2Tree<elem_type>*> compaction_; // result of the running background compaction (if any)
+
+    size_type maxBufferSize_; // number of buffered changes triggering a compaction
+    bool background_; // compact in a separate thread?
+
+    size_type numRows_; // number of rows in the represented relation matrix
+    size_type numCols_; // number of columns in the represented relation matrix
+    size_type numElems_; // number of pairs in the relation
+
+    elem_type null_; // null element
+
+
+    size_type lastRow() const {
+        return (numRows_ == 0) ? 0 : numRows_ - 1;
+    }
+
+    size_type lastCol() const {
+        return (numCols_ == 0) ? 0 : numCols_ - 1;
+    }
+
+    /* helper methods for merging the buffered changes and the static K2Tree */
+
+    // checks whether the value of (i,j) has been changed in d and, if so, stores the new value in val
+    bool lookup(const Delta& d, size_type i, size_type j, elem_type& val) const {
+
+        auto pos = std::make_pair(i, j);
+
+        auto it = d.buffer.find(pos);
+        if (it != d.buffer.end()) {
+
+            val = it->second;
+            return true;
+
+        }
+
+        if (d.tombstones.count(pos) != 0) {
+
+            val = null_;
+            return true;
+
+        }
+
+        return false;
+
+    }
+
+    // checks whether the value of (i,j) is determined by the buffered changes and, if so, stores it in val
+    bool lookup(size_type i, size_type j, elem_type& val) const {
+        return lookup(delta_, i, j, val) || lookup(frozen_, i, j, val);
+    }
+
+    // returns the value of (i,j) in the static K2Tree
+    elem_type staticElement(size_type i, size_type j) const {
+        return ((i < tree_->getNumRows()) && (j < tree_->getNumCols())) ? tree_->getElement(i, j) : null_;
+    }
+
+    // returns all positions (i,j) with i1 <= i <= i2 and j1 <= j <= j2 that have been changed (in row-major order)
+    std::vector<std::pair<size_type, size_type>> changedInRange(size_type i1, size_type i2, size_type j1, size_type j2) const {
+
+        std::vector<std::pair<size_type, size_type>> positions;
+
+        for (const Delta* d : {&delta_, &frozen_}) {
+
+            for (auto it = d->buffer.lower_bound(std::make_pair(i1, j1)); (it != d->buffer.end()) && (it->first.first <= i2); ++it) {
+                if ((j1 <= it->first.second) && (it->first.second <= j2)) positions.push_back(it->first);
+            }
+
+            for (auto it = d->tombstones.lower_bound(std::make_pair(i1, j1)); (it != d->tombstones.end()) && (it->first <= i2); ++it) {
+                if ((j1 <= it->second) && (it->second <= j2)) positions.push_back(*it);
+            }
+
+        }
+
+        std::sort(positions.begin(), positions.end());
+        positions.erase(std::unique(positions.begin(), positions.end()), positions.end());
+
+        return positions;
+
+    }
+
+    // returns all buffered (non-null) pairs (i,j) with i1 <= i <= i2 and j1 <= j <= j2 (in row-major order)
+    pairs_type bufferedInRange(size_type i1, size_type i2, size_type j1, size_type j2) const {
+
+        pairs_type pairs;
+
+        if (getBufferSize() != 0) {
+
+            for (auto& pos : changedInRange(i1, i2, j1, j2)) {
+
+                elem_type val;
+                lookup(pos.first, pos.second, val);
+
+                if (val != null_) {
+                    pairs.push_back(ValuedPosition<elem_type>(pos, val));
+                }
+
+            }
+
+        }
+
+        return pairs;
+
+    }
+
+    // adds the changes in older whose positions are not changed in d to d
+    static void absorb(Delta& d, const Delta& older) {
+
+        for (auto& e : older.buffer) {
+            if (d.tombstones.count(e.first) == 0) d.buffer.insert(e);
+        }
+
+        for (auto& pos : older.tombstones) {
+            if (d.buffer.count(pos) == 0) d.tombstones.insert(pos);
+        }
+
+    }
+
+    /* helper methods for changing values and compacting */
+
+    void set(size_type i, size_type j, const elem_type val) {
+
+        elem_type old = getElement(i, j);
+        numElems_ = numElems_ + (val != null_) - (old != null_);
+
+        auto pos = std::make_pair(i, j);
+
+        if (val != null_) {
+
+            delta_.tombstones.erase(pos);
+            delta_.buffer[pos] = val;
+
+            numRows_ = std::max(numRows_, i + 1);
+            numCols_ = std::max(numCols_, j + 1);
+
+        } else {
+
+            delta_.buffer.erase(pos);
+
+            // a tombstone is only needed if the pair is still present in the frozen changes or the static K2Tree
+            elem_type frozen;
+            if ((lookup(frozen_, i, j, frozen) ? frozen : staticElement(i, j)) != null_) {
+                delta_.tombstones.insert(pos);
+            }
+
+        }
+
+        if (compaction_.valid()) {
+            finishCompaction(false);
+        }
+
+        if (delta_.size() >= maxBufferSize_) {
+
+            if (background_) {
+                startCompaction();
+            } else {
+                compact();
+            }
+
+        }
+
+    }
+
+    // builds a new static K2Tree from the pairs of the current one and the frozen changes
+    K2Tree<elem_type>* mergeFrozen() const {
+
+        pairs_type pairs;
+        tree_->forEachValuedPosition([this, &pairs](size_type i, size_type j, elem_type val) {
+
+            elem_type changed;
+            if (!lookup(frozen_, i, j, changed)) {
+                pairs.push_back(ValuedPosition<elem_type>(i, j, val));
+            }
+
+            return true;
+
+        });
+
+        for (auto& e : frozen_.buffer) {
+            pairs.push_back(ValuedPosition<elem_type>(e.first, e.second));
+        }
+
+        return builder_(pairs);
+
+    }
+
+    // replaces the static K2Tree by tree (which contains the frozen changes)
+    void install(K2Tree<elem_type>* tree) {
+
+        delete tree_;
+        tree_ = tree;
+
+        frozen_.clear();
+
+    }
+
+    // moves the frozen changes back into the buffer (after a failed compaction)
+    void unfreeze() {
+
+        absorb(delta_, frozen_);
+        frozen_.clear();
+
+    }
+
+    // waits for a running background compaction and discards its result (the frozen changes are kept)
+    void cancelCompaction() {
+
+        if (compaction_.valid()) {
+
+            try {
+                delete compaction_.get();
+            } catch (...) {
+                // nothing to do
+            }
+
+            unfreeze();
+
+        }
+
+    }
+
+};
+
+#endif //K2TREES_DYNAMICK2TREE_HPP
@@ -33,6 +33,8 @@
  * and one value is designated the null element ("unrelated").
  *
  * The data structure is static (with the exception of the setNull() method).
+ * All query methods are const and may be called concurrently on a single instance
+ * as long as no modifying method runs at the same time (see setReadOnly()).
  *
  * Adapted from:
  * Brisaboa, N. R., Ladra, S., & Navarro, G. (2014).
@@ -62,72 +64,259 @@ public:
     virtual ~K2Tree() { }
 
     // returns the number of rows of the relation (n)
-    virtual size_type getNumRows() = 0;
+    virtual size_type getNumRows() const = 0;
 
     // returns the number of columns of the relation (m)
-    virtual size_type getNumCols() = 0;
+    virtual size_type getNumCols() const = 0;
 
     // returns the null element of the relation
-    virtual elem_type getNull() = 0;
+    virtual elem_type getNull() const = 0;
 
 
     // checks whether (i,j) is in R
-    virtual bool isNotNull(size_type i, size_type j) = 0;
+    virtual bool isNotNull(size_type i, size_type j) const = 0;
 
     // returns the value of (i,j), if the pair is in R, null otherwise
-    virtual elem_type getElement(size_type i, size_type j) = 0;
+    virtual elem_type getElement(size_type i, size_type j) const = 0;
+
+    // checks for every queried position (i,j) whether it is in R, out[x] refers to queries[x]
+    virtual void isNotNull(const positions_type& queries, std::vector<bool>& out) const {
+
+        out.resize(queries.size());
+        for (size_type x = 0; x < queries.size(); x++) {
+            out[x] = isNotNull(queries[x].first, queries[x].second);
+        }
+
+    }
+
+    // returns the value of every queried position (i,j) (null if the pair is not in R), out[x] refers to queries[x]
+    virtual void getElement(const positions_type& queries, std::vector<elem_type>& out) const {
+
+        out.resize(queries.size());
+        for (size_type x = 0; x < queries.size(); x++) {
+            out[x] = getElement(queries[x].first, queries[x].second);
+        }
+
+    }
 
     // returns the values of all pairs in R whose first component is i
-    virtual std::vector<elem_type> getSuccessorElements(size_type i) = 0;
+    virtual std::vector<elem_type> getSuccessorElements(size_type i) const = 0;
 
     // returns the column numbers of all pairs in R whose first component is i
-    virtual std::vector<size_type> getSuccessorPositions(size_type i) = 0;
+    virtual std::vector<size_type> getSuccessorPositions(size_type i) const = 0;
 
     // returns all valued pairs in R whose first component is i
-    virtual pairs_type getSuccessorValuedPositions(size_type i) = 0;
+    virtual pairs_type getSuccessorValuedPositions(size_type i) const = 0;
 
     // returns the values of all pairs in R whose second component is j
-    virtual std::vector<elem_type> getPredecessorElements(size_type j) = 0;
+    virtual std::vector<elem_type> getPredecessorElements(size_type j) const = 0;
 
     // returns the row numbers of all pairs in R whose second component is j
-    virtual std::vector<size_type> getPredecessorPositions(size_type j) = 0;
+    virtual std::vector<size_type> getPredecessorPositions(size_type j) const = 0;
 
     // returns all valued pairs in R whose second component is j
-    virtual pairs_type getPredecessorValuedPositions(size_type j) = 0;
+    virtual pairs_type getPredecessorValuedPositions(size_type j) const = 0;
 
     // returns the values of all pairs (i,j) in R with i1 <= i <= i2 and j1 <= j <= j2
-    virtual std::vector<elem_type> getElementsInRange(size_type i1, size_type i2, size_type j1, size_type j2) = 0;
+    virtual std::vector<elem_type> getElementsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const = 0;
 
     // returns the positions of all pairs (i,j) in R with i1 <= i <= i2 and j1 <= j <= j2
-    virtual positions_type getPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) = 0;
+    virtual positions_type getPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const = 0;
 
     // returns the positions and values of all pairs (i,j) in R with i1 <= i <= i2 and j1 <= j <= j2
-    virtual pairs_type getValuedPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) = 0;
+    virtual pairs_type getValuedPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const = 0;
 
     // returns the values of all pairs in R
-    virtual std::vector<elem_type> getAllElements() = 0;
+    virtual std::vector<elem_type> getAllElements() const = 0;
 
     // returns the positions of all pairs in R
-    virtual positions_type getAllPositions() = 0;
+    virtual positions_type getAllPositions() const = 0;
 
     // returns all valued pairs in R
-    virtual pairs_type getAllValuedPositions() = 0;
+    virtual pairs_type getAllValuedPositions() const = 0;
+
+    // calls visitor(j) for all pairs (i,j) in R (in the order of getSuccessorPositions(i)) until visitor returns false,
+    // returns false iff the enumeration has been stopped by the visitor
+    virtual bool forEachSuccessorPosition(size_type i, const std::function<bool(size_type)>& visitor) const = 0;
+
+    // calls visitor(i) for all pairs (i,j) in R (in the order of getPredecessorPositions(j)) until visitor returns false,
+    // returns false iff the enumeration has been stopped by the visitor
+    virtual bool forEachPredecessorPosition(size_type j, const std::function<bool(size_type)>& visitor) const = 0;
+
+    // calls visitor(i, j, value) for all pairs (i,j) in R with i1 <= i <= i2 and j1 <= j <= j2 until visitor returns false,
+    // returns false iff the enumeration has been stopped by the visitor
+    virtual bool forEachValuedPositionInRange(size_type i1, size_type i2, size_type j1, size_type j2, const std::function<bool(size_type, size_type, elem_type)>& visitor) const = 0;
+
+    // calls visitor(i, j) for all pairs (i,j) in R with i1 <= i <= i2 and j1 <= j <= j2 until visitor returns false,
+    // returns false iff the enumeration has been stopped by the visitor
+    bool forEachPositionInRange(size_type i1, size_type i2, size_type j1, size_type j2, const std::function<bool(size_type, size_type)>& visitor) const {
+        return forEachValuedPositionInRange(i1, i2, j1, j2, [&visitor](size_type i, size_type j, elem_type) { return visitor(i, j); });
+    }
+
+    // calls visitor(i, j, value) for all pairs (i,j) in R until visitor returns false,
+    // returns false iff the enumeration has been stopped by the visitor
+    bool forEachValuedPosition(const std::function<bool(size_type, size_type, elem_type)>& visitor) const {
+        return (getNumRows() == 0 || getNumCols() == 0) ? true : forEachValuedPositionInRange(0, getNumRows() - 1, 0, getNumCols() - 1, visitor);
+    }
+
+    // returns the column numbers of all pairs (i,j) in R where i is contained in frontier (ascending, without duplicates),
+    // i.e. the union of the successors of all rows in frontier (e.g. one step of a breadth-first search)
+    std::vector<size_type> expandFrontier(const std::vector<size_type>& frontier) const {
+
+        std::vector<bool> visited;
+        return expandFrontier(frontier, visited);
+
+    }
+
+    // same as above, but if visited is not empty (it then has to have at least getNumCols() entries),
+    // all columns j with visited[j] are skipped and all returned columns are marked as visited
+    virtual std::vector<size_type> expandFrontier(const std::vector<size_type>& frontier, std::vector<bool>& visited) const {
+
+        auto rows = prepareFrontier(frontier, visited);
+        std::vector<size_type> cols;
+
+        for (auto i : rows) {
+
+            if (i < getNumRows()) {
+                forEachSuccessorPosition(i, [&cols, &visited](size_type j) {
+                    addToFrontier(j, cols, visited);
+                    return true;
+                });
+            }
+
+        }
+
+        finishFrontier(cols, visited);
+
+        return cols;
+
+    }
+
+    // variants of getSuccessorPositions(), getPredecessorPositions(), getPositionsInRange() and getAllValuedPositions()
+    // writing into a caller-provided vector (which is cleared first, its capacity is reused)
+    void getSuccessorPositions(size_type i, std::vector<size_type>& succs) const {
+
+        succs.clear();
+        forEachSuccessorPosition(i, [&succs](size_type j) { succs.push_back(j); return true; });
+
+    }
+
+    void getPredecessorPositions(size_type j, std::vector<size_type>& preds) const {
+
+        preds.clear();
+        forEachPredecessorPosition(j, [&preds](size_type i) { preds.push_back(i); return true; });
+
+    }
+
+    void getPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2, positions_type& pairs) const {
+
+        pairs.clear();
+        forEachValuedPositionInRange(i1, i2, j1, j2, [&pairs](size_type i, size_type j, elem_type) { pairs.push_back(std::make_pair(i, j)); return true; });
+
+    }
+
+    void getAllValuedPositions(pairs_type& pairs) const {
+
+        pairs.clear();
+        forEachValuedPosition([&pairs](size_type i, size_type j, elem_type val) { pairs.push_back(ValuedPosition<elem_type>(i, j, val)); return true; });
+
+    }
+
+    // returns the column numbers of the (at most) limit first pairs in R whose first component is i
+    // (the traversal stops as soon as the limit is reached)
+    std::vector<size_type> getSuccessorPositions(size_type i, size_type limit) const {
+
+        std::vector<size_type> succs;
+        if (limit != 0) {
+            forEachSuccessorPosition(i, [&succs, limit](size_type j) { succs.push_back(j); return succs.size() < limit; });
+        }
+
+        return succs;
+
+    }
+
+    // returns the (at most) limit smallest column numbers j > c such that (i,j) is in R,
+    // i.e. the next page of successors of i after column c
+    // (all implementations visit the pairs of a single row in ascending column order)
+    std::vector<size_type> getNextSuccessorPositions(size_type i, size_type c, size_type limit) const {
+
+        std::vector<size_type> succs;
+        if (limit != 0 && c + 1 < getNumCols()) {
+            forEachValuedPositionInRange(i, i, c + 1, getNumCols() - 1, [&succs, limit](size_type, size_type j, elem_type) { succs.push_back(j); return succs.size() < limit; });
+        }
+
+        return succs;
+
+    }
+
+    // returns the smallest column number j > c such that (i,j) is in R, or a value >= m if no such pair exists
+    size_type getNextSuccessor(size_type i, size_type c) const {
+
+        size_type next = getNumCols();
+        if (c + 1 < getNumCols()) {
+            forEachValuedPositionInRange(i, i, c + 1, getNumCols() - 1, [&next](size_type, size_type j, elem_type) { next = j; return false; });
+        }
+
+        return next;
+
+    }
+
+    // returns the positions of the (at most) limit first pairs (i,j) in R with i1 <= i <= i2 and j1 <= j <= j2
+    // (in the order of forEachValuedPositionInRange(), the traversal stops as soon as the limit is reached)
+    positions_type getPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2, size_type limit) const {
+
+        positions_type pairs;
+        if (limit != 0) {
+            forEachValuedPositionInRange(i1, i2, j1, j2, [&pairs, limit](size_type i, size_type j, elem_type) { pairs.push_back(std::make_pair(i, j)); return pairs.size() < limit; });
+        }
+
+        return pairs;
+
+    }
 
     // checks whether R contains a pair (i,j) with i1 <= i <= i2 and j1 <= j <= j2
-    virtual bool containsElement(size_type i1, size_type i2, size_type j1, size_type j2) = 0;
+    virtual bool containsElement(size_type i1, size_type i2, size_type j1, size_type j2) const = 0;
 
     // returns the number of pairs in R
-    virtual size_type countElements() = 0;
+    virtual size_type countElements() const = 0;
+
+    // returns the number of pairs (i,j) in R with i1 <= i <= i2 and j1 <= j <= j2
+    virtual size_type countElementsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const {
+
+        size_type cnt = 0;
+        forEachValuedPositionInRange(i1, i2, j1, j2, [&cnt](size_type, size_type, elem_type) { cnt++; return true; });
 
+        return cnt;
+
+    }
+
+
+    // switches the K2Tree to read-only mode: afterwards, all methods modifying the instance (setNull(), load(), ...)
+    // throw a std::runtime_error, so that a single instance can be shared by any number of concurrent readers
+    // (copies and clones are not read-only)
+    void setReadOnly() {
+        readOnly_ = true;
+    }
+
+    bool isReadOnly() const {
+        return readOnly_;
+    }
 
     // creates a deep copy
     virtual K2Tree* clone() const = 0;
 
     // prints the parameters (and contents) of the K2Tree
-    virtual void print(bool all = false) = 0;
+    virtual void print(bool all = false) const = 0;
+
+    // writes the K2Tree (parameters and all data structures, including the rank data structures) to a stream in a versioned binary format
+    virtual void serialize(std::ostream& out) const = 0;
+
+    // replaces the contents of the K2Tree with those read from a stream written by serialize()
+    // (throws a std::runtime_error if the stream does not contain a serialised instance of the same implementation)
+    virtual void load(std::istream& in) = 0;
 
     // compares the K2Tree with a given (relation) matrix
-    virtual bool compare(matrix_type& mat, elem_type null, bool silent) {
+    virtual bool compare(matrix_type& mat, elem_type null, bool silent) const {
 
         bool overallEqual = true;
         bool equal;
@@ -568,7 +757,7 @@ public:
     }
 
     // compares the K2Tree with another K2Tree
-    virtual bool compare(K2Tree& other, bool silent) {
+    virtual bool compare(const K2Tree& other, bool silent) const {
 
         bool overallEqual = true;
         bool equal;
@@ -1011,30 +1200,106 @@ public:
     // sets the value of the pair (i,j) to null, i.e. removes it from the relation
     virtual void setNull(size_type i, size_type j) = 0;
 
+    // reorganises the internal structures after setNull() calls (e.g. removes emptied subtrees) without changing the relation
+    virtual void compact() { }
+
+    // returns the memory footprint of the K2Tree in bytes, broken down by component
+    virtual SizeBreakdown sizeInBytes() const = 0;
+
     // returns the smallest column number j such that (i,j) is in R, or a value >= n if no such pairs exists
-    virtual size_type getFirstSuccessor(size_type i) = 0;
+    virtual size_type getFirstSuccessor(size_type i) const = 0;
 
     /*
      * Method aliases using "relation nomenclature" (similar to the names proposed by Brisaboa et al.)
      */
 
     // alias of isNotNull()
-    virtual bool areRelated(size_type i, size_type j) = 0;
+    virtual bool areRelated(size_type i, size_type j) const = 0;
 
     // alias of getSuccessorPositions()
-    virtual std::vector<size_type> getSuccessors(size_type i) = 0;
+    virtual std::vector<size_type> getSuccessors(size_type i) const = 0;
 
     // alias of getPredecessorPositions()
-    virtual std::vector<size_type> getPredecessors(size_type j) = 0;
+    virtual std::vector<size_type> getPredecessors(size_type j) const = 0;
 
     // alias of getPositionsInRange()
-    virtual positions_type getRange(size_type i1, size_type i2, size_type j1, size_type j2) = 0;
+    virtual positions_type getRange(size_type i1, size_type i2, size_type j1, size_type j2) const = 0;
 
     // alias of containsElement()
-    virtual bool containsLink(size_type i1, size_type i2, size_type j1, size_type j2) = 0;
+    virtual bool containsLink(size_type i1, size_type i2, size_type j1, size_type j2) const = 0;
 
     // alias of countElements()
-    virtual size_type countLinks() = 0;
+    virtual size_type countLinks() const = 0;
+
+    // alias of countElementsInRange()
+    size_type countLinksInRange(size_type i1, size_type i2, size_type j1, size_type j2) const {
+        return countElementsInRange(i1, i2, j1, j2);
+    }
+
+    // alias of getSuccessorPositions(i, limit)
+    std::vector<size_type> getSuccessors(size_type i, size_type limit) const {
+        return getSuccessorPositions(i, limit);
+    }
+
+    // alias of getPositionsInRange(i1, i2, j1, j2, limit)
+    positions_type getRange(size_type i1, size_type i2, size_type j1, size_type j2, size_type limit) const {
+        return getPositionsInRange(i1, i2, j1, j2, limit);
+    }
+
+protected:
+    // throws a std::runtime_error if the K2Tree is in read-only mode
+    void checkWritable(const std::string& method) const {
+
+        if (readOnly_) {
+            throw std::runtime_error(method + "() is not supported by a read-only K2Tree.");
+        }
+
+    }
+
+    /* helper methods for expandFrontier() */
+
+    // returns the rows of frontier in ascending order without duplicates
+    std::vector<size_type> prepareFrontier(const std::vector<size_type>& frontier, const std::vector<bool>& visited) const {
+
+        if (!visited.empty() && (visited.size() < getNumCols())) {
+            throw std::runtime_error("The visited bitmap passed to expandFrontier() has to cover all columns.");
+        }
+
+        std::vector<size_type> rows(frontier);
+        std::sort(rows.begin(), rows.end());
+        rows.erase(std::unique(rows.begin(), rows.end()), rows.end());
+
+        return rows;
+
+    }
+
+    // adds column j to cols, unless visited is not empty and j has already been visited
+    static void addToFrontier(size_type j, std::vector<size_type>& cols, std::vector<bool>& visited) {
+
+        if (visited.empty()) {
+            cols.push_back(j);
+        } else if (!visited[j]) {
+
+            visited[j] = true;
+            cols.push_back(j);
+
+        }
+
+    }
+
+    // sorts cols (duplicates can only occur if no visited bitmap is used)
+    static void finishFrontier(std::vector<size_type>& cols, const std::vector<bool>& visited) {
+
+        std::sort(cols.begin(), cols.end());
+
+        if (visited.empty()) {
+            cols.erase(std::unique(cols.begin(), cols.end()), cols.end());
+        }
+
+    }
+
+private:
+    bool readOnly_ = false; // see setReadOnly()
 
 };
 
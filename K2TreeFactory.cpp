@@ -0,0 +1,482 @@
+/*
+ * Copyright (C) 2017 Robert Mueller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Contact: Robert Mueller <romueller@techfak.uni-bielefeld.de>
+ * Faculty of Technology, Bielefeld University,
+ * PO box 100131, DE-33501 Bielefeld, Germany
+ */
+
+#include "K2TreeFactory.hpp"
+
+std::string toString(const K2TreeConfig& config) {
+
+    switch (config.kind) {
+
+        case BASIC_K2TREE:
+            return "BasicK2Tree(k=" + std::to_string(config.k) + ")";
+
+        case KRKC_TREE:
+            return "KrKcTree(kr=" + std::to_string(config.kr) + ",kc=" + std::to_string(config.kc) + ")";
+
+        case HYBRID_K2TREE:
+            return "HybridK2Tree(upperK=" + std::to_string(config.upperK) + ",upperH=" + std::to_string(config.upperH) + ",lowerK=" + std::to_string(config.lowerK) + ")";
+
+        case UNEVEN_KRKC_OR_MINI_TREE:
+            return "UnevenKrKcOrMiniTree(kr=" + std::to_string(config.kr) + ",kc=" + std::to_string(config.kc) + ",mb=" + std::to_string(config.mb) + ")";
+
+        default:
+            return "unknown";
+
+    }
+
+}
+
+
+/* helper methods for estimating the costs of a configuration */
+
+// padded matrices beyond this number of rows / columns are not considered (to avoid overflows)
+const double K2TREES_MAX_TUNING_DIM = 1e18;
+
+// estimated costs of a tree (or a partition)
+struct TreeEstimate {
+
+    double bytes = 0;
+    double successorCost = 0; // bits inspected by a successor query
+    double predecessorCost = 0; // bits inspected by a predecessor query
+
+};
+
+// estimates the number of distinct classes (here: non-empty nodes) from a sample of n elements (sampling fraction 1 / scale)
+// in which observed classes occur, single of them exactly once and twice of them exactly twice:
+// the observed classes are divided by the sample coverage estimated from single and twice (Chao & Jost 2012),
+// the unseen classes are at most the extrapolated single hits (which is also the estimate for samples without doubles)
+double estimateDistinct(double observed, double single, double twice, double n, double scale) {
+
+    if ((single == 0) || (scale <= 1)) {
+        return observed;
+    }
+
+    double extrapolated = single * (scale - 1);
+    double coverage = 1 - (single / n) * ((n > 1) ? (n - 1) * single / ((n - 1) * single + 2 * twice) : 1);
+
+    return observed + ((coverage > 0) ? std::min(observed / coverage - observed, extrapolated) : extrapolated);
+
+}
+
+// estimates the number of non-empty nodes on each level l of a tree with arities kr[l] x kc[l] over the numRows x numCols submatrix
+// with upper left corner (p, q), based on the pairs sample[left, right) of it (scale = inverse sampling rate, numPairs = estimated number of pairs):
+// the sample is partitioned level by level like in buildFromListsInplace(), a node is non-empty iff its key interval is non-empty,
+// and the unseen nodes are estimated from the nodes hit by one and by two sampled pairs (see estimateDistinct())
+std::vector<double> estimateLevels(RelationPairs& sample, size_type left, size_type right, size_type p, size_type q, size_type numRows, size_type numCols,
+                                   const std::vector<size_type>& kr, const std::vector<size_type>& kc, double scale, double numPairs) {
+
+    struct Block {
+        size_type p, q, left, right;
+    };
+
+    std::vector<Block> level(1, Block{p, q, left, right});
+    std::vector<Block> next;
+    std::vector<double> ones(kr.size(), 0);
+
+    std::vector<std::pair<size_type, size_type>> intervals;
+    std::vector<size_type> counts;
+    RelationPairs tmp;
+
+    size_type rows = numRows;
+    size_type cols = numCols;
+    double numBlocks = 1; // number of nodes on the current level
+    double prev = 1; // (estimated) number of non-empty nodes on the previous level
+
+    for (size_type l = 0; l < kr.size() && !level.empty(); l++) {
+
+        size_type numChildren = kr[l] * kc[l];
+        rows /= kr[l];
+        cols /= kc[l];
+        numBlocks *= numChildren;
+
+        size_type multi = 0; // non-empty nodes hit by at least two sampled pairs
+        size_type single = 0; // non-empty nodes hit by exactly one sampled pair
+        size_type twice = 0; // non-empty nodes hit by exactly two sampled pairs
+        next.clear();
+
+        for (auto& b : level) {
+
+            countingSortByKey(sample, b.left, b.right, numChildren, [&](const RelationPairs::value_type& x) {
+                return ((x.first - b.p) / rows) * kc[l] + (x.second - b.q) / cols;
+            }, intervals, counts, tmp, 1);
+
+            for (size_type c = 0; c < numChildren; c++) {
+
+                size_type len = intervals[c].second - intervals[c].first;
+
+                if (len != 0) {
+
+                    (len == 1) ? single++ : multi++;
+                    twice += (len == 2);
+                    next.push_back(Block{b.p + (c / kc[l]) * rows, b.q + (c % kc[l]) * cols, b.left + intervals[c].first, b.left + intervals[c].second});
+
+                }
+
+            }
+
+        }
+
+        // every non-empty node has at least one and at most numChildren non-empty children
+        ones[l] = std::min({estimateDistinct(multi + single, single, twice, right - left, scale), numPairs, numBlocks, prev * numChildren});
+        ones[l] = std::max(ones[l], std::min(prev, numPairs));
+        prev = ones[l];
+
+        std::swap(level, next);
+
+    }
+
+    return ones;
+
+}
+
+// determines the size and the query costs of a tree with arities kr[l] x kc[l] and ones[l] non-empty nodes on level l
+TreeEstimate evaluateLevels(const std::vector<double>& ones, const std::vector<size_type>& kr, const std::vector<size_type>& kc, size_type elemSize) {
+
+    TreeEstimate res;
+
+    double bitsT = 0;
+    double bitsL = 0;
+    double prev = 1; // non-empty nodes on the previous level
+    double rowBands = 1; // number of row bands on the previous level
+    double colBands = 1; // number of column bands on the previous level
+
+    for (size_type l = 0; l < ones.size(); l++) {
+
+        double bits = prev * kr[l] * kc[l];
+        if (l + 1 < ones.size()) {
+            bitsT += bits;
+        } else {
+            bitsL = bits;
+        }
+
+        // a query inspects the kc (kr) children of all non-empty nodes of the previous level intersecting its row (column)
+        res.successorCost += (prev / rowBands) * kc[l];
+        res.predecessorCost += (prev / colBands) * kr[l];
+
+        rowBands *= kr[l];
+        colBands *= kc[l];
+        prev = ones[l];
+
+    }
+
+    double rankOverhead = (K2TREES_RANK_ID == 1) ? 0.0625 : ((K2TREES_RANK_ID == 2) ? 0.125 : 0.25);
+    res.bytes = bitsT / 8 * (1 + rankOverhead) + ((elemSize == 0) ? bitsL / 8 : bitsL * elemSize);
+
+    return res;
+
+}
+
+// estimates a tree with arity kr x kc on all h levels over the corresponding submatrix with upper left corner (p, q)
+TreeEstimate estimateTree(RelationPairs& sample, size_type left, size_type right, size_type p, size_type q, size_type kr, size_type kc, size_type h,
+                          size_type elemSize, double scale, double numPairs) {
+
+    std::vector<size_type> krs(h, kr);
+    std::vector<size_type> kcs(h, kc);
+    auto ones = estimateLevels(sample, left, right, p, q, size_type(pow(kr, h)), size_type(pow(kc, h)), krs, kcs, scale, numPairs);
+
+    return evaluateLevels(ones, krs, kcs, elemSize);
+
+}
+
+// returns the size of the object of the given kind itself (the bool variants, which are the same as the valued ones up to the null element)
+size_type objectBytes(K2TreeKind kind) {
+
+    switch (kind) {
+
+        case BASIC_K2TREE:
+            return sizeof(BasicK2Tree<bool>);
+
+        case KRKC_TREE:
+            return sizeof(KrKcTree<bool>);
+
+        case HYBRID_K2TREE:
+            return sizeof(HybridK2Tree<bool>);
+
+        case UNEVEN_KRKC_OR_MINI_TREE:
+            return sizeof(UnevenKrKcOrMiniTree<bool>);
+
+        default:
+            return 0;
+
+    }
+
+}
+
+K2TreeConfig makeConfig(K2TreeKind kind, const TreeEstimate& est) {
+
+    K2TreeConfig config;
+    config.kind = kind;
+    config.bytes = est.bytes + objectBytes(kind); // the objects decide between otherwise equally large configurations
+    config.queryCost = (est.successorCost + est.predecessorCost) / 2;
+
+    return config;
+
+}
+
+// estimates UnevenKrKcOrMiniTree for arities kr and kc, choosing the best mb for the objective
+K2TreeConfig estimateUneven(RelationPairs& sample, size_type numPairs, size_type numRows, size_type numCols, size_type kr, size_type kc, size_type elemSize,
+                            double scale, TuningObjective objective) {
+
+    size_type hr = std::max((size_type) 1, logK(numRows, kr));
+    size_type hc = std::max((size_type) 1, logK(numCols, kc));
+    bool vertical = (hc > hr); // partitioned by columns?
+    size_type h = std::min(hr, hc);
+    size_type partitionSize = (size_type) pow(vertical ? kc : kr, h);
+    double numPartitions = pow(vertical ? kc : kr, (vertical ? hc : hr) - h);
+
+    // group the sampled pairs by partition
+    std::stable_sort(sample.begin(), sample.end(), [&](const RelationPairs::value_type& a, const RelationPairs::value_type& b) {
+        return (vertical ? a.second : a.first) / partitionSize < (vertical ? b.second : b.first) / partitionSize;
+    });
+
+    struct Partition {
+        double numPairs;
+        TreeEstimate tree;
+        TreeEstimate mini;
+    };
+
+    std::vector<Partition> parts;
+    for (size_type left = 0, right; left < sample.size(); left = right) {
+
+        size_type part = (vertical ? sample[left].second : sample[left].first) / partitionSize;
+        for (right = left; right < sample.size() && (vertical ? sample[right].second : sample[right].first) / partitionSize == part; right++) { }
+
+        Partition pt;
+        pt.numPairs = std::min((double) numPairs, (right - left) * scale);
+
+        pt.tree = estimateTree(sample, left, right, vertical ? 0 : part * partitionSize, vertical ? part * partitionSize : 0, kr, kc, h, elemSize, scale, pt.numPairs);
+        pt.tree.bytes += sizeof(KrKcTree<bool>);
+
+        // pairs (plus values) and their column order, queries by binary search followed by a scan over the result
+        pt.mini.bytes = pt.numPairs * (sizeof(std::pair<size_type, size_type>) + elemSize + sizeof(size_type)) + sizeof(MiniK2Tree<bool>);
+        pt.mini.successorCost = std::log2(pt.numPairs + 1) + pt.numPairs / pow(kr, h);
+        pt.mini.predecessorCost = std::log2(pt.numPairs + 1) + pt.numPairs / pow(kc, h);
+
+        parts.push_back(pt);
+
+    }
+
+    std::sort(parts.begin(), parts.end(), [](const Partition& a, const Partition& b) {
+        return a.numPairs < b.numPairs;
+    });
+
+    // a query for a row (column) visits all partitions in a vertical (horizontal) partitioning, but only one otherwise
+    auto evaluate = [&](size_type numMini) {
+
+        TreeEstimate res;
+        res.bytes = numPartitions * sizeof(K2Tree<bool>*);
+
+        for (size_type x = 0; x < parts.size(); x++) {
+
+            auto& e = (x < numMini) ? parts[x].mini : parts[x].tree;
+            res.bytes += e.bytes;
+            res.successorCost += e.successorCost / (vertical ? 1 : numPartitions);
+            res.predecessorCost += e.predecessorCost / (vertical ? numPartitions : 1);
+
+        }
+
+        return res;
+
+    };
+
+    // the partitions with at most mb pairs are MiniK2Trees, so the candidates for mb are the sizes of the partitions
+    K2TreeConfig best;
+    for (size_type numMini = 0; numMini <= parts.size(); numMini++) {
+
+        if ((numMini != 0) && (numMini < parts.size()) && (size_type(parts[numMini - 1].numPairs) == size_type(parts[numMini].numPairs))) {
+            continue; // the same mb would also turn the next partition into a MiniK2Tree
+        }
+
+        auto config = makeConfig(UNEVEN_KRKC_OR_MINI_TREE, evaluate(numMini));
+        config.kr = kr;
+        config.kc = kc;
+        config.mb = (numMini == 0) ? 0 : size_type(parts[numMini - 1].numPairs);
+
+        if ((numMini == 0) || (selectK2TreeConfig({best, config}, objective).mb == config.mb)) {
+            best = config;
+        }
+
+    }
+
+    return best;
+
+}
+
+std::vector<K2TreeConfig> estimateK2TreeConfigs(RelationPairs& sample, size_type numPairs, size_type numRows, size_type numCols, size_type elemSize, const TuningOptions& opts) {
+
+    std::vector<K2TreeConfig> candidates;
+
+    double scale = sample.empty() ? 1.0 : (1.0 * numPairs) / sample.size();
+    size_type n = std::max({(size_type) 1, numRows, numCols});
+
+    auto considered = [&](K2TreeKind kind) {
+        return std::find(opts.kinds.begin(), opts.kinds.end(), kind) != opts.kinds.end();
+    };
+
+    if (considered(BASIC_K2TREE)) {
+
+        for (auto k : opts.arities) {
+
+            size_type h = std::max((size_type) 1, logK(n, k));
+            if ((k < 2) || (pow(k, h) > K2TREES_MAX_TUNING_DIM)) continue;
+
+            auto config = makeConfig(BASIC_K2TREE, estimateTree(sample, 0, sample.size(), 0, 0, k, k, h, elemSize, scale, numPairs));
+            config.k = k;
+            candidates.push_back(config);
+
+        }
+
+    }
+
+    if (considered(KRKC_TREE)) {
+
+        for (auto kr : opts.arities) {
+            for (auto kc : opts.arities) {
+
+                size_type h = std::max({(size_type) 1, logK(numRows, kr), logK(numCols, kc)});
+                if ((kr < 2) || (kc < 2) || (kr == kc) || (pow(kr, h) > K2TREES_MAX_TUNING_DIM) || (pow(kc, h) > K2TREES_MAX_TUNING_DIM)) continue; // kr == kc: BasicK2Tree
+
+                auto config = makeConfig(KRKC_TREE, estimateTree(sample, 0, sample.size(), 0, 0, kr, kc, h, elemSize, scale, numPairs));
+                config.kr = kr;
+                config.kc = kc;
+                candidates.push_back(config);
+
+            }
+        }
+
+    }
+
+    if (considered(HYBRID_K2TREE)) {
+
+        for (auto upperK : opts.arities) {
+            for (auto lowerK : opts.arities) {
+
+                if ((lowerK < 2) || (upperK <= lowerK)) continue;
+
+                // same choice of the heights as in the constructors of HybridK2Tree
+                size_type maxUpperH = std::max((size_type) 1, logK(size_type(ceil((1.0 * n) / lowerK)), upperK));
+                for (size_type upperH = 1; upperH <= maxUpperH; upperH++) {
+
+                    double nPrime = pow(upperK, upperH);
+                    size_type h = upperH;
+                    do {
+
+                        nPrime *= lowerK;
+                        h++;
+
+                    } while (nPrime < n);
+
+                    if (nPrime > K2TREES_MAX_TUNING_DIM) continue;
+
+                    std::vector<size_type> ks(h, lowerK);
+                    std::fill(ks.begin(), ks.begin() + upperH, upperK);
+
+                    auto ones = estimateLevels(sample, 0, sample.size(), 0, 0, size_type(nPrime), size_type(nPrime), ks, ks, scale, numPairs);
+                    auto config = makeConfig(HYBRID_K2TREE, evaluateLevels(ones, ks, ks, elemSize));
+                    config.upperK = upperK;
+                    config.upperH = upperH;
+                    config.lowerK = lowerK;
+                    candidates.push_back(config);
+
+                }
+
+            }
+        }
+
+    }
+
+    if (considered(UNEVEN_KRKC_OR_MINI_TREE)) {
+
+        for (auto kr : opts.arities) {
+            for (auto kc : opts.arities) {
+
+                if ((kr < 2) || (kc < 2) || (pow(kr, logK(numRows, kr)) > K2TREES_MAX_TUNING_DIM) || (pow(kc, logK(numCols, kc)) > K2TREES_MAX_TUNING_DIM)) continue;
+                candidates.push_back(estimateUneven(sample, numPairs, numRows, numCols, kr, kc, elemSize, scale, opts.objective));
+
+            }
+        }
+
+    }
+
+    if (candidates.empty()) {
+        throw std::runtime_error("No candidate configuration for tuning the K2Tree (check the arities and kinds of the TuningOptions).");
+    }
+
+    return candidates;
+
+}
+
+K2TreeConfig selectK2TreeConfig(const std::vector<K2TreeConfig>& candidates, TuningObjective objective) {
+
+    if (candidates.empty()) {
+        throw std::runtime_error("No candidate configuration to select from.");
+    }
+
+    auto better = [&](const K2TreeConfig& a, const K2TreeConfig& b) {
+        return (objective == MIN_SPACE) ? std::make_pair(a.bytes, a.queryCost) < std::make_pair(b.bytes, b.queryCost)
+                                        : std::make_pair(a.queryCost, a.bytes) < std::make_pair(b.queryCost, b.bytes);
+    };
+
+    return *std::min_element(candidates.begin(), candidates.end(), better);
+
+}
+
+K2TreeConfig tuneK2Tree(const RelationPairs& pairs, const TuningOptions& opts) {
+
+    if (pairs.empty()) {
+        throw std::runtime_error("Cannot tune a K2Tree for an empty relation.");
+    }
+
+    size_type numRows, numCols;
+    auto sample = samplePositions(pairs.size(), opts.sampleSize, opts.seed, [&](size_type x) {
+        return pairs[x];
+    }, numRows, numCols);
+
+    return selectK2TreeConfig(estimateK2TreeConfigs(sample, pairs.size(), numRows, numCols, 0, opts), opts.objective);
+
+}
+
+K2Tree<bool>* buildK2Tree(RelationPairs& pairs, const K2TreeConfig& config, const size_type numThreads) {
+
+    switch (config.kind) {
+
+        case BASIC_K2TREE:
+            return new BasicK2Tree<bool>(pairs, config.k, numThreads);
+
+        case KRKC_TREE:
+            return new KrKcTree<bool>(pairs, config.kr, config.kc, numThreads);
+
+        case HYBRID_K2TREE:
+            return new HybridK2Tree<bool>(pairs, config.upperK, config.upperH, config.lowerK, numThreads);
+
+        case UNEVEN_KRKC_OR_MINI_TREE:
+            return new UnevenKrKcOrMiniTree<bool>(pairs, config.kr, config.kc, config.mb, numThreads);
+
+        default:
+            throw std::runtime_error("Unknown kind of K2Tree " + std::to_string(config.kind) + ".");
+
+    }
+
+}
+
+K2Tree<bool>* buildTunedK2Tree(RelationPairs& pairs, const TuningOptions& opts, const size_type numThreads) {
+    return buildK2Tree(pairs, tuneK2Tree(pairs, opts), numThreads);
+}
@@ -0,0 +1,187 @@
+/*
+ * Copyright (C) 2017 Robert Mueller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Contact: Robert Mueller <romueller@techfak.uni-bielefeld.de>
+ * Faculty of Technology, Bielefeld University,
+ * PO box 100131, DE-33501 Bielefeld, Germany
+ */
+
+#ifndef K2TREES_K2TREEFACTORY_HPP
+#define K2TREES_K2TREEFACTORY_HPP
+
+#include <random>
+
+#include "K2Tree.hpp"
+#include "StaticBasicRectangularTree.hpp"
+#include "StaticBasicTree.hpp"
+#include "StaticHybridTree.hpp"
+#include "StaticUnevenRectangularOrMiniTree.hpp"
+#include "Utility.hpp"
+
+/**
+ * Choice of the K2Tree implementation and its parameters (k, kr / kc, upperK / upperH / lowerK, mb) for a given relation.
+ *
+ * The candidate configurations are evaluated on a random sample of the pairs: the sample is partitioned level by level
+ * with the same counting sort as in buildFromListsInplace(), so that the non-empty key intervals of a level are its
+ * non-empty nodes. The number of non-empty nodes of the whole relation is estimated from the nodes hit by one and by two
+ * sampled pairs (via the sample coverage, as for the number of species in a population), so that clustered relations,
+ * whose nodes are rarely hit only once, are not overestimated. The estimated number of nodes per level determines the size of T,
+ * of the rank data structure and of L as well as the expected number of bits inspected by a successor / predecessor query.
+ *
+ * tuneK2Tree() returns the best configuration under the chosen objective, buildK2Tree() constructs it
+ * and buildTunedK2Tree() does both.
+ */
+
+// data structures considered by tuneK2Tree()
+enum K2TreeKind {
+    BASIC_K2TREE, KRKC_TREE, HYBRID_K2TREE, UNEVEN_KRKC_OR_MINI_TREE
+};
+
+// objective of tuneK2Tree()
+enum TuningObjective {
+    MIN_SPACE, // smallest estimated size
+    MIN_QUERY_COST // smallest estimated number of bits inspected per successor / predecessor query
+};
+
+// parameters of a K2Tree (only those of the respective kind are set) and its estimated costs
+struct K2TreeConfig {
+
+    K2TreeKind kind = BASIC_K2TREE;
+
+    size_type k = 0; // arity of BasicK2Tree
+    size_type kr = 0; // row arity of KrKcTree and UnevenKrKcOrMiniTree
+    size_type kc = 0; // column arity of KrKcTree and UnevenKrKcOrMiniTree
+    size_type upperK = 0; // arity in the upper part of HybridK2Tree
+    size_type upperH = 0; // height of the upper part of HybridK2Tree
+    size_type lowerK = 0; // arity in the lower part of HybridK2Tree
+    size_type mb = 0; // partitions of UnevenKrKcOrMiniTree with at most mb pairs are represented by MiniK2Trees
+
+    double bytes = 0; // estimated size in bytes
+    double queryCost = 0; // estimated number of bits inspected per successor / predecessor query (on average)
+
+};
+
+// returns a description of the configuration, e.g. "HybridK2Tree(upperK=4,upperH=2,lowerK=2)"
+std::string toString(const K2TreeConfig& config);
+
+struct TuningOptions {
+
+    TuningObjective objective = MIN_SPACE;
+
+    size_type sampleSize = 1 << 16; // maximal number of pairs the estimates are based on (all pairs are used if there are fewer)
+    size_type seed = 0; // seed for drawing the sample
+
+    std::vector<size_type> arities = {2, 4, 8}; // candidate values of k, kr, kc, upperK and lowerK
+    std::vector<K2TreeKind> kinds = {BASIC_K2TREE, KRKC_TREE, HYBRID_K2TREE, UNEVEN_KRKC_OR_MINI_TREE};
+
+};
+
+// estimates all candidate configurations (according to opts) for a relation with numPairs pairs in a numRows x numCols matrix
+// from sample, a subset of its positions (which is reordered), elemSize is the size of a value in L (0 for bool, i.e. one bit)
+std::vector<K2TreeConfig> estimateK2TreeConfigs(RelationPairs& sample, size_type numPairs, size_type numRows, size_type numCols, size_type elemSize, const TuningOptions& opts);
+
+// returns the best of the (non-empty list of) candidates under the given objective
+K2TreeConfig selectK2TreeConfig(const std::vector<K2TreeConfig>& candidates, TuningObjective objective);
+
+// determines the best configuration for the relation pairs
+K2TreeConfig tuneK2Tree(const RelationPairs& pairs, const TuningOptions& opts = TuningOptions());
+
+// builds the K2Tree described by config from pairs (which may be reordered), see the list-of-pairs-based constructors
+K2Tree<bool>* buildK2Tree(RelationPairs& pairs, const K2TreeConfig& config, const size_type numThreads = 1);
+
+// determines the best configuration for pairs (which may be reordered) and builds it
+K2Tree<bool>* buildTunedK2Tree(RelationPairs& pairs, const TuningOptions& opts = TuningOptions(), const size_type numThreads = 1);
+
+
+/* Variants for valued relations (of type E != bool) */
+
+// draws a uniform random sample (in the original order) of at most sampleSize of the n positions pos(0), ..., pos(n - 1)
+// and determines the number of rows and columns spanned by them
+template<typename F>
+RelationPairs samplePositions(size_type n, size_type sampleSize, size_type seed, F pos, size_type& numRows, size_type& numCols) {
+
+    RelationPairs sample;
+    sample.reserve(std::min(n, sampleSize));
+
+    std::mt19937_64 gen(seed);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+
+    numRows = 0;
+    numCols = 0;
+
+    // selection sampling: the x-th position is taken with probability (number still needed) / (number remaining)
+    for (size_type x = 0; x < n; x++) {
+
+        auto p = pos(x);
+        numRows = std::max(numRows, p.first + 1);
+        numCols = std::max(numCols, p.second + 1);
+
+        if ((n <= sampleSize) || ((n - x) * unit(gen) < sampleSize - sample.size())) {
+            sample.push_back(p);
+        }
+
+    }
+
+    return sample;
+
+}
+
+template<typename E>
+K2TreeConfig tuneK2Tree(const std::vector<ValuedPosition<E>>& pairs, const TuningOptions& opts = TuningOptions()) {
+
+    if (pairs.empty()) {
+        throw std::runtime_error("Cannot tune a K2Tree for an empty relation.");
+    }
+
+    size_type numRows, numCols;
+    auto sample = samplePositions(pairs.size(), opts.sampleSize, opts.seed, [&](size_type x) {
+        return std::make_pair(pairs[x].row, pairs[x].col);
+    }, numRows, numCols);
+
+    return selectK2TreeConfig(estimateK2TreeConfigs(sample, pairs.size(), numRows, numCols, sizeof(E), opts), opts.objective);
+
+}
+
+template<typename E>
+K2Tree<E>* buildK2Tree(std::vector<ValuedPosition<E>>& pairs, const K2TreeConfig& config, const E null = E(), const size_type numThreads = 1) {
+
+    switch (config.kind) {
+
+        case BASIC_K2TREE:
+            return new BasicK2Tree<E>(pairs, config.k, null, numThreads);
+
+        case KRKC_TREE:
+            return new KrKcTree<E>(pairs, config.kr, config.kc, null, numThreads);
+
+        case HYBRID_K2TREE:
+            return new HybridK2Tree<E>(pairs, config.upperK, config.upperH, config.lowerK, null, numThreads);
+
+        case UNEVEN_KRKC_OR_MINI_TREE:
+            return new UnevenKrKcOrMiniTree<E>(pairs, config.kr, config.kc, config.mb, null, numThreads);
+
+        default:
+            throw std::runtime_error("Unknown kind of K2Tree " + std::to_string(config.kind) + ".");
+
+    }
+
+}
+
+template<typename E>
+K2Tree<E>* buildTunedK2Tree(std::vector<ValuedPosition<E>>& pairs, const TuningOptions& opts = TuningOptions(), const E null = E(), const size_type numThreads = 1) {
+    return buildK2Tree(pairs, tuneK2Tree(pairs, opts), null, numThreads);
+}
+
+#endif //K2TREES_K2TREEFACTORY_HPP
@@ -0,0 +1,773 @@
+/*
+ * Copyright (C) 2017 Robert Mueller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Contact: Robert Mueller <romueller@techfak.uni-bielefeld.de>
+ * Faculty of Technology, Bielefeld University,
+ * PO box 100131, DE-33501 Bielefeld, Germany
+ */
+
+#ifndef K2TREES_ROWINDEXEDK2TREE_HPP
+#define K2TREES_ROWINDEXEDK2TREE_HPP
+
+#include "K2Tree.hpp"
+#include "RowTree.hpp"
+#include "StaticHybridRowTree.hpp"
+#include "StaticMiniRowTree.hpp"
+#include "Utility.hpp"
+
+/**
+ * Row-wise implementation of K2Tree.
+ *
+ * Represents every non-empty row of the relation matrix by its own RowTree: rows with at most mb pairs
+ * by a MiniRowTree, all other rows by a HybridRowTree with the parameters upperK, upperH and lowerK.
+ * The RowTrees are located via a bitmap marking the non-empty rows and a rank data structure on it,
+ * so that queries on a single row (successors, first successor, single pairs) jump directly to the RowTree of the row
+ * independent of the number of rows. In exchange, predecessor queries have to inspect all non-empty rows.
+ * The described relation matrix has numRows (numCols) rows (columns), where numRows (numCols) exceeds the row (column) numbers
+ * of all relation pairs by one.
+ */
+template<typename E>
+class RowIndexedK2Tree : public virtual K2Tree<E> {
+
+public:
+    typedef E elem_type;
+
+    typedef typename K2Tree<elem_type>::matrix_type matrix_type;
+    typedef typename K2Tree<elem_type>::list_type list_type;
+    typedef typename K2Tree<elem_type>::positions_type positions_type;
+    typedef typename K2Tree<elem_type>::pairs_type pairs_type;
+
+    // output-buffer and limited variants of the query methods (see K2Tree)
+    using K2Tree<elem_type>::getSuccessorPositions;
+    using K2Tree<elem_type>::getPredecessorPositions;
+    using K2Tree<elem_type>::getPositionsInRange;
+    using K2Tree<elem_type>::getAllValuedPositions;
+    using K2Tree<elem_type>::getSuccessors;
+    using K2Tree<elem_type>::getRange;
+
+
+    RowIndexedK2Tree() {
+
+        numRows_ = 0;
+        numCols_ = 0;
+        upperK_ = 0;
+        upperH_ = 0;
+        lowerK_ = 0;
+        mb_ = 0;
+        null_ = elem_type();
+
+        nonEmptyRank_ = bit_rank_type(&nonEmpty_);
+
+    }
+
+    RowIndexedK2Tree(const RowIndexedK2Tree& other) {
+
+        numRows_ = other.numRows_;
+        numCols_ = other.numCols_;
+        upperK_ = other.upperK_;
+        upperH_ = other.upperH_;
+        lowerK_ = other.lowerK_;
+        mb_ = other.mb_;
+        null_ = other.null_;
+
+        nonEmpty_ = other.nonEmpty_;
+        nonEmptyRank_ = bit_rank_type(&nonEmpty_);
+        dense_ = other.dense_;
+
+        rows_.reserve(other.rows_.size());
+        for (auto r : other.rows_) {
+            rows_.push_back(r->clone());
+        }
+
+    }
+
+    RowIndexedK2Tree& operator=(const RowIndexedK2Tree& other) {
+
+        // check for self-assignment
+        if (&other == this) {
+            return *this;
+        }
+
+        for (auto r : rows_) {
+            delete r;
+        }
+        rows_.clear();
+
+        numRows_ = other.numRows_;
+        numCols_ = other.numCols_;
+        upperK_ = other.upperK_;
+        upperH_ = other.upperH_;
+        lowerK_ = other.lowerK_;
+        mb_ = other.mb_;
+        null_ = other.null_;
+
+        nonEmpty_ = other.nonEmpty_;
+        nonEmptyRank_ = bit_rank_type(&nonEmpty_);
+        dense_ = other.dense_;
+
+        rows_.reserve(other.rows_.size());
+        for (auto r : other.rows_) {
+            rows_.push_back(r->clone());
+        }
+
+        return *this;
+
+    }
+
+    /**
+     * List-of-pairs-based constructor (for valued relations)
+     *
+     * Sorts pairs by row and column. Rows with more than mb pairs are represented by HybridRowTrees (upperK, upperH, lowerK),
+     * all other rows by MiniRowTrees. The RowTrees are built with up to numThreads threads.
+     */
+    RowIndexedK2Tree(pairs_type& pairs, const size_type upperK, const size_type upperH, const size_type lowerK, const size_type mb, const elem_type null = elem_type(), const size_type numThreads = 1) {
+
+        null_ = null;
+
+        upperK_ = upperK;
+        upperH_ = upperH;
+        lowerK_ = lowerK;
+        mb_ = mb;
+
+        std::sort(pairs.begin(), pairs.end(), sortValuedPositions<elem_type>());
+
+        buildRows(pairs.size(), [&](size_type y) { return pairs[y].row; }, [&](size_type y) { return pairs[y].col; }, numThreads,
+                  [&](size_type first, size_type last, bool dense) -> RowTree<elem_type>* {
+
+                      list_type list;
+                      list.reserve(last - first);
+                      for (size_type y = first; y < last; y++) {
+                          list.push_back(std::make_pair(pairs[y].col, pairs[y].val));
+                      }
+
+                      if (dense) {
+                          return new HybridRowTree<elem_type>(list, upperK_, upperH_, lowerK_, null_);
+                      } else {
+                          return new MiniRowTree<elem_type>(list, null_);
+                      }
+
+                  });
+
+    }
+
+    /**
+     * List-of-positions-based constructor (e.g. for the bool specialisations)
+     *
+     * Same as above, but for positions (which are sorted by row and column).
+     */
+    RowIndexedK2Tree(positions_type& pairs, const size_type upperK, const size_type upperH, const size_type lowerK, const size_type mb, const size_type numThreads = 1) {
+
+        null_ = elem_type();
+
+        upperK_ = upperK;
+        upperH_ = upperH;
+        lowerK_ = lowerK;
+        mb_ = mb;
+
+        std::sort(pairs.begin(), pairs.end());
+
+        buildRows(pairs.size(), [&](size_type y) { return pairs[y].first; }, [&](size_type y) { return pairs[y].second; }, numThreads,
+                  [&](size_type first, size_type last, bool dense) -> RowTree<elem_type>* {
+
+                      if (dense) {
+                          return new HybridRowTree<elem_type>(pairs.begin() + first, pairs.begin() + last, upperK_, upperH_, lowerK_);
+                      } else {
+                          return new MiniRowTree<elem_type>(pairs.begin() + first, pairs.begin() + last);
+                      }
+
+                  });
+
+    }
+
+    ~RowIndexedK2Tree() {
+
+        for (auto r : rows_) {
+            delete r;
+        }
+
+    }
+
+
+    // returns the arity of the upper part of the HybridRowTrees
+    size_type getUpperK() const {
+        return upperK_;
+    }
+
+    // returns the (maximum) height of the upper part of the HybridRowTrees
+    size_type getUpperH() const {
+        return upperH_;
+    }
+
+    // returns the arity of the lower part of the HybridRowTrees
+    size_type getLowerK() const {
+        return lowerK_;
+    }
+
+    // returns the maximum number of pairs of the rows represented by MiniRowTrees
+    size_type getMb() const {
+        return mb_;
+    }
+
+    // returns the number of non-empty rows (rows with RowTrees)
+    size_type getNumNonEmptyRows() const {
+        return rows_.size();
+    }
+
+    // returns the RowTree of row i (0 if the row is empty), whose universe contains (at least) the columns
+    // of all pairs in the row, but not necessarily all getNumCols() columns
+    const RowTree<elem_type>* getRowTree(size_type i) const {
+
+        size_type x = rowIndex(i);
+        return (x != rows_.size()) ? rows_[x] : 0;
+
+    }
+
+    size_type getNumRows() const override {
+        return numRows_;
+    }
+
+    size_type getNumCols() const override {
+        return numCols_;
+    }
+
+    elem_type getNull() const override {
+        return null_;
+    }
+
+
+    bool isNotNull(size_type i, size_type j) const override {
+
+        size_type x = rowIndex(i);
+        return (x != rows_.size()) && (j < colBound(x)) && rows_[x]->isNotNull(j);
+
+    }
+
+    elem_type getElement(size_type i, size_type j) const override {
+
+        size_type x = rowIndex(i);
+        return ((x != rows_.size()) && (j < colBound(x))) ? rows_[x]->getElement(j) : null_;
+
+    }
+
+    std::vector<elem_type> getSuccessorElements(size_type i) const override {
+
+        size_type x = rowIndex(i);
+        return (x != rows_.size()) ? rows_[x]->getAllElements() : std::vector<elem_type>();
+
+    }
+
+    std::vector<size_type> getSuccessorPositions(size_type i) const override {
+
+        size_type x = rowIndex(i);
+        return (x != rows_.size()) ? rows_[x]->getAllPositions() : std::vector<size_type>();
+
+    }
+
+    pairs_type getSuccessorValuedPositions(size_type i) const override {
+
+        pairs_type succs;
+
+        size_type x = rowIndex(i);
+        if (x != rows_.size()) {
+
+            for (auto& p : rows_[x]->getAllValuedPositions()) {
+                succs.push_back(ValuedPosition<elem_type>(i, p.first, p.second));
+            }
+
+        }
+
+        return succs;
+
+    }
+
+    std::vector<elem_type> getPredecessorElements(size_type j) const override {
+
+        std::vector<elem_type> preds;
+        forEachPredecessor(j, [&](size_type, elem_type val) { preds.push_back(val); return true; });
+
+        return preds;
+
+    }
+
+    std::vector<size_type> getPredecessorPositions(size_type j) const override {
+
+        std::vector<size_type> preds;
+        forEachPredecessor(j, [&](size_type i, elem_type) { preds.push_back(i); return true; });
+
+        return preds;
+
+    }
+
+    pairs_type getPredecessorValuedPositions(size_type j) const override {
+
+        pairs_type preds;
+        forEachPredecessor(j, [&](size_type i, elem_type val) { preds.push_back(ValuedPosition<elem_type>(i, j, val)); return true; });
+
+        return preds;
+
+    }
+
+    std::vector<elem_type> getElementsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
+
+        std::vector<elem_type> elements;
+        forEachRowInRange(i1, i2, j1, j2, [&](size_type, size_type x, size_type last) {
+
+            auto tmp = rows_[x]->getElementsInRange(j1, last);
+            elements.insert(elements.end(), tmp.begin(), tmp.end());
+
+            return true;
+
+        });
+
+        return elements;
+
+    }
+
+    positions_type getPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
+
+        positions_type pairs;
+        forEachRowInRange(i1, i2, j1, j2, [&](size_type i, size_type x, size_type last) {
+
+            for (auto j : rows_[x]->getPositionsInRange(j1, last)) {
+                pairs.push_back(std::make_pair(i, j));
+            }
+
+            return true;
+
+        });
+
+        return pairs;
+
+    }
+
+    pairs_type getValuedPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
+
+        pairs_type pairs;
+        forEachRowInRange(i1, i2, j1, j2, [&](size_type i, size_type x, size_type last) {
+
+            for (auto& p : rows_[x]->getValuedPositionsInRange(j1, last)) {
+                pairs.push_back(ValuedPosition<elem_type>(i, p.first, p.second));
+            }
+
+            return true;
+
+        });
+
+        return pairs;
+
+    }
+
+    std::vector<elem_type> getAllElements() const override {
+        return (numRows_ == 0) ? std::vector<elem_type>() : getElementsInRange(0, numRows_ - 1, 0, numCols_ - 1);
+    }
+
+    positions_type getAllPositions() const override {
+        return (numRows_ == 0) ? positions_type() : getPositionsInRange(0, numRows_ - 1, 0, numCols_ - 1);
+    }
+
+    pairs_type getAllValuedPositions() const override {
+        return (numRows_ == 0) ? pairs_type() : getValuedPositionsInRange(0, numRows_ - 1, 0, numCols_ - 1);
+    }
+
+    bool forEachSuccessorPosition(size_type i, const std::function<bool(size_type)>& visitor) const override {
+
+        size_type x = rowIndex(i);
+        if (x != rows_.size()) {
+
+            for (auto j : rows_[x]->getAllPositions()) {
+                if (!visitor(j)) return false;
+            }
+
+        }
+
+        return true;
+
+    }
+
+    bool forEachPredecessorPosition(size_type j, const std::function<bool(size_type)>& visitor) const override {
+        return forEachPredecessor(j, [&visitor](size_type i, elem_type) { return visitor(i); });
+    }
+
+    bool forEachValuedPositionInRange(size_type i1, size_type i2, size_type j1, size_type j2, const std::function<bool(size_type, size_type, elem_type)>& visitor) const override {
+
+        return forEachRowInRange(i1, i2, j1, j2, [&](size_type i, size_type x, size_type last) {
+
+            for (auto& p : rows_[x]->getValuedPositionsInRange(j1, last)) {
+                if (!visitor(i, p.first, p.second)) return false;
+            }
+
+            return true;
+
+        });
+
+    }
+
+    bool containsElement(size_type i1, size_type i2, size_type j1, size_type j2) const override {
+        return !forEachRowInRange(i1, i2, j1, j2, [&](size_type, size_type x, size_type last) { return !rows_[x]->containsElement(j1, last); });
+    }
+
+    size_type countElements() const override {
+
+        size_type cnt = 0;
+        for (auto r : rows_) {
+            cnt += r->countElements();
+        }
+
+        return cnt;
+
+    }
+
+    size_type countElementsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
+
+        size_type cnt = 0;
+        forEachRowInRange(i1, i2, j1, j2, [&](size_type, size_type x, size_type last) {
+
+            cnt += ((j1 == 0) && (last + 1 == colBound(x))) ? rows_[x]->countElements() : rows_[x]->getPositionsInRange(j1, last).size();
+            return true;
+
+        });
+
+        return cnt;
+
+    }
+
+
+    K2Tree<elem_type>* clone() const override {
+        return new RowIndexedK2Tree<elem_type>(*this);
+    }
+
+    void print(bool all = false) const override {
+
+        std::cout << "### Parameters ###" << std::endl;
+        std::cout << "numRows = " << numRows_ << std::endl;
+        std::cout << "numCols = " << numCols_ << std::endl;
+        std::cout << "upperK = " << upperK_ << std::endl;
+        std::cout << "upperH = " << upperH_ << std::endl;
+        std::cout << "lowerK = " << lowerK_ << std::endl;
+        std::cout << "mb = " << mb_ << std::endl;
+        std::cout << "null = " << null_ << std::endl;
+        std::cout << "non-empty rows = " << rows_.size() << std::endl;
+
+        if (all) {
+
+            for (size_type i = 0; i < numRows_; i++) {
+
+                std::cout << "===== Row " << i << " =====" << std::endl;
+                size_type x = rowIndex(i);
+                if (x != rows_.size()) {
+                    rows_[x]->print(true);
+                } else {
+                    std::cout << "((ALL NULL))" << std::endl;
+                }
+
+            }
+
+        }
+
+    }
+
+    void serialize(std::ostream& out) const override {
+
+        writeHeader(out, "RowIndexedK2Tree", sizeof(elem_type));
+
+        writeValue(out, numRows_);
+        writeValue(out, numCols_);
+        writeValue(out, upperK_);
+        writeValue(out, upperH_);
+        writeValue(out, lowerK_);
+        writeValue(out, mb_);
+        writeValue(out, null_);
+
+        nonEmpty_.serialize(out);
+        nonEmptyRank_.serialize(out);
+        dense_.serialize(out);
+
+        for (auto r : rows_) {
+            r->serialize(out);
+        }
+
+    }
+
+    void load(std::istream& in) override {
+
+        this->checkWritable("load");
+
+        readHeader(in, "RowIndexedK2Tree", sizeof(elem_type));
+
+        for (auto r : rows_) {
+            delete r;
+        }
+        rows_.clear();
+
+        readValue(in, numRows_);
+        readValue(in, numCols_);
+        readValue(in, upperK_);
+        readValue(in, upperH_);
+        readValue(in, lowerK_);
+        readValue(in, mb_);
+        readValue(in, null_);
+
+        nonEmpty_.load(in);
+        nonEmptyRank_.load(in, &nonEmpty_);
+        dense_.load(in);
+
+        rows_.reserve(dense_.size());
+        for (size_type x = 0; x < dense_.size(); x++) {
+
+            if (dense_[x]) {
+                rows_.push_back(new HybridRowTree<elem_type>());
+            } else {
+                rows_.push_back(new MiniRowTree<elem_type>());
+            }
+            rows_.back()->load(in);
+
+        }
+
+    }
+
+    void setNull(size_type i, size_type j) override {
+
+        this->checkWritable("setNull");
+
+        size_type x = rowIndex(i);
+        if ((x != rows_.size()) && (j < colBound(x))) {
+            rows_[x]->setNull(j);
+        }
+
+    }
+
+    // compacts the RowTrees and drops the rows emptied by setNull() from the index
+    void compact() override {
+
+        this->checkWritable("compact");
+
+        size_type y = 0;
+        for (size_type i = 0, x = 0; i < numRows_; i++) {
+
+            if (nonEmpty_[i]) {
+
+                rows_[x]->compact();
+
+                if (rows_[x]->countElements() == 0) {
+
+                    delete rows_[x];
+                    nonEmpty_[i] = 0;
+
+                } else {
+
+                    rows_[y] = rows_[x];
+                    dense_[y] = dense_[x];
+                    y++;
+
+                }
+
+                x++;
+
+            }
+
+        }
+
+        rows_.resize(y);
+        dense_.resize(y);
+        nonEmptyRank_ = bit_rank_type(&nonEmpty_);
+
+    }
+
+    SizeBreakdown sizeInBytes() const override {
+
+        SizeBreakdown s;
+        for (auto r : rows_) {
+            s += r->sizeInBytes();
+        }
+
+        s.partitions += vectorBytes(rows_) + sdsl::size_in_bytes(nonEmpty_) + sdsl::size_in_bytes(nonEmptyRank_) + sdsl::size_in_bytes(dense_);
+        s.other += sizeof(*this);
+
+        return s;
+
+    }
+
+    size_type getFirstSuccessor(size_type i) const override {
+
+        size_type x = rowIndex(i);
+        if (x == rows_.size()) {
+            return numCols_;
+        }
+
+        size_type j = rows_[x]->getFirst();
+
+        return (j < colBound(x)) ? j : numCols_;
+
+    }
+
+
+
+    bool areRelated(size_type i, size_type j) const override {
+        return isNotNull(i, j);
+    }
+
+    std::vector<size_type> getSuccessors(size_type i) const override {
+        return getSuccessorPositions(i);
+    }
+
+    std::vector<size_type> getPredecessors(size_type j) const override {
+        return getPredecessorPositions(j);
+    }
+
+    positions_type getRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
+        return getPositionsInRange(i1, i2, j1, j2);
+    }
+
+    bool containsLink(size_type i1, size_type i2, size_type j1, size_type j2) const override {
+        return containsElement(i1, i2, j1, j2);
+    }
+
+    size_type countLinks() const override {
+        return countElements();
+    }
+
+private:
+    size_type numRows_; // number of rows in the represented relation matrix
+    size_type numCols_; // number of columns in the represented relation matrix
+    size_type upperK_; // arity of the upper part of the HybridRowTrees
+    size_type upperH_; // (maximum) height of the upper part of the HybridRowTrees
+    size_type lowerK_; // arity of the lower part of the HybridRowTrees
+    size_type mb_; // maximum number of pairs of a row represented by a MiniRowTree
+
+    elem_type null_; // null element
+
+    bit_vector_type nonEmpty_; // marks the rows with at least one pair (i.e. with a RowTree)
+    bit_rank_type nonEmptyRank_; // rank data structure on nonEmpty_, maps a non-empty row to the index of its RowTree
+    bit_vector_type dense_; // marks the RowTrees that are HybridRowTrees (all others are MiniRowTrees)
+    std::vector<RowTree<elem_type>*> rows_; // RowTrees of the non-empty rows (in the order of the rows)
+
+
+    /* helper methods for construction */
+
+    // builds the index and the RowTrees from numPairs pairs sorted by row and column, where rowOf(y) and colOf(y) return the row and
+    // the column of the y-th pair and build(first, last, dense) returns the RowTree of the pairs first, ..., last - 1 (which form a row)
+    template<typename R, typename C, typename B>
+    void buildRows(size_type numPairs, R rowOf, C colOf, size_type numThreads, B build) {
+
+        numRows_ = (numPairs == 0) ? 0 : (rowOf(numPairs - 1) + 1);
+        numCols_ = 0;
+        for (size_type y = 0; y < numPairs; y++) {
+            numCols_ = std::max(numCols_, colOf(y) + 1);
+        }
+
+        // first pair of every non-empty row
+        std::vector<size_type> starts;
+        nonEmpty_ = bit_vector_type(numRows_, 0);
+        for (size_type y = 0; y < numPairs; y++) {
+
+            if ((y == 0) || (rowOf(y) != rowOf(y - 1))) {
+
+                starts.push_back(y);
+                nonEmpty_[rowOf(y)] = 1;
+
+            }
+
+        }
+        starts.push_back(numPairs);
+
+        nonEmptyRank_ = bit_rank_type(&nonEmpty_);
+
+        dense_ = bit_vector_type(starts.size() - 1, 0);
+        for (size_type x = 0; x + 1 < starts.size(); x++) {
+            dense_[x] = (starts[x + 1] - starts[x] > mb_);
+        }
+
+        rows_ = std::vector<RowTree<elem_type>*>(starts.size() - 1, 0);
+        parallelFor(rows_.size(), numThreads, [&](size_type x) {
+            rows_[x] = build(starts[x], starts[x + 1], dense_[x]);
+        });
+
+    }
+
+    /* helper methods for queries */
+
+    // returns the index of the RowTree of row i in rows_ (rows_.size() if the row is empty)
+    size_type rowIndex(size_type i) const {
+        return ((i < numRows_) && nonEmpty_[i]) ? nonEmptyRank_.rank(i) : rows_.size();
+    }
+
+    // returns the number of columns that can be passed to the x-th RowTree
+    // (the universe of a HybridRowTree is only large enough for the columns of its own pairs)
+    size_type colBound(size_type x) const {
+        return dense_[x] ? std::min(rows_[x]->getLength(), numCols_) : numCols_;
+    }
+
+    // calls f(i, x, last) for every non-empty row i with i1 <= i <= i2 whose RowTree x covers column j1,
+    // where last = min(j2, last column of the RowTree), until f returns false, returns false iff the enumeration has been stopped by f
+    template<typename F>
+    bool forEachRowInRange(size_type i1, size_type i2, size_type j1, size_type j2, F f) const {
+
+        if (numRows_ == 0) {
+            return true;
+        }
+
+        i2 = std::min(i2, numRows_ - 1);
+        if ((i1 > i2) || (j1 > j2)) {
+            return true;
+        }
+
+        size_type x = nonEmptyRank_.rank(i1);
+
+        return forEachSetBit(nonEmpty_, i1, i2 - i1 + 1, [&](size_type i) {
+
+            size_type y = x++;
+            size_type bound = colBound(y);
+
+            return (j1 >= bound) || f(i, y, std::min(j2, bound - 1));
+
+        });
+
+    }
+
+    // calls f(i, value) for all pairs (i,j) in R (in the order of the rows) until f returns false,
+    // returns false iff the enumeration has been stopped by f
+    template<typename F>
+    bool forEachPredecessor(size_type j, F f) const {
+
+        if (rows_.empty()) {
+            return true;
+        }
+
+        size_type x = 0;
+
+        return forEachSetBit(nonEmpty_, 0, numRows_, [&](size_type i) {
+
+            bool proceed = true;
+            if (j < colBound(x)) {
+
+                auto val = rows_[x]->getElement(j);
+                if (val != null_) {
+                    proceed = f(i, val);
+                }
+
+            }
+
+            x++;
+
+            return proceed;
+
+        });
+
+    }
+
+};
+
+#endif //K2TREES_ROWINDEXEDK2TREE_HPP
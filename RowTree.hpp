@@ -34,6 +34,8 @@
  * and one value is designated the null element ("element is not in the set").
  *
  * The data structure is static (with the exception of the setNull() method).
+ * All query methods are const and may be called concurrently on a single instance
+ * as long as no modifying method runs at the same time (see setReadOnly()).
  */
 template<typename E>
 class RowTree {
@@ -48,54 +50,72 @@ public:
     virtual ~RowTree() { }
 
     // returns the size of the universe (length of the "row", n)
-    virtual size_type getLength() = 0;
+    virtual size_type getLength() const = 0;
 
     // returns the null element
-    virtual elem_type getNull() = 0;
+    virtual elem_type getNull() const = 0;
 
 
     // checks whether i is in S
-    virtual bool isNotNull(size_type i) = 0;
+    virtual bool isNotNull(size_type i) const = 0;
 
     // returns the value of i, if the element is in S, null otherwise
-    virtual elem_type getElement(size_type i) = 0;
+    virtual elem_type getElement(size_type i) const = 0;
 
     // returns the smallest (left-most) element in S, or a value >= n if S is empty
-    virtual size_type getFirst() = 0;
+    virtual size_type getFirst() const = 0;
 
     // returns the values of all elements i in S with l <= i <= r
-    virtual std::vector<elem_type> getElementsInRange(size_type l, size_type r) = 0;
+    virtual std::vector<elem_type> getElementsInRange(size_type l, size_type r) const = 0;
 
     // returns the positions of all elements i in S with l <= i <= r
-    virtual std::vector<size_type> getPositionsInRange(size_type l, size_type r) = 0;
+    virtual std::vector<size_type> getPositionsInRange(size_type l, size_type r) const = 0;
 
     // returns the positions and values of all elements i in S with l <= i <= r
-    virtual list_type getValuedPositionsInRange(size_type l, size_type r) = 0;
+    virtual list_type getValuedPositionsInRange(size_type l, size_type r) const = 0;
 
     // returns the values of all elements in S
-    virtual std::vector<elem_type> getAllElements() = 0;
+    virtual std::vector<elem_type> getAllElements() const = 0;
 
     // returns the positions of all elements in S
-    virtual std::vector<size_type> getAllPositions() = 0;
+    virtual std::vector<size_type> getAllPositions() const = 0;
 
     // returns the positions and values of all elements in S
-    virtual list_type getAllValuedPositions() = 0;
+    virtual list_type getAllValuedPositions() const = 0;
 
     // checks whether S contains an element i with l <= i <= r
-    virtual bool containsElement(size_type l, size_type r) = 0;
+    virtual bool containsElement(size_type l, size_type r) const = 0;
 
     // counts the number of elements in S
-    virtual size_type countElements() = 0;
+    virtual size_type countElements() const = 0;
 
 
+    // switches the RowTree to read-only mode: afterwards, all methods modifying the instance (setNull(), load(), ...)
+    // throw a std::runtime_error, so that a single instance can be shared by any number of concurrent readers
+    // (copies and clones are not read-only)
+    void setReadOnly() {
+        readOnly_ = true;
+    }
+
+    bool isReadOnly() const {
+        return readOnly_;
+    }
+
     // creates a deep copy
     virtual RowTree* clone() const = 0;
 
     // prints the parameters (and contents) of the RowTree
-    virtual void print(bool all = false) = 0;
+    virtual void print(bool all = false) const = 0;
+
+    // writes the RowTree (parameters and all data structures, including the rank data structures) to a stream in a versioned binary format
+    virtual void serialize(std::ostream& out) const = 0;
+
+    // replaces the contents of the RowTree with those read from a stream written by serialize()
+    // (throws a std::runtime_error if the stream does not contain a serialised instance of the same implementation)
+    virtual void load(std::istream& in) = 0;
 
     // compares the RowTree with a given vector representation
-    virtual bool compare(std::vector<elem_type>& v, elem_type null, bool silent) {
+    virtual bool compare(std::vector<elem_type>& v, elem_type null, bool silent) const {
 
         bool overallEqual = true;
         bool equal;
@@ -303,7 +323,7 @@ public:
     }
 
     // compares the RowTree with another RowTree
-    virtual bool compare(RowTree<elem_type>& other, bool silent) {
+    virtual bool compare(const RowTree<elem_type>& other, bool silent) const {
 
         bool overallEqual = true;
         bool equal;
@@ -477,6 +497,25 @@ public:
     // sets the value of element i to null, i.e. removes it from the set
     virtual void setNull(size_type i) = 0;
 
+    // reorganises the internal structures after setNull() calls (e.g. removes emptied subtrees) without changing the set
+    virtual void compact() { }
+
+    // returns the memory footprint of the RowTree in bytes, broken down by component
+    virtual SizeBreakdown sizeInBytes() const = 0;
+
+protected:
+    // throws a std::runtime_error if the RowTree is in read-only mode
+    void checkWritable(const std::string& method) const {
+
+        if (readOnly_) {
+            throw std::runtime_error(method + "() is not supported by a read-only RowTree.");
+        }
+
+    }
+
+private:
+    bool readOnly_ = false; // see setReadOnly()
+
 };
 
 #endif //K2TREES_ROWTREE_HPP
@@ -46,6 +46,15 @@ public:
     typedef typename K2Tree<elem_type>::positions_type positions_type;
     typedef typename K2Tree<elem_type>::pairs_type pairs_type;
 
+    // output-buffer and limited variants of the query methods (see K2Tree)
+    using K2Tree<elem_type>::getSuccessorPositions;
+    using K2Tree<elem_type>::getPredecessorPositions;
+    using K2Tree<elem_type>::getPositionsInRange;
+    using K2Tree<elem_type>::getAllValuedPositions;
+    using K2Tree<elem_type>::getSuccessors;
+    using K2Tree<elem_type>::getRange;
+    using K2Tree<elem_type>::expandFrontier;
+
 
     KrKcTree() {
         // nothing to do
@@ -62,7 +71,10 @@ public:
 
         T_ = other.T_;
         L_ = other.L_;
+        compressedL_ = other.compressedL_;
         R_ = rank_type(&T_);
+        emptyNodes_ = other.emptyNodes_;
+        countSamples_ = other.countSamples_;
 
     }
 
@@ -82,7 +94,10 @@ public:
 
         T_ = other.T_;
         L_ = other.L_;
+        compressedL_ = other.compressedL_;
         R_ = rank_type(&T_);
+        emptyNodes_ = other.emptyNodes_;
+        countSamples_ = other.countSamples_;
 
         return *this;
 
@@ -339,9 +354,59 @@ public:
     }
 
     /**
-     * List-of-pairs-based constructor (based on section 3.3.5. of Brisaboa et al.)
+     * Streaming constructor that consumes the relation pairs provided by reader one after another and, apart from
+     * the resulting data structure, only keeps the path of the current submatrix (height times kr*kc entries) in memory.
+     *
+     * The pairs have to be sorted in the order in which the (depth-first) construction visits them, i.e. by their kr x kc
+     * submatrix on the first level (in row-major order), then by their submatrix on the second level and so on
+     * (within the kr x kc submatrices of the last level, this is plain row-major order).
+     * The represented matrix is the smallest kr^h x kc^h matrix that has at least numRows rows and numCols columns.
+     * Throws a std::runtime_error if a pair lies outside of this matrix, is out of order or occurs more than once.
+     */
+    KrKcTree(PairReader<elem_type>& reader, const size_type numRows, const size_type numCols, const size_type kr, const size_type kc, const elem_type null = elem_type()) {
+
+        null_ = null;
+
+        kr_ = kr;
+        kc_ = kc;
+        h_ = std::max({(size_type)1, logK(numRows, kr_), logK(numCols, kc_)});
+        numRows_ = size_type(pow(kr_, h_));
+        numCols_ = size_type(pow(kc_, h_));
+
+        std::vector<std::vector<bool>> levels(h_ - 1);
+        buildFromStream(reader, levels, numRows_, numCols_, 1, 0, 0);
+
+        if (reader.hasNext()) {
+            throw std::runtime_error("Pair no. " + std::to_string(reader.getConsumed() + 1) + " at (" + std::to_string(reader.peek().row) + ", " + std::to_string(reader.peek().col) + ") is out of order, outside of the matrix or a duplicate.");
+        }
+
+        size_type total = 0;
+        for (size_type l = 0; l < h_ - 1; l++) {
+            total += levels[l].size();
+        }
+        T_ = bit_vector_type(total);
+
+        bit_vector_type::iterator outIter = T_.begin();
+        for (size_type l = 0; l < h_ - 1; l++) {
+
+            outIter = std::move(levels[l].begin(), levels[l].end(), outIter);
+            levels[l].clear();
+            levels[l].shrink_to_fit();
+
+        }
+
+        R_ = rank_type(&T_);
+
+    }
+
+    /**
+     * List-of-pairs-based constructor
+     *
+     * The mixed-radix keys of the pairs are radix-sorted once and the levels are emitted in a single sweep over them
+     * (see buildLevelsFromSortedKeys()) using up to numThreads threads. If the keys do not fit into 64 bits, the tree is built
+     * level by level as in section 3.3.5. of Brisaboa et al., the subproblems of each level are processed by up to numThreads threads.
      */
-    KrKcTree(pairs_type& pairs, const size_type kr, const size_type kc, const elem_type null = elem_type()) {
+    KrKcTree(pairs_type& pairs, const size_type kr, const size_type kc, const elem_type null = elem_type(), const size_type numThreads = 1) {
 
         null_ = null;
 
@@ -360,7 +425,7 @@ public:
         numCols_ = size_type(pow(kc_, h_));
 
         if (pairs.size() != 0) {
-            buildFromListsInplace(pairs);
+            buildFromSortedKeys(pairs, numThreads);
         }
 
         R_ = rank_type(&T_);
@@ -373,8 +438,10 @@ public:
      *  y = first column of the submatrix
      *  nr = number of rows of the submatrix
      *  nc = number of columns of the submatrix
+     *
+     * The subproblems of each level are processed by up to numThreads threads.
      */
-    KrKcTree(pairs_type& pairs, const size_type x, const size_type y, const size_type nr, const size_type nc, const size_type l, const size_type r, const size_type kr, const size_type kc, const elem_type null = elem_type()) {
+    KrKcTree(pairs_type& pairs, const size_type x, const size_type y, const size_type nr, const size_type nc, const size_type l, const size_type r, const size_type kr, const size_type kc, const elem_type null = elem_type(), const size_type numThreads = 1) {
 
         null_ = null;
 
@@ -387,7 +454,7 @@ public:
         checkParameters(nr, nc, kr, kc);
 
         if (l != r) {
-            buildFromListsInplace(pairs, x, y, nr, nc, l, r);
+            buildFromListsInplace(pairs, x, y, nr, nc, l, r, numThreads);
         }
 
         R_ = rank_type(&T_);
@@ -396,42 +463,52 @@ public:
 
 
     // returns the height of the K2Tree
-    size_type getH() {
+    size_type getH() const {
         return h_;
     }
 
     // returns the row arity of the K2Tree
-    size_type getKr() {
+    size_type getKr() const {
         return kr_;
     }
 
     // returns the column arity of the K2Tree
-    size_type getKc() {
+    size_type getKc() const {
         return kc_;
     }
 
-    size_type getNumRows() override {
+    size_type getNumRows() const override {
         return numRows_;
     }
 
-    size_type getNumCols() override {
+    size_type getNumCols() const override {
         return numCols_;
     }
 
-    elem_type getNull() override {
+    elem_type getNull() const override {
         return null_;
     }
 
 
-    bool isNotNull(size_type i, size_type j) override {
+    bool isNotNull(size_type i, size_type j) const override {
         return checkInit(i, j);
     }
 
-    elem_type getElement(size_type i, size_type j) override {
+    elem_type getElement(size_type i, size_type j) const override {
         return getInit(i, j);
     }
 
-    std::vector<elem_type> getSuccessorElements(size_type i) override {
+    void isNotNull(const positions_type& queries, std::vector<bool>& out) const override {
+        out.assign(queries.size(), false);
+        batchInit(queries, [&](size_type x, size_type pos) { out[x] = (leaf(pos) != null_); });
+    }
+
+    void getElement(const positions_type& queries, std::vector<elem_type>& out) const override {
+        out.assign(queries.size(), null_);
+        batchInit(queries, [&](size_type x, size_type pos) { out[x] = leaf(pos); });
+    }
+
+    std::vector<elem_type> getSuccessorElements(size_type i) const override {
 
         std::vector<elem_type> succs;
         allSuccessorElementsIterative(succs, i);
@@ -441,7 +518,7 @@ public:
 
     }
 
-    std::vector<size_type> getSuccessorPositions(size_type i) override {
+    std::vector<size_type> getSuccessorPositions(size_type i) const override {
 
         std::vector<size_type> succs;
 //        successorsPosInit(succs, i);
@@ -451,7 +528,7 @@ public:
 
     }
 
-    pairs_type getSuccessorValuedPositions(size_type i) override {
+    pairs_type getSuccessorValuedPositions(size_type i) const override {
 
         pairs_type succs;
         allSuccessorValuedPositionsIterative(succs, i);
@@ -461,7 +538,7 @@ public:
 
     }
 
-    std::vector<elem_type> getPredecessorElements(size_type j) override {
+    std::vector<elem_type> getPredecessorElements(size_type j) const override {
 
         std::vector<elem_type> preds;
         predecessorsElemInit(preds, j);
@@ -470,7 +547,7 @@ public:
 
     }
 
-    std::vector<size_type> getPredecessorPositions(size_type j) override {
+    std::vector<size_type> getPredecessorPositions(size_type j) const override {
 
         std::vector<size_type> preds;
         predecessorsPosInit(preds, j);
@@ -479,7 +556,7 @@ public:
 
     }
 
-    pairs_type getPredecessorValuedPositions(size_type j) override {
+    pairs_type getPredecessorValuedPositions(size_type j) const override {
 
         pairs_type preds;
         predecessorsValPosInit(preds, j);
@@ -488,7 +565,7 @@ public:
 
     }
 
-    std::vector<elem_type> getElementsInRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    std::vector<elem_type> getElementsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
 
         std::vector<elem_type> elements;
         rangeElemInit(elements, i1, i2, j1, j2);
@@ -498,7 +575,7 @@ public:
 
     }
 
-    positions_type getPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    positions_type getPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
 
         positions_type pairs;
         rangePosInit(pairs, i1, i2, j1, j2);
@@ -508,7 +585,7 @@ public:
 
     }
 
-    pairs_type getValuedPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    pairs_type getValuedPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
 
         pairs_type pairs;
         rangeValPosInit(pairs, i1, i2, j1, j2);
@@ -518,40 +595,108 @@ public:
 
     }
 
-    std::vector<elem_type> getAllElements() override {
+    std::vector<elem_type> getAllElements() const override {
         return getElementsInRange(0, numRows_ - 1, 0, numCols_ - 1);
     }
 
-    positions_type getAllPositions() override {
+    positions_type getAllPositions() const override {
         return getPositionsInRange(0, numRows_ - 1, 0, numCols_ - 1);
     }
 
-    pairs_type getAllValuedPositions() override {
+    pairs_type getAllValuedPositions() const override {
         return getValuedPositionsInRange(0, numRows_ - 1, 0, numCols_ - 1);
     }
 
-    bool containsElement(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    bool forEachSuccessorPosition(size_type i, const std::function<bool(size_type)>& visitor) const override {
+        return successorsVisitInit(visitor, i);
+    }
+
+    bool forEachPredecessorPosition(size_type j, const std::function<bool(size_type)>& visitor) const override {
+        return predecessorsVisitInit(visitor, j);
+    }
+
+    bool forEachValuedPositionInRange(size_type i1, size_type i2, size_type j1, size_type j2, const std::function<bool(size_type, size_type, elem_type)>& visitor) const override {
+        return rangeValVisitInit(visitor, i1, i2, j1, j2);
+    }
+
+    bool containsElement(size_type i1, size_type i2, size_type j1, size_type j2) const override {
         return elemInRangeInit(i1, i2, j1, j2);
 //        return elemInRangeInit(i1, std::min(i2, numRows_ - 1), j1, std::min(j2, numCols_ - 1));
     }
 
-    size_type countElements() override {
+    size_type countElements() const override {
+
+        if (!countSamples_.empty()) {
+            return countSamples_.back();
+        }
 
         size_type cnt = 0;
-        for (size_type i = 0; i < L_.size(); i++) {
-            cnt += (L_[i] != null_);
+        for (size_type i = 0; i < numLeaves(); i++) {
+            cnt += (leaf(i) != null_);
         }
 
         return cnt;
 
     }
 
+    size_type countElementsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
+        return countRangeInit(i1, i2, j1, j2);
+    }
+
+    // builds the (optional) counting index, a sampled prefix sum over the non-null entries of L,
+    // which makes countElements() constant-time and speeds up counting fully covered submatrices in countElementsInRange()
+    // (the index is kept up to date by setNull(), but it is not written by serialize())
+    void buildCountingIndex() {
+
+        this->checkWritable("buildCountingIndex");
+
+        size_type numSamples = numLeaves() / K2TREES_COUNT_SAMPLE_RATE + 1;
+        countSamples_.assign(numSamples + 1, 0);
+
+        size_type cnt = 0;
+        for (size_type s = 0; s < numSamples; s++) {
+
+            countSamples_[s] = cnt;
+            for (size_type x = s * K2TREES_COUNT_SAMPLE_RATE; x < std::min((s + 1) * K2TREES_COUNT_SAMPLE_RATE, numLeaves()); x++) {
+                cnt += (leaf(x) != null_);
+            }
+
+        }
+
+        countSamples_[numSamples] = cnt;
+
+    }
+
+    bool hasCountingIndex() const {
+        return !countSamples_.empty();
+    }
+
+    // replaces the last level L by a dictionary of its distinct kr*kc blocks (sorted by decreasing frequency)
+    // and the DAC-encoded dictionary index of every leaf block, which saves space when few distinct blocks
+    // (e.g. few distinct weights) make up most of L; afterwards, setNull() is no longer supported
+    void compressLeaves() {
+
+        this->checkWritable("compressLeaves");
+
+        if (L_.empty()) {
+            return;
+        }
+
+        compressedL_ = LeafDictionary<elem_type>(L_, kr_ * kc_);
+        L_ = std::vector<elem_type>(0);
+
+    }
+
+    bool hasCompressedLeaves() const {
+        return !compressedL_.empty();
+    }
+
 
     KrKcTree* clone() const override {
         return new KrKcTree<elem_type>(*this);
     }
 
-    void print(bool all = false) override {
+    void print(bool all = false) const override {
 
         std::cout << "### Parameters ###" << std::endl;
         std::cout << "h  = " << h_ << std::endl;
@@ -568,7 +713,7 @@ public:
             std::cout << std::endl << std::endl;
 
             std::cout << "### L ###" << std::endl;
-            for (auto i = 0; i < L_.size(); i++) std::cout << L_[i];
+            for (size_type i = 0; i < numLeaves(); i++) std::cout << leaf(i);
             std::cout << std::endl << std::endl;
 
             std::cout << "### R ###" << std::endl;
@@ -579,42 +724,175 @@ public:
 
     }
 
-    // note: can "invalidate" the data structure (containsLink() probably won't work correctly afterwards)
+    void serialize(std::ostream& out) const override {
+
+        writeHeader(out, "KrKcTree", sizeof(elem_type));
+
+        writeValue(out, h_);
+        writeValue(out, kr_);
+        writeValue(out, kc_);
+        writeValue(out, numRows_);
+        writeValue(out, numCols_);
+        writeValue(out, null_);
+
+        T_.serialize(out);
+        writeVector(out, L_);
+        compressedL_.serialize(out);
+        R_.serialize(out);
+        emptyNodes_.serialize(out);
+
+    }
+
+    void load(std::istream& in) override {
+
+        this->checkWritable("load");
+
+        unsigned int version = readHeader(in, "KrKcTree", sizeof(elem_type));
+
+        readValue(in, h_);
+        readValue(in, kr_);
+        readValue(in, kc_);
+        readValue(in, numRows_);
+        readValue(in, numCols_);
+        readValue(in, null_);
+
+        T_.load(in);
+        readVector(in, L_);
+        if (version >= 2) {
+            compressedL_.load(in);
+        } else {
+            compressedL_ = LeafDictionary<elem_type>();
+        }
+        R_.load(in, &T_);
+        if (version >= 4) {
+            emptyNodes_.load(in);
+        } else {
+            emptyNodes_ = bit_vector_type();
+        }
+
+        countSamples_.clear();
+
+    }
+
+    // note: emptied subtrees are only marked, compact() removes them from the internal structure
     void setNull(size_type i, size_type j) override {
+
+        this->checkWritable("setNull");
+
+        if (!compressedL_.empty()) {
+            throw std::runtime_error("setNull() is not supported after compressLeaves().");
+        }
+
         setInit(i, j);
     }
 
-    size_type getFirstSuccessor(size_type i) override {
+    // rebuilds the internal structure from the remaining elements, so that the subtrees emptied by setNull() are removed
+    // (the size of the relation matrix remains unchanged, the counting index is rebuilt if present)
+    void compact() override {
+
+        this->checkWritable("compact");
+
+        if (emptyNodes_.empty()) {
+            return;
+        }
+
+        pairs_type pairs = getAllValuedPositions();
+
+        T_ = bit_vector_type();
+        L_.clear();
+        emptyNodes_ = bit_vector_type();
+
+        if (!pairs.empty()) {
+            buildFromListsInplace(pairs, 0, 0, numRows_, numCols_, 0, pairs.size(), 1);
+        }
+
+        R_ = rank_type(&T_);
+
+        if (!countSamples_.empty()) {
+            buildCountingIndex();
+        }
+
+    }
+
+    SizeBreakdown sizeInBytes() const override {
+
+        SizeBreakdown s;
+        s.T = sdsl::size_in_bytes(T_);
+        s.L = vectorBytes(L_) + compressedL_.sizeInBytes();
+        s.rank = sdsl::size_in_bytes(R_);
+        s.aux = sdsl::size_in_bytes(emptyNodes_) + vectorBytes(countSamples_);
+        s.other = sizeof(*this);
+
+        return s;
+
+    }
+
+    size_type getFirstSuccessor(size_type i) const override {
 //        return firstSuccessorInit(i);
         return firstSuccessorPositionIterative(i);
     }
 
+    std::vector<size_type> expandFrontier(const std::vector<size_type>& frontier, std::vector<bool>& visited) const override {
+
+        auto rows = this->prepareFrontier(frontier, visited);
+        std::vector<size_type> cols;
+
+        if ((numLeaves() != 0) && !rows.empty()) {
+            frontierPos(cols, visited, numRows_, numCols_, 0, 0, rows.cbegin(), rows.cend(), 0);
+        }
+
+        this->finishFrontier(cols, visited);
+
+        return cols;
+
+    }
+
+    /*
+     * Set operations (traverse both K2Trees level by level at the same time without decompressing them,
+     * only supported between K2Trees with the same arities and height)
+     */
+
+    // returns a K2Tree representing the union of both relations (for pairs contained in both, the value of this K2Tree is used)
+    KrKcTree getUnion(const KrKcTree& other) const {
+        return combine(other, SET_UNION);
+    }
+
+    // returns a K2Tree representing the pairs of this K2Tree that are also contained in other
+    KrKcTree getIntersection(const KrKcTree& other) const {
+        return combine(other, SET_INTERSECTION);
+    }
+
+    // returns a K2Tree representing the pairs of this K2Tree that are not contained in other
+    KrKcTree getDifference(const KrKcTree& other) const {
+        return combine(other, SET_DIFFERENCE);
+    }
+
 
     /*
      * Method aliases using "relation nomenclature" (similar to the names proposed by Brisaboa et al.)
      */
 
-    bool areRelated(size_type i, size_type j) override {
+    bool areRelated(size_type i, size_type j) const override {
         return isNotNull(i, j);
     }
 
-    std::vector<size_type> getSuccessors(size_type i) override {
+    std::vector<size_type> getSuccessors(size_type i) const override {
         return getSuccessorPositions(i);
     }
 
-    std::vector<size_type> getPredecessors(size_type j) override {
+    std::vector<size_type> getPredecessors(size_type j) const override {
         return getPredecessorPositions(j);
     }
 
-    positions_type getRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    positions_type getRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
         return getPositionsInRange(i1, i2, j1, j2);
     }
 
-    bool containsLink(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    bool containsLink(size_type i1, size_type i2, size_type j1, size_type j2) const override {
         return containsElement(i1, i2, j1, j2);
     }
 
-    size_type countLinks() override {
+    size_type countLinks() const override {
         return countElements();
     }
 
@@ -622,14 +900,23 @@ public:
 
 private:
     // representation of all but the last levels of the K2Tree (internal structure)
-    bit_vector_type T_;
+    level_vector_type T_;
 
     // representation of the last level of the K2Tree (actual values of the relation)
     std::vector<elem_type> L_;
 
+    // (optional) compressed representation of the last level, replaces L_ after compressLeaves()
+    LeafDictionary<elem_type> compressedL_;
+
     // rank data structure for navigation in T_
     rank_type R_;
 
+    // marks the internal nodes whose subtrees have been emptied by setNull() (empty if there are none), see compact()
+    bit_vector_type emptyNodes_;
+
+    // (optional) counting index: number of non-null entries in L_[0..s * K2TREES_COUNT_SAMPLE_RATE) for all samples s, followed by the total number
+    std::vector<size_type> countSamples_;
+
     size_type h_; // height of the K2Tree
     size_type kr_; // row arity of the K2Tree
     size_type kc_; // column arity of the K2Tree
@@ -754,6 +1041,69 @@ private:
 
     }
 
+    /* helper method for streaming construction */
+
+    bool buildFromStream(PairReader<elem_type>& reader, std::vector<std::vector<bool>>& levels, size_type numRows, size_type numCols, size_type l, size_type p, size_type q) {
+
+        // as the pairs are sorted, the submatrix is empty if the next pair does not lie within it
+        if (!reader.hasNext()) {
+            return false;
+        }
+
+        auto& rec = reader.peek();
+        if (!((rec.row >= p) && (rec.row < p + numRows) && (rec.col >= q) && (rec.col < q + numCols))) {
+            return false;
+        }
+
+        if (l == h_) {
+
+            std::vector<elem_type> C(kr_ * kc_, null_);
+
+            for (size_type i = 0; i < kr_; i++) {
+                for (size_type j = 0; j < kc_; j++) {
+
+                    if (reader.hasNext() && (reader.peek().row == p + i) && (reader.peek().col == q + j)) {
+
+                        C[i * kc_ + j] = reader.peek().val;
+                        reader.next();
+
+                    }
+
+                }
+            }
+
+            if (isAll(C, null_)) {
+                return false;
+            } else {
+
+                L_.insert(L_.end(), C.begin(), C.end());
+                return true;
+
+            }
+
+        } else {
+
+            std::vector<bool> C(kr_ * kc_);
+
+            for (size_type i = 0; i < kr_; i++) {
+                for (size_type j = 0; j < kc_; j++) {
+                    C[i * kc_ + j] = buildFromStream(reader, levels, numRows / kr_, numCols / kc_, l + 1, p + i * (numRows / kr_), q + j * (numCols / kc_));
+                }
+            }
+
+            if (isAllZero(C)) {
+                return false;
+            } else {
+
+                levels[l - 1].insert(levels[l - 1].end(), C.begin(), C.end());
+                return true;
+
+            }
+
+        }
+
+    }
+
     /* helper methods for construction from relation lists via temporary tree */
 
     void buildFromListsViaTree(const std::vector<list_type>& lists) {// 3.3.3, so far without special bit vectors without initialisation
@@ -910,17 +1260,21 @@ private:
 
         } else {
 
-            std::vector<bool> T;
-            NaiveDynamicRank R;
+            DynamicVector<bool> T;
+            DynamicVector<elem_type> L;
+            DynamicRank R;
 
             for (size_type i = 0; i < lists.size(); i++) {
                 for (size_type j = 0; j < lists[i].size(); j++) {
-                    insertInit(T, R, i, lists[i][j].first, lists[i][j].second);
+                    insertInit(T, L, R, i, lists[i][j].first, lists[i][j].second);
                 }
             }
 
+            L_ = std::vector<elem_type>(L.size());
+            L.copyTo(L_.begin());
+
             T_ = bit_vector_type(T.size());
-            std::move(T.begin(), T.end(), T_.begin());
+            T.copyTo(T_.begin());
 
         }
 
@@ -948,19 +1302,23 @@ private:
 
         } else {
 
-            std::vector<bool> T;
-            NaiveDynamicRank R;
+            DynamicVector<bool> T;
+            DynamicVector<elem_type> L;
+            DynamicRank R;
 
             for (size_type i = x; (i < x + nr) && (i < lists.size()); i++) {
                 for (size_type j = 0; j < lists[i].size(); j++) {
                     if ((y <= lists[i][j].first) && (lists[i][j].first < (y + nc))) {
-                        insertInit(T, R, i - x, lists[i][j].first - y, lists[i][j].second);
+                        insertInit(T, L, R, i - x, lists[i][j].first - y, lists[i][j].second);
                     }
                 }
             }
 
+            L_ = std::vector<elem_type>(L.size());
+            L.copyTo(L_.begin());
+
             T_ = bit_vector_type(T.size());
-            std::move(T.begin(), T.end(), T_.begin());
+            T.copyTo(T_.begin());
 
         }
 
@@ -968,20 +1326,20 @@ private:
 
     }
 
-    void insertInit(std::vector<bool>& T, NaiveDynamicRank& R, size_type p, size_type q, elem_type val) {
+    void insertInit(DynamicVector<bool>& T, DynamicVector<elem_type>& L, DynamicRank& R, size_type p, size_type q, elem_type val) {
 
         if (T.empty()) {
 
-            T = std::vector<bool>(kr_ * kc_);
-            R = NaiveDynamicRank(T);
+            T = DynamicVector<bool>(kr_ * kc_, false);
+            R = DynamicRank(std::vector<bool>(kr_ * kc_));
 
         }
 
-        insert(T, R, numRows_ / kr_, numCols_ / kc_, p % (numRows_ / kr_), q % (numCols_ / kc_), val, (p / (numRows_ / kr_)) * kc_ + q / (numCols_ / kc_), 1);
+        insert(T, L, R, numRows_ / kr_, numCols_ / kc_, p % (numRows_ / kr_), q % (numCols_ / kc_), val, (p / (numRows_ / kr_)) * kc_ + q / (numCols_ / kc_), 1);
 
     }
 
-    void insert(std::vector<bool>& T, NaiveDynamicRank& R, size_type numRows, size_type numCols, size_type p, size_type q, elem_type val, size_type z, size_type l) {
+    void insert(DynamicVector<bool>& T, DynamicVector<elem_type>& L, DynamicRank& R, size_type numRows, size_type numCols, size_type p, size_type q, elem_type val, size_type z, size_type l) {
 
         if (!T[z]) {
 
@@ -992,15 +1350,15 @@ private:
 
             if ((l + 1) == h_) {
 
-                L_.insert(L_.begin() + R.rank(z + 1) * kr_ * kc_ - T.size(), kr_ * kc_, null_);
-                L_[y - T.size()] = 1;
+                L.insert(R.rank(z + 1) * kr_ * kc_ - T.size(), kr_ * kc_, null_);
+                L[y - T.size()] = val;
 
             } else {
 
-                T.insert(T.begin() + R.rank(z + 1) * kr_ * kc_, kr_ * kc_, 0);
+                T.insert(R.rank(z + 1) * kr_ * kc_, kr_ * kc_, 0);
                 R.insert(R.rank(z + 1) * kr_ * kc_ + 1, kr_ * kc_);
 
-                insert(T, R, numRows / kr_, numCols / kc_, p % (numRows / kr_), q % (numCols / kc_), val, y, l + 1);
+                insert(T, L, R, numRows / kr_, numCols / kc_, p % (numRows / kr_), q % (numCols / kc_), val, y, l + 1);
 
             }
 
@@ -1009,115 +1367,91 @@ private:
             size_type y = R.rank(z + 1) * kr_ * kc_ + (p / (numRows / kr_)) * kc_ + q / (numCols / kc_);
 
             if ((l + 1) == h_) {
-                L_[y - T.size()] = 1;
+                L[y - T.size()] = val;
             } else {
-                insert(T, R, numRows / kr_, numCols / kc_, p % (numRows / kr_), q % (numCols / kc_), val, y, l + 1);
+                insert(T, L, R, numRows / kr_, numCols / kc_, p % (numRows / kr_), q % (numCols / kc_), val, y, l + 1);
             }
 
         }
 
     }
 
-    /* helper methods for inplace construction from single list of pairs */
-
-    size_type computeKey(const typename pairs_type::value_type& pair, const Subproblem& sp, size_type widthRow, size_type widthCol) {
-        return ((pair.row - sp.firstRow) / widthRow) * kc_ + (pair.col - sp.firstCol) / widthCol;
-    }
-
-    void countingSort(pairs_type& pairs, std::vector<std::pair<size_type, size_type>>& intervals, const Subproblem& sp, size_type widthRow, size_type widthCol, size_type sup) {
-
-        std::vector<size_type> counts(sup);
-
-        // determine key frequencies
-        for (auto i = sp.left; i < sp.right; i++) {
-            counts[computeKey(pairs[i], sp, widthRow, widthCol)]++;
-        }
-
-        // determine starting index for each key
-        size_type total = 0;
-        size_type tmp;
+    /* helper method for construction from the radix-sorted keys of a single list of pairs */
 
-        for (auto key = 0; key < sup; key++) {
+    void buildFromSortedKeys(pairs_type& pairs, const size_type numThreads) {
 
-            tmp = counts[key];
-            counts[key] = total;
-            total += tmp;
+        std::vector<bool> T;
+        if (!buildLevelsFromSortedKeys(pairs, std::vector<size_type>(h_, kr_), std::vector<size_type>(h_, kc_), null_, T, L_, numThreads)) {
 
-            intervals[key].first = counts[key];
-            intervals[key].second = total;
+            buildFromListsInplace(pairs, 0, 0, numRows_, numCols_, 0, pairs.size(), numThreads); // the keys do not fit into 64 bits
+            return;
 
         }
 
-        // reorder pairs of current subproblem
-        pairs_type tmpPairs(sp.right - sp.left + 1);
-        for (auto i = sp.left; i < sp.right; i++) {
+        T_ = bit_vector_type(T.size());
+        std::move(T.begin(), T.end(), T_.begin());
 
-            tmpPairs[counts[computeKey(pairs[i], sp, widthRow, widthCol)]] = pairs[i];
-            counts[computeKey(pairs[i], sp, widthRow, widthCol)]++;
+    }
 
-        }
+    /* helper methods for inplace construction from single list of pairs */
 
-        for (auto i = sp.left; i < sp.right; i++) {
-            pairs[i] = tmpPairs[i - sp.left];
-        }
+    size_type computeKey(const typename pairs_type::value_type& pair, const Subproblem& sp, size_type widthRow, size_type widthCol) {
+        return ((pair.row - sp.firstRow) / widthRow) * kc_ + (pair.col - sp.firstCol) / widthCol;
+    }
 
+    void countingSort(pairs_type& pairs, LevelBuildState<pairs_type, elem_type>& state, const Subproblem& sp, size_type widthRow, size_type widthCol, size_type sup, size_type numThreads) {
+        countingSortByKey(pairs, sp.left, sp.right, sup, [&](const typename pairs_type::value_type& pair) { return computeKey(pair, sp, widthRow, widthCol); }, state.intervals, state.counts, state.tmpPairs, numThreads);
     }
 
-    void buildFromListsInplace(pairs_type& pairs) {// 3.3.5
+    void buildFromListsInplace(pairs_type& pairs, size_type x, size_type y, size_type nr, size_type nc, size_type l, size_type r, const size_type numThreads) {// 3.3.5 (level by level, the subproblems of each level are distributed among the threads)
 
-        std::queue<Subproblem> queue;
-        Subproblem sp;
-        size_type Sr, Sc;
-        std::vector<std::pair<size_type, size_type>> intervals(kr_ * kc_);
+        std::vector<Subproblem> level(1, Subproblem(x, x + nr - 1, y, y + nc - 1, l, r));
+        std::vector<LevelBuildState<pairs_type, elem_type>> states(std::max(numThreads, (size_type) 1));
         std::vector<bool> T;
-        std::vector<elem_type> appToL;
-
-        queue.push(Subproblem(0, numRows_ - 1, 0, numCols_ - 1, 0, pairs.size()));
-
-        while (!queue.empty()) {
-
-            sp = queue.front();
-            queue.pop();
+        size_type Sr = nr;
+        size_type Sc = nc;
 
-            Sr = sp.lastRow - sp.firstRow + 1;
-            Sc = sp.lastCol - sp.firstCol + 1;
+        auto process = [&](LevelBuildState<pairs_type, elem_type>& state, const Subproblem& sp, size_type sortThreads) {
 
             if (Sr > kr_) {
 
-                countingSort(pairs, intervals, sp, Sr / kr_, Sc / kc_, kr_ * kc_);
+                countingSort(pairs, state, sp, Sr / kr_, Sc / kc_, kr_ * kc_, sortThreads);
 
                 for (size_type i = 0; i < kr_ * kc_; i++) {
 
-                    if (intervals[i].first < intervals[i].second) {
+                    if (state.intervals[i].first < state.intervals[i].second) {
 
-                        T.push_back(true);
-                        queue.push(Subproblem(
+                        state.T.push_back(true);
+                        state.next.push_back(Subproblem(
                                 sp.firstRow + (i / kc_) * (Sr / kr_),
                                 sp.firstRow + (i / kc_ + 1) * (Sr / kr_) - 1,
                                 sp.firstCol + (i % kc_) * (Sc / kc_),
                                 sp.firstCol + (i % kc_ + 1) * (Sc / kc_) - 1,
-                                sp.left + intervals[i].first,
-                                sp.left + intervals[i].second
+                                sp.left + state.intervals[i].first,
+                                sp.left + state.intervals[i].second
                         ));
 
                     } else {
-                        T.push_back(false);
+                        state.T.push_back(false);
                     }
 
                 }
 
             } else {
 
-                appToL = std::vector<elem_type>(kr_ * kc_);
+                size_type offset = state.L.size();
+                state.L.resize(offset + kr_ * kc_, null_);
 
                 for (size_type i = sp.left; i < sp.right; i++) {
-                    appToL[(pairs[i].row - sp.firstRow) * kc_ + (pairs[i].col - sp.firstCol)] = pairs[i].val;
+                    state.L[offset + (pairs[i].row - sp.firstRow) * kc_ + (pairs[i].col - sp.firstCol)] = pairs[i].val;
                 }
 
-                L_.insert(L_.end(), appToL.begin(), appToL.end());
-
             }
 
+        };
+
+        for (; !level.empty(); Sr /= kr_, Sc /= kc_) {
+            processLevel(level, states, numThreads, T, L_, process);
         }
 
         T_ = bit_vector_type(T.size());
@@ -1125,107 +1459,213 @@ private:
 
     }
 
-    void buildFromListsInplace(pairs_type& pairs, size_type x, size_type y, size_type nr, size_type nc, size_type l, size_type r) {// 3.3.5
-
-        std::queue<Subproblem> queue;
-        Subproblem sp;
-        size_type Sr, Sc;
-        std::vector<std::pair<size_type, size_type>> intervals(kr_ * kc_);
-        std::vector<bool> T;
-        std::vector<elem_type> appToL;
-
-        queue.push(Subproblem(x, x + nr - 1, y, y + nc - 1, l, r));
-
-        while (!queue.empty()) {
-
-            sp = queue.front();
-            queue.pop();
-
-            Sr = sp.lastRow - sp.firstRow + 1;
-            Sc = sp.lastCol - sp.firstCol + 1;
 
-            if (Sr > kr_) {
 
-                countingSort(pairs, intervals, sp, Sr / kr_, Sc / kc_, kr_ * kc_);
+    /* helper methods for accessing the (optionally compressed) last level */
 
-                for (size_type i = 0; i < kr_ * kc_; i++) {
+    // returns the entry of the last level at position x
+    inline elem_type leaf(size_type x) const {
 
-                    if (intervals[i].first < intervals[i].second) {
+        K2TREES_COUNT(leafProbes);
+        return compressedL_.empty() ? L_[x] : compressedL_[x];
 
-                        T.push_back(true);
-                        queue.push(Subproblem(
-                                sp.firstRow + (i / kc_) * (Sr / kr_),
-                                sp.firstRow + (i / kc_ + 1) * (Sr / kr_) - 1,
-                                sp.firstCol + (i % kc_) * (Sc / kc_),
-                                sp.firstCol + (i % kc_ + 1) * (Sc / kc_) - 1,
-                                sp.left + intervals[i].first,
-                                sp.left + intervals[i].second
-                        ));
+    }
 
-                    } else {
-                        T.push_back(false);
-                    }
+    // returns the length of the last level
+    inline size_type numLeaves() const {
+        return compressedL_.empty() ? L_.size() : compressedL_.size();
+    }
 
-                }
+    /* isNotNull() */
 
-            } else {
+    bool checkInit(size_type p, size_type q) const {
 
-                appToL = std::vector<elem_type>(kr_ * kc_);
+        size_type x;
+        if (fixedArityLeafPosition(p, q, x)) {
+            return (x < numLeaves()) && (leaf(x) != null_);
+        }
 
-                for (size_type i = sp.left; i < sp.right; i++) {
-                    appToL[(pairs[i].row - sp.firstRow) * kc_ + (pairs[i].col - sp.firstCol)] = pairs[i].val;
-                }
+        return (numLeaves() == 0) ? false : check(numRows_ / kr_, numCols_ / kc_, p % (numRows_ / kr_), q % (numCols_ / kc_), (p / (numRows_ / kr_)) * kc_ + q / (numCols_ / kc_));
 
-                L_.insert(L_.end(), appToL.begin(), appToL.end());
+    }
 
-            }
+    bool check(size_type numRows, size_type numCols, size_type p, size_type q, size_type z) const {
 
+        if (z >= T_.size()) {
+            return (leaf(z - T_.size()) != null_);
+        } else {
+            return T_[z] ? check(numRows / kr_, numCols / kc_, p % (numRows / kr_), q % (numCols / kc_), R_.rank(z + 1) * kr_ * kc_ + (p / (numRows / kr_)) * kc_ + q / (numCols / kc_)) : false;
         }
 
-        T_ = bit_vector_type(T.size());
-        std::move(T.begin(), T.end(), T_.begin());
-
     }
 
+    /* getElement() */
 
+    elem_type getInit(size_type p, size_type q) const {
 
-    /* isNotNull() */
+        size_type x;
+        if (fixedArityLeafPosition(p, q, x)) {
+            return (x < numLeaves()) ? leaf(x) : null_;
+        }
+
+        return (numLeaves() == 0) ? null_ : get(numRows_ / kr_, numCols_ / kc_, p % (numRows_ / kr_), q % (numCols_ / kc_), (p / (numRows_ / kr_)) * kc_ + q / (numCols_ / kc_));
 
-    bool checkInit(size_type p, size_type q) {
-        return (L_.empty()) ? false : check(numRows_ / kr_, numCols_ / kc_, p % (numRows_ / kr_), q % (numCols_ / kc_), (p / (numRows_ / kr_)) * kc_ + q / (numCols_ / kc_));
     }
 
-    bool check(size_type numRows, size_type numCols, size_type p, size_type q, size_type z) {
+    elem_type get(size_type numRows, size_type numCols, size_type p, size_type q, size_type z) const {
 
         if (z >= T_.size()) {
-            return (L_[z - T_.size()] != null_);
+            return leaf(z - T_.size());
         } else {
-            return T_[z] ? check(numRows / kr_, numCols / kc_, p % (numRows / kr_), q % (numCols / kc_), R_.rank(z + 1) * kr_ * kc_ + (p / (numRows / kr_)) * kc_ + q / (numCols / kc_)) : false;
+            return T_[z] ? get(numRows / kr_, numCols / kc_, p % (numRows / kr_), q % (numCols / kc_), R_.rank(z + 1) * kr_ * kc_ + (p / (numRows / kr_)) * kc_ + q / (numCols / kc_)) : null_;
         }
 
     }
 
-    /* getElement() */
+    /* helper methods for point queries with compile-time arities */
+
+    // determines the position x in L of (p, q) (numLeaves() if (p, q) lies in an empty submatrix) via the variant
+    // for the compile-time arities kr_ and kc_ and returns true, returns false if one of them is none of the commonly used arities 2, 4 and 8
+    bool fixedArityLeafPosition(size_type p, size_type q, size_type& x) const {
+
+        switch (kr_) {
+            case 2:
+                return fixedArityLeafPosition<2>(p, q, x);
+            case 4:
+                return fixedArityLeafPosition<4>(p, q, x);
+            case 8:
+                return fixedArityLeafPosition<8>(p, q, x);
+            default:
+                return false;
+        }
 
-    elem_type getInit(size_type p, size_type q) {
-        return (L_.empty()) ? null_ : get(numRows_ / kr_, numCols_ / kc_, p % (numRows_ / kr_), q % (numCols_ / kc_), (p / (numRows_ / kr_)) * kc_ + q / (numCols_ / kc_));
     }
 
-    elem_type get(size_type numRows, size_type numCols, size_type p, size_type q, size_type z) {
+    template<size_type KR>
+    bool fixedArityLeafPosition(size_type p, size_type q, size_type& x) const {
+
+        switch (kc_) {
+            case 2:
+                x = leafPosition<KR, 2>(p, q);
+                return true;
+            case 4:
+                x = leafPosition<KR, 4>(p, q);
+                return true;
+            case 8:
+                x = leafPosition<KR, 8>(p, q);
+                return true;
+            default:
+                return false;
+        }
+
+    }
+
+    // iterative descent for compile-time arities KR and KC (powers of two):
+    // as the height / width of every submatrix is a power of KR / KC, all divisions / remainders become shifts / masks
+    template<size_type KR, size_type KC>
+    size_type leafPosition(size_type p, size_type q) const {
+
+        size_type rs = logTwo(KR) * (h_ - 1);
+        size_type cs = logTwo(KC) * (h_ - 1);
+        size_type z = (p >> rs) * KC + (q >> cs);
+
+        while (z < T_.size()) {
+
+            if (!T_[z]) {
+                return numLeaves();
+            }
+
+            rs -= logTwo(KR);
+            cs -= logTwo(KC);
+            z = R_.rank(z + 1) * KR * KC + ((p >> rs) & (KR - 1)) * KC + ((q >> cs) & (KC - 1));
+
+        }
+
+        return z - T_.size();
+
+    }
+
+    /* helper methods for batch queries (isNotNull() / getElement() on several positions) */
+
+    // calls report(x, pos) for every query x whose position is represented in L_ (at pos),
+    // every submatrix shared by several queries is descended into only once
+    template<typename F>
+    void batchInit(const positions_type& queries, F report) const {
+
+        if (numLeaves() == 0 || queries.empty()) return;
+
+        std::vector<size_type> order(queries.size());
+        std::vector<size_type> buffer(queries.size());
+        std::vector<std::vector<size_type>> ends(h_); // ends of the child groups, one array per level
+
+        for (size_type x = 0; x < queries.size(); x++) {
+            order[x] = x;
+        }
+
+        batch(queries, order, buffer, ends, report, 0, queries.size(), numRows_, numCols_, 0, 0, 0, 0);
+
+    }
+
+    template<typename F>
+    void batch(const positions_type& queries, std::vector<size_type>& order, std::vector<size_type>& buffer, std::vector<std::vector<size_type>>& ends, F& report, size_type first, size_type last, size_type numRows, size_type numCols, size_type p, size_type q, size_type z, size_type l) const {
+
+        size_type mr = numRows / kr_;
+        size_type mc = numCols / kc_;
+        size_type numChildren = kr_ * kc_;
+
+        auto& e = ends[l];
+        e.assign(numChildren, 0);
+
+        // group the queries order[first..last) by the child containing them (stable counting sort)
+        for (size_type x = first; x < last; x++) {
+            e[((queries[order[x]].first - p) / mr) * kc_ + (queries[order[x]].second - q) / mc]++;
+        }
+
+        size_type sum = first;
+        for (size_type c = 0; c < numChildren; c++) {
+            size_type tmp = e[c];
+            e[c] = sum;
+            sum += tmp;
+        }
+
+        for (size_type x = first; x < last; x++) {
+            buffer[e[((queries[order[x]].first - p) / mr) * kc_ + (queries[order[x]].second - q) / mc]++] = order[x];
+        }
+
+        std::copy(buffer.begin() + first, buffer.begin() + last, order.begin() + first);
+
+        // afterwards, the queries of child c are order[(c == 0 ? first : e[c - 1])..e[c])
+        size_type start = first;
+        for (size_type c = 0; c < numChildren; c++) {
+
+            size_type end = e[c];
+
+            if (start < end) {
+
+                size_type y = z + c;
+
+                if (y >= T_.size()) {
+                    for (size_type x = start; x < end; x++) {
+                        report(order[x], y - T_.size());
+                    }
+                } else if (T_[y]) {
+                    batch(queries, order, buffer, ends, report, start, end, mr, mc, p + (c / kc_) * mr, q + (c % kc_) * mc, R_.rank(y + 1) * kr_ * kc_, l + 1);
+                }
+
+            }
+
+            start = end;
 
-        if (z >= T_.size()) {
-            return L_[z - T_.size()];
-        } else {
-            return T_[z] ? get(numRows / kr_, numCols / kc_, p % (numRows / kr_), q % (numCols / kc_), R_.rank(z + 1) * kr_ * kc_ + (p / (numRows / kr_)) * kc_ + q / (numCols / kc_)) : null_;
         }
 
     }
 
+
     /* getSuccessorElements() */
 
-    void allSuccessorElementsIterative(std::vector<elem_type>& succs, size_type p) {
+    void allSuccessorElementsIterative(std::vector<elem_type>& succs, size_type p) const {
 
-        if (L_.empty()) return;
+        if (numLeaves() == 0) return;
 
         std::queue<SubrowInfo> queue, nextLevelQueue;
         size_type lenT = T_.size();
@@ -1234,8 +1674,8 @@ private:
 
             size_type offset = p * numCols_;
             for (size_type i = 0; i < numCols_; i++) {
-                if (L_[offset + i] != null_) {
-                    succs.push_back(L_[offset + i]);
+                if (leaf(offset + i) != null_) {
+                    succs.push_back(leaf(offset + i));
                 }
             }
 
@@ -1246,6 +1686,7 @@ private:
             size_type nc = numCols_/ kc_;
             size_type relP = p;
             for (size_type j = 0, dq = 0, z = kc_ * (relP / nr); j < kc_; j++, dq += nc, z++) {
+                K2TREES_COUNT(queuePushes);
                 queue.push(SubrowInfo(dq, z));
             }
 
@@ -1259,11 +1700,12 @@ private:
 
                     auto& cur = queue.front();
 
-                    if (T_[cur.z]) {
+                    if (hasChildren(cur.z)) {
 
                         auto y = R_.rank(cur.z + 1) * kr_ * kc_ + kc_ * (relP / nr);
 
                         for (size_type j = 0, newDq = cur.dq; j < kc_; j++, newDq += nc, y++) {
+                            K2TREES_COUNT(queuePushes);
                             nextLevelQueue.push(SubrowInfo(newDq, y));
                         }
 
@@ -1282,13 +1724,13 @@ private:
 
                 auto& cur = queue.front();
 
-                if (T_[cur.z]) {
+                if (hasChildren(cur.z)) {
 
                     auto y = R_.rank(cur.z + 1) * kr_ * kc_ + kc_ * (relP / nr) - lenT;
 
                     for (size_type j = 0, newDq = cur.dq; j < kc_; j++, newDq += nc, y++) {
-                        if (L_[y] != null_) {
-                            succs.push_back(L_[y]);
+                        if (leaf(y) != null_) {
+                            succs.push_back(leaf(y));
                         }
                     }
 
@@ -1302,9 +1744,9 @@ private:
 
     }
 
-    void successorsElemInit(std::vector<elem_type>& succs, size_type p) {
+    void successorsElemInit(std::vector<elem_type>& succs, size_type p) const {
 
-        if (!L_.empty()) {
+        if (numLeaves() != 0) {
 
             size_type y = kc_ * (p / (numRows_ / kr_));
 
@@ -1316,17 +1758,17 @@ private:
 
     }
 
-    void successorsElem(std::vector<elem_type>& succs, size_type numRows, size_type numCols, size_type p, size_type q, size_type z) {
+    void successorsElem(std::vector<elem_type>& succs, size_type numRows, size_type numCols, size_type p, size_type q, size_type z) const {
 
         if (z >= T_.size()) {
 
-            if (L_[z - T_.size()] != null_) {
-                succs.push_back(L_[z - T_.size()]);
+            if (leaf(z - T_.size()) != null_) {
+                succs.push_back(leaf(z - T_.size()));
             }
 
         } else {
 
-            if (T_[z]) {
+            if (hasChildren(z)) {
 
                 size_type y = R_.rank(z + 1) * kr_ * kc_ + kc_ * (p / (numRows / kr_));
 
@@ -1343,9 +1785,9 @@ private:
 
     /* getSuccessorPositions() */
 
-    void allSuccessorPositionsIterative(std::vector<size_type>& succs, size_type p) {
+    void allSuccessorPositionsIterative(std::vector<size_type>& succs, size_type p) const {
 
-        if (L_.empty()) return;
+        if (numLeaves() == 0) return;
 
         std::queue<SubrowInfo> queue, nextLevelQueue;
         size_type lenT = T_.size();
@@ -1354,7 +1796,7 @@ private:
 
             size_type offset = p * numCols_;
             for (size_type i = 0; i < numCols_; i++) {
-                if (L_[offset + i] != null_) {
+                if (leaf(offset + i) != null_) {
                     succs.push_back(i);
                 }
             }
@@ -1366,6 +1808,7 @@ private:
             size_type nc = numCols_/ kc_;
             size_type relP = p;
             for (size_type j = 0, dq = 0, z = kc_ * (relP / nr); j < kc_; j++, dq += nc, z++) {
+                K2TREES_COUNT(queuePushes);
                 queue.push(SubrowInfo(dq, z));
             }
 
@@ -1379,11 +1822,12 @@ private:
 
                     auto& cur = queue.front();
 
-                    if (T_[cur.z]) {
+                    if (hasChildren(cur.z)) {
 
                         auto y = R_.rank(cur.z + 1) * kr_ * kc_ + kc_ * (relP / nr);
 
                         for (size_type j = 0, newDq = cur.dq; j < kc_; j++, newDq += nc, y++) {
+                            K2TREES_COUNT(queuePushes);
                             nextLevelQueue.push(SubrowInfo(newDq, y));
                         }
 
@@ -1402,12 +1846,12 @@ private:
 
                 auto& cur = queue.front();
 
-                if (T_[cur.z]) {
+                if (hasChildren(cur.z)) {
 
                     auto y = R_.rank(cur.z + 1) * kr_ * kc_ + kc_ * (relP / nr) - lenT;
 
                     for (size_type j = 0, newDq = cur.dq; j < kc_; j++, newDq += nc, y++) {
-                        if (L_[y] != null_) {
+                        if (leaf(y) != null_) {
                             succs.push_back(newDq);
                         }
                     }
@@ -1422,9 +1866,9 @@ private:
 
     }
 
-    void successorsPosInit(std::vector<size_type>& succs, size_type p) {
+    void successorsPosInit(std::vector<size_type>& succs, size_type p) const {
 
-        if (!L_.empty()) {
+        if (numLeaves() != 0) {
 
             size_type y = kc_ * (p / (numRows_ / kr_));
 
@@ -1436,17 +1880,17 @@ private:
 
     }
 
-    void successorsPos(std::vector<size_type>& succs, size_type numRows, size_type numCols, size_type p, size_type q, size_type z) {
+    void successorsPos(std::vector<size_type>& succs, size_type numRows, size_type numCols, size_type p, size_type q, size_type z) const {
 
         if (z >= T_.size()) {
 
-            if (L_[z - T_.size()] != null_) {
+            if (leaf(z - T_.size()) != null_) {
                 succs.push_back(q);
             }
 
         } else {
 
-            if (T_[z]) {
+            if (hasChildren(z)) {
 
                 size_type y = R_.rank(z + 1) * kr_ * kc_ + kc_ * (p / (numRows / kr_));
 
@@ -1463,9 +1907,9 @@ private:
 
     /* getSuccessorValuedPositions() */
 
-    void allSuccessorValuedPositionsIterative(pairs_type& succs, size_type p) {
+    void allSuccessorValuedPositionsIterative(pairs_type& succs, size_type p) const {
 
-        if (L_.empty()) return;
+        if (numLeaves() == 0) return;
 
         std::queue<SubrowInfo> queue, nextLevelQueue;
         size_type lenT = T_.size();
@@ -1474,8 +1918,8 @@ private:
 
             size_type offset = p * numCols_;
             for (size_type i = 0; i < numCols_; i++) {
-                if (L_[offset + i] != null_) {
-                    succs.push_back(ValuedPosition<elem_type>(p, i, L_[offset + i]));
+                if (leaf(offset + i) != null_) {
+                    succs.push_back(ValuedPosition<elem_type>(p, i, leaf(offset + i)));
                 }
             }
 
@@ -1486,6 +1930,7 @@ private:
             size_type nc = numCols_/ kc_;
             size_type relP = p;
             for (size_type j = 0, dq = 0, z = kc_ * (relP / nr); j < kc_; j++, dq += nc, z++) {
+                K2TREES_COUNT(queuePushes);
                 queue.push(SubrowInfo(dq, z));
             }
 
@@ -1499,11 +1944,12 @@ private:
 
                     auto& cur = queue.front();
 
-                    if (T_[cur.z]) {
+                    if (hasChildren(cur.z)) {
 
                         auto y = R_.rank(cur.z + 1) * kr_ * kc_ + kc_ * (relP / nr);
 
                         for (size_type j = 0, newDq = cur.dq; j < kc_; j++, newDq += nc, y++) {
+                            K2TREES_COUNT(queuePushes);
                             nextLevelQueue.push(SubrowInfo(newDq, y));
                         }
 
@@ -1522,13 +1968,13 @@ private:
 
                 auto& cur = queue.front();
 
-                if (T_[cur.z]) {
+                if (hasChildren(cur.z)) {
 
                     auto y = R_.rank(cur.z + 1) * kr_ * kc_ + kc_ * (relP / nr) - lenT;
 
                     for (size_type j = 0, newDq = cur.dq; j < kc_; j++, newDq += nc, y++) {
-                        if (L_[y] != null_) {
-                            succs.push_back(ValuedPosition<elem_type>(p, newDq, L_[y]));
+                        if (leaf(y) != null_) {
+                            succs.push_back(ValuedPosition<elem_type>(p, newDq, leaf(y)));
                         }
                     }
 
@@ -1542,9 +1988,9 @@ private:
 
     }
 
-    void successorsValPosInit(pairs_type& succs, size_type p) {
+    void successorsValPosInit(pairs_type& succs, size_type p) const {
 
-        if (!L_.empty()) {
+        if (numLeaves() != 0) {
 
             size_type y = kc_ * (p / (numRows_ / kr_));
 
@@ -1560,17 +2006,17 @@ private:
 
     }
 
-    void successorsValPos(pairs_type& succs, size_type numRows, size_type numCols, size_type p, size_type q, size_type z) {
+    void successorsValPos(pairs_type& succs, size_type numRows, size_type numCols, size_type p, size_type q, size_type z) const {
 
         if (z >= T_.size()) {
 
-            if (L_[z - T_.size()] != null_) {
-                succs.push_back(ValuedPosition<elem_type>(0, q, L_[z - T_.size()]));
+            if (leaf(z - T_.size()) != null_) {
+                succs.push_back(ValuedPosition<elem_type>(0, q, leaf(z - T_.size())));
             }
 
         } else {
 
-            if (T_[z]) {
+            if (hasChildren(z)) {
 
                 size_type y = R_.rank(z + 1) * kr_ * kc_ + kc_ * (p / (numRows / kr_));
 
@@ -1585,17 +2031,58 @@ private:
 
     }
 
+    /* expandFrontier() */
+
+    // expands the rows [first, last) of the frontier within the submatrix of size numRows x numCols whose upper left corner is (p,q)
+    // and whose children start at position y, the subtrees shared by several rows are only traversed once
+    void frontierPos(std::vector<size_type>& cols, std::vector<bool>& visited, size_type numRows, size_type numCols, size_type p, size_type q,
+                     std::vector<size_type>::const_iterator first, std::vector<size_type>::const_iterator last, size_type y) const {
+
+        for (size_type i = 0; (i < kr_) && (first != last); i++) {
+
+            // rows of the frontier that lie in the i-th row of children
+            auto next = first;
+            while ((next != last) && (*next < p + (i + 1) * (numRows / kr_))) {
+                next++;
+            }
+
+            if (first != next) {
+
+                for (size_type j = 0; j < kc_; j++) {
+
+                    size_type z = y + i * kc_ + j;
+
+                    if (z >= T_.size()) {
+
+                        if (leaf(z - T_.size()) != null_) {
+                            this->addToFrontier(q + j, cols, visited);
+                        }
+
+                    } else if (hasChildren(z)) {
+                        frontierPos(cols, visited, numRows / kr_, numCols / kc_, p + i * (numRows / kr_), q + j * (numCols / kc_), first, next, R_.rank(z + 1) * kr_ * kc_);
+                    }
+
+                }
+
+            }
+
+            first = next;
+
+        }
+
+    }
+
     /* getFirstSuccessor() */
 
-    size_type firstSuccessorPositionIterative(size_type p) {
+    size_type firstSuccessorPositionIterative(size_type p) const {
 
-        if (L_.empty()) return numCols_;
+        if (numLeaves() == 0) return numCols_;
 
         if (T_.size() == 0) {
 
             size_type offset = p * numCols_;
             for (size_type i = 0; i < numCols_; i++) {
-                if (L_[offset + i] != null_) {
+                if (leaf(offset + i) != null_) {
                     return i;
                 }
             }
@@ -1603,6 +2090,7 @@ private:
         } else {
 
             std::stack<ExtendedSubrowInfo> stack;
+            K2TREES_COUNT(queuePushes);
             stack.emplace(numRows_ / kr_, numCols_ / kc_, p % (numRows_ / kr_), 0, kc_ * (p / (numRows_ / kr_)), 0);
 
             while (!stack.empty()) {
@@ -1615,13 +2103,14 @@ private:
 
                     if (cur.z >= T_.size()) {
 
-                        if (L_[cur.z - T_.size()] != null_) {
+                        if (leaf(cur.z - T_.size()) != null_) {
                             return cur.dq;
                         }
 
                     } else {
 
-                        if (T_[cur.z]) {
+                        if (hasChildren(cur.z)) {
+                            K2TREES_COUNT(queuePushes);
                             stack.emplace(cur.nr / kr_, cur.nc / kc_, cur.p % (cur.nr / kr_), cur.dq, R_.rank(cur.z + 1) * kr_ * kc_ + kc_ * (cur.p / (cur.nr / kr_)), 0);
                         }
 
@@ -1640,11 +2129,11 @@ private:
 
     }
 
-    size_type firstSuccessorInit(size_type p) {
+    size_type firstSuccessorInit(size_type p) const {
 
         size_type pos = numCols_;
 
-        if (!L_.empty()) {
+        if (numLeaves() != 0) {
 
             size_type y = kc_ * (p / (numRows_ / kr_));
 
@@ -1658,19 +2147,19 @@ private:
 
     }
 
-    size_type firstSuccessor(size_type numRows, size_type numCols, size_type p, size_type q, size_type z) {
+    size_type firstSuccessor(size_type numRows, size_type numCols, size_type p, size_type q, size_type z) const {
 
         size_type pos = numCols_;
 
         if (z >= T_.size()) {
 
-            if (L_[z - T_.size()] != null_) {
+            if (leaf(z - T_.size()) != null_) {
                 pos = q;
             }
 
         } else {
 
-            if (T_[z]) {
+            if (hasChildren(z)) {
 
                 size_type y = R_.rank(z + 1) * kr_ * kc_ + kc_ * (p / (numRows / kr_));
 
@@ -1688,9 +2177,9 @@ private:
 
     /* getPredecessorElements() */
 
-    void predecessorsElemInit(std::vector<elem_type>& preds, size_type q) {
+    void predecessorsElemInit(std::vector<elem_type>& preds, size_type q) const {
 
-        if (!L_.empty()) {
+        if (numLeaves() != 0) {
 
             size_type y = q / (numCols_ / kc_);
 
@@ -1702,17 +2191,17 @@ private:
 
     }
 
-    void predecessorsElem(std::vector<elem_type>& preds, size_type numRows, size_type numCols, size_type q, size_type p, size_type z) {
+    void predecessorsElem(std::vector<elem_type>& preds, size_type numRows, size_type numCols, size_type q, size_type p, size_type z) const {
 
         if (z >= T_.size()) {
 
-            if (L_[z - T_.size()] != null_) {
-                preds.push_back(L_[z - T_.size()]);
+            if (leaf(z - T_.size()) != null_) {
+                preds.push_back(leaf(z - T_.size()));
             }
 
         } else {
 
-            if (T_[z]) {
+            if (hasChildren(z)) {
 
                 size_type y = R_.rank(z + 1) * kr_ * kc_ + q / (numCols / kc_);
 
@@ -1728,9 +2217,9 @@ private:
 
     /* getPredecessorPositions() */
 
-    void predecessorsPosInit(std::vector<size_type>& preds, size_type q) {
+    void predecessorsPosInit(std::vector<size_type>& preds, size_type q) const {
 
-        if (!L_.empty()) {
+        if (numLeaves() != 0) {
 
             size_type y = q / (numCols_ / kc_);
 
@@ -1742,17 +2231,17 @@ private:
 
     }
 
-    void predecessorsPos(std::vector<size_type>& preds, size_type numRows, size_type numCols, size_type q, size_type p, size_type z) {
+    void predecessorsPos(std::vector<size_type>& preds, size_type numRows, size_type numCols, size_type q, size_type p, size_type z) const {
 
         if (z >= T_.size()) {
 
-            if (L_[z - T_.size()] != null_) {
+            if (leaf(z - T_.size()) != null_) {
                 preds.push_back(p);
             }
 
         } else {
 
-            if (T_[z]) {
+            if (hasChildren(z)) {
 
                 size_type y = R_.rank(z + 1) * kr_ * kc_ + q / (numCols / kc_);
 
@@ -1768,9 +2257,9 @@ private:
 
     /* getPredecessorValuedPositions() */
 
-    void predecessorsValPosInit(pairs_type& preds, size_type q) {
+    void predecessorsValPosInit(pairs_type& preds, size_type q) const {
 
-        if (!L_.empty()) {
+        if (numLeaves() != 0) {
 
             size_type y = q / (numCols_ / kc_);
 
@@ -1786,17 +2275,17 @@ private:
 
     }
 
-    void predecessorsValPos(pairs_type& preds, size_type numRows, size_type numCols, size_type q, size_type p, size_type z) {
+    void predecessorsValPos(pairs_type& preds, size_type numRows, size_type numCols, size_type q, size_type p, size_type z) const {
 
         if (z >= T_.size()) {
 
-            if (L_[z - T_.size()] != null_) {
-                preds.push_back(ValuedPosition<elem_type>(p, 0, L_[z - T_.size()]));
+            if (leaf(z - T_.size()) != null_) {
+                preds.push_back(ValuedPosition<elem_type>(p, 0, leaf(z - T_.size())));
             }
 
         } else {
 
-            if (T_[z]) {
+            if (hasChildren(z)) {
 
                 size_type y = R_.rank(z + 1) * kr_ * kc_ + q / (numCols / kc_);
 
@@ -1812,9 +2301,9 @@ private:
 
     /* getElementsInRange() */
 
-    void rangeElemInit(std::vector<elem_type>& elements, size_type p1, size_type p2, size_type q1, size_type q2) {
+    void rangeElemInit(std::vector<elem_type>& elements, size_type p1, size_type p2, size_type q1, size_type q2) const {
 
-        if (!L_.empty()) {
+        if (numLeaves() != 0) {
 
             size_type p1Prime, p2Prime;
 
@@ -1844,17 +2333,17 @@ private:
 
     }
 
-    void rangeElem(std::vector<elem_type>& elements, size_type numRows, size_type numCols, size_type p1, size_type p2, size_type q1, size_type q2, size_type dp, size_type dq, size_type z) {
+    void rangeElem(std::vector<elem_type>& elements, size_type numRows, size_type numCols, size_type p1, size_type p2, size_type q1, size_type q2, size_type dp, size_type dq, size_type z) const {
 
         if (z >= T_.size()) {
 
-            if (L_[z - T_.size()] != null_) {
-                elements.push_back(L_[z - T_.size()]);
+            if (leaf(z - T_.size()) != null_) {
+                elements.push_back(leaf(z - T_.size()));
             }
 
         } else {
 
-            if (T_[z]) {
+            if (hasChildren(z)) {
 
                 auto y = R_.rank(z + 1) * kr_ * kc_;
                 size_type p1Prime, p2Prime;
@@ -1889,9 +2378,9 @@ private:
 
     /* getPositionsInRange() */
 
-    void rangePosInit(positions_type& pairs, size_type p1, size_type p2, size_type q1, size_type q2) {
+    void rangePosInit(positions_type& pairs, size_type p1, size_type p2, size_type q1, size_type q2) const {
 
-        if (!L_.empty()) {
+        if (numLeaves() != 0) {
 
             size_type p1Prime, p2Prime;
 
@@ -1921,17 +2410,17 @@ private:
 
     }
 
-    void rangePos(positions_type& pairs, size_type numRows, size_type numCols, size_type p1, size_type p2, size_type q1, size_type q2, size_type dp, size_type dq, size_type z) {
+    void rangePos(positions_type& pairs, size_type numRows, size_type numCols, size_type p1, size_type p2, size_type q1, size_type q2, size_type dp, size_type dq, size_type z) const {
 
         if (z >= T_.size()) {
 
-            if (L_[z - T_.size()] != null_) {
+            if (leaf(z - T_.size()) != null_) {
                 pairs.push_back(std::make_pair(dp, dq));
             }
 
         } else {
 
-            if (T_[z]) {
+            if (hasChildren(z)) {
 
                 auto y = R_.rank(z + 1) * kr_ * kc_;
                 size_type p1Prime, p2Prime;
@@ -1966,9 +2455,9 @@ private:
 
     /* getValuedPositionsInRange() */
 
-    void rangeValPosInit(pairs_type& pairs, size_type p1, size_type p2, size_type q1, size_type q2) {
+    void rangeValPosInit(pairs_type& pairs, size_type p1, size_type p2, size_type q1, size_type q2) const {
 
-        if (!L_.empty()) {
+        if (numLeaves() != 0) {
 
             size_type p1Prime, p2Prime;
 
@@ -1998,17 +2487,17 @@ private:
 
     }
 
-    void rangeValPos(pairs_type& pairs, size_type numRows, size_type numCols, size_type p1, size_type p2, size_type q1, size_type q2, size_type dp, size_type dq, size_type z) {
+    void rangeValPos(pairs_type& pairs, size_type numRows, size_type numCols, size_type p1, size_type p2, size_type q1, size_type q2, size_type dp, size_type dq, size_type z) const {
 
         if (z >= T_.size()) {
 
-            if (L_[z - T_.size()] != null_) {
-                pairs.push_back(ValuedPosition<elem_type>(dp, dq, L_[z - T_.size()]));
+            if (leaf(z - T_.size()) != null_) {
+                pairs.push_back(ValuedPosition<elem_type>(dp, dq, leaf(z - T_.size())));
             }
 
         } else {
 
-            if (T_[z]) {
+            if (hasChildren(z)) {
 
                 auto y = R_.rank(z + 1) * kr_ * kc_;
                 size_type p1Prime, p2Prime;
@@ -2041,18 +2530,182 @@ private:
 
     }
 
-    /* containsElement() */
+    /* forEachSuccessorPosition() */
+
+    bool successorsVisitInit(const std::function<bool(size_type)>& visitor, size_type p) const {
+
+        if (numLeaves() != 0) {
+
+            size_type y = kc_ * (p / (numRows_ / kr_));
+
+            for (size_type j = 0; j < kc_; j++) {
+                if (!successorsVisit(visitor, numRows_ / kr_, numCols_ / kc_, p % (numRows_ / kr_), (numCols_ / kc_) * j, y + j)) return false;
+            }
+
+        }
+
+        return true;
+
+    }
+
+    bool successorsVisit(const std::function<bool(size_type)>& visitor, size_type numRows, size_type numCols, size_type p, size_type q, size_type z) const {
+
+        if (z >= T_.size()) {
+
+            if (leaf(z - T_.size()) != null_) {
+                if (!visitor(q)) return false;
+            }
+
+        } else {
+
+            if (hasChildren(z)) {
+
+                size_type y = R_.rank(z + 1) * kr_ * kc_ + kc_ * (p / (numRows / kr_));
+
+                for (size_type j = 0; j < kc_; j++) {
+                    if (!successorsVisit(visitor, numRows / kr_, numCols / kc_, p % (numRows / kr_), q + (numCols / kc_) * j, y + j)) return false;
+                }
+
+            }
+
+        }
+
+        return true;
+
+    }
+
+    /* forEachPredecessorPosition() */
+
+    bool predecessorsVisitInit(const std::function<bool(size_type)>& visitor, size_type q) const {
+
+        if (numLeaves() != 0) {
+
+            size_type y = q / (numCols_ / kc_);
+
+            for (size_type i = 0; i < kr_; i++) {
+                if (!predecessorsVisit(visitor, numRows_ / kr_, numCols_ / kc_, q % (numCols_ / kc_), (numRows_ / kr_) * i, y + i * kc_)) return false;
+            }
+
+        }
+
+        return true;
+
+    }
+
+    bool predecessorsVisit(const std::function<bool(size_type)>& visitor, size_type numRows, size_type numCols, size_type q, size_type p, size_type z) const {
+
+        if (z >= T_.size()) {
 
-    bool elemInRangeInit(size_type p1, size_type p2, size_type q1, size_type q2) {
+            if (leaf(z - T_.size()) != null_) {
+                if (!visitor(p)) return false;
+            }
+
+        } else {
+
+            if (hasChildren(z)) {
+
+                size_type y = R_.rank(z + 1) * kr_ * kc_ + q / (numCols / kc_);
+
+                for (size_type i = 0; i < kr_; i++) {
+                    if (!predecessorsVisit(visitor, numRows / kr_, numCols / kc_,  q % (numCols / kc_), p + (numRows / kr_) * i, y + i * kc_)) return false;
+                }
+
+            }
+
+        }
+
+        return true;
+
+    }
+
+    /* forEachValuedPositionInRange() */
+
+    bool rangeValVisitInit(const std::function<bool(size_type, size_type, elem_type)>& visitor, size_type p1, size_type p2, size_type q1, size_type q2) const {
+
+        if (numLeaves() != 0) {
+
+            size_type p1Prime, p2Prime;
+
+            for (auto i = p1 / (numRows_ / kr_); i <= p2 / (numRows_ / kr_); i++) {
+
+                p1Prime = (i == p1 / (numRows_ / kr_)) * (p1 % (numRows_ / kr_));
+                p2Prime = (i == p2 / (numRows_ / kr_)) ? p2 % (numRows_ / kr_) : (numRows_ / kr_) - 1;
+
+                for (auto j = q1 / (numCols_ / kc_); j <= q2 / (numCols_ / kc_); j++) {
+                    if (!rangeValVisit(
+                            visitor,
+                            numRows_ / kr_,
+                            numCols_ / kc_,
+                            p1Prime,
+                            p2Prime,
+                            (j == q1 / (numCols_ / kc_)) * (q1 % (numCols_ / kc_)),
+                            (j == q2 / (numCols_ / kc_)) ? q2 % (numCols_ / kc_) : (numCols_ / kc_) - 1,
+                            (numRows_ / kr_) * i,
+                            (numCols_ / kc_) * j,
+                            kc_ * i + j
+                    )) return false;
+                }
+
+            }
+
+        }
+
+        return true;
+
+    }
+
+    bool rangeValVisit(const std::function<bool(size_type, size_type, elem_type)>& visitor, size_type numRows, size_type numCols, size_type p1, size_type p2, size_type q1, size_type q2, size_type dp, size_type dq, size_type z) const {
+
+        if (z >= T_.size()) {
+
+            if (leaf(z - T_.size()) != null_) {
+                if (!visitor(dp, dq, leaf(z - T_.size()))) return false;
+            }
+
+        } else {
+
+            if (hasChildren(z)) {
+
+                auto y = R_.rank(z + 1) * kr_ * kc_;
+                size_type p1Prime, p2Prime;
+
+                for (auto i = p1 / (numRows / kr_); i <= p2 / (numRows / kr_); i++) {
+
+                    p1Prime = (i == p1 / (numRows / kr_)) * (p1 % (numRows / kr_));
+                    p2Prime = (i == p2 / (numRows / kr_)) ? p2 % (numRows / kr_) : numRows / kr_ - 1;
+
+                    for (auto j = q1 / (numCols / kc_); j <= q2 / (numCols / kc_); j++) {
+                        if (!rangeValVisit(
+                                visitor,
+                                numRows / kr_,
+                                numCols / kc_,
+                                p1Prime,
+                                p2Prime,
+                                (j == q1 / (numCols / kc_)) * (q1 % (numCols / kc_)),
+                                (j == q2 / (numCols / kc_)) ? q2 % (numCols / kc_) : numCols / kc_ - 1,
+                                dp + (numRows / kr_) * i,
+                                dq + (numCols / kc_) * j,
+                                y + kc_ * i + j
+                        )) return false;
+                    }
 
-        if (!L_.empty()) {
+                }
 
-            // dividing by k_ (as stated in the paper) in not correct,
-            // because it does not use the size of the currently considered submatrix but of its submatrices
-            if ((p1 == 0) && (q1 == 0) && (p2 == (numRows_ /*/ kr_*/ - 1)) && (q2 == (numCols_ /*/ kc_*/ - 1))) {
-                return 1;
             }
 
+        }
+
+        return true;
+
+    }
+
+
+    /* containsElement() */
+
+    bool elemInRangeInit(size_type p1, size_type p2, size_type q1, size_type q2) const {
+
+        if (numLeaves() != 0) {
+
             size_type p1Prime, p2Prime;
 
             for (auto i = p1 / (numRows_ / kr_); i <= p2 / (numRows_ / kr_); i++) {
@@ -2076,15 +2729,15 @@ private:
 
     }
 
-    bool elemInRange(size_type numRows, size_type numCols, size_type p1, size_type p2, size_type q1, size_type q2, size_type z) {
+    bool elemInRange(size_type numRows, size_type numCols, size_type p1, size_type p2, size_type q1, size_type q2, size_type z) const {
 
         if (z >= T_.size()) {
 
-            return L_[z - T_.size()];
+            return (leaf(z - T_.size()) != null_);
 
         } else {
 
-            if (T_[z]) {
+            if (hasChildren(z)) {
 
                 // dividing by k_ (as stated in the paper) in not correct,
                 // because it does not use the size of the currently considered submatrix but of its submatrices
@@ -2119,37 +2772,315 @@ private:
     }
 
 
-    /* setNull() */
+    /* countElementsInRange() */
 
-    void setInit(size_type p, size_type q) {
+    size_type countRangeInit(size_type p1, size_type p2, size_type q1, size_type q2) const {
+
+        size_type cnt = 0;
+
+        if (numLeaves() != 0) {
+
+            size_type p1Prime, p2Prime;
+
+            for (size_type i = p1 / (numRows_ / kr_); i <= p2 / (numRows_ / kr_); i++) {
+
+                p1Prime = (i == p1 / (numRows_ / kr_)) * (p1 % (numRows_ / kr_));
+                p2Prime = (i == p2 / (numRows_ / kr_)) ? p2 % (numRows_ / kr_) : (numRows_ / kr_) - 1;
+
+                for (size_type j = q1 / (numCols_ / kc_); j <= q2 / (numCols_ / kc_); j++) {
+                    cnt += countRange(
+                            numRows_ / kr_,
+                            numCols_ / kc_,
+                            p1Prime,
+                            p2Prime,
+                            (j == q1 / (numCols_ / kc_)) * (q1 % (numCols_ / kc_)),
+                            (j == q2 / (numCols_ / kc_)) ? q2 % (numCols_ / kc_) : (numCols_ / kc_) - 1,
+                            kc_ * i + j
+                    );
+                }
+
+            }
 
-        if (!L_.empty()) {
-            set(numRows_ / kr_, numCols_ / kc_, p % (numRows_ / kr_), q % (numCols_ / kc_), (p / (numRows_ / kr_)) * kc_ + q / (numCols_ / kc_));
         }
 
+        return cnt;
+
     }
 
-    void set(size_type numRows, size_type numCols, size_type p, size_type q, size_type z) {
+    size_type countRange(size_type numRows, size_type numCols, size_type p1, size_type p2, size_type q1, size_type q2, size_type z) const {
 
         if (z >= T_.size()) {
-            L_[z - T_.size()] = null_;
-        } else {
+            return (leaf(z - T_.size()) != null_);
+        }
+
+        if (!hasChildren(z)) {
+            return 0;
+        }
+
+        // submatrix completely covered by the range: count all its entries at once
+        if (p1 == 0 && q1 == 0 && p2 == numRows - 1 && q2 == numCols - 1) {
+            return countSubtree(z);
+        }
+
+        size_type y = R_.rank(z + 1) * kr_ * kc_;
+        size_type p1Prime, p2Prime;
+        size_type cnt = 0;
+
+        for (size_type i = p1 / (numRows / kr_); i <= p2 / (numRows / kr_); i++) {
 
-            if (T_[z]) {
-                set(numRows / kr_, numCols / kc_, p % (numRows / kr_), q % (numCols / kc_), R_.rank(z + 1) * kr_ * kc_ + (p / (numRows / kr_)) * kc_ + q / (numCols / kc_));
+            p1Prime = (i == p1 / (numRows / kr_)) * (p1 % (numRows / kr_));
+            p2Prime = (i == p2 / (numRows / kr_)) ? p2 % (numRows / kr_) : numRows / kr_ - 1;
+
+            for (size_type j = q1 / (numCols / kc_); j <= q2 / (numCols / kc_); j++) {
+                cnt += countRange(
+                        numRows / kr_,
+                        numCols / kc_,
+                        p1Prime,
+                        p2Prime,
+                        (j == q1 / (numCols / kc_)) * (q1 % (numCols / kc_)),
+                        (j == q2 / (numCols / kc_)) ? q2 % (numCols / kc_) : numCols / kc_ - 1,
+                        y + kc_ * i + j
+                );
             }
 
         }
 
+        return cnt;
+
     }
 
-};
+    /* helper methods for counting (countElements() / countElementsInRange()) */
 
+    // returns the number of non-null entries in the leaves below node z (z < T_.size() and T_[z] = 1),
+    // the nodes of a subtree on each level form a contiguous interval, which is mapped to the next level via rank
+    size_type countSubtree(size_type z) const {
 
-/**
- * Bool specialisation of KrKcTree.
- *
- * Has the same characteristics as the general implementation above,
+        size_type lo = z;
+        size_type hi = z + 1;
+
+        while (lo < hi && lo < T_.size()) {
+
+            lo = (R_.rank(lo) + 1) * kr_ * kc_;
+            hi = (R_.rank(hi) + 1) * kr_ * kc_;
+
+        }
+
+        return (lo < hi) ? countLeaves(lo - T_.size(), hi - T_.size()) : 0;
+
+    }
+
+    // returns the number of non-null entries in L_[from..to)
+    size_type countLeaves(size_type from, size_type to) const {
+
+        if (countSamples_.empty()) {
+
+            size_type cnt = 0;
+            for (size_type x = from; x < to; x++) {
+                cnt += (leaf(x) != null_);
+            }
+
+            return cnt;
+
+        }
+
+        return countPrefix(to) - countPrefix(from);
+
+    }
+
+    // returns the number of non-null entries in L_[0..x) using the counting index
+    size_type countPrefix(size_type x) const {
+
+        size_type cnt = countSamples_[x / K2TREES_COUNT_SAMPLE_RATE];
+        for (size_type y = (x / K2TREES_COUNT_SAMPLE_RATE) * K2TREES_COUNT_SAMPLE_RATE; y < x; y++) {
+            cnt += (leaf(y) != null_);
+        }
+
+        return cnt;
+
+    }
+
+    /* helper method for the set operations */
+
+    // determines the result of op level by level, each element of cur represents a node of the result
+    // by the positions of the first children of the corresponding nodes in this and other (none if the subtree is empty)
+    KrKcTree combine(const KrKcTree& other, const SetOperation op) const {
+
+        if ((kr_ != other.kr_) || (kc_ != other.kc_) || (h_ != other.h_)) {
+            throw std::runtime_error("Set operations are only supported between K2Trees with the same arities and height.");
+        }
+
+        const size_type none = size_type(-1);
+
+        std::vector<std::vector<bool>> levels(h_ - 1);
+        std::vector<elem_type> leaves;
+
+        std::vector<std::pair<size_type, size_type>> cur(1, std::make_pair((numLeaves() != 0) ? 0 : none, (other.numLeaves() != 0) ? 0 : none));
+        std::vector<std::pair<size_type, size_type>> next;
+
+        for (size_type l = 0; l < h_; l++) {
+
+            for (auto& y : cur) {
+
+                for (size_type i = 0; i < kr_ * kc_; i++) {
+
+                    if (l < h_ - 1) {
+
+                        bool a = (y.first != none) && hasChildren(y.first + i);
+                        bool b = (y.second != none) && other.hasChildren(y.second + i);
+                        bool bit = (op == SET_UNION) ? (a || b) : ((op == SET_INTERSECTION) ? (a && b) : a);
+
+                        levels[l].push_back(bit);
+
+                        if (bit) {
+                            next.push_back(std::make_pair(a ? R_.rank(y.first + i + 1) * kr_ * kc_ : none, b ? other.R_.rank(y.second + i + 1) * kr_ * kc_ : none));
+                        }
+
+                    } else {
+
+                        elem_type a = (y.first != none) ? leaf(y.first + i - T_.size()) : null_;
+                        bool b = (y.second != none) && (other.leaf(y.second + i - other.T_.size()) != other.null_);
+
+                        if (op == SET_UNION) {
+                            leaves.push_back(((a == null_) && b) ? other.leaf(y.second + i - other.T_.size()) : a);
+                        } else if (op == SET_INTERSECTION) {
+                            leaves.push_back(b ? a : null_);
+                        } else {
+                            leaves.push_back(b ? null_ : a);
+                        }
+
+                    }
+
+                }
+
+            }
+
+            cur.swap(next);
+            next.clear();
+
+        }
+
+        // the intersection / difference of two non-empty subtrees can be empty
+        if (op != SET_UNION) {
+            pruneEmptyBlocks(levels, leaves, kr_ * kc_, null_);
+        }
+
+        KrKcTree res;
+        res.h_ = h_;
+        res.kr_ = kr_;
+        res.kc_ = kc_;
+        res.numRows_ = numRows_;
+        res.numCols_ = numCols_;
+        res.null_ = null_;
+
+        size_type total = 0;
+        for (size_type l = 0; l < h_ - 1; l++) {
+            total += levels[l].size();
+        }
+        res.T_ = bit_vector_type(total);
+
+        bit_vector_type::iterator outIter = res.T_.begin();
+        for (size_type l = 0; l < h_ - 1; l++) {
+            outIter = std::move(levels[l].begin(), levels[l].end(), outIter);
+        }
+
+        res.L_ = std::move(leaves);
+        res.R_ = rank_type(&res.T_);
+
+        return res;
+
+    }
+
+    /* helper methods for handling subtrees emptied by setNull() */
+
+    // checks whether node z has children, i.e. whether its bit in T is set and its subtree has not been emptied by setNull()
+    inline bool hasChildren(size_type z) const {
+
+        K2TREES_COUNT(nodesVisited);
+        return T_[z] && (emptyNodes_.empty() || !emptyNodes_[z]);
+
+    }
+
+    // checks whether all len nodes of the block starting at position y are empty
+    bool isEmptyBlock(size_type y, size_type len) const {
+
+        for (size_type c = y; c < y + len; c++) {
+            if ((c >= T_.size()) ? (leaf(c - T_.size()) != null_) : hasChildren(c)) {
+                return false;
+            }
+        }
+
+        return true;
+
+    }
+
+    // marks the subtree of node z as empty
+    void markEmpty(size_type z) {
+
+        if (emptyNodes_.empty()) {
+            emptyNodes_ = bit_vector_type(T_.size(), 0);
+        }
+
+        emptyNodes_[z] = 1;
+
+    }
+
+    /* setNull() */
+
+    void setInit(size_type p, size_type q) {
+
+        if (numLeaves() != 0) {
+            set(numRows_ / kr_, numCols_ / kc_, p % (numRows_ / kr_), q % (numCols_ / kc_), (p / (numRows_ / kr_)) * kc_ + q / (numCols_ / kc_));
+        }
+
+    }
+
+    // clears the entry in the subtree of z, returns true iff the subtree is empty afterwards
+    bool set(size_type numRows, size_type numCols, size_type p, size_type q, size_type z) {
+
+        if (z >= T_.size()) {
+
+            // keep the counting index up to date
+            if (!countSamples_.empty() && (leaf(z - T_.size()) != null_)) {
+                for (size_type s = (z - T_.size()) / K2TREES_COUNT_SAMPLE_RATE + 1; s < countSamples_.size(); s++) {
+                    countSamples_[s]--;
+                }
+            }
+
+            L_[z - T_.size()] = null_;
+
+            return true;
+
+        } else {
+
+            if (hasChildren(z)) {
+
+                size_type y = R_.rank(z + 1) * kr_ * kc_;
+
+                // mark z if its whole subtree has become empty
+                if (set(numRows / kr_, numCols / kc_, p % (numRows / kr_), q % (numCols / kc_), y + (p / (numRows / kr_)) * kc_ + q / (numCols / kc_)) && isEmptyBlock(y, kr_ * kc_)) {
+
+                    markEmpty(z);
+                    return true;
+
+                }
+
+                return false;
+
+            }
+
+            return true;
+
+        }
+
+    }
+
+};
+
+
+/**
+ * Bool specialisation of KrKcTree.
+ *
+ * Has the same characteristics as the general implementation above,
  * but makes use of some simplifications since the only non-null value is 1 / true.
  */
 template<>
@@ -2163,6 +3094,15 @@ public:
     typedef K2Tree<elem_type>::positions_type positions_type;
     typedef K2Tree<elem_type>::pairs_type pairs_type;
 
+    // output-buffer and limited variants of the query methods (see K2Tree)
+    using K2Tree<elem_type>::getSuccessorPositions;
+    using K2Tree<elem_type>::getPredecessorPositions;
+    using K2Tree<elem_type>::getPositionsInRange;
+    using K2Tree<elem_type>::getAllValuedPositions;
+    using K2Tree<elem_type>::getSuccessors;
+    using K2Tree<elem_type>::getRange;
+    using K2Tree<elem_type>::expandFrontier;
+
 
     KrKcTree() {
         // nothing to do
@@ -2179,7 +3119,10 @@ public:
 
         T_ = other.T_;
         L_ = other.L_;
+        compressedL_ = other.compressedL_;
         R_ = rank_type(&T_);
+        emptyNodes_ = other.emptyNodes_;
+        countSamples_ = other.countSamples_;
 
     }
 
@@ -2199,7 +3142,10 @@ public:
 
         T_ = other.T_;
         L_ = other.L_;
+        compressedL_ = other.compressedL_;
         R_ = rank_type(&T_);
+        emptyNodes_ = other.emptyNodes_;
+        countSamples_ = other.countSamples_;
 
         return *this;
 
@@ -2476,9 +3422,64 @@ public:
     }
 
     /**
-     * List-of-pairs-based constructor (based on section 3.3.5. of Brisaboa et al.)
+     * Streaming constructor that consumes the relation pairs provided by reader one after another and, apart from
+     * the resulting data structure, only keeps the path of the current submatrix (height times kr*kc entries) in memory.
+     *
+     * The pairs have to be sorted in the order in which the (depth-first) construction visits them, i.e. by their kr x kc
+     * submatrix on the first level (in row-major order), then by their submatrix on the second level and so on
+     * (within the kr x kc submatrices of the last level, this is plain row-major order).
+     * The represented matrix is the smallest kr^h x kc^h matrix that has at least numRows rows and numCols columns.
+     * Throws a std::runtime_error if a pair lies outside of this matrix, is out of order or occurs more than once.
+     */
+    KrKcTree(PairReader<bool>& reader, const size_type numRows, const size_type numCols, const size_type kr, const size_type kc) {
+
+        null_ = false;
+
+        kr_ = kr;
+        kc_ = kc;
+        h_ = std::max({(size_type)1, logK(numRows, kr_), logK(numCols, kc_)});
+        numRows_ = size_type(pow(kr_, h_));
+        numCols_ = size_type(pow(kc_, h_));
+
+        std::vector<std::vector<bool>> levels(h_);
+        buildFromStream(reader, levels, numRows_, numCols_, 1, 0, 0);
+
+        if (reader.hasNext()) {
+            throw std::runtime_error("Pair no. " + std::to_string(reader.getConsumed() + 1) + " at (" + std::to_string(reader.peek().row) + ", " + std::to_string(reader.peek().col) + ") is out of order, outside of the matrix or a duplicate.");
+        }
+
+        size_type total = 0;
+        for (size_type l = 0; l < h_ - 1; l++) {
+            total += levels[l].size();
+        }
+        T_ = bit_vector_type(total);
+
+        bit_vector_type::iterator outIter = T_.begin();
+        for (size_type l = 0; l < h_ - 1; l++) {
+
+            outIter = std::move(levels[l].begin(), levels[l].end(), outIter);
+            levels[l].clear();
+            levels[l].shrink_to_fit();
+
+        }
+
+        L_ = bit_vector_type(levels[h_ - 1].size());
+        std::move(levels[h_ - 1].begin(), levels[h_ - 1].end(), L_.begin());
+        levels[h_ - 1].clear();
+        levels[h_ - 1].shrink_to_fit();
+
+        R_ = rank_type(&T_);
+
+    }
+
+    /**
+     * List-of-pairs-based constructor
+     *
+     * The mixed-radix keys of the pairs are radix-sorted once and the levels are emitted in a single sweep over them
+     * (see buildLevelsFromSortedKeys()) using up to numThreads threads. If the keys do not fit into 64 bits, the tree is built
+     * level by level as in section 3.3.5. of Brisaboa et al., the subproblems of each level are processed by up to numThreads threads.
      */
-    KrKcTree(positions_type& pairs, const size_type kr, const size_type kc) {
+    KrKcTree(positions_type& pairs, const size_type kr, const size_type kc, const size_type numThreads = 1) {
 
         null_ = false;
 
@@ -2497,7 +3498,7 @@ public:
         numCols_ = size_type(pow(kc_, h_));
 
         if (pairs.size() != 0) {
-            buildFromListsInplace(pairs);
+            buildFromSortedKeys(pairs, numThreads);
         }
 
         R_ = rank_type(&T_);
@@ -2510,8 +3511,10 @@ public:
      *  y = first column of the submatrix
      *  nr = number of rows of the submatrix
      *  nc = number of columns of the submatrix
+     *
+     * The subproblems of each level are processed by up to numThreads threads.
      */
-    KrKcTree(positions_type& pairs, const size_type x, const size_type y, const size_type nr, const size_type nc, const size_type l, const size_type r, const size_type kr, const size_type kc) {
+    KrKcTree(positions_type& pairs, const size_type x, const size_type y, const size_type nr, const size_type nc, const size_type l, const size_type r, const size_type kr, const size_type kc, const size_type numThreads = 1) {
 
         null_ = false;
 
@@ -2524,7 +3527,7 @@ public:
         checkParameters(nr, nc, kr, kc);
 
         if (l != r) {
-            buildFromListsInplace(pairs, x, y, nr, nc, l, r);
+            buildFromListsInplace(pairs, x, y, nr, nc, l, r, numThreads);
         }
 
         R_ = rank_type(&T_);
@@ -2533,38 +3536,38 @@ public:
 
 
     // returns the height of the K2Tree
-    size_type getH() {
+    size_type getH() const {
         return h_;
     }
 
     // returns the row arity of the K2Tree
-    size_type getKr() {
+    size_type getKr() const {
         return kr_;
     }
 
     // returns the column arity of the K2Tree
-    size_type getKc() {
+    size_type getKc() const {
         return kc_;
     }
 
-    size_type getNumRows() override {
+    size_type getNumRows() const override {
         return numRows_;
     }
 
-    size_type getNumCols() override {
+    size_type getNumCols() const override {
         return numCols_;
     }
 
-    elem_type getNull() override {
+    elem_type getNull() const override {
         return null_;
     }
 
 
-    bool areRelated(size_type i, size_type j) override {
+    bool areRelated(size_type i, size_type j) const override {
         return checkLinkInit(i, j);
     }
 
-    std::vector<size_type> getSuccessors(size_type i) override {
+    std::vector<size_type> getSuccessors(size_type i) const override {
 
         std::vector<size_type> succs;
 //        successorsInit(succs, i);
@@ -2574,7 +3577,7 @@ public:
 
     }
 
-    std::vector<size_type> getPredecessors(size_type j) override {
+    std::vector<size_type> getPredecessors(size_type j) const override {
 
         std::vector<size_type> preds;
         predecessorsInit(preds, j);
@@ -2583,7 +3586,7 @@ public:
 
     }
 
-    positions_type getRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    positions_type getRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
 
         positions_type pairs;
         rangeInit(pairs, i1, i2, j1, j2);
@@ -2593,16 +3596,20 @@ public:
 
     }
 
-    bool containsLink(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    bool containsLink(size_type i1, size_type i2, size_type j1, size_type j2) const override {
         return linkInRangeInit(i1, i2, j1, j2);
 //        return linkInRangeInit(i1, std::min(i2, numRows_ - 1), j1, std::min(j2, numCols_ - 1));
     }
 
-    size_type countLinks() override {
+    size_type countLinks() const override {
+
+        if (!countSamples_.empty()) {
+            return countSamples_.back();
+        }
 
         size_type res = 0;
-        for (auto i = 0; i < L_.size(); i++) {
-            res += L_[i];
+        for (auto i = 0; i < numLeaves(); i++) {
+            res += leaf(i);
         }
 
         return res;
@@ -2614,23 +3621,32 @@ public:
      * General methods for completeness' sake (are redundant / useless for bool)
      */
 
-    bool isNotNull(size_type i, size_type j) override {
+    bool isNotNull(size_type i, size_type j) const override {
         return areRelated(i, j);
     }
 
-    elem_type getElement(size_type i, size_type j) override {
+    elem_type getElement(size_type i, size_type j) const override {
         return areRelated(i, j);
     }
 
-    std::vector<elem_type> getSuccessorElements(size_type i) override {
+    void isNotNull(const positions_type& queries, std::vector<bool>& out) const override {
+        out.assign(queries.size(), false);
+        batchInit(queries, [&](size_type x, size_type pos) { out[x] = leaf(pos); });
+    }
+
+    void getElement(const positions_type& queries, std::vector<elem_type>& out) const override {
+        isNotNull(queries, out);
+    }
+
+    std::vector<elem_type> getSuccessorElements(size_type i) const override {
         return std::vector<elem_type>(getSuccessors(i).size(), true);
     }
 
-    std::vector<size_type> getSuccessorPositions(size_type i) override {
+    std::vector<size_type> getSuccessorPositions(size_type i) const override {
         return getSuccessors(i);
     }
 
-    pairs_type getSuccessorValuedPositions(size_type i) override {
+    pairs_type getSuccessorValuedPositions(size_type i) const override {
 
         auto pos = getSuccessors(i);
 
@@ -2643,15 +3659,15 @@ public:
 
     }
 
-    std::vector<elem_type> getPredecessorElements(size_type j) override {
+    std::vector<elem_type> getPredecessorElements(size_type j) const override {
         return std::vector<elem_type>(getPredecessors(j).size(), true);
     }
 
-    std::vector<size_type> getPredecessorPositions(size_type j) override {
+    std::vector<size_type> getPredecessorPositions(size_type j) const override {
         return getPredecessors(j);
     }
 
-    pairs_type getPredecessorValuedPositions(size_type j) override {
+    pairs_type getPredecessorValuedPositions(size_type j) const override {
 
         auto pos = getPredecessors(j);
 
@@ -2664,15 +3680,15 @@ public:
 
     }
 
-    std::vector<elem_type> getElementsInRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    std::vector<elem_type> getElementsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
         return std::vector<elem_type>(getRange(i1, i2, j1, j2).size(), true);
     }
 
-    positions_type getPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    positions_type getPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
         return getRange(i1, i2, j1, j2);
     }
 
-    pairs_type getValuedPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    pairs_type getValuedPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
 
         auto pos = getRange(i1, i2, j1, j2);
 
@@ -2685,15 +3701,15 @@ public:
 
     }
 
-    std::vector<elem_type> getAllElements() override {
+    std::vector<elem_type> getAllElements() const override {
         return std::vector<elem_type>(countLinks(), true);
     }
 
-    positions_type getAllPositions() override {
+    positions_type getAllPositions() const override {
         return getRange(0, numRows_ - 1, 0, numCols_ - 1);
     }
 
-    pairs_type getAllValuedPositions() override {
+    pairs_type getAllValuedPositions() const override {
 
         auto pos = getAllPositions();
 
@@ -2706,21 +3722,85 @@ public:
 
     }
 
-    bool containsElement(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    bool forEachSuccessorPosition(size_type i, const std::function<bool(size_type)>& visitor) const override {
+        return successorsVisitInit(visitor, i);
+    }
+
+    bool forEachPredecessorPosition(size_type j, const std::function<bool(size_type)>& visitor) const override {
+        return predecessorsVisitInit(visitor, j);
+    }
+
+    bool forEachValuedPositionInRange(size_type i1, size_type i2, size_type j1, size_type j2, const std::function<bool(size_type, size_type, elem_type)>& visitor) const override {
+        return rangeValVisitInit(visitor, i1, i2, j1, j2);
+    }
+
+    bool containsElement(size_type i1, size_type i2, size_type j1, size_type j2) const override {
         return linkInRangeInit(i1, i2, j1, j2);
 //        return linkInRangeInit(i1, std::min(i2, numRows_ - 1), j1, std::min(j2, numCols_ - 1));
     }
 
-    size_type countElements() override {
+    size_type countElements() const override {
         return countLinks();
     }
 
+    size_type countElementsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
+        return countRangeInit(i1, i2, j1, j2);
+    }
+
+    // builds the (optional) counting index, a sampled prefix sum over the non-null entries of L,
+    // which makes countElements() constant-time and speeds up counting fully covered submatrices in countElementsInRange()
+    // (the index is kept up to date by setNull(), but it is not written by serialize())
+    void buildCountingIndex() {
+
+        this->checkWritable("buildCountingIndex");
+
+        size_type numSamples = numLeaves() / K2TREES_COUNT_SAMPLE_RATE + 1;
+        countSamples_.assign(numSamples + 1, 0);
+
+        size_type cnt = 0;
+        for (size_type s = 0; s < numSamples; s++) {
+
+            countSamples_[s] = cnt;
+            for (size_type x = s * K2TREES_COUNT_SAMPLE_RATE; x < std::min((s + 1) * K2TREES_COUNT_SAMPLE_RATE, numLeaves()); x++) {
+                cnt += leaf(x);
+            }
+
+        }
+
+        countSamples_[numSamples] = cnt;
+
+    }
+
+    bool hasCountingIndex() const {
+        return !countSamples_.empty();
+    }
+
+    // replaces the last level L by a dictionary of its distinct kr*kc blocks (sorted by decreasing frequency)
+    // and the DAC-encoded dictionary index of every leaf block (the vocabulary of leaf blocks of Brisaboa et al.),
+    // which saves space when few distinct blocks make up most of L; afterwards, setNull() is no longer supported
+    void compressLeaves() {
+
+        this->checkWritable("compressLeaves");
+
+        if (L_.empty()) {
+            return;
+        }
+
+        compressedL_ = LeafDictionary<bool>(L_, kr_ * kc_);
+        L_ = bit_vector_type(0);
+
+    }
+
+    bool hasCompressedLeaves() const {
+        return !compressedL_.empty();
+    }
+
 
     KrKcTree* clone() const override {
         return new KrKcTree<elem_type>(*this);
     }
 
-    void print(bool all = false) override {
+    void print(bool all = false) const override {
 
         std::cout << "### Parameters ###" << std::endl;
         std::cout << "h  = " << h_ << std::endl;
@@ -2737,7 +3817,7 @@ public:
             std::cout << std::endl << std::endl;
 
             std::cout << "### L ###" << std::endl;
-            for (auto i = 0; i < L_.size(); i++) std::cout << L_[i];
+            for (auto i = 0; i < numLeaves(); i++) std::cout << leaf(i);
             std::cout << std::endl << std::endl;
 
             std::cout << "### R ###" << std::endl;
@@ -2748,60 +3828,253 @@ public:
 
     }
 
-    // note: can "invalidate" the data structure (containsLink() probably won't work correctly afterwards)
-    void setNull(size_type i, size_type j) override {
-        setInit(i, j);
-    }
-
-    size_type getFirstSuccessor(size_type i) override {
-//        return firstSuccessorInit(i);
-        return firstSuccessorPositionIterative(i);
-    }
+    void serialize(std::ostream& out) const override {
 
+        writeHeader(out, "KrKcTree<bool>", sizeof(elem_type));
 
+        writeValue(out, h_);
+        writeValue(out, kr_);
+        writeValue(out, kc_);
+        writeValue(out, numRows_);
+        writeValue(out, numCols_);
+        writeValue(out, null_);
 
-private:
-    // representation of all but the last levels of the K2Tree (internal structure)
-    bit_vector_type T_;
+        T_.serialize(out);
+        L_.serialize(out);
+        compressedL_.serialize(out);
+        R_.serialize(out);
+        emptyNodes_.serialize(out);
 
-    // representation of the last level of the K2Tree (actual values of the relation)
-    bit_vector_type L_;
+    }
 
-    // rank data structure for navigation in T_
-    rank_type R_;
+    void load(std::istream& in) override {
 
-    size_type h_; // height of the K2Tree
-    size_type kr_; // row arity of the K2Tree
-    size_type kc_; // column arity of the K2Tree
-    size_type numRows_; // number of rows in the represented relation matrix
-    size_type numCols_; // number of columns in the represented relation matrix
+        this->checkWritable("load");
 
-    elem_type null_; // null element
+        unsigned int version = readHeader(in, "KrKcTree<bool>", sizeof(elem_type));
 
+        readValue(in, h_);
+        readValue(in, kr_);
+        readValue(in, kc_);
+        readValue(in, numRows_);
+        readValue(in, numCols_);
+        readValue(in, null_);
 
-    /* helper method to check the feasibility of the tree parameters prior to construction */
+        T_.load(in);
+        L_.load(in);
+        if (version >= 6) {
+            compressedL_.load(in);
+        } else {
+            compressedL_ = LeafDictionary<bool>();
+        }
+        R_.load(in, &T_);
+        if (version >= 4) {
+            emptyNodes_.load(in);
+        } else {
+            emptyNodes_ = bit_vector_type();
+        }
 
-    void checkParameters(const size_type nr, const size_type nc, const size_type kr, const size_type kc) {
+        countSamples_.clear();
 
-        if ((numRows_ != nr) || (numCols_ != nc)) {
+    }
 
-            std::string err = std::string() +
-                              "Unsuitable parameters! " +
-                              "The numbers of rows (nr) and columns (nc) have to be powers of kr resp. kc (using the same exponent h)." +
-                              "But you gave me: nr = " + std::to_string(nr) + ", nc = " = std::to_string(nc) +
-                                                                                          ", kr = " + std::to_string(kr) + " and kc = " + std::to_string(kc) + " leading to h = " + std::to_string(h_) +
-                                                                                          " and " + std::to_string(numRows_) + " rows resp. " + std::to_string(numCols_) + " columns."
-            ;
+    // note: emptied subtrees are only marked, compact() removes them from the internal structure
+    void setNull(size_type i, size_type j) override {
 
-            throw std::runtime_error(err);
+        this->checkWritable("setNull");
 
+        if (!compressedL_.empty()) {
+            throw std::runtime_error("setNull() is not supported after compressLeaves().");
         }
 
+        setInit(i, j);
     }
 
-    /* helper method for construction from relation matrix */
+    // rebuilds the internal structure from the remaining elements, so that the subtrees emptied by setNull() are removed
+    // (the size of the relation matrix remains unchanged, the counting index is rebuilt if present)
+    void compact() override {
 
-    bool buildFromMatrix(const RelationMatrix& mat, std::vector<std::vector<bool>>& levels, size_type numRows, size_type numCols, size_type l, size_type p, size_type q) {// 3.3.1 / Algorithm 1
+        this->checkWritable("compact");
+
+        if (emptyNodes_.empty()) {
+            return;
+        }
+
+        positions_type pairs = getAllPositions();
+        bool compressed = !compressedL_.empty();
+
+        T_ = bit_vector_type();
+        L_ = bit_vector_type();
+        compressedL_ = LeafDictionary<bool>();
+        emptyNodes_ = bit_vector_type();
+
+        if (!pairs.empty()) {
+            buildFromListsInplace(pairs, 0, 0, numRows_, numCols_, 0, pairs.size(), 1);
+        }
+
+        if (compressed) {
+            compressLeaves();
+        }
+
+        R_ = rank_type(&T_);
+
+        if (!countSamples_.empty()) {
+            buildCountingIndex();
+        }
+
+    }
+
+    SizeBreakdown sizeInBytes() const override {
+
+        SizeBreakdown s;
+        s.T = sdsl::size_in_bytes(T_);
+        s.L = sdsl::size_in_bytes(L_) + compressedL_.sizeInBytes();
+        s.rank = sdsl::size_in_bytes(R_);
+        s.aux = sdsl::size_in_bytes(emptyNodes_) + vectorBytes(countSamples_);
+        s.other = sizeof(*this);
+
+        return s;
+
+    }
+
+    size_type getFirstSuccessor(size_type i) const override {
+//        return firstSuccessorInit(i);
+        return firstSuccessorPositionIterative(i);
+    }
+
+    std::vector<size_type> expandFrontier(const std::vector<size_type>& frontier, std::vector<bool>& visited) const override {
+
+        auto rows = this->prepareFrontier(frontier, visited);
+        std::vector<size_type> cols;
+
+        if ((numLeaves() != 0) && !rows.empty()) {
+            frontierPos(cols, visited, numRows_, numCols_, 0, 0, rows.cbegin(), rows.cend(), 0);
+        }
+
+        this->finishFrontier(cols, visited);
+
+        return cols;
+
+    }
+
+    /*
+     * Set operations (traverse both K2Trees level by level at the same time without decompressing them,
+     * only supported between K2Trees with the same arities and height)
+     */
+
+    // returns a K2Tree representing the union of both relations
+    KrKcTree getUnion(const KrKcTree& other) const {
+        return combine(other, SET_UNION);
+    }
+
+    // returns a K2Tree representing the pairs of this K2Tree that are also contained in other
+    KrKcTree getIntersection(const KrKcTree& other) const {
+        return combine(other, SET_INTERSECTION);
+    }
+
+    // returns a K2Tree representing the pairs of this K2Tree that are not contained in other
+    KrKcTree getDifference(const KrKcTree& other) const {
+        return combine(other, SET_DIFFERENCE);
+    }
+
+    /*
+     * Boolean matrix product R x S, i.e. the relational join of R (this K2Tree) and S (other)
+     * (only supported if both K2Trees have the same height and the column arity of this K2Tree equals the row arity of other, the top-level quadrants of the result are processed by up to numThreads threads)
+     */
+
+    // returns all pairs (i,j) such that (i,m) in R and (m,j) in S for some m (in no particular order)
+    positions_type getProductPositions(const KrKcTree& other, const size_type numThreads = 1) const {
+
+        checkProductArguments(other);
+
+        positions_type pairs;
+
+        if ((numLeaves() == 0) || (other.numLeaves() == 0)) {
+            return pairs;
+        }
+
+        productInit(other, pairs, numThreads);
+
+        return pairs;
+
+    }
+
+    // returns a K2Tree representing R x S
+    KrKcTree getProduct(const KrKcTree& other, const size_type numThreads = 1) const {
+
+        auto pairs = getProductPositions(other, numThreads);
+
+        KrKcTree res;
+        res.h_ = h_;
+        res.kr_ = kr_;
+        res.kc_ = other.kc_;
+        res.numRows_ = numRows_;
+        res.numCols_ = other.numCols_;
+        res.null_ = false;
+
+        if (!pairs.empty()) {
+            res.buildFromListsInplace(pairs, 0, 0, res.numRows_, res.numCols_, 0, pairs.size(), numThreads);
+        }
+
+        res.R_ = rank_type(&res.T_);
+
+        return res;
+
+    }
+
+
+
+private:
+    // representation of all but the last levels of the K2Tree (internal structure)
+    level_vector_type T_;
+
+    // representation of the last level of the K2Tree (actual values of the relation)
+    bit_vector_type L_;
+
+    // (optional) compressed representation of the last level, replaces L_ after compressLeaves()
+    LeafDictionary<bool> compressedL_;
+
+    // rank data structure for navigation in T_
+    rank_type R_;
+
+    // marks the internal nodes whose subtrees have been emptied by setNull() (empty if there are none), see compact()
+    bit_vector_type emptyNodes_;
+
+    // (optional) counting index: number of non-null entries in L_[0..s * K2TREES_COUNT_SAMPLE_RATE) for all samples s, followed by the total number
+    std::vector<size_type> countSamples_;
+
+    size_type h_; // height of the K2Tree
+    size_type kr_; // row arity of the K2Tree
+    size_type kc_; // column arity of the K2Tree
+    size_type numRows_; // number of rows in the represented relation matrix
+    size_type numCols_; // number of columns in the represented relation matrix
+
+    elem_type null_; // null element
+
+
+    /* helper method to check the feasibility of the tree parameters prior to construction */
+
+    void checkParameters(const size_type nr, const size_type nc, const size_type kr, const size_type kc) {
+
+        if ((numRows_ != nr) || (numCols_ != nc)) {
+
+            std::string err = std::string() +
+                              "Unsuitable parameters! " +
+                              "The numbers of rows (nr) and columns (nc) have to be powers of kr resp. kc (using the same exponent h)." +
+                              "But you gave me: nr = " + std::to_string(nr) + ", nc = " = std::to_string(nc) +
+                                                                                          ", kr = " + std::to_string(kr) + " and kc = " + std::to_string(kc) + " leading to h = " + std::to_string(h_) +
+                                                                                          " and " + std::to_string(numRows_) + " rows resp. " + std::to_string(numCols_) + " columns."
+            ;
+
+            throw std::runtime_error(err);
+
+        }
+
+    }
+
+    /* helper method for construction from relation matrix */
+
+    bool buildFromMatrix(const RelationMatrix& mat, std::vector<std::vector<bool>>& levels, size_type numRows, size_type numCols, size_type l, size_type p, size_type q) {// 3.3.1 / Algorithm 1
 
         std::vector<bool> C;
 
@@ -2872,6 +4145,58 @@ private:
 
     }
 
+    /* helper method for streaming construction */
+
+    bool buildFromStream(PairReader<bool>& reader, std::vector<std::vector<bool>>& levels, size_type numRows, size_type numCols, size_type l, size_type p, size_type q) {
+
+        // as the pairs are sorted, the submatrix is empty if the next pair does not lie within it
+        if (!reader.hasNext()) {
+            return false;
+        }
+
+        auto& rec = reader.peek();
+        if (!((rec.row >= p) && (rec.row < p + numRows) && (rec.col >= q) && (rec.col < q + numCols))) {
+            return false;
+        }
+
+        std::vector<bool> C(kr_ * kc_);
+
+        if (l == h_) {
+
+            for (size_type i = 0; i < kr_; i++) {
+                for (size_type j = 0; j < kc_; j++) {
+
+                    if (reader.hasNext() && (reader.peek().row == p + i) && (reader.peek().col == q + j)) {
+
+                        C[i * kc_ + j] = true;
+                        reader.next();
+
+                    }
+
+                }
+            }
+
+        } else {
+
+            for (size_type i = 0; i < kr_; i++) {
+                for (size_type j = 0; j < kc_; j++) {
+                    C[i * kc_ + j] = buildFromStream(reader, levels, numRows / kr_, numCols / kc_, l + 1, p + i * (numRows / kr_), q + j * (numCols / kc_));
+                }
+            }
+
+        }
+
+        if (isAllZero(C)) {
+            return false;
+        } else {
+
+            levels[l - 1].insert(levels[l - 1].end(), C.begin(), C.end());
+            return true;
+
+        }
+
+    }
+
     /* helper methods for construction from relation lists via temporary tree */
 
     void buildFromListsViaTree(const RelationLists& lists) {// 3.3.3, so far without special bit vectors without initialisation
@@ -3038,8 +4363,8 @@ private:
 
         } else {
 
-            std::vector<bool> T, L;
-            NaiveDynamicRank R;
+            DynamicVector<bool> T, L;
+            DynamicRank R;
 
             for (size_type i = 0; i < lists.size(); i++) {
                 for (size_type j = 0; j < lists[i].size(); j++) {
@@ -3048,12 +4373,10 @@ private:
             }
 
             L_ = bit_vector_type(L.size());
-            std::move(L.begin(), L.end(), L_.begin());
-            L.clear();
-            L.shrink_to_fit();
+            L.copyTo(L_.begin());
 
             T_ = bit_vector_type(T.size());
-            std::move(T.begin(), T.end(), T_.begin());
+            T.copyTo(T_.begin());
 
         }
 
@@ -3081,8 +4404,8 @@ private:
 
         } else {
 
-            std::vector<bool> T, L;
-            NaiveDynamicRank R;
+            DynamicVector<bool> T, L;
+            DynamicRank R;
 
             for (size_type i = x; (i < x + nr) && (i < lists.size()); i++) {
                 for (size_type j = 0; j < lists[i].size(); j++) {
@@ -3093,12 +4416,10 @@ private:
             }
 
             L_ = bit_vector_type(L.size());
-            std::move(L.begin(), L.end(), L_.begin());
-            L.clear();
-            L.shrink_to_fit();
+            L.copyTo(L_.begin());
 
             T_ = bit_vector_type(T.size());
-            std::move(T.begin(), T.end(), T_.begin());
+            T.copyTo(T_.begin());
 
         }
 
@@ -3106,12 +4427,12 @@ private:
 
     }
 
-    void insertInit(std::vector<bool>& T, std::vector<bool>& L, NaiveDynamicRank& R, size_type p, size_type q) {
+    void insertInit(DynamicVector<bool>& T, DynamicVector<bool>& L, DynamicRank& R, size_type p, size_type q) {
 
         if (T.empty()) {
 
-            T = std::vector<bool>(kr_ * kc_);
-            R = NaiveDynamicRank(T);
+            T = DynamicVector<bool>(kr_ * kc_, false);
+            R = DynamicRank(std::vector<bool>(kr_ * kc_));
 
         }
 
@@ -3119,7 +4440,7 @@ private:
 
     }
 
-    void insert(std::vector<bool>& T, std::vector<bool>& L, NaiveDynamicRank& R, size_type numRows, size_type numCols, size_type p, size_type q, size_type z, size_type l) {
+    void insert(DynamicVector<bool>& T, DynamicVector<bool>& L, DynamicRank& R, size_type numRows, size_type numCols, size_type p, size_type q, size_type z, size_type l) {
 
         if (!T[z]) {
 
@@ -3130,12 +4451,12 @@ private:
 
             if ((l + 1) == h_) {
 
-                L.insert(L.begin() + R.rank(z + 1) * kr_ * kc_ - T.size(), kr_ * kc_, 0);
+                L.insert(R.rank(z + 1) * kr_ * kc_ - T.size(), kr_ * kc_, 0);
                 L[y - T.size()] = 1;
 
             } else {
 
-                T.insert(T.begin() + R.rank(z + 1) * kr_ * kc_, kr_ * kc_, 0);
+                T.insert(R.rank(z + 1) * kr_ * kc_, kr_ * kc_, 0);
                 R.insert(R.rank(z + 1) * kr_ * kc_ + 1, kr_ * kc_);
 
                 insert(T, L, R, numRows / kr_, numCols / kc_, p % (numRows / kr_), q % (numCols / kc_), y, l + 1);
@@ -3156,106 +4477,87 @@ private:
 
     }
 
-    /* helper methods for inplace construction from single list of pairs */
+    /* helper method for construction from the radix-sorted keys of a single list of pairs */
 
-    size_type computeKey(const positions_type::value_type& pair, const Subproblem& sp, size_type widthRow, size_type widthCol) {
-        return ((pair.first - sp.firstRow) / widthRow) * kc_ + (pair.second - sp.firstCol) / widthCol;
-    }
+    void buildFromSortedKeys(positions_type& pairs, const size_type numThreads) {
 
-    void countingSort(positions_type& pairs, std::vector<std::pair<size_type, size_type>>& intervals, const Subproblem& sp, size_type widthRow, size_type widthCol, size_type sup) {
+        std::vector<bool> T, L;
+        if (!buildLevelsFromSortedKeys(pairs, std::vector<size_type>(h_, kr_), std::vector<size_type>(h_, kc_), false, T, L, numThreads)) {
 
-        std::vector<size_type> counts(sup);
+            buildFromListsInplace(pairs, 0, 0, numRows_, numCols_, 0, pairs.size(), numThreads); // the keys do not fit into 64 bits
+            return;
 
-        // determine key frequencies
-        for (auto i = sp.left; i < sp.right; i++) {
-            counts[computeKey(pairs[i], sp, widthRow, widthCol)]++;
         }
 
-        // determine starting index for each key
-        size_type total = 0;
-        size_type tmp;
-
-        for (auto key = 0; key < sup; key++) {
-
-            tmp = counts[key];
-            counts[key] = total;
-            total += tmp;
-
-            intervals[key].first = counts[key];
-            intervals[key].second = total;
-
-        }
+        L_ = bit_vector_type(L.size());
+        std::move(L.begin(), L.end(), L_.begin());
+        L.clear();
+        L.shrink_to_fit();
 
-        // reorder pairs of current subproblem
-        positions_type tmpPairs(sp.right - sp.left + 1);
-        for (auto i = sp.left; i < sp.right; i++) {
+        T_ = bit_vector_type(T.size());
+        std::move(T.begin(), T.end(), T_.begin());
 
-            tmpPairs[counts[computeKey(pairs[i], sp, widthRow, widthCol)]] = pairs[i];
-            counts[computeKey(pairs[i], sp, widthRow, widthCol)]++;
+    }
 
-        }
+    /* helper methods for inplace construction from single list of pairs */
 
-        for (auto i = sp.left; i < sp.right; i++) {
-            pairs[i] = tmpPairs[i - sp.left];
-        }
+    size_type computeKey(const positions_type::value_type& pair, const Subproblem& sp, size_type widthRow, size_type widthCol) {
+        return ((pair.first - sp.firstRow) / widthRow) * kc_ + (pair.second - sp.firstCol) / widthCol;
+    }
 
+    void countingSort(positions_type& pairs, LevelBuildState<positions_type, bool>& state, const Subproblem& sp, size_type widthRow, size_type widthCol, size_type sup, size_type numThreads) {
+        countingSortByKey(pairs, sp.left, sp.right, sup, [&](const positions_type::value_type& pair) { return computeKey(pair, sp, widthRow, widthCol); }, state.intervals, state.counts, state.tmpPairs, numThreads);
     }
 
-    void buildFromListsInplace(positions_type& pairs) {// 3.3.5
+    void buildFromListsInplace(positions_type& pairs, size_type x, size_type y, size_type nr, size_type nc, size_type l, size_type r, const size_type numThreads) {// 3.3.5 (level by level, the subproblems of each level are distributed among the threads)
 
-        std::queue<Subproblem> queue;
-        Subproblem sp;
-        size_type Sr, Sc;
-        std::vector<std::pair<size_type, size_type>> intervals(kr_ * kc_);
+        std::vector<Subproblem> level(1, Subproblem(x, x + nr - 1, y, y + nc - 1, l, r));
+        std::vector<LevelBuildState<positions_type, bool>> states(std::max(numThreads, (size_type) 1));
         std::vector<bool> T, L;
-        bit_vector_type appToL;
-
-        queue.push(Subproblem(0, numRows_ - 1, 0, numCols_ - 1, 0, pairs.size()));
-
-        while (!queue.empty()) {
+        size_type Sr = nr;
+        size_type Sc = nc;
 
-            sp = queue.front();
-            queue.pop();
-
-            Sr = sp.lastRow - sp.firstRow + 1;
-            Sc = sp.lastCol - sp.firstCol + 1;
+        auto process = [&](LevelBuildState<positions_type, bool>& state, const Subproblem& sp, size_type sortThreads) {
 
             if (Sr > kr_) {
 
-                countingSort(pairs, intervals, sp, Sr / kr_, Sc / kc_, kr_ * kc_);
+                countingSort(pairs, state, sp, Sr / kr_, Sc / kc_, kr_ * kc_, sortThreads);
 
                 for (size_type i = 0; i < kr_ * kc_; i++) {
 
-                    if (intervals[i].first < intervals[i].second) {
+                    if (state.intervals[i].first < state.intervals[i].second) {
 
-                        T.push_back(true);
-                        queue.push(Subproblem(
+                        state.T.push_back(true);
+                        state.next.push_back(Subproblem(
                                 sp.firstRow + (i / kc_) * (Sr / kr_),
                                 sp.firstRow + (i / kc_ + 1) * (Sr / kr_) - 1,
                                 sp.firstCol + (i % kc_) * (Sc / kc_),
                                 sp.firstCol + (i % kc_ + 1) * (Sc / kc_) - 1,
-                                sp.left + intervals[i].first,
-                                sp.left + intervals[i].second
+                                sp.left + state.intervals[i].first,
+                                sp.left + state.intervals[i].second
                         ));
 
                     } else {
-                        T.push_back(false);
+                        state.T.push_back(false);
                     }
 
                 }
 
             } else {
 
-                appToL = bit_vector_type(kr_ * kc_);
+                size_type offset = state.L.size();
+                state.L.resize(offset + kr_ * kc_);
 
                 for (size_type i = sp.left; i < sp.right; i++) {
-                    appToL[(pairs[i].first - sp.firstRow) * kc_ + (pairs[i].second - sp.firstCol)] = true;
+                    state.L[offset + (pairs[i].first - sp.firstRow) * kc_ + (pairs[i].second - sp.firstCol)] = true;
                 }
 
-                L.insert(L.end(), appToL.begin(), appToL.end());
-
             }
 
+        };
+
+        for (; !level.empty(); Sr /= kr_, Sc /= kc_) {
+            processLevel(level, states, numThreads, T, L, process);
         }
 
         L_ = bit_vector_type(L.size());
@@ -3268,105 +4570,184 @@ private:
 
     }
 
-    void buildFromListsInplace(positions_type& pairs, size_type x, size_type y, size_type nr, size_type nc, size_type l, size_type r) {// 3.3.5
 
-        std::queue<Subproblem> queue;
-        Subproblem sp;
-        size_type Sr, Sc;
-        std::vector<std::pair<size_type, size_type>> intervals(kr_ * kc_);
-        std::vector<bool> T, L;
-        bit_vector_type appToL;
+    /* areRelated() */
 
-        queue.push(Subproblem(x, x + nr - 1, y, y + nc - 1, l, r));
+    bool checkLinkInit(size_type p, size_type q) const {
 
-        while (!queue.empty()) {
+        size_type x;
+        if (fixedArityLeafPosition(p, q, x)) {
+            return (x < numLeaves()) && leaf(x);
+        }
 
-            sp = queue.front();
-            queue.pop();
+        return (numLeaves() == 0) ? false : checkLink(numRows_ / kr_, numCols_ / kc_, p % (numRows_ / kr_), q % (numCols_ / kc_), (p / (numRows_ / kr_)) * kc_ + q / (numCols_ / kc_));
 
-            Sr = sp.lastRow - sp.firstRow + 1;
-            Sc = sp.lastCol - sp.firstCol + 1;
+    }
 
-            if (Sr > kr_) {
+    bool checkLink(size_type numRows, size_type numCols, size_type p, size_type q, size_type z) const {
 
-                countingSort(pairs, intervals, sp, Sr / kr_, Sc / kc_, kr_ * kc_);
+        if (z >= T_.size()) {
+            return leaf(z - T_.size());
+        } else {
+            return T_[z] ? checkLink(numRows / kr_, numCols / kc_, p % (numRows / kr_), q % (numCols / kc_), R_.rank(z + 1) * kr_ * kc_ + (p / (numRows / kr_)) * kc_ + q / (numCols / kc_)) : false;
+        }
 
-                for (size_type i = 0; i < kr_ * kc_; i++) {
+    }
 
-                    if (intervals[i].first < intervals[i].second) {
+    /* helper methods for point queries with compile-time arities */
 
-                        T.push_back(true);
-                        queue.push(Subproblem(
-                                sp.firstRow + (i / kc_) * (Sr / kr_),
-                                sp.firstRow + (i / kc_ + 1) * (Sr / kr_) - 1,
-                                sp.firstCol + (i % kc_) * (Sc / kc_),
-                                sp.firstCol + (i % kc_ + 1) * (Sc / kc_) - 1,
-                                sp.left + intervals[i].first,
-                                sp.left + intervals[i].second
-                        ));
+    // determines the position x in L of (p, q) (numLeaves() if (p, q) lies in an empty submatrix) via the variant
+    // for the compile-time arities kr_ and kc_ and returns true, returns false if one of them is none of the commonly used arities 2, 4 and 8
+    bool fixedArityLeafPosition(size_type p, size_type q, size_type& x) const {
 
-                    } else {
-                        T.push_back(false);
-                    }
+        switch (kr_) {
+            case 2:
+                return fixedArityLeafPosition<2>(p, q, x);
+            case 4:
+                return fixedArityLeafPosition<4>(p, q, x);
+            case 8:
+                return fixedArityLeafPosition<8>(p, q, x);
+            default:
+                return false;
+        }
 
-                }
+    }
 
-            } else {
+    template<size_type KR>
+    bool fixedArityLeafPosition(size_type p, size_type q, size_type& x) const {
+
+        switch (kc_) {
+            case 2:
+                x = leafPosition<KR, 2>(p, q);
+                return true;
+            case 4:
+                x = leafPosition<KR, 4>(p, q);
+                return true;
+            case 8:
+                x = leafPosition<KR, 8>(p, q);
+                return true;
+            default:
+                return false;
+        }
 
-                appToL = bit_vector_type(kr_ * kc_);
+    }
 
-                for (size_type i = sp.left; i < sp.right; i++) {
-                    appToL[(pairs[i].first - sp.firstRow) * kc_ + (pairs[i].second - sp.firstCol)] = true;
-                }
+    // iterative descent for compile-time arities KR and KC (powers of two):
+    // as the height / width of every submatrix is a power of KR / KC, all divisions / remainders become shifts / masks
+    template<size_type KR, size_type KC>
+    size_type leafPosition(size_type p, size_type q) const {
+
+        size_type rs = logTwo(KR) * (h_ - 1);
+        size_type cs = logTwo(KC) * (h_ - 1);
+        size_type z = (p >> rs) * KC + (q >> cs);
 
-                L.insert(L.end(), appToL.begin(), appToL.end());
+        while (z < T_.size()) {
 
+            if (!T_[z]) {
+                return numLeaves();
             }
 
-        }
+            rs -= logTwo(KR);
+            cs -= logTwo(KC);
+            z = R_.rank(z + 1) * KR * KC + ((p >> rs) & (KR - 1)) * KC + ((q >> cs) & (KC - 1));
 
-        L_ = bit_vector_type(L.size());
-        std::move(L.begin(), L.end(), L_.begin());
-        L.clear();
-        L.shrink_to_fit();
+        }
 
-        T_ = bit_vector_type(T.size());
-        std::move(T.begin(), T.end(), T_.begin());
+        return z - T_.size();
 
     }
 
+    /* helper methods for batch queries (isNotNull() / getElement() on several positions) */
 
-    /* areRelated() */
+    // calls report(x, pos) for every query x whose position is represented in L_ (at pos),
+    // every submatrix shared by several queries is descended into only once
+    template<typename F>
+    void batchInit(const positions_type& queries, F report) const {
 
-    bool checkLinkInit(size_type p, size_type q) {
-        return (L_.empty()) ? false : checkLink(numRows_ / kr_, numCols_ / kc_, p % (numRows_ / kr_), q % (numCols_ / kc_), (p / (numRows_ / kr_)) * kc_ + q / (numCols_ / kc_));
-    }
+        if (numLeaves() == 0 || queries.empty()) return;
 
-    bool checkLink(size_type numRows, size_type numCols, size_type p, size_type q, size_type z) {
+        std::vector<size_type> order(queries.size());
+        std::vector<size_type> buffer(queries.size());
+        std::vector<std::vector<size_type>> ends(h_); // ends of the child groups, one array per level
 
-        if (z >= T_.size()) {
-            return L_[z - T_.size()];
-        } else {
-            return T_[z] ? checkLink(numRows / kr_, numCols / kc_, p % (numRows / kr_), q % (numCols / kc_), R_.rank(z + 1) * kr_ * kc_ + (p / (numRows / kr_)) * kc_ + q / (numCols / kc_)) : false;
+        for (size_type x = 0; x < queries.size(); x++) {
+            order[x] = x;
         }
 
+        batch(queries, order, buffer, ends, report, 0, queries.size(), numRows_, numCols_, 0, 0, 0, 0);
+
     }
 
-    /* getSuccessors() */
+    template<typename F>
+    void batch(const positions_type& queries, std::vector<size_type>& order, std::vector<size_type>& buffer, std::vector<std::vector<size_type>>& ends, F& report, size_type first, size_type last, size_type numRows, size_type numCols, size_type p, size_type q, size_type z, size_type l) const {
 
-    void allSuccessorPositionsIterative(std::vector<size_type>& succs, size_type p) {
+        size_type mr = numRows / kr_;
+        size_type mc = numCols / kc_;
+        size_type numChildren = kr_ * kc_;
 
-        if (L_.empty()) return;
+        auto& e = ends[l];
+        e.assign(numChildren, 0);
 
-        std::queue<SubrowInfo> queue, nextLevelQueue;
-        size_type lenT = T_.size();
+        // group the queries order[first..last) by the child containing them (stable counting sort)
+        for (size_type x = first; x < last; x++) {
+            e[((queries[order[x]].first - p) / mr) * kc_ + (queries[order[x]].second - q) / mc]++;
+        }
 
-        if (lenT == 0) {
+        size_type sum = first;
+        for (size_type c = 0; c < numChildren; c++) {
+            size_type tmp = e[c];
+            e[c] = sum;
+            sum += tmp;
+        }
 
-            size_type offset = p * numCols_;
-            for (size_type i = 0; i < numCols_; i++) {
-                if (L_[offset + i]) {
-                    succs.push_back(i);
+        for (size_type x = first; x < last; x++) {
+            buffer[e[((queries[order[x]].first - p) / mr) * kc_ + (queries[order[x]].second - q) / mc]++] = order[x];
+        }
+
+        std::copy(buffer.begin() + first, buffer.begin() + last, order.begin() + first);
+
+        // afterwards, the queries of child c are order[(c == 0 ? first : e[c - 1])..e[c])
+        size_type start = first;
+        for (size_type c = 0; c < numChildren; c++) {
+
+            size_type end = e[c];
+
+            if (start < end) {
+
+                size_type y = z + c;
+
+                if (y >= T_.size()) {
+                    for (size_type x = start; x < end; x++) {
+                        report(order[x], y - T_.size());
+                    }
+                } else if (T_[y]) {
+                    batch(queries, order, buffer, ends, report, start, end, mr, mc, p + (c / kc_) * mr, q + (c % kc_) * mc, R_.rank(y + 1) * kr_ * kc_, l + 1);
+                }
+
+            }
+
+            start = end;
+
+        }
+
+    }
+
+
+    /* getSuccessors() */
+
+    void allSuccessorPositionsIterative(std::vector<size_type>& succs, size_type p) const {
+
+        if (numLeaves() == 0) return;
+
+        std::queue<SubrowInfo> queue, nextLevelQueue;
+        size_type lenT = T_.size();
+
+        if (lenT == 0) {
+
+            size_type offset = p * numCols_;
+            for (size_type i = 0; i < numCols_; i++) {
+                if (leaf(offset + i)) {
+                    succs.push_back(i);
                 }
             }
 
@@ -3377,6 +4758,7 @@ private:
             size_type nc = numCols_/ kc_;
             size_type relP = p;
             for (size_type j = 0, dq = 0, z = kc_ * (relP / nr); j < kc_; j++, dq += nc, z++) {
+                K2TREES_COUNT(queuePushes);
                 queue.push(SubrowInfo(dq, z));
             }
 
@@ -3390,11 +4772,12 @@ private:
 
                     auto& cur = queue.front();
 
-                    if (T_[cur.z]) {
+                    if (hasChildren(cur.z)) {
 
                         auto y = R_.rank(cur.z + 1) * kr_ * kc_ + kc_ * (relP / nr);
 
                         for (size_type j = 0, newDq = cur.dq; j < kc_; j++, newDq += nc, y++) {
+                            K2TREES_COUNT(queuePushes);
                             nextLevelQueue.push(SubrowInfo(newDq, y));
                         }
 
@@ -3413,12 +4796,12 @@ private:
 
                 auto& cur = queue.front();
 
-                if (T_[cur.z]) {
+                if (hasChildren(cur.z)) {
 
                     auto y = R_.rank(cur.z + 1) * kr_ * kc_ + kc_ * (relP / nr) - lenT;
 
                     for (size_type j = 0, newDq = cur.dq; j < kc_; j++, newDq += nc, y++) {
-                        if (L_[y]) {
+                        if (leaf(y)) {
                             succs.push_back(newDq);
                         }
                     }
@@ -3433,9 +4816,9 @@ private:
 
     }
 
-    void successorsInit(std::vector<size_type>& succs, size_type p) {
+    void successorsInit(std::vector<size_type>& succs, size_type p) const {
 
-        if (!L_.empty()) {
+        if (numLeaves() != 0) {
 
             size_type y = kc_ * (p / (numRows_ / kr_));
 
@@ -3447,17 +4830,17 @@ private:
 
     }
 
-    void successors(std::vector<size_type>& succs, size_type numRows, size_type numCols, size_type p, size_type q, size_type z) {
+    void successors(std::vector<size_type>& succs, size_type numRows, size_type numCols, size_type p, size_type q, size_type z) const {
 
         if (z >= T_.size()) {
 
-            if (L_[z - T_.size()]) {
+            if (leaf(z - T_.size())) {
                 succs.push_back(q);
             }
 
         } else {
 
-            if (T_[z]) {
+            if (hasChildren(z)) {
 
                 size_type y = R_.rank(z + 1) * kr_ * kc_ + kc_ * (p / (numRows / kr_));
 
@@ -3472,17 +4855,58 @@ private:
 
     }
 
+    /* expandFrontier() */
+
+    // expands the rows [first, last) of the frontier within the submatrix of size numRows x numCols whose upper left corner is (p,q)
+    // and whose children start at position y, the subtrees shared by several rows are only traversed once
+    void frontierPos(std::vector<size_type>& cols, std::vector<bool>& visited, size_type numRows, size_type numCols, size_type p, size_type q,
+                     std::vector<size_type>::const_iterator first, std::vector<size_type>::const_iterator last, size_type y) const {
+
+        for (size_type i = 0; (i < kr_) && (first != last); i++) {
+
+            // rows of the frontier that lie in the i-th row of children
+            auto next = first;
+            while ((next != last) && (*next < p + (i + 1) * (numRows / kr_))) {
+                next++;
+            }
+
+            if (first != next) {
+
+                for (size_type j = 0; j < kc_; j++) {
+
+                    size_type z = y + i * kc_ + j;
+
+                    if (z >= T_.size()) {
+
+                        if (leaf(z - T_.size())) {
+                            this->addToFrontier(q + j, cols, visited);
+                        }
+
+                    } else if (hasChildren(z)) {
+                        frontierPos(cols, visited, numRows / kr_, numCols / kc_, p + i * (numRows / kr_), q + j * (numCols / kc_), first, next, R_.rank(z + 1) * kr_ * kc_);
+                    }
+
+                }
+
+            }
+
+            first = next;
+
+        }
+
+    }
+
     /* getFirstSuccessor() */
 
-    size_type firstSuccessorPositionIterative(size_type p) {
+    size_type firstSuccessorPositionIterative(size_type p) const {
 
-        if (L_.empty()) return numCols_;
+        if (numLeaves() == 0) return numCols_;
 
         if (T_.size() == 0) {
 
             size_type offset = p * numCols_;
             for (size_type i = 0; i < numCols_; i++) {
-                if (L_[offset + i]) {
+                if (leaf(offset + i)) {
                     return i;
                 }
             }
@@ -3490,6 +4914,7 @@ private:
         } else {
 
             std::stack<ExtendedSubrowInfo> stack;
+            K2TREES_COUNT(queuePushes);
             stack.emplace(numRows_ / kr_, numCols_ / kc_, p % (numRows_ / kr_), 0, kc_ * (p / (numRows_ / kr_)), 0);
 
             while (!stack.empty()) {
@@ -3502,13 +4927,14 @@ private:
 
                     if (cur.z >= T_.size()) {
 
-                        if (L_[cur.z - T_.size()]) {
+                        if (leaf(cur.z - T_.size())) {
                             return cur.dq;
                         }
 
                     } else {
 
-                        if (T_[cur.z]) {
+                        if (hasChildren(cur.z)) {
+                            K2TREES_COUNT(queuePushes);
                             stack.emplace(cur.nr / kr_, cur.nc / kc_, cur.p % (cur.nr / kr_), cur.dq, R_.rank(cur.z + 1) * kr_ * kc_ + kc_ * (cur.p / (cur.nr / kr_)), 0);
                         }
 
@@ -3527,11 +4953,11 @@ private:
 
     }
 
-    size_type firstSuccessorInit(size_type p) {
+    size_type firstSuccessorInit(size_type p) const {
 
         size_type pos = numCols_;
 
-        if (!L_.empty()) {
+        if (numLeaves() != 0) {
 
             size_type y = kc_ * (p / (numRows_ / kr_));
 
@@ -3545,19 +4971,19 @@ private:
 
     }
 
-    size_type firstSuccessor(size_type numRows, size_type numCols, size_type p, size_type q, size_type z) {
+    size_type firstSuccessor(size_type numRows, size_type numCols, size_type p, size_type q, size_type z) const {
 
         size_type pos = numCols_;
 
         if (z >= T_.size()) {
 
-            if (L_[z - T_.size()]) {
+            if (leaf(z - T_.size())) {
                 pos = q;
             }
 
         } else {
 
-            if (T_[z]) {
+            if (hasChildren(z)) {
 
                 size_type y = R_.rank(z + 1) * kr_ * kc_ + kc_ * (p / (numRows / kr_));
 
@@ -3575,9 +5001,9 @@ private:
 
     /* getPredecessors() */
 
-    void predecessorsInit(std::vector<size_type>& preds, size_type q) {
+    void predecessorsInit(std::vector<size_type>& preds, size_type q) const {
 
-        if (!L_.empty()) {
+        if (numLeaves() != 0) {
 
             size_type y = q / (numCols_ / kc_);
 
@@ -3589,17 +5015,17 @@ private:
 
     }
 
-    void predecessors(std::vector<size_type>& preds, size_type numRows, size_type numCols, size_type q, size_type p, size_type z) {
+    void predecessors(std::vector<size_type>& preds, size_type numRows, size_type numCols, size_type q, size_type p, size_type z) const {
 
         if (z >= T_.size()) {
 
-            if (L_[z - T_.size()]) {
+            if (leaf(z - T_.size())) {
                 preds.push_back(p);
             }
 
         } else {
 
-            if (T_[z]) {
+            if (hasChildren(z)) {
 
                 size_type y = R_.rank(z + 1) * kr_ * kc_ + q / (numCols / kc_);
 
@@ -3615,9 +5041,9 @@ private:
 
     /* getRange() */
 
-    void rangeInit(positions_type& pairs, size_type p1, size_type p2, size_type q1, size_type q2) {
+    void rangeInit(positions_type& pairs, size_type p1, size_type p2, size_type q1, size_type q2) const {
 
-        if (!L_.empty()) {
+        if (numLeaves() != 0) {
 
             size_type p1Prime, p2Prime;
 
@@ -3647,17 +5073,17 @@ private:
 
     }
 
-    void range(positions_type& pairs, size_type numRows, size_type numCols, size_type p1, size_type p2, size_type q1, size_type q2, size_type dp, size_type dq, size_type z) {
+    void range(positions_type& pairs, size_type numRows, size_type numCols, size_type p1, size_type p2, size_type q1, size_type q2, size_type dp, size_type dq, size_type z) const {
 
         if (z >= T_.size()) {
 
-            if (L_[z - T_.size()]) {
+            if (leaf(z - T_.size())) {
                 pairs.push_back(std::make_pair(dp, dq));
             }
 
         } else {
 
-            if (T_[z]) {
+            if (hasChildren(z)) {
 
                 auto y = R_.rank(z + 1) * kr_ * kc_;
                 size_type p1Prime, p2Prime;
@@ -3690,18 +5116,182 @@ private:
 
     }
 
-    /* linkInRange() */
+    /* forEachSuccessorPosition() */
+
+    bool successorsVisitInit(const std::function<bool(size_type)>& visitor, size_type p) const {
+
+        if (numLeaves() != 0) {
+
+            size_type y = kc_ * (p / (numRows_ / kr_));
+
+            for (size_type j = 0; j < kc_; j++) {
+                if (!successorsVisit(visitor, numRows_ / kr_, numCols_ / kc_, p % (numRows_ / kr_), (numCols_ / kc_) * j, y + j)) return false;
+            }
+
+        }
+
+        return true;
+
+    }
+
+    bool successorsVisit(const std::function<bool(size_type)>& visitor, size_type numRows, size_type numCols, size_type p, size_type q, size_type z) const {
+
+        if (z >= T_.size()) {
+
+            if (leaf(z - T_.size())) {
+                if (!visitor(q)) return false;
+            }
+
+        } else {
+
+            if (hasChildren(z)) {
+
+                size_type y = R_.rank(z + 1) * kr_ * kc_ + kc_ * (p / (numRows / kr_));
+
+                for (size_type j = 0; j < kc_; j++) {
+                    if (!successorsVisit(visitor, numRows / kr_, numCols / kc_, p % (numRows / kr_), q + (numCols / kc_) * j, y + j)) return false;
+                }
+
+            }
+
+        }
+
+        return true;
+
+    }
+
+    /* forEachPredecessorPosition() */
+
+    bool predecessorsVisitInit(const std::function<bool(size_type)>& visitor, size_type q) const {
+
+        if (numLeaves() != 0) {
+
+            size_type y = q / (numCols_ / kc_);
+
+            for (size_type i = 0; i < kr_; i++) {
+                if (!predecessorsVisit(visitor, numRows_ / kr_, numCols_ / kc_, q % (numCols_ / kc_), (numRows_ / kr_) * i, y + i * kc_)) return false;
+            }
+
+        }
+
+        return true;
+
+    }
+
+    bool predecessorsVisit(const std::function<bool(size_type)>& visitor, size_type numRows, size_type numCols, size_type q, size_type p, size_type z) const {
+
+        if (z >= T_.size()) {
+
+            if (leaf(z - T_.size())) {
+                if (!visitor(p)) return false;
+            }
+
+        } else {
+
+            if (hasChildren(z)) {
+
+                size_type y = R_.rank(z + 1) * kr_ * kc_ + q / (numCols / kc_);
+
+                for (size_type i = 0; i < kr_; i++) {
+                    if (!predecessorsVisit(visitor, numRows / kr_, numCols / kc_,  q % (numCols / kc_), p + (numRows / kr_) * i, y + i * kc_)) return false;
+                }
+
+            }
+
+        }
+
+        return true;
+
+    }
+
+    /* forEachValuedPositionInRange() */
+
+    bool rangeValVisitInit(const std::function<bool(size_type, size_type, elem_type)>& visitor, size_type p1, size_type p2, size_type q1, size_type q2) const {
+
+        if (numLeaves() != 0) {
+
+            size_type p1Prime, p2Prime;
+
+            for (auto i = p1 / (numRows_ / kr_); i <= p2 / (numRows_ / kr_); i++) {
+
+                p1Prime = (i == p1 / (numRows_ / kr_)) * (p1 % (numRows_ / kr_));
+                p2Prime = (i == p2 / (numRows_ / kr_)) ? p2 % (numRows_ / kr_) : (numRows_ / kr_) - 1;
+
+                for (auto j = q1 / (numCols_ / kc_); j <= q2 / (numCols_ / kc_); j++) {
+                    if (!rangeValVisit(
+                            visitor,
+                            numRows_ / kr_,
+                            numCols_ / kc_,
+                            p1Prime,
+                            p2Prime,
+                            (j == q1 / (numCols_ / kc_)) * (q1 % (numCols_ / kc_)),
+                            (j == q2 / (numCols_ / kc_)) ? q2 % (numCols_ / kc_) : (numCols_ / kc_) - 1,
+                            (numRows_ / kr_) * i,
+                            (numCols_ / kc_) * j,
+                            kc_ * i + j
+                    )) return false;
+                }
+
+            }
+
+        }
+
+        return true;
+
+    }
+
+    bool rangeValVisit(const std::function<bool(size_type, size_type, elem_type)>& visitor, size_type numRows, size_type numCols, size_type p1, size_type p2, size_type q1, size_type q2, size_type dp, size_type dq, size_type z) const {
+
+        if (z >= T_.size()) {
+
+            if (leaf(z - T_.size())) {
+                if (!visitor(dp, dq, leaf(z - T_.size()))) return false;
+            }
+
+        } else {
+
+            if (hasChildren(z)) {
+
+                auto y = R_.rank(z + 1) * kr_ * kc_;
+                size_type p1Prime, p2Prime;
+
+                for (auto i = p1 / (numRows / kr_); i <= p2 / (numRows / kr_); i++) {
+
+                    p1Prime = (i == p1 / (numRows / kr_)) * (p1 % (numRows / kr_));
+                    p2Prime = (i == p2 / (numRows / kr_)) ? p2 % (numRows / kr_) : numRows / kr_ - 1;
 
-    bool linkInRangeInit(size_type p1, size_type p2, size_type q1, size_type q2) {
+                    for (auto j = q1 / (numCols / kc_); j <= q2 / (numCols / kc_); j++) {
+                        if (!rangeValVisit(
+                                visitor,
+                                numRows / kr_,
+                                numCols / kc_,
+                                p1Prime,
+                                p2Prime,
+                                (j == q1 / (numCols / kc_)) * (q1 % (numCols / kc_)),
+                                (j == q2 / (numCols / kc_)) ? q2 % (numCols / kc_) : numCols / kc_ - 1,
+                                dp + (numRows / kr_) * i,
+                                dq + (numCols / kc_) * j,
+                                y + kc_ * i + j
+                        )) return false;
+                    }
 
-        if (!L_.empty()) {
+                }
 
-            // dividing by k_ (as stated in the paper) in not correct,
-            // because it does not use the size of the currently considered submatrix but of its submatrices
-            if ((p1 == 0) && (q1 == 0) && (p2 == (numRows_ /*/ kr_*/ - 1)) && (q2 == (numCols_ /*/ kc_*/ - 1))) {
-                return 1;
             }
 
+        }
+
+        return true;
+
+    }
+
+
+    /* linkInRange() */
+
+    bool linkInRangeInit(size_type p1, size_type p2, size_type q1, size_type q2) const {
+
+        if (numLeaves() != 0) {
+
             size_type p1Prime, p2Prime;
 
             for (auto i = p1 / (numRows_ / kr_); i <= p2 / (numRows_ / kr_); i++) {
@@ -3725,15 +5315,15 @@ private:
 
     }
 
-    bool linkInRange(size_type numRows, size_type numCols, size_type p1, size_type p2, size_type q1, size_type q2, size_type z) {
+    bool linkInRange(size_type numRows, size_type numCols, size_type p1, size_type p2, size_type q1, size_type q2, size_type z) const {
 
         if (z >= T_.size()) {
 
-            return L_[z - T_.size()];
+            return leaf(z - T_.size());
 
         } else {
 
-            if (T_[z]) {
+            if (hasChildren(z)) {
 
                 // dividing by k_ (as stated in the paper) in not correct,
                 // because it does not use the size of the currently considered submatrix but of its submatrices
@@ -3768,26 +5358,428 @@ private:
     }
 
 
+    /* countElementsInRange() */
+
+    size_type countRangeInit(size_type p1, size_type p2, size_type q1, size_type q2) const {
+
+        size_type cnt = 0;
+
+        if (numLeaves() != 0) {
+
+            size_type p1Prime, p2Prime;
+
+            for (size_type i = p1 / (numRows_ / kr_); i <= p2 / (numRows_ / kr_); i++) {
+
+                p1Prime = (i == p1 / (numRows_ / kr_)) * (p1 % (numRows_ / kr_));
+                p2Prime = (i == p2 / (numRows_ / kr_)) ? p2 % (numRows_ / kr_) : (numRows_ / kr_) - 1;
+
+                for (size_type j = q1 / (numCols_ / kc_); j <= q2 / (numCols_ / kc_); j++) {
+                    cnt += countRange(
+                            numRows_ / kr_,
+                            numCols_ / kc_,
+                            p1Prime,
+                            p2Prime,
+                            (j == q1 / (numCols_ / kc_)) * (q1 % (numCols_ / kc_)),
+                            (j == q2 / (numCols_ / kc_)) ? q2 % (numCols_ / kc_) : (numCols_ / kc_) - 1,
+                            kc_ * i + j
+                    );
+                }
+
+            }
+
+        }
+
+        return cnt;
+
+    }
+
+    size_type countRange(size_type numRows, size_type numCols, size_type p1, size_type p2, size_type q1, size_type q2, size_type z) const {
+
+        if (z >= T_.size()) {
+            return leaf(z - T_.size());
+        }
+
+        if (!hasChildren(z)) {
+            return 0;
+        }
+
+        // submatrix completely covered by the range: count all its entries at once
+        if (p1 == 0 && q1 == 0 && p2 == numRows - 1 && q2 == numCols - 1) {
+            return countSubtree(z);
+        }
+
+        size_type y = R_.rank(z + 1) * kr_ * kc_;
+        size_type p1Prime, p2Prime;
+        size_type cnt = 0;
+
+        for (size_type i = p1 / (numRows / kr_); i <= p2 / (numRows / kr_); i++) {
+
+            p1Prime = (i == p1 / (numRows / kr_)) * (p1 % (numRows / kr_));
+            p2Prime = (i == p2 / (numRows / kr_)) ? p2 % (numRows / kr_) : numRows / kr_ - 1;
+
+            for (size_type j = q1 / (numCols / kc_); j <= q2 / (numCols / kc_); j++) {
+                cnt += countRange(
+                        numRows / kr_,
+                        numCols / kc_,
+                        p1Prime,
+                        p2Prime,
+                        (j == q1 / (numCols / kc_)) * (q1 % (numCols / kc_)),
+                        (j == q2 / (numCols / kc_)) ? q2 % (numCols / kc_) : numCols / kc_ - 1,
+                        y + kc_ * i + j
+                );
+            }
+
+        }
+
+        return cnt;
+
+    }
+
+    /* helper methods for counting (countElements() / countElementsInRange()) */
+
+    // returns the number of non-null entries in the leaves below node z (z < T_.size() and T_[z] = 1),
+    // the nodes of a subtree on each level form a contiguous interval, which is mapped to the next level via rank
+    size_type countSubtree(size_type z) const {
+
+        size_type lo = z;
+        size_type hi = z + 1;
+
+        while (lo < hi && lo < T_.size()) {
+
+            lo = (R_.rank(lo) + 1) * kr_ * kc_;
+            hi = (R_.rank(hi) + 1) * kr_ * kc_;
+
+        }
+
+        return (lo < hi) ? countLeaves(lo - T_.size(), hi - T_.size()) : 0;
+
+    }
+
+    // returns the number of non-null entries in L_[from..to)
+    size_type countLeaves(size_type from, size_type to) const {
+
+        if (countSamples_.empty()) {
+
+            size_type cnt = 0;
+            for (size_type x = from; x < to; x++) {
+                cnt += leaf(x);
+            }
+
+            return cnt;
+
+        }
+
+        return countPrefix(to) - countPrefix(from);
+
+    }
+
+    // returns the number of non-null entries in L_[0..x) using the counting index
+    size_type countPrefix(size_type x) const {
+
+        size_type cnt = countSamples_[x / K2TREES_COUNT_SAMPLE_RATE];
+        for (size_type y = (x / K2TREES_COUNT_SAMPLE_RATE) * K2TREES_COUNT_SAMPLE_RATE; y < x; y++) {
+            cnt += leaf(y);
+        }
+
+        return cnt;
+
+    }
+
+    /* helper method for the set operations */
+
+    // determines the result of op level by level, each element of cur represents a node of the result
+    // by the positions of the first children of the corresponding nodes in this and other (none if the subtree is empty)
+    KrKcTree combine(const KrKcTree& other, const SetOperation op) const {
+
+        if ((kr_ != other.kr_) || (kc_ != other.kc_) || (h_ != other.h_)) {
+            throw std::runtime_error("Set operations are only supported between K2Trees with the same arities and height.");
+        }
+
+        const size_type none = size_type(-1);
+
+        std::vector<std::vector<bool>> levels(h_ - 1);
+        std::vector<bool> leaves;
+
+        std::vector<std::pair<size_type, size_type>> cur(1, std::make_pair((numLeaves() != 0) ? 0 : none, (other.numLeaves() != 0) ? 0 : none));
+        std::vector<std::pair<size_type, size_type>> next;
+
+        for (size_type l = 0; l < h_; l++) {
+
+            for (auto& y : cur) {
+
+                for (size_type i = 0; i < kr_ * kc_; i++) {
+
+                    if (l < h_ - 1) {
+
+                        bool a = (y.first != none) && hasChildren(y.first + i);
+                        bool b = (y.second != none) && other.hasChildren(y.second + i);
+                        bool bit = (op == SET_UNION) ? (a || b) : ((op == SET_INTERSECTION) ? (a && b) : a);
+
+                        levels[l].push_back(bit);
+
+                        if (bit) {
+                            next.push_back(std::make_pair(a ? R_.rank(y.first + i + 1) * kr_ * kc_ : none, b ? other.R_.rank(y.second + i + 1) * kr_ * kc_ : none));
+                        }
+
+                    } else {
+
+                        bool a = (y.first != none) && leaf(y.first + i - T_.size());
+                        bool b = (y.second != none) && other.leaf(y.second + i - other.T_.size());
+
+                        leaves.push_back((op == SET_UNION) ? (a || b) : ((op == SET_INTERSECTION) ? (a && b) : (a && !b)));
+
+                    }
+
+                }
+
+            }
+
+            cur.swap(next);
+            next.clear();
+
+        }
+
+        // the intersection / difference of two non-empty subtrees can be empty
+        if (op != SET_UNION) {
+            pruneEmptyBlocks(levels, leaves, kr_ * kc_, false);
+        }
+
+        KrKcTree res;
+        res.h_ = h_;
+        res.kr_ = kr_;
+        res.kc_ = kc_;
+        res.numRows_ = numRows_;
+        res.numCols_ = numCols_;
+        res.null_ = null_;
+
+        size_type total = 0;
+        for (size_type l = 0; l < h_ - 1; l++) {
+            total += levels[l].size();
+        }
+        res.T_ = bit_vector_type(total);
+
+        bit_vector_type::iterator outIter = res.T_.begin();
+        for (size_type l = 0; l < h_ - 1; l++) {
+            outIter = std::move(levels[l].begin(), levels[l].end(), outIter);
+        }
+
+        res.L_ = bit_vector_type(leaves.size());
+        std::move(leaves.begin(), leaves.end(), res.L_.begin());
+        res.R_ = rank_type(&res.T_);
+
+        return res;
+
+    }
+
+    /* helper methods for the boolean matrix product */
+
+    void checkProductArguments(const KrKcTree& other) const {
+
+        if ((kc_ != other.kr_) || (h_ != other.h_)) {
+            throw std::runtime_error("The product is only supported between KrKcTrees with the same height where the column arity of the first equals the row arity of the second.");
+        }
+
+    }
+
+    void productInit(const KrKcTree& other, positions_type& pairs, const size_type numThreads) const {
+
+        std::vector<std::pair<size_type, size_type>> root(1, std::make_pair(0, 0));
+
+        if (h_ == 1) {
+
+            product(other, numRows_, other.numCols_, 0, 0, root, pairs);
+            return;
+
+        }
+
+        // the top-level quadrants of the result are independent of each other
+        std::vector<positions_type> quadrants(kr_ * other.kc_);
+
+        parallelFor(quadrants.size(), numThreads, [&](size_type x) {
+
+            auto terms = productTerms(other, root, x / other.kc_, x % other.kc_);
+
+            if (!terms.empty()) {
+                product(other, numRows_ / kr_, other.numCols_ / other.kc_, (x / other.kc_) * (numRows_ / kr_), (x % other.kc_) * (other.numCols_ / other.kc_), terms, quadrants[x]);
+            }
+
+        });
+
+        for (auto& q : quadrants) {
+            pairs.insert(pairs.end(), q.begin(), q.end());
+        }
+
+    }
+
+    // determines the terms A_pr x B_rq contributing to the child (p,q) of the current node of the result,
+    // every term of the current node is given by the positions of the first children of the corresponding nodes in this and other
+    std::vector<std::pair<size_type, size_type>> productTerms(const KrKcTree& other, const std::vector<std::pair<size_type, size_type>>& terms, size_type p, size_type q) const {
+
+        std::vector<std::pair<size_type, size_type>> res;
+
+        for (auto& y : terms) {
+
+            for (size_type r = 0; r < kc_; r++) {
+
+                size_type za = y.first + p * kc_ + r;
+                size_type zb = y.second + r * other.kc_ + q;
+
+                // empty quadrants do not contribute to the product
+                if (hasChildren(za) && other.hasChildren(zb)) {
+                    res.push_back(std::make_pair(R_.rank(za + 1) * kr_ * kc_, other.R_.rank(zb + 1) * other.kr_ * other.kc_));
+                }
+
+            }
+
+        }
+
+        return res;
+
+    }
+
+    // computes the submatrix of size numRows x numCols of the result whose upper left corner is (p0,q0) from its non-empty terms
+    void product(const KrKcTree& other, size_type numRows, size_type numCols, size_type p0, size_type q0, const std::vector<std::pair<size_type, size_type>>& terms, positions_type& pairs) const {
+
+        if (numRows == kr_) {
+
+            // the children are leaves: multiply the corresponding blocks directly
+            std::vector<bool> block(kr_ * other.kc_, false);
+
+            for (auto& y : terms) {
+                for (size_type p = 0; p < kr_; p++) {
+                    for (size_type r = 0; r < kc_; r++) {
+
+                        if (leaf(y.first + p * kc_ + r - T_.size())) {
+                            for (size_type q = 0; q < other.kc_; q++) {
+                                if (other.leaf(y.second + r * other.kc_ + q - other.T_.size())) {
+                                    block[p * other.kc_ + q] = true;
+                                }
+                            }
+                        }
+
+                    }
+                }
+            }
+
+            for (size_type x = 0; x < block.size(); x++) {
+                if (block[x]) {
+                    pairs.push_back(std::make_pair(p0 + x / other.kc_, q0 + x % other.kc_));
+                }
+            }
+
+        } else {
+
+            for (size_type p = 0; p < kr_; p++) {
+                for (size_type q = 0; q < other.kc_; q++) {
+
+                    auto sub = productTerms(other, terms, p, q);
+
+                    if (!sub.empty()) {
+                        product(other, numRows / kr_, numCols / other.kc_, p0 + p * (numRows / kr_), q0 + q * (numCols / other.kc_), sub, pairs);
+                    }
+
+                }
+            }
+
+        }
+
+    }
+
+    /* helper methods for accessing the (optionally compressed) last level */
+
+    // returns the entry of the last level at position x
+    inline bool leaf(size_type x) const {
+
+        K2TREES_COUNT(leafProbes);
+        return compressedL_.empty() ? L_[x] : compressedL_[x];
+
+    }
+
+    // returns the length of the last level
+    inline size_type numLeaves() const {
+        return compressedL_.empty() ? L_.size() : compressedL_.size();
+    }
+
+    /* helper methods for handling subtrees emptied by setNull() */
+
+    // checks whether node z has children, i.e. whether its bit in T is set and its subtree has not been emptied by setNull()
+    inline bool hasChildren(size_type z) const {
+
+        K2TREES_COUNT(nodesVisited);
+        return T_[z] && (emptyNodes_.empty() || !emptyNodes_[z]);
+
+    }
+
+    // checks whether all len nodes of the block starting at position y are empty
+    bool isEmptyBlock(size_type y, size_type len) const {
+
+        for (size_type c = y; c < y + len; c++) {
+            if ((c >= T_.size()) ? leaf(c - T_.size()) : hasChildren(c)) {
+                return false;
+            }
+        }
+
+        return true;
+
+    }
+
+    // marks the subtree of node z as empty
+    void markEmpty(size_type z) {
+
+        if (emptyNodes_.empty()) {
+            emptyNodes_ = bit_vector_type(T_.size(), 0);
+        }
+
+        emptyNodes_[z] = 1;
+
+    }
+
     /* setNull() */
 
     void setInit(size_type p, size_type q) {
 
-        if (!L_.empty()) {
+        if (numLeaves() != 0) {
             set(numRows_ / kr_, numCols_ / kc_, p % (numRows_ / kr_), q % (numCols_ / kc_), (p / (numRows_ / kr_)) * kc_ + q / (numCols_ / kc_));
         }
 
     }
 
-    void set(size_type numRows, size_type numCols, size_type p, size_type q, size_type z) {
+    // clears the entry in the subtree of z, returns true iff the subtree is empty afterwards
+    bool set(size_type numRows, size_type numCols, size_type p, size_type q, size_type z) {
 
         if (z >= T_.size()) {
+
+            // keep the counting index up to date
+            if (!countSamples_.empty() && leaf(z - T_.size())) {
+                for (size_type s = (z - T_.size()) / K2TREES_COUNT_SAMPLE_RATE + 1; s < countSamples_.size(); s++) {
+                    countSamples_[s]--;
+                }
+            }
+
             L_[z - T_.size()] = null_;
+
+            return true;
+
         } else {
 
-            if (T_[z]) {
-                set(numRows / kr_, numCols / kc_, p % (numRows / kr_), q % (numCols / kc_), R_.rank(z + 1) * kr_ * kc_ + (p / (numRows / kr_)) * kc_ + q / (numCols / kc_));
+            if (hasChildren(z)) {
+
+                size_type y = R_.rank(z + 1) * kr_ * kc_;
+
+                // mark z if its whole subtree has become empty
+                if (set(numRows / kr_, numCols / kc_, p % (numRows / kr_), q % (numCols / kc_), y + (p / (numRows / kr_)) * kc_ + q / (numCols / kc_)) && isEmptyBlock(y, kr_ * kc_)) {
+
+                    markEmpty(z);
+                    return true;
+
+                }
+
+                return false;
+
             }
 
+            return true;
+
         }
 
     }
@@ -46,6 +46,15 @@ public:
     typedef typename K2Tree<elem_type>::positions_type positions_type;
     typedef typename K2Tree<elem_type>::pairs_type pairs_type;
 
+    // output-buffer and limited variants of the query methods (see K2Tree)
+    using K2Tree<elem_type>::getSuccessorPositions;
+    using K2Tree<elem_type>::getPredecessorPositions;
+    using K2Tree<elem_type>::getPositionsInRange;
+    using K2Tree<elem_type>::getAllValuedPositions;
+    using K2Tree<elem_type>::getSuccessors;
+    using K2Tree<elem_type>::getRange;
+    using K2Tree<elem_type>::expandFrontier;
+
 
     BasicK2Tree() {
         // nothing to do
@@ -60,7 +69,13 @@ public:
 
         T_ = other.T_;
         L_ = other.L_;
+        compressedL_ = other.compressedL_;
         R_ = rank_type(&T_);
+        emptyNodes_ = other.emptyNodes_;
+        countSamples_ = other.countSamples_;
+        topNodes_ = other.topNodes_;
+        tableH_ = other.tableH_;
+        tableN_ = other.tableN_;
 
     }
 
@@ -78,7 +93,13 @@ public:
 
         T_ = other.T_;
         L_ = other.L_;
+        compressedL_ = other.compressedL_;
         R_ = rank_type(&T_);
+        emptyNodes_ = other.emptyNodes_;
+        countSamples_ = other.countSamples_;
+        topNodes_ = other.topNodes_;
+        tableH_ = other.tableH_;
+        tableN_ = other.tableN_;
 
         return *this;
 
@@ -202,9 +223,57 @@ public:
     }
 
     /**
-     * List-of-pairs-based constructor (based on section 3.3.5. of Brisaboa et al.)
+     * Streaming constructor that consumes the relation pairs provided by reader one after another and, apart from
+     * the resulting data structure, only keeps the path of the current submatrix (height times k*k entries) in memory.
+     *
+     * The pairs have to be sorted in the order in which the (depth-first) construction visits them, i.e. by their k x k
+     * submatrix on the first level (in row-major order), then by their submatrix on the second level and so on
+     * (within the k x k submatrices of the last level, this is plain row-major order).
+     * The represented matrix has size n x n, where n is the smallest power of k that is not smaller than numRows and numCols.
+     * Throws a std::runtime_error if a pair lies outside of this matrix, is out of order or occurs more than once.
+     */
+    BasicK2Tree(PairReader<elem_type>& reader, const size_type numRows, const size_type numCols, const size_type k, const elem_type null = elem_type()) {
+
+        null_ = null;
+
+        k_ = k;
+        h_ = std::max((size_type)1, logK(std::max(numRows, numCols), k_));
+        nPrime_ = size_type(pow(k_, h_));
+
+        std::vector<std::vector<bool>> levels(h_ - 1);
+        buildFromStream(reader, levels, nPrime_, 1, 0, 0);
+
+        if (reader.hasNext()) {
+            throw std::runtime_error("Pair no. " + std::to_string(reader.getConsumed() + 1) + " at (" + std::to_string(reader.peek().row) + ", " + std::to_string(reader.peek().col) + ") is out of order, outside of the matrix or a duplicate.");
+        }
+
+        size_type total = 0;
+        for (size_type l = 0; l < h_ - 1; l++) {
+            total += levels[l].size();
+        }
+        T_ = bit_vector_type(total);
+
+        bit_vector_type::iterator outIter = T_.begin();
+        for (size_type l = 0; l < h_ - 1; l++) {
+
+            outIter = std::move(levels[l].begin(), levels[l].end(), outIter);
+            levels[l].clear();
+            levels[l].shrink_to_fit();
+
+        }
+
+        R_ = rank_type(&T_);
+
+    }
+
+    /**
+     * List-of-pairs-based constructor
+     *
+     * The mixed-radix keys of the pairs are radix-sorted once and the levels are emitted in a single sweep over them
+     * (see buildLevelsFromSortedKeys()) using up to numThreads threads. If the keys do not fit into 64 bits, the tree is built
+     * level by level as in section 3.3.5. of Brisaboa et al., the subproblems of each level are processed by up to numThreads threads.
      */
-    BasicK2Tree(pairs_type& pairs, const size_type k, const elem_type null = elem_type()) {
+    BasicK2Tree(pairs_type& pairs, const size_type k, const elem_type null = elem_type(), const size_type numThreads = 1) {
 
         null_ = null;
 
@@ -218,7 +287,7 @@ public:
         nPrime_ = size_type(pow(k_, h_));
 
         if (pairs.size() != 0) {
-            buildFromListsInplace(pairs);
+            buildFromSortedKeys(pairs, numThreads);
         }
 
         R_ = rank_type(&T_);
@@ -227,37 +296,47 @@ public:
 
 
     // returns the height of the K2Tree
-    size_type getH() {
+    size_type getH() const {
         return h_;
     }
 
     // returns the arity of the K2Tree
-    size_type getK() {
+    size_type getK() const {
         return k_;
     }
 
-    size_type getNumRows() override {
+    size_type getNumRows() const override {
         return nPrime_;
     }
 
-    size_type getNumCols() override {
+    size_type getNumCols() const override {
         return nPrime_;
     }
 
-    elem_type getNull() override {
+    elem_type getNull() const override {
         return null_;
     }
 
 
-    bool isNotNull(size_type i, size_type j) override {
+    bool isNotNull(size_type i, size_type j) const override {
         return checkInit(i, j);
     }
 
-    elem_type getElement(size_type i, size_type j) override {
+    elem_type getElement(size_type i, size_type j) const override {
         return getInit(i, j);
     }
 
-    std::vector<elem_type> getSuccessorElements(size_type i) override {
+    void isNotNull(const positions_type& queries, std::vector<bool>& out) const override {
+        out.assign(queries.size(), false);
+        batchInit(queries, [&](size_type x, size_type pos) { out[x] = (leaf(pos) != null_); });
+    }
+
+    void getElement(const positions_type& queries, std::vector<elem_type>& out) const override {
+        out.assign(queries.size(), null_);
+        batchInit(queries, [&](size_type x, size_type pos) { out[x] = leaf(pos); });
+    }
+
+    std::vector<elem_type> getSuccessorElements(size_type i) const override {
 
         std::vector<elem_type> succs;
         allSuccessorElementsIterative(succs, i);
@@ -267,7 +346,7 @@ public:
 
     }
 
-    std::vector<size_type> getSuccessorPositions(size_type i) override {
+    std::vector<size_type> getSuccessorPositions(size_type i) const override {
 
         std::vector<size_type> succs;
 //        successorsPosInit(succs, i);
@@ -277,7 +356,7 @@ public:
 
     }
 
-    pairs_type getSuccessorValuedPositions(size_type i) override {
+    pairs_type getSuccessorValuedPositions(size_type i) const override {
 
         pairs_type succs;
         allSuccessorValuedPositionsIterative(succs, i);
@@ -287,7 +366,7 @@ public:
 
     }
 
-    std::vector<elem_type> getPredecessorElements(size_type j) override {
+    std::vector<elem_type> getPredecessorElements(size_type j) const override {
 
         std::vector<elem_type> preds;
         predecessorsElemInit(preds, j);
@@ -296,7 +375,7 @@ public:
 
     }
 
-    std::vector<size_type> getPredecessorPositions(size_type j) override {
+    std::vector<size_type> getPredecessorPositions(size_type j) const override {
 
         std::vector<size_type> preds;
         predecessorsPosInit(preds, j);
@@ -305,7 +384,7 @@ public:
 
     }
 
-    pairs_type getPredecessorValuedPositions(size_type j) override {
+    pairs_type getPredecessorValuedPositions(size_type j) const override {
 
         pairs_type preds;
         predecessorsValPosInit(preds, j);
@@ -314,7 +393,7 @@ public:
 
     }
 
-    std::vector<elem_type> getElementsInRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    std::vector<elem_type> getElementsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
 
         std::vector<elem_type> elements;
         rangeElemInit(elements, i1, i2, j1, j2);
@@ -324,7 +403,7 @@ public:
 
     }
 
-    positions_type getPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    positions_type getPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
 
         positions_type pairs;
         rangePosInit(pairs, i1, i2, j1, j2);
@@ -334,7 +413,7 @@ public:
 
     }
 
-    pairs_type getValuedPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    pairs_type getValuedPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
 
         pairs_type pairs;
         rangeValPosInit(pairs, i1, i2, j1, j2);
@@ -344,40 +423,170 @@ public:
 
     }
 
-    std::vector<elem_type> getAllElements() override {
+    std::vector<elem_type> getAllElements() const override {
         return getElementsInRange(0, nPrime_ - 1, 0, nPrime_ - 1);
     }
 
-    positions_type getAllPositions() override {
+    positions_type getAllPositions() const override {
         return getPositionsInRange(0, nPrime_ - 1, 0, nPrime_ - 1);
     }
 
-    pairs_type getAllValuedPositions() override {
+    pairs_type getAllValuedPositions() const override {
         return getValuedPositionsInRange(0, nPrime_ - 1, 0, nPrime_ - 1);
     }
 
-    bool containsElement(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    bool forEachSuccessorPosition(size_type i, const std::function<bool(size_type)>& visitor) const override {
+        return successorsVisitInit(visitor, i);
+    }
+
+    bool forEachPredecessorPosition(size_type j, const std::function<bool(size_type)>& visitor) const override {
+        return predecessorsVisitInit(visitor, j);
+    }
+
+    bool forEachValuedPositionInRange(size_type i1, size_type i2, size_type j1, size_type j2, const std::function<bool(size_type, size_type, elem_type)>& visitor) const override {
+        return rangeValVisitInit(visitor, i1, i2, j1, j2);
+    }
+
+    bool containsElement(size_type i1, size_type i2, size_type j1, size_type j2) const override {
         return elemInRangeInit(i1, i2, j1, j2);
 //        return elemInRangeInit(i1, std::min(i2, nPrime_ - 1), j1, std::min(j2, nPrime_ - 1));
     }
 
-    size_type countElements() override {
+    size_type countElements() const override {
+
+        if (!countSamples_.empty()) {
+            return countSamples_.back();
+        }
 
         size_type cnt = 0;
-        for (size_type i = 0; i < L_.size(); i++) {
-            cnt += (L_[i] != null_);
+        for (size_type i = 0; i < numLeaves(); i++) {
+            cnt += (leaf(i) != null_);
         }
 
         return cnt;
 
     }
 
+    size_type countElementsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
+        return countRangeInit(i1, i2, j1, j2);
+    }
+
+    // builds the (optional) counting index, a sampled prefix sum over the non-null entries of L,
+    // which makes countElements() constant-time and speeds up counting fully covered submatrices in countElementsInRange()
+    // (the index is kept up to date by setNull(), but it is not written by serialize())
+    void buildCountingIndex() {
+
+        this->checkWritable("buildCountingIndex");
+
+        size_type numSamples = numLeaves() / K2TREES_COUNT_SAMPLE_RATE + 1;
+        countSamples_.assign(numSamples + 1, 0);
+
+        size_type cnt = 0;
+        for (size_type s = 0; s < numSamples; s++) {
+
+            countSamples_[s] = cnt;
+            for (size_type x = s * K2TREES_COUNT_SAMPLE_RATE; x < std::min((s + 1) * K2TREES_COUNT_SAMPLE_RATE, numLeaves()); x++) {
+                cnt += (leaf(x) != null_);
+            }
+
+        }
+
+        countSamples_[numSamples] = cnt;
+
+    }
+
+    bool hasCountingIndex() const {
+        return !countSamples_.empty();
+    }
+
+    // builds a direct lookup table for the nodes of the upper levels levels of the K2Tree (k^(2 * levels) entries, at most getMaxLookupTableLevels() levels),
+    // so that point queries start their descent at the corresponding node and skip the accesses to T on these levels
+    // (like the counting index, the table is not written by serialize())
+    void buildLookupTable(size_type levels) {
+
+        this->checkWritable("buildLookupTable");
+
+        size_type maxLevels = getMaxLookupTableLevels();
+        if ((levels == 0) || (levels > maxLevels)) {
+            throw std::runtime_error("Number of levels for the lookup table has to be between 1 and " + std::to_string(maxLevels) + " (see getMaxLookupTableLevels()).");
+        }
+
+        size_type width = size_type(pow(k_, levels));
+        size_type n = nPrime_ / width;
+        topNodes_.assign(width * width, 0);
+
+        for (size_type r = 0; r < width; r++) {
+            for (size_type c = 0; c < width; c++) {
+
+                // descend to the node covering submatrix (r, c) or stop at its closest (empty) ancestor
+                size_type p = r * n;
+                size_type q = c * n;
+                size_type m = nPrime_ / k_;
+                size_type z = (p / m) * k_ + q / m;
+                for (size_type l = 1; (l < levels) && (z < T_.size()) && T_[z]; l++) {
+
+                    p %= m;
+                    q %= m;
+                    m /= k_;
+                    z = R_.rank(z + 1) * k_ * k_ + (p / m) * k_ + q / m;
+
+                }
+
+                topNodes_[r * width + c] = z;
+
+            }
+        }
+
+        tableH_ = levels;
+        tableN_ = n;
+
+    }
+
+    bool hasLookupTable() const {
+        return !topNodes_.empty();
+    }
+
+    // returns the largest number of levels accepted by buildLookupTable() (at most the height): the table may take at most
+    // K2TREES_LOOKUP_TABLE_MAX_RATIO times the space of T and its rank data structure, only the table of the first level is always permitted
+    size_type getMaxLookupTableLevels() const {
+
+        double budget = K2TREES_LOOKUP_TABLE_MAX_RATIO * (sdsl::size_in_bytes(T_) + sdsl::size_in_bytes(R_)) / sizeof(size_type); // in entries
+
+        size_type levels = std::min((size_type) 1, h_);
+        while ((levels < h_) && (pow(k_, 2 * (levels + 1)) <= budget)) {
+            levels++;
+        }
+
+        return levels;
+
+    }
+
+    // replaces the last level L by a dictionary of its distinct k*k blocks (sorted by decreasing frequency)
+    // and the DAC-encoded dictionary index of every leaf block, which saves space when few distinct blocks
+    // (e.g. few distinct weights) make up most of L; afterwards, setNull() is no longer supported
+    void compressLeaves() {
+
+        this->checkWritable("compressLeaves");
+
+        if (L_.empty()) {
+            return;
+        }
+
+        compressedL_ = LeafDictionary<elem_type>(L_, k_ * k_);
+        L_ = std::vector<elem_type>(0);
+
+    }
+
+    bool hasCompressedLeaves() const {
+        return !compressedL_.empty();
+    }
+
 
     BasicK2Tree* clone() const override {
         return new BasicK2Tree<elem_type>(*this);
     }
 
-    void print(bool all = false) override {
+    void print(bool all = false) const override {
 
         std::cout << "### Parameters ###" << std::endl;
         std::cout << "h  = " << h_ << std::endl;
@@ -392,7 +601,7 @@ public:
             std::cout << std::endl << std::endl;
 
             std::cout << "### L ###" << std::endl;
-            for (size_type i = 0; i < L_.size(); i++) std::cout << L_[i];
+            for (size_type i = 0; i < numLeaves(); i++) std::cout << leaf(i);
             std::cout << std::endl << std::endl;
 
             std::cout << "### R ###" << std::endl;
@@ -403,42 +612,178 @@ public:
 
     }
 
-    // note: can "invalidate" the data structure (containsLink() probably won't work correctly afterwards)
+    void serialize(std::ostream& out) const override {
+
+        writeHeader(out, "BasicK2Tree", sizeof(elem_type));
+
+        writeValue(out, h_);
+        writeValue(out, k_);
+        writeValue(out, nPrime_);
+        writeValue(out, null_);
+
+        T_.serialize(out);
+        writeVector(out, L_);
+        compressedL_.serialize(out);
+        R_.serialize(out);
+        emptyNodes_.serialize(out);
+
+    }
+
+    void load(std::istream& in) override {
+
+        this->checkWritable("load");
+
+        unsigned int version = readHeader(in, "BasicK2Tree", sizeof(elem_type));
+
+        readValue(in, h_);
+        readValue(in, k_);
+        readValue(in, nPrime_);
+        readValue(in, null_);
+
+        T_.load(in);
+        readVector(in, L_);
+        if (version >= 2) {
+            compressedL_.load(in);
+        } else {
+            compressedL_ = LeafDictionary<elem_type>();
+        }
+        R_.load(in, &T_);
+        if (version >= 4) {
+            emptyNodes_.load(in);
+        } else {
+            emptyNodes_ = bit_vector_type();
+        }
+
+        countSamples_.clear();
+        topNodes_.clear();
+        tableH_ = 0;
+        tableN_ = 0;
+
+    }
+
+    // note: emptied subtrees are only marked, compact() removes them from the internal structure
     void setNull(size_type i, size_type j) override {
+
+        this->checkWritable("setNull");
+
+        if (!compressedL_.empty()) {
+            throw std::runtime_error("setNull() is not supported after compressLeaves().");
+        }
+
         setInit(i, j);
     }
 
-    size_type getFirstSuccessor(size_type i) override {
+    // rebuilds the internal structure from the remaining elements, so that the subtrees emptied by setNull() are removed
+    // (the size of the relation matrix remains unchanged, the counting index and the lookup table are rebuilt if present)
+    void compact() override {
+
+        this->checkWritable("compact");
+
+        if (emptyNodes_.empty()) {
+            return;
+        }
+
+        pairs_type pairs = getAllValuedPositions();
+
+        T_ = bit_vector_type();
+        L_.clear();
+        emptyNodes_ = bit_vector_type();
+
+        if (!pairs.empty()) {
+            buildFromListsInplace(pairs, 1);
+        }
+
+        R_ = rank_type(&T_);
+
+        if (!countSamples_.empty()) {
+            buildCountingIndex();
+        }
+
+        if (!topNodes_.empty()) {
+            buildLookupTable(std::min(tableH_, getMaxLookupTableLevels()));
+        }
+
+    }
+
+    SizeBreakdown sizeInBytes() const override {
+
+        SizeBreakdown s;
+        s.T = sdsl::size_in_bytes(T_);
+        s.L = vectorBytes(L_) + compressedL_.sizeInBytes();
+        s.rank = sdsl::size_in_bytes(R_);
+        s.aux = sdsl::size_in_bytes(emptyNodes_) + vectorBytes(countSamples_) + vectorBytes(topNodes_);
+        s.other = sizeof(*this);
+
+        return s;
+
+    }
+
+    size_type getFirstSuccessor(size_type i) const override {
 //        return firstSuccessorInit(i);
         return firstSuccessorPositionIterative(i);
     }
 
+    std::vector<size_type> expandFrontier(const std::vector<size_type>& frontier, std::vector<bool>& visited) const override {
+
+        auto rows = this->prepareFrontier(frontier, visited);
+        std::vector<size_type> cols;
+
+        if ((numLeaves() != 0) && !rows.empty()) {
+            frontierPos(cols, visited, nPrime_, 0, 0, rows.cbegin(), rows.cend(), 0);
+        }
+
+        this->finishFrontier(cols, visited);
+
+        return cols;
+
+    }
+
+    /*
+     * Set operations (traverse both K2Trees level by level at the same time without decompressing them,
+     * only supported between K2Trees with the same arities and height)
+     */
+
+    // returns a K2Tree representing the union of both relations (for pairs contained in both, the value of this K2Tree is used)
+    BasicK2Tree getUnion(const BasicK2Tree& other) const {
+        return combine(other, SET_UNION);
+    }
+
+    // returns a K2Tree representing the pairs of this K2Tree that are also contained in other
+    BasicK2Tree getIntersection(const BasicK2Tree& other) const {
+        return combine(other, SET_INTERSECTION);
+    }
+
+    // returns a K2Tree representing the pairs of this K2Tree that are not contained in other
+    BasicK2Tree getDifference(const BasicK2Tree& other) const {
+        return combine(other, SET_DIFFERENCE);
+    }
+
 
     /*
      * Method aliases using "relation nomenclature" (similar to the names proposed by Brisaboa et al.)
      */
 
-    bool areRelated(size_type i, size_type j) override {
+    bool areRelated(size_type i, size_type j) const override {
         return isNotNull(i, j);
     }
 
-    std::vector<size_type> getSuccessors(size_type i) override {
+    std::vector<size_type> getSuccessors(size_type i) const override {
         return getSuccessorPositions(i);
     }
 
-    std::vector<size_type> getPredecessors(size_type j) override {
+    std::vector<size_type> getPredecessors(size_type j) const override {
         return getPredecessorPositions(j);
     }
 
-    positions_type getRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    positions_type getRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
         return getPositionsInRange(i1, i2, j1, j2);
     }
 
-    bool containsLink(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    bool containsLink(size_type i1, size_type i2, size_type j1, size_type j2) const override {
         return containsElement(i1, i2, j1, j2);
     }
 
-    size_type countLinks() override {
+    size_type countLinks() const override {
         return countElements();
     }
 
@@ -446,14 +791,29 @@ public:
 
 private:
     // representation of all but the last levels of the K2Tree (internal structure)
-    bit_vector_type T_;
+    level_vector_type T_;
 
     // representation of the last level of the K2Tree (actual values of the relation)
     std::vector<elem_type> L_;
 
+    // (optional) compressed representation of the last level, replaces L_ after compressLeaves()
+    LeafDictionary<elem_type> compressedL_;
+
     // rank data structure for navigation in T_
     rank_type R_;
 
+    // marks the internal nodes whose subtrees have been emptied by setNull() (empty if there are none), see compact()
+    bit_vector_type emptyNodes_;
+
+    // (optional) counting index: number of non-null entries in L_[0..s * K2TREES_COUNT_SAMPLE_RATE) for all samples s, followed by the total number
+    std::vector<size_type> countSamples_;
+
+    // (optional) lookup table: node on level tableH_ covering submatrix (r, c) of edge length tableN_ (or its closest empty ancestor)
+    // at position r * (nPrime_ / tableN_) + c
+    std::vector<size_type> topNodes_;
+    size_type tableH_ = 0;
+    size_type tableN_ = 0;
+
     size_type h_; // height of the K2Tree
     size_type k_; // arity of the K2Tree
     size_type nPrime_; // edge length of the represented relation matrix
@@ -556,6 +916,69 @@ private:
 
     }
 
+    /* helper method for streaming construction */
+
+    bool buildFromStream(PairReader<elem_type>& reader, std::vector<std::vector<bool>>& levels, size_type n, size_type l, size_type p, size_type q) {
+
+        // as the pairs are sorted, the submatrix is empty if the next pair does not lie within it
+        if (!reader.hasNext()) {
+            return false;
+        }
+
+        auto& rec = reader.peek();
+        if (!((rec.row >= p) && (rec.row < p + n) && (rec.col >= q) && (rec.col < q + n))) {
+            return false;
+        }
+
+        if (l == h_) {
+
+            std::vector<elem_type> C(k_ * k_, null_);
+
+            for (size_type i = 0; i < k_; i++) {
+                for (size_type j = 0; j < k_; j++) {
+
+                    if (reader.hasNext() && (reader.peek().row == p + i) && (reader.peek().col == q + j)) {
+
+                        C[i * k_ + j] = reader.peek().val;
+                        reader.next();
+
+                    }
+
+                }
+            }
+
+            if (isAll(C, null_)) {
+                return false;
+            } else {
+
+                L_.insert(L_.end(), C.begin(), C.end());
+                return true;
+
+            }
+
+        } else {
+
+            std::vector<bool> C(k_ * k_);
+
+            for (size_type i = 0; i < k_; i++) {
+                for (size_type j = 0; j < k_; j++) {
+                    C[i * k_ + j] = buildFromStream(reader, levels, n / k_, l + 1, p + i * (n / k_), q + j * (n / k_));
+                }
+            }
+
+            if (isAllZero(C)) {
+                return false;
+            } else {
+
+                levels[l - 1].insert(levels[l - 1].end(), C.begin(), C.end());
+                return true;
+
+            }
+
+        }
+
+    }
+
     /* helper methods for construction from relation lists via temporary tree */
 
     void buildFromListsViaTree(const std::vector<list_type>& lists) {// 3.3.3, so far without special bit vectors without initialisation
@@ -656,17 +1079,21 @@ private:
 
         } else {
 
-            std::vector<bool> T;
-            NaiveDynamicRank R;
+            DynamicVector<bool> T;
+            DynamicVector<elem_type> L;
+            DynamicRank R;
 
             for (size_type i = 0; i < lists.size(); i++) {
                 for (size_type j = 0; j < lists[i].size(); j++) {
-                    insertInit(T, R, i, lists[i][j].first, lists[i][j].second);
+                    insertInit(T, L, R, i, lists[i][j].first, lists[i][j].second);
                 }
             }
 
+            L_ = std::vector<elem_type>(L.size());
+            L.copyTo(L_.begin());
+
             T_ = bit_vector_type(T.size());
-            std::move(T.begin(), T.end(), T_.begin());
+            T.copyTo(T_.begin());
 
         }
 
@@ -674,20 +1101,20 @@ private:
 
     }
 
-    void insertInit(std::vector<bool>& T, NaiveDynamicRank& R, size_type p, size_type q, elem_type val) {
+    void insertInit(DynamicVector<bool>& T, DynamicVector<elem_type>& L, DynamicRank& R, size_type p, size_type q, elem_type val) {
 
         if (T.empty()) {
 
-            T = std::vector<bool>(k_ * k_);
-            R = NaiveDynamicRank(T);
+            T = DynamicVector<bool>(k_ * k_, false);
+            R = DynamicRank(std::vector<bool>(k_ * k_));
 
         }
 
-        insert(T, R, nPrime_ / k_, p % (nPrime_ / k_), q % (nPrime_ / k_), val, (p / (nPrime_ / k_)) * k_ + q / (nPrime_ / k_), 1);
+        insert(T, L, R, nPrime_ / k_, p % (nPrime_ / k_), q % (nPrime_ / k_), val, (p / (nPrime_ / k_)) * k_ + q / (nPrime_ / k_), 1);
 
     }
 
-    void insert(std::vector<bool>& T, NaiveDynamicRank& R, size_type n, size_type p, size_type q, elem_type val, size_type z, size_type l) {
+    void insert(DynamicVector<bool>& T, DynamicVector<elem_type>& L, DynamicRank& R, size_type n, size_type p, size_type q, elem_type val, size_type z, size_type l) {
 
         if (!T[z]) {
 
@@ -698,15 +1125,15 @@ private:
 
             if ((l + 1) == h_) {
 
-                L_.insert(L_.begin() + R.rank(z + 1) * k_ * k_ - T.size(), k_ * k_, null_);
-                L_[y - T.size()] = val;
+                L.insert(R.rank(z + 1) * k_ * k_ - T.size(), k_ * k_, null_);
+                L[y - T.size()] = val;
 
             } else {
 
-                T.insert(T.begin() + R.rank(z + 1) * k_ * k_, k_ * k_, 0);
+                T.insert(R.rank(z + 1) * k_ * k_, k_ * k_, 0);
                 R.insert(R.rank(z + 1) * k_ * k_ + 1, k_ * k_);
 
-                insert(T, R, n / k_, p % (n / k_), q % (n / k_), val, y, l + 1);
+                insert(T, L, R, n / k_, p % (n / k_), q % (n / k_), val, y, l + 1);
 
             }
 
@@ -715,114 +1142,92 @@ private:
             size_type y = R.rank(z + 1) * k_ * k_ + (p / (n / k_)) * k_ + q / (n / k_);
 
             if ((l + 1) == h_) {
-                L_[y - T.size()] = val;
+                L[y - T.size()] = val;
             } else {
-                insert(T, R, n / k_, p % (n / k_), q % (n / k_), val, y, l + 1);
+                insert(T, L, R, n / k_, p % (n / k_), q % (n / k_), val, y, l + 1);
             }
 
         }
 
     }
 
-    /* helper methods for inplace construction from single list of pairs */
-
-    size_type computeKey(const typename pairs_type::value_type& pair, const Subproblem& sp, size_type width) {
-        return ((pair.row - sp.firstRow) / width) * k_ + (pair.col - sp.firstCol) / width;
-    }
-
-    void countingSort(pairs_type& pairs, std::vector<std::pair<size_type, size_type>>& intervals, const Subproblem& sp, size_type width, size_type sup) {
-
-        std::vector<size_type> counts(sup);
-
-        // determine key frequencies
-        for (size_type i = sp.left; i < sp.right; i++) {
-            counts[computeKey(pairs[i], sp, width)]++;
-        }
+    /* helper method for construction from the radix-sorted keys of a single list of pairs */
 
-        // determine starting index for each key
-        size_type total = 0;
-        size_type tmp;
+    void buildFromSortedKeys(pairs_type& pairs, const size_type numThreads) {
 
-        for (size_type key = 0; key < sup; key++) {
+        std::vector<size_type> ks(h_, k_);
 
-            tmp = counts[key];
-            counts[key] = total;
-            total += tmp;
+        std::vector<bool> T;
+        if (!buildLevelsFromSortedKeys(pairs, ks, ks, null_, T, L_, numThreads)) {
 
-            intervals[key].first = counts[key];
-            intervals[key].second = total;
+            buildFromListsInplace(pairs, numThreads); // the keys do not fit into 64 bits
+            return;
 
         }
 
-        // reorder pairs of current subproblem
-        pairs_type tmpPairs(sp.right - sp.left + 1);
-        for (size_type i = sp.left; i < sp.right; i++) {
+        T_ = bit_vector_type(T.size());
+        std::move(T.begin(), T.end(), T_.begin());
 
-            tmpPairs[counts[computeKey(pairs[i], sp, width)]] = pairs[i];
-            counts[computeKey(pairs[i], sp, width)]++;
+    }
 
-        }
+    /* helper methods for inplace construction from single list of pairs */
 
-        for (size_type i = sp.left; i < sp.right; i++) {
-            pairs[i] = tmpPairs[i - sp.left];
-        }
+    size_type computeKey(const typename pairs_type::value_type& pair, const Subproblem& sp, size_type width) {
+        return ((pair.row - sp.firstRow) / width) * k_ + (pair.col - sp.firstCol) / width;
+    }
 
+    void countingSort(pairs_type& pairs, LevelBuildState<pairs_type, elem_type>& state, const Subproblem& sp, size_type width, size_type sup, size_type numThreads) {
+        countingSortByKey(pairs, sp.left, sp.right, sup, [&](const typename pairs_type::value_type& pair) { return computeKey(pair, sp, width); }, state.intervals, state.counts, state.tmpPairs, numThreads);
     }
 
-    void buildFromListsInplace(pairs_type& pairs) {// 3.3.5
+    void buildFromListsInplace(pairs_type& pairs, const size_type numThreads) {// 3.3.5 (level by level, the subproblems of each level are distributed among the threads)
 
-        std::queue<Subproblem> queue;
-        Subproblem sp;
-        size_type S;
-        std::vector<std::pair<size_type, size_type>> intervals(k_ * k_);
+        std::vector<Subproblem> level(1, Subproblem(0, nPrime_ - 1, 0, nPrime_ - 1, 0, pairs.size()));
+        std::vector<LevelBuildState<pairs_type, elem_type>> states(std::max(numThreads, (size_type) 1));
         std::vector<bool> T;
-        std::vector<elem_type> appToL;
-
-        queue.push(Subproblem(0, nPrime_ - 1, 0, nPrime_ - 1, 0, pairs.size()));
+        size_type S = nPrime_;
 
-        while (!queue.empty()) {
-
-            sp = queue.front();
-            queue.pop();
-
-            S = sp.lastRow - sp.firstRow + 1;
+        auto process = [&](LevelBuildState<pairs_type, elem_type>& state, const Subproblem& sp, size_type sortThreads) {
 
             if (S > k_) {
 
-                countingSort(pairs, intervals, sp, S / k_, k_ * k_);
+                countingSort(pairs, state, sp, S / k_, k_ * k_, sortThreads);
 
                 for (size_type i = 0; i < k_ * k_; i++) {
 
-                    if (intervals[i].first < intervals[i].second) {
+                    if (state.intervals[i].first < state.intervals[i].second) {
 
-                        T.push_back(true);
-                        queue.push(Subproblem(
+                        state.T.push_back(true);
+                        state.next.push_back(Subproblem(
                                 sp.firstRow + (i / k_) * (S / k_),
                                 sp.firstRow + (i / k_ + 1) * (S / k_) - 1,
                                 sp.firstCol + (i % k_) * (S / k_),
                                 sp.firstCol + (i % k_ + 1) * (S / k_) - 1,
-                                sp.left + intervals[i].first,
-                                sp.left + intervals[i].second
+                                sp.left + state.intervals[i].first,
+                                sp.left + state.intervals[i].second
                         ));
 
                     } else {
-                        T.push_back(false);
+                        state.T.push_back(false);
                     }
 
                 }
 
             } else {
 
-                appToL = std::vector<elem_type>(k_ * k_);
+                size_type offset = state.L.size();
+                state.L.resize(offset + k_ * k_, null_);
 
                 for (size_type i = sp.left; i < sp.right; i++) {
-                    appToL[(pairs[i].row - sp.firstRow) * k_ + (pairs[i].col - sp.firstCol)] = pairs[i].val;
+                    state.L[offset + (pairs[i].row - sp.firstRow) * k_ + (pairs[i].col - sp.firstCol)] = pairs[i].val;
                 }
 
-                L_.insert(L_.end(), appToL.begin(), appToL.end());
-
             }
 
+        };
+
+        for (; !level.empty(); S /= k_) {
+            processLevel(level, states, numThreads, T, L_, process);
         }
 
         T_ = bit_vector_type(T.size());
@@ -832,34 +1237,189 @@ private:
 
 
 
-    /* isNotNull() */
+    /* helper methods for accessing the (optionally compressed) last level */
+
+    // returns the entry of the last level at position x
+    inline elem_type leaf(size_type x) const {
+
+        K2TREES_COUNT(leafProbes);
+        return compressedL_.empty() ? L_[x] : compressedL_[x];
 
-    bool checkInit(size_type p, size_type q) {
-        return (L_.empty()) ? false : check(nPrime_ / k_, p % (nPrime_ / k_), q % (nPrime_ / k_), (p / (nPrime_ / k_)) * k_ + q / (nPrime_ / k_));
     }
 
-    bool check(size_type n, size_type p, size_type q, size_type z) {
+    // returns the length of the last level
+    inline size_type numLeaves() const {
+        return compressedL_.empty() ? L_.size() : compressedL_.size();
+    }
 
-        if (z >= T_.size()) {
-            return (L_[z - T_.size()] != null_);
-        } else {
-            return T_[z] ? check(n / k_, p % (n / k_), q % (n / k_), R_.rank(z + 1) * k_ * k_ + (p / (n / k_)) * k_ + q / (n / k_)) : false;
+    /* isNotNull() */
+
+    bool checkInit(size_type p, size_type q) const {
+
+        size_type x;
+        if (fixedArityLeafPosition(p, q, x)) {
+            return (x < numLeaves()) && (leaf(x) != null_);
         }
 
-    }
+        if (tableH_ != 0) {
+            return (numLeaves() == 0) ? false : check(tableN_, p % tableN_, q % tableN_, topNodes_[(p / tableN_) * (nPrime_ / tableN_) + q / tableN_]);
+        }
 
-    /* getElement() */
+        return (numLeaves() == 0) ? false : check(nPrime_ / k_, p % (nPrime_ / k_), q % (nPrime_ / k_), (p / (nPrime_ / k_)) * k_ + q / (nPrime_ / k_));
 
-    elem_type getInit(size_type p, size_type q) {
-        return (L_.empty()) ? null_ : get(nPrime_ / k_, p % (nPrime_ / k_), q % (nPrime_ / k_), (p / (nPrime_ / k_)) * k_ + q / (nPrime_ / k_));
     }
 
-    elem_type get(size_type n, size_type p, size_type q, size_type z) {
+    bool check(size_type n, size_type p, size_type q, size_type z) const {
 
         if (z >= T_.size()) {
-            return L_[z - T_.size()];
+            return (leaf(z - T_.size()) != null_);
         } else {
-            return T_[z] ? get(n / k_, p % (n / k_), q % (n / k_), R_.rank(z + 1) * k_ * k_ + (p / (n / k_)) * k_ + q / (n / k_)) : null_;
+            return T_[z] ? check(n / k_, p % (n / k_), q % (n / k_), R_.rank(z + 1) * k_ * k_ + (p / (n / k_)) * k_ + q / (n / k_)) : false;
+        }
+
+    }
+
+    /* getElement() */
+
+    elem_type getInit(size_type p, size_type q) const {
+
+        size_type x;
+        if (fixedArityLeafPosition(p, q, x)) {
+            return (x < numLeaves()) ? leaf(x) : null_;
+        }
+
+        if (tableH_ != 0) {
+            return (numLeaves() == 0) ? null_ : get(tableN_, p % tableN_, q % tableN_, topNodes_[(p / tableN_) * (nPrime_ / tableN_) + q / tableN_]);
+        }
+
+        return (numLeaves() == 0) ? null_ : get(nPrime_ / k_, p % (nPrime_ / k_), q % (nPrime_ / k_), (p / (nPrime_ / k_)) * k_ + q / (nPrime_ / k_));
+
+    }
+
+    elem_type get(size_type n, size_type p, size_type q, size_type z) const {
+
+        if (z >= T_.size()) {
+            return leaf(z - T_.size());
+        } else {
+            return T_[z] ? get(n / k_, p % (n / k_), q % (n / k_), R_.rank(z + 1) * k_ * k_ + (p / (n / k_)) * k_ + q / (n / k_)) : null_;
+        }
+
+    }
+
+
+    /* helper methods for point queries with compile-time arities */
+
+    // determines the position x in L of (p, q) (numLeaves() if (p, q) lies in an empty submatrix) via the variant
+    // for the compile-time arity k_ and returns true, returns false if k_ is none of the commonly used arities 2 and 4
+    bool fixedArityLeafPosition(size_type p, size_type q, size_type& x) const {
+
+        switch (k_) {
+            case 2:
+                x = leafPosition<2>(p, q);
+                return true;
+            case 4:
+                x = leafPosition<4>(p, q);
+                return true;
+            default:
+                return false;
+        }
+
+    }
+
+    // iterative descent for a compile-time arity K (a power of two):
+    // as the edge length of every submatrix is a power of K, all divisions / remainders become shifts / masks
+    template<size_type K>
+    size_type leafPosition(size_type p, size_type q) const {
+
+        // start at the node of the lookup table (if any) or at the child of the root
+        size_type s = logTwo(K) * (h_ - std::max(tableH_, (size_type) 1));
+        size_type z = (tableH_ != 0) ? topNodes_[(p >> s) * (nPrime_ >> s) + (q >> s)] : (p >> s) * K + (q >> s);
+
+        while (z < T_.size()) {
+
+            if (!T_[z]) {
+                return numLeaves();
+            }
+
+            s -= logTwo(K);
+            z = R_.rank(z + 1) * K * K + ((p >> s) & (K - 1)) * K + ((q >> s) & (K - 1));
+
+        }
+
+        return z - T_.size();
+
+    }
+
+    /* helper methods for batch queries (isNotNull() / getElement() on several positions) */
+
+    // calls report(x, pos) for every query x whose position is represented in L_ (at pos),
+    // every submatrix shared by several queries is descended into only once
+    template<typename F>
+    void batchInit(const positions_type& queries, F report) const {
+
+        if (numLeaves() == 0 || queries.empty()) return;
+
+        std::vector<size_type> order(queries.size());
+        std::vector<size_type> buffer(queries.size());
+        std::vector<std::vector<size_type>> ends(h_); // ends of the child groups, one array per level
+
+        for (size_type x = 0; x < queries.size(); x++) {
+            order[x] = x;
+        }
+
+        batch(queries, order, buffer, ends, report, 0, queries.size(), nPrime_, 0, 0, 0, 0);
+
+    }
+
+    template<typename F>
+    void batch(const positions_type& queries, std::vector<size_type>& order, std::vector<size_type>& buffer, std::vector<std::vector<size_type>>& ends, F& report, size_type first, size_type last, size_type n, size_type p, size_type q, size_type z, size_type l) const {
+
+        size_type m = n / k_;
+        size_type numChildren = k_ * k_;
+
+        auto& e = ends[l];
+        e.assign(numChildren, 0);
+
+        // group the queries order[first..last) by the child containing them (stable counting sort)
+        for (size_type x = first; x < last; x++) {
+            e[((queries[order[x]].first - p) / m) * k_ + (queries[order[x]].second - q) / m]++;
+        }
+
+        size_type sum = first;
+        for (size_type c = 0; c < numChildren; c++) {
+            size_type tmp = e[c];
+            e[c] = sum;
+            sum += tmp;
+        }
+
+        for (size_type x = first; x < last; x++) {
+            buffer[e[((queries[order[x]].first - p) / m) * k_ + (queries[order[x]].second - q) / m]++] = order[x];
+        }
+
+        std::copy(buffer.begin() + first, buffer.begin() + last, order.begin() + first);
+
+        // afterwards, the queries of child c are order[(c == 0 ? first : e[c - 1])..e[c])
+        size_type start = first;
+        for (size_type c = 0; c < numChildren; c++) {
+
+            size_type end = e[c];
+
+            if (start < end) {
+
+                size_type y = z + c;
+
+                if (y >= T_.size()) {
+                    for (size_type x = start; x < end; x++) {
+                        report(order[x], y - T_.size());
+                    }
+                } else if (T_[y]) {
+                    batch(queries, order, buffer, ends, report, start, end, m, p + (c / k_) * m, q + (c % k_) * m, R_.rank(y + 1) * k_ * k_, l + 1);
+                }
+
+            }
+
+            start = end;
+
         }
 
     }
@@ -867,9 +1427,9 @@ private:
 
     /* getSuccessorElements() */
 
-    void allSuccessorElementsIterative(std::vector<elem_type>& succs, size_type p) {
+    void allSuccessorElementsIterative(std::vector<elem_type>& succs, size_type p) const {
 
-        if (L_.empty()) return;
+        if (numLeaves() == 0) return;
 
         std::queue<SubrowInfo> queue, nextLevelQueue;
         size_type lenT = T_.size();
@@ -878,8 +1438,8 @@ private:
 
             size_type offset = p * nPrime_;
             for (size_type i = 0; i < nPrime_; i++) {
-                if (L_[offset + i] != null_) {
-                    succs.push_back(L_[offset + i]);
+                if (leaf(offset + i) != null_) {
+                    succs.push_back(leaf(offset + i));
                 }
             }
 
@@ -889,6 +1449,7 @@ private:
             size_type n = nPrime_/ k_;
             size_type relP = p;
             for (size_type j = 0, dq = 0, z = k_ * (relP / n); j < k_; j++, dq += n, z++) {
+                K2TREES_COUNT(queuePushes);
                 queue.push(SubrowInfo(dq, z));
             }
 
@@ -901,11 +1462,12 @@ private:
 
                     auto& cur = queue.front();
 
-                    if (T_[cur.z]) {
+                    if (hasChildren(cur.z)) {
 
                         auto y = R_.rank(cur.z + 1) * k_ * k_ + k_ * (relP / n);
 
                         for (size_type j = 0, newDq = cur.dq; j < k_; j++, newDq += n, y++) {
+                            K2TREES_COUNT(queuePushes);
                             nextLevelQueue.push(SubrowInfo(newDq, y));
                         }
 
@@ -924,13 +1486,13 @@ private:
 
                 auto& cur = queue.front();
 
-                if (T_[cur.z]) {
+                if (hasChildren(cur.z)) {
 
                     auto y = R_.rank(cur.z + 1) * k_ * k_ + k_ * (relP / n) - lenT;
 
                     for (size_type j = 0, newDq = cur.dq; j < k_; j++, newDq += n, y++) {
-                        if (L_[y] != null_) {
-                            succs.push_back(L_[y]);
+                        if (leaf(y) != null_) {
+                            succs.push_back(leaf(y));
                         }
                     }
 
@@ -944,9 +1506,9 @@ private:
 
     }
 
-    void successorsElemInit(std::vector<elem_type>& succs, size_type p) {
+    void successorsElemInit(std::vector<elem_type>& succs, size_type p) const {
 
-        if (!L_.empty()) {
+        if (numLeaves() != 0) {
 
             size_type y = k_ * (p / (nPrime_ / k_));
 
@@ -958,17 +1520,17 @@ private:
 
     }
 
-    void successorsElem(std::vector<elem_type>& succs, size_type n, size_type p, size_type q, size_type z) {
+    void successorsElem(std::vector<elem_type>& succs, size_type n, size_type p, size_type q, size_type z) const {
 
         if (z >= T_.size()) {
 
-            if (L_[z - T_.size()] != null_) {
-                succs.push_back(L_[z - T_.size()]);
+            if (leaf(z - T_.size()) != null_) {
+                succs.push_back(leaf(z - T_.size()));
             }
 
         } else {
 
-            if (T_[z]) {
+            if (hasChildren(z)) {
 
                 size_type y = R_.rank(z + 1) * k_ * k_ + k_ * (p / (n / k_));
 
@@ -985,9 +1547,9 @@ private:
 
     /* getSuccessorPositions() */
 
-    void allSuccessorPositionsIterative(std::vector<size_type>& succs, size_type p) {
+    void allSuccessorPositionsIterative(std::vector<size_type>& succs, size_type p) const {
 
-        if (L_.empty()) return;
+        if (numLeaves() == 0) return;
 
         std::queue<SubrowInfo> queue, nextLevelQueue;
         size_type lenT = T_.size();
@@ -996,7 +1558,7 @@ private:
 
             size_type offset = p * nPrime_;
             for (size_type i = 0; i < nPrime_; i++) {
-                if (L_[offset + i] != null_) {
+                if (leaf(offset + i) != null_) {
                     succs.push_back(i);
                 }
             }
@@ -1007,6 +1569,7 @@ private:
             size_type n = nPrime_/ k_;
             size_type relP = p;
             for (size_type j = 0, dq = 0, z = k_ * (relP / n); j < k_; j++, dq += n, z++) {
+                K2TREES_COUNT(queuePushes);
                 queue.push(SubrowInfo(dq, z));
             }
 
@@ -1019,11 +1582,12 @@ private:
 
                     auto& cur = queue.front();
 
-                    if (T_[cur.z]) {
+                    if (hasChildren(cur.z)) {
 
                         auto y = R_.rank(cur.z + 1) * k_ * k_ + k_ * (relP / n);
 
                         for (size_type j = 0, newDq = cur.dq; j < k_; j++, newDq += n, y++) {
+                            K2TREES_COUNT(queuePushes);
                             nextLevelQueue.push(SubrowInfo(newDq, y));
                         }
 
@@ -1042,12 +1606,12 @@ private:
 
                 auto& cur = queue.front();
 
-                if (T_[cur.z]) {
+                if (hasChildren(cur.z)) {
 
                     auto y = R_.rank(cur.z + 1) * k_ * k_ + k_ * (relP / n) - lenT;
 
                     for (size_type j = 0, newDq = cur.dq; j < k_; j++, newDq += n, y++) {
-                        if (L_[y] != null_) {
+                        if (leaf(y) != null_) {
                             succs.push_back(newDq);
                         }
                     }
@@ -1062,9 +1626,9 @@ private:
 
     }
 
-    void successorsPosInit(std::vector<size_type>& succs, size_type p) {
+    void successorsPosInit(std::vector<size_type>& succs, size_type p) const {
 
-        if (!L_.empty()) {
+        if (numLeaves() != 0) {
 
             size_type y = k_ * (p / (nPrime_ / k_));
 
@@ -1076,17 +1640,17 @@ private:
 
     }
 
-    void successorsPos(std::vector<size_type>& succs, size_type n, size_type p, size_type q, size_type z) {
+    void successorsPos(std::vector<size_type>& succs, size_type n, size_type p, size_type q, size_type z) const {
 
         if (z >= T_.size()) {
 
-            if (L_[z - T_.size()] != null_) {
+            if (leaf(z - T_.size()) != null_) {
                 succs.push_back(q);
             }
 
         } else {
 
-            if (T_[z]) {
+            if (hasChildren(z)) {
 
                 size_type y = R_.rank(z + 1) * k_ * k_ + k_ * (p / (n / k_));
 
@@ -1103,9 +1667,9 @@ private:
 
     /* getSuccessorValuedPositions() */
 
-    void allSuccessorValuedPositionsIterative(pairs_type& succs, size_type p) {
+    void allSuccessorValuedPositionsIterative(pairs_type& succs, size_type p) const {
 
-        if (L_.empty()) return;
+        if (numLeaves() == 0) return;
 
         std::queue<SubrowInfo> queue, nextLevelQueue;
         size_type lenT = T_.size();
@@ -1114,8 +1678,8 @@ private:
 
             size_type offset = p * nPrime_;
             for (size_type i = 0; i < nPrime_; i++) {
-                if (L_[offset + i] != null_) {
-                    succs.push_back(ValuedPosition<elem_type>(p, i, L_[offset + i]));
+                if (leaf(offset + i) != null_) {
+                    succs.push_back(ValuedPosition<elem_type>(p, i, leaf(offset + i)));
                 }
             }
 
@@ -1125,6 +1689,7 @@ private:
             size_type n = nPrime_/ k_;
             size_type relP = p;
             for (size_type j = 0, dq = 0, z = k_ * (relP / n); j < k_; j++, dq += n, z++) {
+                K2TREES_COUNT(queuePushes);
                 queue.push(SubrowInfo(dq, z));
             }
 
@@ -1137,11 +1702,12 @@ private:
 
                     auto& cur = queue.front();
 
-                    if (T_[cur.z]) {
+                    if (hasChildren(cur.z)) {
 
                         auto y = R_.rank(cur.z + 1) * k_ * k_ + k_ * (relP / n);
 
                         for (size_type j = 0, newDq = cur.dq; j < k_; j++, newDq += n, y++) {
+                            K2TREES_COUNT(queuePushes);
                             nextLevelQueue.push(SubrowInfo(newDq, y));
                         }
 
@@ -1160,13 +1726,13 @@ private:
 
                 auto& cur = queue.front();
 
-                if (T_[cur.z]) {
+                if (hasChildren(cur.z)) {
 
                     auto y = R_.rank(cur.z + 1) * k_ * k_ + k_ * (relP / n) - lenT;
 
                     for (size_type j = 0, newDq = cur.dq; j < k_; j++, newDq += n, y++) {
-                        if (L_[y] != null_) {
-                            succs.push_back(ValuedPosition<elem_type>(p, newDq, L_[y]));
+                        if (leaf(y) != null_) {
+                            succs.push_back(ValuedPosition<elem_type>(p, newDq, leaf(y)));
                         }
                     }
 
@@ -1180,9 +1746,9 @@ private:
 
     }
 
-    void successorsValPosInit(pairs_type& succs, size_type p) {
+    void successorsValPosInit(pairs_type& succs, size_type p) const {
 
-        if (!L_.empty()) {
+        if (numLeaves() != 0) {
 
             size_type y = k_ * (p / (nPrime_ / k_));
 
@@ -1198,17 +1764,17 @@ private:
 
     }
 
-    void successorsValPos(pairs_type& succs, size_type n, size_type p, size_type q, size_type z) {
+    void successorsValPos(pairs_type& succs, size_type n, size_type p, size_type q, size_type z) const {
 
         if (z >= T_.size()) {
 
-            if (L_[z - T_.size()] != null_) {
-                succs.push_back(ValuedPosition<elem_type>(0, q, L_[z - T_.size()]));
+            if (leaf(z - T_.size()) != null_) {
+                succs.push_back(ValuedPosition<elem_type>(0, q, leaf(z - T_.size())));
             }
 
         } else {
 
-            if (T_[z]) {
+            if (hasChildren(z)) {
 
                 size_type y = R_.rank(z + 1) * k_ * k_ + k_ * (p / (n / k_));
 
@@ -1223,17 +1789,58 @@ private:
 
     }
 
+    /* expandFrontier() */
+
+    // expands the rows [first, last) of the frontier within the submatrix of size n x n whose upper left corner is (p,q)
+    // and whose children start at position y, the subtrees shared by several rows are only traversed once
+    void frontierPos(std::vector<size_type>& cols, std::vector<bool>& visited, size_type n, size_type p, size_type q,
+                     std::vector<size_type>::const_iterator first, std::vector<size_type>::const_iterator last, size_type y) const {
+
+        for (size_type i = 0; (i < k_) && (first != last); i++) {
+
+            // rows of the frontier that lie in the i-th row of children
+            auto next = first;
+            while ((next != last) && (*next < p + (i + 1) * (n / k_))) {
+                next++;
+            }
+
+            if (first != next) {
+
+                for (size_type j = 0; j < k_; j++) {
+
+                    size_type z = y + i * k_ + j;
+
+                    if (z >= T_.size()) {
+
+                        if (leaf(z - T_.size()) != null_) {
+                            this->addToFrontier(q + j, cols, visited);
+                        }
+
+                    } else if (hasChildren(z)) {
+                        frontierPos(cols, visited, n / k_, p + i * (n / k_), q + j * (n / k_), first, next, R_.rank(z + 1) * k_ * k_);
+                    }
+
+                }
+
+            }
+
+            first = next;
+
+        }
+
+    }
+
     /* getFirstSuccessor() */
 
-    size_type firstSuccessorPositionIterative(size_type p) {
+    size_type firstSuccessorPositionIterative(size_type p) const {
 
-        if (L_.empty()) return nPrime_;
+        if (numLeaves() == 0) return nPrime_;
 
         if (T_.size() == 0) {
 
             size_type offset = p * nPrime_;
             for (size_type i = 0; i < nPrime_; i++) {
-                if (L_[offset + i] != null_) {
+                if (leaf(offset + i) != null_) {
                     return i;
                 }
             }
@@ -1241,6 +1848,7 @@ private:
         } else {
 
             std::stack<ExtendedSubrowInfo> stack;
+            K2TREES_COUNT(queuePushes);
             stack.emplace(nPrime_ / k_, nPrime_ / k_, p % (nPrime_ / k_), 0, k_ * (p / (nPrime_ / k_)), 0);
 
             while (!stack.empty()) {
@@ -1253,13 +1861,14 @@ private:
 
                     if (cur.z >= T_.size()) {
 
-                        if (L_[cur.z - T_.size()] != null_) {
+                        if (leaf(cur.z - T_.size()) != null_) {
                             return cur.dq;
                         }
 
                     } else {
 
-                        if (T_[cur.z]) {
+                        if (hasChildren(cur.z)) {
+                            K2TREES_COUNT(queuePushes);
                             stack.emplace(cur.nr / k_, cur.nc / k_, cur.p % (cur.nr / k_), cur.dq, R_.rank(cur.z + 1) * k_ * k_ + k_ * (cur.p / (cur.nr / k_)), 0);
                         }
 
@@ -1278,11 +1887,11 @@ private:
 
     }
 
-    size_type firstSuccessorInit(size_type p) {
+    size_type firstSuccessorInit(size_type p) const {
 
         size_type pos = nPrime_;
 
-        if (!L_.empty()) {
+        if (numLeaves() != 0) {
 
             size_type y = k_ * (p / (nPrime_ / k_));
 
@@ -1296,19 +1905,19 @@ private:
 
     }
 
-    size_type firstSuccessor(size_type n, size_type p, size_type q, size_type z) {
+    size_type firstSuccessor(size_type n, size_type p, size_type q, size_type z) const {
 
         size_type pos = nPrime_;
 
         if (z >= T_.size()) {
 
-            if (L_[z - T_.size()] != null_) {
+            if (leaf(z - T_.size()) != null_) {
                 pos = q;
             }
 
         } else {
 
-            if (T_[z]) {
+            if (hasChildren(z)) {
 
                 size_type y = R_.rank(z + 1) * k_ * k_ + k_ * (p / (n / k_));
 
@@ -1327,9 +1936,9 @@ private:
 
     /* getPredecessorElements() */
 
-    void predecessorsElemInit(std::vector<elem_type>& preds, size_type q) {
+    void predecessorsElemInit(std::vector<elem_type>& preds, size_type q) const {
 
-        if (!L_.empty()) {
+        if (numLeaves() != 0) {
 
             size_type y = q / (nPrime_ / k_);
 
@@ -1341,17 +1950,17 @@ private:
 
     }
 
-    void predecessorsElem(std::vector<elem_type>& preds, size_type n, size_type q, size_type p, size_type z) {
+    void predecessorsElem(std::vector<elem_type>& preds, size_type n, size_type q, size_type p, size_type z) const {
 
         if (z >= T_.size()) {
 
-            if (L_[z - T_.size()] != null_) {
-                preds.push_back(L_[z - T_.size()]);
+            if (leaf(z - T_.size()) != null_) {
+                preds.push_back(leaf(z - T_.size()));
             }
 
         } else {
 
-            if (T_[z]) {
+            if (hasChildren(z)) {
 
                 size_type y = R_.rank(z + 1) * k_ * k_ + q / (n / k_);
 
@@ -1367,9 +1976,9 @@ private:
 
     /* getPredecessorPositions() */
 
-    void predecessorsPosInit(std::vector<size_type>& preds, size_type q) {
+    void predecessorsPosInit(std::vector<size_type>& preds, size_type q) const {
 
-        if (!L_.empty()) {
+        if (numLeaves() != 0) {
 
             size_type y = q / (nPrime_ / k_);
 
@@ -1381,17 +1990,17 @@ private:
 
     }
 
-    void predecessorsPos(std::vector<size_type>& preds, size_type n, size_type q, size_type p, size_type z) {
+    void predecessorsPos(std::vector<size_type>& preds, size_type n, size_type q, size_type p, size_type z) const {
 
         if (z >= T_.size()) {
 
-            if (L_[z - T_.size()] != null_) {
+            if (leaf(z - T_.size()) != null_) {
                 preds.push_back(p);
             }
 
         } else {
 
-            if (T_[z]) {
+            if (hasChildren(z)) {
 
                 size_type y = R_.rank(z + 1) * k_ * k_ + q / (n / k_);
 
@@ -1407,9 +2016,9 @@ private:
 
     /* getPredecessorValuedPositions() */
 
-    void predecessorsValPosInit(pairs_type& preds, size_type q) {
+    void predecessorsValPosInit(pairs_type& preds, size_type q) const {
 
-        if (!L_.empty()) {
+        if (numLeaves() != 0) {
 
             size_type y = q / (nPrime_ / k_);
 
@@ -1425,17 +2034,17 @@ private:
 
     }
 
-    void predecessorsValPos(pairs_type& preds, size_type n, size_type q, size_type p, size_type z) {
+    void predecessorsValPos(pairs_type& preds, size_type n, size_type q, size_type p, size_type z) const {
 
         if (z >= T_.size()) {
 
-            if (L_[z - T_.size()] != null_) {
-                preds.push_back(ValuedPosition<elem_type>(p, 0, L_[z - T_.size()]));
+            if (leaf(z - T_.size()) != null_) {
+                preds.push_back(ValuedPosition<elem_type>(p, 0, leaf(z - T_.size())));
             }
 
         } else {
 
-            if (T_[z]) {
+            if (hasChildren(z)) {
 
                 size_type y = R_.rank(z + 1) * k_ * k_ + q / (n / k_);
 
@@ -1452,9 +2061,9 @@ private:
 
     /* getElementsInRange() */
 
-    void rangeElemInit(std::vector<elem_type>& elements, size_type p1, size_type p2, size_type q1, size_type q2) {
+    void rangeElemInit(std::vector<elem_type>& elements, size_type p1, size_type p2, size_type q1, size_type q2) const {
 
-        if (!L_.empty()) {
+        if (numLeaves() != 0) {
 
             size_type p1Prime, p2Prime;
 
@@ -1483,17 +2092,17 @@ private:
 
     }
 
-    void rangeElem(std::vector<elem_type>& elements, size_type n, size_type p1, size_type p2, size_type q1, size_type q2, size_type dp, size_type dq, size_type z) {
+    void rangeElem(std::vector<elem_type>& elements, size_type n, size_type p1, size_type p2, size_type q1, size_type q2, size_type dp, size_type dq, size_type z) const {
 
         if (z >= T_.size()) {
 
-            if (L_[z - T_.size()] != null_) {
-                elements.push_back(L_[z - T_.size()]);
+            if (leaf(z - T_.size()) != null_) {
+                elements.push_back(leaf(z - T_.size()));
             }
 
         } else {
 
-            if (T_[z]) {
+            if (hasChildren(z)) {
 
                 size_type y = R_.rank(z + 1) * k_ * k_;
                 size_type p1Prime, p2Prime;
@@ -1527,9 +2136,9 @@ private:
 
     /* getPositionsInRange() */
 
-    void rangePosInit(positions_type& pairs, size_type p1, size_type p2, size_type q1, size_type q2) {
+    void rangePosInit(positions_type& pairs, size_type p1, size_type p2, size_type q1, size_type q2) const {
 
-        if (!L_.empty()) {
+        if (numLeaves() != 0) {
 
             size_type p1Prime, p2Prime;
 
@@ -1558,17 +2167,17 @@ private:
 
     }
 
-    void rangePos(positions_type& pairs, size_type n, size_type p1, size_type p2, size_type q1, size_type q2, size_type dp, size_type dq, size_type z) {
+    void rangePos(positions_type& pairs, size_type n, size_type p1, size_type p2, size_type q1, size_type q2, size_type dp, size_type dq, size_type z) const {
 
         if (z >= T_.size()) {
 
-            if (L_[z - T_.size()] != null_) {
+            if (leaf(z - T_.size()) != null_) {
                 pairs.push_back(std::make_pair(dp, dq));
             }
 
         } else {
 
-            if (T_[z]) {
+            if (hasChildren(z)) {
 
                 size_type y = R_.rank(z + 1) * k_ * k_;
                 size_type p1Prime, p2Prime;
@@ -1602,9 +2211,9 @@ private:
 
     /* getValuedPositionsRange() */
 
-    void rangeValPosInit(pairs_type& pairs, size_type p1, size_type p2, size_type q1, size_type q2) {
+    void rangeValPosInit(pairs_type& pairs, size_type p1, size_type p2, size_type q1, size_type q2) const {
 
-        if (!L_.empty()) {
+        if (numLeaves() != 0) {
 
             size_type p1Prime, p2Prime;
 
@@ -1633,17 +2242,17 @@ private:
 
     }
 
-    void rangeValPos(pairs_type& pairs, size_type n, size_type p1, size_type p2, size_type q1, size_type q2, size_type dp, size_type dq, size_type z) {
+    void rangeValPos(pairs_type& pairs, size_type n, size_type p1, size_type p2, size_type q1, size_type q2, size_type dp, size_type dq, size_type z) const {
 
         if (z >= T_.size()) {
 
-            if (L_[z - T_.size()] != null_) {
-                pairs.push_back(ValuedPosition<elem_type>(dp, dq, L_[z - T_.size()]));
+            if (leaf(z - T_.size()) != null_) {
+                pairs.push_back(ValuedPosition<elem_type>(dp, dq, leaf(z - T_.size())));
             }
 
         } else {
 
-            if (T_[z]) {
+            if (hasChildren(z)) {
 
                 size_type y = R_.rank(z + 1) * k_ * k_;
                 size_type p1Prime, p2Prime;
@@ -1676,18 +2285,180 @@ private:
     }
 
 
-    /* containsElement() */
+    /* forEachSuccessorPosition() */
+
+    bool successorsVisitInit(const std::function<bool(size_type)>& visitor, size_type p) const {
+
+        if (numLeaves() != 0) {
+
+            size_type y = k_ * (p / (nPrime_ / k_));
+
+            for (size_type j = 0; j < k_; j++) {
+                if (!successorsVisit(visitor, nPrime_ / k_, p % (nPrime_ / k_), (nPrime_ / k_) * j, y + j)) return false;
+            }
+
+        }
+
+        return true;
+
+    }
+
+    bool successorsVisit(const std::function<bool(size_type)>& visitor, size_type n, size_type p, size_type q, size_type z) const {
+
+        if (z >= T_.size()) {
+
+            if (leaf(z - T_.size()) != null_) {
+                if (!visitor(q)) return false;
+            }
+
+        } else {
+
+            if (hasChildren(z)) {
+
+                size_type y = R_.rank(z + 1) * k_ * k_ + k_ * (p / (n / k_));
+
+                for (size_type j = 0; j < k_; j++) {
+                    if (!successorsVisit(visitor, n / k_, p % (n / k_), q + (n / k_) * j, y + j)) return false;
+                }
+
+            }
+
+        }
+
+        return true;
+
+    }
+
+    /* forEachPredecessorPosition() */
 
-    bool elemInRangeInit(size_type p1, size_type p2, size_type q1, size_type q2) {
+    bool predecessorsVisitInit(const std::function<bool(size_type)>& visitor, size_type q) const {
 
-        if (!L_.empty()) {
+        if (numLeaves() != 0) {
+
+            size_type y = q / (nPrime_ / k_);
+
+            for (size_type i = 0; i < k_; i++) {
+                if (!predecessorsVisit(visitor, nPrime_ / k_, q % (nPrime_ / k_), (nPrime_ / k_) * i, y + i * k_)) return false;
+            }
+
+        }
+
+        return true;
+
+    }
+
+    bool predecessorsVisit(const std::function<bool(size_type)>& visitor, size_type n, size_type q, size_type p, size_type z) const {
+
+        if (z >= T_.size()) {
+
+            if (leaf(z - T_.size()) != null_) {
+                if (!visitor(p)) return false;
+            }
+
+        } else {
+
+            if (hasChildren(z)) {
+
+                size_type y = R_.rank(z + 1) * k_ * k_ + q / (n / k_);
+
+                for (size_type i = 0; i < k_; i++) {
+                    if (!predecessorsVisit(visitor, n / k_, q % (n / k_), p + (n / k_) * i, y + i * k_)) return false;
+                }
+
+            }
+
+        }
+
+        return true;
+
+    }
+
+    /* forEachValuedPositionInRange() */
+
+    bool rangeValVisitInit(const std::function<bool(size_type, size_type, elem_type)>& visitor, size_type p1, size_type p2, size_type q1, size_type q2) const {
+
+        if (numLeaves() != 0) {
+
+            size_type p1Prime, p2Prime;
+
+            for (size_type i = p1 / (nPrime_ / k_); i <= p2 / (nPrime_ / k_); i++) {
+
+                p1Prime = (i == p1 / (nPrime_ / k_)) * (p1 % (nPrime_ / k_));
+                p2Prime = (i == p2 / (nPrime_ / k_)) ? p2 % (nPrime_ / k_) : (nPrime_ / k_) - 1;
+
+                for (size_type j = q1 / (nPrime_ / k_); j <= q2 / (nPrime_ / k_); j++) {
+                    if (!rangeValVisit(
+                            visitor,
+                            nPrime_ / k_,
+                            p1Prime,
+                            p2Prime,
+                            (j == q1 / (nPrime_ / k_)) * (q1 % (nPrime_ / k_)),
+                            (j == q2 / (nPrime_ / k_)) ? q2 % (nPrime_ / k_) : (nPrime_ / k_) - 1,
+                            (nPrime_ / k_) * i,
+                            (nPrime_ / k_) * j,
+                            k_ * i + j
+                    )) return false;
+                }
+
+            }
+
+        }
+
+        return true;
+
+    }
+
+    bool rangeValVisit(const std::function<bool(size_type, size_type, elem_type)>& visitor, size_type n, size_type p1, size_type p2, size_type q1, size_type q2, size_type dp, size_type dq, size_type z) const {
+
+        if (z >= T_.size()) {
+
+            if (leaf(z - T_.size()) != null_) {
+                if (!visitor(dp, dq, leaf(z - T_.size()))) return false;
+            }
+
+        } else {
+
+            if (hasChildren(z)) {
+
+                size_type y = R_.rank(z + 1) * k_ * k_;
+                size_type p1Prime, p2Prime;
+
+                for (size_type i = p1 / (n / k_); i <= p2 / (n / k_); i++) {
+
+                    p1Prime = (i == p1 / (n / k_)) * (p1 % (n / k_));
+                    p2Prime = (i == p2 / (n / k_)) ? p2 % (n / k_) : n / k_ - 1;
+
+                    for (size_type j = q1 / (n / k_); j <= q2 / (n / k_); j++) {
+                        if (!rangeValVisit(
+                                visitor,
+                                n / k_,
+                                p1Prime,
+                                p2Prime,
+                                (j == q1 / (n / k_)) * (q1 % (n / k_)),
+                                (j == q2 / (n / k_)) ? q2 % (n / k_) : n / k_ - 1,
+                                dp + (n / k_) * i,
+                                dq + (n / k_) * j,
+                                y + k_ * i + j
+                        )) return false;
+                    }
+
+                }
 
-            // dividing by k_ (as stated in the paper) in not correct,
-            // because it does not use the size of the currently considered submatrix but of its submatrices
-            if ((p1 == 0) && (q1 == 0) && (p2 == (nPrime_ /*/ k_*/ - 1)) && (q2 == (nPrime_ /*/ k_*/ - 1))) {
-                return 1;
             }
 
+        }
+
+        return true;
+
+    }
+
+
+    /* containsElement() */
+
+    bool elemInRangeInit(size_type p1, size_type p2, size_type q1, size_type q2) const {
+
+        if (numLeaves() != 0) {
+
             size_type p1Prime, p2Prime;
 
             for (size_type i = p1 / (nPrime_ / k_); i <= p2 / (nPrime_ / k_); i++) {
@@ -1711,15 +2482,15 @@ private:
 
     }
 
-    bool elemInRange(size_type n, size_type p1, size_type p2, size_type q1, size_type q2, size_type z) {
+    bool elemInRange(size_type n, size_type p1, size_type p2, size_type q1, size_type q2, size_type z) const {
 
         if (z >= T_.size()) {
 
-            return L_[z - T_.size()];
+            return (leaf(z - T_.size()) != null_);
 
         } else {
 
-            if (T_[z]) {
+            if (hasChildren(z)) {
 
                 // dividing by k_ (as stated in the paper) in not correct,
                 // because it does not use the size of the currently considered submatrix but of its submatrices
@@ -1754,35 +2525,309 @@ private:
     }
 
 
-    /* setNull() */
+    /* countElementsInRange() */
 
-    void setInit(size_type p, size_type q) {
+    size_type countRangeInit(size_type p1, size_type p2, size_type q1, size_type q2) const {
 
-        if (!L_.empty()) {
-            set(nPrime_ / k_, p % (nPrime_ / k_), q % (nPrime_ / k_), (p / (nPrime_ / k_)) * k_ + q / (nPrime_ / k_));
-        }
+        size_type cnt = 0;
 
-    }
+        if (numLeaves() != 0) {
+
+            size_type p1Prime, p2Prime;
 
-    void set(size_type n, size_type p, size_type q, size_type z) {
+            for (size_type i = p1 / (nPrime_ / k_); i <= p2 / (nPrime_ / k_); i++) {
 
-        if (z >= T_.size()) {
-            L_[z - T_.size()] = null_;
-        } else {
+                p1Prime = (i == p1 / (nPrime_ / k_)) * (p1 % (nPrime_ / k_));
+                p2Prime = (i == p2 / (nPrime_ / k_)) ? p2 % (nPrime_ / k_) : (nPrime_ / k_) - 1;
+
+                for (size_type j = q1 / (nPrime_ / k_); j <= q2 / (nPrime_ / k_); j++) {
+                    cnt += countRange(
+                            nPrime_ / k_,
+                            p1Prime,
+                            p2Prime,
+                            (j == q1 / (nPrime_ / k_)) * (q1 % (nPrime_ / k_)),
+                            (j == q2 / (nPrime_ / k_)) ? q2 % (nPrime_ / k_) : (nPrime_ / k_) - 1,
+                            k_ * i + j
+                    );
+                }
 
-            if (T_[z]) {
-                set(n / k_, p % (n / k_), q % (n / k_), R_.rank(z + 1) * k_ * k_ + (p / (n / k_)) * k_ + q / (n / k_));
             }
 
         }
 
+        return cnt;
+
     }
 
-};
+    size_type countRange(size_type n, size_type p1, size_type p2, size_type q1, size_type q2, size_type z) const {
 
+        if (z >= T_.size()) {
+            return (leaf(z - T_.size()) != null_);
+        }
 
-/**
- * Bool specialisation of BasicK2Tree.
+        if (!hasChildren(z)) {
+            return 0;
+        }
+
+        // submatrix completely covered by the range: count all its entries at once
+        if (p1 == 0 && q1 == 0 && p2 == n - 1 && q2 == n - 1) {
+            return countSubtree(z);
+        }
+
+        size_type y = R_.rank(z + 1) * k_ * k_;
+        size_type p1Prime, p2Prime;
+        size_type cnt = 0;
+
+        for (size_type i = p1 / (n / k_); i <= p2 / (n / k_); i++) {
+
+            p1Prime = (i == p1 / (n / k_)) * (p1 % (n / k_));
+            p2Prime = (i == p2 / (n / k_)) ? p2 % (n / k_) : n / k_ - 1;
+
+            for (size_type j = q1 / (n / k_); j <= q2 / (n / k_); j++) {
+                cnt += countRange(
+                        n / k_,
+                        p1Prime,
+                        p2Prime,
+                        (j == q1 / (n / k_)) * (q1 % (n / k_)),
+                        (j == q2 / (n / k_)) ? q2 % (n / k_) : n / k_ - 1,
+                        y + k_ * i + j
+                );
+            }
+
+        }
+
+        return cnt;
+
+    }
+
+    /* helper methods for counting (countElements() / countElementsInRange()) */
+
+    // returns the number of non-null entries in the leaves below node z (z < T_.size() and T_[z] = 1),
+    // the nodes of a subtree on each level form a contiguous interval, which is mapped to the next level via rank
+    size_type countSubtree(size_type z) const {
+
+        size_type lo = z;
+        size_type hi = z + 1;
+
+        while (lo < hi && lo < T_.size()) {
+
+            lo = (R_.rank(lo) + 1) * k_ * k_;
+            hi = (R_.rank(hi) + 1) * k_ * k_;
+
+        }
+
+        return (lo < hi) ? countLeaves(lo - T_.size(), hi - T_.size()) : 0;
+
+    }
+
+    // returns the number of non-null entries in L_[from..to)
+    size_type countLeaves(size_type from, size_type to) const {
+
+        if (countSamples_.empty()) {
+
+            size_type cnt = 0;
+            for (size_type x = from; x < to; x++) {
+                cnt += (leaf(x) != null_);
+            }
+
+            return cnt;
+
+        }
+
+        return countPrefix(to) - countPrefix(from);
+
+    }
+
+    // returns the number of non-null entries in L_[0..x) using the counting index
+    size_type countPrefix(size_type x) const {
+
+        size_type cnt = countSamples_[x / K2TREES_COUNT_SAMPLE_RATE];
+        for (size_type y = (x / K2TREES_COUNT_SAMPLE_RATE) * K2TREES_COUNT_SAMPLE_RATE; y < x; y++) {
+            cnt += (leaf(y) != null_);
+        }
+
+        return cnt;
+
+    }
+
+    /* helper method for the set operations */
+
+    // determines the result of op level by level, each element of cur represents a node of the result
+    // by the positions of the first children of the corresponding nodes in this and other (none if the subtree is empty)
+    BasicK2Tree combine(const BasicK2Tree& other, const SetOperation op) const {
+
+        if ((k_ != other.k_) || (h_ != other.h_)) {
+            throw std::runtime_error("Set operations are only supported between K2Trees with the same arity and height.");
+        }
+
+        const size_type none = size_type(-1);
+
+        std::vector<std::vector<bool>> levels(h_ - 1);
+        std::vector<elem_type> leaves;
+
+        std::vector<std::pair<size_type, size_type>> cur(1, std::make_pair((numLeaves() != 0) ? 0 : none, (other.numLeaves() != 0) ? 0 : none));
+        std::vector<std::pair<size_type, size_type>> next;
+
+        for (size_type l = 0; l < h_; l++) {
+
+            for (auto& y : cur) {
+
+                for (size_type i = 0; i < k_ * k_; i++) {
+
+                    if (l < h_ - 1) {
+
+                        bool a = (y.first != none) && hasChildren(y.first + i);
+                        bool b = (y.second != none) && other.hasChildren(y.second + i);
+                        bool bit = (op == SET_UNION) ? (a || b) : ((op == SET_INTERSECTION) ? (a && b) : a);
+
+                        levels[l].push_back(bit);
+
+                        if (bit) {
+                            next.push_back(std::make_pair(a ? R_.rank(y.first + i + 1) * k_ * k_ : none, b ? other.R_.rank(y.second + i + 1) * k_ * k_ : none));
+                        }
+
+                    } else {
+
+                        elem_type a = (y.first != none) ? leaf(y.first + i - T_.size()) : null_;
+                        bool b = (y.second != none) && (other.leaf(y.second + i - other.T_.size()) != other.null_);
+
+                        if (op == SET_UNION) {
+                            leaves.push_back(((a == null_) && b) ? other.leaf(y.second + i - other.T_.size()) : a);
+                        } else if (op == SET_INTERSECTION) {
+                            leaves.push_back(b ? a : null_);
+                        } else {
+                            leaves.push_back(b ? null_ : a);
+                        }
+
+                    }
+
+                }
+
+            }
+
+            cur.swap(next);
+            next.clear();
+
+        }
+
+        // the intersection / difference of two non-empty subtrees can be empty
+        if (op != SET_UNION) {
+            pruneEmptyBlocks(levels, leaves, k_ * k_, null_);
+        }
+
+        BasicK2Tree res;
+        res.h_ = h_;
+        res.k_ = k_;
+        res.nPrime_ = nPrime_;
+        res.null_ = null_;
+
+        size_type total = 0;
+        for (size_type l = 0; l < h_ - 1; l++) {
+            total += levels[l].size();
+        }
+        res.T_ = bit_vector_type(total);
+
+        bit_vector_type::iterator outIter = res.T_.begin();
+        for (size_type l = 0; l < h_ - 1; l++) {
+            outIter = std::move(levels[l].begin(), levels[l].end(), outIter);
+        }
+
+        res.L_ = std::move(leaves);
+        res.R_ = rank_type(&res.T_);
+
+        return res;
+
+    }
+
+    /* helper methods for handling subtrees emptied by setNull() */
+
+    // checks whether node z has children, i.e. whether its bit in T is set and its subtree has not been emptied by setNull()
+    inline bool hasChildren(size_type z) const {
+
+        K2TREES_COUNT(nodesVisited);
+        return T_[z] && (emptyNodes_.empty() || !emptyNodes_[z]);
+
+    }
+
+    // checks whether all len nodes of the block starting at position y are empty
+    bool isEmptyBlock(size_type y, size_type len) const {
+
+        for (size_type c = y; c < y + len; c++) {
+            if ((c >= T_.size()) ? (leaf(c - T_.size()) != null_) : hasChildren(c)) {
+                return false;
+            }
+        }
+
+        return true;
+
+    }
+
+    // marks the subtree of node z as empty
+    void markEmpty(size_type z) {
+
+        if (emptyNodes_.empty()) {
+            emptyNodes_ = bit_vector_type(T_.size(), 0);
+        }
+
+        emptyNodes_[z] = 1;
+
+    }
+
+    /* setNull() */
+
+    void setInit(size_type p, size_type q) {
+
+        if (numLeaves() != 0) {
+            set(nPrime_ / k_, p % (nPrime_ / k_), q % (nPrime_ / k_), (p / (nPrime_ / k_)) * k_ + q / (nPrime_ / k_));
+        }
+
+    }
+
+    // clears the entry in the subtree of z, returns true iff the subtree is empty afterwards
+    bool set(size_type n, size_type p, size_type q, size_type z) {
+
+        if (z >= T_.size()) {
+
+            // keep the counting index up to date
+            if (!countSamples_.empty() && (leaf(z - T_.size()) != null_)) {
+                for (size_type s = (z - T_.size()) / K2TREES_COUNT_SAMPLE_RATE + 1; s < countSamples_.size(); s++) {
+                    countSamples_[s]--;
+                }
+            }
+
+            L_[z - T_.size()] = null_;
+
+            return true;
+
+        } else {
+
+            if (hasChildren(z)) {
+
+                size_type y = R_.rank(z + 1) * k_ * k_;
+
+                // mark z if its whole subtree has become empty
+                if (set(n / k_, p % (n / k_), q % (n / k_), y + (p / (n / k_)) * k_ + q / (n / k_)) && isEmptyBlock(y, k_ * k_)) {
+
+                    markEmpty(z);
+                    return true;
+
+                }
+
+                return false;
+
+            }
+
+            return true;
+
+        }
+
+    }
+
+};
+
+
+/**
+ * Bool specialisation of BasicK2Tree.
  *
  * Has the same characteristics as the general implementation above,
  * but makes use of some simplifications since the only non-null value is 1 / true.
@@ -1798,6 +2843,15 @@ public:
     typedef K2Tree<elem_type>::positions_type positions_type;
     typedef K2Tree<elem_type>::pairs_type pairs_type;
 
+    // output-buffer and limited variants of the query methods (see K2Tree)
+    using K2Tree<elem_type>::getSuccessorPositions;
+    using K2Tree<elem_type>::getPredecessorPositions;
+    using K2Tree<elem_type>::getPositionsInRange;
+    using K2Tree<elem_type>::getAllValuedPositions;
+    using K2Tree<elem_type>::getSuccessors;
+    using K2Tree<elem_type>::getRange;
+    using K2Tree<elem_type>::expandFrontier;
+
 
     BasicK2Tree() {
         // nothing to do
@@ -1812,7 +2866,13 @@ public:
 
         T_ = other.T_;
         L_ = other.L_;
+        compressedL_ = other.compressedL_;
         R_ = rank_type(&T_);
+        emptyNodes_ = other.emptyNodes_;
+        countSamples_ = other.countSamples_;
+        topNodes_ = other.topNodes_;
+        tableH_ = other.tableH_;
+        tableN_ = other.tableN_;
 
     }
 
@@ -1830,7 +2890,13 @@ public:
 
         T_ = other.T_;
         L_ = other.L_;
+        compressedL_ = other.compressedL_;
         R_ = rank_type(&T_);
+        emptyNodes_ = other.emptyNodes_;
+        countSamples_ = other.countSamples_;
+        topNodes_ = other.topNodes_;
+        tableH_ = other.tableH_;
+        tableN_ = other.tableN_;
 
         return *this;
 
@@ -1964,9 +3030,62 @@ public:
     }
 
     /**
-     * List-of-pairs-based constructor (based on section 3.3.5. of Brisaboa et al.)
+     * Streaming constructor that consumes the relation pairs provided by reader one after another and, apart from
+     * the resulting data structure, only keeps the path of the current submatrix (height times k*k entries) in memory.
+     *
+     * The pairs have to be sorted in the order in which the (depth-first) construction visits them, i.e. by their k x k
+     * submatrix on the first level (in row-major order), then by their submatrix on the second level and so on
+     * (within the k x k submatrices of the last level, this is plain row-major order).
+     * The represented matrix has size n x n, where n is the smallest power of k that is not smaller than numRows and numCols.
+     * Throws a std::runtime_error if a pair lies outside of this matrix, is out of order or occurs more than once.
+     */
+    BasicK2Tree(PairReader<bool>& reader, const size_type numRows, const size_type numCols, const size_type k) {
+
+        null_ = false;
+
+        k_ = k;
+        h_ = std::max((size_type)1, logK(std::max(numRows, numCols), k_));
+        nPrime_ = size_type(pow(k_, h_));
+
+        std::vector<std::vector<bool>> levels(h_);
+        buildFromStream(reader, levels, nPrime_, 1, 0, 0);
+
+        if (reader.hasNext()) {
+            throw std::runtime_error("Pair no. " + std::to_string(reader.getConsumed() + 1) + " at (" + std::to_string(reader.peek().row) + ", " + std::to_string(reader.peek().col) + ") is out of order, outside of the matrix or a duplicate.");
+        }
+
+        size_type total = 0;
+        for (size_type l = 0; l < h_ - 1; l++) {
+            total += levels[l].size();
+        }
+        T_ = bit_vector_type(total);
+
+        bit_vector_type::iterator outIter = T_.begin();
+        for (size_type l = 0; l < h_ - 1; l++) {
+
+            outIter = std::move(levels[l].begin(), levels[l].end(), outIter);
+            levels[l].clear();
+            levels[l].shrink_to_fit();
+
+        }
+
+        L_ = bit_vector_type(levels[h_ - 1].size());
+        std::move(levels[h_ - 1].begin(), levels[h_ - 1].end(), L_.begin());
+        levels[h_ - 1].clear();
+        levels[h_ - 1].shrink_to_fit();
+
+        R_ = rank_type(&T_);
+
+    }
+
+    /**
+     * List-of-pairs-based constructor
+     *
+     * The mixed-radix keys of the pairs are radix-sorted once and the levels are emitted in a single sweep over them
+     * (see buildLevelsFromSortedKeys()) using up to numThreads threads. If the keys do not fit into 64 bits, the tree is built
+     * level by level as in section 3.3.5. of Brisaboa et al., the subproblems of each level are processed by up to numThreads threads.
      */
-    BasicK2Tree(positions_type& pairs, const size_type k) {
+    BasicK2Tree(positions_type& pairs, const size_type k, const size_type numThreads = 1) {
 
         null_ = false;
 
@@ -1980,7 +3099,7 @@ public:
         nPrime_ = size_type(pow(k_, h_));
 
         if (pairs.size() != 0) {
-            buildFromListsInplace(pairs);
+            buildFromSortedKeys(pairs, numThreads);
         }
 
         R_ = rank_type(&T_);
@@ -1989,33 +3108,33 @@ public:
 
 
     // returns the height of the K2Tree
-    size_type getH() {
+    size_type getH() const {
         return h_;
     }
 
     // returns the arity of the K2Tree
-    size_type getK() {
+    size_type getK() const {
         return k_;
     }
 
-    size_type getNumRows() override {
+    size_type getNumRows() const override {
         return nPrime_;
     }
 
-    size_type getNumCols() override {
+    size_type getNumCols() const override {
         return nPrime_;
     }
 
-    elem_type getNull() override {
+    elem_type getNull() const override {
         return null_;
     }
 
 
-    bool areRelated(size_type i, size_type j) override {
+    bool areRelated(size_type i, size_type j) const override {
         return checkLinkInit(i, j);
     }
 
-    std::vector<size_type> getSuccessors(size_type i) override {
+    std::vector<size_type> getSuccessors(size_type i) const override {
 
         std::vector<size_type> succs;
 //        successorsInit(succs, i);
@@ -2025,7 +3144,7 @@ public:
 
     }
 
-    std::vector<size_type> getPredecessors(size_type j) override {
+    std::vector<size_type> getPredecessors(size_type j) const override {
 
         std::vector<size_type> preds;
         predecessorsInit(preds, j);
@@ -2034,7 +3153,7 @@ public:
 
     }
 
-    positions_type getRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    positions_type getRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
 
         positions_type pairs;
         rangeInit(pairs, i1, i2, j1, j2);
@@ -2044,19 +3163,18 @@ public:
 
     }
 
-    bool containsLink(size_type i1, size_type i2, size_type j1, size_type j2) {
+    bool containsLink(size_type i1, size_type i2, size_type j1, size_type j2) const {
         return linkInRangeInit(i1, i2, j1, j2);
 //        return linkInRangeInit(i1, std::min(i2, nPrime_ - 1), j1, std::min(j2, nPrime_ - 1));
     }
 
-    size_type countLinks() override {
+    size_type countLinks() const override {
 
-        size_type res = 0;
-        for (size_type i = 0; i < L_.size(); i++) {
-            res += L_[i];
+        if (!countSamples_.empty()) {
+            return countSamples_.back();
         }
 
-        return res;
+        return countLeaves(0, numLeaves());
 
     }
 
@@ -2065,23 +3183,32 @@ public:
      * General methods for completeness' sake (are redundant / useless for bool)
      */
 
-    bool isNotNull(size_type i, size_type j) override {
+    bool isNotNull(size_type i, size_type j) const override {
         return areRelated(i, j);
     }
 
-    elem_type getElement(size_type i, size_type j) override {
+    elem_type getElement(size_type i, size_type j) const override {
         return areRelated(i, j);
     }
 
-    std::vector<elem_type> getSuccessorElements(size_type i) override {
+    void isNotNull(const positions_type& queries, std::vector<bool>& out) const override {
+        out.assign(queries.size(), false);
+        batchInit(queries, [&](size_type x, size_type pos) { out[x] = leaf(pos); });
+    }
+
+    void getElement(const positions_type& queries, std::vector<elem_type>& out) const override {
+        isNotNull(queries, out);
+    }
+
+    std::vector<elem_type> getSuccessorElements(size_type i) const override {
         return std::vector<elem_type>(getSuccessors(i).size(), true);
     }
 
-    std::vector<size_type> getSuccessorPositions(size_type i) override {
+    std::vector<size_type> getSuccessorPositions(size_type i) const override {
         return getSuccessors(i);
     }
 
-    pairs_type getSuccessorValuedPositions(size_type i) override {
+    pairs_type getSuccessorValuedPositions(size_type i) const override {
 
         auto pos = getSuccessors(i);
 
@@ -2094,15 +3221,15 @@ public:
 
     }
 
-    std::vector<elem_type> getPredecessorElements(size_type j) override {
+    std::vector<elem_type> getPredecessorElements(size_type j) const override {
         return std::vector<elem_type>(getPredecessors(j).size(), true);
     }
 
-    std::vector<size_type> getPredecessorPositions(size_type j) override {
+    std::vector<size_type> getPredecessorPositions(size_type j) const override {
         return getPredecessors(j);
     }
 
-    pairs_type getPredecessorValuedPositions(size_type j) override {
+    pairs_type getPredecessorValuedPositions(size_type j) const override {
 
         auto pos = getPredecessors(j);
 
@@ -2115,15 +3242,15 @@ public:
 
     }
 
-    std::vector<elem_type> getElementsInRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    std::vector<elem_type> getElementsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
         return std::vector<elem_type>(getRange(i1, i2, j1, j2).size(), true);
     }
 
-    positions_type getPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    positions_type getPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
         return getRange(i1, i2, j1, j2);
     }
 
-    pairs_type getValuedPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    pairs_type getValuedPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
 
         auto pos = getRange(i1, i2, j1, j2);
 
@@ -2136,15 +3263,15 @@ public:
 
     }
 
-    std::vector<elem_type> getAllElements() override {
+    std::vector<elem_type> getAllElements() const override {
         return std::vector<elem_type>(countLinks(), true);
     }
 
-    positions_type getAllPositions() override {
+    positions_type getAllPositions() const override {
         return getRange(0, nPrime_ - 1, 0, nPrime_ - 1);
     }
 
-    pairs_type getAllValuedPositions() override {
+    pairs_type getAllValuedPositions() const override {
 
         auto pos = getAllPositions();
 
@@ -2157,21 +3284,145 @@ public:
 
     }
 
-    bool containsElement(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    bool forEachSuccessorPosition(size_type i, const std::function<bool(size_type)>& visitor) const override {
+        return successorsVisitInit(visitor, i);
+    }
+
+    bool forEachPredecessorPosition(size_type j, const std::function<bool(size_type)>& visitor) const override {
+        return predecessorsVisitInit(visitor, j);
+    }
+
+    bool forEachValuedPositionInRange(size_type i1, size_type i2, size_type j1, size_type j2, const std::function<bool(size_type, size_type, elem_type)>& visitor) const override {
+        return rangeValVisitInit(visitor, i1, i2, j1, j2);
+    }
+
+    bool containsElement(size_type i1, size_type i2, size_type j1, size_type j2) const override {
         return linkInRangeInit(i1, i2, j1, j2);
 //        return linkInRangeInit(i1, std::min(i2, nPrime_ - 1), j1, std::min(j2, nPrime_ - 1));
     }
 
-    size_type countElements() override {
+    size_type countElements() const override {
         return countLinks();
     }
 
+    size_type countElementsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
+        return countRangeInit(i1, i2, j1, j2);
+    }
+
+    // builds the (optional) counting index, a sampled prefix sum over the non-null entries of L,
+    // which makes countElements() constant-time and speeds up counting fully covered submatrices in countElementsInRange()
+    // (the index is kept up to date by setNull(), but it is not written by serialize())
+    void buildCountingIndex() {
+
+        this->checkWritable("buildCountingIndex");
+
+        size_type numSamples = numLeaves() / K2TREES_COUNT_SAMPLE_RATE + 1;
+        countSamples_.assign(numSamples + 1, 0);
+
+        size_type cnt = 0;
+        for (size_type s = 0; s < numSamples; s++) {
+
+            countSamples_[s] = cnt;
+            cnt += countLeafBits(s * K2TREES_COUNT_SAMPLE_RATE, std::min((s + 1) * K2TREES_COUNT_SAMPLE_RATE, numLeaves()) - s * K2TREES_COUNT_SAMPLE_RATE);
+
+        }
+
+        countSamples_[numSamples] = cnt;
+
+    }
+
+    bool hasCountingIndex() const {
+        return !countSamples_.empty();
+    }
+
+    // builds a direct lookup table for the nodes of the upper levels levels of the K2Tree (k^(2 * levels) entries, at most getMaxLookupTableLevels() levels),
+    // so that point queries start their descent at the corresponding node and skip the accesses to T on these levels
+    // (like the counting index, the table is not written by serialize())
+    void buildLookupTable(size_type levels) {
+
+        this->checkWritable("buildLookupTable");
+
+        size_type maxLevels = getMaxLookupTableLevels();
+        if ((levels == 0) || (levels > maxLevels)) {
+            throw std::runtime_error("Number of levels for the lookup table has to be between 1 and " + std::to_string(maxLevels) + " (see getMaxLookupTableLevels()).");
+        }
+
+        size_type width = size_type(pow(k_, levels));
+        size_type n = nPrime_ / width;
+        topNodes_.assign(width * width, 0);
+
+        for (size_type r = 0; r < width; r++) {
+            for (size_type c = 0; c < width; c++) {
+
+                // descend to the node covering submatrix (r, c) or stop at its closest (empty) ancestor
+                size_type p = r * n;
+                size_type q = c * n;
+                size_type m = nPrime_ / k_;
+                size_type z = (p / m) * k_ + q / m;
+                for (size_type l = 1; (l < levels) && (z < T_.size()) && T_[z]; l++) {
+
+                    p %= m;
+                    q %= m;
+                    m /= k_;
+                    z = R_.rank(z + 1) * k_ * k_ + (p / m) * k_ + q / m;
+
+                }
+
+                topNodes_[r * width + c] = z;
+
+            }
+        }
+
+        tableH_ = levels;
+        tableN_ = n;
+
+    }
+
+    bool hasLookupTable() const {
+        return !topNodes_.empty();
+    }
+
+    // returns the largest number of levels accepted by buildLookupTable() (at most the height): the table may take at most
+    // K2TREES_LOOKUP_TABLE_MAX_RATIO times the space of T and its rank data structure, only the table of the first level is always permitted
+    size_type getMaxLookupTableLevels() const {
+
+        double budget = K2TREES_LOOKUP_TABLE_MAX_RATIO * (sdsl::size_in_bytes(T_) + sdsl::size_in_bytes(R_)) / sizeof(size_type); // in entries
+
+        size_type levels = std::min((size_type) 1, h_);
+        while ((levels < h_) && (pow(k_, 2 * (levels + 1)) <= budget)) {
+            levels++;
+        }
+
+        return levels;
+
+    }
+
+    // replaces the last level L by a dictionary of its distinct k*k blocks (sorted by decreasing frequency)
+    // and the DAC-encoded dictionary index of every leaf block (the vocabulary of leaf blocks of Brisaboa et al.),
+    // which saves space when few distinct blocks make up most of L; afterwards, setNull() is no longer supported
+    void compressLeaves() {
+
+        this->checkWritable("compressLeaves");
+
+        if (L_.empty()) {
+            return;
+        }
+
+        compressedL_ = LeafDictionary<bool>(L_, k_ * k_);
+        L_ = bit_vector_type(0);
+
+    }
+
+    bool hasCompressedLeaves() const {
+        return !compressedL_.empty();
+    }
+
 
     BasicK2Tree* clone() const override {
         return new BasicK2Tree<elem_type>(*this);
     }
 
-    void print(bool all = false) override {
+    void print(bool all = false) const override {
 
         std::cout << "### Parameters ###" << std::endl;
         std::cout << "h  = " << h_ << std::endl;
@@ -2186,7 +3437,7 @@ public:
             std::cout << std::endl << std::endl;
 
             std::cout << "### L ###" << std::endl;
-            for (size_type i = 0; i < L_.size(); i++) std::cout << L_[i];
+            for (size_type i = 0; i < numLeaves(); i++) std::cout << leaf(i);
             std::cout << std::endl << std::endl;
 
             std::cout << "### R ###" << std::endl;
@@ -2197,28 +3448,228 @@ public:
 
     }
 
-    // note: can "invalidate" the data structure (containsLink() probably won't work correctly afterwards)
-    void setNull(size_type i, size_type j) override {
-        setInit(i, j);
+    void serialize(std::ostream& out) const override {
+
+        writeHeader(out, "BasicK2Tree<bool>", sizeof(elem_type));
+
+        writeValue(out, h_);
+        writeValue(out, k_);
+        writeValue(out, nPrime_);
+        writeValue(out, null_);
+
+        T_.serialize(out);
+        L_.serialize(out);
+        compressedL_.serialize(out);
+        R_.serialize(out);
+        emptyNodes_.serialize(out);
+
+    }
+
+    void load(std::istream& in) override {
+
+        this->checkWritable("load");
+
+        unsigned int version = readHeader(in, "BasicK2Tree<bool>", sizeof(elem_type));
+
+        readValue(in, h_);
+        readValue(in, k_);
+        readValue(in, nPrime_);
+        readValue(in, null_);
+
+        T_.load(in);
+        L_.load(in);
+        if (version >= 6) {
+            compressedL_.load(in);
+        } else {
+            compressedL_ = LeafDictionary<bool>();
+        }
+        R_.load(in, &T_);
+        if (version >= 4) {
+            emptyNodes_.load(in);
+        } else {
+            emptyNodes_ = bit_vector_type();
+        }
+
+        countSamples_.clear();
+        topNodes_.clear();
+        tableH_ = 0;
+        tableN_ = 0;
+
+    }
+
+    // note: emptied subtrees are only marked, compact() removes them from the internal structure
+    void setNull(size_type i, size_type j) override {
+
+        this->checkWritable("setNull");
+
+        if (!compressedL_.empty()) {
+            throw std::runtime_error("setNull() is not supported after compressLeaves().");
+        }
+
+        setInit(i, j);
+    }
+
+    // rebuilds the internal structure from the remaining elements, so that the subtrees emptied by setNull() are removed
+    // (the size of the relation matrix remains unchanged, the counting index and the lookup table are rebuilt if present)
+    void compact() override {
+
+        this->checkWritable("compact");
+
+        if (emptyNodes_.empty()) {
+            return;
+        }
+
+        positions_type pairs = getAllPositions();
+        bool compressed = !compressedL_.empty();
+
+        T_ = bit_vector_type();
+        L_ = bit_vector_type();
+        compressedL_ = LeafDictionary<bool>();
+        emptyNodes_ = bit_vector_type();
+
+        if (!pairs.empty()) {
+            buildFromListsInplace(pairs, 1);
+        }
+
+        if (compressed) {
+            compressLeaves();
+        }
+
+        R_ = rank_type(&T_);
+
+        if (!countSamples_.empty()) {
+            buildCountingIndex();
+        }
+
+        if (!topNodes_.empty()) {
+            buildLookupTable(std::min(tableH_, getMaxLookupTableLevels()));
+        }
+
+    }
+
+    SizeBreakdown sizeInBytes() const override {
+
+        SizeBreakdown s;
+        s.T = sdsl::size_in_bytes(T_);
+        s.L = sdsl::size_in_bytes(L_) + compressedL_.sizeInBytes();
+        s.rank = sdsl::size_in_bytes(R_);
+        s.aux = sdsl::size_in_bytes(emptyNodes_) + vectorBytes(countSamples_) + vectorBytes(topNodes_);
+        s.other = sizeof(*this);
+
+        return s;
+
     }
 
-    size_type getFirstSuccessor(size_type i) override {
+    size_type getFirstSuccessor(size_type i) const override {
 //        return firstSuccessorInit(i);
         return firstSuccessorPositionIterative(i);
     }
 
+    std::vector<size_type> expandFrontier(const std::vector<size_type>& frontier, std::vector<bool>& visited) const override {
+
+        auto rows = this->prepareFrontier(frontier, visited);
+        std::vector<size_type> cols;
+
+        if ((numLeaves() != 0) && !rows.empty()) {
+            frontierPos(cols, visited, nPrime_, 0, 0, rows.cbegin(), rows.cend(), 0);
+        }
+
+        this->finishFrontier(cols, visited);
+
+        return cols;
+
+    }
+
+    /*
+     * Set operations (traverse both K2Trees level by level at the same time without decompressing them,
+     * only supported between K2Trees with the same arities and height)
+     */
+
+    // returns a K2Tree representing the union of both relations
+    BasicK2Tree getUnion(const BasicK2Tree& other) const {
+        return combine(other, SET_UNION);
+    }
+
+    // returns a K2Tree representing the pairs of this K2Tree that are also contained in other
+    BasicK2Tree getIntersection(const BasicK2Tree& other) const {
+        return combine(other, SET_INTERSECTION);
+    }
+
+    // returns a K2Tree representing the pairs of this K2Tree that are not contained in other
+    BasicK2Tree getDifference(const BasicK2Tree& other) const {
+        return combine(other, SET_DIFFERENCE);
+    }
+
+    /*
+     * Boolean matrix product R x S, i.e. the relational join of R (this K2Tree) and S (other)
+     * (only supported between K2Trees with the same arity and height, the top-level quadrants of the result are processed by up to numThreads threads)
+     */
+
+    // returns all pairs (i,j) such that (i,m) in R and (m,j) in S for some m (in no particular order)
+    positions_type getProductPositions(const BasicK2Tree& other, const size_type numThreads = 1) const {
+
+        checkProductArguments(other);
+
+        positions_type pairs;
+
+        if ((numLeaves() == 0) || (other.numLeaves() == 0)) {
+            return pairs;
+        }
+
+        productInit(other, pairs, numThreads);
+
+        return pairs;
+
+    }
+
+    // returns a K2Tree representing R x S
+    BasicK2Tree getProduct(const BasicK2Tree& other, const size_type numThreads = 1) const {
+
+        auto pairs = getProductPositions(other, numThreads);
+
+        BasicK2Tree res;
+        res.h_ = h_;
+        res.k_ = k_;
+        res.nPrime_ = nPrime_;
+        res.null_ = false;
+
+        if (!pairs.empty()) {
+            res.buildFromListsInplace(pairs, numThreads);
+        }
+
+        res.R_ = rank_type(&res.T_);
+
+        return res;
+
+    }
+
 
 
 private:
     // representation of all but the last levels of the K2Tree (internal structure)
-    bit_vector_type T_;
+    level_vector_type T_;
 
     // representation of the last level of the K2Tree (actual values of the relation)
     bit_vector_type L_;
 
+    // (optional) compressed representation of the last level, replaces L_ after compressLeaves()
+    LeafDictionary<bool> compressedL_;
+
     // rank data structure for navigation in T_
     rank_type R_;
 
+    // marks the internal nodes whose subtrees have been emptied by setNull() (empty if there are none), see compact()
+    bit_vector_type emptyNodes_;
+
+    // (optional) counting index: number of non-null entries in L_[0..s * K2TREES_COUNT_SAMPLE_RATE) for all samples s, followed by the total number
+    std::vector<size_type> countSamples_;
+
+    // (optional) lookup table: node on level tableH_ covering submatrix (r, c) of edge length tableN_ (or its closest empty ancestor)
+    // at position r * (nPrime_ / tableN_) + c
+    std::vector<size_type> topNodes_;
+    size_type tableH_ = 0;
+    size_type tableN_ = 0;
+
     size_type h_; // height of the K2Tree
     size_type k_; // arity of the K2Tree
     size_type nPrime_; // edge length of the represented relation matrix
@@ -2300,6 +3751,58 @@ private:
 
     }
 
+    /* helper method for streaming construction */
+
+    bool buildFromStream(PairReader<bool>& reader, std::vector<std::vector<bool>>& levels, size_type n, size_type l, size_type p, size_type q) {
+
+        // as the pairs are sorted, the submatrix is empty if the next pair does not lie within it
+        if (!reader.hasNext()) {
+            return false;
+        }
+
+        auto& rec = reader.peek();
+        if (!((rec.row >= p) && (rec.row < p + n) && (rec.col >= q) && (rec.col < q + n))) {
+            return false;
+        }
+
+        std::vector<bool> C(k_ * k_);
+
+        if (l == h_) {
+
+            for (size_type i = 0; i < k_; i++) {
+                for (size_type j = 0; j < k_; j++) {
+
+                    if (reader.hasNext() && (reader.peek().row == p + i) && (reader.peek().col == q + j)) {
+
+                        C[i * k_ + j] = true;
+                        reader.next();
+
+                    }
+
+                }
+            }
+
+        } else {
+
+            for (size_type i = 0; i < k_; i++) {
+                for (size_type j = 0; j < k_; j++) {
+                    C[i * k_ + j] = buildFromStream(reader, levels, n / k_, l + 1, p + i * (n / k_), q + j * (n / k_));
+                }
+            }
+
+        }
+
+        if (isAllZero(C)) {
+            return false;
+        } else {
+
+            levels[l - 1].insert(levels[l - 1].end(), C.begin(), C.end());
+            return true;
+
+        }
+
+    }
+
     /* helper methods for construction from relation lists via temporary tree */
 
     void buildFromListsViaTree(const RelationLists& lists) {// 3.3.3, so far without special bit vectors without initialisation
@@ -2405,8 +3908,8 @@ private:
 
         } else {
 
-            std::vector<bool> T, L;
-            NaiveDynamicRank R;
+            DynamicVector<bool> T, L;
+            DynamicRank R;
 
             for (size_type i = 0; i < lists.size(); i++) {
                 for (size_type j = 0; j < lists[i].size(); j++) {
@@ -2415,12 +3918,10 @@ private:
             }
 
             L_ = bit_vector_type(L.size());
-            std::move(L.begin(), L.end(), L_.begin());
-            L.clear();
-            L.shrink_to_fit();
+            L.copyTo(L_.begin());
 
             T_ = bit_vector_type(T.size());
-            std::move(T.begin(), T.end(), T_.begin());
+            T.copyTo(T_.begin());
 
         }
 
@@ -2428,12 +3929,12 @@ private:
 
     }
 
-    void insertInit(std::vector<bool>& T, std::vector<bool>& L, NaiveDynamicRank& R, size_type p, size_type q) {
+    void insertInit(DynamicVector<bool>& T, DynamicVector<bool>& L, DynamicRank& R, size_type p, size_type q) {
 
         if (T.empty()) {
 
-            T = std::vector<bool>(k_ * k_);
-            R = NaiveDynamicRank(T);
+            T = DynamicVector<bool>(k_ * k_, false);
+            R = DynamicRank(std::vector<bool>(k_ * k_));
 
         }
 
@@ -2441,7 +3942,7 @@ private:
 
     }
 
-    void insert(std::vector<bool>& T, std::vector<bool>& L, NaiveDynamicRank& R, size_type n, size_type p, size_type q, size_type z, size_type l) {
+    void insert(DynamicVector<bool>& T, DynamicVector<bool>& L, DynamicRank& R, size_type n, size_type p, size_type q, size_type z, size_type l) {
 
         if (!T[z]) {
 
@@ -2452,12 +3953,12 @@ private:
 
             if ((l + 1) == h_) {
 
-                L.insert(L.begin() + R.rank(z + 1) * k_ * k_ - T.size(), k_ * k_, 0);
+                L.insert(R.rank(z + 1) * k_ * k_ - T.size(), k_ * k_, 0);
                 L[y - T.size()] = 1;
 
             } else {
 
-                T.insert(T.begin() + R.rank(z + 1) * k_ * k_, k_ * k_, 0);
+                T.insert(R.rank(z + 1) * k_ * k_, k_ * k_, 0);
                 R.insert(R.rank(z + 1) * k_ * k_ + 1, k_ * k_);
 
                 insert(T, L, R, n / k_, p % (n / k_), q % (n / k_), y, l + 1);
@@ -2478,105 +3979,88 @@ private:
 
     }
 
-    /* helper methods for inplace construction from single list of pairs */
-
-    size_type computeKey(const positions_type::value_type& pair, const Subproblem& sp, size_type width) {
-        return ((pair.first - sp.firstRow) / width) * k_ + (pair.second - sp.firstCol) / width;
-    }
-
-    void countingSort(positions_type& pairs, std::vector<std::pair<size_type, size_type>>& intervals, const Subproblem& sp, size_type width, size_type sup) {
+    /* helper method for construction from the radix-sorted keys of a single list of pairs */
 
-        std::vector<size_type> counts(sup);
+    void buildFromSortedKeys(positions_type& pairs, const size_type numThreads) {
 
-        // determine key frequencies
-        for (size_type i = sp.left; i < sp.right; i++) {
-            counts[computeKey(pairs[i], sp, width)]++;
-        }
-
-        // determine starting index for each key
-        size_type total = 0;
-        size_type tmp;
-
-        for (size_type key = 0; key < sup; key++) {
+        std::vector<size_type> ks(h_, k_);
 
-            tmp = counts[key];
-            counts[key] = total;
-            total += tmp;
+        std::vector<bool> T, L;
+        if (!buildLevelsFromSortedKeys(pairs, ks, ks, false, T, L, numThreads)) {
 
-            intervals[key].first = counts[key];
-            intervals[key].second = total;
+            buildFromListsInplace(pairs, numThreads); // the keys do not fit into 64 bits
+            return;
 
         }
 
-        // reorder pairs of current subproblem
-        positions_type tmpPairs(sp.right - sp.left + 1);
-        for (size_type i = sp.left; i < sp.right; i++) {
-
-            tmpPairs[counts[computeKey(pairs[i], sp, width)]] = pairs[i];
-            counts[computeKey(pairs[i], sp, width)]++;
-
-        }
+        L_ = bit_vector_type(L.size());
+        std::move(L.begin(), L.end(), L_.begin());
+        L.clear();
+        L.shrink_to_fit();
 
-        for (size_type i = sp.left; i < sp.right; i++) {
-            pairs[i] = tmpPairs[i - sp.left];
-        }
+        T_ = bit_vector_type(T.size());
+        std::move(T.begin(), T.end(), T_.begin());
 
     }
 
-    void buildFromListsInplace(positions_type& pairs) {// 3.3.5
+    /* helper methods for inplace construction from single list of pairs */
 
-        std::queue<Subproblem> queue;
-        Subproblem sp;
-        size_type S;
-        std::vector<std::pair<size_type, size_type>> intervals(k_ * k_);
-        std::vector<bool> T, L;
-        bit_vector_type appToL;
+    size_type computeKey(const positions_type::value_type& pair, const Subproblem& sp, size_type width) {
+        return ((pair.first - sp.firstRow) / width) * k_ + (pair.second - sp.firstCol) / width;
+    }
 
-        queue.push(Subproblem(0, nPrime_ - 1, 0, nPrime_ - 1, 0, pairs.size()));
+    void countingSort(positions_type& pairs, LevelBuildState<positions_type, bool>& state, const Subproblem& sp, size_type width, size_type sup, size_type numThreads) {
+        countingSortByKey(pairs, sp.left, sp.right, sup, [&](const positions_type::value_type& pair) { return computeKey(pair, sp, width); }, state.intervals, state.counts, state.tmpPairs, numThreads);
+    }
 
-        while (!queue.empty()) {
+    void buildFromListsInplace(positions_type& pairs, const size_type numThreads) {// 3.3.5 (level by level, the subproblems of each level are distributed among the threads)
 
-            sp = queue.front();
-            queue.pop();
+        std::vector<Subproblem> level(1, Subproblem(0, nPrime_ - 1, 0, nPrime_ - 1, 0, pairs.size()));
+        std::vector<LevelBuildState<positions_type, bool>> states(std::max(numThreads, (size_type) 1));
+        std::vector<bool> T, L;
+        size_type S = nPrime_;
 
-            S = sp.lastRow - sp.firstRow + 1;
+        auto process = [&](LevelBuildState<positions_type, bool>& state, const Subproblem& sp, size_type sortThreads) {
 
             if (S > k_) {
 
-                countingSort(pairs, intervals, sp, S / k_, k_ * k_);
+                countingSort(pairs, state, sp, S / k_, k_ * k_, sortThreads);
 
                 for (size_type i = 0; i < k_ * k_; i++) {
 
-                    if (intervals[i].first < intervals[i].second) {
+                    if (state.intervals[i].first < state.intervals[i].second) {
 
-                        T.push_back(true);
-                        queue.push(Subproblem(
+                        state.T.push_back(true);
+                        state.next.push_back(Subproblem(
                                 sp.firstRow + (i / k_) * (S / k_),
                                 sp.firstRow + (i / k_ + 1) * (S / k_) - 1,
                                 sp.firstCol + (i % k_) * (S / k_),
                                 sp.firstCol + (i % k_ + 1) * (S / k_) - 1,
-                                sp.left + intervals[i].first,
-                                sp.left + intervals[i].second
+                                sp.left + state.intervals[i].first,
+                                sp.left + state.intervals[i].second
                         ));
 
                     } else {
-                        T.push_back(false);
+                        state.T.push_back(false);
                     }
 
                 }
 
             } else {
 
-                appToL = bit_vector_type(k_ * k_);
+                size_type offset = state.L.size();
+                state.L.resize(offset + k_ * k_);
 
                 for (size_type i = sp.left; i < sp.right; i++) {
-                    appToL[(pairs[i].first - sp.firstRow) * k_ + (pairs[i].second - sp.firstCol)] = true;
+                    state.L[offset + (pairs[i].first - sp.firstRow) * k_ + (pairs[i].second - sp.firstCol)] = true;
                 }
 
-                L.insert(L.end(), appToL.begin(), appToL.end());
-
             }
 
+        };
+
+        for (; !level.empty(); S /= k_) {
+            processLevel(level, states, numThreads, T, L, process);
         }
 
         L_ = bit_vector_type(L.size());
@@ -2592,25 +4076,154 @@ private:
 
     /* areRelated() */
 
-    bool checkLinkInit(size_type p, size_type q) {
-        return (L_.empty()) ? false : checkLink(nPrime_ / k_, p % (nPrime_ / k_), q % (nPrime_ / k_), (p / (nPrime_ / k_)) * k_ + q / (nPrime_ / k_));
+    bool checkLinkInit(size_type p, size_type q) const {
+
+        size_type x;
+        if (fixedArityLeafPosition(p, q, x)) {
+            return (x < numLeaves()) && leaf(x);
+        }
+
+        if (tableH_ != 0) {
+            return (numLeaves() == 0) ? false : checkLink(tableN_, p % tableN_, q % tableN_, topNodes_[(p / tableN_) * (nPrime_ / tableN_) + q / tableN_]);
+        }
+
+        return (numLeaves() == 0) ? false : checkLink(nPrime_ / k_, p % (nPrime_ / k_), q % (nPrime_ / k_), (p / (nPrime_ / k_)) * k_ + q / (nPrime_ / k_));
+
     }
 
-    bool checkLink(size_type n, size_type p, size_type q, size_type z) {
+    bool checkLink(size_type n, size_type p, size_type q, size_type z) const {
 
         if (z >= T_.size()) {
-            return L_[z - T_.size()];
+            return leaf(z - T_.size());
         } else {
             return T_[z] ? checkLink(n / k_, p % (n / k_), q % (n / k_), R_.rank(z + 1) * k_ * k_ + (p / (n / k_)) * k_ + q / (n / k_)) : false;
         }
 
     }
 
+    /* helper methods for point queries with compile-time arities */
+
+    // determines the position x in L of (p, q) (numLeaves() if (p, q) lies in an empty submatrix) via the variant
+    // for the compile-time arity k_ and returns true, returns false if k_ is none of the commonly used arities 2 and 4
+    bool fixedArityLeafPosition(size_type p, size_type q, size_type& x) const {
+
+        switch (k_) {
+            case 2:
+                x = leafPosition<2>(p, q);
+                return true;
+            case 4:
+                x = leafPosition<4>(p, q);
+                return true;
+            default:
+                return false;
+        }
+
+    }
+
+    // iterative descent for a compile-time arity K (a power of two):
+    // as the edge length of every submatrix is a power of K, all divisions / remainders become shifts / masks
+    template<size_type K>
+    size_type leafPosition(size_type p, size_type q) const {
+
+        // start at the node of the lookup table (if any) or at the child of the root
+        size_type s = logTwo(K) * (h_ - std::max(tableH_, (size_type) 1));
+        size_type z = (tableH_ != 0) ? topNodes_[(p >> s) * (nPrime_ >> s) + (q >> s)] : (p >> s) * K + (q >> s);
+
+        while (z < T_.size()) {
+
+            if (!T_[z]) {
+                return numLeaves();
+            }
+
+            s -= logTwo(K);
+            z = R_.rank(z + 1) * K * K + ((p >> s) & (K - 1)) * K + ((q >> s) & (K - 1));
+
+        }
+
+        return z - T_.size();
+
+    }
+
+    /* helper methods for batch queries (isNotNull() / getElement() on several positions) */
+
+    // calls report(x, pos) for every query x whose position is represented in L_ (at pos),
+    // every submatrix shared by several queries is descended into only once
+    template<typename F>
+    void batchInit(const positions_type& queries, F report) const {
+
+        if (numLeaves() == 0 || queries.empty()) return;
+
+        std::vector<size_type> order(queries.size());
+        std::vector<size_type> buffer(queries.size());
+        std::vector<std::vector<size_type>> ends(h_); // ends of the child groups, one array per level
+
+        for (size_type x = 0; x < queries.size(); x++) {
+            order[x] = x;
+        }
+
+        batch(queries, order, buffer, ends, report, 0, queries.size(), nPrime_, 0, 0, 0, 0);
+
+    }
+
+    template<typename F>
+    void batch(const positions_type& queries, std::vector<size_type>& order, std::vector<size_type>& buffer, std::vector<std::vector<size_type>>& ends, F& report, size_type first, size_type last, size_type n, size_type p, size_type q, size_type z, size_type l) const {
+
+        size_type m = n / k_;
+        size_type numChildren = k_ * k_;
+
+        auto& e = ends[l];
+        e.assign(numChildren, 0);
+
+        // group the queries order[first..last) by the child containing them (stable counting sort)
+        for (size_type x = first; x < last; x++) {
+            e[((queries[order[x]].first - p) / m) * k_ + (queries[order[x]].second - q) / m]++;
+        }
+
+        size_type sum = first;
+        for (size_type c = 0; c < numChildren; c++) {
+            size_type tmp = e[c];
+            e[c] = sum;
+            sum += tmp;
+        }
+
+        for (size_type x = first; x < last; x++) {
+            buffer[e[((queries[order[x]].first - p) / m) * k_ + (queries[order[x]].second - q) / m]++] = order[x];
+        }
+
+        std::copy(buffer.begin() + first, buffer.begin() + last, order.begin() + first);
+
+        // afterwards, the queries of child c are order[(c == 0 ? first : e[c - 1])..e[c])
+        size_type start = first;
+        for (size_type c = 0; c < numChildren; c++) {
+
+            size_type end = e[c];
+
+            if (start < end) {
+
+                size_type y = z + c;
+
+                if (y >= T_.size()) {
+                    for (size_type x = start; x < end; x++) {
+                        report(order[x], y - T_.size());
+                    }
+                } else if (T_[y]) {
+                    batch(queries, order, buffer, ends, report, start, end, m, p + (c / k_) * m, q + (c % k_) * m, R_.rank(y + 1) * k_ * k_, l + 1);
+                }
+
+            }
+
+            start = end;
+
+        }
+
+    }
+
+
     /* getSuccessors() */
 
-    void allSuccessorPositionsIterative(std::vector<size_type>& succs, size_type p) {
+    void allSuccessorPositionsIterative(std::vector<size_type>& succs, size_type p) const {
 
-        if (L_.empty()) return;
+        if (numLeaves() == 0) return;
 
         std::queue<SubrowInfo> queue, nextLevelQueue;
         size_type lenT = T_.size();
@@ -2618,11 +4231,7 @@ private:
         if (lenT == 0) {
 
             size_type offset = p * nPrime_;
-            for (size_type i = 0; i < nPrime_; i++) {
-                if (L_[offset + i]) {
-                    succs.push_back(i);
-                }
-            }
+            forEachLeaf(offset, nPrime_, [&](size_type x) { succs.push_back(x - offset); return true; });
 
         } else {
 
@@ -2630,6 +4239,7 @@ private:
             size_type n = nPrime_/ k_;
             size_type relP = p;
             for (size_type j = 0, dq = 0, z = k_ * (relP / n); j < k_; j++, dq += n, z++) {
+                K2TREES_COUNT(queuePushes);
                 queue.push(SubrowInfo(dq, z));
             }
 
@@ -2642,11 +4252,12 @@ private:
 
                     auto& cur = queue.front();
 
-                    if (T_[cur.z]) {
+                    if (hasChildren(cur.z)) {
 
                         auto y = R_.rank(cur.z + 1) * k_ * k_ + k_ * (relP / n);
 
                         for (size_type j = 0, newDq = cur.dq; j < k_; j++, newDq += n, y++) {
+                            K2TREES_COUNT(queuePushes);
                             nextLevelQueue.push(SubrowInfo(newDq, y));
                         }
 
@@ -2665,15 +4276,10 @@ private:
 
                 auto& cur = queue.front();
 
-                if (T_[cur.z]) {
+                if (hasChildren(cur.z)) {
 
                     auto y = R_.rank(cur.z + 1) * k_ * k_ + k_ * (relP / n) - lenT;
-
-                    for (size_type j = 0, newDq = cur.dq; j < k_; j++, newDq += n, y++) {
-                        if (L_[y]) {
-                            succs.push_back(newDq);
-                        }
-                    }
+                    forEachLeaf(y, k_, [&](size_type x) { succs.push_back(cur.dq + x - y); return true; });
 
                 }
 
@@ -2685,9 +4291,9 @@ private:
 
     }
 
-    void successorsInit(std::vector<size_type>& succs, size_type p) {
+    void successorsInit(std::vector<size_type>& succs, size_type p) const {
 
-        if (!L_.empty()) {
+        if (numLeaves() != 0) {
 
             size_type y = k_ * (p / (nPrime_ / k_));
 
@@ -2699,17 +4305,17 @@ private:
 
     }
 
-    void successors(std::vector<size_type>& succs, size_type n, size_type p, size_type q, size_type z) {
+    void successors(std::vector<size_type>& succs, size_type n, size_type p, size_type q, size_type z) const {
 
         if (z >= T_.size()) {
 
-            if (L_[z - T_.size()]) {
+            if (leaf(z - T_.size())) {
                 succs.push_back(q);
             }
 
         } else {
 
-            if (T_[z]) {
+            if (hasChildren(z)) {
 
                 size_type y = R_.rank(z + 1) * k_ * k_ + k_ * (p / (n / k_));
 
@@ -2724,43 +4330,82 @@ private:
 
     }
 
-    /* getFirstSuccessor() */
-
-    size_type firstSuccessorPositionIterative(size_type p) {
+    /* expandFrontier() */
 
-        if (L_.empty()) return nPrime_;
+    // expands the rows [first, last) of the frontier within the submatrix of size n x n whose upper left corner is (p,q)
+    // and whose children start at position y, the subtrees shared by several rows are only traversed once
+    void frontierPos(std::vector<size_type>& cols, std::vector<bool>& visited, size_type n, size_type p, size_type q,
+                     std::vector<size_type>::const_iterator first, std::vector<size_type>::const_iterator last, size_type y) const {
 
-        if (T_.size() == 0) {
+        for (size_type i = 0; (i < k_) && (first != last); i++) {
 
-            size_type offset = p * nPrime_;
-            for (size_type i = 0; i < nPrime_; i++) {
-                if (L_[offset + i]) {
-                    return i;
-                }
+            // rows of the frontier that lie in the i-th row of children
+            auto next = first;
+            while ((next != last) && (*next < p + (i + 1) * (n / k_))) {
+                next++;
             }
 
-        } else {
+            if (first != next) {
 
-            std::stack<ExtendedSubrowInfo> stack;
-            stack.emplace(nPrime_ / k_, nPrime_ / k_, p % (nPrime_ / k_), 0, k_ * (p / (nPrime_ / k_)), 0);
+                for (size_type j = 0; j < k_; j++) {
 
-            while (!stack.empty()) {
+                    size_type z = y + i * k_ + j;
 
-                auto& cur = stack.top();
+                    if (z >= T_.size()) {
 
-                if (cur.j == k_) {
-                    stack.pop();
-                } else {
+                        if (leaf(z - T_.size())) {
+                            this->addToFrontier(q + j, cols, visited);
+                        }
 
-                    if (cur.z >= T_.size()) {
+                    } else if (hasChildren(z)) {
+                        frontierPos(cols, visited, n / k_, p + i * (n / k_), q + j * (n / k_), first, next, R_.rank(z + 1) * k_ * k_);
+                    }
 
-                        if (L_[cur.z - T_.size()]) {
+                }
+
+            }
+
+            first = next;
+
+        }
+
+    }
+
+    /* getFirstSuccessor() */
+
+    size_type firstSuccessorPositionIterative(size_type p) const {
+
+        if (numLeaves() == 0) return nPrime_;
+
+        if (T_.size() == 0) {
+
+            size_type offset = p * nPrime_;
+            return findFirstLeaf(offset, nPrime_) - offset;
+
+        } else {
+
+            std::stack<ExtendedSubrowInfo> stack;
+            K2TREES_COUNT(queuePushes);
+            stack.emplace(nPrime_ / k_, nPrime_ / k_, p % (nPrime_ / k_), 0, k_ * (p / (nPrime_ / k_)), 0);
+
+            while (!stack.empty()) {
+
+                auto& cur = stack.top();
+
+                if (cur.j == k_) {
+                    stack.pop();
+                } else {
+
+                    if (cur.z >= T_.size()) {
+
+                        if (leaf(cur.z - T_.size())) {
                             return cur.dq;
                         }
 
                     } else {
 
-                        if (T_[cur.z]) {
+                        if (hasChildren(cur.z)) {
+                            K2TREES_COUNT(queuePushes);
                             stack.emplace(cur.nr / k_, cur.nc / k_, cur.p % (cur.nr / k_), cur.dq, R_.rank(cur.z + 1) * k_ * k_ + k_ * (cur.p / (cur.nr / k_)), 0);
                         }
 
@@ -2779,11 +4424,11 @@ private:
 
     }
 
-    size_type firstSuccessorInit(size_type p) {
+    size_type firstSuccessorInit(size_type p) const {
 
         size_type pos = nPrime_;
 
-        if (!L_.empty()) {
+        if (numLeaves() != 0) {
 
             size_type y = k_ * (p / (nPrime_ / k_));
 
@@ -2797,19 +4442,19 @@ private:
 
     }
 
-    size_type firstSuccessor(size_type n, size_type p, size_type q, size_type z) {
+    size_type firstSuccessor(size_type n, size_type p, size_type q, size_type z) const {
 
         size_type pos = nPrime_;
 
         if (z >= T_.size()) {
 
-            if (L_[z - T_.size()]) {
+            if (leaf(z - T_.size())) {
                 pos = q;
             }
 
         } else {
 
-            if (T_[z]) {
+            if (hasChildren(z)) {
 
                 size_type y = R_.rank(z + 1) * k_ * k_ + k_ * (p / (n / k_));
 
@@ -2827,9 +4472,9 @@ private:
 
     /* getPredecessors() */
 
-    void predecessorsInit(std::vector<size_type>& preds, size_type q) {
+    void predecessorsInit(std::vector<size_type>& preds, size_type q) const {
 
-        if (!L_.empty()) {
+        if (numLeaves() != 0) {
 
             size_type y = q / (nPrime_ / k_);
 
@@ -2841,17 +4486,17 @@ private:
 
     }
 
-    void predecessors(std::vector<size_type>& preds, size_type n, size_type q, size_type p, size_type z) {
+    void predecessors(std::vector<size_type>& preds, size_type n, size_type q, size_type p, size_type z) const {
 
         if (z >= T_.size()) {
 
-            if (L_[z - T_.size()]) {
+            if (leaf(z - T_.size())) {
                 preds.push_back(p);
             }
 
         } else {
 
-            if (T_[z]) {
+            if (hasChildren(z)) {
 
                 size_type y = R_.rank(z + 1) * k_ * k_ + q / (n / k_);
 
@@ -2867,9 +4512,9 @@ private:
 
     /* getRange() */
 
-    void rangeInit(positions_type& pairs, size_type p1, size_type p2, size_type q1, size_type q2) {
+    void rangeInit(positions_type& pairs, size_type p1, size_type p2, size_type q1, size_type q2) const {
 
-        if (!L_.empty()) {
+        if (numLeaves() != 0) {
 
             size_type p1Prime, p2Prime;
 
@@ -2898,19 +4543,31 @@ private:
 
     }
 
-    void range(positions_type& pairs, size_type n, size_type p1, size_type p2, size_type q1, size_type q2, size_type dp, size_type dq, size_type z) {
+    void range(positions_type& pairs, size_type n, size_type p1, size_type p2, size_type q1, size_type q2, size_type dp, size_type dq, size_type z) const {
 
         if (z >= T_.size()) {
 
-            if (L_[z - T_.size()]) {
+            if (leaf(z - T_.size())) {
                 pairs.push_back(std::make_pair(dp, dq));
             }
 
         } else {
 
-            if (T_[z]) {
+            if (hasChildren(z)) {
 
                 size_type y = R_.rank(z + 1) * k_ * k_;
+
+                if (n == k_) {
+
+                    // the children are leaves: scan the rows of the leaf chunk word by word
+                    for (size_type i = p1, x = y - T_.size() + k_ * p1; i <= p2; i++, x += k_) {
+                        forEachLeaf(x + q1, q2 - q1 + 1, [&](size_type c) { pairs.push_back(std::make_pair(dp + i, dq + c - x)); return true; });
+                    }
+
+                    return;
+
+                }
+
                 size_type p1Prime, p2Prime;
 
                 for (size_type i = p1 / (n / k_); i <= p2 / (n / k_); i++) {
@@ -2940,18 +4597,180 @@ private:
 
     }
 
-    /* linkInRange() */
+    /* forEachSuccessorPosition() */
+
+    bool successorsVisitInit(const std::function<bool(size_type)>& visitor, size_type p) const {
+
+        if (numLeaves() != 0) {
+
+            size_type y = k_ * (p / (nPrime_ / k_));
+
+            for (size_type j = 0; j < k_; j++) {
+                if (!successorsVisit(visitor, nPrime_ / k_, p % (nPrime_ / k_), (nPrime_ / k_) * j, y + j)) return false;
+            }
+
+        }
+
+        return true;
+
+    }
+
+    bool successorsVisit(const std::function<bool(size_type)>& visitor, size_type n, size_type p, size_type q, size_type z) const {
+
+        if (z >= T_.size()) {
 
-    bool linkInRangeInit(size_type p1, size_type p2, size_type q1, size_type q2) {
+            if (leaf(z - T_.size())) {
+                if (!visitor(q)) return false;
+            }
+
+        } else {
+
+            if (hasChildren(z)) {
+
+                size_type y = R_.rank(z + 1) * k_ * k_ + k_ * (p / (n / k_));
+
+                for (size_type j = 0; j < k_; j++) {
+                    if (!successorsVisit(visitor, n / k_, p % (n / k_), q + (n / k_) * j, y + j)) return false;
+                }
+
+            }
+
+        }
+
+        return true;
 
-        if (!L_.empty()) {
+    }
+
+    /* forEachPredecessorPosition() */
+
+    bool predecessorsVisitInit(const std::function<bool(size_type)>& visitor, size_type q) const {
+
+        if (numLeaves() != 0) {
 
-            // dividing by k_ (as stated in the paper) in not correct,
-            // because it does not use the size of the currently considered submatrix but of its submatrices
-            if ((p1 == 0) && (q1 == 0) && (p2 == (nPrime_ /*/ k_*/ - 1)) && (q2 == (nPrime_ /*/ k_*/ - 1))) {
-                return 1;
+            size_type y = q / (nPrime_ / k_);
+
+            for (size_type i = 0; i < k_; i++) {
+                if (!predecessorsVisit(visitor, nPrime_ / k_, q % (nPrime_ / k_), (nPrime_ / k_) * i, y + i * k_)) return false;
             }
 
+        }
+
+        return true;
+
+    }
+
+    bool predecessorsVisit(const std::function<bool(size_type)>& visitor, size_type n, size_type q, size_type p, size_type z) const {
+
+        if (z >= T_.size()) {
+
+            if (leaf(z - T_.size())) {
+                if (!visitor(p)) return false;
+            }
+
+        } else {
+
+            if (hasChildren(z)) {
+
+                size_type y = R_.rank(z + 1) * k_ * k_ + q / (n / k_);
+
+                for (size_type i = 0; i < k_; i++) {
+                    if (!predecessorsVisit(visitor, n / k_, q % (n / k_), p + (n / k_) * i, y + i * k_)) return false;
+                }
+
+            }
+
+        }
+
+        return true;
+
+    }
+
+    /* forEachValuedPositionInRange() */
+
+    bool rangeValVisitInit(const std::function<bool(size_type, size_type, elem_type)>& visitor, size_type p1, size_type p2, size_type q1, size_type q2) const {
+
+        if (numLeaves() != 0) {
+
+            size_type p1Prime, p2Prime;
+
+            for (size_type i = p1 / (nPrime_ / k_); i <= p2 / (nPrime_ / k_); i++) {
+
+                p1Prime = (i == p1 / (nPrime_ / k_)) * (p1 % (nPrime_ / k_));
+                p2Prime = (i == p2 / (nPrime_ / k_)) ? p2 % (nPrime_ / k_) : (nPrime_ / k_) - 1;
+
+                for (size_type j = q1 / (nPrime_ / k_); j <= q2 / (nPrime_ / k_); j++) {
+                    if (!rangeValVisit(
+                            visitor,
+                            nPrime_ / k_,
+                            p1Prime,
+                            p2Prime,
+                            (j == q1 / (nPrime_ / k_)) * (q1 % (nPrime_ / k_)),
+                            (j == q2 / (nPrime_ / k_)) ? q2 % (nPrime_ / k_) : (nPrime_ / k_) - 1,
+                            (nPrime_ / k_) * i,
+                            (nPrime_ / k_) * j,
+                            k_ * i + j
+                    )) return false;
+                }
+
+            }
+
+        }
+
+        return true;
+
+    }
+
+    bool rangeValVisit(const std::function<bool(size_type, size_type, elem_type)>& visitor, size_type n, size_type p1, size_type p2, size_type q1, size_type q2, size_type dp, size_type dq, size_type z) const {
+
+        if (z >= T_.size()) {
+
+            if (leaf(z - T_.size())) {
+                if (!visitor(dp, dq, leaf(z - T_.size()))) return false;
+            }
+
+        } else {
+
+            if (hasChildren(z)) {
+
+                size_type y = R_.rank(z + 1) * k_ * k_;
+                size_type p1Prime, p2Prime;
+
+                for (size_type i = p1 / (n / k_); i <= p2 / (n / k_); i++) {
+
+                    p1Prime = (i == p1 / (n / k_)) * (p1 % (n / k_));
+                    p2Prime = (i == p2 / (n / k_)) ? p2 % (n / k_) : n / k_ - 1;
+
+                    for (size_type j = q1 / (n / k_); j <= q2 / (n / k_); j++) {
+                        if (!rangeValVisit(
+                                visitor,
+                                n / k_,
+                                p1Prime,
+                                p2Prime,
+                                (j == q1 / (n / k_)) * (q1 % (n / k_)),
+                                (j == q2 / (n / k_)) ? q2 % (n / k_) : n / k_ - 1,
+                                dp + (n / k_) * i,
+                                dq + (n / k_) * j,
+                                y + k_ * i + j
+                        )) return false;
+                    }
+
+                }
+
+            }
+
+        }
+
+        return true;
+
+    }
+
+
+    /* linkInRange() */
+
+    bool linkInRangeInit(size_type p1, size_type p2, size_type q1, size_type q2) const {
+
+        if (numLeaves() != 0) {
+
             size_type p1Prime, p2Prime;
 
             for (size_type i = p1 / (nPrime_ / k_); i <= p2 / (nPrime_ / k_); i++) {
@@ -2975,15 +4794,15 @@ private:
 
     }
 
-    bool linkInRange(size_type n, size_type p1, size_type p2, size_type q1, size_type q2, size_type z) {
+    bool linkInRange(size_type n, size_type p1, size_type p2, size_type q1, size_type q2, size_type z) const {
 
         if (z >= T_.size()) {
 
-            return L_[z - T_.size()];
+            return leaf(z - T_.size());
 
         } else {
 
-            if (T_[z]) {
+            if (hasChildren(z)) {
 
                 // dividing by k_ (as stated in the paper) in not correct,
                 // because it does not use the size of the currently considered submatrix but of its submatrices
@@ -2992,6 +4811,20 @@ private:
                 }
 
                 size_type y = R_.rank(z + 1) * k_ * k_;
+
+                if (n == k_) {
+
+                    // the children are leaves: check the rows of the leaf chunk word by word
+                    for (size_type i = p1, x = y - T_.size() + k_ * p1; i <= p2; i++, x += k_) {
+                        if (anyLeaf(x + q1, q2 - q1 + 1)) {
+                            return true;
+                        }
+                    }
+
+                    return false;
+
+                }
+
                 size_type p1Prime, p2Prime;
 
                 for (size_type i = p1 / (n / k_); i <= p2 / (n / k_); i++) {
@@ -3018,26 +4851,471 @@ private:
     }
 
 
+    /* countElementsInRange() */
+
+    size_type countRangeInit(size_type p1, size_type p2, size_type q1, size_type q2) const {
+
+        size_type cnt = 0;
+
+        if (numLeaves() != 0) {
+
+            size_type p1Prime, p2Prime;
+
+            for (size_type i = p1 / (nPrime_ / k_); i <= p2 / (nPrime_ / k_); i++) {
+
+                p1Prime = (i == p1 / (nPrime_ / k_)) * (p1 % (nPrime_ / k_));
+                p2Prime = (i == p2 / (nPrime_ / k_)) ? p2 % (nPrime_ / k_) : (nPrime_ / k_) - 1;
+
+                for (size_type j = q1 / (nPrime_ / k_); j <= q2 / (nPrime_ / k_); j++) {
+                    cnt += countRange(
+                            nPrime_ / k_,
+                            p1Prime,
+                            p2Prime,
+                            (j == q1 / (nPrime_ / k_)) * (q1 % (nPrime_ / k_)),
+                            (j == q2 / (nPrime_ / k_)) ? q2 % (nPrime_ / k_) : (nPrime_ / k_) - 1,
+                            k_ * i + j
+                    );
+                }
+
+            }
+
+        }
+
+        return cnt;
+
+    }
+
+    size_type countRange(size_type n, size_type p1, size_type p2, size_type q1, size_type q2, size_type z) const {
+
+        if (z >= T_.size()) {
+            return leaf(z - T_.size());
+        }
+
+        if (!hasChildren(z)) {
+            return 0;
+        }
+
+        // submatrix completely covered by the range: count all its entries at once
+        if (p1 == 0 && q1 == 0 && p2 == n - 1 && q2 == n - 1) {
+            return countSubtree(z);
+        }
+
+        size_type y = R_.rank(z + 1) * k_ * k_;
+        size_type cnt = 0;
+
+        if (n == k_) {
+
+            // the children are leaves: count the rows of the leaf chunk word by word
+            for (size_type i = p1, x = y - T_.size() + k_ * p1; i <= p2; i++, x += k_) {
+                cnt += countLeaves(x + q1, x + q2 + 1);
+            }
+
+            return cnt;
+
+        }
+
+        size_type p1Prime, p2Prime;
+
+        for (size_type i = p1 / (n / k_); i <= p2 / (n / k_); i++) {
+
+            p1Prime = (i == p1 / (n / k_)) * (p1 % (n / k_));
+            p2Prime = (i == p2 / (n / k_)) ? p2 % (n / k_) : n / k_ - 1;
+
+            for (size_type j = q1 / (n / k_); j <= q2 / (n / k_); j++) {
+                cnt += countRange(
+                        n / k_,
+                        p1Prime,
+                        p2Prime,
+                        (j == q1 / (n / k_)) * (q1 % (n / k_)),
+                        (j == q2 / (n / k_)) ? q2 % (n / k_) : n / k_ - 1,
+                        y + k_ * i + j
+                );
+            }
+
+        }
+
+        return cnt;
+
+    }
+
+    /* helper methods for counting (countElements() / countElementsInRange()) */
+
+    // returns the number of non-null entries in the leaves below node z (z < T_.size() and T_[z] = 1),
+    // the nodes of a subtree on each level form a contiguous interval, which is mapped to the next level via rank
+    size_type countSubtree(size_type z) const {
+
+        size_type lo = z;
+        size_type hi = z + 1;
+
+        while (lo < hi && lo < T_.size()) {
+
+            lo = (R_.rank(lo) + 1) * k_ * k_;
+            hi = (R_.rank(hi) + 1) * k_ * k_;
+
+        }
+
+        return (lo < hi) ? countLeaves(lo - T_.size(), hi - T_.size()) : 0;
+
+    }
+
+    // returns the number of non-null entries in L_[from..to)
+    size_type countLeaves(size_type from, size_type to) const {
+
+        if (countSamples_.empty()) {
+
+            K2TREES_COUNT(leafProbes);
+            return countLeafBits(from, to - from);
+
+        }
+
+        return countPrefix(to) - countPrefix(from);
+
+    }
+
+    // returns the number of non-null entries in L_[0..x) using the counting index
+    size_type countPrefix(size_type x) const {
+
+        size_type y = (x / K2TREES_COUNT_SAMPLE_RATE) * K2TREES_COUNT_SAMPLE_RATE;
+
+        K2TREES_COUNT(leafProbes);
+        return countSamples_[x / K2TREES_COUNT_SAMPLE_RATE] + countLeafBits(y, x - y);
+
+    }
+
+    /* helper method for the set operations */
+
+    // determines the result of op level by level, each element of cur represents a node of the result
+    // by the positions of the first children of the corresponding nodes in this and other (none if the subtree is empty)
+    BasicK2Tree combine(const BasicK2Tree& other, const SetOperation op) const {
+
+        if ((k_ != other.k_) || (h_ != other.h_)) {
+            throw std::runtime_error("Set operations are only supported between K2Trees with the same arity and height.");
+        }
+
+        const size_type none = size_type(-1);
+
+        std::vector<std::vector<bool>> levels(h_ - 1);
+        std::vector<bool> leaves;
+
+        std::vector<std::pair<size_type, size_type>> cur(1, std::make_pair((numLeaves() != 0) ? 0 : none, (other.numLeaves() != 0) ? 0 : none));
+        std::vector<std::pair<size_type, size_type>> next;
+
+        for (size_type l = 0; l < h_; l++) {
+
+            for (auto& y : cur) {
+
+                for (size_type i = 0; i < k_ * k_; i++) {
+
+                    if (l < h_ - 1) {
+
+                        bool a = (y.first != none) && hasChildren(y.first + i);
+                        bool b = (y.second != none) && other.hasChildren(y.second + i);
+                        bool bit = (op == SET_UNION) ? (a || b) : ((op == SET_INTERSECTION) ? (a && b) : a);
+
+                        levels[l].push_back(bit);
+
+                        if (bit) {
+                            next.push_back(std::make_pair(a ? R_.rank(y.first + i + 1) * k_ * k_ : none, b ? other.R_.rank(y.second + i + 1) * k_ * k_ : none));
+                        }
+
+                    } else {
+
+                        bool a = (y.first != none) && leaf(y.first + i - T_.size());
+                        bool b = (y.second != none) && other.leaf(y.second + i - other.T_.size());
+
+                        leaves.push_back((op == SET_UNION) ? (a || b) : ((op == SET_INTERSECTION) ? (a && b) : (a && !b)));
+
+                    }
+
+                }
+
+            }
+
+            cur.swap(next);
+            next.clear();
+
+        }
+
+        // the intersection / difference of two non-empty subtrees can be empty
+        if (op != SET_UNION) {
+            pruneEmptyBlocks(levels, leaves, k_ * k_, false);
+        }
+
+        BasicK2Tree res;
+        res.h_ = h_;
+        res.k_ = k_;
+        res.nPrime_ = nPrime_;
+        res.null_ = null_;
+
+        size_type total = 0;
+        for (size_type l = 0; l < h_ - 1; l++) {
+            total += levels[l].size();
+        }
+        res.T_ = bit_vector_type(total);
+
+        bit_vector_type::iterator outIter = res.T_.begin();
+        for (size_type l = 0; l < h_ - 1; l++) {
+            outIter = std::move(levels[l].begin(), levels[l].end(), outIter);
+        }
+
+        res.L_ = bit_vector_type(leaves.size());
+        std::move(leaves.begin(), leaves.end(), res.L_.begin());
+        res.R_ = rank_type(&res.T_);
+
+        return res;
+
+    }
+
+    /* helper methods for the boolean matrix product */
+
+    void checkProductArguments(const BasicK2Tree& other) const {
+
+        if ((k_ != other.k_) || (h_ != other.h_)) {
+            throw std::runtime_error("The product is only supported between K2Trees with the same arity and height.");
+        }
+
+    }
+
+    void productInit(const BasicK2Tree& other, positions_type& pairs, const size_type numThreads) const {
+
+        std::vector<std::pair<size_type, size_type>> root(1, std::make_pair(0, 0));
+
+        if (h_ == 1) {
+
+            product(other, nPrime_, 0, 0, root, pairs);
+            return;
+
+        }
+
+        // the top-level quadrants of the result are independent of each other
+        std::vector<positions_type> quadrants(k_ * k_);
+
+        parallelFor(quadrants.size(), numThreads, [&](size_type x) {
+
+            auto terms = productTerms(other, root, x / k_, x % k_);
+
+            if (!terms.empty()) {
+                product(other, nPrime_ / k_, (x / k_) * (nPrime_ / k_), (x % k_) * (nPrime_ / k_), terms, quadrants[x]);
+            }
+
+        });
+
+        for (auto& q : quadrants) {
+            pairs.insert(pairs.end(), q.begin(), q.end());
+        }
+
+    }
+
+    // determines the terms A_pr x B_rq contributing to the child (p,q) of the current node of the result,
+    // every term of the current node is given by the positions of the first children of the corresponding nodes in this and other
+    std::vector<std::pair<size_type, size_type>> productTerms(const BasicK2Tree& other, const std::vector<std::pair<size_type, size_type>>& terms, size_type p, size_type q) const {
+
+        std::vector<std::pair<size_type, size_type>> res;
+
+        for (auto& y : terms) {
+
+            for (size_type r = 0; r < k_; r++) {
+
+                size_type za = y.first + p * k_ + r;
+                size_type zb = y.second + r * k_ + q;
+
+                // empty quadrants do not contribute to the product
+                if (hasChildren(za) && other.hasChildren(zb)) {
+                    res.push_back(std::make_pair(R_.rank(za + 1) * k_ * k_, other.R_.rank(zb + 1) * k_ * k_));
+                }
+
+            }
+
+        }
+
+        return res;
+
+    }
+
+    // computes the submatrix of size n x n of the result whose upper left corner is (p0,q0) from its non-empty terms
+    void product(const BasicK2Tree& other, size_type n, size_type p0, size_type q0, const std::vector<std::pair<size_type, size_type>>& terms, positions_type& pairs) const {
+
+        if (n == k_) {
+
+            // the children are leaves: multiply the corresponding blocks directly
+            std::vector<bool> block(k_ * k_, false);
+
+            for (auto& y : terms) {
+                for (size_type p = 0; p < k_; p++) {
+                    for (size_type r = 0; r < k_; r++) {
+
+                        if (leaf(y.first + p * k_ + r - T_.size())) {
+                            for (size_type q = 0; q < k_; q++) {
+                                if (other.leaf(y.second + r * k_ + q - other.T_.size())) {
+                                    block[p * k_ + q] = true;
+                                }
+                            }
+                        }
+
+                    }
+                }
+            }
+
+            for (size_type x = 0; x < block.size(); x++) {
+                if (block[x]) {
+                    pairs.push_back(std::make_pair(p0 + x / k_, q0 + x % k_));
+                }
+            }
+
+        } else {
+
+            for (size_type p = 0; p < k_; p++) {
+                for (size_type q = 0; q < k_; q++) {
+
+                    auto sub = productTerms(other, terms, p, q);
+
+                    if (!sub.empty()) {
+                        product(other, n / k_, p0 + p * (n / k_), q0 + q * (n / k_), sub, pairs);
+                    }
+
+                }
+            }
+
+        }
+
+    }
+
+    /* helper methods for accessing the (optionally compressed) last level */
+
+    // returns the entry of the last level at position x
+    inline bool leaf(size_type x) const {
+
+        K2TREES_COUNT(leafProbes);
+        return compressedL_.empty() ? L_[x] : compressedL_[x];
+
+    }
+
+    // returns the length of the last level
+    inline size_type numLeaves() const {
+        return compressedL_.empty() ? L_.size() : compressedL_.size();
+    }
+
+    // calls visitor(x) for the positions x of all set bits of the last level in [x, x + len) (word by word, see forEachSetBit())
+    template<typename F>
+    inline bool forEachLeaf(size_type x, size_type len, F visitor) const {
+
+        K2TREES_COUNT(leafProbes);
+        return compressedL_.empty() ? forEachSetBit(L_, x, len, visitor) : compressedL_.forEachSetBit(x, len, visitor);
+
+    }
+
+    // checks whether the last level contains a set bit in [x, x + len)
+    inline bool anyLeaf(size_type x, size_type len) const {
+
+        K2TREES_COUNT(leafProbes);
+
+        if (!compressedL_.empty()) {
+            return compressedL_.anyBitSet(x, len);
+        }
+
+        return (len <= 64) ? (getBits(L_, x, len) != 0) : anyBitSet(L_, x, len);
+
+    }
+
+    // returns the number of set bits of the last level in [x, x + len) (without the counting index)
+    inline size_type countLeafBits(size_type x, size_type len) const {
+
+        if (!compressedL_.empty()) {
+            return compressedL_.countBits(x, len);
+        }
+
+        return (len <= 64) ? sdsl::bits::cnt(getBits(L_, x, len)) : countBits(L_, x, len);
+
+    }
+
+    // returns the position of the first set bit of the last level in [x, x + len) (x + len if there is none)
+    inline size_type findFirstLeaf(size_type x, size_type len) const {
+
+        K2TREES_COUNT(leafProbes);
+        return compressedL_.empty() ? findFirstBit(L_, x, len) : compressedL_.findFirstBit(x, len);
+
+    }
+
+    /* helper methods for handling subtrees emptied by setNull() */
+
+    // checks whether node z has children, i.e. whether its bit in T is set and its subtree has not been emptied by setNull()
+    inline bool hasChildren(size_type z) const {
+
+        K2TREES_COUNT(nodesVisited);
+        return T_[z] && (emptyNodes_.empty() || !emptyNodes_[z]);
+
+    }
+
+    // checks whether all len nodes of the block starting at position y are empty
+    bool isEmptyBlock(size_type y, size_type len) const {
+
+        for (size_type c = y; c < y + len; c++) {
+            if ((c >= T_.size()) ? leaf(c - T_.size()) : hasChildren(c)) {
+                return false;
+            }
+        }
+
+        return true;
+
+    }
+
+    // marks the subtree of node z as empty
+    void markEmpty(size_type z) {
+
+        if (emptyNodes_.empty()) {
+            emptyNodes_ = bit_vector_type(T_.size(), 0);
+        }
+
+        emptyNodes_[z] = 1;
+
+    }
+
     /* setNull() */
 
     void setInit(size_type p, size_type q) {
 
-        if (!L_.empty()) {
+        if (numLeaves() != 0) {
             set(nPrime_ / k_, p % (nPrime_ / k_), q % (nPrime_ / k_), (p / (nPrime_ / k_)) * k_ + q / (nPrime_ / k_));
         }
 
     }
 
-    void set(size_type n, size_type p, size_type q, size_type z) {
+    // clears the entry in the subtree of z, returns true iff the subtree is empty afterwards
+    bool set(size_type n, size_type p, size_type q, size_type z) {
 
         if (z >= T_.size()) {
+
+            // keep the counting index up to date
+            if (!countSamples_.empty() && leaf(z - T_.size())) {
+                for (size_type s = (z - T_.size()) / K2TREES_COUNT_SAMPLE_RATE + 1; s < countSamples_.size(); s++) {
+                    countSamples_[s]--;
+                }
+            }
+
             L_[z - T_.size()] = null_;
+
+            return true;
+
         } else {
 
-            if (T_[z]) {
-                set(n / k_, p % (n / k_), q % (n / k_), R_.rank(z + 1) * k_ * k_ + (p / (n / k_)) * k_ + q / (n / k_));
+            if (hasChildren(z)) {
+
+                size_type y = R_.rank(z + 1) * k_ * k_;
+
+                // mark z if its whole subtree has become empty
+                if (set(n / k_, p % (n / k_), q % (n / k_), y + (p / (n / k_)) * k_ + q / (n / k_)) && isEmptyBlock(y, k_ * k_)) {
+
+                    markEmpty(z);
+                    return true;
+
+                }
+
+                return false;
+
             }
 
+            return true;
+
         }
 
     }
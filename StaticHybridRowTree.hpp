@@ -63,6 +63,7 @@ public:
         T_ = other.T_;
         L_ = other.L_;
         R_ = rank_type(&T_);
+        emptyNodes_ = other.emptyNodes_;
 
     }
 
@@ -85,6 +86,7 @@ public:
         T_ = other.T_;
         L_ = other.L_;
         R_ = rank_type(&T_);
+        emptyNodes_ = other.emptyNodes_;
 
         return *this;
 
@@ -300,53 +302,53 @@ public:
 
 
     // returns the arity of the upper part of the RowTree
-    size_type getUpperK() {
+    size_type getUpperK() const {
         return upperK_;
     }
 
     // returns the arity of the lower part of the RowTree
-    size_type getLowerK() {
+    size_type getLowerK() const {
         return lowerK_;
     }
 
     // returns the height of the upper part of the RowTree
-    size_type getUpperH() {
+    size_type getUpperH() const {
         return upperH_;
     }
 
     // returns the number of 1-bits in the upper part of the RowTree
-    size_type getUpperOnes() {
+    size_type getUpperOnes() const {
         return upperOnes_;
     }
 
     // returns the number of bits in the upper part of the RowTree
-    size_type getUpperLength() {
+    size_type getUpperLength() const {
         return upperLength_;
     }
 
     // returns the height of the RowTree
-    size_type getH() {
+    size_type getH() const {
         return upperK_;
     }
 
-    size_type getLength() override {
+    size_type getLength() const override {
         return nPrime_;
     }
 
-    elem_type getNull() override {
+    elem_type getNull() const override {
         return null_;
     }
 
 
-    bool isNotNull(size_type i) override {
+    bool isNotNull(size_type i) const override {
         return checkInit(i);
     }
 
-    elem_type getElement(size_type i) override {
+    elem_type getElement(size_type i) const override {
         return getInit(i);
     }
 
-    std::vector<elem_type> getElementsInRange(size_type l, size_type r) override {
+    std::vector<elem_type> getElementsInRange(size_type l, size_type r) const override {
 
         std::vector<elem_type> elems;
         rangeElemInit(elems, l, r);
@@ -356,7 +358,7 @@ public:
 
     }
 
-    std::vector<size_type> getPositionsInRange(size_type l, size_type r) override {
+    std::vector<size_type> getPositionsInRange(size_type l, size_type r) const override {
 
         std::vector<size_type> positions;
         rangePosInit(positions, l, r);
@@ -366,7 +368,7 @@ public:
 
     }
 
-    list_type getValuedPositionsInRange(size_type l, size_type r) override {
+    list_type getValuedPositionsInRange(size_type l, size_type r) const override {
 
         list_type positions;
         rangeValPosInit(positions, l, r);
@@ -376,7 +378,7 @@ public:
 
     }
 
-    std::vector<elem_type> getAllElements() override {
+    std::vector<elem_type> getAllElements() const override {
 //        return getElementsInRange(0, nPrime_ - 1);
         std::vector<elem_type> elements;
         fullRangeElemIterative(elements);
@@ -384,7 +386,7 @@ public:
 
     }
 
-    std::vector<size_type> getAllPositions() override {
+    std::vector<size_type> getAllPositions() const override {
 //        return getPositionsInRange(0, nPrime_ - 1);
         std::vector<size_type> positions;
         fullRangePosIterative(positions);
@@ -392,7 +394,7 @@ public:
 
     }
 
-    list_type getAllValuedPositions() override {
+    list_type getAllValuedPositions() const override {
 //        return getValuedPositionsInRange(0, nPrime_ - 1);
         list_type positions;
         fullRangeValPosIterative(positions);
@@ -400,16 +402,16 @@ public:
 
     }
 
-    bool containsElement(size_type l, size_type r) override {
+    bool containsElement(size_type l, size_type r) const override {
         return elemInRangeInit(l, r);
 //        return elemInRangeInit(l, std::min(r, nPrime_ - 1));
     }
 
-    size_type countElements() override {
+    size_type countElements() const override {
 
         size_type res = 0;
         for (auto i = 0; i < L_.size(); i++) {
-            res += (L_[i] != null_);
+            res += (leaf(i) != null_);
         }
 
         return res;
@@ -421,7 +423,7 @@ public:
         return new HybridRowTree<elem_type>(*this);
     }
 
-    void print(bool all = false) override {
+    void print(bool all = false) const override {
 
         std::cout << "### Parameters ###" << std::endl;
         std::cout << "h  = " << h_ << std::endl;
@@ -451,12 +453,96 @@ public:
 
     }
 
-    // note: can "invalidate" the data structure (containsElement() probably won't work correctly afterwards)
+    void serialize(std::ostream& out) const override {
+
+        writeHeader(out, "HybridRowTree", sizeof(elem_type));
+
+        writeValue(out, h_);
+        writeValue(out, upperH_);
+        writeValue(out, upperOnes_);
+        writeValue(out, upperLength_);
+        writeValue(out, upperK_);
+        writeValue(out, lowerK_);
+        writeValue(out, nPrime_);
+        writeValue(out, null_);
+
+        T_.serialize(out);
+        writeVector(out, L_);
+        R_.serialize(out);
+        emptyNodes_.serialize(out);
+
+    }
+
+    void load(std::istream& in) override {
+
+        this->checkWritable("load");
+
+        unsigned int version = readHeader(in, "HybridRowTree", sizeof(elem_type));
+
+        readValue(in, h_);
+        readValue(in, upperH_);
+        readValue(in, upperOnes_);
+        readValue(in, upperLength_);
+        readValue(in, upperK_);
+        readValue(in, lowerK_);
+        readValue(in, nPrime_);
+        readValue(in, null_);
+
+        T_.load(in);
+        readVector(in, L_);
+        R_.load(in, &T_);
+        if (version >= 4) {
+            emptyNodes_.load(in);
+        } else {
+            emptyNodes_ = bit_vector_type();
+        }
+
+    }
+
+    // note: emptied subtrees are only marked, compact() removes them from the internal structure
     void setNull(size_type i) override {
+        this->checkWritable("setNull");
         setInit(i);
     }
 
-    size_type getFirst() override {
+    // rebuilds the internal structure from the remaining elements, so that the subtrees emptied by setNull() are removed
+    // (the size of the universe remains unchanged)
+    void compact() override {
+
+        this->checkWritable("compact");
+
+        if (emptyNodes_.empty()) {
+            return;
+        }
+
+        list_type pairs = getAllValuedPositions();
+
+        T_ = bit_vector_type();
+        L_.clear();
+        emptyNodes_ = bit_vector_type();
+
+        if (!pairs.empty()) {
+            buildFromListsInplace(pairs);
+        }
+
+        R_ = rank_type(&T_);
+
+    }
+
+    SizeBreakdown sizeInBytes() const override {
+
+        SizeBreakdown s;
+        s.T = sdsl::size_in_bytes(T_);
+        s.L = vectorBytes(L_);
+        s.rank = sdsl::size_in_bytes(R_);
+        s.aux = sdsl::size_in_bytes(emptyNodes_);
+        s.other = sizeof(*this);
+
+        return s;
+
+    }
+
+    size_type getFirst() const override {
 //        return getFirstInit();
         return getFirstIterative();
     }
@@ -465,7 +551,7 @@ public:
 
 private:
     // representation of all but the last levels of the RowTree (internal structure)
-    bit_vector_type T_;
+    level_vector_type T_;
 
     // representation of the last level of the RowTree (actual values of the universe)
     std::vector<elem_type> L_;
@@ -473,6 +559,9 @@ private:
     // rank data structure for navigation in T_
     rank_type R_;
 
+    // marks the internal nodes whose subtrees have been emptied by setNull() (empty if there are none), see compact()
+    bit_vector_type emptyNodes_;
+
     size_type upperK_; // arity in the upper part of the RowTree
     size_type lowerK_; // arity in the lower part of the RowTree
     size_type upperH_; // height of the upper part of the RowTree
@@ -684,15 +773,19 @@ private:
 
         } else {
 
-            std::vector<bool> T;
-            NaiveDynamicRank R;
+            DynamicVector<bool> T;
+            DynamicVector<elem_type> L;
+            DynamicRank R;
 
             for (auto j = 0; j < list.size(); j++) {
-                insertInit(T, R, list[j].first, list[j].second);
+                insertInit(T, L, R, list[j].first, list[j].second);
             }
 
+            L_ = std::vector<elem_type>(L.size());
+            L.copyTo(L_.begin());
+
             T_ = bit_vector_type(T.size());
-            std::move(T.begin(), T.end(), T_.begin());
+            T.copyTo(T_.begin());
 
         }
 
@@ -700,25 +793,25 @@ private:
 
     }
 
-    void insertInit(std::vector<bool>& T, NaiveDynamicRank& R, size_type q, elem_type val) {
+    void insertInit(DynamicVector<bool>& T, DynamicVector<elem_type>& L, DynamicRank& R, size_type q, elem_type val) {
 
         auto k = (upperH_ > 0) ? upperK_ : lowerK_;
 
         if (T.empty()) {
 
-            T = std::vector<bool>(k);
-            R = NaiveDynamicRank(T);
+            T = DynamicVector<bool>(k, false);
+            R = DynamicRank(std::vector<bool>(k));
 
             upperOnes_ = 0;
             upperLength_ = (upperH_ > 0) ? k : 0;
 
         }
 
-        insert(T, R, nPrime_ / k, q % (nPrime_ / k), val, q / (nPrime_ / k), 1);
+        insert(T, L, R, nPrime_ / k, q % (nPrime_ / k), val, q / (nPrime_ / k), 1);
 
     }
 
-    void insert(std::vector<bool>& T, NaiveDynamicRank& R, size_type n, size_type q, elem_type val, size_type z, size_type l) {
+    void insert(DynamicVector<bool>& T, DynamicVector<elem_type>& L, DynamicRank& R, size_type n, size_type q, elem_type val, size_type z, size_type l) {
 
         auto k = (l < upperH_) ? upperK_ : lowerK_;
 
@@ -738,15 +831,15 @@ private:
 
             if ((l + 1) == h_) {
 
-                L_.insert(L_.begin() + y - T.size(), k, null_);
-                L_[y + q / (n / k) - T.size()] = val;
+                L.insert(y - T.size(), k, null_);
+                L[y + q / (n / k) - T.size()] = val;
 
             } else {
 
-                T.insert(T.begin() + y, k, null_);
+                T.insert(y, k, null_);
                 R.insert(y + 1, k);
 
-                insert(T, R, n / k, q % (n / k), val, y + q / (n / k), l + 1);
+                insert(T, L, R, n / k, q % (n / k), val, y + q / (n / k), l + 1);
 
             }
 
@@ -755,9 +848,9 @@ private:
             size_type y = (l >= upperH_) * upperLength_ + (R.rank(z + 1) - (l >= upperH_) * (upperOnes_ + 1)) * k + q / (n / k);
 
             if ((l + 1) == h_) {
-                L_[y - T.size()] = val;
+                L[y - T.size()] = val;
             } else {
-                insert(T, R, n / k, q % (n / k), val, y, l + 1);
+                insert(T, L, R, n / k, q % (n / k), val, y, l + 1);
             }
 
         }
@@ -884,7 +977,7 @@ private:
 
     /* isNotNull() */
 
-    bool checkInit(size_type q) {
+    bool checkInit(size_type q) const {
 
         size_type k = (upperH_ > 0) ? upperK_ : lowerK_;
 
@@ -892,10 +985,10 @@ private:
 
     }
 
-    bool check(size_type n, size_type q, size_type z, size_type l) {
+    bool check(size_type n, size_type q, size_type z, size_type l) const {
 
         if (z >= T_.size()) {
-            return (L_[z - T_.size()] != null_);
+            return (leaf(z - T_.size()) != null_);
         } else {
 
             auto k = (l < upperH_) ? upperK_ : lowerK_;
@@ -908,7 +1001,7 @@ private:
 
     /* getElement() */
 
-    elem_type getInit(size_type q) {
+    elem_type getInit(size_type q) const {
 
         size_type k = (upperH_ > 0) ? upperK_ : lowerK_;
 
@@ -916,10 +1009,10 @@ private:
 
     }
 
-    elem_type get(size_type n, size_type q, size_type z, size_type l) {
+    elem_type get(size_type n, size_type q, size_type z, size_type l) const {
 
         if (z >= T_.size()) {
-            return L_[z - T_.size()];
+            return leaf(z - T_.size());
         } else {
 
             auto k = (l < upperH_) ? upperK_ : lowerK_;
@@ -932,14 +1025,14 @@ private:
 
     /* getFirst() */
 
-    size_type getFirstIterative() {
+    size_type getFirstIterative() const {
 
         if (L_.empty()) return nPrime_;
 
         if (T_.size() == 0) {
 
             for (size_type i = 0; i < nPrime_; i++) {
-                if (L_[i] != null_) {
+                if (leaf(i) != null_) {
                     return i;
                 }
             }
@@ -954,7 +1047,7 @@ private:
 
             while (z < T_.size()) {
 
-                if (T_[z]) {
+                if (hasChildren(z)) {
 
                     k = (level < upperH_) ? upperK_ : lowerK_;
                     n /= k;
@@ -973,7 +1066,7 @@ private:
             k = (level < upperH_) ? upperK_ : lowerK_;
             for (size_type offset = 0; offset < k; offset++) {
 
-                if (L_[z - T_.size() + offset] != null_) {
+                if (leaf(z - T_.size() + offset) != null_) {
                     return dq + offset;
                 }
 
@@ -985,7 +1078,7 @@ private:
 
     }
 
-    size_type getFirstInit() {
+    size_type getFirstInit() const {
 
         size_type pos = nPrime_;
 
@@ -1010,19 +1103,19 @@ private:
 
     }
 
-    size_type getFirst(size_type n, size_type l, size_type r, size_type dq, size_type z, size_type level) {
+    size_type getFirst(size_type n, size_type l, size_type r, size_type dq, size_type z, size_type level) const {
 
         size_type pos = nPrime_;
 
         if (z >= T_.size()) {
 
-            if (L_[z - T_.size()] != null_) {
+            if (leaf(z - T_.size()) != null_) {
                 pos = dq;
             }
 
         } else {
 
-            if (T_[z]) {
+            if (hasChildren(z)) {
 
                 auto k = (level < upperH_) ? upperK_ : lowerK_;
                 auto y = (level >= upperH_) * upperLength_ + (R_.rank(z + 1) - (level >= upperH_) * (upperOnes_ + 1)) * k;
@@ -1049,7 +1142,7 @@ private:
 
     /* getElementsInRange() */
 
-    void fullRangeElemIterative(std::vector<elem_type>& elems) {
+    void fullRangeElemIterative(std::vector<elem_type>& elems) const {
 
         if (L_.empty()) return;
 
@@ -1060,8 +1153,8 @@ private:
         if (lenT == 0) {
 
             for (size_type i = 0; i < nPrime_; i++) {
-                if (L_[i] != null_) {
-                    elems.push_back(L_[i]);
+                if (leaf(i) != null_) {
+                    elems.push_back(leaf(i));
                 }
             }
 
@@ -1072,6 +1165,7 @@ private:
             size_type l = 1;
 
             for (size_type z = 0, dq = 0; z < k; z++, dq += n) {
+                K2TREES_COUNT(queuePushes);
                 queue.push(SubrowInfo(dq, z));
             }
 
@@ -1087,11 +1181,12 @@ private:
 
                     auto& cur = queue.front();
 
-                    if (T_[cur.z]) {
+                    if (hasChildren(cur.z)) {
 
                         auto y = a + (R_.rank(cur.z + 1) - b) * k;
 
                         for (size_type j = 0, newDq = cur.dq; j < k; j++, newDq += n, y++) {
+                            K2TREES_COUNT(queuePushes);
                             nextLevelQueue.push(SubrowInfo(newDq, y));
                         }
 
@@ -1112,13 +1207,13 @@ private:
 
                 auto& cur = queue.front();
 
-                if (T_[cur.z]) {
+                if (hasChildren(cur.z)) {
 
                     auto y = a + (R_.rank(cur.z + 1) - b) * k - lenT;
 
                     for (size_type j = 0, newDq = cur.dq; j < k; j++, newDq += n, y++) {
-                        if (L_[y] != null_) {
-                            elems.push_back(L_[y]);
+                        if (leaf(y) != null_) {
+                            elems.push_back(leaf(y));
                         }
                     }
 
@@ -1132,7 +1227,7 @@ private:
 
     }
 
-    void rangeElemInit(std::vector<elem_type>& elems, size_type l, size_type r) {
+    void rangeElemInit(std::vector<elem_type>& elems, size_type l, size_type r) const {
 
         if (!L_.empty()) {
 
@@ -1154,17 +1249,17 @@ private:
 
     }
 
-    void rangeElem(std::vector<elem_type>& elems, size_type n, size_type l, size_type r, size_type dq, size_type z, size_type level) {
+    void rangeElem(std::vector<elem_type>& elems, size_type n, size_type l, size_type r, size_type dq, size_type z, size_type level) const {
 
         if (z >= T_.size()) {
 
-            if (L_[z - T_.size()] != null_) {
-                elems.push_back(L_[z - T_.size()]);
+            if (leaf(z - T_.size()) != null_) {
+                elems.push_back(leaf(z - T_.size()));
             }
 
         } else {
 
-            if (T_[z]) {
+            if (hasChildren(z)) {
 
                 auto k = (level < upperH_) ? upperK_ : lowerK_;
                 auto y = (level >= upperH_) * upperLength_ + (R_.rank(z + 1) - (level >= upperH_) * (upperOnes_ + 1)) * k;
@@ -1189,7 +1284,7 @@ private:
 
     /* getPositionsInRange() */
 
-    void fullRangePosIterative(std::vector<size_type>& elems) {
+    void fullRangePosIterative(std::vector<size_type>& elems) const {
 
         if (L_.empty()) return;
 
@@ -1200,7 +1295,7 @@ private:
         if (lenT == 0) {
 
             for (size_type i = 0; i < nPrime_; i++) {
-                if (L_[i] != null_) {
+                if (leaf(i) != null_) {
                     elems.push_back(i);
                 }
             }
@@ -1212,6 +1307,7 @@ private:
             size_type l = 1;
 
             for (size_type z = 0, dq = 0; z < k; z++, dq += n) {
+                K2TREES_COUNT(queuePushes);
                 queue.push(SubrowInfo(dq, z));
             }
 
@@ -1227,11 +1323,12 @@ private:
 
                     auto& cur = queue.front();
 
-                    if (T_[cur.z]) {
+                    if (hasChildren(cur.z)) {
 
                         auto y = a + (R_.rank(cur.z + 1) - b) * k;
 
                         for (size_type j = 0, newDq = cur.dq; j < k; j++, newDq += n, y++) {
+                            K2TREES_COUNT(queuePushes);
                             nextLevelQueue.push(SubrowInfo(newDq, y));
                         }
 
@@ -1252,12 +1349,12 @@ private:
 
                 auto& cur = queue.front();
 
-                if (T_[cur.z]) {
+                if (hasChildren(cur.z)) {
 
                     auto y = a + (R_.rank(cur.z + 1) - b) * k - lenT;
 
                     for (size_type j = 0, newDq = cur.dq; j < k; j++, newDq += n, y++) {
-                        if (L_[y] != null_) {
+                        if (leaf(y) != null_) {
                             elems.push_back(newDq);
                         }
                     }
@@ -1272,7 +1369,7 @@ private:
 
     }
 
-    void rangePosInit(std::vector<size_type>& elems, size_type l, size_type r) {
+    void rangePosInit(std::vector<size_type>& elems, size_type l, size_type r) const {
 
         if (!L_.empty()) {
 
@@ -1294,17 +1391,17 @@ private:
 
     }
 
-    void rangePos(std::vector<size_type>& elems, size_type n, size_type l, size_type r, size_type dq, size_type z, size_type level) {
+    void rangePos(std::vector<size_type>& elems, size_type n, size_type l, size_type r, size_type dq, size_type z, size_type level) const {
 
         if (z >= T_.size()) {
 
-            if (L_[z - T_.size()] != null_) {
+            if (leaf(z - T_.size()) != null_) {
                 elems.push_back(dq);
             }
 
         } else {
 
-            if (T_[z]) {
+            if (hasChildren(z)) {
 
                 auto k = (level < upperH_) ? upperK_ : lowerK_;
                 auto y = (level >= upperH_) * upperLength_ + (R_.rank(z + 1) - (level >= upperH_) * (upperOnes_ + 1)) * k;
@@ -1329,7 +1426,7 @@ private:
 
     /* getValuedPositionsInRange() */
 
-    void fullRangeValPosIterative(list_type& elems) {
+    void fullRangeValPosIterative(list_type& elems) const {
 
         if (L_.empty()) return;
 
@@ -1340,8 +1437,8 @@ private:
         if (lenT == 0) {
 
             for (size_type i = 0; i < nPrime_; i++) {
-                if (L_[i] != null_) {
-                    elems.push_back(std::make_pair(i, L_[i]));
+                if (leaf(i) != null_) {
+                    elems.push_back(std::make_pair(i, leaf(i)));
                 }
             }
 
@@ -1352,6 +1449,7 @@ private:
             size_type l = 1;
 
             for (size_type z = 0, dq = 0; z < k; z++, dq += n) {
+                K2TREES_COUNT(queuePushes);
                 queue.push(SubrowInfo(dq, z));
             }
 
@@ -1367,11 +1465,12 @@ private:
 
                     auto& cur = queue.front();
 
-                    if (T_[cur.z]) {
+                    if (hasChildren(cur.z)) {
 
                         auto y = a + (R_.rank(cur.z + 1) - b) * k;
 
                         for (size_type j = 0, newDq = cur.dq; j < k; j++, newDq += n, y++) {
+                            K2TREES_COUNT(queuePushes);
                             nextLevelQueue.push(SubrowInfo(newDq, y));
                         }
 
@@ -1392,13 +1491,13 @@ private:
 
                 auto& cur = queue.front();
 
-                if (T_[cur.z]) {
+                if (hasChildren(cur.z)) {
 
                     auto y = a + (R_.rank(cur.z + 1) - b) * k - lenT;
 
                     for (size_type j = 0, newDq = cur.dq; j < k; j++, newDq += n, y++) {
-                        if (L_[y] != null_) {
-                            elems.push_back(std::make_pair(newDq, L_[y]));
+                        if (leaf(y) != null_) {
+                            elems.push_back(std::make_pair(newDq, leaf(y)));
                         }
                     }
 
@@ -1412,7 +1511,7 @@ private:
 
     }
 
-    void rangeValPosInit(list_type& elems, size_type l, size_type r) {
+    void rangeValPosInit(list_type& elems, size_type l, size_type r) const {
 
         if (!L_.empty()) {
 
@@ -1434,17 +1533,17 @@ private:
 
     }
 
-    void rangeValPos(list_type& elems, size_type n, size_type l, size_type r, size_type dq, size_type z, size_type level) {
+    void rangeValPos(list_type& elems, size_type n, size_type l, size_type r, size_type dq, size_type z, size_type level) const {
 
         if (z >= T_.size()) {
 
-            if (L_[z - T_.size()] != null_) {
-                elems.push_back(std::make_pair(dq, L_[z - T_.size()]));
+            if (leaf(z - T_.size()) != null_) {
+                elems.push_back(std::make_pair(dq, leaf(z - T_.size())));
             }
 
         } else {
 
-            if (T_[z]) {
+            if (hasChildren(z)) {
 
                 auto k = (level < upperH_) ? upperK_ : lowerK_;
                 auto y = (level >= upperH_) * upperLength_ + (R_.rank(z + 1) - (level >= upperH_) * (upperOnes_ + 1)) * k;
@@ -1469,14 +1568,10 @@ private:
 
     /* containsElement() */
 
-    bool elemInRangeInit(size_type l, size_type r) {
+    bool elemInRangeInit(size_type l, size_type r) const {
 
         if (!L_.empty()) {
 
-            if ((l == 0) && (r == (nPrime_ - 1))) {
-                return 1;
-            }
-
             size_type k = (upperH_ > 0) ? upperK_ : lowerK_;
 
             for (auto j = l / (nPrime_ / k); j <= r / (nPrime_ / k); j++) {
@@ -1493,15 +1588,15 @@ private:
 
     }
 
-    bool elemInRange(size_type n, size_type l, size_type r, size_type z, size_type level) {
+    bool elemInRange(size_type n, size_type l, size_type r, size_type z, size_type level) const {
 
         if (z >= T_.size()) {
 
-            return L_[z - T_.size()] != null_;
+            return leaf(z - T_.size()) != null_;
 
         } else {
 
-            if (T_[z]) {
+            if (hasChildren(z)) {
 
                 if ((l == 0) && (r == (n - 1))) {
                     return true;
@@ -1527,6 +1622,48 @@ private:
     }
 
 
+    /* helper methods for handling subtrees emptied by setNull() */
+
+    // returns the entry of the last level at position x
+    inline elem_type leaf(size_type x) const {
+
+        K2TREES_COUNT(leafProbes);
+        return L_[x];
+
+    }
+
+    // checks whether node z has children, i.e. whether its bit in T is set and its subtree has not been emptied by setNull()
+    inline bool hasChildren(size_type z) const {
+
+        K2TREES_COUNT(nodesVisited);
+        return T_[z] && (emptyNodes_.empty() || !emptyNodes_[z]);
+
+    }
+
+    // checks whether all len nodes of the block starting at position y are empty
+    bool isEmptyBlock(size_type y, size_type len) const {
+
+        for (size_type c = y; c < y + len; c++) {
+            if ((c >= T_.size()) ? (leaf(c - T_.size()) != null_) : hasChildren(c)) {
+                return false;
+            }
+        }
+
+        return true;
+
+    }
+
+    // marks the subtree of node z as empty
+    void markEmpty(size_type z) {
+
+        if (emptyNodes_.empty()) {
+            emptyNodes_ = bit_vector_type(T_.size(), 0);
+        }
+
+        emptyNodes_[z] = 1;
+
+    }
+
     /* setNull() */
 
     void setInit(size_type q) {
@@ -1539,18 +1676,37 @@ private:
 
     }
 
-    void set(size_type n, size_type q, size_type z, size_type l) {
+    // clears the entry in the subtree of z, returns true iff the subtree is empty afterwards
+    bool set(size_type n, size_type q, size_type z, size_type l) {
 
         if (z >= T_.size()) {
+
             L_[z - T_.size()] = null_;
+
+            return true;
+
         } else {
 
             auto k = (l < upperH_) ? upperK_ : lowerK_;
 
-            if (T_[z]) {
-                set(n / k, q % (n / k), (l >= upperH_) * upperLength_ + (R_.rank(z + 1) - (l >= upperH_) * (upperOnes_ + 1)) * k + q / (n / k), l + 1);
+            if (hasChildren(z)) {
+
+                size_type y = (l >= upperH_) * upperLength_ + (R_.rank(z + 1) - (l >= upperH_) * (upperOnes_ + 1)) * k;
+
+                // mark z if its whole subtree has become empty
+                if (set(n / k, q % (n / k), y + q / (n / k), l + 1) && isEmptyBlock(y, k)) {
+
+                    markEmpty(z);
+                    return true;
+
+                }
+
+                return false;
+
             }
 
+            return true;
+
         }
 
     }
@@ -1591,6 +1747,7 @@ public:
         T_ = other.T_;
         L_ = other.L_;
         R_ = rank_type(&T_);
+        emptyNodes_ = other.emptyNodes_;
 
     }
 
@@ -1613,6 +1770,7 @@ public:
         T_ = other.T_;
         L_ = other.L_;
         R_ = rank_type(&T_);
+        emptyNodes_ = other.emptyNodes_;
 
         return *this;
 
@@ -1878,57 +2036,57 @@ public:
 
 
     // returns the arity of the upper part of the RowTree
-    size_type getUpperK() {
+    size_type getUpperK() const {
         return upperK_;
     }
 
     // returns the arity of the lower part of the RowTree
-    size_type getLowerK() {
+    size_type getLowerK() const {
         return lowerK_;
     }
 
     // returns the height of the upper part of the RowTree
-    size_type getUpperH() {
+    size_type getUpperH() const {
         return upperH_;
     }
 
     // returns the number of 1-bits in the upper part of the RowTree
-    size_type getUpperOnes() {
+    size_type getUpperOnes() const {
         return upperOnes_;
     }
 
     // returns the number of bits in the upper part of the RowTree
-    size_type getUpperLength() {
+    size_type getUpperLength() const {
         return upperLength_;
     }
 
     // returns the height of the RowTree
-    size_type getH() {
+    size_type getH() const {
         return upperK_;
     }
 
-    size_type getLength() override {
+    size_type getLength() const override {
         return nPrime_;
     }
 
-    elem_type getNull() override {
+    elem_type getNull() const override {
         return null_;
     }
 
 
-    bool isNotNull(size_type i) override {
+    bool isNotNull(size_type i) const override {
         return checkInit(i);
     }
 
-    elem_type getElement(size_type i) override {
+    elem_type getElement(size_type i) const override {
         return isNotNull(i);
     }
 
-    std::vector<elem_type> getElementsInRange(size_type l, size_type r) override {
+    std::vector<elem_type> getElementsInRange(size_type l, size_type r) const override {
         return std::vector<elem_type>(getPositionsInRange(l, r).size(), 1);
     }
 
-    std::vector<size_type> getPositionsInRange(size_type l, size_type r) override {
+    std::vector<size_type> getPositionsInRange(size_type l, size_type r) const override {
 
         std::vector<size_type> positions;
         rangeInit(positions, l, r);
@@ -1938,7 +2096,7 @@ public:
 
     }
 
-    std::vector<std::pair<size_type, elem_type>> getValuedPositionsInRange(size_type l, size_type r) override {
+    std::vector<std::pair<size_type, elem_type>> getValuedPositionsInRange(size_type l, size_type r) const override {
 
         std::vector<size_type> positions;
         rangeInit(positions, l, r);
@@ -1953,11 +2111,11 @@ public:
 
     }
 
-    std::vector<elem_type> getAllElements() override {
+    std::vector<elem_type> getAllElements() const override {
         return std::vector<elem_type>(countElements(), 1);
     }
 
-    std::vector<size_type> getAllPositions() override {
+    std::vector<size_type> getAllPositions() const override {
 //        return getPositionsInRange(0, nPrime_ - 1);
         std::vector<size_type> positions;
         fullRangeIterative(positions);
@@ -1965,7 +2123,7 @@ public:
 
     }
 
-    std::vector<std::pair<size_type, elem_type>> getAllValuedPositions() override {
+    std::vector<std::pair<size_type, elem_type>> getAllValuedPositions() const override {
 //        return getValuedPositionsInRange(0, nPrime_ - 1);
         std::vector<std::pair<size_type, elem_type>> positions;
         fullRangeValPosIterative(positions);
@@ -1973,16 +2131,16 @@ public:
 
     }
 
-    bool containsElement(size_type l, size_type r) override {
+    bool containsElement(size_type l, size_type r) const override {
         return elemInRangeInit(l, r);
 //        return elemInRangeInit(l, std::min(r, nPrime_ - 1));
     }
 
-    size_type countElements() override {
+    size_type countElements() const override {
 
         size_type res = 0;
         for (auto i = 0; i < L_.size(); i++) {
-            res += L_[i];
+            res += leaf(i);
         }
 
         return res;
@@ -1994,7 +2152,7 @@ public:
         return new HybridRowTree<elem_type>(*this);
     }
 
-    void print(bool all = false) override {
+    void print(bool all = false) const override {
 
         std::cout << "### Parameters ###" << std::endl;
         std::cout << "h  = " << h_ << std::endl;
@@ -2024,12 +2182,96 @@ public:
 
     }
 
-    // note: can "invalidate" the data structure (containsElement() probably won't work correctly afterwards)
+    void serialize(std::ostream& out) const override {
+
+        writeHeader(out, "HybridRowTree<bool>", sizeof(elem_type));
+
+        writeValue(out, h_);
+        writeValue(out, upperH_);
+        writeValue(out, upperOnes_);
+        writeValue(out, upperLength_);
+        writeValue(out, upperK_);
+        writeValue(out, lowerK_);
+        writeValue(out, nPrime_);
+        writeValue(out, null_);
+
+        T_.serialize(out);
+        L_.serialize(out);
+        R_.serialize(out);
+        emptyNodes_.serialize(out);
+
+    }
+
+    void load(std::istream& in) override {
+
+        this->checkWritable("load");
+
+        unsigned int version = readHeader(in, "HybridRowTree<bool>", sizeof(elem_type));
+
+        readValue(in, h_);
+        readValue(in, upperH_);
+        readValue(in, upperOnes_);
+        readValue(in, upperLength_);
+        readValue(in, upperK_);
+        readValue(in, lowerK_);
+        readValue(in, nPrime_);
+        readValue(in, null_);
+
+        T_.load(in);
+        L_.load(in);
+        R_.load(in, &T_);
+        if (version >= 4) {
+            emptyNodes_.load(in);
+        } else {
+            emptyNodes_ = bit_vector_type();
+        }
+
+    }
+
+    // note: emptied subtrees are only marked, compact() removes them from the internal structure
     void setNull(size_type i) override {
+        this->checkWritable("setNull");
         setInit(i);
     }
 
-    size_type getFirst() override {
+    // rebuilds the internal structure from the remaining elements, so that the subtrees emptied by setNull() are removed
+    // (the size of the universe remains unchanged)
+    void compact() override {
+
+        this->checkWritable("compact");
+
+        if (emptyNodes_.empty()) {
+            return;
+        }
+
+        list_type pairs = getAllPositions();
+
+        T_ = bit_vector_type();
+        L_ = bit_vector_type();
+        emptyNodes_ = bit_vector_type();
+
+        if (!pairs.empty()) {
+            buildFromListsInplace(pairs);
+        }
+
+        R_ = rank_type(&T_);
+
+    }
+
+    SizeBreakdown sizeInBytes() const override {
+
+        SizeBreakdown s;
+        s.T = sdsl::size_in_bytes(T_);
+        s.L = sdsl::size_in_bytes(L_);
+        s.rank = sdsl::size_in_bytes(R_);
+        s.aux = sdsl::size_in_bytes(emptyNodes_);
+        s.other = sizeof(*this);
+
+        return s;
+
+    }
+
+    size_type getFirst() const override {
 //        return getFirstInit();
         return getFirstIterative();
     }
@@ -2038,7 +2280,7 @@ public:
 
 private:
     // representation of all but the last levels of the RowTree (internal structure)
-    bit_vector_type T_;
+    level_vector_type T_;
 
     // representation of the last level of the RowTree (actual values of the universe)
     bit_vector_type L_;
@@ -2046,6 +2288,9 @@ private:
     // rank data structure for navigation in T_
     rank_type R_;
 
+    // marks the internal nodes whose subtrees have been emptied by setNull() (empty if there are none), see compact()
+    bit_vector_type emptyNodes_;
+
     size_type upperK_; // arity in the upper part of the RowTree
     size_type lowerK_; // arity in the lower part of the RowTree
     size_type upperH_; // height of the upper part of the RowTree
@@ -2237,20 +2482,18 @@ private:
 
         } else {
 
-            std::vector<bool> T, L;
-            NaiveDynamicRank R;
+            DynamicVector<bool> T, L;
+            DynamicRank R;
 
             for (auto j = 0; j < list.size(); j++) {
                 insertInit(T, L, R, list[j]);
             }
 
             L_ = bit_vector_type(L.size());
-            std::move(L.begin(), L.end(), L_.begin());
-            L.clear();
-            L.shrink_to_fit();
+            L.copyTo(L_.begin());
 
             T_ = bit_vector_type(T.size());
-            std::move(T.begin(), T.end(), T_.begin());
+            T.copyTo(T_.begin());
 
         }
 
@@ -2258,14 +2501,14 @@ private:
 
     }
 
-    void insertInit(std::vector<bool>& T, std::vector<bool>& L, NaiveDynamicRank& R, size_type q) {
+    void insertInit(DynamicVector<bool>& T, DynamicVector<bool>& L, DynamicRank& R, size_type q) {
 
         auto k = (upperH_ > 0) ? upperK_ : lowerK_;
 
         if (T.empty()) {
 
-            T = std::vector<bool>(k);
-            R = NaiveDynamicRank(T);
+            T = DynamicVector<bool>(k, false);
+            R = DynamicRank(std::vector<bool>(k));
 
             upperOnes_ = 0;
             upperLength_ = (upperH_ > 0) ? k : 0;
@@ -2276,7 +2519,7 @@ private:
 
     }
 
-    void insert(std::vector<bool>& T, std::vector<bool>& L, NaiveDynamicRank& R, size_type n, size_type q, size_type z, size_type l) {
+    void insert(DynamicVector<bool>& T, DynamicVector<bool>& L, DynamicRank& R, size_type n, size_type q, size_type z, size_type l) {
 
         auto k = (l < upperH_) ? upperK_ : lowerK_;
 
@@ -2296,12 +2539,12 @@ private:
 
             if ((l + 1) == h_) {
 
-                L.insert(L.begin() + y - T.size(), k, 0);
+                L.insert(y - T.size(), k, 0);
                 L[y + q / (n / k) - T.size()] = 1;
 
             } else {
 
-                T.insert(T.begin() + y, k, 0);
+                T.insert(y, k, 0);
                 R.insert(y + 1, k);
 
                 insert(T, L, R, n / k, q % (n / k), y + q / (n / k), l + 1);
@@ -2310,7 +2553,7 @@ private:
 
         } else {
 
-            size_type y = (l >= upperH_) * upperLength_ + (R_.rank(z + 1) - (l >= upperH_) * (upperOnes_ + 1)) * k + q / (n / k);
+            size_type y = (l >= upperH_) * upperLength_ + (R.rank(z + 1) - (l >= upperH_) * (upperOnes_ + 1)) * k + q / (n / k);
 
             if ((l + 1) == h_) {
                 L[y - T.size()] = 1;
@@ -2570,7 +2813,7 @@ private:
 
     /* isNotNull() */
 
-    bool checkInit(size_type q) {
+    bool checkInit(size_type q) const {
 
         size_type k = (upperH_ > 0) ? upperK_ : lowerK_;
 
@@ -2578,10 +2821,10 @@ private:
 
     }
 
-    bool check(size_type n, size_type q, size_type z, size_type l) {
+    bool check(size_type n, size_type q, size_type z, size_type l) const {
 
         if (z >= T_.size()) {
-            return L_[z - T_.size()];
+            return leaf(z - T_.size());
         } else {
 
             auto k = (l < upperH_) ? upperK_ : lowerK_;
@@ -2594,7 +2837,7 @@ private:
 
     /* getRange() */
 
-    void fullRangeIterative(std::vector<size_type>& elems) {
+    void fullRangeIterative(std::vector<size_type>& elems) const {
 
         if (L_.empty()) return;
 
@@ -2605,7 +2848,7 @@ private:
         if (lenT == 0) {
 
             for (size_type i = 0; i < nPrime_; i++) {
-                if (L_[i]) {
+                if (leaf(i)) {
                     elems.push_back(i);
                 }
             }
@@ -2617,6 +2860,7 @@ private:
             size_type l = 1;
 
             for (size_type z = 0, dq = 0; z < k; z++, dq += n) {
+                K2TREES_COUNT(queuePushes);
                 queue.push(SubrowInfo(dq, z));
             }
 
@@ -2632,11 +2876,12 @@ private:
 
                     auto& cur = queue.front();
 
-                    if (T_[cur.z]) {
+                    if (hasChildren(cur.z)) {
 
                         auto y = a + (R_.rank(cur.z + 1) - b) * k;
 
                         for (size_type j = 0, newDq = cur.dq; j < k; j++, newDq += n, y++) {
+                            K2TREES_COUNT(queuePushes);
                             nextLevelQueue.push(SubrowInfo(newDq, y));
                         }
 
@@ -2657,12 +2902,12 @@ private:
 
                 auto& cur = queue.front();
 
-                if (T_[cur.z]) {
+                if (hasChildren(cur.z)) {
 
                     auto y = a + (R_.rank(cur.z + 1) - b) * k - lenT;
 
                     for (size_type j = 0, newDq = cur.dq; j < k; j++, newDq += n, y++) {
-                        if (L_[y]) {
+                        if (leaf(y)) {
                             elems.push_back(newDq);
                         }
                     }
@@ -2677,7 +2922,7 @@ private:
 
     }
 
-    void fullRangeValPosIterative(std::vector<std::pair<size_type, elem_type>>& elems) {
+    void fullRangeValPosIterative(std::vector<std::pair<size_type, elem_type>>& elems) const {
 
         if (L_.empty()) return;
 
@@ -2688,7 +2933,7 @@ private:
         if (lenT == 0) {
 
             for (size_type i = 0; i < nPrime_; i++) {
-                if (L_[i]) {
+                if (leaf(i)) {
                     elems.push_back(std::make_pair(i, 1));
                 }
             }
@@ -2700,6 +2945,7 @@ private:
             size_type l = 1;
 
             for (size_type z = 0, dq = 0; z < k; z++, dq += n) {
+                K2TREES_COUNT(queuePushes);
                 queue.push(SubrowInfo(dq, z));
             }
 
@@ -2715,11 +2961,12 @@ private:
 
                     auto& cur = queue.front();
 
-                    if (T_[cur.z]) {
+                    if (hasChildren(cur.z)) {
 
                         auto y = a + (R_.rank(cur.z + 1) - b) * k;
 
                         for (size_type j = 0, newDq = cur.dq; j < k; j++, newDq += n, y++) {
+                            K2TREES_COUNT(queuePushes);
                             nextLevelQueue.push(SubrowInfo(newDq, y));
                         }
 
@@ -2740,12 +2987,12 @@ private:
 
                 auto& cur = queue.front();
 
-                if (T_[cur.z]) {
+                if (hasChildren(cur.z)) {
 
                     auto y = a + (R_.rank(cur.z + 1) - b) * k - lenT;
 
                     for (size_type j = 0, newDq = cur.dq; j < k; j++, newDq += n, y++) {
-                        if (L_[y]) {
+                        if (leaf(y)) {
                             elems.push_back(std::make_pair(newDq, 1));
                         }
                     }
@@ -2760,7 +3007,7 @@ private:
 
     }
 
-    void rangeInit(std::vector<size_type>& elems, size_type l, size_type r) {
+    void rangeInit(std::vector<size_type>& elems, size_type l, size_type r) const {
 
         if (!L_.empty()) {
 
@@ -2782,17 +3029,17 @@ private:
 
     }
 
-    void range(std::vector<size_type>& elems, size_type n, size_type l, size_type r, size_type dq, size_type z, size_type level) {
+    void range(std::vector<size_type>& elems, size_type n, size_type l, size_type r, size_type dq, size_type z, size_type level) const {
 
         if (z >= T_.size()) {
 
-            if (L_[z - T_.size()]) {
+            if (leaf(z - T_.size())) {
                 elems.push_back(dq);
             }
 
         } else {
 
-            if (T_[z]) {
+            if (hasChildren(z)) {
 
                 auto k = (level < upperH_) ? upperK_ : lowerK_;
                 auto y = (level >= upperH_) * upperLength_ + (R_.rank(z + 1) - (level >= upperH_) * (upperOnes_ + 1)) * k;
@@ -2817,14 +3064,10 @@ private:
 
     /* containsElement() */
 
-    bool elemInRangeInit(size_type l, size_type r) {
+    bool elemInRangeInit(size_type l, size_type r) const {
 
         if (!L_.empty()) {
 
-            if ((l == 0) && (r == (nPrime_ - 1))) {
-                return 1;
-            }
-
             size_type k = (upperH_ > 0) ? upperK_ : lowerK_;
 
             for (auto j = l / (nPrime_ / k); j <= r / (nPrime_ / k); j++) {
@@ -2841,15 +3084,15 @@ private:
 
     }
 
-    bool elemInRange(size_type n, size_type l, size_type r, size_type z, size_type level) {
+    bool elemInRange(size_type n, size_type l, size_type r, size_type z, size_type level) const {
 
         if (z >= T_.size()) {
 
-            return L_[z - T_.size()];
+            return leaf(z - T_.size());
 
         } else {
 
-            if (T_[z]) {
+            if (hasChildren(z)) {
 
                 if ((l == 0) && (r == (n - 1))) {
                     return true;
@@ -2875,6 +3118,48 @@ private:
     }
 
 
+    /* helper methods for handling subtrees emptied by setNull() */
+
+    // returns the entry of the last level at position x
+    inline bool leaf(size_type x) const {
+
+        K2TREES_COUNT(leafProbes);
+        return L_[x];
+
+    }
+
+    // checks whether node z has children, i.e. whether its bit in T is set and its subtree has not been emptied by setNull()
+    inline bool hasChildren(size_type z) const {
+
+        K2TREES_COUNT(nodesVisited);
+        return T_[z] && (emptyNodes_.empty() || !emptyNodes_[z]);
+
+    }
+
+    // checks whether all len nodes of the block starting at position y are empty
+    bool isEmptyBlock(size_type y, size_type len) const {
+
+        for (size_type c = y; c < y + len; c++) {
+            if ((c >= T_.size()) ? leaf(c - T_.size()) : hasChildren(c)) {
+                return false;
+            }
+        }
+
+        return true;
+
+    }
+
+    // marks the subtree of node z as empty
+    void markEmpty(size_type z) {
+
+        if (emptyNodes_.empty()) {
+            emptyNodes_ = bit_vector_type(T_.size(), 0);
+        }
+
+        emptyNodes_[z] = 1;
+
+    }
+
     /* setNull() */
 
     void setInit(size_type q) {
@@ -2887,32 +3172,51 @@ private:
 
     }
 
-    void set(size_type n, size_type q, size_type z, size_type l) {
+    // clears the entry in the subtree of z, returns true iff the subtree is empty afterwards
+    bool set(size_type n, size_type q, size_type z, size_type l) {
 
         if (z >= T_.size()) {
+
             L_[z - T_.size()] = null_;
+
+            return true;
+
         } else {
 
             auto k = (l < upperH_) ? upperK_ : lowerK_;
 
-            if (T_[z]) {
-                set(n / k, q % (n / k), (l >= upperH_) * upperLength_ + (R_.rank(z + 1) - (l >= upperH_) * (upperOnes_ + 1)) * k + q / (n / k), l + 1);
+            if (hasChildren(z)) {
+
+                size_type y = (l >= upperH_) * upperLength_ + (R_.rank(z + 1) - (l >= upperH_) * (upperOnes_ + 1)) * k;
+
+                // mark z if its whole subtree has become empty
+                if (set(n / k, q % (n / k), y + q / (n / k), l + 1) && isEmptyBlock(y, k)) {
+
+                    markEmpty(z);
+                    return true;
+
+                }
+
+                return false;
+
             }
 
+            return true;
+
         }
 
     }
 
     /* getFirst() */
 
-    size_type getFirstIterative() {
+    size_type getFirstIterative() const {
 
         if (L_.empty()) return nPrime_;
 
         if (T_.size() == 0) {
 
             for (size_type i = 0; i < nPrime_; i++) {
-                if (L_[i]) {
+                if (leaf(i)) {
                     return i;
                 }
             }
@@ -2927,7 +3231,7 @@ private:
 
             while (z < T_.size()) {
 
-                if (T_[z]) {
+                if (hasChildren(z)) {
 
                     k = (level < upperH_) ? upperK_ : lowerK_;
                     n /= k;
@@ -2946,7 +3250,7 @@ private:
             k = (level < upperH_) ? upperK_ : lowerK_;
             for (size_type offset = 0; offset < k; offset++) {
 
-                if (L_[z - T_.size() + offset]) {
+                if (leaf(z - T_.size() + offset)) {
                     return dq + offset;
                 }
 
@@ -2958,7 +3262,7 @@ private:
 
     }
 
-    size_type getFirstInit() {
+    size_type getFirstInit() const {
 
         size_type pos = nPrime_;
 
@@ -2983,19 +3287,19 @@ private:
 
     }
 
-    size_type getFirst(size_type n, size_type l, size_type r, size_type dq, size_type z, size_type level) {
+    size_type getFirst(size_type n, size_type l, size_type r, size_type dq, size_type z, size_type level) const {
 
         size_type pos = nPrime_;
 
         if (z >= T_.size()) {
 
-            if (L_[z - T_.size()]) {
+            if (leaf(z - T_.size())) {
                 pos = dq;
             }
 
         } else {
 
-            if (T_[z]) {
+            if (hasChildren(z)) {
 
                 auto k = (level < upperH_) ? upperK_ : lowerK_;
                 auto y = (level >= upperH_) * upperLength_ + (R_.rank(z + 1) - (level >= upperH_) * (upperOnes_ + 1)) * k;
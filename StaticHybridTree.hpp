@@ -50,6 +50,15 @@ public:
     typedef typename K2Tree<elem_type>::positions_type positions_type;
     typedef typename K2Tree<elem_type>::pairs_type pairs_type;
 
+    // output-buffer and limited variants of the query methods (see K2Tree)
+    using K2Tree<elem_type>::getSuccessorPositions;
+    using K2Tree<elem_type>::getPredecessorPositions;
+    using K2Tree<elem_type>::getPositionsInRange;
+    using K2Tree<elem_type>::getAllValuedPositions;
+    using K2Tree<elem_type>::getSuccessors;
+    using K2Tree<elem_type>::getRange;
+    using K2Tree<elem_type>::expandFrontier;
+
 
     HybridK2Tree() {
         // nothing to do
@@ -68,7 +77,13 @@ public:
 
         T_ = other.T_;
         L_ = other.L_;
+        compressedL_ = other.compressedL_;
         R_ = rank_type(&T_);
+        emptyNodes_ = other.emptyNodes_;
+        countSamples_ = other.countSamples_;
+        topNodes_ = other.topNodes_;
+        tableH_ = other.tableH_;
+        tableN_ = other.tableN_;
 
     }
 
@@ -90,7 +105,13 @@ public:
 
         T_ = other.T_;
         L_ = other.L_;
+        compressedL_ = other.compressedL_;
         R_ = rank_type(&T_);
+        emptyNodes_ = other.emptyNodes_;
+        countSamples_ = other.countSamples_;
+        topNodes_ = other.topNodes_;
+        tableH_ = other.tableH_;
+        tableN_ = other.tableN_;
 
         return *this;
 
@@ -269,9 +290,13 @@ public:
     }
 
     /**
-     * List-of-pairs-based constructor (based on section 3.3.5. of Brisaboa et al.)
+     * List-of-pairs-based constructor
+     *
+     * The mixed-radix keys of the pairs are radix-sorted once and the levels are emitted in a single sweep over them
+     * (see buildLevelsFromSortedKeys()) using up to numThreads threads. If the keys do not fit into 64 bits, the tree is built
+     * level by level as in section 3.3.5. of Brisaboa et al., the subproblems of each level are processed by up to numThreads threads.
      */
-    HybridK2Tree(pairs_type& pairs, const size_type upperK, const size_type upperH, const size_type lowerK, const elem_type null = elem_type()) {
+    HybridK2Tree(pairs_type& pairs, const size_type upperK, const size_type upperH, const size_type lowerK, const elem_type null = elem_type(), const size_type numThreads = 1) {
 
         null_ = null;
 
@@ -297,7 +322,7 @@ public:
         } while (nPrime_ < maxDim);
 
         if (pairs.size() != 0) {
-            buildFromListsInplace(pairs);
+            buildFromSortedKeys(pairs, numThreads);
         }
 
         R_ = rank_type(&T_);
@@ -306,57 +331,67 @@ public:
 
 
     // returns the arity of the upper part of the K2Tree
-    size_type getUpperK() {
+    size_type getUpperK() const {
         return upperK_;
     }
 
     // returns the arity of the lower part of the K2Tree
-    size_type getLowerK() {
+    size_type getLowerK() const {
         return lowerK_;
     }
 
     // returns the height of the upper part of the K2Tree
-    size_type getUpperH() {
+    size_type getUpperH() const {
         return upperH_;
     }
 
     // returns the number of 1-bits in the upper part of the K2Tree
-    size_type getUpperOnes() {
+    size_type getUpperOnes() const {
         return upperOnes_;
     }
 
     // returns the number of bits in the upper part of the K2Tree
-    size_type getUpperLength() {
+    size_type getUpperLength() const {
         return upperLength_;
     }
 
     // returns the height of the K2Tree
-    size_type getH() {
+    size_type getH() const {
         return upperK_;
     }
 
-    size_type getNumRows() override {
+    size_type getNumRows() const override {
         return nPrime_;
     }
 
-    size_type getNumCols() override {
+    size_type getNumCols() const override {
         return nPrime_;
     }
 
-    elem_type getNull() override {
+    elem_type getNull() const override {
         return null_;
     }
 
 
-    bool isNotNull(size_type i, size_type j) override {
+    bool isNotNull(size_type i, size_type j) const override {
         return checkInit(i, j);
     }
 
-    elem_type getElement(size_type i, size_type j) override {
+    elem_type getElement(size_type i, size_type j) const override {
         return getInit(i, j);
     }
 
-    std::vector<elem_type> getSuccessorElements(size_type i) override {
+    void isNotNull(const positions_type& queries, std::vector<bool>& out) const override {
+        out.assign(queries.size(), false);
+        batchInit(queries, [&](size_type x, size_type pos) { out[x] = (leaf(pos) != null_); });
+    }
+
+    void getElement(const positions_type& queries, std::vector<elem_type>& out) const override {
+        out.assign(queries.size(), null_);
+        batchInit(queries, [&](size_type x, size_type pos) { out[x] = leaf(pos); });
+    }
+
+    std::vector<elem_type> getSuccessorElements(size_type i) const override {
 
         std::vector<elem_type> succs;
 //        successorsElemInit(succs, i);
@@ -366,7 +401,7 @@ public:
 
     }
 
-    std::vector<size_type> getSuccessorPositions(size_type i) override {
+    std::vector<size_type> getSuccessorPositions(size_type i) const override {
 
         std::vector<size_type> succs;
 //        successorsPosInit(succs, i);
@@ -376,7 +411,7 @@ public:
 
     }
 
-    pairs_type getSuccessorValuedPositions(size_type i) override {
+    pairs_type getSuccessorValuedPositions(size_type i) const override {
 
         pairs_type succs;
 //        successorsValPosInit(succs, i);
@@ -386,7 +421,7 @@ public:
 
     }
 
-    std::vector<elem_type> getPredecessorElements(size_type j) override {
+    std::vector<elem_type> getPredecessorElements(size_type j) const override {
 
         std::vector<elem_type> preds;
         predecessorsElemInit(preds, j);
@@ -395,7 +430,7 @@ public:
 
     }
 
-    std::vector<size_type> getPredecessorPositions(size_type j) override {
+    std::vector<size_type> getPredecessorPositions(size_type j) const override {
 
         std::vector<size_type> preds;
         predecessorsPosInit(preds, j);
@@ -404,7 +439,7 @@ public:
 
     }
 
-    pairs_type getPredecessorValuedPositions(size_type j) override {
+    pairs_type getPredecessorValuedPositions(size_type j) const override {
 
         pairs_type preds;
         predecessorsValPosInit(preds, j);
@@ -413,7 +448,7 @@ public:
 
     }
 
-    std::vector<elem_type> getElementsInRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    std::vector<elem_type> getElementsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
 
         std::vector<elem_type> elements;
         rangeElemInit(elements, i1, i2, j1, j2);
@@ -423,7 +458,7 @@ public:
 
     }
 
-    positions_type getPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    positions_type getPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
 
         positions_type pairs;
         rangePosInit(pairs, i1, i2, j1, j2);
@@ -433,7 +468,7 @@ public:
 
     }
 
-    pairs_type getValuedPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    pairs_type getValuedPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
 
         pairs_type pairs;
         rangeValPosInit(pairs, i1, i2, j1, j2);
@@ -443,40 +478,170 @@ public:
 
     }
 
-    std::vector<elem_type> getAllElements() override {
+    std::vector<elem_type> getAllElements() const override {
         return getElementsInRange(0, nPrime_ - 1, 0, nPrime_ - 1);
     }
 
-    positions_type getAllPositions() override {
+    positions_type getAllPositions() const override {
         return getPositionsInRange(0, nPrime_ - 1, 0, nPrime_ - 1);
     }
 
-    pairs_type getAllValuedPositions() override {
+    pairs_type getAllValuedPositions() const override {
         return getValuedPositionsInRange(0, nPrime_ - 1, 0, nPrime_ - 1);
     }
 
-    bool containsElement(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    bool forEachSuccessorPosition(size_type i, const std::function<bool(size_type)>& visitor) const override {
+        return successorsVisitInit(visitor, i);
+    }
+
+    bool forEachPredecessorPosition(size_type j, const std::function<bool(size_type)>& visitor) const override {
+        return predecessorsVisitInit(visitor, j);
+    }
+
+    bool forEachValuedPositionInRange(size_type i1, size_type i2, size_type j1, size_type j2, const std::function<bool(size_type, size_type, elem_type)>& visitor) const override {
+        return rangeValVisitInit(visitor, i1, i2, j1, j2);
+    }
+
+    bool containsElement(size_type i1, size_type i2, size_type j1, size_type j2) const override {
         return elemInRangeInit(i1, i2, j1, j2);
 //        return elemInRangeInit(i1, std::min(i2, nPrime_ - 1), j1, std::min(j2, nPrime_ - 1));
     }
 
-    size_type countElements() override {
+    size_type countElements() const override {
+
+        if (!countSamples_.empty()) {
+            return countSamples_.back();
+        }
 
         size_type cnt = 0;
-        for (size_type i = 0; i < L_.size(); i++) {
-            cnt += (L_[i] != null_);
+        for (size_type i = 0; i < numLeaves(); i++) {
+            cnt += (leaf(i) != null_);
         }
 
         return cnt;
 
     }
 
+    size_type countElementsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
+        return countRangeInit(i1, i2, j1, j2);
+    }
+
+    // builds the (optional) counting index, a sampled prefix sum over the non-null entries of L,
+    // which makes countElements() constant-time and speeds up counting fully covered submatrices in countElementsInRange()
+    // (the index is kept up to date by setNull(), but it is not written by serialize())
+    void buildCountingIndex() {
+
+        this->checkWritable("buildCountingIndex");
+
+        size_type numSamples = numLeaves() / K2TREES_COUNT_SAMPLE_RATE + 1;
+        countSamples_.assign(numSamples + 1, 0);
+
+        size_type cnt = 0;
+        for (size_type s = 0; s < numSamples; s++) {
+
+            countSamples_[s] = cnt;
+            for (size_type x = s * K2TREES_COUNT_SAMPLE_RATE; x < std::min((s + 1) * K2TREES_COUNT_SAMPLE_RATE, numLeaves()); x++) {
+                cnt += (leaf(x) != null_);
+            }
+
+        }
+
+        countSamples_[numSamples] = cnt;
+
+    }
+
+    bool hasCountingIndex() const {
+        return !countSamples_.empty();
+    }
+
+    // builds a direct lookup table for the nodes of the upper levels levels of the K2Tree (upperK^(2 * levels) entries, at most getMaxLookupTableLevels() levels),
+    // so that point queries start their descent at the corresponding node and skip the accesses to T on these levels
+    // (like the counting index, the table is not written by serialize())
+    void buildLookupTable(size_type levels) {
+
+        this->checkWritable("buildLookupTable");
+
+        size_type maxLevels = getMaxLookupTableLevels();
+        if ((levels == 0) || (levels > maxLevels)) {
+            throw std::runtime_error("Number of levels for the lookup table has to be between 1 and " + std::to_string(maxLevels) + " (see getMaxLookupTableLevels()).");
+        }
+
+        size_type width = size_type(pow(upperK_, levels));
+        size_type n = nPrime_ / width;
+        topNodes_.assign(width * width, 0);
+
+        for (size_type r = 0; r < width; r++) {
+            for (size_type c = 0; c < width; c++) {
+
+                // descend to the node covering submatrix (r, c) or stop at its closest (empty) ancestor
+                size_type p = r * n;
+                size_type q = c * n;
+                size_type m = nPrime_ / upperK_;
+                size_type z = (p / m) * upperK_ + q / m;
+                for (size_type l = 1; (l < levels) && (z < T_.size()) && T_[z]; l++) {
+
+                    p %= m;
+                    q %= m;
+                    m /= upperK_;
+                    z = R_.rank(z + 1) * upperK_ * upperK_ + (p / m) * upperK_ + q / m;
+
+                }
+
+                topNodes_[r * width + c] = z;
+
+            }
+        }
+
+        tableH_ = levels;
+        tableN_ = n;
+
+    }
+
+    bool hasLookupTable() const {
+        return !topNodes_.empty();
+    }
+
+    // returns the largest number of levels accepted by buildLookupTable() (at most upperH): the table may take at most
+    // K2TREES_LOOKUP_TABLE_MAX_RATIO times the space of T and its rank data structure, only the table of the first level is always permitted
+    size_type getMaxLookupTableLevels() const {
+
+        double budget = K2TREES_LOOKUP_TABLE_MAX_RATIO * (sdsl::size_in_bytes(T_) + sdsl::size_in_bytes(R_)) / sizeof(size_type); // in entries
+
+        size_type levels = std::min((size_type) 1, upperH_);
+        while ((levels < upperH_) && (pow(upperK_, 2 * (levels + 1)) <= budget)) {
+            levels++;
+        }
+
+        return levels;
+
+    }
+
+    // replaces the last level L by a dictionary of its distinct lowerK*lowerK blocks (sorted by decreasing frequency)
+    // and the DAC-encoded dictionary index of every leaf block, which saves space when few distinct blocks
+    // (e.g. few distinct weights) make up most of L; afterwards, setNull() is no longer supported
+    void compressLeaves() {
+
+        this->checkWritable("compressLeaves");
+
+        if (L_.empty()) {
+            return;
+        }
+
+        compressedL_ = LeafDictionary<elem_type>(L_, lowerK_ * lowerK_);
+        L_ = std::vector<elem_type>(0);
+
+    }
+
+    bool hasCompressedLeaves() const {
+        return !compressedL_.empty();
+    }
+
 
     HybridK2Tree* clone() const override {
         return new HybridK2Tree<elem_type>(*this);
     }
 
-    void print(bool all = false) override {
+    void print(bool all = false) const override {
 
         std::cout << "### Parameters ###" << std::endl;
         std::cout << "h  = " << h_ << std::endl;
@@ -495,7 +660,7 @@ public:
             std::cout << std::endl << std::endl;
 
             std::cout << "### L ###" << std::endl;
-            for (size_type i = 0; i < L_.size(); i++) std::cout << L_[i];
+            for (size_type i = 0; i < numLeaves(); i++) std::cout << leaf(i);
             std::cout << std::endl << std::endl;
 
             std::cout << "### R ###" << std::endl;
@@ -506,42 +671,166 @@ public:
 
     }
 
-    // note: can "invalidate" the data structure (containsLink() probably won't work correctly afterwards)
+    void serialize(std::ostream& out) const override {
+
+        writeHeader(out, "HybridK2Tree", sizeof(elem_type));
+
+        writeValue(out, h_);
+        writeValue(out, upperH_);
+        writeValue(out, upperOnes_);
+        writeValue(out, upperLength_);
+        writeValue(out, upperK_);
+        writeValue(out, lowerK_);
+        writeValue(out, nPrime_);
+        writeValue(out, null_);
+
+        T_.serialize(out);
+        writeVector(out, L_);
+        compressedL_.serialize(out);
+        R_.serialize(out);
+        emptyNodes_.serialize(out);
+
+    }
+
+    void load(std::istream& in) override {
+
+        this->checkWritable("load");
+
+        unsigned int version = readHeader(in, "HybridK2Tree", sizeof(elem_type));
+
+        readValue(in, h_);
+        readValue(in, upperH_);
+        readValue(in, upperOnes_);
+        readValue(in, upperLength_);
+        readValue(in, upperK_);
+        readValue(in, lowerK_);
+        readValue(in, nPrime_);
+        readValue(in, null_);
+
+        T_.load(in);
+        readVector(in, L_);
+        if (version >= 2) {
+            compressedL_.load(in);
+        } else {
+            compressedL_ = LeafDictionary<elem_type>();
+        }
+        R_.load(in, &T_);
+        if (version >= 4) {
+            emptyNodes_.load(in);
+        } else {
+            emptyNodes_ = bit_vector_type();
+        }
+
+        countSamples_.clear();
+        topNodes_.clear();
+        tableH_ = 0;
+        tableN_ = 0;
+
+    }
+
+    // note: emptied subtrees are only marked, compact() removes them from the internal structure
     void setNull(size_type i, size_type j) override {
+
+        this->checkWritable("setNull");
+
+        if (!compressedL_.empty()) {
+            throw std::runtime_error("setNull() is not supported after compressLeaves().");
+        }
+
         setInit(i, j);
     }
 
-    size_type getFirstSuccessor(size_type i) override {
+    // rebuilds the internal structure from the remaining elements, so that the subtrees emptied by setNull() are removed
+    // (the size of the relation matrix remains unchanged, the counting index and the lookup table are rebuilt if present)
+    void compact() override {
+
+        this->checkWritable("compact");
+
+        if (emptyNodes_.empty()) {
+            return;
+        }
+
+        pairs_type pairs = getAllValuedPositions();
+
+        T_ = bit_vector_type();
+        L_.clear();
+        emptyNodes_ = bit_vector_type();
+
+        if (!pairs.empty()) {
+            buildFromListsInplace(pairs, 1);
+        }
+
+        R_ = rank_type(&T_);
+
+        if (!countSamples_.empty()) {
+            buildCountingIndex();
+        }
+
+        if (!topNodes_.empty()) {
+            buildLookupTable(std::min(tableH_, getMaxLookupTableLevels()));
+        }
+
+    }
+
+    SizeBreakdown sizeInBytes() const override {
+
+        SizeBreakdown s;
+        s.T = sdsl::size_in_bytes(T_);
+        s.L = vectorBytes(L_) + compressedL_.sizeInBytes();
+        s.rank = sdsl::size_in_bytes(R_);
+        s.aux = sdsl::size_in_bytes(emptyNodes_) + vectorBytes(countSamples_) + vectorBytes(topNodes_);
+        s.other = sizeof(*this);
+
+        return s;
+
+    }
+
+    size_type getFirstSuccessor(size_type i) const override {
 //        return firstSuccessorInit(i);
         return firstSuccessorPositionIterative(i);
     }
 
+    std::vector<size_type> expandFrontier(const std::vector<size_type>& frontier, std::vector<bool>& visited) const override {
+
+        auto rows = this->prepareFrontier(frontier, visited);
+        std::vector<size_type> cols;
+
+        if ((numLeaves() != 0) && !rows.empty()) {
+            frontierPos(cols, visited, nPrime_, 0, 0, rows.cbegin(), rows.cend(), 0, 0);
+        }
+
+        this->finishFrontier(cols, visited);
+
+        return cols;
+
+    }
+
 
     /*
      * Method aliases using "relation nomenclature" (similar to the names proposed by Brisaboa et al.)
      */
 
-    bool areRelated(size_type i, size_type j) override {
+    bool areRelated(size_type i, size_type j) const override {
         return isNotNull(i, j);
     }
 
-    std::vector<size_type> getSuccessors(size_type i) override {
+    std::vector<size_type> getSuccessors(size_type i) const override {
         return getSuccessorPositions(i);
     }
 
-    std::vector<size_type> getPredecessors(size_type j) override {
+    std::vector<size_type> getPredecessors(size_type j) const override {
         return getPredecessorPositions(j);
     }
 
-    positions_type getRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    positions_type getRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
         return getPositionsInRange(i1, i2, j1, j2);
     }
 
-    bool containsLink(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    bool containsLink(size_type i1, size_type i2, size_type j1, size_type j2) const override {
         return containsElement(i1, i2, j1, j2);
     }
 
-    size_type countLinks() override {
+    size_type countLinks() const override {
         return countElements();
     }
 
@@ -549,14 +838,29 @@ public:
 
 private:
     // representation of all but the last levels of the K2Tree (internal structure)
-    bit_vector_type T_;
+    level_vector_type T_;
 
     // representation of the last level of the K2Tree (actual values of the relation)
     std::vector<elem_type> L_;
 
+    // (optional) compressed representation of the last level, replaces L_ after compressLeaves()
+    LeafDictionary<elem_type> compressedL_;
+
     // rank data structure for navigation in T_
     rank_type R_;
 
+    // marks the internal nodes whose subtrees have been emptied by setNull() (empty if there are none), see compact()
+    bit_vector_type emptyNodes_;
+
+    // (optional) counting index: number of non-null entries in L_[0..s * K2TREES_COUNT_SAMPLE_RATE) for all samples s, followed by the total number
+    std::vector<size_type> countSamples_;
+
+    // (optional) lookup table: node on level tableH_ covering submatrix (r, c) of edge length tableN_ (or its closest empty ancestor)
+    // at position r * (nPrime_ / tableN_) + c
+    std::vector<size_type> topNodes_;
+    size_type tableH_ = 0;
+    size_type tableN_ = 0;
+
     size_type upperK_; // arity in the upper part of the K2Tree
     size_type lowerK_; // arity in the lower part of the K2Tree
     size_type upperH_; // height of the upper part of the K2Tree
@@ -779,17 +1083,21 @@ private:
 
         } else {
 
-            std::vector<bool> T;
-            NaiveDynamicRank R;
+            DynamicVector<bool> T;
+            DynamicVector<elem_type> L;
+            DynamicRank R;
 
             for (size_type i = 0; i < lists.size(); i++) {
                 for (size_type j = 0; j < lists[i].size(); j++) {
-                    insertInit(T, R, i, lists[i][j].first, lists[i][j].second);
+                    insertInit(T, L, R, i, lists[i][j].first, lists[i][j].second);
                 }
             }
 
+            L_ = std::vector<elem_type>(L.size());
+            L.copyTo(L_.begin());
+
             T_ = bit_vector_type(T.size());
-            std::move(T.begin(), T.end(), T_.begin());
+            T.copyTo(T_.begin());
 
         }
 
@@ -797,25 +1105,25 @@ private:
 
     }
 
-    void insertInit(std::vector<bool>& T, NaiveDynamicRank& R, size_type p, size_type q, elem_type val) {
+    void insertInit(DynamicVector<bool>& T, DynamicVector<elem_type>& L, DynamicRank& R, size_type p, size_type q, elem_type val) {
 
         auto k = (upperH_ > 0) ? upperK_ : lowerK_;
 
         if (T.empty()) {
 
-            T = std::vector<bool>(k * k);
-            R = NaiveDynamicRank(T);
+            T = DynamicVector<bool>(k * k, false);
+            R = DynamicRank(std::vector<bool>(k * k));
 
             upperOnes_ = 0;
             upperLength_ = (upperH_ > 0) ? k * k : 0;
 
         }
 
-        insert(T, R, nPrime_ / k, p % (nPrime_ / k), q % (nPrime_ / k), val, (p / (nPrime_ / k)) * k + q / (nPrime_ / k), 1);
+        insert(T, L, R, nPrime_ / k, p % (nPrime_ / k), q % (nPrime_ / k), val, (p / (nPrime_ / k)) * k + q / (nPrime_ / k), 1);
 
     }
 
-    void insert(std::vector<bool>& T, NaiveDynamicRank& R, size_type n, size_type p, size_type q, elem_type val, size_type z, size_type l) {
+    void insert(DynamicVector<bool>& T, DynamicVector<elem_type>& L, DynamicRank& R, size_type n, size_type p, size_type q, elem_type val, size_type z, size_type l) {
 
         auto k = (l < upperH_) ? upperK_ : lowerK_;
 
@@ -827,7 +1135,7 @@ private:
             if (l < upperH_) {
 
                 upperOnes_++;
-                upperLength_ += k;
+                upperLength_ += k * k;
 
             }
 
@@ -835,15 +1143,15 @@ private:
 
             if ((l + 1) == h_) {
 
-                L_.insert(L_.begin() + y - T.size(), k * k, null_);
-                L_[y + (p / (n / k)) * k + q / (n / k) - T.size()] = val;
+                L.insert(y - T.size(), k * k, null_);
+                L[y + (p / (n / k)) * k + q / (n / k) - T.size()] = val;
 
             } else {
 
-                T.insert(T.begin() + y, k * k, 0);
+                T.insert(y, k * k, 0);
                 R.insert(y + 1, k * k);
 
-                insert(T, R, n / k, p % (n / k), q % (n / k), val, y, l + 1);
+                insert(T, L, R, n / k, p % (n / k), q % (n / k), val, y + (p / (n / k)) * k + q / (n / k), l + 1);
 
             }
 
@@ -852,121 +1160,111 @@ private:
             size_type y = (l >= upperH_) * upperLength_ + (R.rank(z + 1) - (l >= upperH_) * (upperOnes_ + 1)) * k * k + (p / (n / k)) * k + q / (n / k);
 
             if ((l + 1) == h_) {
-                L_[y - T.size()] = val;
+                L[y - T.size()] = val;
             } else {
-                insert(T, R, n / k, p % (n / k), q % (n / k), val, y, l + 1);
+                insert(T, L, R, n / k, p % (n / k), q % (n / k), val, y, l + 1);
             }
 
         }
 
     }
 
-    /* helper methods for inplace construction from single list of pairs */
-
-    size_type computeKey(const typename pairs_type::value_type& pair, const Subproblem& sp, size_type width, size_type k) {
-        return ((pair.row - sp.firstRow) / width) * k + (pair.col - sp.firstCol) / width;
-    }
-
-    void countingSort(pairs_type& pairs, std::vector<std::pair<size_type, size_type>>& intervals, const Subproblem& sp, size_type width, size_type sup, size_type k) {
-
-        std::vector<size_type> counts(sup);
+    /* helper method for construction from the radix-sorted keys of a single list of pairs */
 
-        // determine key frequencies
-        for (size_type i = sp.left; i < sp.right; i++) {
-            counts[computeKey(pairs[i], sp, width, k)]++;
-        }
+    void buildFromSortedKeys(pairs_type& pairs, const size_type numThreads) {
 
-        // determine starting index for each key
-        size_type total = 0;
-        size_type tmp;
+        std::vector<size_type> ks(h_, lowerK_);
+        std::fill(ks.begin(), ks.begin() + upperH_, upperK_);
+        std::vector<size_type> ones;
 
-        for (size_type key = 0; key < sup; key++) {
+        std::vector<bool> T;
+        if (!buildLevelsFromSortedKeys(pairs, ks, ks, null_, T, L_, numThreads, &ones)) {
 
-            tmp = counts[key];
-            counts[key] = total;
-            total += tmp;
+            buildFromListsInplace(pairs, numThreads); // the keys do not fit into 64 bits
+            return;
 
-            intervals[key].first = counts[key];
-            intervals[key].second = total;
+        }
 
+        // all ones of the upper levels (except for the last one) belong to the upper part
+        upperOnes_ = 0;
+        for (size_type l = 0; l + 1 < upperH_; l++) {
+            upperOnes_ += ones[l];
         }
+        upperLength_ = (upperH_ > 0) ? (upperOnes_ + 1) * upperK_ * upperK_ : 0;
 
-        // reorder pairs of current subproblem
-        pairs_type tmpPairs(sp.right - sp.left + 1);
-        for (size_type i = sp.left; i < sp.right; i++) {
+        T_ = bit_vector_type(T.size());
+        std::move(T.begin(), T.end(), T_.begin());
 
-            tmpPairs[counts[computeKey(pairs[i], sp, width, k)]] = pairs[i];
-            counts[computeKey(pairs[i], sp, width, k)]++;
+    }
 
-        }
+    /* helper methods for inplace construction from single list of pairs */
 
-        for (size_type i = sp.left; i < sp.right; i++) {
-            pairs[i] = tmpPairs[i - sp.left];
-        }
+    size_type computeKey(const typename pairs_type::value_type& pair, const Subproblem& sp, size_type width, size_type k) {
+        return ((pair.row - sp.firstRow) / width) * k + (pair.col - sp.firstCol) / width;
+    }
 
+    void countingSort(pairs_type& pairs, LevelBuildState<pairs_type, elem_type>& state, const Subproblem& sp, size_type width, size_type sup, size_type k, size_type numThreads) {
+        countingSortByKey(pairs, sp.left, sp.right, sup, [&](const typename pairs_type::value_type& pair) { return computeKey(pair, sp, width, k); }, state.intervals, state.counts, state.tmpPairs, numThreads);
     }
 
-    void buildFromListsInplace(pairs_type& pairs) {// 3.3.5
+    void buildFromListsInplace(pairs_type& pairs, const size_type numThreads) {// 3.3.5 (level by level, the subproblems of each level are distributed among the threads)
 
-        std::queue<std::pair<Subproblem, size_type>> queue;
-        std::pair<Subproblem, size_type> sp;
-        size_type k, S;
-        std::vector<std::pair<size_type, size_type>> intervals(std::max(upperK_, lowerK_) * std::max(upperK_, lowerK_));
+        std::vector<Subproblem> level(1, Subproblem(0, nPrime_ - 1, 0, nPrime_ - 1, 0, pairs.size()));
+        std::vector<LevelBuildState<pairs_type, elem_type>> states(std::max(numThreads, (size_type) 1));
         std::vector<bool> T;
-        std::vector<elem_type> appToL;
+        size_type S = nPrime_;
+        size_type k = 0;
 
         upperOnes_ = 0;
         upperLength_ = 0;
 
-        queue.push(std::make_pair(Subproblem(0, nPrime_ - 1, 0, nPrime_ - 1, 0, pairs.size()), 0));
-
-        while (!queue.empty()) {
-
-            sp = queue.front();
-            queue.pop();
-
-            k = (sp.second < upperH_) ? upperK_ : lowerK_;
-            S = sp.first.lastRow - sp.first.firstRow + 1;
+        auto process = [&](LevelBuildState<pairs_type, elem_type>& state, const Subproblem& sp, size_type sortThreads) {
 
             if (S > k) {
 
-                countingSort(pairs, intervals, sp.first, S / k, k * k, k);
+                countingSort(pairs, state, sp, S / k, k * k, k, sortThreads);
 
                 for (size_type i = 0; i < k * k; i++) {
 
-                    if (intervals[i].first < intervals[i].second) {
-
-                        T.push_back(true);
-                        queue.push(std::make_pair(
-                                Subproblem(
-                                sp.first.firstRow + (i / k) * (S / k),
-                                sp.first.firstRow + (i / k + 1) * (S / k) - 1,
-                                sp.first.firstCol + (i % k) * (S / k),
-                                sp.first.firstCol + (i % k + 1) * (S / k) - 1,
-                                sp.first.left + intervals[i].first,
-                                sp.first.left + intervals[i].second
-                                ),
-                                sp.second + 1
-                        ));
+                    if (state.intervals[i].first < state.intervals[i].second) {
 
-                        upperOnes_+= ((upperH_ > 0) && (sp.second < upperH_ - 1));
+                        state.T.push_back(true);
+                        state.next.push_back(Subproblem(
+                                sp.firstRow + (i / k) * (S / k),
+                                sp.firstRow + (i / k + 1) * (S / k) - 1,
+                                sp.firstCol + (i % k) * (S / k),
+                                sp.firstCol + (i % k + 1) * (S / k) - 1,
+                                sp.left + state.intervals[i].first,
+                                sp.left + state.intervals[i].second
+                        ));
 
                     } else {
-                        T.push_back(false);
+                        state.T.push_back(false);
                     }
 
                 }
 
             } else {
 
-                appToL = std::vector<elem_type>(k * k);
+                size_type offset = state.L.size();
+                state.L.resize(offset + k * k, null_);
 
-                for (size_type i = sp.first.left; i < sp.first.right; i++) {
-                    appToL[(pairs[i].row - sp.first.firstRow) * k + (pairs[i].col - sp.first.firstCol)] = pairs[i].val;
+                for (size_type i = sp.left; i < sp.right; i++) {
+                    state.L[offset + (pairs[i].row - sp.firstRow) * k + (pairs[i].col - sp.firstCol)] = pairs[i].val;
                 }
 
-                L_.insert(L_.end(), appToL.begin(), appToL.end());
+            }
+
+        };
 
+        for (size_type l = 0; !level.empty(); S /= k, l++) {
+
+            k = (l < upperH_) ? upperK_ : lowerK_;
+            processLevel(level, states, numThreads, T, L_, process);
+
+            // all ones of this level (i.e. the subproblems of the next level) belong to the upper part (except for the last upper level)
+            if ((upperH_ > 0) && (l < upperH_ - 1)) {
+                upperOnes_ += level.size();
             }
 
         }
@@ -979,20 +1277,44 @@ private:
     }
 
 
+    /* helper methods for accessing the (optionally compressed) last level */
+
+    // returns the entry of the last level at position x
+    inline elem_type leaf(size_type x) const {
+
+        K2TREES_COUNT(leafProbes);
+        return compressedL_.empty() ? L_[x] : compressedL_[x];
+
+    }
+
+    // returns the length of the last level
+    inline size_type numLeaves() const {
+        return compressedL_.empty() ? L_.size() : compressedL_.size();
+    }
+
     /* isNotNull() */
 
-    bool checkInit(size_type p, size_type q) {
+    bool checkInit(size_type p, size_type q) const {
+
+        size_type x;
+        if (fixedArityLeafPosition(p, q, x)) {
+            return (x < numLeaves()) && (leaf(x) != null_);
+        }
+
+        if (tableH_ != 0) {
+            return (numLeaves() == 0) ? false : check(tableN_, p % tableN_, q % tableN_, topNodes_[(p / tableN_) * (nPrime_ / tableN_) + q / tableN_], tableH_);
+        }
 
         size_type k = (upperH_ > 0) ? upperK_ : lowerK_;
 
-        return (L_.empty()) ? false : check(nPrime_ / k, p % (nPrime_ / k), q % (nPrime_ / k), (p / (nPrime_ / k)) * k + q / (nPrime_ / k), 1);
+        return (numLeaves() == 0) ? false : check(nPrime_ / k, p % (nPrime_ / k), q % (nPrime_ / k), (p / (nPrime_ / k)) * k + q / (nPrime_ / k), 1);
 
     }
 
-    bool check(size_type n, size_type p, size_type q, size_type z, size_type l) {
+    bool check(size_type n, size_type p, size_type q, size_type z, size_type l) const {
 
         if (z >= T_.size()) {
-            return (L_[z - T_.size()] != null_);
+            return (leaf(z - T_.size()) != null_);
         } else {
 
             auto k = (l < upperH_) ? upperK_ : lowerK_;
@@ -1005,18 +1327,27 @@ private:
 
     /* getElement() */
 
-    elem_type getInit(size_type p, size_type q) {
+    elem_type getInit(size_type p, size_type q) const {
+
+        size_type x;
+        if (fixedArityLeafPosition(p, q, x)) {
+            return (x < numLeaves()) ? leaf(x) : null_;
+        }
+
+        if (tableH_ != 0) {
+            return (numLeaves() == 0) ? null_ : get(tableN_, p % tableN_, q % tableN_, topNodes_[(p / tableN_) * (nPrime_ / tableN_) + q / tableN_], tableH_);
+        }
 
         size_type k = (upperH_ > 0) ? upperK_ : lowerK_;
 
-        return (L_.empty()) ? null_ : get(nPrime_ / k, p % (nPrime_ / k), q % (nPrime_ / k), (p / (nPrime_ / k)) * k + q / (nPrime_ / k), 1);
+        return (numLeaves() == 0) ? null_ : get(nPrime_ / k, p % (nPrime_ / k), q % (nPrime_ / k), (p / (nPrime_ / k)) * k + q / (nPrime_ / k), 1);
 
     }
 
-    elem_type get(size_type n, size_type p, size_type q, size_type z, size_type l) {
+    elem_type get(size_type n, size_type p, size_type q, size_type z, size_type l) const {
 
         if (z >= T_.size()) {
-            return L_[z - T_.size()];
+            return leaf(z - T_.size());
         } else {
 
             auto k = (l < upperH_) ? upperK_ : lowerK_;
@@ -1028,11 +1359,171 @@ private:
     }
 
 
+    /* helper methods for point queries with compile-time arities */
+
+    // determines the position x in L of (p, q) (numLeaves() if (p, q) lies in an empty submatrix) via the variant
+    // for the compile-time arities upperK_ and lowerK_ and returns true, returns false if one of them is none of the commonly used arities 2 and 4
+    bool fixedArityLeafPosition(size_type p, size_type q, size_type& x) const {
+
+        switch (upperK_) {
+            case 2:
+                return fixedArityLeafPosition<2>(p, q, x);
+            case 4:
+                return fixedArityLeafPosition<4>(p, q, x);
+            default:
+                return false;
+        }
+
+    }
+
+    template<size_type KU>
+    bool fixedArityLeafPosition(size_type p, size_type q, size_type& x) const {
+
+        switch (lowerK_) {
+            case 2:
+                x = leafPosition<KU, 2>(p, q);
+                return true;
+            case 4:
+                x = leafPosition<KU, 4>(p, q);
+                return true;
+            default:
+                return false;
+        }
+
+    }
+
+    // iterative descent for compile-time arities KU (upper part) and KL (lower part), both powers of two:
+    // as the edge length of every submatrix is a product of powers of KU and KL, all divisions / remainders become shifts / masks
+    template<size_type KU, size_type KL>
+    size_type leafPosition(size_type p, size_type q) const {
+
+        size_type s = logTwo(KU) * upperH_ + logTwo(KL) * (h_ - upperH_);
+        size_type z;
+
+        // start at the node of the lookup table (if any) or at the child of the root
+        if (tableH_ != 0) {
+
+            s -= logTwo(KU) * tableH_;
+            z = topNodes_[(p >> s) * (nPrime_ >> s) + (q >> s)];
+
+        } else if (upperH_ > 0) {
+
+            s -= logTwo(KU);
+            z = (p >> s) * KU + (q >> s);
+
+        } else {
+
+            s -= logTwo(KL);
+            z = (p >> s) * KL + (q >> s);
+
+        }
+
+        for (size_type l = std::max(tableH_, (size_type) 1); z < T_.size(); l++) {
+
+            if (!T_[z]) {
+                return numLeaves();
+            }
+
+            if (l < upperH_) {
+
+                s -= logTwo(KU);
+                z = R_.rank(z + 1) * KU * KU + ((p >> s) & (KU - 1)) * KU + ((q >> s) & (KU - 1));
+
+            } else {
+
+                s -= logTwo(KL);
+                z = upperLength_ + (R_.rank(z + 1) - (upperOnes_ + 1)) * KL * KL + ((p >> s) & (KL - 1)) * KL + ((q >> s) & (KL - 1));
+
+            }
+
+        }
+
+        return z - T_.size();
+
+    }
+
+    /* helper methods for batch queries (isNotNull() / getElement() on several positions) */
+
+    // calls report(x, pos) for every query x whose position is represented in L_ (at pos),
+    // every submatrix shared by several queries is descended into only once
+    template<typename F>
+    void batchInit(const positions_type& queries, F report) const {
+
+        if (numLeaves() == 0 || queries.empty()) return;
+
+        std::vector<size_type> order(queries.size());
+        std::vector<size_type> buffer(queries.size());
+        std::vector<std::vector<size_type>> ends(h_); // ends of the child groups, one array per level
+
+        for (size_type x = 0; x < queries.size(); x++) {
+            order[x] = x;
+        }
+
+        batch(queries, order, buffer, ends, report, 0, queries.size(), nPrime_, 0, 0, 0, 0);
+
+    }
+
+    template<typename F>
+    void batch(const positions_type& queries, std::vector<size_type>& order, std::vector<size_type>& buffer, std::vector<std::vector<size_type>>& ends, F& report, size_type first, size_type last, size_type n, size_type p, size_type q, size_type z, size_type l) const {
+
+        size_type k = (l < upperH_) ? upperK_ : lowerK_;
+        size_type kk = (l + 1 < upperH_) ? upperK_ : lowerK_;
+        size_type m = n / k;
+        size_type numChildren = k * k;
+
+        auto& e = ends[l];
+        e.assign(numChildren, 0);
+
+        // group the queries order[first..last) by the child containing them (stable counting sort)
+        for (size_type x = first; x < last; x++) {
+            e[((queries[order[x]].first - p) / m) * k + (queries[order[x]].second - q) / m]++;
+        }
+
+        size_type sum = first;
+        for (size_type c = 0; c < numChildren; c++) {
+            size_type tmp = e[c];
+            e[c] = sum;
+            sum += tmp;
+        }
+
+        for (size_type x = first; x < last; x++) {
+            buffer[e[((queries[order[x]].first - p) / m) * k + (queries[order[x]].second - q) / m]++] = order[x];
+        }
+
+        std::copy(buffer.begin() + first, buffer.begin() + last, order.begin() + first);
+
+        // afterwards, the queries of child c are order[(c == 0 ? first : e[c - 1])..e[c])
+        size_type start = first;
+        for (size_type c = 0; c < numChildren; c++) {
+
+            size_type end = e[c];
+
+            if (start < end) {
+
+                size_type y = z + c;
+
+                if (y >= T_.size()) {
+                    for (size_type x = start; x < end; x++) {
+                        report(order[x], y - T_.size());
+                    }
+                } else if (T_[y]) {
+                    batch(queries, order, buffer, ends, report, start, end, m, p + (c / k) * m, q + (c % k) * m, (l + 1 >= upperH_) * upperLength_ + (R_.rank(y + 1) - (l + 1 >= upperH_) * (upperOnes_ + 1)) * kk * kk, l + 1);
+                }
+
+            }
+
+            start = end;
+
+        }
+
+    }
+
+
     /* getSuccessorElements() */
 
-    void allSuccessorElementsIterative(std::vector<elem_type>& succs, size_type p) {
+    void allSuccessorElementsIterative(std::vector<elem_type>& succs, size_type p) const {
 
-        if (L_.empty()) return;
+        if (numLeaves() == 0) return;
 
         std::queue<SubrowInfo> queue, nextLevelQueue;
         size_type lenT = T_.size();
@@ -1043,8 +1534,8 @@ private:
 
             size_type offset = p * nPrime_;
             for (size_type i = 0; i < nPrime_; i++) {
-                if (L_[offset + i] != null_) {
-                    succs.push_back(L_[offset + i]);
+                if (leaf(offset + i) != null_) {
+                    succs.push_back(leaf(offset + i));
                 }
             }
 
@@ -1055,6 +1546,7 @@ private:
             size_type l = 1;
             size_type relP = p;
             for (size_type j = 0, dq = 0, z = k * (relP / n); j < k; j++, dq += n, z++) {
+                K2TREES_COUNT(queuePushes);
                 queue.push(SubrowInfo(dq, z));
             }
 
@@ -1071,11 +1563,12 @@ private:
 
                     auto& cur = queue.front();
 
-                    if (T_[cur.z]) {
+                    if (hasChildren(cur.z)) {
 
                         size_type y = a + (R_.rank(cur.z + 1) - b) * k * k + k * (relP / n);
 
                         for (size_type j = 0, newDq = cur.dq; j < k; j++, newDq += n, y++) {
+                            K2TREES_COUNT(queuePushes);
                             nextLevelQueue.push(SubrowInfo(newDq, y));
                         }
 
@@ -1096,13 +1589,13 @@ private:
 
                 auto& cur = queue.front();
 
-                if (T_[cur.z]) {
+                if (hasChildren(cur.z)) {
 
                     size_type y = a + (R_.rank(cur.z + 1) - b) * k * k + k * (relP / n) - lenT;
 
                     for (size_type j = 0, newDq = cur.dq; j < k; j++, newDq += n, y++) {
-                        if (L_[y] != null_) {
-                            succs.push_back(L_[y]);
+                        if (leaf(y) != null_) {
+                            succs.push_back(leaf(y));
                         }
                     }
 
@@ -1116,9 +1609,9 @@ private:
 
     }
 
-    void successorsElemInit(std::vector<elem_type>& succs, size_type p) {
+    void successorsElemInit(std::vector<elem_type>& succs, size_type p) const {
 
-        if (!L_.empty()) {
+        if (numLeaves() != 0) {
 
             size_type k = (upperH_ > 0) ? upperK_ : lowerK_;
             size_type y = k * (p / (nPrime_ / k));
@@ -1131,17 +1624,17 @@ private:
 
     }
 
-    void successorsElem(std::vector<elem_type>& succs, size_type n, size_type p, size_type q, size_type z, size_type l) {
+    void successorsElem(std::vector<elem_type>& succs, size_type n, size_type p, size_type q, size_type z, size_type l) const {
 
         if (z >= T_.size()) {
 
-            if (L_[z - T_.size()] != null_) {
-                succs.push_back(L_[z - T_.size()]);
+            if (leaf(z - T_.size()) != null_) {
+                succs.push_back(leaf(z - T_.size()));
             }
 
         } else {
 
-            if (T_[z]) {
+            if (hasChildren(z)) {
 
                 auto k = (l < upperH_) ? upperK_ : lowerK_;
                 size_type y = (l >= upperH_) * upperLength_ + (R_.rank(z + 1) - (l >= upperH_) * (upperOnes_ + 1)) * k * k + k * (p / (n / k));
@@ -1159,9 +1652,9 @@ private:
 
     /* getSuccessorPositions() */
 
-    void allSuccessorPositionsIterative(std::vector<size_type>& succs, size_type p) {
+    void allSuccessorPositionsIterative(std::vector<size_type>& succs, size_type p) const {
 
-        if (L_.empty()) return;
+        if (numLeaves() == 0) return;
 
         std::queue<SubrowInfo> queue, nextLevelQueue;
         size_type lenT = T_.size();
@@ -1172,7 +1665,7 @@ private:
 
             size_type offset = p * nPrime_;
             for (size_type i = 0; i < nPrime_; i++) {
-                if (L_[offset + i] != null_) {
+                if (leaf(offset + i) != null_) {
                     succs.push_back(i);
                 }
             }
@@ -1184,6 +1677,7 @@ private:
             size_type l = 1;
             size_type relP = p;
             for (size_type j = 0, dq = 0, z = k * (relP / n); j < k; j++, dq += n, z++) {
+                K2TREES_COUNT(queuePushes);
                 queue.push(SubrowInfo(dq, z));
             }
 
@@ -1200,11 +1694,12 @@ private:
 
                     auto& cur = queue.front();
 
-                    if (T_[cur.z]) {
+                    if (hasChildren(cur.z)) {
 
                         size_type y = a + (R_.rank(cur.z + 1) - b) * k * k + k * (relP / n);
 
                         for (size_type j = 0, newDq = cur.dq; j < k; j++, newDq += n, y++) {
+                            K2TREES_COUNT(queuePushes);
                             nextLevelQueue.push(SubrowInfo(newDq, y));
                         }
 
@@ -1225,12 +1720,12 @@ private:
 
                 auto& cur = queue.front();
 
-                if (T_[cur.z]) {
+                if (hasChildren(cur.z)) {
 
                     size_type y = a + (R_.rank(cur.z + 1) - b) * k * k + k * (relP / n) - lenT;
 
                     for (size_type j = 0, newDq = cur.dq; j < k; j++, newDq += n, y++) {
-                        if (L_[y] != null_) {
+                        if (leaf(y) != null_) {
                             succs.push_back(newDq);
                         }
                     }
@@ -1245,9 +1740,9 @@ private:
 
     }
 
-    void successorsPosInit(std::vector<size_type>& succs, size_type p) {
+    void successorsPosInit(std::vector<size_type>& succs, size_type p) const {
 
-        if (!L_.empty()) {
+        if (numLeaves() != 0) {
 
             size_type k = (upperH_ > 0) ? upperK_ : lowerK_;
             size_type y = k * (p / (nPrime_ / k));
@@ -1260,17 +1755,17 @@ private:
 
     }
 
-    void successorsPos(std::vector<size_type>& succs, size_type n, size_type p, size_type q, size_type z, size_type l) {
+    void successorsPos(std::vector<size_type>& succs, size_type n, size_type p, size_type q, size_type z, size_type l) const {
 
         if (z >= T_.size()) {
 
-            if (L_[z - T_.size()] != null_) {
+            if (leaf(z - T_.size()) != null_) {
                 succs.push_back(q);
             }
 
         } else {
 
-            if (T_[z]) {
+            if (hasChildren(z)) {
 
                 auto k = (l < upperH_) ? upperK_ : lowerK_;
                 size_type y = (l >= upperH_) * upperLength_ + (R_.rank(z + 1) - (l >= upperH_) * (upperOnes_ + 1)) * k * k + k * (p / (n / k));
@@ -1288,9 +1783,9 @@ private:
 
     /* getSuccessorValuedPositions() */
 
-    void allSuccessorValuedPositionsIterative(pairs_type& succs, size_type p) {
+    void allSuccessorValuedPositionsIterative(pairs_type& succs, size_type p) const {
 
-        if (L_.empty()) return;
+        if (numLeaves() == 0) return;
 
         std::queue<SubrowInfo> queue, nextLevelQueue;
         size_type lenT = T_.size();
@@ -1301,8 +1796,8 @@ private:
 
             size_type offset = p * nPrime_;
             for (size_type i = 0; i < nPrime_; i++) {
-                if (L_[offset + i] != null_) {
-                    succs.push_back(ValuedPosition<elem_type>(p, i, L_[offset + i]));
+                if (leaf(offset + i) != null_) {
+                    succs.push_back(ValuedPosition<elem_type>(p, i, leaf(offset + i)));
                 }
             }
 
@@ -1313,6 +1808,7 @@ private:
             size_type l = 1;
             size_type relP = p;
             for (size_type j = 0, dq = 0, z = k * (relP / n); j < k; j++, dq += n, z++) {
+                K2TREES_COUNT(queuePushes);
                 queue.push(SubrowInfo(dq, z));
             }
 
@@ -1329,11 +1825,12 @@ private:
 
                     auto& cur = queue.front();
 
-                    if (T_[cur.z]) {
+                    if (hasChildren(cur.z)) {
 
                         size_type y = a + (R_.rank(cur.z + 1) - b) * k * k + k * (relP / n);
 
                         for (size_type j = 0, newDq = cur.dq; j < k; j++, newDq += n, y++) {
+                            K2TREES_COUNT(queuePushes);
                             nextLevelQueue.push(SubrowInfo(newDq, y));
                         }
 
@@ -1354,13 +1851,13 @@ private:
 
                 auto& cur = queue.front();
 
-                if (T_[cur.z]) {
+                if (hasChildren(cur.z)) {
 
                     size_type y = a + (R_.rank(cur.z + 1) - b) * k * k + k * (relP / n) - lenT;
 
                     for (size_type j = 0, newDq = cur.dq; j < k; j++, newDq += n, y++) {
-                        if (L_[y] != null_) {
-                            succs.push_back(ValuedPosition<elem_type>(p, newDq, L_[y]));
+                        if (leaf(y) != null_) {
+                            succs.push_back(ValuedPosition<elem_type>(p, newDq, leaf(y)));
                         }
                     }
 
@@ -1374,9 +1871,9 @@ private:
 
     }
 
-    void successorsValPosInit(pairs_type& succs, size_type p) {
+    void successorsValPosInit(pairs_type& succs, size_type p) const {
 
-        if (!L_.empty()) {
+        if (numLeaves() != 0) {
 
             size_type k = (upperH_ > 0) ? upperK_ : lowerK_;
             size_type y = k * (p / (nPrime_ / k));
@@ -1393,17 +1890,17 @@ private:
 
     }
 
-    void successorsValPos(pairs_type& succs, size_type n, size_type p, size_type q, size_type z, size_type l) {
+    void successorsValPos(pairs_type& succs, size_type n, size_type p, size_type q, size_type z, size_type l) const {
 
         if (z >= T_.size()) {
 
-            if (L_[z - T_.size()] != null_) {
-                succs.push_back(ValuedPosition<elem_type>(0, q, L_[z - T_.size()]));
+            if (leaf(z - T_.size()) != null_) {
+                succs.push_back(ValuedPosition<elem_type>(0, q, leaf(z - T_.size())));
             }
 
         } else {
 
-            if (T_[z]) {
+            if (hasChildren(z)) {
 
                 auto k = (l < upperH_) ? upperK_ : lowerK_;
                 size_type y = (l >= upperH_) * upperLength_ + (R_.rank(z + 1) - (l >= upperH_) * (upperOnes_ + 1)) * k * k + k * (p / (n / k));
@@ -1419,27 +1916,77 @@ private:
 
     }
 
-    /* getFirstSuccessor() */
+    /* expandFrontier() */
 
-    size_type firstSuccessorPositionIterative(size_type p) {
+    // expands the rows [first, last) of the frontier within the submatrix of size n x n whose upper left corner is (p,q)
+    // and whose children start at position y, the subtrees shared by several rows are only traversed once
+    void frontierPos(std::vector<size_type>& cols, std::vector<bool>& visited, size_type n, size_type p, size_type q,
+                     std::vector<size_type>::const_iterator first, std::vector<size_type>::const_iterator last, size_type y, size_type l) const {
 
-        if (L_.empty()) return nPrime_;
+        auto k = (l < upperH_) ? upperK_ : lowerK_;
 
-        if (T_.size() == 0) {
+        for (size_type i = 0; (i < k) && (first != last); i++) {
 
-            size_type offset = p * nPrime_;
-            for (size_type i = 0; i < nPrime_; i++) {
-                if (L_[offset + i] != null_) {
-                    return i;
-                }
+            // rows of the frontier that lie in the i-th row of children
+            auto next = first;
+            while ((next != last) && (*next < p + (i + 1) * (n / k))) {
+                next++;
             }
 
-        } else {
+            if (first != next) {
 
-            size_type k = (upperH_ > 0) ? upperK_ : lowerK_;
-            size_type l = 1;
+                for (size_type j = 0; j < k; j++) {
+
+                    size_type z = y + i * k + j;
+
+                    if (z >= T_.size()) {
+
+                        if (leaf(z - T_.size()) != null_) {
+                            this->addToFrontier(q + j, cols, visited);
+                        }
+
+                    } else if (hasChildren(z)) {
+
+                        // the children of z lie on level l + 1
+                        auto kz = (l + 1 < upperH_) ? upperK_ : lowerK_;
+                        size_type yz = (l + 1 >= upperH_) * upperLength_ + (R_.rank(z + 1) - (l + 1 >= upperH_) * (upperOnes_ + 1)) * kz * kz;
+
+                        frontierPos(cols, visited, n / k, p + i * (n / k), q + j * (n / k), first, next, yz, l + 1);
+
+                    }
+
+                }
+
+            }
+
+            first = next;
+
+        }
+
+    }
+
+    /* getFirstSuccessor() */
+
+    size_type firstSuccessorPositionIterative(size_type p) const {
+
+        if (numLeaves() == 0) return nPrime_;
+
+        if (T_.size() == 0) {
+
+            size_type offset = p * nPrime_;
+            for (size_type i = 0; i < nPrime_; i++) {
+                if (leaf(offset + i) != null_) {
+                    return i;
+                }
+            }
+
+        } else {
+
+            size_type k = (upperH_ > 0) ? upperK_ : lowerK_;
+            size_type l = 1;
 
             std::stack<ExtendedSubrowInfo> stack;
+            K2TREES_COUNT(queuePushes);
             stack.emplace(nPrime_ / k, nPrime_ / k, p % (nPrime_ / k), 0, k * (p / (nPrime_ / k)), 0);
 
             while (!stack.empty()) {
@@ -1455,15 +2002,16 @@ private:
 
                     if (cur.z >= T_.size()) {
 
-                        if (L_[cur.z - T_.size()] != null_) {
+                        if (leaf(cur.z - T_.size()) != null_) {
                             return cur.dq;
                         }
 
                     } else {
 
-                        if (T_[cur.z]) {
+                        if (hasChildren(cur.z)) {
 
                             k = (l < upperH_) ? upperK_ : lowerK_;
+                            K2TREES_COUNT(queuePushes);
                             stack.emplace(cur.nr / k, cur.nc / k, cur.p % (cur.nr / k), cur.dq, (l >= upperH_) * upperLength_ + (R_.rank(cur.z + 1) - (l >= upperH_) * (upperOnes_ + 1)) * k * k + k * (cur.p / (cur.nr / k)), 0);
                             l++;
 
@@ -1484,11 +2032,11 @@ private:
 
     }
 
-    size_type firstSuccessorInit(size_type p) {
+    size_type firstSuccessorInit(size_type p) const {
 
         size_type pos = nPrime_;
 
-        if (!L_.empty()) {
+        if (numLeaves() != 0) {
 
             size_type k = (upperH_ > 0) ? upperK_ : lowerK_;
             size_type y = k * (p / (nPrime_ / k));
@@ -1503,19 +2051,19 @@ private:
 
     }
 
-    size_type firstSuccessor(size_type n, size_type p, size_type q, size_type z, size_type l) {
+    size_type firstSuccessor(size_type n, size_type p, size_type q, size_type z, size_type l) const {
 
         size_type pos = nPrime_;
 
         if (z >= T_.size()) {
 
-            if (L_[z - T_.size()] != null_) {
+            if (leaf(z - T_.size()) != null_) {
                 pos = q;
             }
 
         } else {
 
-            if (T_[z]) {
+            if (hasChildren(z)) {
 
                 auto k = (l < upperH_) ? upperK_ : lowerK_;
                 size_type y = (l >= upperH_) * upperLength_ + (R_.rank(z + 1) - (l >= upperH_) * (upperOnes_ + 1)) * k * k + k * (p / (n / k));
@@ -1535,9 +2083,9 @@ private:
 
     /* getPredecessorElements() */
 
-    void predecessorsElemInit(std::vector<elem_type>& preds, size_type q) {
+    void predecessorsElemInit(std::vector<elem_type>& preds, size_type q) const {
 
-        if (!L_.empty()) {
+        if (numLeaves() != 0) {
 
             size_type k = (upperH_ > 0) ? upperK_ : lowerK_;
             size_type y = q / (nPrime_ / k);
@@ -1550,17 +2098,17 @@ private:
 
     }
 
-    void predecessorsElem(std::vector<elem_type>& preds, size_type n, size_type q, size_type p, size_type z, size_type l) {
+    void predecessorsElem(std::vector<elem_type>& preds, size_type n, size_type q, size_type p, size_type z, size_type l) const {
 
         if (z >= T_.size()) {
 
-            if (L_[z - T_.size()] != null_) {
-                preds.push_back(L_[z - T_.size()]);
+            if (leaf(z - T_.size()) != null_) {
+                preds.push_back(leaf(z - T_.size()));
             }
 
         } else {
 
-            if (T_[z]) {
+            if (hasChildren(z)) {
 
                 auto k = (l < upperH_) ? upperK_ : lowerK_;
                 size_type y = (l >= upperH_) * upperLength_ + (R_.rank(z + 1) - (l >= upperH_) * (upperOnes_ + 1)) * k * k + q / (n / k);
@@ -1577,9 +2125,9 @@ private:
 
     /* getPredecessorPositions() */
 
-    void predecessorsPosInit(std::vector<size_type>& preds, size_type q) {
+    void predecessorsPosInit(std::vector<size_type>& preds, size_type q) const {
 
-        if (!L_.empty()) {
+        if (numLeaves() != 0) {
 
             size_type k = (upperH_ > 0) ? upperK_ : lowerK_;
             size_type y = q / (nPrime_ / k);
@@ -1592,17 +2140,17 @@ private:
 
     }
 
-    void predecessorsPos(std::vector<size_type>& preds, size_type n, size_type q, size_type p, size_type z, size_type l) {
+    void predecessorsPos(std::vector<size_type>& preds, size_type n, size_type q, size_type p, size_type z, size_type l) const {
 
         if (z >= T_.size()) {
 
-            if (L_[z - T_.size()] != null_) {
+            if (leaf(z - T_.size()) != null_) {
                 preds.push_back(p);
             }
 
         } else {
 
-            if (T_[z]) {
+            if (hasChildren(z)) {
 
                 auto k = (l < upperH_) ? upperK_ : lowerK_;
                 size_type y = (l >= upperH_) * upperLength_ + (R_.rank(z + 1) - (l >= upperH_) * (upperOnes_ + 1)) * k * k + q / (n / k);
@@ -1619,9 +2167,9 @@ private:
 
     /* getPredecessorValuedPositions() */
 
-    void predecessorsValPosInit(pairs_type& preds, size_type q) {
+    void predecessorsValPosInit(pairs_type& preds, size_type q) const {
 
-        if (!L_.empty()) {
+        if (numLeaves() != 0) {
 
             size_type k = (upperH_ > 0) ? upperK_ : lowerK_;
             size_type y = q / (nPrime_ / k);
@@ -1638,17 +2186,17 @@ private:
 
     }
 
-    void predecessorsValPos(pairs_type& preds, size_type n, size_type q, size_type p, size_type z, size_type l) {
+    void predecessorsValPos(pairs_type& preds, size_type n, size_type q, size_type p, size_type z, size_type l) const {
 
         if (z >= T_.size()) {
 
-            if (L_[z - T_.size()] != null_) {
-                preds.push_back(ValuedPosition<elem_type>(p, 0, L_[z - T_.size()]));
+            if (leaf(z - T_.size()) != null_) {
+                preds.push_back(ValuedPosition<elem_type>(p, 0, leaf(z - T_.size())));
             }
 
         } else {
 
-            if (T_[z]) {
+            if (hasChildren(z)) {
 
                 auto k = (l < upperH_) ? upperK_ : lowerK_;
                 size_type y = (l >= upperH_) * upperLength_ + (R_.rank(z + 1) - (l >= upperH_) * (upperOnes_ + 1)) * k * k + q / (n / k);
@@ -1666,9 +2214,9 @@ private:
 
     /* getElementsInRange() */
 
-    void rangeElemInit(std::vector<elem_type>& elements, size_type p1, size_type p2, size_type q1, size_type q2) {
+    void rangeElemInit(std::vector<elem_type>& elements, size_type p1, size_type p2, size_type q1, size_type q2) const {
 
-        if (!L_.empty()) {
+        if (numLeaves() != 0) {
 
             size_type p1Prime, p2Prime;
 
@@ -1700,17 +2248,17 @@ private:
 
     }
 
-    void rangeElem(std::vector<elem_type>& elements, size_type n, size_type p1, size_type p2, size_type q1, size_type q2, size_type dp, size_type dq, size_type z, size_type l) {
+    void rangeElem(std::vector<elem_type>& elements, size_type n, size_type p1, size_type p2, size_type q1, size_type q2, size_type dp, size_type dq, size_type z, size_type l) const {
 
         if (z >= T_.size()) {
 
-            if (L_[z - T_.size()] != null_) {
-                elements.push_back(L_[z - T_.size()]);
+            if (leaf(z - T_.size()) != null_) {
+                elements.push_back(leaf(z - T_.size()));
             }
 
         } else {
 
-            if (T_[z]) {
+            if (hasChildren(z)) {
 
                 auto k = (l < upperH_) ? upperK_ : lowerK_;
                 size_type y = (l >= upperH_) * upperLength_ + (R_.rank(z + 1) - (l >= upperH_) * (upperOnes_ + 1)) * k * k;
@@ -1746,9 +2294,9 @@ private:
 
     /* getPositionsInRange() */
 
-    void rangePosInit(positions_type& pairs, size_type p1, size_type p2, size_type q1, size_type q2) {
+    void rangePosInit(positions_type& pairs, size_type p1, size_type p2, size_type q1, size_type q2) const {
 
-        if (!L_.empty()) {
+        if (numLeaves() != 0) {
 
             size_type p1Prime, p2Prime;
 
@@ -1780,17 +2328,17 @@ private:
 
     }
 
-    void rangePos(positions_type& pairs, size_type n, size_type p1, size_type p2, size_type q1, size_type q2, size_type dp, size_type dq, size_type z, size_type l) {
+    void rangePos(positions_type& pairs, size_type n, size_type p1, size_type p2, size_type q1, size_type q2, size_type dp, size_type dq, size_type z, size_type l) const {
 
         if (z >= T_.size()) {
 
-            if (L_[z - T_.size()] != null_) {
+            if (leaf(z - T_.size()) != null_) {
                 pairs.push_back(std::make_pair(dp, dq));
             }
 
         } else {
 
-            if (T_[z]) {
+            if (hasChildren(z)) {
 
                 auto k = (l < upperH_) ? upperK_ : lowerK_;
                 size_type y = (l >= upperH_) * upperLength_ + (R_.rank(z + 1) - (l >= upperH_) * (upperOnes_ + 1)) * k * k;
@@ -1826,9 +2374,9 @@ private:
 
     /* getValuedPositionsRange() */
 
-    void rangeValPosInit(pairs_type& pairs, size_type p1, size_type p2, size_type q1, size_type q2) {
+    void rangeValPosInit(pairs_type& pairs, size_type p1, size_type p2, size_type q1, size_type q2) const {
 
-        if (!L_.empty()) {
+        if (numLeaves() != 0) {
 
             size_type p1Prime, p2Prime;
 
@@ -1860,17 +2408,17 @@ private:
 
     }
 
-    void rangeValPos(pairs_type& pairs, size_type n, size_type p1, size_type p2, size_type q1, size_type q2, size_type dp, size_type dq, size_type z, size_type l) {
+    void rangeValPos(pairs_type& pairs, size_type n, size_type p1, size_type p2, size_type q1, size_type q2, size_type dp, size_type dq, size_type z, size_type l) const {
 
         if (z >= T_.size()) {
 
-            if (L_[z - T_.size()] != null_) {
-                pairs.push_back(ValuedPosition<elem_type>(dp, dq, L_[z - T_.size()]));
+            if (leaf(z - T_.size()) != null_) {
+                pairs.push_back(ValuedPosition<elem_type>(dp, dq, leaf(z - T_.size())));
             }
 
         } else {
 
-            if (T_[z]) {
+            if (hasChildren(z)) {
 
                 auto k = (l < upperH_) ? upperK_ : lowerK_;
                 size_type y = (l >= upperH_) * upperLength_ + (R_.rank(z + 1) - (l >= upperH_) * (upperOnes_ + 1)) * k * k;
@@ -1905,18 +2453,189 @@ private:
     }
 
 
-    /* containsElement() */
+    /* forEachSuccessorPosition() */
+
+    bool successorsVisitInit(const std::function<bool(size_type)>& visitor, size_type p) const {
+
+        if (numLeaves() != 0) {
+
+            size_type k = (upperH_ > 0) ? upperK_ : lowerK_;
+            size_type y = k * (p / (nPrime_ / k));
+
+            for (size_type j = 0; j < k; j++) {
+                if (!successorsVisit(visitor, nPrime_ / k, p % (nPrime_ / k), (nPrime_ / k) * j, y + j, 1)) return false;
+            }
+
+        }
+
+        return true;
+
+    }
+
+    bool successorsVisit(const std::function<bool(size_type)>& visitor, size_type n, size_type p, size_type q, size_type z, size_type l) const {
+
+        if (z >= T_.size()) {
+
+            if (leaf(z - T_.size()) != null_) {
+                if (!visitor(q)) return false;
+            }
+
+        } else {
+
+            if (hasChildren(z)) {
+
+                auto k = (l < upperH_) ? upperK_ : lowerK_;
+                size_type y = (l >= upperH_) * upperLength_ + (R_.rank(z + 1) - (l >= upperH_) * (upperOnes_ + 1)) * k * k + k * (p / (n / k));
+
+                for (size_type j = 0; j < k; j++) {
+                    if (!successorsVisit(visitor, n / k, p % (n / k), q + (n / k) * j, y + j, l + 1)) return false;
+                }
+
+            }
+
+        }
+
+        return true;
+
+    }
+
+    /* forEachPredecessorPosition() */
+
+    bool predecessorsVisitInit(const std::function<bool(size_type)>& visitor, size_type q) const {
+
+        if (numLeaves() != 0) {
+
+            size_type k = (upperH_ > 0) ? upperK_ : lowerK_;
+            size_type y = q / (nPrime_ / k);
+
+            for (size_type i = 0; i < k; i++) {
+                if (!predecessorsVisit(visitor, nPrime_ / k, q % (nPrime_ / k), (nPrime_ / k) * i, y + i * k, 1)) return false;
+            }
+
+        }
+
+        return true;
+
+    }
+
+    bool predecessorsVisit(const std::function<bool(size_type)>& visitor, size_type n, size_type q, size_type p, size_type z, size_type l) const {
+
+        if (z >= T_.size()) {
+
+            if (leaf(z - T_.size()) != null_) {
+                if (!visitor(p)) return false;
+            }
+
+        } else {
+
+            if (hasChildren(z)) {
+
+                auto k = (l < upperH_) ? upperK_ : lowerK_;
+                size_type y = (l >= upperH_) * upperLength_ + (R_.rank(z + 1) - (l >= upperH_) * (upperOnes_ + 1)) * k * k + q / (n / k);
+
+                for (size_type i = 0; i < k; i++) {
+                    if (!predecessorsVisit(visitor, n / k, q % (n / k), p + (n / k) * i, y + i * k, l + 1)) return false;
+                }
+
+            }
+
+        }
+
+        return true;
+
+    }
+
+    /* forEachValuedPositionInRange() */
+
+    bool rangeValVisitInit(const std::function<bool(size_type, size_type, elem_type)>& visitor, size_type p1, size_type p2, size_type q1, size_type q2) const {
+
+        if (numLeaves() != 0) {
+
+            size_type p1Prime, p2Prime;
+
+            size_type k = (upperH_ > 0) ? upperK_ : lowerK_;
+
+            for (size_type i = p1 / (nPrime_ / k); i <= p2 / (nPrime_ / k); i++) {
+
+                p1Prime = (i == p1 / (nPrime_ / k)) * (p1 % (nPrime_ / k));
+                p2Prime = (i == p2 / (nPrime_ / k)) ? p2 % (nPrime_ / k) : (nPrime_ / k) - 1;
+
+                for (size_type j = q1 / (nPrime_ / k); j <= q2 / (nPrime_ / k); j++) {
+                    if (!rangeValVisit(
+                            visitor,
+                            nPrime_ / k,
+                            p1Prime,
+                            p2Prime,
+                            (j == q1 / (nPrime_ / k)) * (q1 % (nPrime_ / k)),
+                            (j == q2 / (nPrime_ / k)) ? q2 % (nPrime_ / k) : (nPrime_ / k) - 1,
+                            (nPrime_ / k) * i,
+                            (nPrime_ / k) * j,
+                            k * i + j,
+                            1
+                    )) return false;
+                }
+
+            }
+
+        }
+
+        return true;
+
+    }
+
+    bool rangeValVisit(const std::function<bool(size_type, size_type, elem_type)>& visitor, size_type n, size_type p1, size_type p2, size_type q1, size_type q2, size_type dp, size_type dq, size_type z, size_type l) const {
+
+        if (z >= T_.size()) {
+
+            if (leaf(z - T_.size()) != null_) {
+                if (!visitor(dp, dq, leaf(z - T_.size()))) return false;
+            }
+
+        } else {
 
-    bool elemInRangeInit(size_type p1, size_type p2, size_type q1, size_type q2) {
+            if (hasChildren(z)) {
+
+                auto k = (l < upperH_) ? upperK_ : lowerK_;
+                size_type y = (l >= upperH_) * upperLength_ + (R_.rank(z + 1) - (l >= upperH_) * (upperOnes_ + 1)) * k * k;
+                size_type p1Prime, p2Prime;
+
+                for (size_type i = p1 / (n / k); i <= p2 / (n / k); i++) {
+
+                    p1Prime = (i == p1 / (n / k)) * (p1 % (n / k));
+                    p2Prime = (i == p2 / (n / k)) ? p2 % (n / k) : n / k - 1;
+
+                    for (size_type j = q1 / (n / k); j <= q2 / (n / k); j++) {
+                        if (!rangeValVisit(
+                                visitor,
+                                n / k,
+                                p1Prime,
+                                p2Prime,
+                                (j == q1 / (n / k)) * (q1 % (n / k)),
+                                (j == q2 / (n / k)) ? q2 % (n / k) : n / k - 1,
+                                dp + (n / k) * i,
+                                dq + (n / k) * j,
+                                y + k * i + j,
+                                l + 1
+                        )) return false;
+                    }
 
-        if (!L_.empty()) {
+                }
 
-            // dividing by k_ (as stated in the paper) in not correct,
-            // because it does not use the size of the currently considered submatrix but of its submatrices
-            if ((p1 == 0) && (q1 == 0) && (p2 == (nPrime_ /*/ k_*/ - 1)) && (q2 == (nPrime_ /*/ k_*/ - 1))) {
-                return 1;
             }
 
+        }
+
+        return true;
+
+    }
+
+
+    /* containsElement() */
+
+    bool elemInRangeInit(size_type p1, size_type p2, size_type q1, size_type q2) const {
+
+        if (numLeaves() != 0) {
+
             size_type p1Prime, p2Prime;
 
             size_type k = (upperH_ > 0) ? upperK_ : lowerK_;
@@ -1942,15 +2661,15 @@ private:
 
     }
 
-    bool elemInRange(size_type n, size_type p1, size_type p2, size_type q1, size_type q2, size_type z, size_type l) {
+    bool elemInRange(size_type n, size_type p1, size_type p2, size_type q1, size_type q2, size_type z, size_type l) const {
 
         if (z >= T_.size()) {
 
-            return L_[z - T_.size()];
+            return (leaf(z - T_.size()) != null_);
 
         } else {
 
-            if (T_[z]) {
+            if (hasChildren(z)) {
 
                 // dividing by k_ (as stated in the paper) in not correct,
                 // because it does not use the size of the currently considered submatrix but of its submatrices
@@ -1986,79 +2705,287 @@ private:
     }
 
 
-    /* setNull() */
+    /* countElementsInRange() */
 
-    void setInit(size_type p, size_type q) {
+    size_type countRangeInit(size_type p1, size_type p2, size_type q1, size_type q2) const {
 
-        size_type k = (upperH_ > 0) ? upperK_ : lowerK_;
+        size_type cnt = 0;
+
+        if (numLeaves() != 0) {
+
+            size_type k = (upperH_ > 0) ? upperK_ : lowerK_;
+
+            size_type p1Prime, p2Prime;
+
+            for (size_type i = p1 / (nPrime_ / k); i <= p2 / (nPrime_ / k); i++) {
+
+                p1Prime = (i == p1 / (nPrime_ / k)) * (p1 % (nPrime_ / k));
+                p2Prime = (i == p2 / (nPrime_ / k)) ? p2 % (nPrime_ / k) : (nPrime_ / k) - 1;
+
+                for (size_type j = q1 / (nPrime_ / k); j <= q2 / (nPrime_ / k); j++) {
+                    cnt += countRange(
+                            nPrime_ / k,
+                            p1Prime,
+                            p2Prime,
+                            (j == q1 / (nPrime_ / k)) * (q1 % (nPrime_ / k)),
+                            (j == q2 / (nPrime_ / k)) ? q2 % (nPrime_ / k) : (nPrime_ / k) - 1,
+                            k * i + j,
+                            1
+                    );
+                }
+
+            }
 
-        if (!L_.empty()) {
-            set(nPrime_ / k, p % (nPrime_ / k), q % (nPrime_ / k), (p / (nPrime_ / k)) * k + q / (nPrime_ / k), 1);
         }
 
+        return cnt;
+
     }
 
-    void set(size_type n, size_type p, size_type q, size_type z, size_type l) {
+    size_type countRange(size_type n, size_type p1, size_type p2, size_type q1, size_type q2, size_type z, size_type l) const {
 
         if (z >= T_.size()) {
-            L_[z - T_.size()] = null_;
-        } else {
+            return (leaf(z - T_.size()) != null_);
+        }
 
-            auto k = (l < upperH_) ? upperK_ : lowerK_;
+        if (!hasChildren(z)) {
+            return 0;
+        }
+
+        // submatrix completely covered by the range: count all its entries at once
+        if (p1 == 0 && q1 == 0 && p2 == n - 1 && q2 == n - 1) {
+            return countSubtree(z, l);
+        }
+
+        auto k = (l < upperH_) ? upperK_ : lowerK_;
+        size_type y = (l >= upperH_) * upperLength_ + (R_.rank(z + 1) - (l >= upperH_) * (upperOnes_ + 1)) * k * k;
+        size_type p1Prime, p2Prime;
+        size_type cnt = 0;
 
-            if (T_[z]) {
-                set(n / k, p % (n / k), q % (n / k), (l >= upperH_) * upperLength_ + (R_.rank(z + 1) - (l >= upperH_) * (upperOnes_ + 1)) * k * k + (p / (n / k)) * k + q / (n / k), l + 1);
+        for (size_type i = p1 / (n / k); i <= p2 / (n / k); i++) {
+
+            p1Prime = (i == p1 / (n / k)) * (p1 % (n / k));
+            p2Prime = (i == p2 / (n / k)) ? p2 % (n / k) : n / k - 1;
+
+            for (size_type j = q1 / (n / k); j <= q2 / (n / k); j++) {
+                cnt += countRange(
+                        n / k,
+                        p1Prime,
+                        p2Prime,
+                        (j == q1 / (n / k)) * (q1 % (n / k)),
+                        (j == q2 / (n / k)) ? q2 % (n / k) : n / k - 1,
+                        y + k * i + j,
+                        l + 1
+                );
             }
 
         }
 
+        return cnt;
+
     }
 
-};
+    /* helper methods for counting (countElements() / countElementsInRange()) */
 
+    // returns the number of non-null entries in the leaves below node z (z < T_.size() and T_[z] = 1),
+    // the nodes of a subtree on each level form a contiguous interval, which is mapped to the next level via rank
+    size_type countSubtree(size_type z, size_type l) const {
 
-/**
- * Bool specialisation of HybridK2Tree.
- *
- * Has the same characteristics as the general implementation above,
- * but makes use of some simplifications since the only non-null value is 1 / true.
- */
-template<>
-class HybridK2Tree<bool> : public virtual K2Tree<bool> {
+        size_type lo = z;
+        size_type hi = z + 1;
 
-public:
-    typedef bool elem_type;
+        while (lo < hi && lo < T_.size()) {
 
-    typedef K2Tree<elem_type>::matrix_type matrix_type;
-    typedef K2Tree<elem_type>::list_type list_type;
-    typedef K2Tree<elem_type>::positions_type positions_type;
-    typedef K2Tree<elem_type>::pairs_type pairs_type;
+            auto k = (l < upperH_) ? upperK_ : lowerK_;
 
+            lo = (l >= upperH_) * upperLength_ + (R_.rank(lo) + 1 - (l >= upperH_) * (upperOnes_ + 1)) * k * k;
+            hi = (l >= upperH_) * upperLength_ + (R_.rank(hi) + 1 - (l >= upperH_) * (upperOnes_ + 1)) * k * k;
+            l++;
+
+        }
+
+        return (lo < hi) ? countLeaves(lo - T_.size(), hi - T_.size()) : 0;
 
-    HybridK2Tree() {
-        // nothing to do
     }
 
-    HybridK2Tree(const HybridK2Tree& other) {
+    // returns the number of non-null entries in L_[from..to)
+    size_type countLeaves(size_type from, size_type to) const {
 
-        h_ = other.h_;
-        upperH_ = other.upperH_;
-        upperOnes_ = other.upperOnes_;
-        upperLength_ = other.upperLength_;
-        upperK_ = other.upperK_;
-        lowerK_ = other.lowerK_;
-        nPrime_ = other.nPrime_;
-        null_ = other.null_;
+        if (countSamples_.empty()) {
 
-        T_ = other.T_;
-        L_ = other.L_;
-        R_ = rank_type(&T_);
+            size_type cnt = 0;
+            for (size_type x = from; x < to; x++) {
+                cnt += (leaf(x) != null_);
+            }
 
-    }
+            return cnt;
 
-    HybridK2Tree& operator=(const HybridK2Tree& other) {
+        }
 
-        // check for self-assignment
+        return countPrefix(to) - countPrefix(from);
+
+    }
+
+    // returns the number of non-null entries in L_[0..x) using the counting index
+    size_type countPrefix(size_type x) const {
+
+        size_type cnt = countSamples_[x / K2TREES_COUNT_SAMPLE_RATE];
+        for (size_type y = (x / K2TREES_COUNT_SAMPLE_RATE) * K2TREES_COUNT_SAMPLE_RATE; y < x; y++) {
+            cnt += (leaf(y) != null_);
+        }
+
+        return cnt;
+
+    }
+
+    /* helper methods for handling subtrees emptied by setNull() */
+
+    // checks whether node z has children, i.e. whether its bit in T is set and its subtree has not been emptied by setNull()
+    inline bool hasChildren(size_type z) const {
+
+        K2TREES_COUNT(nodesVisited);
+        return T_[z] && (emptyNodes_.empty() || !emptyNodes_[z]);
+
+    }
+
+    // checks whether all len nodes of the block starting at position y are empty
+    bool isEmptyBlock(size_type y, size_type len) const {
+
+        for (size_type c = y; c < y + len; c++) {
+            if ((c >= T_.size()) ? (leaf(c - T_.size()) != null_) : hasChildren(c)) {
+                return false;
+            }
+        }
+
+        return true;
+
+    }
+
+    // marks the subtree of node z as empty
+    void markEmpty(size_type z) {
+
+        if (emptyNodes_.empty()) {
+            emptyNodes_ = bit_vector_type(T_.size(), 0);
+        }
+
+        emptyNodes_[z] = 1;
+
+    }
+
+    /* setNull() */
+
+    void setInit(size_type p, size_type q) {
+
+        size_type k = (upperH_ > 0) ? upperK_ : lowerK_;
+
+        if (numLeaves() != 0) {
+            set(nPrime_ / k, p % (nPrime_ / k), q % (nPrime_ / k), (p / (nPrime_ / k)) * k + q / (nPrime_ / k), 1);
+        }
+
+    }
+
+    // clears the entry in the subtree of z, returns true iff the subtree is empty afterwards
+    bool set(size_type n, size_type p, size_type q, size_type z, size_type l) {
+
+        if (z >= T_.size()) {
+
+            // keep the counting index up to date
+            if (!countSamples_.empty() && (leaf(z - T_.size()) != null_)) {
+                for (size_type s = (z - T_.size()) / K2TREES_COUNT_SAMPLE_RATE + 1; s < countSamples_.size(); s++) {
+                    countSamples_[s]--;
+                }
+            }
+
+            L_[z - T_.size()] = null_;
+
+            return true;
+
+        } else {
+
+            auto k = (l < upperH_) ? upperK_ : lowerK_;
+
+            if (hasChildren(z)) {
+
+                size_type y = (l >= upperH_) * upperLength_ + (R_.rank(z + 1) - (l >= upperH_) * (upperOnes_ + 1)) * k * k;
+
+                // mark z if its whole subtree has become empty
+                if (set(n / k, p % (n / k), q % (n / k), y + (p / (n / k)) * k + q / (n / k), l + 1) && isEmptyBlock(y, k * k)) {
+
+                    markEmpty(z);
+                    return true;
+
+                }
+
+                return false;
+
+            }
+
+            return true;
+
+        }
+
+    }
+
+};
+
+
+/**
+ * Bool specialisation of HybridK2Tree.
+ *
+ * Has the same characteristics as the general implementation above,
+ * but makes use of some simplifications since the only non-null value is 1 / true.
+ */
+template<>
+class HybridK2Tree<bool> : public virtual K2Tree<bool> {
+
+public:
+    typedef bool elem_type;
+
+    typedef K2Tree<elem_type>::matrix_type matrix_type;
+    typedef K2Tree<elem_type>::list_type list_type;
+    typedef K2Tree<elem_type>::positions_type positions_type;
+    typedef K2Tree<elem_type>::pairs_type pairs_type;
+
+    // output-buffer and limited variants of the query methods (see K2Tree)
+    using K2Tree<elem_type>::getSuccessorPositions;
+    using K2Tree<elem_type>::getPredecessorPositions;
+    using K2Tree<elem_type>::getPositionsInRange;
+    using K2Tree<elem_type>::getAllValuedPositions;
+    using K2Tree<elem_type>::getSuccessors;
+    using K2Tree<elem_type>::getRange;
+    using K2Tree<elem_type>::expandFrontier;
+
+
+    HybridK2Tree() {
+        // nothing to do
+    }
+
+    HybridK2Tree(const HybridK2Tree& other) {
+
+        h_ = other.h_;
+        upperH_ = other.upperH_;
+        upperOnes_ = other.upperOnes_;
+        upperLength_ = other.upperLength_;
+        upperK_ = other.upperK_;
+        lowerK_ = other.lowerK_;
+        nPrime_ = other.nPrime_;
+        null_ = other.null_;
+
+        T_ = other.T_;
+        L_ = other.L_;
+        compressedL_ = other.compressedL_;
+        R_ = rank_type(&T_);
+        emptyNodes_ = other.emptyNodes_;
+        countSamples_ = other.countSamples_;
+        topNodes_ = other.topNodes_;
+        tableH_ = other.tableH_;
+        tableN_ = other.tableN_;
+
+    }
+
+    HybridK2Tree& operator=(const HybridK2Tree& other) {
+
+        // check for self-assignment
         if (&other == this) {
             return *this;
         }
@@ -2074,7 +3001,13 @@ public:
 
         T_ = other.T_;
         L_ = other.L_;
+        compressedL_ = other.compressedL_;
         R_ = rank_type(&T_);
+        emptyNodes_ = other.emptyNodes_;
+        countSamples_ = other.countSamples_;
+        topNodes_ = other.topNodes_;
+        tableH_ = other.tableH_;
+        tableN_ = other.tableN_;
 
         return *this;
 
@@ -2263,9 +3196,13 @@ public:
     }
 
     /**
-     * List-of-pairs-based constructor (based on section 3.3.5. of Brisaboa et al.)
+     * List-of-pairs-based constructor
+     *
+     * The mixed-radix keys of the pairs are radix-sorted once and the levels are emitted in a single sweep over them
+     * (see buildLevelsFromSortedKeys()) using up to numThreads threads. If the keys do not fit into 64 bits, the tree is built
+     * level by level as in section 3.3.5. of Brisaboa et al., the subproblems of each level are processed by up to numThreads threads.
      */
-    HybridK2Tree(positions_type& pairs, const size_type upperK, const size_type upperH, const size_type lowerK) {
+    HybridK2Tree(positions_type& pairs, const size_type upperK, const size_type upperH, const size_type lowerK, const size_type numThreads = 1) {
 
         null_ = false;
 
@@ -2291,7 +3228,7 @@ public:
         } while (nPrime_ < maxDim);
 
         if (pairs.size() != 0) {
-            buildFromListsInplace(pairs);
+            buildFromSortedKeys(pairs, numThreads);
         }
 
         R_ = rank_type(&T_);
@@ -2300,53 +3237,53 @@ public:
 
 
     // returns the arity of the upper part of the K2Tree
-    size_type getUpperK() {
+    size_type getUpperK() const {
         return upperK_;
     }
 
     // returns the arity of the lower part of the K2Tree
-    size_type getLowerK() {
+    size_type getLowerK() const {
         return lowerK_;
     }
 
     // returns the height of the upper part of the K2Tree
-    size_type getUpperH() {
+    size_type getUpperH() const {
         return upperH_;
     }
 
     // returns the number of 1-bits in the upper part of the K2Tree
-    size_type getUpperOnes() {
+    size_type getUpperOnes() const {
         return upperOnes_;
     }
 
     // returns the number of bits in the upper part of the K2Tree
-    size_type getUpperLength() {
+    size_type getUpperLength() const {
         return upperLength_;
     }
 
     // returns the height of the K2Tree
-    size_type getH() {
+    size_type getH() const {
         return upperK_;
     }
 
-    size_type getNumRows() override {
+    size_type getNumRows() const override {
         return nPrime_;
     }
 
-    size_type getNumCols() override {
+    size_type getNumCols() const override {
         return nPrime_;
     }
 
-    elem_type getNull() override {
+    elem_type getNull() const override {
         return null_;
     }
 
 
-    bool areRelated(size_type i, size_type j) override {
+    bool areRelated(size_type i, size_type j) const override {
         return checkLinkInit(i, j);
     }
 
-    std::vector<size_type> getSuccessors(size_type i) override {
+    std::vector<size_type> getSuccessors(size_type i) const override {
 
         std::vector<size_type> succs;
 //        successorsInit(succs, i);
@@ -2356,7 +3293,7 @@ public:
 
     }
 
-    std::vector<size_type> getPredecessors(size_type j) override {
+    std::vector<size_type> getPredecessors(size_type j) const override {
 
         std::vector<size_type> preds;
         predecessorsInit(preds, j);
@@ -2365,7 +3302,7 @@ public:
 
     }
 
-    positions_type getRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    positions_type getRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
 
         positions_type pairs;
         rangeInit(pairs, i1, i2, j1, j2);
@@ -2375,16 +3312,20 @@ public:
 
     }
 
-    bool containsLink(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    bool containsLink(size_type i1, size_type i2, size_type j1, size_type j2) const override {
         return linkInRangeInit(i1, i2, j1, j2);
 //        return linkInRangeInit(i1, std::min(i2, nPrime_ - 1), j1, std::min(j2, nPrime_ - 1));
     }
 
-    size_type countLinks() override {
+    size_type countLinks() const override {
+
+        if (!countSamples_.empty()) {
+            return countSamples_.back();
+        }
 
         size_type res = 0;
-        for (size_type i = 0; i < L_.size(); i++) {
-            res += L_[i];
+        for (size_type i = 0; i < numLeaves(); i++) {
+            res += leaf(i);
         }
 
         return res;
@@ -2396,23 +3337,32 @@ public:
      * General methods for completeness' sake (are redundant / useless for bool)
      */
 
-    bool isNotNull(size_type i, size_type j) override {
+    bool isNotNull(size_type i, size_type j) const override {
         return areRelated(i, j);
     }
 
-    elem_type getElement(size_type i, size_type j) override {
+    elem_type getElement(size_type i, size_type j) const override {
         return areRelated(i, j);
     }
 
-    std::vector<elem_type> getSuccessorElements(size_type i) override {
+    void isNotNull(const positions_type& queries, std::vector<bool>& out) const override {
+        out.assign(queries.size(), false);
+        batchInit(queries, [&](size_type x, size_type pos) { out[x] = leaf(pos); });
+    }
+
+    void getElement(const positions_type& queries, std::vector<elem_type>& out) const override {
+        isNotNull(queries, out);
+    }
+
+    std::vector<elem_type> getSuccessorElements(size_type i) const override {
         return std::vector<elem_type>(getSuccessors(i).size(), true);
     }
 
-    std::vector<size_type> getSuccessorPositions(size_type i) override {
+    std::vector<size_type> getSuccessorPositions(size_type i) const override {
         return getSuccessors(i);
     }
 
-    pairs_type getSuccessorValuedPositions(size_type i) override {
+    pairs_type getSuccessorValuedPositions(size_type i) const override {
 
         auto pos = getSuccessors(i);
 
@@ -2425,15 +3375,15 @@ public:
 
     }
 
-    std::vector<elem_type> getPredecessorElements(size_type j) override {
+    std::vector<elem_type> getPredecessorElements(size_type j) const override {
         return std::vector<elem_type>(getPredecessors(j).size(), true);
     }
 
-    std::vector<size_type> getPredecessorPositions(size_type j) override {
+    std::vector<size_type> getPredecessorPositions(size_type j) const override {
         return getPredecessors(j);
     }
 
-    pairs_type getPredecessorValuedPositions(size_type j) override {
+    pairs_type getPredecessorValuedPositions(size_type j) const override {
 
         auto pos = getPredecessors(j);
 
@@ -2446,15 +3396,15 @@ public:
 
     }
 
-    std::vector<elem_type> getElementsInRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    std::vector<elem_type> getElementsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
         return std::vector<elem_type>(getRange(i1, i2, j1, j2).size(), true);
     }
 
-    positions_type getPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    positions_type getPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
         return getRange(i1, i2, j1, j2);
     }
 
-    pairs_type getValuedPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    pairs_type getValuedPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
 
         auto pos = getRange(i1, i2, j1, j2);
 
@@ -2467,15 +3417,15 @@ public:
 
     }
 
-    std::vector<elem_type> getAllElements() override {
+    std::vector<elem_type> getAllElements() const override {
         return std::vector<elem_type>(countLinks(), true);
     }
 
-    positions_type getAllPositions() override {
+    positions_type getAllPositions() const override {
         return getRange(0, nPrime_ - 1, 0, nPrime_ - 1);
     }
 
-    pairs_type getAllValuedPositions() override {
+    pairs_type getAllValuedPositions() const override {
 
         auto pos = getAllPositions();
 
@@ -2488,21 +3438,147 @@ public:
 
     }
 
-    bool containsElement(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    bool forEachSuccessorPosition(size_type i, const std::function<bool(size_type)>& visitor) const override {
+        return successorsVisitInit(visitor, i);
+    }
+
+    bool forEachPredecessorPosition(size_type j, const std::function<bool(size_type)>& visitor) const override {
+        return predecessorsVisitInit(visitor, j);
+    }
+
+    bool forEachValuedPositionInRange(size_type i1, size_type i2, size_type j1, size_type j2, const std::function<bool(size_type, size_type, elem_type)>& visitor) const override {
+        return rangeValVisitInit(visitor, i1, i2, j1, j2);
+    }
+
+    bool containsElement(size_type i1, size_type i2, size_type j1, size_type j2) const override {
         return linkInRangeInit(i1, i2, j1, j2);
 //        return linkInRangeInit(i1, std::min(i2, nPrime_ - 1), j1, std::min(j2, nPrime_ - 1));
     }
 
-    size_type countElements() override {
+    size_type countElements() const override {
         return countLinks();
     }
 
+    size_type countElementsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
+        return countRangeInit(i1, i2, j1, j2);
+    }
+
+    // builds the (optional) counting index, a sampled prefix sum over the non-null entries of L,
+    // which makes countElements() constant-time and speeds up counting fully covered submatrices in countElementsInRange()
+    // (the index is kept up to date by setNull(), but it is not written by serialize())
+    void buildCountingIndex() {
+
+        this->checkWritable("buildCountingIndex");
+
+        size_type numSamples = numLeaves() / K2TREES_COUNT_SAMPLE_RATE + 1;
+        countSamples_.assign(numSamples + 1, 0);
+
+        size_type cnt = 0;
+        for (size_type s = 0; s < numSamples; s++) {
+
+            countSamples_[s] = cnt;
+            for (size_type x = s * K2TREES_COUNT_SAMPLE_RATE; x < std::min((s + 1) * K2TREES_COUNT_SAMPLE_RATE, numLeaves()); x++) {
+                cnt += leaf(x);
+            }
+
+        }
+
+        countSamples_[numSamples] = cnt;
+
+    }
+
+    bool hasCountingIndex() const {
+        return !countSamples_.empty();
+    }
+
+    // builds a direct lookup table for the nodes of the upper levels levels of the K2Tree (upperK^(2 * levels) entries, at most getMaxLookupTableLevels() levels),
+    // so that point queries start their descent at the corresponding node and skip the accesses to T on these levels
+    // (like the counting index, the table is not written by serialize())
+    void buildLookupTable(size_type levels) {
+
+        this->checkWritable("buildLookupTable");
+
+        size_type maxLevels = getMaxLookupTableLevels();
+        if ((levels == 0) || (levels > maxLevels)) {
+            throw std::runtime_error("Number of levels for the lookup table has to be between 1 and " + std::to_string(maxLevels) + " (see getMaxLookupTableLevels()).");
+        }
+
+        size_type width = size_type(pow(upperK_, levels));
+        size_type n = nPrime_ / width;
+        topNodes_.assign(width * width, 0);
+
+        for (size_type r = 0; r < width; r++) {
+            for (size_type c = 0; c < width; c++) {
+
+                // descend to the node covering submatrix (r, c) or stop at its closest (empty) ancestor
+                size_type p = r * n;
+                size_type q = c * n;
+                size_type m = nPrime_ / upperK_;
+                size_type z = (p / m) * upperK_ + q / m;
+                for (size_type l = 1; (l < levels) && (z < T_.size()) && T_[z]; l++) {
+
+                    p %= m;
+                    q %= m;
+                    m /= upperK_;
+                    z = R_.rank(z + 1) * upperK_ * upperK_ + (p / m) * upperK_ + q / m;
+
+                }
+
+                topNodes_[r * width + c] = z;
+
+            }
+        }
+
+        tableH_ = levels;
+        tableN_ = n;
+
+    }
+
+    bool hasLookupTable() const {
+        return !topNodes_.empty();
+    }
+
+    // returns the largest number of levels accepted by buildLookupTable() (at most upperH): the table may take at most
+    // K2TREES_LOOKUP_TABLE_MAX_RATIO times the space of T and its rank data structure, only the table of the first level is always permitted
+    size_type getMaxLookupTableLevels() const {
+
+        double budget = K2TREES_LOOKUP_TABLE_MAX_RATIO * (sdsl::size_in_bytes(T_) + sdsl::size_in_bytes(R_)) / sizeof(size_type); // in entries
+
+        size_type levels = std::min((size_type) 1, upperH_);
+        while ((levels < upperH_) && (pow(upperK_, 2 * (levels + 1)) <= budget)) {
+            levels++;
+        }
+
+        return levels;
+
+    }
+
+    // replaces the last level L by a dictionary of its distinct lowerK*lowerK blocks (sorted by decreasing frequency)
+    // and the DAC-encoded dictionary index of every leaf block (the vocabulary of leaf blocks of Brisaboa et al.),
+    // which saves space when few distinct blocks make up most of L; afterwards, setNull() is no longer supported
+    void compressLeaves() {
+
+        this->checkWritable("compressLeaves");
+
+        if (L_.empty()) {
+            return;
+        }
+
+        compressedL_ = LeafDictionary<bool>(L_, lowerK_ * lowerK_);
+        L_ = bit_vector_type(0);
+
+    }
+
+    bool hasCompressedLeaves() const {
+        return !compressedL_.empty();
+    }
+
 
     HybridK2Tree* clone() const override {
         return new HybridK2Tree<elem_type>(*this);
     }
 
-    void print(bool all = false) override {
+    void print(bool all = false) const override {
 
         std::cout << "### Parameters ###" << std::endl;
         std::cout << "h  = " << h_ << std::endl;
@@ -2521,7 +3597,7 @@ public:
             std::cout << std::endl << std::endl;
 
             std::cout << "### L ###" << std::endl;
-            for (size_type i = 0; i < L_.size(); i++) std::cout << L_[i];
+            for (size_type i = 0; i < numLeaves(); i++) std::cout << leaf(i);
             std::cout << std::endl << std::endl;
 
             std::cout << "### R ###" << std::endl;
@@ -2532,28 +3608,173 @@ public:
 
     }
 
-    // note: can "invalidate" the data structure (containsLink() probably won't work correctly afterwards)
+    void serialize(std::ostream& out) const override {
+
+        writeHeader(out, "HybridK2Tree<bool>", sizeof(elem_type));
+
+        writeValue(out, h_);
+        writeValue(out, upperH_);
+        writeValue(out, upperOnes_);
+        writeValue(out, upperLength_);
+        writeValue(out, upperK_);
+        writeValue(out, lowerK_);
+        writeValue(out, nPrime_);
+        writeValue(out, null_);
+
+        T_.serialize(out);
+        L_.serialize(out);
+        compressedL_.serialize(out);
+        R_.serialize(out);
+        emptyNodes_.serialize(out);
+
+    }
+
+    void load(std::istream& in) override {
+
+        this->checkWritable("load");
+
+        unsigned int version = readHeader(in, "HybridK2Tree<bool>", sizeof(elem_type));
+
+        readValue(in, h_);
+        readValue(in, upperH_);
+        readValue(in, upperOnes_);
+        readValue(in, upperLength_);
+        readValue(in, upperK_);
+        readValue(in, lowerK_);
+        readValue(in, nPrime_);
+        readValue(in, null_);
+
+        T_.load(in);
+        L_.load(in);
+        if (version >= 6) {
+            compressedL_.load(in);
+        } else {
+            compressedL_ = LeafDictionary<bool>();
+        }
+        R_.load(in, &T_);
+        if (version >= 4) {
+            emptyNodes_.load(in);
+        } else {
+            emptyNodes_ = bit_vector_type();
+        }
+
+        countSamples_.clear();
+        topNodes_.clear();
+        tableH_ = 0;
+        tableN_ = 0;
+
+    }
+
+    // note: emptied subtrees are only marked, compact() removes them from the internal structure
     void setNull(size_type i, size_type j) override {
+
+        this->checkWritable("setNull");
+
+        if (!compressedL_.empty()) {
+            throw std::runtime_error("setNull() is not supported after compressLeaves().");
+        }
+
         setInit(i, j);
     }
 
-    size_type getFirstSuccessor(size_type i) override {
+    // rebuilds the internal structure from the remaining elements, so that the subtrees emptied by setNull() are removed
+    // (the size of the relation matrix remains unchanged, the counting index and the lookup table are rebuilt if present)
+    void compact() override {
+
+        this->checkWritable("compact");
+
+        if (emptyNodes_.empty()) {
+            return;
+        }
+
+        positions_type pairs = getAllPositions();
+        bool compressed = !compressedL_.empty();
+
+        T_ = bit_vector_type();
+        L_ = bit_vector_type();
+        compressedL_ = LeafDictionary<bool>();
+        emptyNodes_ = bit_vector_type();
+
+        if (!pairs.empty()) {
+            buildFromListsInplace(pairs, 1);
+        }
+
+        if (compressed) {
+            compressLeaves();
+        }
+
+        R_ = rank_type(&T_);
+
+        if (!countSamples_.empty()) {
+            buildCountingIndex();
+        }
+
+        if (!topNodes_.empty()) {
+            buildLookupTable(std::min(tableH_, getMaxLookupTableLevels()));
+        }
+
+    }
+
+    SizeBreakdown sizeInBytes() const override {
+
+        SizeBreakdown s;
+        s.T = sdsl::size_in_bytes(T_);
+        s.L = sdsl::size_in_bytes(L_) + compressedL_.sizeInBytes();
+        s.rank = sdsl::size_in_bytes(R_);
+        s.aux = sdsl::size_in_bytes(emptyNodes_) + vectorBytes(countSamples_) + vectorBytes(topNodes_);
+        s.other = sizeof(*this);
+
+        return s;
+
+    }
+
+    size_type getFirstSuccessor(size_type i) const override {
 //        return firstSuccessorInit(i);
         return firstSuccessorPositionIterative(i);
     }
 
+    std::vector<size_type> expandFrontier(const std::vector<size_type>& frontier, std::vector<bool>& visited) const override {
+
+        auto rows = this->prepareFrontier(frontier, visited);
+        std::vector<size_type> cols;
+
+        if ((numLeaves() != 0) && !rows.empty()) {
+            frontierPos(cols, visited, nPrime_, 0, 0, rows.cbegin(), rows.cend(), 0, 0);
+        }
+
+        this->finishFrontier(cols, visited);
+
+        return cols;
+
+    }
+
 
 
 private:
     // representation of all but the last levels of the K2Tree (internal structure)
-    bit_vector_type T_;
+    level_vector_type T_;
 
     // representation of the last level of the K2Tree (actual values of the relation)
     bit_vector_type L_;
 
+    // (optional) compressed representation of the last level, replaces L_ after compressLeaves()
+    LeafDictionary<bool> compressedL_;
+
     // rank data structure for navigation in T_
     rank_type R_;
 
+    // marks the internal nodes whose subtrees have been emptied by setNull() (empty if there are none), see compact()
+    bit_vector_type emptyNodes_;
+
+    // (optional) counting index: number of non-null entries in L_[0..s * K2TREES_COUNT_SAMPLE_RATE) for all samples s, followed by the total number
+    std::vector<size_type> countSamples_;
+
+    // (optional) lookup table: node on level tableH_ covering submatrix (r, c) of edge length tableN_ (or its closest empty ancestor)
+    // at position r * (nPrime_ / tableN_) + c
+    std::vector<size_type> topNodes_;
+    size_type tableH_ = 0;
+    size_type tableN_ = 0;
+
     size_type upperK_; // arity in the upper part of the K2Tree
     size_type lowerK_; // arity in the lower part of the K2Tree
     size_type upperH_; // height of the upper part of the K2Tree
@@ -2759,8 +3980,8 @@ private:
 
         } else {
 
-            std::vector<bool> T, L;
-            NaiveDynamicRank R;
+            DynamicVector<bool> T, L;
+            DynamicRank R;
 
             for (size_type i = 0; i < lists.size(); i++) {
                 for (size_type j = 0; j < lists[i].size(); j++) {
@@ -2769,12 +3990,10 @@ private:
             }
 
             L_ = bit_vector_type(L.size());
-            std::move(L.begin(), L.end(), L_.begin());
-            L.clear();
-            L.shrink_to_fit();
+            L.copyTo(L_.begin());
 
             T_ = bit_vector_type(T.size());
-            std::move(T.begin(), T.end(), T_.begin());
+            T.copyTo(T_.begin());
 
         }
 
@@ -2782,14 +4001,14 @@ private:
 
     }
 
-    void insertInit(std::vector<bool>& T, std::vector<bool>& L, NaiveDynamicRank& R, size_type p, size_type q) {
+    void insertInit(DynamicVector<bool>& T, DynamicVector<bool>& L, DynamicRank& R, size_type p, size_type q) {
 
         auto k = (upperH_ > 0) ? upperK_ : lowerK_;
 
         if (T.empty()) {
 
-            T = std::vector<bool>(k * k);
-            R = NaiveDynamicRank(T);
+            T = DynamicVector<bool>(k * k, false);
+            R = DynamicRank(std::vector<bool>(k * k));
 
             upperOnes_ = 0;
             upperLength_ = (upperH_ > 0) ? k * k : 0;
@@ -2800,7 +4019,7 @@ private:
 
     }
 
-    void insert(std::vector<bool>& T, std::vector<bool>& L, NaiveDynamicRank& R, size_type n, size_type p, size_type q, size_type z, size_type l) {
+    void insert(DynamicVector<bool>& T, DynamicVector<bool>& L, DynamicRank& R, size_type n, size_type p, size_type q, size_type z, size_type l) {
 
         auto k = (l < upperH_) ? upperK_ : lowerK_;
 
@@ -2812,7 +4031,7 @@ private:
             if (l < upperH_) {
 
                 upperOnes_++;
-                upperLength_ += k;
+                upperLength_ += k * k;
 
             }
 
@@ -2820,15 +4039,15 @@ private:
 
             if ((l + 1) == h_) {
 
-                L.insert(L.begin() + y - T.size(), k * k, 0);
+                L.insert(y - T.size(), k * k, 0);
                 L[y + (p / (n / k)) * k + q / (n / k) - T.size()] = 1;
 
             } else {
 
-                T.insert(T.begin() + y, k * k, 0);
+                T.insert(y, k * k, 0);
                 R.insert(y + 1, k * k);
 
-                insert(T, L, R, n / k, p % (n / k), q % (n / k), y, l + 1);
+                insert(T, L, R, n / k, p % (n / k), q % (n / k), y + (p / (n / k)) * k + q / (n / k), l + 1);
 
             }
 
@@ -2846,112 +4065,107 @@ private:
 
     }
 
-    /* helper methods for inplace construction from single list of pairs */
-
-    size_type computeKey(const positions_type::value_type& pair, const Subproblem& sp, size_type width, size_type k) {
-        return ((pair.first - sp.firstRow) / width) * k + (pair.second - sp.firstCol) / width;
-    }
-
-    void countingSort(positions_type& pairs, std::vector<std::pair<size_type, size_type>>& intervals, const Subproblem& sp, size_type width, size_type sup, size_type k) {
-
-        std::vector<size_type> counts(sup);
+    /* helper method for construction from the radix-sorted keys of a single list of pairs */
 
-        // determine key frequencies
-        for (size_type i = sp.left; i < sp.right; i++) {
-            counts[computeKey(pairs[i], sp, width, k)]++;
-        }
-
-        // determine starting index for each key
-        size_type total = 0;
-        size_type tmp;
+    void buildFromSortedKeys(positions_type& pairs, const size_type numThreads) {
 
-        for (size_type key = 0; key < sup; key++) {
+        std::vector<size_type> ks(h_, lowerK_);
+        std::fill(ks.begin(), ks.begin() + upperH_, upperK_);
+        std::vector<size_type> ones;
 
-            tmp = counts[key];
-            counts[key] = total;
-            total += tmp;
+        std::vector<bool> T, L;
+        if (!buildLevelsFromSortedKeys(pairs, ks, ks, false, T, L, numThreads, &ones)) {
 
-            intervals[key].first = counts[key];
-            intervals[key].second = total;
+            buildFromListsInplace(pairs, numThreads); // the keys do not fit into 64 bits
+            return;
 
         }
 
-        // reorder pairs of current subproblem
-        positions_type tmpPairs(sp.right - sp.left + 1);
-        for (size_type i = sp.left; i < sp.right; i++) {
+        // all ones of the upper levels (except for the last one) belong to the upper part
+        upperOnes_ = 0;
+        for (size_type l = 0; l + 1 < upperH_; l++) {
+            upperOnes_ += ones[l];
+        }
+        upperLength_ = (upperH_ > 0) ? (upperOnes_ + 1) * upperK_ * upperK_ : 0;
 
-            tmpPairs[counts[computeKey(pairs[i], sp, width, k)]] = pairs[i];
-            counts[computeKey(pairs[i], sp, width, k)]++;
+        L_ = bit_vector_type(L.size());
+        std::move(L.begin(), L.end(), L_.begin());
+        L.clear();
+        L.shrink_to_fit();
 
-        }
+        T_ = bit_vector_type(T.size());
+        std::move(T.begin(), T.end(), T_.begin());
 
-        for (size_type i = sp.left; i < sp.right; i++) {
-            pairs[i] = tmpPairs[i - sp.left];
-        }
+    }
+
+    /* helper methods for inplace construction from single list of pairs */
 
+    size_type computeKey(const positions_type::value_type& pair, const Subproblem& sp, size_type width, size_type k) {
+        return ((pair.first - sp.firstRow) / width) * k + (pair.second - sp.firstCol) / width;
     }
 
-    void buildFromListsInplace(positions_type& pairs) {// 3.3.5
+    void countingSort(positions_type& pairs, LevelBuildState<positions_type, bool>& state, const Subproblem& sp, size_type width, size_type sup, size_type k, size_type numThreads) {
+        countingSortByKey(pairs, sp.left, sp.right, sup, [&](const positions_type::value_type& pair) { return computeKey(pair, sp, width, k); }, state.intervals, state.counts, state.tmpPairs, numThreads);
+    }
 
-        std::queue<std::pair<Subproblem, size_type>> queue;
-        std::pair<Subproblem, size_type> sp;
-        size_type k, S;
-        std::vector<std::pair<size_type, size_type>> intervals(std::max(upperK_, lowerK_) * std::max(upperK_, lowerK_));
+    void buildFromListsInplace(positions_type& pairs, const size_type numThreads) {// 3.3.5 (level by level, the subproblems of each level are distributed among the threads)
+
+        std::vector<Subproblem> level(1, Subproblem(0, nPrime_ - 1, 0, nPrime_ - 1, 0, pairs.size()));
+        std::vector<LevelBuildState<positions_type, bool>> states(std::max(numThreads, (size_type) 1));
         std::vector<bool> T, L;
-        bit_vector_type appToL;
+        size_type S = nPrime_;
+        size_type k = 0;
 
         upperOnes_ = 0;
         upperLength_ = 0;
 
-        queue.push(std::make_pair(Subproblem(0, nPrime_ - 1, 0, nPrime_ - 1, 0, pairs.size()), 0));
-
-        while (!queue.empty()) {
-
-            sp = queue.front();
-            queue.pop();
-
-            k = (sp.second < upperH_) ? upperK_ : lowerK_;
-            S = sp.first.lastRow - sp.first.firstRow + 1;
+        auto process = [&](LevelBuildState<positions_type, bool>& state, const Subproblem& sp, size_type sortThreads) {
 
             if (S > k) {
 
-                countingSort(pairs, intervals, sp.first, S / k, k * k, k);
+                countingSort(pairs, state, sp, S / k, k * k, k, sortThreads);
 
                 for (size_type i = 0; i < k * k; i++) {
 
-                    if (intervals[i].first < intervals[i].second) {
-
-                        T.push_back(true);
-                        queue.push(std::make_pair(
-                                Subproblem(
-                                sp.first.firstRow + (i / k) * (S / k),
-                                sp.first.firstRow + (i / k + 1) * (S / k) - 1,
-                                sp.first.firstCol + (i % k) * (S / k),
-                                sp.first.firstCol + (i % k + 1) * (S / k) - 1,
-                                sp.first.left + intervals[i].first,
-                                sp.first.left + intervals[i].second
-                                ),
-                                sp.second + 1
-                        ));
+                    if (state.intervals[i].first < state.intervals[i].second) {
 
-                        upperOnes_+= ((upperH_ > 0) && (sp.second < upperH_ - 1));
+                        state.T.push_back(true);
+                        state.next.push_back(Subproblem(
+                                sp.firstRow + (i / k) * (S / k),
+                                sp.firstRow + (i / k + 1) * (S / k) - 1,
+                                sp.firstCol + (i % k) * (S / k),
+                                sp.firstCol + (i % k + 1) * (S / k) - 1,
+                                sp.left + state.intervals[i].first,
+                                sp.left + state.intervals[i].second
+                        ));
 
                     } else {
-                        T.push_back(false);
+                        state.T.push_back(false);
                     }
 
                 }
 
             } else {
 
-                appToL = bit_vector_type(k * k);
+                size_type offset = state.L.size();
+                state.L.resize(offset + k * k);
 
-                for (size_type i = sp.first.left; i < sp.first.right; i++) {
-                    appToL[(pairs[i].first - sp.first.firstRow) * k + (pairs[i].second - sp.first.firstCol)] = true;
+                for (size_type i = sp.left; i < sp.right; i++) {
+                    state.L[offset + (pairs[i].first - sp.firstRow) * k + (pairs[i].second - sp.firstCol)] = true;
                 }
 
-                L.insert(L.end(), appToL.begin(), appToL.end());
+            }
+
+        };
+
+        for (size_type l = 0; !level.empty(); S /= k, l++) {
 
+            k = (l < upperH_) ? upperK_ : lowerK_;
+            processLevel(level, states, numThreads, T, L, process);
+
+            // all ones of this level (i.e. the subproblems of the next level) belong to the upper part (except for the last upper level)
+            if ((upperH_ > 0) && (l < upperH_ - 1)) {
+                upperOnes_ += level.size();
             }
 
         }
@@ -2971,18 +4185,27 @@ private:
 
     /* areRelated() */
 
-    bool checkLinkInit(size_type p, size_type q) {
+    bool checkLinkInit(size_type p, size_type q) const {
+
+        size_type x;
+        if (fixedArityLeafPosition(p, q, x)) {
+            return (x < numLeaves()) && leaf(x);
+        }
+
+        if (tableH_ != 0) {
+            return (numLeaves() == 0) ? false : checkLink(tableN_, p % tableN_, q % tableN_, topNodes_[(p / tableN_) * (nPrime_ / tableN_) + q / tableN_], tableH_);
+        }
 
         size_type k = (upperH_ > 0) ? upperK_ : lowerK_;
 
-        return (L_.empty()) ? false : checkLink(nPrime_ / k, p % (nPrime_ / k), q % (nPrime_ / k), (p / (nPrime_ / k)) * k + q / (nPrime_ / k), 1);
+        return (numLeaves() == 0) ? false : checkLink(nPrime_ / k, p % (nPrime_ / k), q % (nPrime_ / k), (p / (nPrime_ / k)) * k + q / (nPrime_ / k), 1);
 
     }
 
-    bool checkLink(size_type n, size_type p, size_type q, size_type z, size_type l) {
+    bool checkLink(size_type n, size_type p, size_type q, size_type z, size_type l) const {
 
         if (z >= T_.size()) {
-            return L_[z - T_.size()];
+            return leaf(z - T_.size());
         } else {
 
             auto k = (l < upperH_) ? upperK_ : lowerK_;
@@ -2993,11 +4216,171 @@ private:
 
     }
 
+    /* helper methods for point queries with compile-time arities */
+
+    // determines the position x in L of (p, q) (numLeaves() if (p, q) lies in an empty submatrix) via the variant
+    // for the compile-time arities upperK_ and lowerK_ and returns true, returns false if one of them is none of the commonly used arities 2 and 4
+    bool fixedArityLeafPosition(size_type p, size_type q, size_type& x) const {
+
+        switch (upperK_) {
+            case 2:
+                return fixedArityLeafPosition<2>(p, q, x);
+            case 4:
+                return fixedArityLeafPosition<4>(p, q, x);
+            default:
+                return false;
+        }
+
+    }
+
+    template<size_type KU>
+    bool fixedArityLeafPosition(size_type p, size_type q, size_type& x) const {
+
+        switch (lowerK_) {
+            case 2:
+                x = leafPosition<KU, 2>(p, q);
+                return true;
+            case 4:
+                x = leafPosition<KU, 4>(p, q);
+                return true;
+            default:
+                return false;
+        }
+
+    }
+
+    // iterative descent for compile-time arities KU (upper part) and KL (lower part), both powers of two:
+    // as the edge length of every submatrix is a product of powers of KU and KL, all divisions / remainders become shifts / masks
+    template<size_type KU, size_type KL>
+    size_type leafPosition(size_type p, size_type q) const {
+
+        size_type s = logTwo(KU) * upperH_ + logTwo(KL) * (h_ - upperH_);
+        size_type z;
+
+        // start at the node of the lookup table (if any) or at the child of the root
+        if (tableH_ != 0) {
+
+            s -= logTwo(KU) * tableH_;
+            z = topNodes_[(p >> s) * (nPrime_ >> s) + (q >> s)];
+
+        } else if (upperH_ > 0) {
+
+            s -= logTwo(KU);
+            z = (p >> s) * KU + (q >> s);
+
+        } else {
+
+            s -= logTwo(KL);
+            z = (p >> s) * KL + (q >> s);
+
+        }
+
+        for (size_type l = std::max(tableH_, (size_type) 1); z < T_.size(); l++) {
+
+            if (!T_[z]) {
+                return numLeaves();
+            }
+
+            if (l < upperH_) {
+
+                s -= logTwo(KU);
+                z = R_.rank(z + 1) * KU * KU + ((p >> s) & (KU - 1)) * KU + ((q >> s) & (KU - 1));
+
+            } else {
+
+                s -= logTwo(KL);
+                z = upperLength_ + (R_.rank(z + 1) - (upperOnes_ + 1)) * KL * KL + ((p >> s) & (KL - 1)) * KL + ((q >> s) & (KL - 1));
+
+            }
+
+        }
+
+        return z - T_.size();
+
+    }
+
+    /* helper methods for batch queries (isNotNull() / getElement() on several positions) */
+
+    // calls report(x, pos) for every query x whose position is represented in L_ (at pos),
+    // every submatrix shared by several queries is descended into only once
+    template<typename F>
+    void batchInit(const positions_type& queries, F report) const {
+
+        if (numLeaves() == 0 || queries.empty()) return;
+
+        std::vector<size_type> order(queries.size());
+        std::vector<size_type> buffer(queries.size());
+        std::vector<std::vector<size_type>> ends(h_); // ends of the child groups, one array per level
+
+        for (size_type x = 0; x < queries.size(); x++) {
+            order[x] = x;
+        }
+
+        batch(queries, order, buffer, ends, report, 0, queries.size(), nPrime_, 0, 0, 0, 0);
+
+    }
+
+    template<typename F>
+    void batch(const positions_type& queries, std::vector<size_type>& order, std::vector<size_type>& buffer, std::vector<std::vector<size_type>>& ends, F& report, size_type first, size_type last, size_type n, size_type p, size_type q, size_type z, size_type l) const {
+
+        size_type k = (l < upperH_) ? upperK_ : lowerK_;
+        size_type kk = (l + 1 < upperH_) ? upperK_ : lowerK_;
+        size_type m = n / k;
+        size_type numChildren = k * k;
+
+        auto& e = ends[l];
+        e.assign(numChildren, 0);
+
+        // group the queries order[first..last) by the child containing them (stable counting sort)
+        for (size_type x = first; x < last; x++) {
+            e[((queries[order[x]].first - p) / m) * k + (queries[order[x]].second - q) / m]++;
+        }
+
+        size_type sum = first;
+        for (size_type c = 0; c < numChildren; c++) {
+            size_type tmp = e[c];
+            e[c] = sum;
+            sum += tmp;
+        }
+
+        for (size_type x = first; x < last; x++) {
+            buffer[e[((queries[order[x]].first - p) / m) * k + (queries[order[x]].second - q) / m]++] = order[x];
+        }
+
+        std::copy(buffer.begin() + first, buffer.begin() + last, order.begin() + first);
+
+        // afterwards, the queries of child c are order[(c == 0 ? first : e[c - 1])..e[c])
+        size_type start = first;
+        for (size_type c = 0; c < numChildren; c++) {
+
+            size_type end = e[c];
+
+            if (start < end) {
+
+                size_type y = z + c;
+
+                if (y >= T_.size()) {
+                    for (size_type x = start; x < end; x++) {
+                        report(order[x], y - T_.size());
+                    }
+                } else if (T_[y]) {
+                    batch(queries, order, buffer, ends, report, start, end, m, p + (c / k) * m, q + (c % k) * m, (l + 1 >= upperH_) * upperLength_ + (R_.rank(y + 1) - (l + 1 >= upperH_) * (upperOnes_ + 1)) * kk * kk, l + 1);
+                }
+
+            }
+
+            start = end;
+
+        }
+
+    }
+
+
     /* getSuccessors() */
 
-    void allSuccessorPositionsIterative(std::vector<size_type>& succs, size_type p) {
+    void allSuccessorPositionsIterative(std::vector<size_type>& succs, size_type p) const {
 
-        if (L_.empty()) return;
+        if (numLeaves() == 0) return;
 
         std::queue<SubrowInfo> queue, nextLevelQueue;
         size_type lenT = T_.size();
@@ -3008,7 +4391,7 @@ private:
 
             size_type offset = p * nPrime_;
             for (size_type i = 0; i < nPrime_; i++) {
-                if (L_[offset + i]) {
+                if (leaf(offset + i)) {
                     succs.push_back(i);
                 }
             }
@@ -3020,6 +4403,7 @@ private:
             size_type l = 1;
             size_type relP = p;
             for (size_type j = 0, dq = 0, z = k * (relP / n); j < k; j++, dq += n, z++) {
+                K2TREES_COUNT(queuePushes);
                 queue.push(SubrowInfo(dq, z));
             }
 
@@ -3036,11 +4420,12 @@ private:
 
                     auto& cur = queue.front();
 
-                    if (T_[cur.z]) {
+                    if (hasChildren(cur.z)) {
 
                         size_type y = a + (R_.rank(cur.z + 1) - b) * k * k + k * (relP / n);
 
                         for (size_type j = 0, newDq = cur.dq; j < k; j++, newDq += n, y++) {
+                            K2TREES_COUNT(queuePushes);
                             nextLevelQueue.push(SubrowInfo(newDq, y));
                         }
 
@@ -3061,12 +4446,12 @@ private:
 
                 auto& cur = queue.front();
 
-                if (T_[cur.z]) {
+                if (hasChildren(cur.z)) {
 
                     size_type y = a + (R_.rank(cur.z + 1) - b) * k * k + k * (relP / n) - lenT;
 
                     for (size_type j = 0, newDq = cur.dq; j < k; j++, newDq += n, y++) {
-                        if (L_[y]) {
+                        if (leaf(y)) {
                             succs.push_back(newDq);
                         }
                     }
@@ -3081,9 +4466,9 @@ private:
 
     }
 
-    void successorsInit(std::vector<size_type>& succs, size_type p) {
+    void successorsInit(std::vector<size_type>& succs, size_type p) const {
 
-        if (!L_.empty()) {
+        if (numLeaves() != 0) {
 
             size_type k = (upperH_ > 0) ? upperK_ : lowerK_;
             size_type y = k * (p / (nPrime_ / k));
@@ -3096,17 +4481,17 @@ private:
 
     }
 
-    void successors(std::vector<size_type>& succs, size_type n, size_type p, size_type q, size_type z, size_type l) {
+    void successors(std::vector<size_type>& succs, size_type n, size_type p, size_type q, size_type z, size_type l) const {
 
         if (z >= T_.size()) {
 
-            if (L_[z - T_.size()]) {
+            if (leaf(z - T_.size())) {
                 succs.push_back(q);
             }
 
         } else {
 
-            if (T_[z]) {
+            if (hasChildren(z)) {
 
                 auto k = (l < upperH_) ? upperK_ : lowerK_;
                 size_type y = (l >= upperH_) * upperLength_ + (R_.rank(z + 1) - (l >= upperH_) * (upperOnes_ + 1)) * k * k + k * (p / (n / k));
@@ -3122,17 +4507,66 @@ private:
 
     }
 
+    /* expandFrontier() */
+
+    // expands the rows [first, last) of the frontier within the submatrix of size n x n whose upper left corner is (p,q)
+    // and whose children start at position y, the subtrees shared by several rows are only traversed once
+    void frontierPos(std::vector<size_type>& cols, std::vector<bool>& visited, size_type n, size_type p, size_type q,
+                     std::vector<size_type>::const_iterator first, std::vector<size_type>::const_iterator last, size_type y, size_type l) const {
+
+        auto k = (l < upperH_) ? upperK_ : lowerK_;
+
+        for (size_type i = 0; (i < k) && (first != last); i++) {
+
+            // rows of the frontier that lie in the i-th row of children
+            auto next = first;
+            while ((next != last) && (*next < p + (i + 1) * (n / k))) {
+                next++;
+            }
+
+            if (first != next) {
+
+                for (size_type j = 0; j < k; j++) {
+
+                    size_type z = y + i * k + j;
+
+                    if (z >= T_.size()) {
+
+                        if (leaf(z - T_.size())) {
+                            this->addToFrontier(q + j, cols, visited);
+                        }
+
+                    } else if (hasChildren(z)) {
+
+                        // the children of z lie on level l + 1
+                        auto kz = (l + 1 < upperH_) ? upperK_ : lowerK_;
+                        size_type yz = (l + 1 >= upperH_) * upperLength_ + (R_.rank(z + 1) - (l + 1 >= upperH_) * (upperOnes_ + 1)) * kz * kz;
+
+                        frontierPos(cols, visited, n / k, p + i * (n / k), q + j * (n / k), first, next, yz, l + 1);
+
+                    }
+
+                }
+
+            }
+
+            first = next;
+
+        }
+
+    }
+
     /* getFirstSuccessor() */
 
-    size_type firstSuccessorPositionIterative(size_type p) {
+    size_type firstSuccessorPositionIterative(size_type p) const {
 
-        if (L_.empty()) return nPrime_;
+        if (numLeaves() == 0) return nPrime_;
 
         if (T_.size() == 0) {
 
             size_type offset = p * nPrime_;
             for (size_type i = 0; i < nPrime_; i++) {
-                if (L_[offset + i]) {
+                if (leaf(offset + i)) {
                     return i;
                 }
             }
@@ -3143,6 +4577,7 @@ private:
             size_type l = 1;
 
             std::stack<ExtendedSubrowInfo> stack;
+            K2TREES_COUNT(queuePushes);
             stack.emplace(nPrime_ / k, nPrime_ / k, p % (nPrime_ / k), 0, k * (p / (nPrime_ / k)), 0);
 
             while (!stack.empty()) {
@@ -3158,15 +4593,16 @@ private:
 
                     if (cur.z >= T_.size()) {
 
-                        if (L_[cur.z - T_.size()]) {
+                        if (leaf(cur.z - T_.size())) {
                             return cur.dq;
                         }
 
                     } else {
 
-                        if (T_[cur.z]) {
+                        if (hasChildren(cur.z)) {
 
                             k = (l < upperH_) ? upperK_ : lowerK_;
+                            K2TREES_COUNT(queuePushes);
                             stack.emplace(cur.nr / k, cur.nc / k, cur.p % (cur.nr / k), cur.dq, (l >= upperH_) * upperLength_ + (R_.rank(cur.z + 1) - (l >= upperH_) * (upperOnes_ + 1)) * k * k + k * (cur.p / (cur.nr / k)), 0);
                             l++;
 
@@ -3187,11 +4623,11 @@ private:
 
     }
 
-    size_type firstSuccessorInit(size_type p) {
+    size_type firstSuccessorInit(size_type p) const {
 
         size_type pos = nPrime_;
 
-        if (!L_.empty()) {
+        if (numLeaves() != 0) {
 
             size_type k = (upperH_ > 0) ? upperK_ : lowerK_;
             size_type y = k * (p / (nPrime_ / k));
@@ -3206,19 +4642,19 @@ private:
 
     }
 
-    size_type firstSuccessor(size_type n, size_type p, size_type q, size_type z, size_type l) {
+    size_type firstSuccessor(size_type n, size_type p, size_type q, size_type z, size_type l) const {
 
         size_type pos = nPrime_;
 
         if (z >= T_.size()) {
 
-            if (L_[z - T_.size()]) {
+            if (leaf(z - T_.size())) {
                 pos = q;
             }
 
         } else {
 
-            if (T_[z]) {
+            if (hasChildren(z)) {
 
                 auto k = (l < upperH_) ? upperK_ : lowerK_;
                 size_type y = (l >= upperH_) * upperLength_ + (R_.rank(z + 1) - (l >= upperH_) * (upperOnes_ + 1)) * k * k + k * (p / (n / k));
@@ -3237,9 +4673,9 @@ private:
 
     /* getPredecessors() */
 
-    void predecessorsInit(std::vector<size_type>& preds, size_type q) {
+    void predecessorsInit(std::vector<size_type>& preds, size_type q) const {
 
-        if (!L_.empty()) {
+        if (numLeaves() != 0) {
 
             size_type k = (upperH_ > 0) ? upperK_ : lowerK_;
             size_type y = q / (nPrime_ / k);
@@ -3252,17 +4688,17 @@ private:
 
     }
 
-    void predecessors(std::vector<size_type>& preds, size_type n, size_type q, size_type p, size_type z, size_type l) {
+    void predecessors(std::vector<size_type>& preds, size_type n, size_type q, size_type p, size_type z, size_type l) const {
 
         if (z >= T_.size()) {
 
-            if (L_[z - T_.size()]) {
+            if (leaf(z - T_.size())) {
                 preds.push_back(p);
             }
 
         } else {
 
-            if (T_[z]) {
+            if (hasChildren(z)) {
 
                 auto k = (l < upperH_) ? upperK_ : lowerK_;
                 size_type y = (l >= upperH_) * upperLength_ + (R_.rank(z + 1) - (l >= upperH_) * (upperOnes_ + 1)) * k * k + q / (n / k);
@@ -3279,9 +4715,9 @@ private:
 
     /* getRange() */
 
-    void rangeInit(positions_type& pairs, size_type p1, size_type p2, size_type q1, size_type q2) {
+    void rangeInit(positions_type& pairs, size_type p1, size_type p2, size_type q1, size_type q2) const {
 
-        if (!L_.empty()) {
+        if (numLeaves() != 0) {
 
             size_type p1Prime, p2Prime;
 
@@ -3313,17 +4749,17 @@ private:
 
     }
 
-    void range(positions_type& pairs, size_type n, size_type p1, size_type p2, size_type q1, size_type q2, size_type dp, size_type dq, size_type z, size_type l) {
+    void range(positions_type& pairs, size_type n, size_type p1, size_type p2, size_type q1, size_type q2, size_type dp, size_type dq, size_type z, size_type l) const {
 
         if (z >= T_.size()) {
 
-            if (L_[z - T_.size()]) {
+            if (leaf(z - T_.size())) {
                 pairs.push_back(std::make_pair(dp, dq));
             }
 
         } else {
 
-            if (T_[z]) {
+            if (hasChildren(z)) {
 
                 auto k = (l < upperH_) ? upperK_ : lowerK_;
                 size_type y = (l >= upperH_) * upperLength_ + (R_.rank(z + 1) - (l >= upperH_) * (upperOnes_ + 1)) * k * k;
@@ -3357,18 +4793,189 @@ private:
 
     }
 
-    /* linkInRange() */
+    /* forEachSuccessorPosition() */
+
+    bool successorsVisitInit(const std::function<bool(size_type)>& visitor, size_type p) const {
+
+        if (numLeaves() != 0) {
+
+            size_type k = (upperH_ > 0) ? upperK_ : lowerK_;
+            size_type y = k * (p / (nPrime_ / k));
+
+            for (size_type j = 0; j < k; j++) {
+                if (!successorsVisit(visitor, nPrime_ / k, p % (nPrime_ / k), (nPrime_ / k) * j, y + j, 1)) return false;
+            }
+
+        }
+
+        return true;
+
+    }
+
+    bool successorsVisit(const std::function<bool(size_type)>& visitor, size_type n, size_type p, size_type q, size_type z, size_type l) const {
+
+        if (z >= T_.size()) {
+
+            if (leaf(z - T_.size())) {
+                if (!visitor(q)) return false;
+            }
+
+        } else {
+
+            if (hasChildren(z)) {
+
+                auto k = (l < upperH_) ? upperK_ : lowerK_;
+                size_type y = (l >= upperH_) * upperLength_ + (R_.rank(z + 1) - (l >= upperH_) * (upperOnes_ + 1)) * k * k + k * (p / (n / k));
+
+                for (size_type j = 0; j < k; j++) {
+                    if (!successorsVisit(visitor, n / k, p % (n / k), q + (n / k) * j, y + j, l + 1)) return false;
+                }
+
+            }
+
+        }
+
+        return true;
+
+    }
+
+    /* forEachPredecessorPosition() */
+
+    bool predecessorsVisitInit(const std::function<bool(size_type)>& visitor, size_type q) const {
+
+        if (numLeaves() != 0) {
+
+            size_type k = (upperH_ > 0) ? upperK_ : lowerK_;
+            size_type y = q / (nPrime_ / k);
+
+            for (size_type i = 0; i < k; i++) {
+                if (!predecessorsVisit(visitor, nPrime_ / k, q % (nPrime_ / k), (nPrime_ / k) * i, y + i * k, 1)) return false;
+            }
+
+        }
+
+        return true;
+
+    }
+
+    bool predecessorsVisit(const std::function<bool(size_type)>& visitor, size_type n, size_type q, size_type p, size_type z, size_type l) const {
+
+        if (z >= T_.size()) {
+
+            if (leaf(z - T_.size())) {
+                if (!visitor(p)) return false;
+            }
+
+        } else {
+
+            if (hasChildren(z)) {
+
+                auto k = (l < upperH_) ? upperK_ : lowerK_;
+                size_type y = (l >= upperH_) * upperLength_ + (R_.rank(z + 1) - (l >= upperH_) * (upperOnes_ + 1)) * k * k + q / (n / k);
+
+                for (size_type i = 0; i < k; i++) {
+                    if (!predecessorsVisit(visitor, n / k, q % (n / k), p + (n / k) * i, y + i * k, l + 1)) return false;
+                }
+
+            }
 
-    bool linkInRangeInit(size_type p1, size_type p2, size_type q1, size_type q2) {
+        }
+
+        return true;
+
+    }
+
+    /* forEachValuedPositionInRange() */
+
+    bool rangeValVisitInit(const std::function<bool(size_type, size_type, elem_type)>& visitor, size_type p1, size_type p2, size_type q1, size_type q2) const {
+
+        if (numLeaves() != 0) {
+
+            size_type p1Prime, p2Prime;
+
+            size_type k = (upperH_ > 0) ? upperK_ : lowerK_;
+
+            for (size_type i = p1 / (nPrime_ / k); i <= p2 / (nPrime_ / k); i++) {
 
-        if (!L_.empty()) {
+                p1Prime = (i == p1 / (nPrime_ / k)) * (p1 % (nPrime_ / k));
+                p2Prime = (i == p2 / (nPrime_ / k)) ? p2 % (nPrime_ / k) : (nPrime_ / k) - 1;
+
+                for (size_type j = q1 / (nPrime_ / k); j <= q2 / (nPrime_ / k); j++) {
+                    if (!rangeValVisit(
+                            visitor,
+                            nPrime_ / k,
+                            p1Prime,
+                            p2Prime,
+                            (j == q1 / (nPrime_ / k)) * (q1 % (nPrime_ / k)),
+                            (j == q2 / (nPrime_ / k)) ? q2 % (nPrime_ / k) : (nPrime_ / k) - 1,
+                            (nPrime_ / k) * i,
+                            (nPrime_ / k) * j,
+                            k * i + j,
+                            1
+                    )) return false;
+                }
 
-            // dividing by k_ (as stated in the paper) in not correct,
-            // because it does not use the size of the currently considered submatrix but of its submatrices
-            if ((p1 == 0) && (q1 == 0) && (p2 == (nPrime_ /*/ k_*/ - 1)) && (q2 == (nPrime_ /*/ k_*/ - 1))) {
-                return 1;
             }
 
+        }
+
+        return true;
+
+    }
+
+    bool rangeValVisit(const std::function<bool(size_type, size_type, elem_type)>& visitor, size_type n, size_type p1, size_type p2, size_type q1, size_type q2, size_type dp, size_type dq, size_type z, size_type l) const {
+
+        if (z >= T_.size()) {
+
+            if (leaf(z - T_.size())) {
+                if (!visitor(dp, dq, leaf(z - T_.size()))) return false;
+            }
+
+        } else {
+
+            if (hasChildren(z)) {
+
+                auto k = (l < upperH_) ? upperK_ : lowerK_;
+                size_type y = (l >= upperH_) * upperLength_ + (R_.rank(z + 1) - (l >= upperH_) * (upperOnes_ + 1)) * k * k;
+                size_type p1Prime, p2Prime;
+
+                for (size_type i = p1 / (n / k); i <= p2 / (n / k); i++) {
+
+                    p1Prime = (i == p1 / (n / k)) * (p1 % (n / k));
+                    p2Prime = (i == p2 / (n / k)) ? p2 % (n / k) : n / k - 1;
+
+                    for (size_type j = q1 / (n / k); j <= q2 / (n / k); j++) {
+                        if (!rangeValVisit(
+                                visitor,
+                                n / k,
+                                p1Prime,
+                                p2Prime,
+                                (j == q1 / (n / k)) * (q1 % (n / k)),
+                                (j == q2 / (n / k)) ? q2 % (n / k) : n / k - 1,
+                                dp + (n / k) * i,
+                                dq + (n / k) * j,
+                                y + k * i + j,
+                                l + 1
+                        )) return false;
+                    }
+
+                }
+
+            }
+
+        }
+
+        return true;
+
+    }
+
+
+    /* linkInRange() */
+
+    bool linkInRangeInit(size_type p1, size_type p2, size_type q1, size_type q2) const {
+
+        if (numLeaves() != 0) {
+
             size_type p1Prime, p2Prime;
 
             size_type k = (upperH_ > 0) ? upperK_ : lowerK_;
@@ -3394,15 +5001,15 @@ private:
 
     }
 
-    bool linkInRange(size_type n, size_type p1, size_type p2, size_type q1, size_type q2, size_type z, size_type l) {
+    bool linkInRange(size_type n, size_type p1, size_type p2, size_type q1, size_type q2, size_type z, size_type l) const {
 
         if (z >= T_.size()) {
 
-            return L_[z - T_.size()];
+            return leaf(z - T_.size());
 
         } else {
 
-            if (T_[z]) {
+            if (hasChildren(z)) {
 
                 // dividing by k_ (as stated in the paper) in not correct,
                 // because it does not use the size of the currently considered submatrix but of its submatrices
@@ -3438,30 +5045,238 @@ private:
     }
 
 
+    /* countElementsInRange() */
+
+    size_type countRangeInit(size_type p1, size_type p2, size_type q1, size_type q2) const {
+
+        size_type cnt = 0;
+
+        if (numLeaves() != 0) {
+
+            size_type k = (upperH_ > 0) ? upperK_ : lowerK_;
+
+            size_type p1Prime, p2Prime;
+
+            for (size_type i = p1 / (nPrime_ / k); i <= p2 / (nPrime_ / k); i++) {
+
+                p1Prime = (i == p1 / (nPrime_ / k)) * (p1 % (nPrime_ / k));
+                p2Prime = (i == p2 / (nPrime_ / k)) ? p2 % (nPrime_ / k) : (nPrime_ / k) - 1;
+
+                for (size_type j = q1 / (nPrime_ / k); j <= q2 / (nPrime_ / k); j++) {
+                    cnt += countRange(
+                            nPrime_ / k,
+                            p1Prime,
+                            p2Prime,
+                            (j == q1 / (nPrime_ / k)) * (q1 % (nPrime_ / k)),
+                            (j == q2 / (nPrime_ / k)) ? q2 % (nPrime_ / k) : (nPrime_ / k) - 1,
+                            k * i + j,
+                            1
+                    );
+                }
+
+            }
+
+        }
+
+        return cnt;
+
+    }
+
+    size_type countRange(size_type n, size_type p1, size_type p2, size_type q1, size_type q2, size_type z, size_type l) const {
+
+        if (z >= T_.size()) {
+            return leaf(z - T_.size());
+        }
+
+        if (!hasChildren(z)) {
+            return 0;
+        }
+
+        // submatrix completely covered by the range: count all its entries at once
+        if (p1 == 0 && q1 == 0 && p2 == n - 1 && q2 == n - 1) {
+            return countSubtree(z, l);
+        }
+
+        auto k = (l < upperH_) ? upperK_ : lowerK_;
+        size_type y = (l >= upperH_) * upperLength_ + (R_.rank(z + 1) - (l >= upperH_) * (upperOnes_ + 1)) * k * k;
+        size_type p1Prime, p2Prime;
+        size_type cnt = 0;
+
+        for (size_type i = p1 / (n / k); i <= p2 / (n / k); i++) {
+
+            p1Prime = (i == p1 / (n / k)) * (p1 % (n / k));
+            p2Prime = (i == p2 / (n / k)) ? p2 % (n / k) : n / k - 1;
+
+            for (size_type j = q1 / (n / k); j <= q2 / (n / k); j++) {
+                cnt += countRange(
+                        n / k,
+                        p1Prime,
+                        p2Prime,
+                        (j == q1 / (n / k)) * (q1 % (n / k)),
+                        (j == q2 / (n / k)) ? q2 % (n / k) : n / k - 1,
+                        y + k * i + j,
+                        l + 1
+                );
+            }
+
+        }
+
+        return cnt;
+
+    }
+
+    /* helper methods for counting (countElements() / countElementsInRange()) */
+
+    // returns the number of non-null entries in the leaves below node z (z < T_.size() and T_[z] = 1),
+    // the nodes of a subtree on each level form a contiguous interval, which is mapped to the next level via rank
+    size_type countSubtree(size_type z, size_type l) const {
+
+        size_type lo = z;
+        size_type hi = z + 1;
+
+        while (lo < hi && lo < T_.size()) {
+
+            auto k = (l < upperH_) ? upperK_ : lowerK_;
+
+            lo = (l >= upperH_) * upperLength_ + (R_.rank(lo) + 1 - (l >= upperH_) * (upperOnes_ + 1)) * k * k;
+            hi = (l >= upperH_) * upperLength_ + (R_.rank(hi) + 1 - (l >= upperH_) * (upperOnes_ + 1)) * k * k;
+            l++;
+
+        }
+
+        return (lo < hi) ? countLeaves(lo - T_.size(), hi - T_.size()) : 0;
+
+    }
+
+    // returns the number of non-null entries in L_[from..to)
+    size_type countLeaves(size_type from, size_type to) const {
+
+        if (countSamples_.empty()) {
+
+            size_type cnt = 0;
+            for (size_type x = from; x < to; x++) {
+                cnt += leaf(x);
+            }
+
+            return cnt;
+
+        }
+
+        return countPrefix(to) - countPrefix(from);
+
+    }
+
+    // returns the number of non-null entries in L_[0..x) using the counting index
+    size_type countPrefix(size_type x) const {
+
+        size_type cnt = countSamples_[x / K2TREES_COUNT_SAMPLE_RATE];
+        for (size_type y = (x / K2TREES_COUNT_SAMPLE_RATE) * K2TREES_COUNT_SAMPLE_RATE; y < x; y++) {
+            cnt += leaf(y);
+        }
+
+        return cnt;
+
+    }
+
+    /* helper methods for accessing the (optionally compressed) last level */
+
+    // returns the entry of the last level at position x
+    inline bool leaf(size_type x) const {
+
+        K2TREES_COUNT(leafProbes);
+        return compressedL_.empty() ? L_[x] : compressedL_[x];
+
+    }
+
+    // returns the length of the last level
+    inline size_type numLeaves() const {
+        return compressedL_.empty() ? L_.size() : compressedL_.size();
+    }
+
+    /* helper methods for handling subtrees emptied by setNull() */
+
+    // checks whether node z has children, i.e. whether its bit in T is set and its subtree has not been emptied by setNull()
+    inline bool hasChildren(size_type z) const {
+
+        K2TREES_COUNT(nodesVisited);
+        return T_[z] && (emptyNodes_.empty() || !emptyNodes_[z]);
+
+    }
+
+    // checks whether all len nodes of the block starting at position y are empty
+    bool isEmptyBlock(size_type y, size_type len) const {
+
+        for (size_type c = y; c < y + len; c++) {
+            if ((c >= T_.size()) ? leaf(c - T_.size()) : hasChildren(c)) {
+                return false;
+            }
+        }
+
+        return true;
+
+    }
+
+    // marks the subtree of node z as empty
+    void markEmpty(size_type z) {
+
+        if (emptyNodes_.empty()) {
+            emptyNodes_ = bit_vector_type(T_.size(), 0);
+        }
+
+        emptyNodes_[z] = 1;
+
+    }
+
     /* setNull() */
 
     void setInit(size_type p, size_type q) {
 
         size_type k = (upperH_ > 0) ? upperK_ : lowerK_;
 
-        if (!L_.empty()) {
+        if (numLeaves() != 0) {
             set(nPrime_ / k, p % (nPrime_ / k), q % (nPrime_ / k), (p / (nPrime_ / k)) * k + q / (nPrime_ / k), 1);
         }
 
     }
 
-    void set(size_type n, size_type p, size_type q, size_type z, size_type l) {
+    // clears the entry in the subtree of z, returns true iff the subtree is empty afterwards
+    bool set(size_type n, size_type p, size_type q, size_type z, size_type l) {
 
         if (z >= T_.size()) {
+
+            // keep the counting index up to date
+            if (!countSamples_.empty() && leaf(z - T_.size())) {
+                for (size_type s = (z - T_.size()) / K2TREES_COUNT_SAMPLE_RATE + 1; s < countSamples_.size(); s++) {
+                    countSamples_[s]--;
+                }
+            }
+
             L_[z - T_.size()] = null_;
+
+            return true;
+
         } else {
 
             auto k = (l < upperH_) ? upperK_ : lowerK_;
 
-            if (T_[z]) {
-                set(n / k, p % (n / k), q % (n / k), (l >= upperH_) * upperLength_ + (R_.rank(z + 1) - (l >= upperH_) * (upperOnes_ + 1)) * k * k + (p / (n / k)) * k + q / (n / k), l + 1);
+            if (hasChildren(z)) {
+
+                size_type y = (l >= upperH_) * upperLength_ + (R_.rank(z + 1) - (l >= upperH_) * (upperOnes_ + 1)) * k * k;
+
+                // mark z if its whole subtree has become empty
+                if (set(n / k, p % (n / k), q % (n / k), y + (p / (n / k)) * k + q / (n / k), l + 1) && isEmptyBlock(y, k * k)) {
+
+                    markEmpty(z);
+                    return true;
+
+                }
+
+                return false;
+
             }
 
+            return true;
+
         }
 
     }
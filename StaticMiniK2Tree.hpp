@@ -28,7 +28,8 @@
 /**
  * Naive implementation of a relation matrix with a K2Tree interface for very small relations.
  *
- * Simply contains a list of the relation pairs.
+ * Simply contains a list of the relation pairs (sorted by row and column) and their permutation by column,
+ * so that point, successor and range queries are answered via binary search on the pairs and predecessor queries via the permutation.
  */
 template<typename E>
 class MiniK2Tree : public virtual K2Tree<E> {
@@ -41,9 +42,21 @@ public:
     typedef typename K2Tree<elem_type>::positions_type positions_type;
     typedef typename K2Tree<elem_type>::pairs_type pairs_type;
 
+    // output-buffer and limited variants of the query methods (see K2Tree)
+    using K2Tree<elem_type>::getSuccessorPositions;
+    using K2Tree<elem_type>::getPredecessorPositions;
+    using K2Tree<elem_type>::getPositionsInRange;
+    using K2Tree<elem_type>::getAllValuedPositions;
+    using K2Tree<elem_type>::getSuccessors;
+    using K2Tree<elem_type>::getRange;
+
 
     MiniK2Tree() {
-        // nothing to do
+
+        positions_ = 0;
+        values_ = 0;
+        length_ = 0;
+
     }
 
     MiniK2Tree(const MiniK2Tree& other) {
@@ -60,6 +73,8 @@ public:
 
         }
 
+        colOrder_ = other.colOrder_;
+
     }
 
     MiniK2Tree& operator=(const MiniK2Tree& other) {
@@ -84,6 +99,8 @@ public:
 
         }
 
+        colOrder_ = other.colOrder_;
+
         return *this;
 
     }
@@ -121,6 +138,8 @@ public:
             }
         }
 
+        buildColumnOrder();
+
     }
 
     /**
@@ -148,6 +167,10 @@ public:
             }
         }
 
+
+        sortPositions();
+        buildColumnOrder();
+
     }
 
     /**
@@ -169,6 +192,10 @@ public:
 
         }
 
+
+        sortPositions();
+        buildColumnOrder();
+
     }
 
     /**
@@ -189,10 +216,12 @@ public:
 
             positions_[pos] = std::make_pair(iter->row - x, iter->col - y);
             values_[pos++] = iter->val;
-            pos++;
 
         }
 
+        sortPositions();
+        buildColumnOrder();
+
     }
 
     ~MiniK2Tree() {
@@ -202,177 +231,146 @@ public:
 
     }
 
-    size_type getNumRows() override {
-
-        size_type max = 0;
-        for (size_type k = 0; k < length_; k++) {
-            max = std::max(max, positions_[k].first + 1);
-        }
-
-        return max;
-
+    size_type getNumRows() const override {
+        return (length_ == 0) ? 0 : positions_[length_ - 1].first + 1;
     }
 
-    size_type getNumCols() override {
-
-        size_type max = 0;
-        for (size_type k = 0; k < length_; k++) {
-            max = std::max(max, positions_[k].second + 1);
-        }
-
-        return max;
-
+    size_type getNumCols() const override {
+        return (length_ == 0) ? 0 : positions_[colOrder_[length_ - 1]].second + 1;
     }
 
-    elem_type getNull() override {
+    elem_type getNull() const override {
         return null_;
     }
 
 
-    bool isNotNull(size_type i, size_type j) override {
-        return std::find_if(positions_, positions_ + length_,
-                            [i, j](const std::pair<size_type, size_type>& val) {
-                                return val.first == i && val.second == j;
-                            }) != positions_ + length_;
+    bool isNotNull(size_type i, size_type j) const override {
+        return indexOf(i, j) != length_;
     }
 
-    elem_type getElement(size_type i, size_type j) override {
+    elem_type getElement(size_type i, size_type j) const override {
 
-        auto iter = std::find_if(positions_, positions_ + length_,
-                                 [i, j](const std::pair<size_type, size_type>& val) {
-                                     return val.first == i && val.second == j;
-                                 });
+        size_type k = indexOf(i, j);
 
-        return (iter != positions_ + length_) ? values_[iter - positions_] : null_;
+        return (k != length_) ? values_[k] : null_;
 
     }
 
-    std::vector<elem_type> getSuccessorElements(size_type i) override {
+    // batch variants of isNotNull() / getElement() answer the queries one after another (the trees are tiny anyway)
+    using K2Tree<elem_type>::isNotNull;
+    using K2Tree<elem_type>::getElement;
+
+    std::vector<elem_type> getSuccessorElements(size_type i) const override {
 
         std::vector<elem_type> succs;
-        for (size_type k = 0; k < length_; k++) {
-            if (positions_[k].first == i) {
-                succs.push_back(values_[k]);
-            }
+        for (size_type k = lowerBound(i, 0); k < length_ && positions_[k].first == i; k++) {
+            succs.push_back(values_[k]);
         }
 
         return succs;
 
     }
 
-    std::vector<size_type> getSuccessorPositions(size_type i) override {
+    std::vector<size_type> getSuccessorPositions(size_type i) const override {
 
         std::vector<size_type> succs;
-        for (size_type k = 0; k < length_; k++) {
-            if (positions_[k].first == i) {
-                succs.push_back(positions_[k].second);
-            }
+        for (size_type k = lowerBound(i, 0); k < length_ && positions_[k].first == i; k++) {
+            succs.push_back(positions_[k].second);
         }
 
         return succs;
 
     }
 
-    pairs_type getSuccessorValuedPositions(size_type i) override {
+    pairs_type getSuccessorValuedPositions(size_type i) const override {
 
         pairs_type succs;
-        for (size_type k = 0; k < length_; k++) {
-            if (positions_[k].first == i) {
-                succs.push_back(ValuedPosition<elem_type>(positions_[k], values_[k]));
-            }
+        for (size_type k = lowerBound(i, 0); k < length_ && positions_[k].first == i; k++) {
+            succs.push_back(ValuedPosition<elem_type>(positions_[k], values_[k]));
         }
 
         return succs;
 
     }
 
-    std::vector<elem_type> getPredecessorElements(size_type j) override {
+    std::vector<elem_type> getPredecessorElements(size_type j) const override {
 
         std::vector<elem_type> preds;
-        for (size_type k = 0; k < length_; k++) {
-            if (positions_[k].second == j) {
-                preds.push_back(values_[k]);
-            }
+        for (size_type x = columnLowerBound(j); x < length_ && positions_[colOrder_[x]].second == j; x++) {
+            preds.push_back(values_[colOrder_[x]]);
         }
 
         return preds;
 
     }
 
-    std::vector<size_type> getPredecessorPositions(size_type j) override {
+    std::vector<size_type> getPredecessorPositions(size_type j) const override {
 
         std::vector<size_type> preds;
-        for (size_type k = 0; k < length_; k++) {
-            if (positions_[k].second == j) {
-                preds.push_back(positions_[k].first);
-            }
+        for (size_type x = columnLowerBound(j); x < length_ && positions_[colOrder_[x]].second == j; x++) {
+            preds.push_back(positions_[colOrder_[x]].first);
         }
 
         return preds;
 
     }
 
-    pairs_type getPredecessorValuedPositions(size_type j) override {
+    pairs_type getPredecessorValuedPositions(size_type j) const override {
 
         pairs_type preds;
-        for (size_type k = 0; k < length_; k++) {
-            if (positions_[k].second == j) {
-                preds.push_back(ValuedPosition<elem_type>(positions_[k], values_[k]));
-            }
+        for (size_type x = columnLowerBound(j); x < length_ && positions_[colOrder_[x]].second == j; x++) {
+            preds.push_back(ValuedPosition<elem_type>(positions_[colOrder_[x]], values_[colOrder_[x]]));
         }
 
         return preds;
 
     }
 
-    std::vector<elem_type> getElementsInRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    std::vector<elem_type> getElementsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
 
         std::vector<elem_type> elements;
-        for (size_type k = 0; k < length_; k++) {
-            if (i1 <= positions_[k].first && positions_[k].first <= i2 && j1 <= positions_[k].second && positions_[k].second <= j2) {
-                elements.push_back(values_[k]);
-            }
-        }
+        forEachInRange(i1, i2, j1, j2, [&](size_type k) {
+            elements.push_back(values_[k]);
+            return true;
+        });
 
         return elements;
 
     }
 
-    positions_type getPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    positions_type getPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
 
         positions_type pairs;
-        for (size_type k = 0; k < length_; k++) {
-            if (i1 <= positions_[k].first && positions_[k].first <= i2 && j1 <= positions_[k].second && positions_[k].second <= j2) {
-                pairs.push_back(positions_[k]);
-            }
-        }
+        forEachInRange(i1, i2, j1, j2, [&](size_type k) {
+            pairs.push_back(positions_[k]);
+            return true;
+        });
 
         return pairs;
 
     }
 
-    pairs_type getValuedPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    pairs_type getValuedPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
 
         pairs_type pairs;
-        for (size_type k = 0; k < length_; k++) {
-            if (i1 <= positions_[k].first && positions_[k].first <= i2 && j1 <= positions_[k].second && positions_[k].second <= j2) {
-                pairs.push_back(ValuedPosition<elem_type>(positions_[k], values_[k]));
-            }
-        }
+        forEachInRange(i1, i2, j1, j2, [&](size_type k) {
+            pairs.push_back(ValuedPosition<elem_type>(positions_[k], values_[k]));
+            return true;
+        });
 
         return pairs;
 
     }
 
-    std::vector<elem_type> getAllElements() override {
+    std::vector<elem_type> getAllElements() const override {
         return std::vector<elem_type>(values_, values_ + length_);
     }
 
-    positions_type getAllPositions() override {
+    positions_type getAllPositions() const override {
         return positions_type(positions_, positions_ + length_);
     }
 
-    pairs_type getAllValuedPositions() override {
+    pairs_type getAllValuedPositions() const override {
 
         pairs_type pairs;
         for (size_type k = 0; k < length_; k++) {
@@ -383,27 +381,60 @@ public:
 
     }
 
-    bool containsElement(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    bool forEachSuccessorPosition(size_type i, const std::function<bool(size_type)>& visitor) const override {
+
+        for (size_type k = lowerBound(i, 0); k < length_ && positions_[k].first == i; k++) {
+            if (!visitor(positions_[k].second)) {
+                return false;
+            }
+        }
+
+        return true;
+
+    }
+
+    bool forEachPredecessorPosition(size_type j, const std::function<bool(size_type)>& visitor) const override {
 
-        bool flag = false;
-        for (size_type k = 0; k < length_ && !flag; k++) {
-            flag = i1 <= positions_[k].first && positions_[k].first <= i2 && j1 <= positions_[k].second && positions_[k].second <= j2;
+        for (size_type x = columnLowerBound(j); x < length_ && positions_[colOrder_[x]].second == j; x++) {
+            if (!visitor(positions_[colOrder_[x]].first)) {
+                return false;
+            }
         }
 
-        return flag;
+        return true;
+
+    }
+
+    bool forEachValuedPositionInRange(size_type i1, size_type i2, size_type j1, size_type j2, const std::function<bool(size_type, size_type, elem_type)>& visitor) const override {
+        return forEachInRange(i1, i2, j1, j2, [&](size_type k) { return visitor(positions_[k].first, positions_[k].second, values_[k]); });
+    }
 
+    bool containsElement(size_type i1, size_type i2, size_type j1, size_type j2) const override {
+        return !forEachInRange(i1, i2, j1, j2, [](size_type) { return false; });
     }
 
-    size_type countElements() override {
+    size_type countElements() const override {
         return length_;
     }
 
+    size_type countElementsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
+
+        size_type cnt = 0;
+        forEachInRange(i1, i2, j1, j2, [&cnt](size_type) {
+            cnt++;
+            return true;
+        });
+
+        return cnt;
+
+    }
+
 
     MiniK2Tree* clone() const override {
         return new MiniK2Tree<elem_type>(*this);
     }
 
-    void print(bool all = false) override {
+    void print(bool all = false) const override {
 
         std::cout << "### Parameters ###" << std::endl;
         std::cout << "numRows  = " << getNumRows() << std::endl;
@@ -422,54 +453,96 @@ public:
 
     }
 
+    void serialize(std::ostream& out) const override {
+
+        writeHeader(out, "MiniK2Tree", sizeof(elem_type));
+
+        writeValue(out, length_);
+        writeValue(out, null_);
+
+        writeArray(out, positions_, length_);
+        writeArray(out, values_, length_);
+
+    }
+
+    void load(std::istream& in) override {
+
+        this->checkWritable("load");
+
+        readHeader(in, "MiniK2Tree", sizeof(elem_type));
+
+        delete[] positions_;
+        delete[] values_;
+
+        readValue(in, length_);
+        readValue(in, null_);
+
+        positions_ = new std::pair<size_type, size_type>[length_];
+        values_ = new elem_type[length_];
+        readArray(in, positions_, length_);
+        readArray(in, values_, length_);
+
+        // older streams do not necessarily contain the relation pairs in sorted order
+        if (!std::is_sorted(positions_, positions_ + length_)) {
+            sortPositions();
+        }
+        buildColumnOrder();
+
+    }
+
     // note: can "invalidate" the data structure (containsLink() probably won't work correctly afterwards)
     void setNull(size_type i, size_type j) override {
 
-        auto iter = std::find_if(positions_, positions_ + length_,
-                                 [i, j](const std::pair<size_type, size_type>& val) {
-                                     return val.first == i && val.second == j;
-                                 });
+        this->checkWritable("setNull");
+
+        size_type idx = indexOf(i, j);
 
-        if (iter != positions_ + length_) {
+        if (idx != length_) {
 
             std::pair<size_type, size_type>* tmpPos = new std::pair<size_type, size_type>[length_ - 1];
             elem_type* tmpVal = new elem_type[length_ - 1];
 
             size_type pos = 0;
-            std::pair<size_type, size_type>* p;
-            elem_type* v;
-            for (p = positions_, v = values_; p != positions_ + length_; p++, v++) {
+            for (size_type k = 0; k < length_; k++) {
 
-                if (p != iter) {
+                if (k != idx) {
 
-                    tmpPos[pos] = *p;
-                    tmpVal[pos] = *v;
+                    tmpPos[pos] = positions_[k];
+                    tmpVal[pos] = values_[k];
                     pos++;
 
                 }
 
             }
 
-            delete positions_;
-            delete values_;
+            delete[] positions_;
+            delete[] values_;
             positions_ = tmpPos;
             values_ = tmpVal;
             length_--;
 
+            buildColumnOrder();
+
         }
 
     }
 
-    size_type getFirstSuccessor(size_type i) override {
+    SizeBreakdown sizeInBytes() const override {
 
-        size_type min = getNumCols();
-        for (size_type k = 0; k < length_; k++) {
-            if (positions_[k].first == i) {
-                min = std::min(min, positions_[k].second);
-            }
-        }
+        SizeBreakdown s;
+        s.miniTrees = length_ * (sizeof(std::pair<size_type, size_type>) + sizeof(elem_type));
+        s.aux = vectorBytes(colOrder_);
+        s.other = sizeof(*this);
+
+        return s;
+
+    }
 
-        return min;
+    size_type getFirstSuccessor(size_type i) const override {
+
+        size_type k = lowerBound(i, 0);
+
+        return (k < length_ && positions_[k].first == i) ? positions_[k].second : getNumCols();
 
     }
 
@@ -478,27 +551,27 @@ public:
      * Method aliases using "relation nomenclature" (similar to the names proposed by Brisaboa et al.)
      */
 
-    bool areRelated(size_type i, size_type j) override {
+    bool areRelated(size_type i, size_type j) const override {
         return isNotNull(i, j);
     }
 
-    std::vector<size_type> getSuccessors(size_type i) override {
+    std::vector<size_type> getSuccessors(size_type i) const override {
         return getSuccessorPositions(i);
     }
 
-    std::vector<size_type> getPredecessors(size_type j) override {
+    std::vector<size_type> getPredecessors(size_type j) const override {
         return getPredecessorPositions(j);
     }
 
-    positions_type getRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    positions_type getRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
         return getPositionsInRange(i1, i2, j1, j2);
     }
 
-    bool containsLink(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    bool containsLink(size_type i1, size_type i2, size_type j1, size_type j2) const override {
         return containsElement(i1, i2, j1, j2);
     }
 
-    size_type countLinks() override {
+    size_type countLinks() const override {
         return countElements();
     }
 
@@ -511,6 +584,86 @@ private:
     size_type length_; // number of relation pairs
     elem_type null_; // null element
 
+    std::vector<size_type> colOrder_; // indices of all relation pairs sorted by column and row (for predecessor queries)
+
+
+    // sorts the relation pairs by row and column, which is the order in which they are enumerated
+    void sortPositions() {
+
+        std::vector<size_type> perm(length_);
+        for (size_type k = 0; k < length_; k++) {
+            perm[k] = k;
+        }
+
+        std::sort(perm.begin(), perm.end(), [this](const size_type a, const size_type b) { return positions_[a] < positions_[b]; });
+
+        std::vector<std::pair<size_type, size_type>> tmpPos(positions_, positions_ + length_);
+        std::vector<elem_type> tmpVal(values_, values_ + length_);
+        for (size_type k = 0; k < length_; k++) {
+            positions_[k] = tmpPos[perm[k]];
+            values_[k] = tmpVal[perm[k]];
+        }
+
+    }
+
+    // returns the index of the first relation pair at or after position (i, j) in row-major order
+    size_type lowerBound(size_type i, size_type j) const {
+        return std::lower_bound(positions_, positions_ + length_, std::make_pair(i, j)) - positions_;
+    }
+
+    // returns the index of the relation pair at position (i, j) or length_ if there is none
+    size_type indexOf(size_type i, size_type j) const {
+
+        size_type k = lowerBound(i, j);
+
+        return (k < length_ && positions_[k].first == i && positions_[k].second == j) ? k : length_;
+
+    }
+
+    // returns the first index x such that the relation pair colOrder_[x] lies in column j or behind it
+    size_type columnLowerBound(size_type j) const {
+        return std::lower_bound(colOrder_.begin(), colOrder_.end(), j, [this](const size_type k, const size_type col) { return positions_[k].second < col; }) - colOrder_.begin();
+    }
+
+    // calls f(k) for all relation pairs k in [i1, i2] x [j1, j2] (in row-major order) until it returns false
+    // and returns whether it never did; the columns outside [j1, j2] are skipped row by row via binary search
+    template<typename F>
+    bool forEachInRange(size_type i1, size_type i2, size_type j1, size_type j2, F f) const {
+
+        size_type k = lowerBound(i1, j1);
+        while (k < length_ && positions_[k].first <= i2) {
+
+            if (positions_[k].second < j1) {
+                k = lowerBound(positions_[k].first, j1);
+            } else if (positions_[k].second > j2) {
+                k = lowerBound(positions_[k].first + 1, j1);
+            } else {
+
+                if (!f(k)) {
+                    return false;
+                }
+                k++;
+
+            }
+
+        }
+
+        return true;
+
+    }
+
+    // computes colOrder_ from the relation pairs, which have to be sorted by row and column already
+    void buildColumnOrder() {
+
+        colOrder_.resize(length_);
+        for (size_type k = 0; k < length_; k++) {
+            colOrder_[k] = k;
+        }
+
+        std::stable_sort(colOrder_.begin(), colOrder_.end(), [this](const size_type a, const size_type b) { return positions_[a].second < positions_[b].second; });
+
+    }
+
 };
 
 
@@ -531,9 +684,20 @@ public:
     typedef K2Tree<elem_type>::positions_type positions_type;
     typedef K2Tree<elem_type>::pairs_type pairs_type;
 
+    // output-buffer and limited variants of the query methods (see K2Tree)
+    using K2Tree<elem_type>::getSuccessorPositions;
+    using K2Tree<elem_type>::getPredecessorPositions;
+    using K2Tree<elem_type>::getPositionsInRange;
+    using K2Tree<elem_type>::getAllValuedPositions;
+    using K2Tree<elem_type>::getSuccessors;
+    using K2Tree<elem_type>::getRange;
+
 
     MiniK2Tree() {
-        // nothing to do
+
+        positions_ = 0;
+        length_ = 0;
+
     }
 
     MiniK2Tree(const MiniK2Tree& other) {
@@ -544,6 +708,8 @@ public:
             positions_[k] = other.positions_[k];
         }
 
+        colOrder_ = other.colOrder_;
+
     }
 
     MiniK2Tree& operator=(const MiniK2Tree& other) {
@@ -561,6 +727,8 @@ public:
             positions_[k] = other.positions_[k];
         }
 
+        colOrder_ = other.colOrder_;
+
         return *this;
 
     }
@@ -592,6 +760,9 @@ public:
             }
         }
 
+
+        buildColumnOrder();
+
     }
 
     /**
@@ -613,6 +784,10 @@ public:
             }
         }
 
+
+        std::sort(positions_, positions_ + length_);
+        buildColumnOrder();
+
     }
 
     /**
@@ -628,6 +803,10 @@ public:
             positions_[pos++] = p;
         }
 
+
+        std::sort(positions_, positions_ + length_);
+        buildColumnOrder();
+
     }
 
     /**
@@ -650,180 +829,152 @@ public:
 
         }
 
+
+        std::sort(positions_, positions_ + length_);
+        buildColumnOrder();
+
     }
 
     ~MiniK2Tree() {
         delete[] positions_;
     }
 
-    size_type getNumRows() override {
-
-        size_type max = 0;
-        for (size_type i = 0; i < length_; i++) {
-            max = std::max(max, positions_[i].first + 1);
-        }
-
-        return max;
-
-
+    size_type getNumRows() const override {
+        return (length_ == 0) ? 0 : positions_[length_ - 1].first + 1;
     }
 
-    size_type getNumCols() override {
-
-        size_type max = 0;
-        for (size_type i = 0; i < length_; i++) {
-            max = std::max(max, positions_[i].second + 1);
-        }
-
-        return max;
-
+    size_type getNumCols() const override {
+        return (length_ == 0) ? 0 : positions_[colOrder_[length_ - 1]].second + 1;
     }
 
-    elem_type getNull() override {
+    elem_type getNull() const override {
         return false;
     }
 
 
-    bool isNotNull(size_type i, size_type j) override {
-        return std::find_if(positions_, positions_ + length_,
-                            [i, j](const std::pair<size_type, size_type>& val) {
-                                return val.first == i && val.second == j;
-                            }) != positions_ + length_;
+    bool isNotNull(size_type i, size_type j) const override {
+        return indexOf(i, j) != length_;
     }
 
-    elem_type getElement(size_type i, size_type j) override {
-        return std::find_if(positions_, positions_ + length_,
-                            [i, j](const std::pair<size_type, size_type>& val) {
-                                return val.first == i && val.second == j;
-                            }) != positions_ + length_;
+    elem_type getElement(size_type i, size_type j) const override {
+        return indexOf(i, j) != length_;
     }
 
-    std::vector<elem_type> getSuccessorElements(size_type i) override {
+    // batch variants of isNotNull() / getElement() answer the queries one after another (the trees are tiny anyway)
+    using K2Tree<elem_type>::isNotNull;
+    using K2Tree<elem_type>::getElement;
+
+    std::vector<elem_type> getSuccessorElements(size_type i) const override {
 
         std::vector<elem_type> succs;
-        for (size_type k = 0; k < length_; k++) {
-            if (positions_[k].first == i) {
-                succs.push_back(true);
-            }
+        for (size_type k = lowerBound(i, 0); k < length_ && positions_[k].first == i; k++) {
+            succs.push_back(true);
         }
 
         return succs;
 
     }
 
-    std::vector<size_type> getSuccessorPositions(size_type i) override {
+    std::vector<size_type> getSuccessorPositions(size_type i) const override {
 
         std::vector<size_type> succs;
-        for (size_type k = 0; k < length_; k++) {
-            if (positions_[k].first == i) {
-                succs.push_back(positions_[k].second);
-            }
+        for (size_type k = lowerBound(i, 0); k < length_ && positions_[k].first == i; k++) {
+            succs.push_back(positions_[k].second);
         }
 
         return succs;
 
     }
 
-    pairs_type getSuccessorValuedPositions(size_type i) override {
+    pairs_type getSuccessorValuedPositions(size_type i) const override {
 
         pairs_type succs;
-        for (size_type k = 0; k < length_; k++) {
-            if (positions_[k].first == i) {
-                succs.push_back(ValuedPosition<elem_type>(positions_[k], true));
-            }
+        for (size_type k = lowerBound(i, 0); k < length_ && positions_[k].first == i; k++) {
+            succs.push_back(ValuedPosition<elem_type>(positions_[k], true));
         }
 
         return succs;
 
     }
 
-    std::vector<elem_type> getPredecessorElements(size_type j) override {
+    std::vector<elem_type> getPredecessorElements(size_type j) const override {
 
         std::vector<elem_type> preds;
-        for (size_type k = 0; k < length_; k++) {
-            if (positions_[k].second == j) {
-                preds.push_back(true);
-            }
+        for (size_type x = columnLowerBound(j); x < length_ && positions_[colOrder_[x]].second == j; x++) {
+            preds.push_back(true);
         }
 
         return preds;
 
     }
 
-    std::vector<size_type> getPredecessorPositions(size_type j) override {
+    std::vector<size_type> getPredecessorPositions(size_type j) const override {
 
         std::vector<size_type> preds;
-        for (size_type k = 0; k < length_; k++) {
-            if (positions_[k].second == j) {
-                preds.push_back(positions_[k].first);
-            }
+        for (size_type x = columnLowerBound(j); x < length_ && positions_[colOrder_[x]].second == j; x++) {
+            preds.push_back(positions_[colOrder_[x]].first);
         }
 
         return preds;
 
     }
 
-    pairs_type getPredecessorValuedPositions(size_type j) override {
+    pairs_type getPredecessorValuedPositions(size_type j) const override {
 
         pairs_type preds;
-        for (size_type k = 0; k < length_; k++) {
-            if (positions_[k].second == j) {
-                preds.push_back(ValuedPosition<elem_type>(positions_[k], true));
-            }
+        for (size_type x = columnLowerBound(j); x < length_ && positions_[colOrder_[x]].second == j; x++) {
+            preds.push_back(ValuedPosition<elem_type>(positions_[colOrder_[x]], true));
         }
 
         return preds;
 
     }
 
-    std::vector<elem_type> getElementsInRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    std::vector<elem_type> getElementsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
 
         std::vector<elem_type> elements;
-        for (size_type k = 0; k < length_; k++) {
-            if (i1 <= positions_[k].first && positions_[k].first <= i2 && j1 <= positions_[k].second && positions_[k].second <= j2) {
-                elements.push_back(true);
-            }
-        }
+        forEachInRange(i1, i2, j1, j2, [&](size_type k) {
+            elements.push_back(true);
+            return true;
+        });
 
         return elements;
 
     }
 
-    positions_type getPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    positions_type getPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
 
         positions_type pairs;
-        for (size_type k = 0; k < length_; k++) {
-            if (i1 <= positions_[k].first && positions_[k].first <= i2 && j1 <= positions_[k].second && positions_[k].second <= j2) {
-                pairs.push_back(positions_[k]);
-            }
-        }
+        forEachInRange(i1, i2, j1, j2, [&](size_type k) {
+            pairs.push_back(positions_[k]);
+            return true;
+        });
 
         return pairs;
 
     }
 
-    pairs_type getValuedPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    pairs_type getValuedPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
 
         pairs_type pairs;
-        for (size_type k = 0; k < length_; k++) {
-            if (i1 <= positions_[k].first && positions_[k].first <= i2 && j1 <= positions_[k].second && positions_[k].second <= j2) {
-                pairs.push_back(ValuedPosition<elem_type>(positions_[k], true));
-            }
-        }
+        forEachInRange(i1, i2, j1, j2, [&](size_type k) {
+            pairs.push_back(ValuedPosition<elem_type>(positions_[k], true));
+            return true;
+        });
 
         return pairs;
 
     }
 
-    std::vector<elem_type> getAllElements() override {
+    std::vector<elem_type> getAllElements() const override {
         return std::vector<elem_type>(length_, true);
     }
 
-    positions_type getAllPositions() override {
+    positions_type getAllPositions() const override {
         return positions_type(positions_, positions_ + length_);
     }
 
-    pairs_type getAllValuedPositions() override {
+    pairs_type getAllValuedPositions() const override {
 
         pairs_type pairs;
         for (size_type k = 0; k < length_; k++) {
@@ -834,27 +985,60 @@ public:
 
     }
 
-    bool containsElement(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    bool forEachSuccessorPosition(size_type i, const std::function<bool(size_type)>& visitor) const override {
+
+        for (size_type k = lowerBound(i, 0); k < length_ && positions_[k].first == i; k++) {
+            if (!visitor(positions_[k].second)) {
+                return false;
+            }
+        }
+
+        return true;
+
+    }
+
+    bool forEachPredecessorPosition(size_type j, const std::function<bool(size_type)>& visitor) const override {
 
-        bool flag = false;
-        for (size_type k = 0; k < length_ && !flag; k++) {
-            flag = i1 <= positions_[k].first && positions_[k].first <= i2 && j1 <= positions_[k].second && positions_[k].second <= j2;
+        for (size_type x = columnLowerBound(j); x < length_ && positions_[colOrder_[x]].second == j; x++) {
+            if (!visitor(positions_[colOrder_[x]].first)) {
+                return false;
+            }
         }
 
-        return flag;
+        return true;
+
+    }
+
+    bool forEachValuedPositionInRange(size_type i1, size_type i2, size_type j1, size_type j2, const std::function<bool(size_type, size_type, elem_type)>& visitor) const override {
+        return forEachInRange(i1, i2, j1, j2, [&](size_type k) { return visitor(positions_[k].first, positions_[k].second, true); });
+    }
 
+    bool containsElement(size_type i1, size_type i2, size_type j1, size_type j2) const override {
+        return !forEachInRange(i1, i2, j1, j2, [](size_type) { return false; });
     }
 
-    size_type countElements() override {
+    size_type countElements() const override {
         return length_;
     }
 
+    size_type countElementsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
+
+        size_type cnt = 0;
+        forEachInRange(i1, i2, j1, j2, [&cnt](size_type) {
+            cnt++;
+            return true;
+        });
+
+        return cnt;
+
+    }
+
 
     MiniK2Tree* clone() const override {
         return new MiniK2Tree<elem_type>(*this);
     }
 
-    void print(bool all = false) override {
+    void print(bool all = false) const override {
 
         std::cout << "### Parameters ###" << std::endl;
         std::cout << "numRows  = " << getNumRows() << std::endl;
@@ -873,49 +1057,86 @@ public:
 
     }
 
+    void serialize(std::ostream& out) const override {
+
+        writeHeader(out, "MiniK2Tree<bool>", sizeof(elem_type));
+
+        writeValue(out, length_);
+
+        writeArray(out, positions_, length_);
+
+    }
+
+    void load(std::istream& in) override {
+
+        this->checkWritable("load");
+
+        readHeader(in, "MiniK2Tree<bool>", sizeof(elem_type));
+
+        delete[] positions_;
+
+        readValue(in, length_);
+
+        positions_ = new std::pair<size_type, size_type>[length_];
+        readArray(in, positions_, length_);
+
+        // older streams do not necessarily contain the relation pairs in sorted order
+        if (!std::is_sorted(positions_, positions_ + length_)) {
+            std::sort(positions_, positions_ + length_);
+        }
+        buildColumnOrder();
+
+    }
+
     // note: can "invalidate" the data structure (containsLink() probably won't work correctly afterwards)
     void setNull(size_type i, size_type j) override {
 
-        auto iter = std::find_if(positions_, positions_ + length_,
-                                 [i, j](const std::pair<size_type, size_type>& val) {
-                                     return val.first == i && val.second == j;
-                                 });
+        this->checkWritable("setNull");
+
+        size_type idx = indexOf(i, j);
 
-        if (iter != positions_ + length_) {
+        if (idx != length_) {
 
             std::pair<size_type, size_type>* tmpPos = new std::pair<size_type, size_type>[length_ - 1];
 
             size_type pos = 0;
-            std::pair<size_type, size_type>* p;
-            for (p = positions_; p != positions_ + length_; p++) {
+            for (size_type k = 0; k < length_; k++) {
 
-                if (p != iter) {
+                if (k != idx) {
 
-                    tmpPos[pos] = *p;
+                    tmpPos[pos] = positions_[k];
                     pos++;
 
                 }
 
             }
 
-            delete positions_;
+            delete[] positions_;
             positions_ = tmpPos;
             length_--;
 
+            buildColumnOrder();
+
         }
 
     }
 
-    size_type getFirstSuccessor(size_type i) override {
+    SizeBreakdown sizeInBytes() const override {
 
-        size_type min = getNumCols();
-        for (size_type k = 0; k < length_; k++) {
-            if (positions_[k].first == i) {
-                min = std::min(min, positions_[k].second);
-            }
-        }
+        SizeBreakdown s;
+        s.miniTrees = length_ * sizeof(std::pair<size_type, size_type>);
+        s.aux = vectorBytes(colOrder_);
+        s.other = sizeof(*this);
+
+        return s;
+
+    }
 
-        return min;
+    size_type getFirstSuccessor(size_type i) const override {
+
+        size_type k = lowerBound(i, 0);
+
+        return (k < length_ && positions_[k].first == i) ? positions_[k].second : getNumCols();
 
     }
 
@@ -924,27 +1145,27 @@ public:
      * Method aliases using "relation nomenclature" (similar to the names proposed by Brisaboa et al.)
      */
 
-    bool areRelated(size_type i, size_type j) override {
+    bool areRelated(size_type i, size_type j) const override {
         return isNotNull(i, j);
     }
 
-    std::vector<size_type> getSuccessors(size_type i) override {
+    std::vector<size_type> getSuccessors(size_type i) const override {
         return getSuccessorPositions(i);
     }
 
-    std::vector<size_type> getPredecessors(size_type j) override {
+    std::vector<size_type> getPredecessors(size_type j) const override {
         return getPredecessorPositions(j);
     }
 
-    positions_type getRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    positions_type getRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
         return getPositionsInRange(i1, i2, j1, j2);
     }
 
-    bool containsLink(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    bool containsLink(size_type i1, size_type i2, size_type j1, size_type j2) const override {
         return containsElement(i1, i2, j1, j2);
     }
 
-    size_type countLinks() override {
+    size_type countLinks() const override {
         return countElements();
     }
 
@@ -954,6 +1175,67 @@ private:
     std::pair<size_type, size_type>* positions_; // positions of all relation pairs
     size_type length_; // number of relation pairs
 
+    std::vector<size_type> colOrder_; // indices of all relation pairs sorted by column and row (for predecessor queries)
+
+
+    // returns the index of the first relation pair at or after position (i, j) in row-major order
+    size_type lowerBound(size_type i, size_type j) const {
+        return std::lower_bound(positions_, positions_ + length_, std::make_pair(i, j)) - positions_;
+    }
+
+    // returns the index of the relation pair at position (i, j) or length_ if there is none
+    size_type indexOf(size_type i, size_type j) const {
+
+        size_type k = lowerBound(i, j);
+
+        return (k < length_ && positions_[k].first == i && positions_[k].second == j) ? k : length_;
+
+    }
+
+    // returns the first index x such that the relation pair colOrder_[x] lies in column j or behind it
+    size_type columnLowerBound(size_type j) const {
+        return std::lower_bound(colOrder_.begin(), colOrder_.end(), j, [this](const size_type k, const size_type col) { return positions_[k].second < col; }) - colOrder_.begin();
+    }
+
+    // calls f(k) for all relation pairs k in [i1, i2] x [j1, j2] (in row-major order) until it returns false
+    // and returns whether it never did; the columns outside [j1, j2] are skipped row by row via binary search
+    template<typename F>
+    bool forEachInRange(size_type i1, size_type i2, size_type j1, size_type j2, F f) const {
+
+        size_type k = lowerBound(i1, j1);
+        while (k < length_ && positions_[k].first <= i2) {
+
+            if (positions_[k].second < j1) {
+                k = lowerBound(positions_[k].first, j1);
+            } else if (positions_[k].second > j2) {
+                k = lowerBound(positions_[k].first + 1, j1);
+            } else {
+
+                if (!f(k)) {
+                    return false;
+                }
+                k++;
+
+            }
+
+        }
+
+        return true;
+
+    }
+
+    // computes colOrder_ from the relation pairs, which have to be sorted by row and column already
+    void buildColumnOrder() {
+
+        colOrder_.resize(length_);
+        for (size_type k = 0; k < length_; k++) {
+            colOrder_[k] = k;
+        }
+
+        std::stable_sort(colOrder_.begin(), colOrder_.end(), [this](const size_type a, const size_type b) { return positions_[a].second < positions_[b].second; });
+
+    }
+
 };
 
 #endif //K2TREES_STATICMINIK2TREE_HPP
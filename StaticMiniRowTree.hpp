@@ -30,7 +30,7 @@
 /**
  * Naive implementation of a universe subset with a RowTree interface for very small subsets.
  *
- * Simply contains a list of the elements.
+ * Simply contains a list of the elements (sorted by position), which is searched via binary search.
  */
 template<typename E>
 class MiniRowTree : public virtual RowTree<E> {
@@ -42,7 +42,11 @@ public:
 
 
     MiniRowTree() {
-        // nothing to do
+
+        positions_ = 0;
+        values_ = 0;
+        length_ = 0;
+
     }
 
     MiniRowTree(const MiniRowTree& other) {
@@ -68,8 +72,8 @@ public:
             return *this;
         }
 
-        delete positions_;
-        delete values_;
+        delete[] positions_;
+        delete[] values_;
 
         null_ = other.null_;
 
@@ -132,85 +136,81 @@ public:
 
         }
 
+        sortPositions();
+
     }
 
     ~MiniRowTree() {
 
-        delete positions_;
-        delete values_;
+        delete[] positions_;
+        delete[] values_;
 
     }
 
 
-    size_type getLength() override {
+    size_type getLength() const override {
         return length_;
     }
 
-    elem_type getNull() override {
+    elem_type getNull() const override {
         return null_;
     }
 
 
-    bool isNotNull(size_type i) override {
-        return std::find(positions_, positions_ + length_, i) != positions_ + length_;
+    bool isNotNull(size_type i) const override {
+        return indexOf(i) != length_;
     }
 
-    elem_type getElement(size_type i) override {
+    elem_type getElement(size_type i) const override {
 
-        auto iter = std::find(positions_, positions_ + length_, i);
+        size_type k = indexOf(i);
 
-        return (iter != positions_ + length_) ? values_[iter - positions_] : null_;
+        return (k != length_) ? values_[k] : null_;
 
     }
 
-    std::vector<elem_type> getElementsInRange(size_type l, size_type r) override {
+    std::vector<elem_type> getElementsInRange(size_type l, size_type r) const override {
 
         std::vector<elem_type> elems;
-        for (size_type i = 0; i < length_; i++) {
-            if (l <= positions_[i] && positions_[i] <= r) {
-                elems.push_back(values_[i]);
-            }
+        for (size_type i = lowerBound(l); i < length_ && positions_[i] <= r; i++) {
+            elems.push_back(values_[i]);
         }
 
         return elems;
 
     }
 
-    std::vector<size_type> getPositionsInRange(size_type l, size_type r) override {
+    std::vector<size_type> getPositionsInRange(size_type l, size_type r) const override {
 
         std::vector<size_type> positions;
-        for (size_type i = 0; i < length_; i++) {
-            if (l <= positions_[i] && positions_[i] <= r) {
-                positions.push_back(positions_[i]);
-            }
+        for (size_type i = lowerBound(l); i < length_ && positions_[i] <= r; i++) {
+            positions.push_back(positions_[i]);
         }
 
         return positions;
 
     }
 
-    list_type getValuedPositionsInRange(size_type l, size_type r) override {
+    list_type getValuedPositionsInRange(size_type l, size_type r) const override {
 
         list_type positions;
-        for (size_type i = 0; i < length_; i++) {
-            if (l <= positions_[i] && positions_[i] <= r) {
-                positions.push_back(std::make_pair(positions_[i], values_[i]));
-            }
+        for (size_type i = lowerBound(l); i < length_ && positions_[i] <= r; i++) {
+            positions.push_back(std::make_pair(positions_[i], values_[i]));
         }
 
         return positions;
 
     }
 
-    std::vector<elem_type> getAllElements() override {
+    std::vector<elem_type> getAllElements() const override {
         return std::vector<elem_type>(values_, values_ + length_);
     }
 
-    std::vector<size_type> getAllPositions() override {
+    std::vector<size_type> getAllPositions() const override {
         return std::vector<size_type>(positions_, positions_ + length_);
     }
 
-    list_type getAllValuedPositions() override {
+    list_type getAllValuedPositions() const override {
 
         std::vector<std::pair<size_type, elem_type>> positions;
         for (size_type i = 0; i < length_; i++) {
@@ -221,18 +221,15 @@ public:
 
     }
 
-    bool containsElement(size_type l, size_type r) override {
+    bool containsElement(size_type l, size_type r) const override {
 
-        bool flag = false;
-        for (auto i = 0; i < length_ && !flag; i++) {
-            flag = l <= positions_[i] && positions_[i] <= r;
-        }
+        size_type i = lowerBound(l);
 
-        return flag;
+        return i < length_ && positions_[i] <= r;
 
     }
 
-    size_type countElements() override {
+    size_type countElements() const override {
         return length_;
     }
 
@@ -241,7 +238,7 @@ public:
         return new MiniRowTree<elem_type>(*this);
     }
 
-    void print(bool all = false) override {
+    void print(bool all = false) const override {
 
         std::cout << "### Parameters ###" << std::endl;
         std::cout << "length  = " << length_ << std::endl;
@@ -261,32 +258,68 @@ public:
 
     }
 
+    void serialize(std::ostream& out) const override {
+
+        writeHeader(out, "MiniRowTree", sizeof(elem_type));
+
+        writeValue(out, length_);
+        writeValue(out, null_);
+
+        writeArray(out, positions_, length_);
+        writeArray(out, values_, length_);
+
+    }
+
+    void load(std::istream& in) override {
+
+        this->checkWritable("load");
+
+        readHeader(in, "MiniRowTree", sizeof(elem_type));
+
+        delete[] positions_;
+        delete[] values_;
+
+        readValue(in, length_);
+        readValue(in, null_);
+
+        positions_ = new size_type[length_];
+        values_ = new elem_type[length_];
+        readArray(in, positions_, length_);
+        readArray(in, values_, length_);
+
+        // older streams do not necessarily contain the elements in sorted order
+        if (!std::is_sorted(positions_, positions_ + length_)) {
+            sortPositions();
+        }
+
+    }
+
     void setNull(size_type i) override {
 
-        auto iter = std::find(positions_, positions_ + length_, i);
+        this->checkWritable("setNull");
+
+        size_type idx = indexOf(i);
 
-        if (iter != positions_ + length_) {
+        if (idx != length_) {
 
             size_type* tmpPos = new size_type[length_ - 1];
             elem_type* tmpVal = new elem_type[length_ - 1];
 
             size_type pos = 0;
-            size_type* p;
-            elem_type* v;
-            for (p = positions_, v = values_; p != positions_ + length_; p++, v++) {
+            for (size_type k = 0; k < length_; k++) {
 
-                if (p != iter) {
+                if (k != idx) {
 
-                    tmpPos[pos] = *p;
-                    tmpVal[pos] = *v;
+                    tmpPos[pos] = positions_[k];
+                    tmpVal[pos] = values_[k];
                     pos++;
 
                 }
 
             }
 
-            delete positions_;
-            delete values_;
+            delete[] positions_;
+            delete[] values_;
             positions_ = tmpPos;
             values_ = tmpVal;
             length_--;
@@ -295,15 +328,18 @@ public:
 
     }
 
-    size_type getFirst() override {
+    SizeBreakdown sizeInBytes() const override {
 
-        size_type min = -1;
-        for (auto i = 0; i < length_; i++) {
-            min = std::min(min, positions_[i]);
-        }
+        SizeBreakdown s;
+        s.miniTrees = length_ * (sizeof(size_type) + sizeof(elem_type));
+        s.other = sizeof(*this);
+
+        return s;
 
-        return min;
+    }
 
+    size_type getFirst() const override {
+        return (length_ == 0) ? size_type(-1) : positions_[0];
     }
 
 
@@ -315,6 +351,40 @@ private:
     size_type length_; // number of elements
     elem_type null_; // null element
 
+
+    // returns the index of the first element at or after position i
+    size_type lowerBound(size_type i) const {
+        return std::lower_bound(positions_, positions_ + length_, i) - positions_;
+    }
+
+    // returns the index of the element at position i or length_ if there is none
+    size_type indexOf(size_type i) const {
+
+        size_type k = lowerBound(i);
+
+        return (k < length_ && positions_[k] == i) ? k : length_;
+
+    }
+
+    // sorts the elements by position
+    void sortPositions() {
+
+        std::vector<size_type> perm(length_);
+        for (size_type k = 0; k < length_; k++) {
+            perm[k] = k;
+        }
+
+        std::sort(perm.begin(), perm.end(), [this](const size_type a, const size_type b) { return positions_[a] < positions_[b]; });
+
+        std::vector<size_type> tmpPos(positions_, positions_ + length_);
+        std::vector<elem_type> tmpVal(values_, values_ + length_);
+        for (size_type k = 0; k < length_; k++) {
+            positions_[k] = tmpPos[perm[k]];
+            values_[k] = tmpVal[perm[k]];
+        }
+
+    }
+
 };
 
 
@@ -334,7 +404,10 @@ public:
 
 
     MiniRowTree() {
-        // nothing to do
+
+        positions_ = 0;
+        length_ = 0;
+
     }
 
     MiniRowTree(const MiniRowTree& other) {
@@ -373,20 +446,11 @@ public:
      */
     MiniRowTree(const bit_vector_type& v) {
 
-        length_ = 0;
-        for (size_type i = 0; i < v.size(); i++) {
-            length_ += v[i];
-        }
-
+        length_ = countBits(v, 0, v.size());
         positions_ = new size_type[length_];
 
-        for (size_type i = 0, pos = 0; i < v.size(); i++) {
-
-            if (v[i]) {
-                positions_[pos++] = i;
-            }
-
-        }
+        size_type pos = 0;
+        forEachSetBit(v, 0, v.size(), [&](size_type i) { positions_[pos++] = i; return true; });
 
     }
 
@@ -402,6 +466,8 @@ public:
             positions_[i] = list[i];
         }
 
+        std::sort(positions_, positions_ + length_);
+
     }
 
     /**
@@ -417,77 +483,73 @@ public:
             positions_[i] = iter->second;
         }
 
+        std::sort(positions_, positions_ + length_);
+
     }
 
     ~MiniRowTree() {
-        delete positions_;
+        delete[] positions_;
     }
 
-    size_type getLength() override {
+    size_type getLength() const override {
         return length_;
     }
 
-    elem_type getNull() override {
+    elem_type getNull() const override {
         return false;
     }
 
 
-    bool isNotNull(size_type i) override {
-        return std::find(positions_, positions_ + length_, i) != positions_ + length_;
+    bool isNotNull(size_type i) const override {
+        return indexOf(i) != length_;
     }
 
-    elem_type getElement(size_type i) override {
-        return std::find(positions_, positions_ + length_, i) != positions_ + length_;
+    elem_type getElement(size_type i) const override {
+        return indexOf(i) != length_;
     }
 
-    std::vector<elem_type> getElementsInRange(size_type l, size_type r) override {
+    std::vector<elem_type> getElementsInRange(size_type l, size_type r) const override {
 
         std::vector<elem_type> elems;
-        for (size_type i = 0; i < length_; i++) {
-            if (l <= positions_[i] && positions_[i] <= r) {
-                elems.push_back(true);
-            }
+        for (size_type i = lowerBound(l); i < length_ && positions_[i] <= r; i++) {
+            elems.push_back(true);
         }
 
         return elems;
 
     }
 
-    std::vector<size_type> getPositionsInRange(size_type l, size_type r) override {
+    std::vector<size_type> getPositionsInRange(size_type l, size_type r) const override {
 
         std::vector<size_type> positions;
-        for (size_type i = 0; i < length_; i++) {
-            if (l <= positions_[i] && positions_[i] <= r) {
-                positions.push_back(positions_[i]);
-            }
+        for (size_type i = lowerBound(l); i < length_ && positions_[i] <= r; i++) {
+            positions.push_back(positions_[i]);
         }
 
         return positions;
 
     }
 
-    std::vector<std::pair<size_type, elem_type>> getValuedPositionsInRange(size_type l, size_type r) override {
+    std::vector<std::pair<size_type, elem_type>> getValuedPositionsInRange(size_type l, size_type r) const override {
 
         std::vector<std::pair<size_type, elem_type>> positions;
-        for (size_type i = 0; i < length_; i++) {
-            if (l <= positions_[i] && positions_[i] <= r) {
-                positions.push_back(std::make_pair(positions_[i], true));
-            }
+        for (size_type i = lowerBound(l); i < length_ && positions_[i] <= r; i++) {
+            positions.push_back(std::make_pair(positions_[i], true));
         }
 
         return positions;
 
     }
 
-    std::vector<elem_type> getAllElements() override {
+    std::vector<elem_type> getAllElements() const override {
         return std::vector<elem_type>(length_, true);
     }
 
-    std::vector<size_type> getAllPositions() override {
+    std::vector<size_type> getAllPositions() const override {
         return std::vector<size_type>(positions_, positions_ + length_);
     }
 
-    std::vector<std::pair<size_type, elem_type>> getAllValuedPositions() override {
+    std::vector<std::pair<size_type, elem_type>> getAllValuedPositions() const override {
 
         std::vector<std::pair<size_type, elem_type>> positions;
         for (size_type i = 0; i < length_; i++) {
@@ -498,18 +560,15 @@ public:
 
     }
 
-    bool containsElement(size_type l, size_type r) override {
+    bool containsElement(size_type l, size_type r) const override {
 
-        bool flag = false;
-        for (auto i = 0; i < length_ && !flag; i++) {
-            flag = l <= positions_[i] && positions_[i] <= r;
-        }
+        size_type i = lowerBound(l);
 
-        return flag;
+        return i < length_ && positions_[i] <= r;
 
     }
 
-    size_type countElements() override {
+    size_type countElements() const override {
         return length_;
     }
 
@@ -518,7 +577,7 @@ public:
         return new MiniRowTree<elem_type>(*this);
     }
 
-    void print(bool all = false) override {
+    void print(bool all = false) const override {
 
         std::cout << "### Parameters ###" << std::endl;
         std::cout << "length  = " << length_ << std::endl;
@@ -534,24 +593,56 @@ public:
 
     }
 
+    void serialize(std::ostream& out) const override {
+
+        writeHeader(out, "MiniRowTree<bool>", sizeof(elem_type));
+
+        writeValue(out, length_);
+
+        writeArray(out, positions_, length_);
+
+    }
+
+    void load(std::istream& in) override {
+
+        this->checkWritable("load");
+
+        readHeader(in, "MiniRowTree<bool>", sizeof(elem_type));
+
+        delete[] positions_;
+
+        readValue(in, length_);
+
+        positions_ = new size_type[length_];
+        readArray(in, positions_, length_);
+
+        // older streams do not necessarily contain the elements in sorted order
+        if (!std::is_sorted(positions_, positions_ + length_)) {
+            std::sort(positions_, positions_ + length_);
+        }
+
+    }
+
     void setNull(size_type i) override {
 
-        auto iter = std::find(positions_, positions_ + length_, i);
+        this->checkWritable("setNull");
+
+        size_type idx = indexOf(i);
 
-        if (iter != positions_ + length_) {
+        if (idx != length_) {
 
             size_type* tmp = new size_type[length_ - 1];
 
             size_type pos = 0;
-            for (size_type* p = positions_; p != positions_ + length_; p++) {
+            for (size_type k = 0; k < length_; k++) {
 
-                if (p != iter) {
-                    tmp[pos++] = *p;
+                if (k != idx) {
+                    tmp[pos++] = positions_[k];
                 }
 
             }
 
-            delete positions_;
+            delete[] positions_;
             positions_ = tmp;
             length_--;
 
@@ -559,23 +650,40 @@ public:
 
     }
 
-    size_type getFirst() override {
+    SizeBreakdown sizeInBytes() const override {
 
-        size_type min = -1;
-        for (auto i = 0; i < length_; i++) {
-            min = std::min(min, positions_[i]);
-        }
+        SizeBreakdown s;
+        s.miniTrees = length_ * sizeof(size_type);
+        s.other = sizeof(*this);
 
-        return min;
+        return s;
 
     }
 
+    size_type getFirst() const override {
+        return (length_ == 0) ? size_type(-1) : positions_[0];
+    }
+
 
 
 private:
     size_type length_; // number of elements
     size_type* positions_; // positions of all elements
 
+
+    // returns the index of the first element at or after position i
+    size_type lowerBound(size_type i) const {
+        return std::lower_bound(positions_, positions_ + length_, i) - positions_;
+    }
+
+    // returns the index of the element at position i or length_ if there is none
+    size_type indexOf(size_type i) const {
+
+        size_type k = lowerBound(i);
+
+        return (k < length_ && positions_[k] == i) ? k : length_;
+
+    }
 };
 
 #endif //K2TREES_MINIBASICROWTREE_HPP
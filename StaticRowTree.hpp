@@ -57,6 +57,7 @@ public:
         T_ = other.T_;
         L_ = other.L_;
         R_ = rank_type(&T_);
+        emptyNodes_ = other.emptyNodes_;
 
     }
 
@@ -75,6 +76,7 @@ public:
         T_ = other.T_;
         L_ = other.L_;
         R_ = rank_type(&T_);
+        emptyNodes_ = other.emptyNodes_;
 
         return *this;
 
@@ -216,33 +218,33 @@ public:
 
 
     // returns the height of the RowTree
-    size_type getH() {
+    size_type getH() const {
         return h_;
     }
 
     // returns the arity of the RowTree
-    size_type getK() {
+    size_type getK() const {
         return k_;
     }
 
-    size_type getLength() override {
+    size_type getLength() const override {
         return nPrime_;
     }
 
-    elem_type getNull() override {
+    elem_type getNull() const override {
         return null_;
     }
 
 
-    bool isNotNull(size_type i) override {
+    bool isNotNull(size_type i) const override {
         return checkInit(i);
     }
 
-    elem_type getElement(size_type i) override {
+    elem_type getElement(size_type i) const override {
         return getInit(i);
     }
 
-    std::vector<elem_type> getElementsInRange(size_type l, size_type r) override {
+    std::vector<elem_type> getElementsInRange(size_type l, size_type r) const override {
 
         std::vector<elem_type> elems;
         rangeElemInit(elems, l, r);
@@ -252,7 +254,7 @@ public:
 
     }
 
-    std::vector<size_type> getPositionsInRange(size_type l, size_type r) override {
+    std::vector<size_type> getPositionsInRange(size_type l, size_type r) const override {
 
         std::vector<size_type> positions;
         rangePosInit(positions, l, r);
@@ -262,7 +264,7 @@ public:
 
     }
 
-    list_type getValuedPositionsInRange(size_type l, size_type r) override {
+    list_type getValuedPositionsInRange(size_type l, size_type r) const override {
 
         list_type positions;
         rangeValPosInit(positions, l, r);
@@ -272,7 +274,7 @@ public:
 
     }
 
-    std::vector<elem_type> getAllElements() override {
+    std::vector<elem_type> getAllElements() const override {
 //        return getElementsInRange(0, nPrime_ - 1);
         std::vector<elem_type> elements;
         fullRangeElemIterative(elements);
@@ -280,7 +282,7 @@ public:
 
     }
 
-    std::vector<size_type> getAllPositions() override {
+    std::vector<size_type> getAllPositions() const override {
 //        return getPositionsInRange(0, nPrime_ - 1);
         std::vector<size_type> positions;
         fullRangePosIterative(positions);
@@ -288,7 +290,7 @@ public:
 
     }
 
-    list_type getAllValuedPositions() override {
+    list_type getAllValuedPositions() const override {
 //        return getValuedPositionsInRange(0, nPrime_ - 1);
         list_type positions;
         fullRangeValPosIterative(positions);
@@ -296,16 +298,16 @@ public:
 
     }
 
-    bool containsElement(size_type l, size_type r) override {
+    bool containsElement(size_type l, size_type r) const override {
         return elemInRangeInit(l, r);
 //        return elemInRangeInit(l, std::min(r, nPrime_ - 1));
     }
 
-    size_type countElements() override {
+    size_type countElements() const override {
 
         size_type res = 0;
         for (auto i = 0; i < L_.size(); i++) {
-            res += (L_[i] != null_);
+            res += (leaf(i) != null_);
         }
 
         return res;
@@ -317,7 +319,7 @@ public:
         return new BasicRowTree<elem_type>(*this);
     }
 
-    void print(bool all = false) override {
+    void print(bool all = false) const override {
 
         std::cout << "### Parameters ###" << std::endl;
         std::cout << "h  = " << h_ << std::endl;
@@ -343,12 +345,88 @@ public:
 
     }
 
-    // note: can "invalidate" the data structure (containsElement() probably won't work correctly afterwards)
+    void serialize(std::ostream& out) const override {
+
+        writeHeader(out, "BasicRowTree", sizeof(elem_type));
+
+        writeValue(out, h_);
+        writeValue(out, k_);
+        writeValue(out, nPrime_);
+        writeValue(out, null_);
+
+        T_.serialize(out);
+        writeVector(out, L_);
+        R_.serialize(out);
+        emptyNodes_.serialize(out);
+
+    }
+
+    void load(std::istream& in) override {
+
+        this->checkWritable("load");
+
+        unsigned int version = readHeader(in, "BasicRowTree", sizeof(elem_type));
+
+        readValue(in, h_);
+        readValue(in, k_);
+        readValue(in, nPrime_);
+        readValue(in, null_);
+
+        T_.load(in);
+        readVector(in, L_);
+        R_.load(in, &T_);
+        if (version >= 4) {
+            emptyNodes_.load(in);
+        } else {
+            emptyNodes_ = bit_vector_type();
+        }
+
+    }
+
+    // note: emptied subtrees are only marked, compact() removes them from the internal structure
     void setNull(size_type i) override {
+        this->checkWritable("setNull");
         setInit(i);
     }
 
-    size_type getFirst() override {
+    // rebuilds the internal structure from the remaining elements, so that the subtrees emptied by setNull() are removed
+    // (the size of the universe remains unchanged)
+    void compact() override {
+
+        this->checkWritable("compact");
+
+        if (emptyNodes_.empty()) {
+            return;
+        }
+
+        list_type pairs = getAllValuedPositions();
+
+        T_ = bit_vector_type();
+        L_.clear();
+        emptyNodes_ = bit_vector_type();
+
+        if (!pairs.empty()) {
+            buildFromListsInplace(pairs);
+        }
+
+        R_ = rank_type(&T_);
+
+    }
+
+    SizeBreakdown sizeInBytes() const override {
+
+        SizeBreakdown s;
+        s.T = sdsl::size_in_bytes(T_);
+        s.L = vectorBytes(L_);
+        s.rank = sdsl::size_in_bytes(R_);
+        s.aux = sdsl::size_in_bytes(emptyNodes_);
+        s.other = sizeof(*this);
+
+        return s;
+
+    }
+
+    size_type getFirst() const override {
 //        return getFirstInit();
         return getFirstIterative();
     }
@@ -357,7 +435,7 @@ public:
 
 private:
     // representation of all but the last levels of the RowTree (internal structure)
-    bit_vector_type T_;
+    level_vector_type T_;
 
     // representation of the last level of the RowTree (actual values of the universe)
     std::vector<elem_type> L_;
@@ -365,6 +443,9 @@ private:
     // rank data structure for navigation in T_
     rank_type R_;
 
+    // marks the internal nodes whose subtrees have been emptied by setNull() (empty if there are none), see compact()
+    bit_vector_type emptyNodes_;
+
     size_type k_; // arity of the RowTree
     size_type h_; // height of the RowTree
     size_type nPrime_; // size of the represented universe
@@ -556,15 +637,19 @@ private:
 
         } else {
 
-            std::vector<bool> T;
-            NaiveDynamicRank R;
+            DynamicVector<bool> T;
+            DynamicVector<elem_type> L;
+            DynamicRank R;
 
             for (auto j = 0; j < list.size(); j++) {
-                insertInit(T, R, list[j].first, list[j].second);
+                insertInit(T, L, R, list[j].first, list[j].second);
             }
 
+            L_ = std::vector<elem_type>(L.size());
+            L.copyTo(L_.begin());
+
             T_ = bit_vector_type(T.size());
-            std::move(T.begin(), T.end(), T_.begin());
+            T.copyTo(T_.begin());
 
         }
 
@@ -572,20 +657,20 @@ private:
 
     }
 
-    void insertInit(std::vector<bool>& T, NaiveDynamicRank& R, size_type q, elem_type val) {
+    void insertInit(DynamicVector<bool>& T, DynamicVector<elem_type>& L, DynamicRank& R, size_type q, elem_type val) {
 
         if (T.empty()) {
 
-            T = std::vector<bool>(k_);
-            R = NaiveDynamicRank(T);
+            T = DynamicVector<bool>(k_, false);
+            R = DynamicRank(std::vector<bool>(k_));
 
         }
 
-        insert(T, R, nPrime_ / k_, q % (nPrime_ / k_), val, q / (nPrime_ / k_), 1);
+        insert(T, L, R, nPrime_ / k_, q % (nPrime_ / k_), val, q / (nPrime_ / k_), 1);
 
     }
 
-    void insert(std::vector<bool>& T, NaiveDynamicRank& R, size_type n, size_type q, elem_type val, size_type z, size_type l) {
+    void insert(DynamicVector<bool>& T, DynamicVector<elem_type>& L, DynamicRank& R, size_type n, size_type q, elem_type val, size_type z, size_type l) {
 
         if (!T[z]) {
 
@@ -596,26 +681,26 @@ private:
 
             if ((l + 1) == h_) {
 
-                L_.insert(L_.begin() + R.rank(z + 1) * k_ - T.size(), k_, null_);
-                L_[y - T.size()] = val;
+                L.insert(R.rank(z + 1) * k_ - T.size(), k_, null_);
+                L[y - T.size()] = val;
 
             } else {
 
-                T.insert(T.begin() + R.rank(z + 1) * k_, k_, null_);
+                T.insert(R.rank(z + 1) * k_, k_, null_);
                 R.insert(R.rank(z + 1) * k_ + 1, k_);
 
-                insert(T, R, n / k_, q % (n / k_), val, y, l + 1);
+                insert(T, L, R, n / k_, q % (n / k_), val, y, l + 1);
 
             }
 
         } else {
 
-            size_type y = R.rank(z) * k_ + q / (n / k_);
+            size_type y = R.rank(z + 1) * k_ + q / (n / k_);
 
             if ((l + 1) == h_) {
-                L_[y - T.size()] = val;
+                L[y - T.size()] = val;
             } else {
-                insert(T, R, n / k_, q % (n / k_), val, y, l + 1);
+                insert(T, L, R, n / k_, q % (n / k_), val, y, l + 1);
             }
 
         }
@@ -731,14 +816,14 @@ private:
 
     /* isNotNull() */
 
-    bool checkInit(size_type q) {
+    bool checkInit(size_type q) const {
         return (L_.empty()) ? false : check(nPrime_ / k_, q % (nPrime_ / k_), q / (nPrime_ / k_));
     }
 
-    bool check(size_type n, size_type q, size_type z) {
+    bool check(size_type n, size_type q, size_type z) const {
 
         if (z >= T_.size()) {
-            return (L_[z - T_.size()] != null_);
+            return (leaf(z - T_.size()) != null_);
         } else {
             return T_[z] ? check(n / k_, q % (n / k_), R_.rank(z + 1) * k_ + q / (n / k_)) : false;
         }
@@ -747,14 +832,14 @@ private:
 
     /* getElement() */
 
-    elem_type getInit(size_type q) {
+    elem_type getInit(size_type q) const {
         return (L_.empty()) ? null_ : get(nPrime_ / k_, q % (nPrime_ / k_), q / (nPrime_ / k_));
     }
 
-    elem_type get(size_type n, size_type q, size_type z) {
+    elem_type get(size_type n, size_type q, size_type z) const {
 
         if (z >= T_.size()) {
-            return L_[z - T_.size()];
+            return leaf(z - T_.size());
         } else {
             return T_[z] ? get(n / k_, q % (n / k_), R_.rank(z + 1) * k_ + q / (n / k_)) : null_;
         }
@@ -763,14 +848,14 @@ private:
 
     /* getFirst() */
 
-    size_type getFirstIterative() {
+    size_type getFirstIterative() const {
 
         if (L_.empty()) return nPrime_;
 
         if (T_.size() == 0) {
 
             for (size_type i = 0; i < nPrime_; i++) {
-                if (L_[i] != null_) {
+                if (leaf(i) != null_) {
                     return i;
                 }
             }
@@ -783,7 +868,7 @@ private:
 
             while (z < T_.size()) {
 
-                if (T_[z]) {
+                if (hasChildren(z)) {
 
                     n /= k_;
                     z = R_.rank(z + 1) * k_;
@@ -799,7 +884,7 @@ private:
 
             for (size_type offset = 0; offset < k_; offset++) {
 
-                if (L_[z - T_.size() + offset] != null_) {
+                if (leaf(z - T_.size() + offset) != null_) {
                     return dq + offset;
                 }
 
@@ -811,7 +896,7 @@ private:
 
     }
 
-    size_type getFirstInit() {
+    size_type getFirstInit() const {
 
         size_type pos = nPrime_;
 
@@ -833,19 +918,19 @@ private:
 
     }
 
-    size_type getFirst(size_type n, size_type l, size_type r, size_type dq, size_type z) {
+    size_type getFirst(size_type n, size_type l, size_type r, size_type dq, size_type z) const {
 
         size_type pos = nPrime_;
 
         if (z >= T_.size()) {
 
-            if (L_[z - T_.size()] != null_) {
+            if (leaf(z - T_.size()) != null_) {
                 pos = dq;
             }
 
         } else {
 
-            if (T_[z]) {
+            if (hasChildren(z)) {
 
                 auto y = R_.rank(z + 1) * k_;
 
@@ -869,7 +954,7 @@ private:
 
     /* getElementsInRange() */
 
-    void fullRangeElemIterative(std::vector<elem_type>& elems) {
+    void fullRangeElemIterative(std::vector<elem_type>& elems) const {
 
         if (L_.empty()) return;
 
@@ -879,8 +964,8 @@ private:
         if (lenT == 0) {
 
             for (size_type i = 0; i < nPrime_; i++) {
-                if (L_[i] != null_) {
-                    elems.push_back(L_[i]);
+                if (leaf(i) != null_) {
+                    elems.push_back(leaf(i));
                 }
             }
 
@@ -890,6 +975,7 @@ private:
             size_type n = nPrime_/ k_;
 
             for (size_type z = 0, dq = 0; z < k_; z++, dq += n) {
+                K2TREES_COUNT(queuePushes);
                 queue.push(SubrowInfo(dq, z));
             }
 
@@ -901,11 +987,12 @@ private:
 
                     auto& cur = queue.front();
 
-                    if (T_[cur.z]) {
+                    if (hasChildren(cur.z)) {
 
                         auto y = R_.rank(cur.z + 1) * k_;
 
                         for (size_type j = 0, newDq = cur.dq; j < k_; j++, newDq += n, y++) {
+                            K2TREES_COUNT(queuePushes);
                             nextLevelQueue.push(SubrowInfo(newDq, y));
                         }
 
@@ -923,13 +1010,13 @@ private:
 
                 auto& cur = queue.front();
 
-                if (T_[cur.z]) {
+                if (hasChildren(cur.z)) {
 
                     auto y = R_.rank(cur.z + 1) * k_ - lenT;
 
                     for (size_type j = 0, newDq = cur.dq; j < k_; j++, newDq += n, y++) {
-                        if (L_[y] != null_) {
-                            elems.push_back(L_[y]);
+                        if (leaf(y) != null_) {
+                            elems.push_back(leaf(y));
                         }
                     }
 
@@ -943,7 +1030,7 @@ private:
 
     }
 
-    void rangeElemInit(std::vector<elem_type>& elems, size_type l, size_type r) {
+    void rangeElemInit(std::vector<elem_type>& elems, size_type l, size_type r) const {
 
         if (!L_.empty()) {
 
@@ -962,17 +1049,17 @@ private:
 
     }
 
-    void rangeElem(std::vector<elem_type>& elems, size_type n, size_type l, size_type r, size_type dq, size_type z) {
+    void rangeElem(std::vector<elem_type>& elems, size_type n, size_type l, size_type r, size_type dq, size_type z) const {
 
         if (z >= T_.size()) {
 
-            if (L_[z - T_.size()] != null_) {
-                elems.push_back(L_[z - T_.size()]);
+            if (leaf(z - T_.size()) != null_) {
+                elems.push_back(leaf(z - T_.size()));
             }
 
         } else {
 
-            if (T_[z]) {
+            if (hasChildren(z)) {
 
                 auto y = R_.rank(z + 1) * k_;
 
@@ -996,7 +1083,7 @@ private:
 
     /* getPositionsInRange() */
 
-    void fullRangePosIterative(std::vector<size_type>& elems) {
+    void fullRangePosIterative(std::vector<size_type>& elems) const {
 
         if (L_.empty()) return;
 
@@ -1006,7 +1093,7 @@ private:
         if (lenT == 0) {
 
             for (size_type i = 0; i < nPrime_; i++) {
-                if (L_[i] != null_) {
+                if (leaf(i) != null_) {
                     elems.push_back(i);
                 }
             }
@@ -1017,6 +1104,7 @@ private:
             size_type n = nPrime_/ k_;
 
             for (size_type z = 0, dq = 0; z < k_; z++, dq += n) {
+                K2TREES_COUNT(queuePushes);
                 queue.push(SubrowInfo(dq, z));
             }
 
@@ -1028,11 +1116,12 @@ private:
 
                     auto& cur = queue.front();
 
-                    if (T_[cur.z]) {
+                    if (hasChildren(cur.z)) {
 
                         auto y = R_.rank(cur.z + 1) * k_;
 
                         for (size_type j = 0, newDq = cur.dq; j < k_; j++, newDq += n, y++) {
+                            K2TREES_COUNT(queuePushes);
                             nextLevelQueue.push(SubrowInfo(newDq, y));
                         }
 
@@ -1050,12 +1139,12 @@ private:
 
                 auto& cur = queue.front();
 
-                if (T_[cur.z]) {
+                if (hasChildren(cur.z)) {
 
                     auto y = R_.rank(cur.z + 1) * k_ - lenT;
 
                     for (size_type j = 0, newDq = cur.dq; j < k_; j++, newDq += n, y++) {
-                        if (L_[y] != null_) {
+                        if (leaf(y) != null_) {
                             elems.push_back(newDq);
                         }
                     }
@@ -1070,7 +1159,7 @@ private:
 
     }
 
-    void rangePosInit(std::vector<size_type>& elems, size_type l, size_type r) {
+    void rangePosInit(std::vector<size_type>& elems, size_type l, size_type r) const {
 
         if (!L_.empty()) {
 
@@ -1089,17 +1178,17 @@ private:
 
     }
 
-    void rangePos(std::vector<size_type>& elems, size_type n, size_type l, size_type r, size_type dq, size_type z) {
+    void rangePos(std::vector<size_type>& elems, size_type n, size_type l, size_type r, size_type dq, size_type z) const {
 
         if (z >= T_.size()) {
 
-            if (L_[z - T_.size()] != null_) {
+            if (leaf(z - T_.size()) != null_) {
                 elems.push_back(dq);
             }
 
         } else {
 
-            if (T_[z]) {
+            if (hasChildren(z)) {
 
                 auto y = R_.rank(z + 1) * k_;
 
@@ -1123,7 +1212,7 @@ private:
 
     /* getValuedPositionsInRange() */
 
-    void fullRangeValPosIterative(list_type& elems) {
+    void fullRangeValPosIterative(list_type& elems) const {
 
         if (L_.empty()) return;
 
@@ -1133,8 +1222,8 @@ private:
         if (lenT == 0) {
 
             for (size_type i = 0; i < nPrime_; i++) {
-                if (L_[i] != null_) {
-                    elems.push_back(std::make_pair(i, L_[i]));
+                if (leaf(i) != null_) {
+                    elems.push_back(std::make_pair(i, leaf(i)));
                 }
             }
 
@@ -1144,6 +1233,7 @@ private:
             size_type n = nPrime_/ k_;
 
             for (size_type z = 0, dq = 0; z < k_; z++, dq += n) {
+                K2TREES_COUNT(queuePushes);
                 queue.push(SubrowInfo(dq, z));
             }
 
@@ -1155,11 +1245,12 @@ private:
 
                     auto& cur = queue.front();
 
-                    if (T_[cur.z]) {
+                    if (hasChildren(cur.z)) {
 
                         auto y = R_.rank(cur.z + 1) * k_;
 
                         for (size_type j = 0, newDq = cur.dq; j < k_; j++, newDq += n, y++) {
+                            K2TREES_COUNT(queuePushes);
                             nextLevelQueue.push(SubrowInfo(newDq, y));
                         }
 
@@ -1177,13 +1268,13 @@ private:
 
                 auto& cur = queue.front();
 
-                if (T_[cur.z]) {
+                if (hasChildren(cur.z)) {
 
                     auto y = R_.rank(cur.z + 1) * k_ - lenT;
 
                     for (size_type j = 0, newDq = cur.dq; j < k_; j++, newDq += n, y++) {
-                        if (L_[y] != null_) {
-                            elems.push_back(std::make_pair(newDq, L_[y]));
+                        if (leaf(y) != null_) {
+                            elems.push_back(std::make_pair(newDq, leaf(y)));
                         }
                     }
 
@@ -1197,7 +1288,7 @@ private:
 
     }
 
-    void rangeValPosInit(list_type& elems, size_type l, size_type r) {
+    void rangeValPosInit(list_type& elems, size_type l, size_type r) const {
 
         if (!L_.empty()) {
 
@@ -1216,17 +1307,17 @@ private:
 
     }
 
-    void rangeValPos(list_type& elems, size_type n, size_type l, size_type r, size_type dq, size_type z) {
+    void rangeValPos(list_type& elems, size_type n, size_type l, size_type r, size_type dq, size_type z) const {
 
         if (z >= T_.size()) {
 
-            if (L_[z - T_.size()] != null_) {
-                elems.push_back(std::make_pair(dq, L_[z - T_.size()]));
+            if (leaf(z - T_.size()) != null_) {
+                elems.push_back(std::make_pair(dq, leaf(z - T_.size())));
             }
 
         } else {
 
-            if (T_[z]) {
+            if (hasChildren(z)) {
 
                 auto y = R_.rank(z + 1) * k_;
 
@@ -1249,14 +1340,10 @@ private:
 
     /* containsElement() */
 
-    bool elemInRangeInit(size_type l, size_type r) {
+    bool elemInRangeInit(size_type l, size_type r) const {
 
         if (!L_.empty()) {
 
-            if ((l == 0) && (r == (nPrime_ - 1))) {
-                return 1;
-            }
-
             for (auto j = l / (nPrime_ / k_); j <= r / (nPrime_ / k_); j++) {
 
                 if (elemInRange(nPrime_ / k_, (j == l / (nPrime_ / k_)) * (l % (nPrime_ / k_)), (j == r / (nPrime_ / k_)) ? r % (nPrime_ / k_) : nPrime_ / k_ - 1, j)) {
@@ -1271,15 +1358,15 @@ private:
 
     }
 
-    bool elemInRange(size_type n, size_type l, size_type r, size_type z) {
+    bool elemInRange(size_type n, size_type l, size_type r, size_type z) const {
 
         if (z >= T_.size()) {
 
-            return L_[z - T_.size()] != null_;
+            return leaf(z - T_.size()) != null_;
 
         } else {
 
-            if (T_[z]) {
+            if (hasChildren(z)) {
 
                 if ((l == 0) && (r == (n - 1))) {
                     return true;
@@ -1307,6 +1394,50 @@ private:
 
     /* getElement() */
 
+    /* helper methods for handling subtrees emptied by setNull() */
+
+    // returns the entry of the last level at position x
+    inline elem_type leaf(size_type x) const {
+
+        K2TREES_COUNT(leafProbes);
+        return L_[x];
+
+    }
+
+    // checks whether node z has children, i.e. whether its bit in T is set and its subtree has not been emptied by setNull()
+    inline bool hasChildren(size_type z) const {
+
+        K2TREES_COUNT(nodesVisited);
+        return T_[z] && (emptyNodes_.empty() || !emptyNodes_[z]);
+
+    }
+
+    // checks whether all len nodes of the block starting at position y are empty
+    bool isEmptyBlock(size_type y, size_type len) const {
+
+        for (size_type c = y; c < y + len; c++) {
+            if ((c >= T_.size()) ? (leaf(c - T_.size()) != null_) : hasChildren(c)) {
+                return false;
+            }
+        }
+
+        return true;
+
+    }
+
+    // marks the subtree of node z as empty
+    void markEmpty(size_type z) {
+
+        if (emptyNodes_.empty()) {
+            emptyNodes_ = bit_vector_type(T_.size(), 0);
+        }
+
+        emptyNodes_[z] = 1;
+
+    }
+
+    /* setNull() */
+
     void setInit(size_type q) {
 
         if (!L_.empty()) {
@@ -1315,14 +1446,35 @@ private:
 
     }
 
-    void set(size_type n, size_type q, size_type z) {
+    // clears the entry in the subtree of z, returns true iff the subtree is empty afterwards
+    bool set(size_type n, size_type q, size_type z) {
 
         if (z >= T_.size()) {
+
             L_[z - T_.size()] = null_;
+
+            return true;
+
         } else {
-            if (T_[z]) {
-                set(n / k_, q % (n / k_), R_.rank(z + 1) * k_ + q / (n / k_));
+
+            if (hasChildren(z)) {
+
+                size_type y = R_.rank(z + 1) * k_;
+
+                // mark z if its whole subtree has become empty
+                if (set(n / k_, q % (n / k_), y + q / (n / k_)) && isEmptyBlock(y, k_)) {
+
+                    markEmpty(z);
+                    return true;
+
+                }
+
+                return false;
+
             }
+
+            return true;
+
         }
 
     }
@@ -1359,6 +1511,7 @@ public:
         T_ = other.T_;
         L_ = other.L_;
         R_ = rank_type(&T_);
+        emptyNodes_ = other.emptyNodes_;
 
     }
 
@@ -1377,6 +1530,7 @@ public:
         T_ = other.T_;
         L_ = other.L_;
         R_ = rank_type(&T_);
+        emptyNodes_ = other.emptyNodes_;
 
         return *this;
 
@@ -1552,37 +1706,37 @@ public:
 
 
     // returns the height of the RowTree
-    size_type getH() {
+    size_type getH() const {
         return h_;
     }
 
     // returns the arity of the RowTree
-    size_type getK() {
+    size_type getK() const {
         return k_;
     }
 
-    size_type getLength() override {
+    size_type getLength() const override {
         return nPrime_;
     }
 
-    elem_type getNull() override {
+    elem_type getNull() const override {
         return null_;
     }
 
 
-    bool isNotNull(size_type i) override {
+    bool isNotNull(size_type i) const override {
         return checkInit(i);
     }
 
-    elem_type getElement(size_type i) override {
+    elem_type getElement(size_type i) const override {
         return isNotNull(i);
     }
 
-    std::vector<elem_type> getElementsInRange(size_type l, size_type r) override {
+    std::vector<elem_type> getElementsInRange(size_type l, size_type r) const override {
         return std::vector<elem_type>(getPositionsInRange(l, r).size(), 1);
     }
 
-    std::vector<size_type> getPositionsInRange(size_type l, size_type r) override {
+    std::vector<size_type> getPositionsInRange(size_type l, size_type r) const override {
 
         std::vector<size_type> positions;
         rangeInit(positions, l, r);
@@ -1592,7 +1746,7 @@ public:
 
     }
 
-    std::vector<std::pair<size_type, elem_type>> getValuedPositionsInRange(size_type l, size_type r) override {
+    std::vector<std::pair<size_type, elem_type>> getValuedPositionsInRange(size_type l, size_type r) const override {
 
         std::vector<size_type> positions;
         rangeInit(positions, l, r);
@@ -1607,11 +1761,11 @@ public:
 
     }
 
-    std::vector<elem_type> getAllElements() override {
+    std::vector<elem_type> getAllElements() const override {
         return std::vector<elem_type>(countElements(), 1);
     }
 
-    std::vector<size_type> getAllPositions() override {
+    std::vector<size_type> getAllPositions() const override {
 //        return getPositionsInRange(0, nPrime_ - 1);
         std::vector<size_type> positions;
         fullRangeIterative(positions);
@@ -1619,7 +1773,7 @@ public:
 
     }
 
-    std::vector<std::pair<size_type, elem_type>> getAllValuedPositions() override {
+    std::vector<std::pair<size_type, elem_type>> getAllValuedPositions() const override {
 //        return getValuedPositionsInRange(0, nPrime_ - 1);
         std::vector<std::pair<size_type, elem_type>> positions;
         fullRangeValPosIterative(positions);
@@ -1627,19 +1781,15 @@ public:
 
     }
 
-    bool containsElement(size_type l, size_type r) override {
+    bool containsElement(size_type l, size_type r) const override {
         return elemInRangeInit(l, r);
 //        return elemInRangeInit(l, std::min(r, nPrime_ - 1));
     }
 
-    size_type countElements() override {
+    size_type countElements() const override {
 
-        size_type res = 0;
-        for (auto i = 0; i < L_.size(); i++) {
-            res += L_[i];
-        }
-
-        return res;
+        K2TREES_COUNT(leafProbes);
+        return countBits(L_, 0, L_.size());
 
     }
 
@@ -1648,7 +1798,7 @@ public:
         return new BasicRowTree<elem_type>(*this);
     }
 
-    void print(bool all = false) override {
+    void print(bool all = false) const override {
 
         std::cout << "### Parameters ###" << std::endl;
         std::cout << "h  = " << h_ << std::endl;
@@ -1674,12 +1824,88 @@ public:
 
     }
 
-    // note: can "invalidate" the data structure (containsElement() probably won't work correctly afterwards)
+    void serialize(std::ostream& out) const override {
+
+        writeHeader(out, "BasicRowTree<bool>", sizeof(elem_type));
+
+        writeValue(out, h_);
+        writeValue(out, k_);
+        writeValue(out, nPrime_);
+        writeValue(out, null_);
+
+        T_.serialize(out);
+        L_.serialize(out);
+        R_.serialize(out);
+        emptyNodes_.serialize(out);
+
+    }
+
+    void load(std::istream& in) override {
+
+        this->checkWritable("load");
+
+        unsigned int version = readHeader(in, "BasicRowTree<bool>", sizeof(elem_type));
+
+        readValue(in, h_);
+        readValue(in, k_);
+        readValue(in, nPrime_);
+        readValue(in, null_);
+
+        T_.load(in);
+        L_.load(in);
+        R_.load(in, &T_);
+        if (version >= 4) {
+            emptyNodes_.load(in);
+        } else {
+            emptyNodes_ = bit_vector_type();
+        }
+
+    }
+
+    // note: emptied subtrees are only marked, compact() removes them from the internal structure
     void setNull(size_type i) override {
+        this->checkWritable("setNull");
         setInit(i);
     }
 
-    size_type getFirst() override {
+    // rebuilds the internal structure from the remaining elements, so that the subtrees emptied by setNull() are removed
+    // (the size of the universe remains unchanged)
+    void compact() override {
+
+        this->checkWritable("compact");
+
+        if (emptyNodes_.empty()) {
+            return;
+        }
+
+        list_type pairs = getAllPositions();
+
+        T_ = bit_vector_type();
+        L_ = bit_vector_type();
+        emptyNodes_ = bit_vector_type();
+
+        if (!pairs.empty()) {
+            buildFromListsInplace(pairs);
+        }
+
+        R_ = rank_type(&T_);
+
+    }
+
+    SizeBreakdown sizeInBytes() const override {
+
+        SizeBreakdown s;
+        s.T = sdsl::size_in_bytes(T_);
+        s.L = sdsl::size_in_bytes(L_);
+        s.rank = sdsl::size_in_bytes(R_);
+        s.aux = sdsl::size_in_bytes(emptyNodes_);
+        s.other = sizeof(*this);
+
+        return s;
+
+    }
+
+    size_type getFirst() const override {
 //        return getFirstInit();
         return getFirstIterative();
     }
@@ -1688,7 +1914,7 @@ public:
 
 private:
     // representation of all but the last levels of the RowTree (internal structure)
-    bit_vector_type T_;
+    level_vector_type T_;
 
     // representation of the last level of the RowTree (actual values of the universe)
     bit_vector_type L_;
@@ -1696,6 +1922,9 @@ private:
     // rank data structure for navigation in T_
     rank_type R_;
 
+    // marks the internal nodes whose subtrees have been emptied by setNull() (empty if there are none), see compact()
+    bit_vector_type emptyNodes_;
+
     size_type k_; // arity of the RowTree
     size_type h_; // height of the RowTree
     size_type nPrime_; // size of the represented universe
@@ -1868,20 +2097,18 @@ private:
 
         } else {
 
-            std::vector<bool> T, L;
-            NaiveDynamicRank R;
+            DynamicVector<bool> T, L;
+            DynamicRank R;
 
             for (auto j = 0; j < list.size(); j++) {
                 insertInit(T, L, R, list[j]);
             }
 
             L_ = bit_vector_type(L.size());
-            std::move(L.begin(), L.end(), L_.begin());
-            L.clear();
-            L.shrink_to_fit();
+            L.copyTo(L_.begin());
 
             T_ = bit_vector_type(T.size());
-            std::move(T.begin(), T.end(), T_.begin());
+            T.copyTo(T_.begin());
 
         }
 
@@ -1889,12 +2116,12 @@ private:
 
     }
 
-    void insertInit(std::vector<bool>& T, std::vector<bool>& L, NaiveDynamicRank& R, size_type q) {
+    void insertInit(DynamicVector<bool>& T, DynamicVector<bool>& L, DynamicRank& R, size_type q) {
 
         if (T.empty()) {
 
-            T = std::vector<bool>(k_);
-            R = NaiveDynamicRank(T);
+            T = DynamicVector<bool>(k_, false);
+            R = DynamicRank(std::vector<bool>(k_));
 
         }
 
@@ -1902,7 +2129,7 @@ private:
 
     }
 
-    void insert(std::vector<bool>& T, std::vector<bool>& L, NaiveDynamicRank& R, size_type n, size_type q, size_type z, size_type l) {
+    void insert(DynamicVector<bool>& T, DynamicVector<bool>& L, DynamicRank& R, size_type n, size_type q, size_type z, size_type l) {
 
         if (!T[z]) {
 
@@ -1913,12 +2140,12 @@ private:
 
             if ((l + 1) == h_) {
 
-                L.insert(L.begin() + R.rank(z + 1) * k_ - T.size(), k_, 0);
+                L.insert(R.rank(z + 1) * k_ - T.size(), k_, 0);
                 L[y - T.size()] = 1;
 
             } else {
 
-                T.insert(T.begin() + R.rank(z + 1) * k_, k_, 0);
+                T.insert(R.rank(z + 1) * k_, k_, 0);
                 R.insert(R.rank(z + 1) * k_ + 1, k_);
 
                 insert(T, L, R, n / k_, q % (n / k_), y, l + 1);
@@ -2164,14 +2391,14 @@ private:
 
     /* isNotNull() */
 
-    bool checkInit(size_type q) {
+    bool checkInit(size_type q) const {
         return (L_.empty()) ? false : check(nPrime_ / k_, q % (nPrime_ / k_), q / (nPrime_ / k_));
     }
 
-    bool check(size_type n, size_type q, size_type z) {
+    bool check(size_type n, size_type q, size_type z) const {
 
         if (z >= T_.size()) {
-            return L_[z - T_.size()];
+            return leaf(z - T_.size());
         } else {
             return T_[z] ? check(n / k_, q % (n / k_), R_.rank(z + 1) * k_ + q / (n / k_)) : false;
         }
@@ -2180,7 +2407,7 @@ private:
 
     /* getRange() */
 
-    void fullRangeIterative(std::vector<size_type>& elems) {
+    void fullRangeIterative(std::vector<size_type>& elems) const {
 
         if (L_.empty()) return;
 
@@ -2189,11 +2416,7 @@ private:
 
         if (lenT == 0) {
 
-            for (size_type i = 0; i < nPrime_; i++) {
-                if (L_[i]) {
-                    elems.push_back(i);
-                }
-            }
+            forEachLeaf(0, nPrime_, [&](size_type x) { elems.push_back(x); return true; });
 
         } else {
 
@@ -2201,6 +2424,7 @@ private:
             size_type n = nPrime_/ k_;
 
             for (size_type z = 0, dq = 0; z < k_; z++, dq += n) {
+                K2TREES_COUNT(queuePushes);
                 queue.push(SubrowInfo(dq, z));
             }
 
@@ -2212,11 +2436,12 @@ private:
 
                     auto& cur = queue.front();
 
-                    if (T_[cur.z]) {
+                    if (hasChildren(cur.z)) {
 
                         auto y = R_.rank(cur.z + 1) * k_;
 
                         for (size_type j = 0, newDq = cur.dq; j < k_; j++, newDq += n, y++) {
+                            K2TREES_COUNT(queuePushes);
                             nextLevelQueue.push(SubrowInfo(newDq, y));
                         }
 
@@ -2234,15 +2459,10 @@ private:
 
                 auto& cur = queue.front();
 
-                if (T_[cur.z]) {
+                if (hasChildren(cur.z)) {
 
                     auto y = R_.rank(cur.z + 1) * k_ - lenT;
-
-                    for (size_type j = 0, newDq = cur.dq; j < k_; j++, newDq += n, y++) {
-                        if (L_[y]) {
-                            elems.push_back(newDq);
-                        }
-                    }
+                    forEachLeaf(y, k_, [&](size_type x) { elems.push_back(cur.dq + x - y); return true; });
 
                 }
 
@@ -2254,7 +2474,7 @@ private:
 
     }
 
-    void fullRangeValPosIterative(std::vector<std::pair<size_type, elem_type>>& elems) {
+    void fullRangeValPosIterative(std::vector<std::pair<size_type, elem_type>>& elems) const {
 
         if (L_.empty()) return;
 
@@ -2263,11 +2483,7 @@ private:
 
         if (lenT == 0) {
 
-            for (size_type i = 0; i < nPrime_; i++) {
-                if (L_[i]) {
-                    elems.push_back(std::make_pair(i, 1));
-                }
-            }
+            forEachLeaf(0, nPrime_, [&](size_type x) { elems.push_back(std::make_pair(x, 1)); return true; });
 
         } else {
 
@@ -2275,6 +2491,7 @@ private:
             size_type n = nPrime_/ k_;
 
             for (size_type z = 0, dq = 0; z < k_; z++, dq += n) {
+                K2TREES_COUNT(queuePushes);
                 queue.push(SubrowInfo(dq, z));
             }
 
@@ -2286,11 +2503,12 @@ private:
 
                     auto& cur = queue.front();
 
-                    if (T_[cur.z]) {
+                    if (hasChildren(cur.z)) {
 
                         auto y = R_.rank(cur.z + 1) * k_;
 
                         for (size_type j = 0, newDq = cur.dq; j < k_; j++, newDq += n, y++) {
+                            K2TREES_COUNT(queuePushes);
                             nextLevelQueue.push(SubrowInfo(newDq, y));
                         }
 
@@ -2308,15 +2526,10 @@ private:
 
                 auto& cur = queue.front();
 
-                if (T_[cur.z]) {
+                if (hasChildren(cur.z)) {
 
                     auto y = R_.rank(cur.z + 1) * k_ - lenT;
-
-                    for (size_type j = 0, newDq = cur.dq; j < k_; j++, newDq += n, y++) {
-                        if (L_[y]) {
-                            elems.push_back(std::make_pair(newDq, 1));
-                        }
-                    }
+                    forEachLeaf(y, k_, [&](size_type x) { elems.push_back(std::make_pair(cur.dq + x - y, 1)); return true; });
 
                 }
 
@@ -2328,7 +2541,7 @@ private:
 
     }
 
-    void rangeInit(std::vector<size_type>& elems, size_type l, size_type r) {
+    void rangeInit(std::vector<size_type>& elems, size_type l, size_type r) const {
 
         if (!L_.empty()) {
 
@@ -2347,20 +2560,30 @@ private:
 
     }
 
-    void range(std::vector<size_type>& elems, size_type n, size_type l, size_type r, size_type dq, size_type z) {
+    void range(std::vector<size_type>& elems, size_type n, size_type l, size_type r, size_type dq, size_type z) const {
 
         if (z >= T_.size()) {
 
-            if (L_[z - T_.size()]) {
+            if (leaf(z - T_.size())) {
                 elems.push_back(dq);
             }
 
         } else {
 
-            if (T_[z]) {
+            if (hasChildren(z)) {
 
                 auto y = R_.rank(z + 1) * k_;
 
+                if (n == k_) {
+
+                    // the children are leaves: scan them word by word
+                    size_type x = y - T_.size();
+                    forEachLeaf(x + l, r - l + 1, [&](size_type c) { elems.push_back(dq + c - x); return true; });
+
+                    return;
+
+                }
+
                 for (auto j = l / (n / k_); j <= r / (n / k_); j++) {
                     range(
                             elems,
@@ -2380,14 +2603,10 @@ private:
 
     /* containsElements() */
 
-    bool elemInRangeInit(size_type l, size_type r) {
+    bool elemInRangeInit(size_type l, size_type r) const {
 
         if (!L_.empty()) {
 
-            if ((l == 0) && (r == (nPrime_ - 1))) {
-                return 1;
-            }
-
             for (auto j = l / (nPrime_ / k_); j <= r / (nPrime_ / k_); j++) {
 
                 if (elemInRange(nPrime_ / k_, (j == l / (nPrime_ / k_)) * (l % (nPrime_ / k_)), (j == r / (nPrime_ / k_)) ? r % (nPrime_ / k_) : nPrime_ / k_ - 1, j)) {
@@ -2402,22 +2621,25 @@ private:
 
     }
 
-    bool elemInRange(size_type n, size_type l, size_type r, size_type z) {
+    bool elemInRange(size_type n, size_type l, size_type r, size_type z) const {
 
         if (z >= T_.size()) {
 
-            return L_[z - T_.size()];
+            return leaf(z - T_.size());
 
         } else {
 
-            if (T_[z]) {
+            if (hasChildren(z)) {
 
                 if ((l == 0) && (r == (n - 1))) {
                     return true;
                 }
 
                 auto y = R_.rank(z + 1) * k_;
-                size_type p1Prime, p2Prime;
+
+                if (n == k_) {
+                    return anyLeaf(y - T_.size() + l, r - l + 1); // the children are leaves
+                }
 
                 for (auto j = l / (n / k_); j <= r / (n / k_); j++) {
 
@@ -2436,6 +2658,65 @@ private:
     }
 
 
+    /* helper methods for handling subtrees emptied by setNull() */
+
+    // returns the entry of the last level at position x
+    inline bool leaf(size_type x) const {
+
+        K2TREES_COUNT(leafProbes);
+        return L_[x];
+
+    }
+
+    // calls visitor(x) for the positions x of all set bits of the last level in [x, x + len) (word by word, see forEachSetBit())
+    template<typename F>
+    inline bool forEachLeaf(size_type x, size_type len, F visitor) const {
+
+        K2TREES_COUNT(leafProbes);
+        return forEachSetBit(L_, x, len, visitor);
+
+    }
+
+    // checks whether the last level contains a set bit in [x, x + len)
+    inline bool anyLeaf(size_type x, size_type len) const {
+
+        K2TREES_COUNT(leafProbes);
+        return (len <= 64) ? (getBits(L_, x, len) != 0) : anyBitSet(L_, x, len);
+
+    }
+
+    // checks whether node z has children, i.e. whether its bit in T is set and its subtree has not been emptied by setNull()
+    inline bool hasChildren(size_type z) const {
+
+        K2TREES_COUNT(nodesVisited);
+        return T_[z] && (emptyNodes_.empty() || !emptyNodes_[z]);
+
+    }
+
+    // checks whether all len nodes of the block starting at position y are empty
+    bool isEmptyBlock(size_type y, size_type len) const {
+
+        for (size_type c = y; c < y + len; c++) {
+            if ((c >= T_.size()) ? leaf(c - T_.size()) : hasChildren(c)) {
+                return false;
+            }
+        }
+
+        return true;
+
+    }
+
+    // marks the subtree of node z as empty
+    void markEmpty(size_type z) {
+
+        if (emptyNodes_.empty()) {
+            emptyNodes_ = bit_vector_type(T_.size(), 0);
+        }
+
+        emptyNodes_[z] = 1;
+
+    }
+
     /* setNull() */
 
     void setInit(size_type q) {
@@ -2446,31 +2727,49 @@ private:
 
     }
 
-    void set(size_type n, size_type q, size_type z) {
+    // clears the entry in the subtree of z, returns true iff the subtree is empty afterwards
+    bool set(size_type n, size_type q, size_type z) {
 
         if (z >= T_.size()) {
+
             L_[z - T_.size()] = null_;
+
+            return true;
+
         } else {
-            if (T_[z]) {
-                set(n / k_, q % (n / k_), R_.rank(z + 1) * k_ + q / (n / k_));
+
+            if (hasChildren(z)) {
+
+                size_type y = R_.rank(z + 1) * k_;
+
+                // mark z if its whole subtree has become empty
+                if (set(n / k_, q % (n / k_), y + q / (n / k_)) && isEmptyBlock(y, k_)) {
+
+                    markEmpty(z);
+                    return true;
+
+                }
+
+                return false;
+
             }
+
+            return true;
+
         }
 
     }
 
     /* getFirst() */
 
-    size_type getFirstIterative() {
+    size_type getFirstIterative() const {
 
         if (L_.empty()) return nPrime_;
 
         if (T_.size() == 0) {
 
-            for (size_type i = 0; i < nPrime_; i++) {
-                if (L_[i]) {
-                    return i;
-                }
-            }
+            K2TREES_COUNT(leafProbes);
+            return findFirstBit(L_, 0, nPrime_);
 
         } else {
 
@@ -2480,7 +2779,7 @@ private:
 
             while (z < T_.size()) {
 
-                if (T_[z]) {
+                if (hasChildren(z)) {
 
                     n /= k_;
                     z = R_.rank(z + 1) * k_;
@@ -2494,12 +2793,10 @@ private:
 
             }
 
-            for (size_type offset = 0; offset < k_; offset++) {
-
-                if (L_[z - T_.size() + offset]) {
-                    return dq + offset;
-                }
-
+            K2TREES_COUNT(leafProbes);
+            size_type offset = findFirstBit(L_, z - T_.size(), k_) - (z - T_.size());
+            if (offset < k_) {
+                return dq + offset;
             }
 
         }
@@ -2508,7 +2805,7 @@ private:
 
     }
 
-    size_type getFirstInit() {
+    size_type getFirstInit() const {
 
         size_type pos = nPrime_;
 
@@ -2530,19 +2827,19 @@ private:
 
     }
 
-    size_type getFirst(size_type n, size_type l, size_type r, size_type dq, size_type z) {
+    size_type getFirst(size_type n, size_type l, size_type r, size_type dq, size_type z) const {
 
         size_type pos = nPrime_;
 
         if (z >= T_.size()) {
 
-            if (L_[z - T_.size()]) {
+            if (leaf(z - T_.size())) {
                 pos = dq;
             }
 
         } else {
 
-            if (T_[z]) {
+            if (hasChildren(z)) {
 
                 auto y = R_.rank(z + 1) * k_;
 
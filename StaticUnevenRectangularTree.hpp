@@ -22,7 +22,10 @@
 #ifndef K2TREES_STATICUNEVENRECTANGULARTREE_HPP
 #define K2TREES_STATICUNEVENRECTANGULARTREE_HPP
 
+#include <atomic>
+#include <memory>
 #include <queue>
+#include <sstream>
 
 #include "K2Tree.hpp"
 #include "StaticBasicRectangularTree.hpp"
@@ -50,6 +53,15 @@ public:
     typedef typename K2Tree<elem_type>::positions_type positions_type;
     typedef typename K2Tree<elem_type>::pairs_type pairs_type;
 
+    // output-buffer and limited variants of the query methods (see K2Tree)
+    using K2Tree<elem_type>::getSuccessorPositions;
+    using K2Tree<elem_type>::getPredecessorPositions;
+    using K2Tree<elem_type>::getPositionsInRange;
+    using K2Tree<elem_type>::getAllValuedPositions;
+    using K2Tree<elem_type>::getSuccessors;
+    using K2Tree<elem_type>::getRange;
+    using K2Tree<elem_type>::expandFrontier;
+
 
     UnevenKrKcTree() {
 
@@ -70,10 +82,11 @@ public:
 
         partitions_ = new KrKcTree<elem_type>*[other.numPartitions_];
         for (size_type k = 0; k < other.numPartitions_; k++) {
-            partitions_[k] = new KrKcTree<elem_type>(*other.partitions_[k]);
+            partitions_[k] = (other.partition(k) != 0) ? new KrKcTree<elem_type>(*other.partition(k)) : 0;
         }
         partitionSize_ = other.partitionSize_;
         numPartitions_ = other.numPartitions_;
+        pool_ = other.pool_;
 
     }
 
@@ -96,12 +109,14 @@ public:
             delete partitions_[k];
         }
         delete[] partitions_;
+        releaseMapping();
         partitions_ = new KrKcTree<elem_type>*[other.numPartitions_];
         for (size_type k = 0; k < other.numPartitions_; k++) {
-            partitions_[k] = new KrKcTree<elem_type>(*other.partitions_[k]);
+            partitions_[k] = (other.partition(k) != 0) ? new KrKcTree<elem_type>(*other.partition(k)) : 0;
         }
         partitionSize_ = other.partitionSize_;
         numPartitions_ = other.numPartitions_;
+        pool_ = other.pool_;
 
         return *this;
 
@@ -227,8 +242,10 @@ public:
 
     /**
      * List-of-pairs-based constructor (based on section 3.3.5. of Brisaboa et al.)
+     *
+     * The (independent) partitions are built concurrently by up to numThreads threads.
      */
-    UnevenKrKcTree(pairs_type& pairs, const size_type kr, const size_type kc, const elem_type null = elem_type()) {
+    UnevenKrKcTree(pairs_type& pairs, const size_type kr, const size_type kc, const elem_type null = elem_type(), const size_type numThreads = 1) {
 
         null_ = null;
 
@@ -252,45 +269,60 @@ public:
 
             partitionSize_ = size_type(pow(kc_, hr_));
             numPartitions_ = numCols_ / partitionSize_;
-            partitions_ = new KrKcTree<elem_type>*[numPartitions_];
-
-            Subproblem sp(0, numRows_ - 1, 0, numCols_ - 1, 0, pairs.size());
-            std::vector<std::pair<size_type, size_type>> intervals(numPartitions_);
-            countingSort(pairs, intervals, sp, numRows_, partitionSize_, numPartitions_);
-
-            for (size_type i = 0; i < numPartitions_; i++) {
-                partitions_[i] = new KrKcTree<elem_type>(pairs, 0, i * partitionSize_, numRows_, partitionSize_, intervals[i].first, intervals[i].second, kr_, kc_, null);
-            }
-
 
         } else {
 
             partitionSize_ = size_type(pow(kr_, hc_));
             numPartitions_ = numRows_ / partitionSize_;
-            partitions_ = new KrKcTree<elem_type>*[numPartitions_];
 
-            Subproblem sp(0, numRows_ - 1, 0, numCols_ - 1, 0, pairs.size());
-            std::vector<std::pair<size_type, size_type>> intervals(numPartitions_);
-            countingSort(pairs, intervals, sp, partitionSize_, numCols_, numPartitions_);
+        }
 
-            for (size_type j = 0; j < numPartitions_; j++) {
-                partitions_[j] = new KrKcTree<elem_type>(pairs, j * partitionSize_, 0, partitionSize_, numCols_, intervals[j].first, intervals[j].second, kr_, kc_, null);
-            }
+        buildPartitions(pairs, pairs.size(), 0, numPartitions_, numThreads);
 
-        }
+    }
 
-#if 1
-        for (size_type k = 0; k < numPartitions_; k++) {
+    /**
+     * Sharding constructor: builds the given shard of the relation described by manifest (see ShardManifest),
+     * i.e. an UnevenKrKcTree with the dimensions of the whole relation consisting only of the partitions of this shard.
+     *
+     * pairs may contain pairs of other shards, which are ignored (but moved to the end of pairs).
+     * Throws a std::runtime_error if the shard does not exist or some pair lies outside of the relation matrix.
+     */
+    UnevenKrKcTree(pairs_type& pairs, const ShardManifest& manifest, const size_type shard, const elem_type null = elem_type(), const size_type numThreads = 1) {
 
-            if (partitions_[k]->getNumRows() == 0) {
+        null_ = null;
 
-                delete partitions_[k];
-                partitions_[k] = 0;
+        kr_ = manifest.getKr();
+        kc_ = manifest.getKc();
+        numRows_ = manifest.getNumRows();
+        numCols_ = manifest.getNumCols();
+        hr_ = logK(numRows_, kr_);
+        hc_ = logK(numCols_, kc_);
+        partitionSize_ = manifest.getPartitionSize();
+        numPartitions_ = manifest.getNumPartitions();
+
+        checkShard(manifest, shard);
 
+        for (auto& p : pairs) {
+
+            if ((p.row >= numRows_) || (p.col >= numCols_)) {
+                throw std::runtime_error("Pair (" + std::to_string(p.row) + ", " + std::to_string(p.col) + ") lies outside of the relation described by the shard manifest.");
             }
 
         }
-#endif
+
+        // rows (columns) of the shard
+        size_type first = manifest.getFirstPartition(shard) * partitionSize_;
+        size_type last = manifest.getFirstPartition(shard + 1) * partitionSize_;
+
+        auto end = std::partition(pairs.begin(), pairs.end(), [&](const typename pairs_type::value_type& p) {
+
+            size_type x = (hc_ > hr_) ? p.col : p.row;
+            return (first <= x) && (x < last);
+
+        });
+
+        buildPartitions(pairs, end - pairs.begin(), manifest.getFirstPartition(shard), manifest.getFirstPartition(shard + 1), numThreads);
 
     }
 
@@ -300,84 +332,111 @@ public:
             delete partitions_[k];
         }
         delete[] partitions_;
+        releaseMapping();
 
     }
 
 
     // returns the row height of the K2Tree
-    size_type getHr() {
+    size_type getHr() const {
         return hr_;
     }
 
     // returns the column height of the K2Tree
-    size_type getHc() {
+    size_type getHc() const {
         return hc_;
     }
 
     // returns the row arity of the K2Tree
-    size_type getKr() {
+    size_type getKr() const {
         return kr_;
     }
 
     // returns the column arity of the K2Tree
-    size_type getKc() {
+    size_type getKc() const {
         return kc_;
     }
 
-    size_type getNumRows() override {
+    size_type getNumRows() const override {
         return numRows_;
     }
 
-    size_type getNumCols() override {
+    size_type getNumCols() const override {
         return numCols_;
     }
 
-    elem_type getNull() override {
+    elem_type getNull() const override {
         return null_;
     }
 
 
-    bool isNotNull(size_type i, size_type j) override {
+    bool isNotNull(size_type i, size_type j) const override {
 
         auto pis = determineIndices(i, j);
-        auto p = partitions_[pis.partition];
+        auto p = partition(pis.partition);
 
         return (p != 0) && p->isNotNull(pis.row, pis.col);
 
     }
 
-    elem_type getElement(size_type i, size_type j) override {
+    elem_type getElement(size_type i, size_type j) const override {
 
         auto pis = determineIndices(i, j);
-        auto p = partitions_[pis.partition];
+        auto p = partition(pis.partition);
 
         return (p != 0) ? p->getElement(pis.row, pis.col) : null_;
 
     }
 
-    std::vector<elem_type> getSuccessorElements(size_type i) override {
+    void isNotNull(const positions_type& queries, std::vector<bool>& out) const override {
 
-        std::vector<elem_type> succs;
+        out.assign(queries.size(), false);
 
-        if (hc_ > hr_) {
+        // (one byte per query, as the partitions may be queried concurrently)
+        std::vector<char> found(queries.size(), false);
+        batchByPartition(queries, [&](K2Tree<elem_type>* p, const positions_type& local, const size_type* idx) {
+            std::vector<bool> res;
+            p->isNotNull(local, res);
+            for (size_type x = 0; x < local.size(); x++) {
+                found[idx[x]] = res[x];
+            }
+        });
 
-            for (size_type k = 0; k < numPartitions_; k++) {
+        out.assign(found.begin(), found.end());
 
-                auto p = partitions_[k];
-                if (p != 0) {
+    }
 
-                    auto tmp = p->getSuccessorElements(i);
-                    succs.reserve(succs.size() + tmp.size());
-                    std::move(tmp.begin(), tmp.end(), std::back_inserter(succs));
+    void getElement(const positions_type& queries, std::vector<elem_type>& out) const override {
 
-                }
+        out.assign(queries.size(), null_);
 
+        batchByPartition(queries, [&](K2Tree<elem_type>* p, const positions_type& local, const size_type* idx) {
+            std::vector<elem_type> res;
+            p->getElement(local, res);
+            for (size_type x = 0; x < local.size(); x++) {
+                out[idx[x]] = res[x];
             }
+        });
+
+    }
+
+    std::vector<elem_type> getSuccessorElements(size_type i) const override {
+
+        std::vector<elem_type> succs;
+
+        if (hc_ > hr_) {
+
+            // (queried concurrently if a worker pool is set, see setWorkerPool())
+            succs = gatherPartitions<std::vector<elem_type>>(0, numPartitions_, [&](KrKcTree<elem_type>* p, size_type k) -> std::vector<elem_type> {
+
+                return p->getSuccessorElements(i);
+
+            });
 
         } else {
 
             auto pis = determineIndices(i, 0);
-            auto p = partitions_[pis.partition];
+            auto p = partition(pis.partition);
             if (p != 0) {
                 succs = p->getSuccessorElements(pis.row);
             }
@@ -388,34 +447,28 @@ public:
 
     }
 
-    std::vector<size_type> getSuccessorPositions(size_type i) override {
+    std::vector<size_type> getSuccessorPositions(size_type i) const override {
 
         std::vector<size_type> succs;
 
         if (hc_ > hr_) {
 
-            size_type offset = 0;
-            for (size_type k = 0; k < numPartitions_; k++, offset += partitionSize_) {
-
-                auto p = partitions_[k];
-                if (p != 0) {
-
-                    auto tmp = p->getSuccessorPositions(i);
-                    for (size_type l = 0; l < tmp.size(); l++) {
-                        tmp[l] += offset;
-                    }
-
-                    succs.reserve(succs.size() + tmp.size());
-                    std::move(tmp.begin(), tmp.end(), std::back_inserter(succs));
+            // (queried concurrently if a worker pool is set, see setWorkerPool())
+            succs = gatherPartitions<std::vector<size_type>>(0, numPartitions_, [&](KrKcTree<elem_type>* p, size_type k) -> std::vector<size_type> {
 
+                auto tmp = p->getSuccessorPositions(i);
+                for (size_type l = 0; l < tmp.size(); l++) {
+                    tmp[l] += k * partitionSize_;
                 }
 
-            }
+                return tmp;
+
+            });
 
         } else {
 
             auto pis = determineIndices(i, 0);
-            auto p = partitions_[pis.partition];
+            auto p = partition(pis.partition);
             if (p != 0) {
                 succs = p->getSuccessorPositions(pis.row);
             }
@@ -426,34 +479,28 @@ public:
 
     }
 
-    pairs_type getSuccessorValuedPositions(size_type i) override {
+    pairs_type getSuccessorValuedPositions(size_type i) const override {
 
         pairs_type succs;
 
         if (hc_ > hr_) {
 
-            size_type offset = 0;
-            for (size_type k = 0; k < numPartitions_; k++, offset += partitionSize_) {
-
-                auto p = partitions_[k];
-                if (p != 0) {
-
-                    auto tmp = p->getSuccessorValuedPositions(i);
-                    for (size_type l = 0; l < tmp.size(); l++) {
-                        tmp[l].col += offset;
-                    }
-
-                    succs.reserve(succs.size() + tmp.size());
-                    std::move(tmp.begin(), tmp.end(), std::back_inserter(succs));
+            // (queried concurrently if a worker pool is set, see setWorkerPool())
+            succs = gatherPartitions<pairs_type>(0, numPartitions_, [&](KrKcTree<elem_type>* p, size_type k) -> pairs_type {
 
+                auto tmp = p->getSuccessorValuedPositions(i);
+                for (size_type l = 0; l < tmp.size(); l++) {
+                    tmp[l].col += k * partitionSize_;
                 }
 
-            }
+                return tmp;
+
+            });
 
         } else {
 
             auto pis = determineIndices(i, 0);
-            auto p = partitions_[pis.partition];
+            auto p = partition(pis.partition);
             if (p != 0) {
                 succs = p->getSuccessorValuedPositions(pis.row);
             }
@@ -473,29 +520,23 @@ public:
 
     }
 
-    std::vector<elem_type> getPredecessorElements(size_type j) override {
+    std::vector<elem_type> getPredecessorElements(size_type j) const override {
 
         std::vector<elem_type> preds;
 
         if (hc_ < hr_) {
 
-            for (size_type k = 0; k < numPartitions_; k++) {
-
-                auto p = partitions_[k];
-                if (p != 0) {
-
-                    auto tmp = p->getPredecessorElements(j);
-                    preds.reserve(preds.size() + tmp.size());
-                    std::move(tmp.begin(), tmp.end(), std::back_inserter(preds));
+            // (queried concurrently if a worker pool is set, see setWorkerPool())
+            preds = gatherPartitions<std::vector<elem_type>>(0, numPartitions_, [&](KrKcTree<elem_type>* p, size_type k) -> std::vector<elem_type> {
 
-                }
+                return p->getPredecessorElements(j);
 
-            }
+            });
 
         } else {
 
             auto pis = determineIndices(0, j);
-            auto p = partitions_[pis.partition];
+            auto p = partition(pis.partition);
             if (p != 0) {
                 preds = p->getPredecessorElements(pis.col);
             }
@@ -506,34 +547,28 @@ public:
 
     }
 
-    std::vector<size_type> getPredecessorPositions(size_type j) override {
+    std::vector<size_type> getPredecessorPositions(size_type j) const override {
 
         std::vector<size_type> preds;
 
         if (hc_ < hr_) {
 
-            size_type offset = 0;
-            for (size_type k = 0; k < numPartitions_; k++, offset += partitionSize_) {
-
-                auto p = partitions_[k];
-                if (p != 0) {
-
-                    auto tmp = p->getPredecessorPositions(j);
-                    for (size_type l = 0; l < tmp.size(); l++) {
-                        tmp[l] += offset;
-                    }
-
-                    preds.reserve(preds.size() + tmp.size());
-                    std::move(tmp.begin(), tmp.end(), std::back_inserter(preds));
+            // (queried concurrently if a worker pool is set, see setWorkerPool())
+            preds = gatherPartitions<std::vector<size_type>>(0, numPartitions_, [&](KrKcTree<elem_type>* p, size_type k) -> std::vector<size_type> {
 
+                auto tmp = p->getPredecessorPositions(j);
+                for (size_type l = 0; l < tmp.size(); l++) {
+                    tmp[l] += k * partitionSize_;
                 }
 
-            }
+                return tmp;
+
+            });
 
         } else {
 
             auto pis = determineIndices(0, j);
-            auto p = partitions_[pis.partition];
+            auto p = partition(pis.partition);
             if (p != 0) {
                 preds = p->getPredecessorPositions(pis.col);
             }
@@ -544,34 +579,28 @@ public:
 
     }
 
-    pairs_type getPredecessorValuedPositions(size_type j) override {
+    pairs_type getPredecessorValuedPositions(size_type j) const override {
 
         pairs_type preds;
 
         if (hc_ < hr_) {
 
-            size_type offset = 0;
-            for (size_type k = 0; k < numPartitions_; k++, offset += partitionSize_) {
-
-                auto p = partitions_[k];
-                if (p != 0) {
-
-                    auto tmp = p->getPredecessorValuedPositions(j);
-                    for (size_type l = 0; l < tmp.size(); l++) {
-                        tmp[l].row += offset;
-                    }
-
-                    preds.reserve(preds.size() + tmp.size());
-                    std::move(tmp.begin(), tmp.end(), std::back_inserter(preds));
+            // (queried concurrently if a worker pool is set, see setWorkerPool())
+            preds = gatherPartitions<pairs_type>(0, numPartitions_, [&](KrKcTree<elem_type>* p, size_type k) -> pairs_type {
 
+                auto tmp = p->getPredecessorValuedPositions(j);
+                for (size_type l = 0; l < tmp.size(); l++) {
+                    tmp[l].row += k * partitionSize_;
                 }
 
-            }
+                return tmp;
+
+            });
 
         } else {
 
             auto pis = determineIndices(0, j);
-            auto p = partitions_[pis.partition];
+            auto p = partition(pis.partition);
             if (p != 0) {
                 preds = p->getPredecessorValuedPositions(pis.col);
             }
@@ -591,7 +620,7 @@ public:
 
     }
 
-    std::vector<elem_type> getElementsInRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    std::vector<elem_type> getElementsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
 
         std::vector<elem_type> elements;
 
@@ -601,7 +630,7 @@ public:
         // range falls completely within one partition
         if (upperLeft.partition == lowerRight.partition) {
 
-            auto p = partitions_[upperLeft.partition];
+            auto p = partition(upperLeft.partition);
             if (p != 0) {
                 elements = p->getElementsInRange(upperLeft.row, lowerRight.row, upperLeft.col, lowerRight.col);
             }
@@ -610,94 +639,21 @@ public:
 
         }
 
-        // range spans multiple partitions
-        std::vector<std::vector<elem_type>> tmp;
-        tmp.reserve(lowerRight.partition - upperLeft.partition + 1);
-
-        if (hc_ > hr_) {
-
-            // first partition (partially spanned)
-            auto p = partitions_[upperLeft.partition];
-            if (p != 0) {
-                tmp.push_back(p->getElementsInRange(upperLeft.row, lowerRight.row, upperLeft.col, partitionSize_ - 1));
-            }
-
-            // intermediate partition (fully spanned, if any)
-            for (size_type k = upperLeft.partition + 1; k < lowerRight.partition; k++) {
-
-                p = partitions_[k];
-                if (p != 0) {
-                    tmp.push_back(p->getElementsInRange(upperLeft.row, lowerRight.row, 0, partitionSize_ - 1));
-                }
-
-            }
-
-            // last partition (partially spanned)
-            p = partitions_[lowerRight.partition];
-            if (p != 0) {
-                tmp.push_back(p->getElementsInRange(upperLeft.row, lowerRight.row, 0, lowerRight.col));
-            }
-
-            size_type toReserve = elements.size();
-            for (auto& v : tmp) {
-                toReserve += v.size();
-            }
-            elements.reserve(toReserve);
-
-            for (auto& v : tmp) {
-
-                std::move(v.begin(), v.end(), std::back_inserter(elements));
-                v.clear();
-                v.shrink_to_fit();
-
-            }
-
-        } else {
-
-            // first partition (partially spanned)
-            auto p = partitions_[upperLeft.partition];
-            if (p != 0) {
-                tmp.push_back(p->getElementsInRange(upperLeft.row, partitionSize_ - 1, upperLeft.col, lowerRight.col));
-            }
-
-            // intermediate partition (fully spanned, if any)
-            for (size_type k = upperLeft.partition + 1; k < lowerRight.partition; k++) {
-
-                p = partitions_[k];
-                if (p != 0) {
-                    tmp.push_back(p->getElementsInRange(0, partitionSize_ - 1, upperLeft.col, lowerRight.col));
-                }
-
-            }
-
-            // last partition (partially spanned)
-            p = partitions_[lowerRight.partition];
-            if (p != 0) {
-                tmp.push_back(p->getElementsInRange(0, lowerRight.row, upperLeft.col, lowerRight.col));
-            }
-
-        }
-
-        // flatten results
-        size_type toReserve = elements.size();
-        for (auto& v : tmp) {
-            toReserve += v.size();
-        }
-        elements.reserve(toReserve);
-
-        for (auto& v : tmp) {
+        // range spans multiple partitions (queried concurrently if a worker pool is set, see setWorkerPool())
+        return gatherPartitions<std::vector<elem_type>>(upperLeft.partition, lowerRight.partition + 1, [&](KrKcTree<elem_type>* p, size_type k) -> std::vector<elem_type> {
 
-            std::move(v.begin(), v.end(), std::back_inserter(elements));
-            v.clear();
-            v.shrink_to_fit();
+            size_type from = (k == upperLeft.partition) ? ((hc_ > hr_) ? upperLeft.col : upperLeft.row) : 0;
+            size_type to = (k == lowerRight.partition) ? ((hc_ > hr_) ? lowerRight.col : lowerRight.row) : partitionSize_ - 1;
 
-        }
+            return (hc_ > hr_)
+                    ? p->getElementsInRange(upperLeft.row, lowerRight.row, from, to)
+                    : p->getElementsInRange(from, to, upperLeft.col, lowerRight.col);
 
-        return elements;
+        });
 
     }
 
-    positions_type getPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    positions_type getPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
 
         positions_type elements;
 
@@ -707,7 +663,7 @@ public:
         // range falls completely within one partition
         if (upperLeft.partition == lowerRight.partition) {
 
-            auto p = partitions_[upperLeft.partition];
+            auto p = partition(upperLeft.partition);
             if (p != 0) {
 
                 elements = p->getPositionsInRange(upperLeft.row, lowerRight.row, upperLeft.col, lowerRight.col);
@@ -734,113 +690,38 @@ public:
 
         }
 
-        // range spans multiple partitions
-        std::vector<positions_type> tmp;
-        tmp.reserve(lowerRight.partition - upperLeft.partition + 1);
-        size_type offset = partitionSize_ * upperLeft.partition;
-
-        if (hc_ > hr_) {
-
-            // first partition (partially spanned)
-            auto p = partitions_[upperLeft.partition];
-            if (p != 0) {
-
-                tmp.push_back(p->getPositionsInRange(upperLeft.row, lowerRight.row, upperLeft.col, partitionSize_ - 1));
-                for (auto& e : tmp.back()) {
-                    e.second += offset;
-                }
-
-            }
-
-            // intermediate partition (fully spanned, if any)
-            offset += partitionSize_;
-            for (size_type k = upperLeft.partition + 1; k < lowerRight.partition; k++, offset += partitionSize_) {
-
-                p = partitions_[k];
-                if (p != 0) {
-
-                    tmp.push_back(p->getPositionsInRange(upperLeft.row, lowerRight.row, 0, partitionSize_ - 1));
-                    for (auto& e : tmp.back()) {
-                        e.second += offset;
-                    }
+        // range spans multiple partitions (queried concurrently if a worker pool is set, see setWorkerPool())
+        return gatherPartitions<positions_type>(upperLeft.partition, lowerRight.partition + 1, [&](KrKcTree<elem_type>* p, size_type k) -> positions_type {
 
-                }
+            size_type from = (k == upperLeft.partition) ? ((hc_ > hr_) ? upperLeft.col : upperLeft.row) : 0;
+            size_type to = (k == lowerRight.partition) ? ((hc_ > hr_) ? lowerRight.col : lowerRight.row) : partitionSize_ - 1;
 
-            }
+            positions_type res;
+            size_type offset = partitionSize_ * k;
 
-            // last partition (partially spanned)
-            p = partitions_[lowerRight.partition];
-            if (p != 0) {
+            if (hc_ > hr_) {
 
-                tmp.push_back(p->getPositionsInRange(upperLeft.row, lowerRight.row, 0, lowerRight.col));
-                for (auto& e : tmp.back()) {
+                res = p->getPositionsInRange(upperLeft.row, lowerRight.row, from, to);
+                for (auto& e : res) {
                     e.second += offset;
                 }
 
-            }
-
-        } else {
-
-            // first partition (partially spanned)
-            auto p = partitions_[upperLeft.partition];
-            if (p != 0) {
-
-                tmp.push_back(p->getPositionsInRange(upperLeft.row, partitionSize_ - 1, upperLeft.col, lowerRight.col));
-                for (auto& e : tmp.back()) {
-                    e.first += offset;
-                }
-
-            }
-
-            // intermediate partition (fully spanned, if any)
-            offset += partitionSize_;
-            for (size_type k = upperLeft.partition + 1; k < lowerRight.partition; k++, offset += partitionSize_) {
-
-                p = partitions_[k];
-                if (p != 0) {
-
-                    tmp.push_back(p->getPositionsInRange(0, partitionSize_ - 1, upperLeft.col, lowerRight.col));
-                    for (auto& e : tmp.back()) {
-                        e.first += offset;
-                    }
-
-                }
-
-            }
-
-            // last partition (partially spanned)
-            p = partitions_[lowerRight.partition];
-            if (p != 0) {
+            } else {
 
-                tmp.push_back(p->getPositionsInRange(0, lowerRight.row, upperLeft.col, lowerRight.col));
-                for (auto& e : tmp.back()) {
+                res = p->getPositionsInRange(from, to, upperLeft.col, lowerRight.col);
+                for (auto& e : res) {
                     e.first += offset;
                 }
 
             }
 
-        }
-
-        // flatten results
-        size_type toReserve = elements.size();
-        for (auto& v : tmp) {
-            toReserve += v.size();
-        }
-        elements.reserve(toReserve);
-
-        for (auto& v : tmp) {
-
-            std::move(v.begin(), v.end(), std::back_inserter(elements));
-            v.clear();
-            v.shrink_to_fit();
-
-        }
+            return res;
 
-        return elements;
+        });
 
     }
 
-    pairs_type getValuedPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    pairs_type getValuedPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
 
         pairs_type elements;
 
@@ -850,7 +731,7 @@ public:
         // range falls completely within one partition
         if (upperLeft.partition == lowerRight.partition) {
 
-            auto p = partitions_[upperLeft.partition];
+            auto p = partition(upperLeft.partition);
             if (p != 0) {
 
                 elements = p->getValuedPositionsInRange(upperLeft.row, lowerRight.row, upperLeft.col, lowerRight.col);
@@ -877,119 +758,44 @@ public:
 
         }
 
-        // range spans multiple partitions
-        std::vector<pairs_type> tmp;
-        tmp.reserve(lowerRight.partition - upperLeft.partition + 1);
-        size_type offset = partitionSize_ * upperLeft.partition;
-
-        if (hc_ > hr_) {
-
-            // first partition (partially spanned)
-            auto p = partitions_[upperLeft.partition];
-            if (p != 0) {
-
-                tmp.push_back(p->getValuedPositionsInRange(upperLeft.row, lowerRight.row, upperLeft.col, partitionSize_ - 1));
-                for (auto& e : tmp.back()) {
-                    e.col += offset;
-                }
-
-            }
-
-            // intermediate partition (fully spanned, if any)
-            offset += partitionSize_;
-            for (size_type k = upperLeft.partition + 1; k < lowerRight.partition; k++, offset += partitionSize_) {
-
-                p = partitions_[k];
-                if (p != 0) {
+        // range spans multiple partitions (queried concurrently if a worker pool is set, see setWorkerPool())
+        return gatherPartitions<pairs_type>(upperLeft.partition, lowerRight.partition + 1, [&](KrKcTree<elem_type>* p, size_type k) -> pairs_type {
 
-                    tmp.push_back(p->getValuedPositionsInRange(upperLeft.row, lowerRight.row, 0, partitionSize_ - 1));
-                    for (auto& e : tmp.back()) {
-                        e.col += offset;
-                    }
-
-                }
+            size_type from = (k == upperLeft.partition) ? ((hc_ > hr_) ? upperLeft.col : upperLeft.row) : 0;
+            size_type to = (k == lowerRight.partition) ? ((hc_ > hr_) ? lowerRight.col : lowerRight.row) : partitionSize_ - 1;
 
-            }
+            pairs_type res;
+            size_type offset = partitionSize_ * k;
 
-            // last partition (partially spanned)
-            p = partitions_[lowerRight.partition];
-            if (p != 0) {
+            if (hc_ > hr_) {
 
-                tmp.push_back(p->getValuedPositionsInRange(upperLeft.row, lowerRight.row, 0, lowerRight.col));
-                for (auto& e : tmp.back()) {
+                res = p->getValuedPositionsInRange(upperLeft.row, lowerRight.row, from, to);
+                for (auto& e : res) {
                     e.col += offset;
                 }
 
-            }
-
-        } else {
-
-            // first partition (partially spanned)
-            auto p = partitions_[upperLeft.partition];
-            if (p != 0) {
-
-                tmp.push_back(p->getValuedPositionsInRange(upperLeft.row, partitionSize_ - 1, upperLeft.col, lowerRight.col));
-                for (auto& e : tmp.back()) {
-                    e.row += offset;
-                }
-
-            }
-
-            // intermediate partition (fully spanned, if any)
-            offset += partitionSize_;
-            for (size_type k = upperLeft.partition + 1; k < lowerRight.partition; k++, offset += partitionSize_) {
-
-                p = partitions_[k];
-                if (p != 0) {
-
-                    tmp.push_back(p->getValuedPositionsInRange(0, partitionSize_ - 1, upperLeft.col, lowerRight.col));
-                    for (auto& e : tmp.back()) {
-                        e.row += offset;
-                    }
-
-                }
-
-            }
-
-            // last partition (partially spanned)
-            p = partitions_[lowerRight.partition];
-            if (p != 0) {
+            } else {
 
-                tmp.push_back(p->getValuedPositionsInRange(0, lowerRight.row, upperLeft.col, lowerRight.col));
-                for (auto& e : tmp.back()) {
+                res = p->getValuedPositionsInRange(from, to, upperLeft.col, lowerRight.col);
+                for (auto& e : res) {
                     e.row += offset;
                 }
 
             }
 
-        }
-
-        // flatten results
-        size_type toReserve = elements.size();
-        for (auto& v : tmp) {
-            toReserve += v.size();
-        }
-        elements.reserve(toReserve);
-
-        for (auto& v : tmp) {
+            return res;
 
-            std::move(v.begin(), v.end(), std::back_inserter(elements));
-            v.clear();
-            v.shrink_to_fit();
-
-        }
-
-        return elements;
+        });
 
     }
 
-    std::vector<elem_type> getAllElements() override {
+    std::vector<elem_type> getAllElements() const override {
 
         std::vector<elem_type> elements;
 
         for (size_type k = 0; k < numPartitions_; k++) {
 
-            auto p = partitions_[k];
+            auto p = partition(k);
             if (p != 0) {
 
                 auto tmp = p->getAllElements();
@@ -1004,14 +810,14 @@ public:
 
     }
 
-    positions_type getAllPositions() override {
+    positions_type getAllPositions() const override {
 
         positions_type elements;
         size_type offset = 0;
 
         for (size_type k = 0; k < numPartitions_; k++, offset += partitionSize_) {
 
-            auto p = partitions_[k];
+            auto p = partition(k);
             if (p != 0) {
 
                 auto tmp = p->getAllPositions();
@@ -1040,14 +846,14 @@ public:
 
     }
 
-    pairs_type getAllValuedPositions() override {
+    pairs_type getAllValuedPositions() const override {
 
         pairs_type elements;
         size_type offset = 0;
 
         for (size_type k = 0; k < numPartitions_; k++, offset += partitionSize_) {
 
-            auto p = partitions_[k];
+            auto p = partition(k);
             if (p != 0) {
 
                 auto tmp = p->getAllValuedPositions();
@@ -1076,7 +882,88 @@ public:
 
     }
 
-    bool containsElement(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    bool forEachSuccessorPosition(size_type i, const std::function<bool(size_type)>& visitor) const override {
+
+        if (hc_ > hr_) {
+
+            size_type offset = 0;
+            for (size_type k = 0; k < numPartitions_; k++, offset += partitionSize_) {
+
+                auto p = partition(k);
+                if (p != 0 && !p->forEachSuccessorPosition(i, [&visitor, offset](size_type j) { return visitor(j + offset); })) {
+                    return false;
+                }
+
+            }
+
+            return true;
+
+        } else {
+
+            auto pis = determineIndices(i, 0);
+            auto p = partition(pis.partition);
+
+            return (p != 0) ? p->forEachSuccessorPosition(pis.row, visitor) : true;
+
+        }
+
+    }
+
+    bool forEachPredecessorPosition(size_type j, const std::function<bool(size_type)>& visitor) const override {
+
+        if (hc_ > hr_) {
+
+            auto pis = determineIndices(0, j);
+            auto p = partition(pis.partition);
+
+            return (p != 0) ? p->forEachPredecessorPosition(pis.col, visitor) : true;
+
+        } else {
+
+            size_type offset = 0;
+            for (size_type k = 0; k < numPartitions_; k++, offset += partitionSize_) {
+
+                auto p = partition(k);
+                if (p != 0 && !p->forEachPredecessorPosition(j, [&visitor, offset](size_type i) { return visitor(i + offset); })) {
+                    return false;
+                }
+
+            }
+
+            return true;
+
+        }
+
+    }
+
+    bool forEachValuedPositionInRange(size_type i1, size_type i2, size_type j1, size_type j2, const std::function<bool(size_type, size_type, elem_type)>& visitor) const override {
+
+        auto upperLeft = determineIndices(i1, j1);
+        auto lowerRight = determineIndices(i2, j2);
+
+        // the first and the last partition may be spanned only partially
+        for (size_type k = upperLeft.partition; k <= lowerRight.partition; k++) {
+
+            auto p = partition(k);
+            if (p == 0) continue;
+
+            size_type offset = partitionSize_ * k;
+            size_type from = (k == upperLeft.partition) ? ((hc_ > hr_) ? upperLeft.col : upperLeft.row) : 0;
+            size_type to = (k == lowerRight.partition) ? ((hc_ > hr_) ? lowerRight.col : lowerRight.row) : partitionSize_ - 1;
+
+            bool completed = (hc_ > hr_)
+                    ? p->forEachValuedPositionInRange(upperLeft.row, lowerRight.row, from, to, [&visitor, offset](size_type i, size_type j, elem_type val) { return visitor(i, j + offset, val); })
+                    : p->forEachValuedPositionInRange(from, to, upperLeft.col, lowerRight.col, [&visitor, offset](size_type i, size_type j, elem_type val) { return visitor(i + offset, j, val); });
+
+            if (!completed) return false;
+
+        }
+
+        return true;
+
+    }
+
+    bool containsElement(size_type i1, size_type i2, size_type j1, size_type j2) const override {
 
         auto upperLeft = determineIndices(i1, j1);
         auto lowerRight = determineIndices(i2, j2);
@@ -1085,7 +972,7 @@ public:
         // range falls completely within one partition
         if (upperLeft.partition == lowerRight.partition) {
 
-            auto p = partitions_[upperLeft.partition];
+            auto p = partition(upperLeft.partition);
             return (p != 0) && p->containsElement(upperLeft.row, lowerRight.row, upperLeft.col, lowerRight.col);
 
         }
@@ -1096,37 +983,37 @@ public:
         if (hc_ > hr_) {
 
             // first partition (partially spanned)
-            auto p = partitions_[upperLeft.partition];
+            auto p = partition(upperLeft.partition);
             found = (p != 0) && p->containsElement(upperLeft.row, lowerRight.row, upperLeft.col, partitionSize_ - 1);
 
             // intermediate partition (fully spanned, if any)
             for (size_type k = upperLeft.partition + 1; (k < lowerRight.partition) && !found; k++) {
 
-                p = partitions_[k];
+                p = partition(k);
                 found = (p != 0) && p->containsElement(upperLeft.row, lowerRight.row, 0, partitionSize_ - 1);
 
             }
 
             // last partition (partially spanned)
-            p = partitions_[lowerRight.partition];
+            p = partition(lowerRight.partition);
             found = found || ((p != 0) && p->containsElement(upperLeft.row, lowerRight.row, 0, lowerRight.col));
 
         } else {
 
             // first partition (partially spanned)
-            auto p = partitions_[upperLeft.partition];
+            auto p = partition(upperLeft.partition);
             found =  (p != 0) && p->containsElement(upperLeft.row, partitionSize_ - 1, upperLeft.col, lowerRight.col);
 
             // intermediate partition (fully spanned, if any)
             for (size_type k = upperLeft.partition + 1; (k < lowerRight.partition) && !found; k++) {
 
-                p = partitions_[k];
+                p = partition(k);
                 found = (p != 0) && p->containsElement(0, partitionSize_ - 1, upperLeft.col, lowerRight.col);
 
             }
 
             // last partition (partially spanned)
-            p = partitions_[lowerRight.partition];
+            p = partition(lowerRight.partition);
             found = found ||  ((p != 0) && p->containsElement(0, lowerRight.row, upperLeft.col, lowerRight.col));
 
         }
@@ -1135,12 +1022,12 @@ public:
 
     }
 
-    size_type countElements() override {
+    size_type countElements() const override {
 
         size_type cnt = 0;
         for (size_type k = 0; k < numPartitions_; k++) {
 
-            auto p = partitions_[k];
+            auto p = partition(k);
             cnt += (p != 0) ? p->countElements() : 0;
 
         }
@@ -1149,12 +1036,37 @@ public:
 
     }
 
+    size_type countElementsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
+
+        auto upperLeft = determineIndices(i1, j1);
+        auto lowerRight = determineIndices(i2, j2);
+
+        // the first and the last partition may be spanned only partially
+        size_type cnt = 0;
+        for (size_type k = upperLeft.partition; k <= lowerRight.partition; k++) {
+
+            auto p = partition(k);
+            if (p == 0) continue;
+
+            size_type from = (k == upperLeft.partition) ? ((hc_ > hr_) ? upperLeft.col : upperLeft.row) : 0;
+            size_type to = (k == lowerRight.partition) ? ((hc_ > hr_) ? lowerRight.col : lowerRight.row) : partitionSize_ - 1;
+
+            cnt += (hc_ > hr_)
+                    ? p->countElementsInRange(upperLeft.row, lowerRight.row, from, to)
+                    : p->countElementsInRange(from, to, upperLeft.col, lowerRight.col);
+
+        }
+
+        return cnt;
+
+    }
+
 
     UnevenKrKcTree* clone() const override {
         return new UnevenKrKcTree<elem_type>(*this);
     }
 
-    void print(bool all = false) override {
+    void print(bool all = false) const override {
 
         std::cout << "### Parameters ###" << std::endl;
         std::cout << "hr  = " << hr_ << std::endl;
@@ -1172,7 +1084,7 @@ public:
             for (size_type k = 0; k < numPartitions_; k++) {
 
                 std::cout << "===== Partition " << k << " =====" << std::endl;
-                auto p = partitions_[k];
+                auto p = partition(k);
                 if (p != 0) {
                     p->print(true);
                 } else {
@@ -1185,11 +1097,51 @@ public:
 
     }
 
-    // note: can "invalidate" the data structure (containsLink() probably won't work correctly afterwards)
+    void serialize(std::ostream& out) const override {
+        write(out, 0, numPartitions_);
+    }
+
+    void load(std::istream& in) override {
+        this->checkWritable("load");
+        read(in, 0);
+    }
+
+    // replaces the contents of the K2Tree with those of a file written by serialize(), which is mapped read-only (and shared between processes) into memory;
+    // partitions are only deserialised when a query accesses them for the first time (the file must not be modified while it is mapped);
+    // files written before format version 5 lack the lengths for locating the partitions and are deserialised completely right away
+    void mapFile(const std::string& path) {
+
+        this->checkWritable("mapFile");
+
+        MappedFile* mapping = new MappedFile(path);
+        MemoryStreamBuffer buf(mapping->data(), mapping->size());
+        std::istream in(&buf);
+
+        read(in, mapping);
+
+    }
+
+    // returns a sharding of the K2Tree into numShards shards of (almost) equally many partitions (see ShardManifest)
+    ShardManifest getShardManifest(size_type numShards) const {
+        return ShardManifest(numRows_, numCols_, kr_, kc_, numShards);
+    }
+
+    // writes only the given shard of manifest, which can be read by load() or mapFile() like the output of serialize()
+    // (throws a std::runtime_error if the shard does not exist or manifest does not describe the partitioning of the K2Tree)
+    void serializeShard(std::ostream& out, const ShardManifest& manifest, size_type shard) const {
+
+        checkShard(manifest, shard);
+        write(out, manifest.getFirstPartition(shard), manifest.getFirstPartition(shard + 1));
+
+    }
+
+    // note: emptied subtrees of the partitions are only marked, compact() removes them from the internal structures
     void setNull(size_type i, size_type j) override {
 
+        this->checkWritable("setNull");
+
         auto pis = determineIndices(i, j);
-        auto p = partitions_[pis.partition];
+        auto p = partition(pis.partition);
 
         if (p != 0) {
             p->setNull(pis.row, pis.col);
@@ -1197,7 +1149,41 @@ public:
 
     }
 
-    size_type getFirstSuccessor(size_type i) override {
+    void compact() override {
+
+        this->checkWritable("compact");
+
+        for (size_type k = 0; k < numPartitions_; k++) {
+
+            auto p = partition(k);
+            if (p != 0) {
+                p->compact();
+            }
+
+        }
+
+    }
+
+    // (partitions not yet deserialised from a file opened via mapFile() are not included)
+    SizeBreakdown sizeInBytes() const override {
+
+        SizeBreakdown s;
+        for (size_type k = 0; k < numPartitions_; k++) {
+
+            if (isAvailable(k) && (partitions_[k] != 0)) {
+                s += partitions_[k]->sizeInBytes();
+            }
+
+        }
+
+        s.partitions += numPartitions_ * sizeof(partitions_[0]) + ((offsets_ != 0) ? numPartitions_ * sizeof(offsets_[0]) : 0);
+        s.other += sizeof(*this);
+
+        return s;
+
+    }
+
+    size_type getFirstSuccessor(size_type i) const override {
 
         size_type pos = numCols_;
 
@@ -1206,7 +1192,7 @@ public:
             size_type offset = 0;
             for (size_type k = 0; k < numPartitions_ && pos == numCols_; k++, offset += partitionSize_) {
 
-                auto p = partitions_[k];
+                auto p = partition(k);
                 if (p != 0) {
 
                     auto tmp = p->getFirstSuccessor(i);
@@ -1221,7 +1207,7 @@ public:
         } else {
 
             auto pis = determineIndices(i, 0);
-            auto p = partitions_[pis.partition];
+            auto p = partition(pis.partition);
             if (p != 0) {
                 pos = p->getFirstSuccessor(pis.row);
             }
@@ -1232,36 +1218,107 @@ public:
 
     }
 
+    std::vector<size_type> expandFrontier(const std::vector<size_type>& frontier, std::vector<bool>& visited) const override {
+
+        auto rows = this->prepareFrontier(frontier, visited);
+        std::vector<size_type> cols;
+
+        if (hc_ > hr_) {
+
+            // every partition covers all rows: expand the whole frontier in every partition
+            size_type offset = 0;
+            for (size_type k = 0; k < numPartitions_; k++, offset += partitionSize_) {
+
+                auto p = partition(k);
+                if (p != 0) {
+
+                    for (auto j : p->expandFrontier(rows)) {
+                        this->addToFrontier(j + offset, cols, visited);
+                    }
+
+                }
+
+            }
+
+        } else {
+
+            // every partition covers a range of rows: route the (sorted) rows of the frontier to the partitions in bulk
+            std::vector<size_type> local;
+            for (size_type x = 0; x < rows.size();) {
+
+                size_type k = rows[x] / partitionSize_;
+
+                local.clear();
+                for (; (x < rows.size()) && (rows[x] / partitionSize_ == k); x++) {
+                    local.push_back(rows[x] % partitionSize_);
+                }
+
+                auto p = (k < numPartitions_) ? partition(k) : 0;
+                if (p != 0) {
+
+                    for (auto j : p->expandFrontier(local)) {
+                        this->addToFrontier(j, cols, visited);
+                    }
+
+                }
+
+            }
+
+        }
+
+        this->finishFrontier(cols, visited);
+
+        return cols;
+
+    }
+
 
     /*
      * Method aliases using "relation nomenclature" (similar to the names proposed by Brisaboa et al.)
      */
 
-    bool areRelated(size_type i, size_type j) override {
+    bool areRelated(size_type i, size_type j) const override {
         return isNotNull(i, j);
     }
 
-    std::vector<size_type> getSuccessors(size_type i) override {
+    std::vector<size_type> getSuccessors(size_type i) const override {
         return getSuccessorPositions(i);
     }
 
-    std::vector<size_type> getPredecessors(size_type j) override {
+    std::vector<size_type> getPredecessors(size_type j) const override {
         return getPredecessorPositions(j);
     }
 
-    positions_type getRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    positions_type getRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
         return getPositionsInRange(i1, i2, j1, j2);
     }
 
-    bool containsLink(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    bool containsLink(size_type i1, size_type i2, size_type j1, size_type j2) const override {
         return containsElement(i1, i2, j1, j2);
     }
 
-    size_type countLinks() override {
+    size_type countLinks() const override {
         return countElements();
     }
 
 
+    /*
+     * Concurrent execution of queries spanning several partitions
+     */
+
+    // lets the queries touching several partitions (ranges over several partitions, rows / columns crossing all partitions,
+    // batches of positions) query these partitions concurrently on the given workers (0 for sequential execution, the default),
+    // the results are the same (and in the same order) as without workers: the answers of the partitions are concatenated in partition order,
+    // which is not row-major if the partitions cover ranges of columns, and every partition answers in the order of its KrKcTree
+    void setWorkerPool(const std::shared_ptr<WorkerPool>& pool) {
+        pool_ = pool;
+    }
+
+    const std::shared_ptr<WorkerPool>& getWorkerPool() const {
+        return pool_;
+    }
+
+
 
 private:
     size_type hr_; // row height of the K2Tree
@@ -1274,137 +1331,479 @@ private:
     KrKcTree<elem_type>** partitions_; // representations of the partitions / submatrices
     size_type partitionSize_; // number of rows (columns) per partition in a vertical (horizontal) partitioning
     size_type numPartitions_; // number of partitions
+    std::shared_ptr<WorkerPool> pool_; // workers querying several partitions concurrently (0 for sequential queries)
 
     elem_type null_; // null element
 
+    MappedFile* mapping_ = 0; // file the K2Tree has been opened from via mapFile() (0 if none)
+    std::atomic<size_type>* offsets_ = 0; // positions of the not yet deserialised partitions within mapping_ (0 for partitions that are empty or already available)
+    mutable std::mutex offsetsMutex_; // serialises the first deserialisation of partitions by concurrent queries
+
 
     /* helper methods for mapping (overall) indices to positions in the partitions */
 
-    size_type determinePartition(size_type i, size_type j) {
+    size_type determinePartition(size_type i, size_type j) const {
         return (hc_ > hr_) ? (j / partitionSize_) : (i / partitionSize_);
     }
 
-    PartitionIndices determineIndices(size_type i, size_type j) {
+    PartitionIndices determineIndices(size_type i, size_type j) const {
         return (hc_ > hr_) ? PartitionIndices(j / partitionSize_, i, j % partitionSize_) : PartitionIndices(i / partitionSize_, i % partitionSize_, j);
     }
 
-    /* helper methods for inplace construction from single list of pairs */
+    /* helper method for batch queries (isNotNull() / getElement() on several positions) */
 
-    size_type computeKey(const typename pairs_type::value_type& pair, const Subproblem& sp, size_type widthRow, size_type widthCol) {
-        return ((pair.row - sp.firstRow) / widthRow) + (pair.col - sp.firstCol) / widthCol;
-    }
+    // groups the queries by partition and calls f(p, local, idx) for every non-empty partition p
+    // that is hit by at least one query, local[x] is the relative position of query idx[x] in p
+    // (f may be called concurrently for different partitions, see setWorkerPool())
+    template<typename F>
+    void batchByPartition(const positions_type& queries, F f) const {
 
-    void countingSort(pairs_type& pairs, std::vector<std::pair<size_type, size_type>>& intervals, const Subproblem& sp, size_type widthRow, size_type widthCol, size_type sup) {
+        std::vector<size_type> bounds(numPartitions_ + 1, 0);
+        std::vector<PartitionIndices> pis(queries.size());
 
-        std::vector<size_type> counts(sup);
+        for (size_type x = 0; x < queries.size(); x++) {
+            pis[x] = determineIndices(queries[x].first, queries[x].second);
+            bounds[pis[x].partition + 1]++;
+        }
 
-        // determine key frequencies
-        for (auto i = sp.left; i < sp.right; i++) {
-            counts[computeKey(pairs[i], sp, widthRow, widthCol)]++;
+        for (size_type k = 0; k < numPartitions_; k++) {
+            bounds[k + 1] += bounds[k];
         }
 
-        // determine starting index for each key
-        size_type total = 0;
-        size_type tmp;
+        std::vector<size_type> order(queries.size());
+        positions_type local(queries.size());
+        std::vector<size_type> next(bounds.begin(), bounds.end() - 1);
 
-        for (auto key = 0; key < sup; key++) {
+        for (size_type x = 0; x < queries.size(); x++) {
+            auto y = next[pis[x].partition]++;
+            order[y] = x;
+            local[y] = std::make_pair(pis[x].row, pis[x].col);
+        }
 
-            tmp = counts[key];
-            counts[key] = total;
-            total += tmp;
+        forEachPartition(0, numPartitions_, [&](size_type k) {
 
-            intervals[key].first = counts[key];
-            intervals[key].second = total;
+            if (bounds[k] < bounds[k + 1]) {
+
+                auto p = partition(k);
+
+                if (p != 0) {
+                    positions_type part(local.begin() + bounds[k], local.begin() + bounds[k + 1]);
+                    f(p, part, order.data() + bounds[k]);
+                }
+
+            }
+
+        });
+
+    }
+
+    /* helper methods for queries spanning several partitions */
+
+    // calls f(k) for all partitions k in [first, last), concurrently if a worker pool has been set
+    void forEachPartition(size_type first, size_type last, const std::function<void(size_type)>& f) const {
 
+        if (pool_) {
+            pool_->run(first, last, f);
+        } else {
+            for (size_type k = first; k < last; k++) {
+                f(k);
+            }
         }
 
-        // reorder pairs of current subproblem
-        pairs_type tmpPairs(sp.right - sp.left + 1);
-        for (auto i = sp.left; i < sp.right; i++) {
+    }
 
-            tmpPairs[counts[computeKey(pairs[i], sp, widthRow, widthCol)]] = pairs[i];
-            counts[computeKey(pairs[i], sp, widthRow, widthCol)]++;
+    // returns the concatenation of f(p, k) over all non-empty partitions p = partition(k), k in [first, last), in the order of k
+    // (not merged by (row, column), f may be called concurrently for different partitions)
+    template<typename V, typename F>
+    V gatherPartitions(size_type first, size_type last, F f) const {
 
+        std::vector<V> parts(last - first);
+        forEachPartition(first, last, [&](size_type k) {
+
+            auto p = partition(k);
+            if (p != 0) {
+                parts[k - first] = f(p, k);
+            }
+
+        });
+
+        size_type num = 0;
+        for (auto& part : parts) {
+            num += part.size();
         }
 
-        for (auto i = sp.left; i < sp.right; i++) {
-            pairs[i] = tmpPairs[i - sp.left];
+        V res;
+        res.reserve(num);
+        for (auto& part : parts) {
+            res.insert(res.end(), part.begin(), part.end());
         }
 
+        return res;
+
     }
 
-};
+    /* helper methods for accessing / reading the partitions */
 
+    // returns the k-th partition (deserialises it first if the K2Tree has been opened via mapFile() and the partition has not been accessed yet)
+    KrKcTree<elem_type>* partition(size_type k) const {
 
-/**
- * Bool specialisation of UnevenKrKcTree.
- *
- * Has the same characteristics as the general implementation above,
- * but makes use of some simplifications since the only non-null value is 1 / true.
- */
-template<>
-class UnevenKrKcTree<bool> : public virtual K2Tree<bool> {
+        K2TREES_COUNT(partitionsTouched);
 
-public:
-    typedef bool elem_type;
+        // only the first access to a partition takes the lock (double-checked, partitions_[k] is published by the release store)
+        if (!isAvailable(k)) {
 
-    typedef typename K2Tree<elem_type>::matrix_type matrix_type;
-    typedef typename K2Tree<elem_type>::list_type list_type;
-    typedef typename K2Tree<elem_type>::positions_type positions_type;
-    typedef typename K2Tree<elem_type>::pairs_type pairs_type;
+            std::lock_guard<std::mutex> lock(offsetsMutex_);
 
+            size_type pos = offsets_[k].load(std::memory_order_relaxed);
+            if (pos != 0) {
 
-    UnevenKrKcTree() {
+                MemoryStreamBuffer buf(mapping_->data() + pos, mapping_->size() - pos);
+                std::istream in(&buf);
 
-        partitions_ = 0;
-        numPartitions_ = 0;
+                readPartition(in, k, true);
+                offsets_[k].store(0, std::memory_order_release);
+
+            }
+
+        }
+
+        return partitions_[k];
 
     }
 
-    UnevenKrKcTree(const UnevenKrKcTree& other) {
+    // returns whether the k-th partition can be accessed without deserialising it first
+    bool isAvailable(size_type k) const {
+        return (offsets_ == 0) || (offsets_[k].load(std::memory_order_acquire) == 0);
+    }
 
-        hr_ = other.hr_;
-        hc_ = other.hc_;
-        kr_ = other.kr_;
-        kc_ = other.kc_;
-        numRows_ = other.numRows_;
-        numCols_ = other.numCols_;
-        null_ = other.null_;
+    // reads the entry of the k-th partition as written by serialize() (format version 5 or higher prefixes the partition with its length)
+    void readPartition(std::istream& in, size_type k, bool withLength) const {
 
-        partitions_ = new KrKcTree<elem_type>*[other.numPartitions_];
-        for (size_type k = 0; k < other.numPartitions_; k++) {
-            partitions_[k] = new KrKcTree<elem_type>(*other.partitions_[k]);
+        bool present;
+        readValue(in, present);
+
+        if (present) {
+
+            if (withLength) {
+                size_type length;
+                readValue(in, length); // only needed for skipping the partition
+            }
+
+            partitions_[k] = new KrKcTree<elem_type>();
+            partitions_[k]->load(in);
+
+        } else {
+            partitions_[k] = 0;
         }
-        partitionSize_ = other.partitionSize_;
-        numPartitions_ = other.numPartitions_;
 
     }
 
-    UnevenKrKcTree& operator=(const UnevenKrKcTree& other) {
+    // writes the K2Tree as serialize() does, but with the partitions outside of first, ..., last - 1 as empty ones
+    void write(std::ostream& out, size_type first, size_type last) const {
 
-        // check for self-assignment
-        if (&other == this) {
-            return *this;
-        }
+        writeHeader(out, "UnevenKrKcTree", sizeof(elem_type));
 
-        hr_ = other.hr_;
-        hc_ = other.hc_;
-        kr_ = other.kr_;
-        kc_ = other.kc_;
-        numRows_ = other.numRows_;
-        numCols_ = other.numCols_;
-        null_ = other.null_;
+        writeValue(out, hr_);
+        writeValue(out, hc_);
+        writeValue(out, kr_);
+        writeValue(out, kc_);
+        writeValue(out, numRows_);
+        writeValue(out, numCols_);
+        writeValue(out, partitionSize_);
+        writeValue(out, numPartitions_);
+        writeValue(out, null_);
 
         for (size_type k = 0; k < numPartitions_; k++) {
-            delete partitions_[k];
-        }
+
+            auto p = ((first <= k) && (k < last)) ? partition(k) : 0;
+
+            writeValue(out, (bool) (p != 0));
+            if (p != 0) {
+
+                // prefix each partition with its length so that mapFile() can skip it
+                std::ostringstream buf;
+                p->serialize(buf);
+                std::string bytes = buf.str();
+
+                writeValue(out, (size_type) bytes.size());
+                out.write(bytes.data(), bytes.size());
+
+            }
+
+        }
+
+    }
+
+    // replaces the contents of the K2Tree with those read from the stream,
+    // where a non-zero mapping (backing the stream) leads to partitions being only located instead of deserialised
+    void read(std::istream& in, MappedFile* mapping) {
+
+        for (size_type k = 0; k < numPartitions_; k++) {
+            delete partitions_[k];
+        }
+        delete[] partitions_;
+        releaseMapping();
+
+        partitions_ = 0;
+        numPartitions_ = 0;
+        mapping_ = mapping;
+
+        unsigned int version = readHeader(in, "UnevenKrKcTree", sizeof(elem_type));
+
+        readValue(in, hr_);
+        readValue(in, hc_);
+        readValue(in, kr_);
+        readValue(in, kc_);
+        readValue(in, numRows_);
+        readValue(in, numCols_);
+        readValue(in, partitionSize_);
+        readValue(in, numPartitions_);
+        readValue(in, null_);
+
+        partitions_ = new KrKcTree<elem_type>*[numPartitions_];
+        // the partitions of files older than format version 5 cannot be skipped (no lengths), so they are deserialised right away
+        bool lazy = (mapping_ != 0) && (version >= 5);
+        if (lazy) {
+            offsets_ = new std::atomic<size_type>[numPartitions_];
+        }
+
+        for (size_type k = 0; k < numPartitions_; k++) {
+
+            if (!lazy) {
+                readPartition(in, k, version >= 5);
+            } else {
+
+                size_type pos = in.tellg();
+                bool present;
+                readValue(in, present);
+
+                partitions_[k] = 0;
+                offsets_[k] = 0;
+
+                if (present) {
+
+                    size_type length;
+                    readValue(in, length);
+                    in.seekg(length, std::ios_base::cur);
+
+                    offsets_[k] = pos;
+
+                }
+
+            }
+
+        }
+
+        if (!lazy) {
+            releaseMapping(); // everything has been deserialised, the mapping is not needed anymore
+        }
+
+    }
+
+    void releaseMapping() {
+
+        delete mapping_;
+        delete[] offsets_;
+
+        mapping_ = 0;
+        offsets_ = 0;
+
+    }
+
+    /* helper methods for building (a subset of) the partitions */
+
+    // builds the partitions first, ..., last - 1 from the first numPairs pairs (which have to lie within these partitions),
+    // all other partitions are empty
+    void buildPartitions(pairs_type& pairs, size_type numPairs, size_type first, size_type last, size_type numThreads) {
+
+        partitions_ = new KrKcTree<elem_type>*[numPartitions_];
+        std::fill(partitions_, partitions_ + numPartitions_, (KrKcTree<elem_type>*) 0);
+
+        Subproblem sp(0, numRows_ - 1, 0, numCols_ - 1, 0, numPairs);
+        std::vector<std::pair<size_type, size_type>> intervals(numPartitions_);
+
+        if (hc_ > hr_) {
+
+            countingSort(pairs, intervals, sp, numRows_, partitionSize_, numPartitions_);
+
+            parallelFor(last - first, numThreads, [&](size_type x) {
+
+                size_type i = first + x;
+                partitions_[i] = new KrKcTree<elem_type>(pairs, 0, i * partitionSize_, numRows_, partitionSize_, intervals[i].first, intervals[i].second, kr_, kc_, null_);
+
+            });
+
+        } else {
+
+            countingSort(pairs, intervals, sp, partitionSize_, numCols_, numPartitions_);
+
+            parallelFor(last - first, numThreads, [&](size_type x) {
+
+                size_type j = first + x;
+                partitions_[j] = new KrKcTree<elem_type>(pairs, j * partitionSize_, 0, partitionSize_, numCols_, intervals[j].first, intervals[j].second, kr_, kc_, null_);
+
+            });
+
+        }
+
+#if 1
+        for (size_type k = first; k < last; k++) {
+
+            if (partitions_[k]->getNumRows() == 0) {
+
+                delete partitions_[k];
+                partitions_[k] = 0;
+
+            }
+
+        }
+#endif
+
+    }
+
+    // throws a std::runtime_error unless manifest describes the partitioning of the K2Tree and contains the given shard
+    void checkShard(const ShardManifest& manifest, size_type shard) const {
+
+        if ((manifest.getNumRows() != numRows_) || (manifest.getNumCols() != numCols_)
+            || (manifest.getPartitionSize() != partitionSize_) || (manifest.getNumPartitions() != numPartitions_)) {
+            throw std::runtime_error("Shard manifest does not match the partitioning of the K2Tree.");
+        }
+
+        if (shard >= manifest.getNumShards()) {
+            throw std::runtime_error("Shard " + std::to_string(shard) + " does not exist (the manifest has " + std::to_string(manifest.getNumShards()) + " shards).");
+        }
+
+    }
+
+    /* helper methods for inplace construction from single list of pairs */
+
+    size_type computeKey(const typename pairs_type::value_type& pair, const Subproblem& sp, size_type widthRow, size_type widthCol) {
+        return ((pair.row - sp.firstRow) / widthRow) + (pair.col - sp.firstCol) / widthCol;
+    }
+
+    void countingSort(pairs_type& pairs, std::vector<std::pair<size_type, size_type>>& intervals, const Subproblem& sp, size_type widthRow, size_type widthCol, size_type sup) {
+
+        std::vector<size_type> counts(sup);
+
+        // determine key frequencies
+        for (auto i = sp.left; i < sp.right; i++) {
+            counts[computeKey(pairs[i], sp, widthRow, widthCol)]++;
+        }
+
+        // determine starting index for each key
+        size_type total = 0;
+        size_type tmp;
+
+        for (auto key = 0; key < sup; key++) {
+
+            tmp = counts[key];
+            counts[key] = total;
+            total += tmp;
+
+            intervals[key].first = counts[key];
+            intervals[key].second = total;
+
+        }
+
+        // reorder pairs of current subproblem
+        pairs_type tmpPairs(sp.right - sp.left + 1);
+        for (auto i = sp.left; i < sp.right; i++) {
+
+            tmpPairs[counts[computeKey(pairs[i], sp, widthRow, widthCol)]] = pairs[i];
+            counts[computeKey(pairs[i], sp, widthRow, widthCol)]++;
+
+        }
+
+        for (auto i = sp.left; i < sp.right; i++) {
+            pairs[i] = tmpPairs[i - sp.left];
+        }
+
+    }
+
+};
+
+
+/**
+ * Bool specialisation of UnevenKrKcTree.
+ *
+ * Has the same characteristics as the general implementation above,
+ * but makes use of some simplifications since the only non-null value is 1 / true.
+ */
+template<>
+class UnevenKrKcTree<bool> : public virtual K2Tree<bool> {
+
+public:
+    typedef bool elem_type;
+
+    typedef typename K2Tree<elem_type>::matrix_type matrix_type;
+    typedef typename K2Tree<elem_type>::list_type list_type;
+    typedef typename K2Tree<elem_type>::positions_type positions_type;
+    typedef typename K2Tree<elem_type>::pairs_type pairs_type;
+
+    // output-buffer and limited variants of the query methods (see K2Tree)
+    using K2Tree<elem_type>::getSuccessorPositions;
+    using K2Tree<elem_type>::getPredecessorPositions;
+    using K2Tree<elem_type>::getPositionsInRange;
+    using K2Tree<elem_type>::getAllValuedPositions;
+    using K2Tree<elem_type>::getSuccessors;
+    using K2Tree<elem_type>::getRange;
+    using K2Tree<elem_type>::expandFrontier;
+
+
+    UnevenKrKcTree() {
+
+        partitions_ = 0;
+        numPartitions_ = 0;
+
+    }
+
+    UnevenKrKcTree(const UnevenKrKcTree& other) {
+
+        hr_ = other.hr_;
+        hc_ = other.hc_;
+        kr_ = other.kr_;
+        kc_ = other.kc_;
+        numRows_ = other.numRows_;
+        numCols_ = other.numCols_;
+        null_ = other.null_;
+
+        partitions_ = new KrKcTree<elem_type>*[other.numPartitions_];
+        for (size_type k = 0; k < other.numPartitions_; k++) {
+            partitions_[k] = (other.partition(k) != 0) ? new KrKcTree<elem_type>(*other.partition(k)) : 0;
+        }
+        partitionSize_ = other.partitionSize_;
+        numPartitions_ = other.numPartitions_;
+        pool_ = other.pool_;
+
+    }
+
+    UnevenKrKcTree& operator=(const UnevenKrKcTree& other) {
+
+        // check for self-assignment
+        if (&other == this) {
+            return *this;
+        }
+
+        hr_ = other.hr_;
+        hc_ = other.hc_;
+        kr_ = other.kr_;
+        kc_ = other.kc_;
+        numRows_ = other.numRows_;
+        numCols_ = other.numCols_;
+        null_ = other.null_;
+
+        for (size_type k = 0; k < numPartitions_; k++) {
+            delete partitions_[k];
+        }
         delete[] partitions_;
+        releaseMapping();
         partitions_ = new KrKcTree<elem_type>*[other.numPartitions_];
         for (size_type k = 0; k < other.numPartitions_; k++) {
-            partitions_[k] = new KrKcTree<elem_type>(*other.partitions_[k]);
+            partitions_[k] = (other.partition(k) != 0) ? new KrKcTree<elem_type>(*other.partition(k)) : 0;
         }
         partitionSize_ = other.partitionSize_;
         numPartitions_ = other.numPartitions_;
+        pool_ = other.pool_;
 
         return *this;
 
@@ -1530,8 +1929,10 @@ public:
 
     /**
      * List-of-pairs-based constructor (based on section 3.3.5. of Brisaboa et al.)
+     *
+     * The (independent) partitions are built concurrently by up to numThreads threads.
      */
-    UnevenKrKcTree(positions_type& pairs, const size_type kr, const size_type kc) {
+    UnevenKrKcTree(positions_type& pairs, const size_type kr, const size_type kc, const size_type numThreads = 1) {
 
         null_ = false;
 
@@ -1555,45 +1956,60 @@ public:
 
             partitionSize_ = size_type(pow(kc_, hr_));
             numPartitions_ = numCols_ / partitionSize_;
-            partitions_ = new KrKcTree<elem_type>*[numPartitions_];
-
-            Subproblem sp(0, numRows_ - 1, 0, numCols_ - 1, 0, pairs.size());
-            std::vector<std::pair<size_type, size_type>> intervals(numPartitions_);
-            countingSort(pairs, intervals, sp, numRows_, partitionSize_, numPartitions_);
-
-            for (size_type i = 0; i < numPartitions_; i++) {
-                partitions_[i] = new KrKcTree<elem_type>(pairs, 0, i * partitionSize_, numRows_, partitionSize_, intervals[i].first, intervals[i].second, kr_, kc_);
-            }
-
 
         } else {
 
             partitionSize_ = size_type(pow(kr_, hc_));
             numPartitions_ = numRows_ / partitionSize_;
-            partitions_ = new KrKcTree<elem_type>*[numPartitions_];
 
-            Subproblem sp(0, numRows_ - 1, 0, numCols_ - 1, 0, pairs.size());
-            std::vector<std::pair<size_type, size_type>> intervals(numPartitions_);
-            countingSort(pairs, intervals, sp, partitionSize_, numCols_, numPartitions_);
+        }
 
-            for (size_type j = 0; j < numPartitions_; j++) {
-                partitions_[j] = new KrKcTree<elem_type>(pairs, j * partitionSize_, 0, partitionSize_, numCols_, intervals[j].first, intervals[j].second, kr_, kc_);
-            }
+        buildPartitions(pairs, pairs.size(), 0, numPartitions_, numThreads);
 
-        }
+    }
 
-#if 1
-        for (size_type k = 0; k < numPartitions_; k++) {
+    /**
+     * Sharding constructor: builds the given shard of the relation described by manifest (see ShardManifest),
+     * i.e. an UnevenKrKcTree with the dimensions of the whole relation consisting only of the partitions of this shard.
+     *
+     * pairs may contain pairs of other shards, which are ignored (but moved to the end of pairs).
+     * Throws a std::runtime_error if the shard does not exist or some pair lies outside of the relation matrix.
+     */
+    UnevenKrKcTree(positions_type& pairs, const ShardManifest& manifest, const size_type shard, const size_type numThreads = 1) {
 
-            if (partitions_[k]->getNumRows() == 0) {
+        null_ = false;
 
-                delete partitions_[k];
-                partitions_[k] = 0;
+        kr_ = manifest.getKr();
+        kc_ = manifest.getKc();
+        numRows_ = manifest.getNumRows();
+        numCols_ = manifest.getNumCols();
+        hr_ = logK(numRows_, kr_);
+        hc_ = logK(numCols_, kc_);
+        partitionSize_ = manifest.getPartitionSize();
+        numPartitions_ = manifest.getNumPartitions();
+
+        checkShard(manifest, shard);
+
+        for (auto& p : pairs) {
 
+            if ((p.first >= numRows_) || (p.second >= numCols_)) {
+                throw std::runtime_error("Pair (" + std::to_string(p.first) + ", " + std::to_string(p.second) + ") lies outside of the relation described by the shard manifest.");
             }
 
         }
-#endif
+
+        // rows (columns) of the shard
+        size_type first = manifest.getFirstPartition(shard) * partitionSize_;
+        size_type last = manifest.getFirstPartition(shard + 1) * partitionSize_;
+
+        auto end = std::partition(pairs.begin(), pairs.end(), [&](const typename positions_type::value_type& p) {
+
+            size_type x = (hc_ > hr_) ? p.second : p.first;
+            return (first <= x) && (x < last);
+
+        });
+
+        buildPartitions(pairs, end - pairs.begin(), manifest.getFirstPartition(shard), manifest.getFirstPartition(shard + 1), numThreads);
 
     }
 
@@ -1603,80 +2019,75 @@ public:
             delete partitions_[k];
         }
         delete[] partitions_;
+        releaseMapping();
 
     }
 
 
     // returns the row height of the K2Tree
-    size_type getHr() {
+    size_type getHr() const {
         return hr_;
     }
 
     // returns the column height of the K2Tree
-    size_type getHc() {
+    size_type getHc() const {
         return hc_;
     }
 
     // returns the row arity of the K2Tree
-    size_type getKr() {
+    size_type getKr() const {
         return kr_;
     }
 
     // returns the column arity of the K2Tree
-    size_type getKc() {
+    size_type getKc() const {
         return kc_;
     }
 
-    size_type getNumRows() override {
+    size_type getNumRows() const override {
         return numRows_;
     }
 
-    size_type getNumCols() override {
+    size_type getNumCols() const override {
         return numCols_;
     }
 
-    elem_type getNull() override {
+    elem_type getNull() const override {
         return null_;
     }
 
 
-    bool areRelated(size_type i, size_type j) override {
+    bool areRelated(size_type i, size_type j) const override {
 
         auto pis = determineIndices(i, j);
-        auto p = partitions_[pis.partition];
+        auto p = partition(pis.partition);
 
         return (p != 0) && p->areRelated(pis.row, pis.col);
 
     }
 
-    std::vector<size_type> getSuccessors(size_type i) override {
+    std::vector<size_type> getSuccessors(size_type i) const override {
 
         std::vector<size_type> succs;
 
         if (hc_ > hr_) {
 
-            size_type offset = 0;
-            for (size_type k = 0; k < numPartitions_; k++, offset += partitionSize_) {
-
-                auto p = partitions_[k];
-                if (p != 0) {
-
-                    auto tmp = p->getSuccessors(i);
-                    for (size_type l = 0; l < tmp.size(); l++) {
-                        tmp[l] += offset;
-                    }
-
-                    succs.reserve(succs.size() + tmp.size());
-                    std::move(tmp.begin(), tmp.end(), std::back_inserter(succs));
+            // (queried concurrently if a worker pool is set, see setWorkerPool())
+            succs = gatherPartitions<std::vector<size_type>>(0, numPartitions_, [&](KrKcTree<elem_type>* p, size_type k) -> std::vector<size_type> {
 
+                auto tmp = p->getSuccessors(i);
+                for (size_type l = 0; l < tmp.size(); l++) {
+                    tmp[l] += k * partitionSize_;
                 }
 
-            }
+                return tmp;
+
+            });
 
         } else {
 
             auto pis = determineIndices(i, 0);
-            auto p = partitions_[pis.partition];
+            auto p = partition(pis.partition);
             if (p != 0) {
                 succs = p->getSuccessors(pis.row);
             }
@@ -1687,34 +2098,28 @@ public:
 
     }
 
-    std::vector<size_type> getPredecessors(size_type j) override {
+    std::vector<size_type> getPredecessors(size_type j) const override {
 
         std::vector<size_type> preds;
 
         if (hc_ < hr_) {
 
-            size_type offset = 0;
-            for (size_type k = 0; k < numPartitions_; k++, offset += partitionSize_) {
-
-                auto p = partitions_[k];
-                if (p != 0) {
-
-                    auto tmp = p->getPredecessors(j);
-                    for (size_type l = 0; l < tmp.size(); l++) {
-                        tmp[l] += offset;
-                    }
-
-                    preds.reserve(preds.size() + tmp.size());
-                    std::move(tmp.begin(), tmp.end(), std::back_inserter(preds));
+            // (queried concurrently if a worker pool is set, see setWorkerPool())
+            preds = gatherPartitions<std::vector<size_type>>(0, numPartitions_, [&](KrKcTree<elem_type>* p, size_type k) -> std::vector<size_type> {
 
+                auto tmp = p->getPredecessors(j);
+                for (size_type l = 0; l < tmp.size(); l++) {
+                    tmp[l] += k * partitionSize_;
                 }
 
-            }
+                return tmp;
+
+            });
 
         } else {
 
             auto pis = determineIndices(0, j);
-            auto p = partitions_[pis.partition];
+            auto p = partition(pis.partition);
             if (p != 0) {
                 preds = p->getPredecessors(pis.col);
             }
@@ -1725,7 +2130,7 @@ public:
 
     }
 
-    positions_type getRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    positions_type getRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
 
         positions_type elements;
 
@@ -1735,7 +2140,7 @@ public:
         // range falls completely within one partition
         if (upperLeft.partition == lowerRight.partition) {
 
-            auto p = partitions_[upperLeft.partition];
+            auto p = partition(upperLeft.partition);
             if (p != 0) {
 
                 elements = p->getRange(upperLeft.row, lowerRight.row, upperLeft.col, lowerRight.col);
@@ -1762,113 +2167,38 @@ public:
 
         }
 
-        // range spans multiple partitions
-        std::vector<positions_type> tmp;
-        tmp.reserve(lowerRight.partition - upperLeft.partition + 1);
-        size_type offset = partitionSize_ * upperLeft.partition;
+        // range spans multiple partitions (queried concurrently if a worker pool is set, see setWorkerPool())
+        return gatherPartitions<positions_type>(upperLeft.partition, lowerRight.partition + 1, [&](KrKcTree<elem_type>* p, size_type k) -> positions_type {
 
-        if (hc_ > hr_) {
+            size_type from = (k == upperLeft.partition) ? ((hc_ > hr_) ? upperLeft.col : upperLeft.row) : 0;
+            size_type to = (k == lowerRight.partition) ? ((hc_ > hr_) ? lowerRight.col : lowerRight.row) : partitionSize_ - 1;
 
-            // first partition (partially spanned)
-            auto p = partitions_[upperLeft.partition];
-            if (p != 0) {
-
-                tmp.push_back(p->getRange(upperLeft.row, lowerRight.row, upperLeft.col, partitionSize_ - 1));
-                for (auto& e : tmp.back()) {
-                    e.second += offset;
-                }
-
-            }
-
-            // intermediate partition (fully spanned, if any)
-            offset += partitionSize_;
-            for (size_type k = upperLeft.partition + 1; k < lowerRight.partition; k++, offset += partitionSize_) {
-
-                p = partitions_[k];
-                if (p != 0) {
-
-                    tmp.push_back(p->getRange(upperLeft.row, lowerRight.row, 0, partitionSize_ - 1));
-                    for (auto& e : tmp.back()) {
-                        e.second += offset;
-                    }
-
-                }
-
-            }
+            positions_type res;
+            size_type offset = partitionSize_ * k;
 
-            // last partition (partially spanned)
-            p = partitions_[lowerRight.partition];
-            if (p != 0) {
+            if (hc_ > hr_) {
 
-                tmp.push_back(p->getRange(upperLeft.row, lowerRight.row, 0, lowerRight.col));
-                for (auto& e : tmp.back()) {
+                res = p->getRange(upperLeft.row, lowerRight.row, from, to);
+                for (auto& e : res) {
                     e.second += offset;
                 }
 
-            }
-
-        } else {
-
-            // first partition (partially spanned)
-            auto p = partitions_[upperLeft.partition];
-            if (p != 0) {
-
-                tmp.push_back(p->getRange(upperLeft.row, partitionSize_ - 1, upperLeft.col, lowerRight.col));
-                for (auto& e : tmp.back()) {
-                    e.first += offset;
-                }
-
-            }
-
-            // intermediate partition (fully spanned, if any)
-            offset += partitionSize_;
-            for (size_type k = upperLeft.partition + 1; k < lowerRight.partition; k++, offset += partitionSize_) {
-
-                p = partitions_[k];
-                if (p != 0) {
-
-                    tmp.push_back(p->getRange(0, partitionSize_ - 1, upperLeft.col, lowerRight.col));
-                    for (auto& e : tmp.back()) {
-                        e.first += offset;
-                    }
-
-                }
-
-            }
-
-            // last partition (partially spanned)
-            p = partitions_[lowerRight.partition];
-            if (p != 0) {
+            } else {
 
-                tmp.push_back(p->getRange(0, lowerRight.row, upperLeft.col, lowerRight.col));
-                for (auto& e : tmp.back()) {
+                res = p->getRange(from, to, upperLeft.col, lowerRight.col);
+                for (auto& e : res) {
                     e.first += offset;
                 }
 
             }
 
-        }
-
-        // flatten results
-        size_type toReserve = elements.size();
-        for (auto& v : tmp) {
-            toReserve += v.size();
-        }
-        elements.reserve(toReserve);
-
-        for (auto& v : tmp) {
-
-            std::move(v.begin(), v.end(), std::back_inserter(elements));
-            v.clear();
-            v.shrink_to_fit();
-
-        }
+            return res;
 
-        return elements;
+        });
 
     }
 
-    bool containsLink(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    bool containsLink(size_type i1, size_type i2, size_type j1, size_type j2) const override {
 
         auto upperLeft = determineIndices(i1, j1);
         auto lowerRight = determineIndices(i2, j2);
@@ -1877,7 +2207,7 @@ public:
         // range falls completely within one partition
         if (upperLeft.partition == lowerRight.partition) {
 
-            auto p = partitions_[upperLeft.partition];
+            auto p = partition(upperLeft.partition);
             return (p != 0) && p->containsLink(upperLeft.row, lowerRight.row, upperLeft.col, lowerRight.col);
 
         }
@@ -1888,37 +2218,37 @@ public:
         if (hc_ > hr_) {
 
             // first partition (partially spanned)
-            auto p = partitions_[upperLeft.partition];
+            auto p = partition(upperLeft.partition);
             found = (p != 0) && p->containsLink(upperLeft.row, lowerRight.row, upperLeft.col, partitionSize_ - 1);
 
             // intermediate partition (fully spanned, if any)
             for (size_type k = upperLeft.partition + 1; (k < lowerRight.partition) && !found; k++) {
 
-                p = partitions_[k];
+                p = partition(k);
                 found = (p != 0) && p->containsLink(upperLeft.row, lowerRight.row, 0, partitionSize_ - 1);
 
             }
 
             // last partition (partially spanned)
-            p = partitions_[lowerRight.partition];
+            p = partition(lowerRight.partition);
             found = found || ((p != 0) && p->containsLink(upperLeft.row, lowerRight.row, 0, lowerRight.col));
 
         } else {
 
             // first partition (partially spanned)
-            auto p = partitions_[upperLeft.partition];
+            auto p = partition(upperLeft.partition);
             found =  (p != 0) && p->containsLink(upperLeft.row, partitionSize_ - 1, upperLeft.col, lowerRight.col);
 
             // intermediate partition (fully spanned, if any)
             for (size_type k = upperLeft.partition + 1; (k < lowerRight.partition) && !found; k++) {
 
-                p = partitions_[k];
+                p = partition(k);
                 found = (p != 0) && p->containsLink(0, partitionSize_ - 1, upperLeft.col, lowerRight.col);
 
             }
 
             // last partition (partially spanned)
-            p = partitions_[lowerRight.partition];
+            p = partition(lowerRight.partition);
             found = found ||  ((p != 0) && p->containsLink(0, lowerRight.row, upperLeft.col, lowerRight.col));
 
         }
@@ -1927,12 +2257,12 @@ public:
 
     }
 
-    size_type countLinks() override {
+    size_type countLinks() const override {
 
         size_type cnt = 0;
         for (size_type k = 0; k < numPartitions_; k++) {
 
-            auto p = partitions_[k];
+            auto p = partition(k);
             cnt += (p != 0) ? p->countLinks() : 0;
 
         }
@@ -1946,23 +2276,45 @@ public:
      * General methods for completeness' sake (are redundant / useless for bool)
      */
 
-    bool isNotNull(size_type i, size_type j) override {
+    bool isNotNull(size_type i, size_type j) const override {
         return areRelated(i, j);
     }
 
-    elem_type getElement(size_type i, size_type j) override {
+    elem_type getElement(size_type i, size_type j) const override {
         return areRelated(i, j);
     }
 
-    std::vector<elem_type> getSuccessorElements(size_type i) override {
+    void isNotNull(const positions_type& queries, std::vector<bool>& out) const override {
+
+        out.assign(queries.size(), false);
+
+        // (one byte per query, as the partitions may be queried concurrently)
+        std::vector<char> found(queries.size(), false);
+        batchByPartition(queries, [&](K2Tree<bool>* p, const positions_type& local, const size_type* idx) {
+            std::vector<bool> res;
+            p->isNotNull(local, res);
+            for (size_type x = 0; x < local.size(); x++) {
+                found[idx[x]] = res[x];
+            }
+        });
+
+        out.assign(found.begin(), found.end());
+
+    }
+
+    void getElement(const positions_type& queries, std::vector<elem_type>& out) const override {
+        isNotNull(queries, out);
+    }
+
+    std::vector<elem_type> getSuccessorElements(size_type i) const override {
         return std::vector<elem_type>(getSuccessors(i).size(), true);
     }
 
-    std::vector<size_type> getSuccessorPositions(size_type i) override {
+    std::vector<size_type> getSuccessorPositions(size_type i) const override {
         return getSuccessors(i);
     }
 
-    pairs_type getSuccessorValuedPositions(size_type i) override {
+    pairs_type getSuccessorValuedPositions(size_type i) const override {
 
         auto pos = getSuccessors(i);
 
@@ -1975,15 +2327,15 @@ public:
 
     }
 
-    std::vector<elem_type> getPredecessorElements(size_type j) override {
+    std::vector<elem_type> getPredecessorElements(size_type j) const override {
         return std::vector<elem_type>(getPredecessors(j).size(), true);
     }
 
-    std::vector<size_type> getPredecessorPositions(size_type j) override {
+    std::vector<size_type> getPredecessorPositions(size_type j) const override {
         return getPredecessors(j);
     }
 
-    pairs_type getPredecessorValuedPositions(size_type j) override {
+    pairs_type getPredecessorValuedPositions(size_type j) const override {
 
         auto pos = getPredecessors(j);
 
@@ -1996,15 +2348,15 @@ public:
 
     }
 
-    std::vector<elem_type> getElementsInRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    std::vector<elem_type> getElementsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
         return std::vector<elem_type>(getRange(i1, i2, j1, j2).size(), true);
     }
 
-    positions_type getPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    positions_type getPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
         return getRange(i1, i2, j1, j2);
     }
 
-    pairs_type getValuedPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    pairs_type getValuedPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
 
         auto pos = getRange(i1, i2, j1, j2);
 
@@ -2017,15 +2369,15 @@ public:
 
     }
 
-    std::vector<elem_type> getAllElements() override {
+    std::vector<elem_type> getAllElements() const override {
         return std::vector<elem_type>(countLinks(), true);
     }
 
-    positions_type getAllPositions() override {
+    positions_type getAllPositions() const override {
         return getRange(0, numRows_ - 1, 0, numCols_ - 1);
     }
 
-    pairs_type getAllValuedPositions() override {
+    pairs_type getAllValuedPositions() const override {
 
         auto pos = getAllPositions();
 
@@ -2038,20 +2390,126 @@ public:
 
     }
 
-    bool containsElement(size_type i1, size_type i2, size_type j1, size_type j2) override {
+    bool forEachSuccessorPosition(size_type i, const std::function<bool(size_type)>& visitor) const override {
+
+        if (hc_ > hr_) {
+
+            size_type offset = 0;
+            for (size_type k = 0; k < numPartitions_; k++, offset += partitionSize_) {
+
+                auto p = partition(k);
+                if (p != 0 && !p->forEachSuccessorPosition(i, [&visitor, offset](size_type j) { return visitor(j + offset); })) {
+                    return false;
+                }
+
+            }
+
+            return true;
+
+        } else {
+
+            auto pis = determineIndices(i, 0);
+            auto p = partition(pis.partition);
+
+            return (p != 0) ? p->forEachSuccessorPosition(pis.row, visitor) : true;
+
+        }
+
+    }
+
+    bool forEachPredecessorPosition(size_type j, const std::function<bool(size_type)>& visitor) const override {
+
+        if (hc_ > hr_) {
+
+            auto pis = determineIndices(0, j);
+            auto p = partition(pis.partition);
+
+            return (p != 0) ? p->forEachPredecessorPosition(pis.col, visitor) : true;
+
+        } else {
+
+            size_type offset = 0;
+            for (size_type k = 0; k < numPartitions_; k++, offset += partitionSize_) {
+
+                auto p = partition(k);
+                if (p != 0 && !p->forEachPredecessorPosition(j, [&visitor, offset](size_type i) { return visitor(i + offset); })) {
+                    return false;
+                }
+
+            }
+
+            return true;
+
+        }
+
+    }
+
+    bool forEachValuedPositionInRange(size_type i1, size_type i2, size_type j1, size_type j2, const std::function<bool(size_type, size_type, elem_type)>& visitor) const override {
+
+        auto upperLeft = determineIndices(i1, j1);
+        auto lowerRight = determineIndices(i2, j2);
+
+        // the first and the last partition may be spanned only partially
+        for (size_type k = upperLeft.partition; k <= lowerRight.partition; k++) {
+
+            auto p = partition(k);
+            if (p == 0) continue;
+
+            size_type offset = partitionSize_ * k;
+            size_type from = (k == upperLeft.partition) ? ((hc_ > hr_) ? upperLeft.col : upperLeft.row) : 0;
+            size_type to = (k == lowerRight.partition) ? ((hc_ > hr_) ? lowerRight.col : lowerRight.row) : partitionSize_ - 1;
+
+            bool completed = (hc_ > hr_)
+                    ? p->forEachValuedPositionInRange(upperLeft.row, lowerRight.row, from, to, [&visitor, offset](size_type i, size_type j, elem_type val) { return visitor(i, j + offset, val); })
+                    : p->forEachValuedPositionInRange(from, to, upperLeft.col, lowerRight.col, [&visitor, offset](size_type i, size_type j, elem_type val) { return visitor(i + offset, j, val); });
+
+            if (!completed) return false;
+
+        }
+
+        return true;
+
+    }
+
+    bool containsElement(size_type i1, size_type i2, size_type j1, size_type j2) const override {
         return containsLink(i1, i2, j1, j2);
     }
 
-    size_type countElements() override {
+    size_type countElements() const override {
         return countLinks();
     }
 
+    size_type countElementsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
+
+        auto upperLeft = determineIndices(i1, j1);
+        auto lowerRight = determineIndices(i2, j2);
+
+        // the first and the last partition may be spanned only partially
+        size_type cnt = 0;
+        for (size_type k = upperLeft.partition; k <= lowerRight.partition; k++) {
+
+            auto p = partition(k);
+            if (p == 0) continue;
+
+            size_type from = (k == upperLeft.partition) ? ((hc_ > hr_) ? upperLeft.col : upperLeft.row) : 0;
+            size_type to = (k == lowerRight.partition) ? ((hc_ > hr_) ? lowerRight.col : lowerRight.row) : partitionSize_ - 1;
+
+            cnt += (hc_ > hr_)
+                    ? p->countElementsInRange(upperLeft.row, lowerRight.row, from, to)
+                    : p->countElementsInRange(from, to, upperLeft.col, lowerRight.col);
+
+        }
+
+        return cnt;
+
+    }
+
 
     UnevenKrKcTree* clone() const override {
         return new UnevenKrKcTree<elem_type>(*this);
     }
 
-    void print(bool all = false) override {
+    void print(bool all = false) const override {
 
         std::cout << "### Parameters ###" << std::endl;
         std::cout << "hr  = " << hr_ << std::endl;
@@ -2069,7 +2527,7 @@ public:
             for (size_type k = 0; k < numPartitions_; k++) {
 
                 std::cout << "===== Partition " << k << " =====" << std::endl;
-                auto p = partitions_[k];
+                auto p = partition(k);
                 if (p != 0) {
                     p->print(true);
                 } else {
@@ -2082,11 +2540,51 @@ public:
 
     }
 
-    // note: can "invalidate" the data structure (containsLink() probably won't work correctly afterwards)
+    void serialize(std::ostream& out) const override {
+        write(out, 0, numPartitions_);
+    }
+
+    void load(std::istream& in) override {
+        this->checkWritable("load");
+        read(in, 0);
+    }
+
+    // replaces the contents of the K2Tree with those of a file written by serialize(), which is mapped read-only (and shared between processes) into memory;
+    // partitions are only deserialised when a query accesses them for the first time (the file must not be modified while it is mapped);
+    // files written before format version 5 lack the lengths for locating the partitions and are deserialised completely right away
+    void mapFile(const std::string& path) {
+
+        this->checkWritable("mapFile");
+
+        MappedFile* mapping = new MappedFile(path);
+        MemoryStreamBuffer buf(mapping->data(), mapping->size());
+        std::istream in(&buf);
+
+        read(in, mapping);
+
+    }
+
+    // returns a sharding of the K2Tree into numShards shards of (almost) equally many partitions (see ShardManifest)
+    ShardManifest getShardManifest(size_type numShards) const {
+        return ShardManifest(numRows_, numCols_, kr_, kc_, numShards);
+    }
+
+    // writes only the given shard of manifest, which can be read by load() or mapFile() like the output of serialize()
+    // (throws a std::runtime_error if the shard does not exist or manifest does not describe the partitioning of the K2Tree)
+    void serializeShard(std::ostream& out, const ShardManifest& manifest, size_type shard) const {
+
+        checkShard(manifest, shard);
+        write(out, manifest.getFirstPartition(shard), manifest.getFirstPartition(shard + 1));
+
+    }
+
+    // note: emptied subtrees of the partitions are only marked, compact() removes them from the internal structures
     void setNull(size_type i, size_type j) override {
 
+        this->checkWritable("setNull");
+
         auto pis = determineIndices(i, j);
-        auto p = partitions_[pis.partition];
+        auto p = partition(pis.partition);
 
         if (p != 0) {
             p->setNull(pis.row, pis.col);
@@ -2094,7 +2592,41 @@ public:
 
     }
 
-    size_type getFirstSuccessor(size_type i) override {
+    void compact() override {
+
+        this->checkWritable("compact");
+
+        for (size_type k = 0; k < numPartitions_; k++) {
+
+            auto p = partition(k);
+            if (p != 0) {
+                p->compact();
+            }
+
+        }
+
+    }
+
+    // (partitions not yet deserialised from a file opened via mapFile() are not included)
+    SizeBreakdown sizeInBytes() const override {
+
+        SizeBreakdown s;
+        for (size_type k = 0; k < numPartitions_; k++) {
+
+            if (isAvailable(k) && (partitions_[k] != 0)) {
+                s += partitions_[k]->sizeInBytes();
+            }
+
+        }
+
+        s.partitions += numPartitions_ * sizeof(partitions_[0]) + ((offsets_ != 0) ? numPartitions_ * sizeof(offsets_[0]) : 0);
+        s.other += sizeof(*this);
+
+        return s;
+
+    }
+
+    size_type getFirstSuccessor(size_type i) const override {
 
         size_type pos = numCols_;
 
@@ -2103,7 +2635,7 @@ public:
             size_type offset = 0;
             for (size_type k = 0; k < numPartitions_ && pos == numCols_; k++, offset += partitionSize_) {
 
-                auto p = partitions_[k];
+                auto p = partition(k);
                 if (p != 0) {
 
                     auto tmp = p->getFirstSuccessor(i);
@@ -2118,7 +2650,7 @@ public:
         } else {
 
             auto pis = determineIndices(i, 0);
-            auto p = partitions_[pis.partition];
+            auto p = partition(pis.partition);
             if (p != 0) {
                 pos = p->getFirstSuccessor(pis.row);
             }
@@ -2129,6 +2661,77 @@ public:
 
     }
 
+    std::vector<size_type> expandFrontier(const std::vector<size_type>& frontier, std::vector<bool>& visited) const override {
+
+        auto rows = this->prepareFrontier(frontier, visited);
+        std::vector<size_type> cols;
+
+        if (hc_ > hr_) {
+
+            // every partition covers all rows: expand the whole frontier in every partition
+            size_type offset = 0;
+            for (size_type k = 0; k < numPartitions_; k++, offset += partitionSize_) {
+
+                auto p = partition(k);
+                if (p != 0) {
+
+                    for (auto j : p->expandFrontier(rows)) {
+                        this->addToFrontier(j + offset, cols, visited);
+                    }
+
+                }
+
+            }
+
+        } else {
+
+            // every partition covers a range of rows: route the (sorted) rows of the frontier to the partitions in bulk
+            std::vector<size_type> local;
+            for (size_type x = 0; x < rows.size();) {
+
+                size_type k = rows[x] / partitionSize_;
+
+                local.clear();
+                for (; (x < rows.size()) && (rows[x] / partitionSize_ == k); x++) {
+                    local.push_back(rows[x] % partitionSize_);
+                }
+
+                auto p = (k < numPartitions_) ? partition(k) : 0;
+                if (p != 0) {
+
+                    for (auto j : p->expandFrontier(local)) {
+                        this->addToFrontier(j, cols, visited);
+                    }
+
+                }
+
+            }
+
+        }
+
+        this->finishFrontier(cols, visited);
+
+        return cols;
+
+    }
+
+
+    /*
+     * Concurrent execution of queries spanning several partitions
+     */
+
+    // lets the queries touching several partitions (ranges over several partitions, rows / columns crossing all partitions,
+    // batches of positions) query these partitions concurrently on the given workers (0 for sequential execution, the default),
+    // the results are the same (and in the same order) as without workers: the answers of the partitions are concatenated in partition order,
+    // which is not row-major if the partitions cover ranges of columns, and every partition answers in the order of its KrKcTree
+    void setWorkerPool(const std::shared_ptr<WorkerPool>& pool) {
+        pool_ = pool;
+    }
+
+    const std::shared_ptr<WorkerPool>& getWorkerPool() const {
+        return pool_;
+    }
+
 
 
 private:
@@ -2142,20 +2745,350 @@ private:
     KrKcTree<elem_type>** partitions_; // representations of the partitions / submatrices
     size_type partitionSize_; // number of rows (columns) per partition in a vertical (horizontal) partitioning
     size_type numPartitions_; // number of partitions
+    std::shared_ptr<WorkerPool> pool_; // workers querying several partitions concurrently (0 for sequential queries)
 
     elem_type null_; // null element
 
+    MappedFile* mapping_ = 0; // file the K2Tree has been opened from via mapFile() (0 if none)
+    std::atomic<size_type>* offsets_ = 0; // positions of the not yet deserialised partitions within mapping_ (0 for partitions that are empty or already available)
+    mutable std::mutex offsetsMutex_; // serialises the first deserialisation of partitions by concurrent queries
+
 
     /* helper methods for mapping (overall) indices to positions in the partitions */
 
-    size_type determinePartition(size_type i, size_type j) {
+    size_type determinePartition(size_type i, size_type j) const {
         return (hc_ > hr_) ? (j / partitionSize_) : (i / partitionSize_);
     }
 
-    PartitionIndices determineIndices(size_type i, size_type j) {
+    PartitionIndices determineIndices(size_type i, size_type j) const {
         return (hc_ > hr_) ? PartitionIndices(j / partitionSize_, i, j % partitionSize_) : PartitionIndices(i / partitionSize_, i % partitionSize_, j);
     }
 
+    /* helper method for batch queries (isNotNull() / getElement() on several positions) */
+
+    // groups the queries by partition and calls f(p, local, idx) for every non-empty partition p
+    // that is hit by at least one query, local[x] is the relative position of query idx[x] in p
+    // (f may be called concurrently for different partitions, see setWorkerPool())
+    template<typename F>
+    void batchByPartition(const positions_type& queries, F f) const {
+
+        std::vector<size_type> bounds(numPartitions_ + 1, 0);
+        std::vector<PartitionIndices> pis(queries.size());
+
+        for (size_type x = 0; x < queries.size(); x++) {
+            pis[x] = determineIndices(queries[x].first, queries[x].second);
+            bounds[pis[x].partition + 1]++;
+        }
+
+        for (size_type k = 0; k < numPartitions_; k++) {
+            bounds[k + 1] += bounds[k];
+        }
+
+        std::vector<size_type> order(queries.size());
+        positions_type local(queries.size());
+        std::vector<size_type> next(bounds.begin(), bounds.end() - 1);
+
+        for (size_type x = 0; x < queries.size(); x++) {
+            auto y = next[pis[x].partition]++;
+            order[y] = x;
+            local[y] = std::make_pair(pis[x].row, pis[x].col);
+        }
+
+        forEachPartition(0, numPartitions_, [&](size_type k) {
+
+            if (bounds[k] < bounds[k + 1]) {
+
+                auto p = partition(k);
+
+                if (p != 0) {
+                    positions_type part(local.begin() + bounds[k], local.begin() + bounds[k + 1]);
+                    f(p, part, order.data() + bounds[k]);
+                }
+
+            }
+
+        });
+
+    }
+
+    /* helper methods for queries spanning several partitions */
+
+    // calls f(k) for all partitions k in [first, last), concurrently if a worker pool has been set
+    void forEachPartition(size_type first, size_type last, const std::function<void(size_type)>& f) const {
+
+        if (pool_) {
+            pool_->run(first, last, f);
+        } else {
+            for (size_type k = first; k < last; k++) {
+                f(k);
+            }
+        }
+
+    }
+
+    // returns the concatenation of f(p, k) over all non-empty partitions p = partition(k), k in [first, last), in the order of k
+    // (not merged by (row, column), f may be called concurrently for different partitions)
+    template<typename V, typename F>
+    V gatherPartitions(size_type first, size_type last, F f) const {
+
+        std::vector<V> parts(last - first);
+        forEachPartition(first, last, [&](size_type k) {
+
+            auto p = partition(k);
+            if (p != 0) {
+                parts[k - first] = f(p, k);
+            }
+
+        });
+
+        size_type num = 0;
+        for (auto& part : parts) {
+            num += part.size();
+        }
+
+        V res;
+        res.reserve(num);
+        for (auto& part : parts) {
+            res.insert(res.end(), part.begin(), part.end());
+        }
+
+        return res;
+
+    }
+
+    /* helper methods for accessing / reading the partitions */
+
+    // returns the k-th partition (deserialises it first if the K2Tree has been opened via mapFile() and the partition has not been accessed yet)
+    KrKcTree<elem_type>* partition(size_type k) const {
+
+        K2TREES_COUNT(partitionsTouched);
+
+        // only the first access to a partition takes the lock (double-checked, partitions_[k] is published by the release store)
+        if (!isAvailable(k)) {
+
+            std::lock_guard<std::mutex> lock(offsetsMutex_);
+
+            size_type pos = offsets_[k].load(std::memory_order_relaxed);
+            if (pos != 0) {
+
+                MemoryStreamBuffer buf(mapping_->data() + pos, mapping_->size() - pos);
+                std::istream in(&buf);
+
+                readPartition(in, k, true);
+                offsets_[k].store(0, std::memory_order_release);
+
+            }
+
+        }
+
+        return partitions_[k];
+
+    }
+
+    // returns whether the k-th partition can be accessed without deserialising it first
+    bool isAvailable(size_type k) const {
+        return (offsets_ == 0) || (offsets_[k].load(std::memory_order_acquire) == 0);
+    }
+
+    // reads the entry of the k-th partition as written by serialize() (format version 5 or higher prefixes the partition with its length)
+    void readPartition(std::istream& in, size_type k, bool withLength) const {
+
+        bool present;
+        readValue(in, present);
+
+        if (present) {
+
+            if (withLength) {
+                size_type length;
+                readValue(in, length); // only needed for skipping the partition
+            }
+
+            partitions_[k] = new KrKcTree<elem_type>();
+            partitions_[k]->load(in);
+
+        } else {
+            partitions_[k] = 0;
+        }
+
+    }
+
+    // writes the K2Tree as serialize() does, but with the partitions outside of first, ..., last - 1 as empty ones
+    void write(std::ostream& out, size_type first, size_type last) const {
+
+        writeHeader(out, "UnevenKrKcTree<bool>", sizeof(elem_type));
+
+        writeValue(out, hr_);
+        writeValue(out, hc_);
+        writeValue(out, kr_);
+        writeValue(out, kc_);
+        writeValue(out, numRows_);
+        writeValue(out, numCols_);
+        writeValue(out, partitionSize_);
+        writeValue(out, numPartitions_);
+        writeValue(out, null_);
+
+        for (size_type k = 0; k < numPartitions_; k++) {
+
+            auto p = ((first <= k) && (k < last)) ? partition(k) : 0;
+
+            writeValue(out, (bool) (p != 0));
+            if (p != 0) {
+
+                // prefix each partition with its length so that mapFile() can skip it
+                std::ostringstream buf;
+                p->serialize(buf);
+                std::string bytes = buf.str();
+
+                writeValue(out, (size_type) bytes.size());
+                out.write(bytes.data(), bytes.size());
+
+            }
+
+        }
+
+    }
+
+    // replaces the contents of the K2Tree with those read from the stream,
+    // where a non-zero mapping (backing the stream) leads to partitions being only located instead of deserialised
+    void read(std::istream& in, MappedFile* mapping) {
+
+        for (size_type k = 0; k < numPartitions_; k++) {
+            delete partitions_[k];
+        }
+        delete[] partitions_;
+        releaseMapping();
+
+        partitions_ = 0;
+        numPartitions_ = 0;
+        mapping_ = mapping;
+
+        unsigned int version = readHeader(in, "UnevenKrKcTree<bool>", sizeof(elem_type));
+
+        readValue(in, hr_);
+        readValue(in, hc_);
+        readValue(in, kr_);
+        readValue(in, kc_);
+        readValue(in, numRows_);
+        readValue(in, numCols_);
+        readValue(in, partitionSize_);
+        readValue(in, numPartitions_);
+        readValue(in, null_);
+
+        partitions_ = new KrKcTree<elem_type>*[numPartitions_];
+        // the partitions of files older than format version 5 cannot be skipped (no lengths), so they are deserialised right away
+        bool lazy = (mapping_ != 0) && (version >= 5);
+        if (lazy) {
+            offsets_ = new std::atomic<size_type>[numPartitions_];
+        }
+
+        for (size_type k = 0; k < numPartitions_; k++) {
+
+            if (!lazy) {
+                readPartition(in, k, version >= 5);
+            } else {
+
+                size_type pos = in.tellg();
+                bool present;
+                readValue(in, present);
+
+                partitions_[k] = 0;
+                offsets_[k] = 0;
+
+                if (present) {
+
+                    size_type length;
+                    readValue(in, length);
+                    in.seekg(length, std::ios_base::cur);
+
+                    offsets_[k] = pos;
+
+                }
+
+            }
+
+        }
+
+        if (!lazy) {
+            releaseMapping(); // everything has been deserialised, the mapping is not needed anymore
+        }
+
+    }
+
+    void releaseMapping() {
+
+        delete mapping_;
+        delete[] offsets_;
+
+        mapping_ = 0;
+        offsets_ = 0;
+
+    }
+
+    /* helper methods for building (a subset of) the partitions */
+
+    // builds the partitions first, ..., last - 1 from the first numPairs pairs (which have to lie within these partitions),
+    // all other partitions are empty
+    void buildPartitions(positions_type& pairs, size_type numPairs, size_type first, size_type last, size_type numThreads) {
+
+        partitions_ = new KrKcTree<elem_type>*[numPartitions_];
+        std::fill(partitions_, partitions_ + numPartitions_, (KrKcTree<elem_type>*) 0);
+
+        Subproblem sp(0, numRows_ - 1, 0, numCols_ - 1, 0, numPairs);
+        std::vector<std::pair<size_type, size_type>> intervals(numPartitions_);
+
+        if (hc_ > hr_) {
+
+            countingSort(pairs, intervals, sp, numRows_, partitionSize_, numPartitions_);
+
+            parallelFor(last - first, numThreads, [&](size_type x) {
+
+                size_type i = first + x;
+                partitions_[i] = new KrKcTree<elem_type>(pairs, 0, i * partitionSize_, numRows_, partitionSize_, intervals[i].first, intervals[i].second, kr_, kc_);
+
+            });
+
+        } else {
+
+            countingSort(pairs, intervals, sp, partitionSize_, numCols_, numPartitions_);
+
+            parallelFor(last - first, numThreads, [&](size_type x) {
+
+                size_type j = first + x;
+                partitions_[j] = new KrKcTree<elem_type>(pairs, j * partitionSize_, 0, partitionSize_, numCols_, intervals[j].first, intervals[j].second, kr_, kc_);
+
+            });
+
+        }
+
+#if 1
+        for (size_type k = first; k < last; k++) {
+
+            if (partitions_[k]->getNumRows() == 0) {
+
+                delete partitions_[k];
+                partitions_[k] = 0;
+
+            }
+
+        }
+#endif
+
+    }
+
+    // throws a std::runtime_error unless manifest describes the partitioning of the K2Tree and contains the given shard
+    void checkShard(const ShardManifest& manifest, size_type shard) const {
+
+        if ((manifest.getNumRows() != numRows_) || (manifest.getNumCols() != numCols_)
+            || (manifest.getPartitionSize() != partitionSize_) || (manifest.getNumPartitions() != numPartitions_)) {
+            throw std::runtime_error("Shard manifest does not match the partitioning of the K2Tree.");
+        }
+
+        if (shard >= manifest.getNumShards()) {
+            throw std::runtime_error("Shard " + std::to_string(shard) + " does not exist (the manifest has " + std::to_string(manifest.getNumShards()) + " shards).");
+        }
+
+    }
+
     /* helper methods for inplace construction from single list of pairs */
 
     size_type computeKey(const positions_type::value_type& pair, const Subproblem& sp, size_type widthRow, size_type widthCol) {
@@ -0,0 +1,429 @@
+/*
+ * Copyright (C) 2017 Robert Mueller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Contact: Robert Mueller <romueller@techfak.uni-bielefeld.de>
+ * Faculty of Technology, Bielefeld University,
+ * PO box 100131, DE-33501 Bielefeld, Germany
+ */
+
+#ifndef K2TREES_TWINK2TREE_HPP
+#define K2TREES_TWINK2TREE_HPP
+
+#include "K2Tree.hpp"
+#include "Utility.hpp"
+
+/**
+ * Pair of two K2Trees representing a relation and its transposition.
+ *
+ * Both K2Trees are built by the same builder (e.g. one of the list-of-pairs-based constructors) from the same pairs,
+ * which are transposed in place in between. Predecessor queries (and range queries restricted to a single column)
+ * are answered as successor queries on the transposed K2Tree, all other queries by the forward one.
+ * In exchange, the data structure needs about twice the space, see sizeInBytes() and getTwinSizeInBytes().
+ */
+template<typename E>
+class TwinK2Tree : public virtual K2Tree<E> {
+
+public:
+    typedef E elem_type;
+
+    typedef typename K2Tree<elem_type>::matrix_type matrix_type;
+    typedef typename K2Tree<elem_type>::list_type list_type;
+    typedef typename K2Tree<elem_type>::positions_type positions_type;
+    typedef typename K2Tree<elem_type>::pairs_type pairs_type;
+
+    // output-buffer and limited variants of the query methods (see K2Tree)
+    using K2Tree<elem_type>::getSuccessorPositions;
+    using K2Tree<elem_type>::getPredecessorPositions;
+    using K2Tree<elem_type>::getPositionsInRange;
+    using K2Tree<elem_type>::getAllValuedPositions;
+    using K2Tree<elem_type>::getSuccessors;
+    using K2Tree<elem_type>::getRange;
+
+    // creates a new static K2Tree (on the heap) from the given pairs / positions (which may be reordered)
+    typedef std::function<K2Tree<elem_type>*(pairs_type&)> builder_type;
+    typedef std::function<K2Tree<elem_type>*(positions_type&)> positions_builder_type;
+
+
+    /**
+     * List-of-pairs-based constructor
+     *
+     * Builds the forward and the transposed K2Tree from pairs, which is reordered but contains the same pairs afterwards.
+     */
+    TwinK2Tree(pairs_type& pairs, const builder_type& builder) {
+
+        forward_ = builder(pairs);
+
+        try {
+
+            transpose(pairs);
+            twin_ = builder(pairs);
+            transpose(pairs);
+
+        } catch (...) {
+
+            delete forward_;
+            throw;
+
+        }
+
+    }
+
+    /**
+     * List-of-positions-based constructor (e.g. for the bool specialisations)
+     *
+     * Builds the forward and the transposed K2Tree from pairs, which is reordered but contains the same pairs afterwards.
+     */
+    TwinK2Tree(positions_type& pairs, const positions_builder_type& builder) {
+
+        forward_ = builder(pairs);
+
+        try {
+
+            transpose(pairs);
+            twin_ = builder(pairs);
+            transpose(pairs);
+
+        } catch (...) {
+
+            delete forward_;
+            throw;
+
+        }
+
+    }
+
+    TwinK2Tree(const TwinK2Tree& other) {
+
+        forward_ = other.forward_->clone();
+        twin_ = other.twin_->clone();
+
+    }
+
+    TwinK2Tree& operator=(const TwinK2Tree& other) {
+
+        // check for self-assignment
+        if (&other == this) {
+            return *this;
+        }
+
+        K2Tree<elem_type>* forward = other.forward_->clone();
+        K2Tree<elem_type>* twin = other.twin_->clone();
+
+        delete forward_;
+        delete twin_;
+
+        forward_ = forward;
+        twin_ = twin;
+
+        return *this;
+
+    }
+
+    ~TwinK2Tree() {
+
+        delete forward_;
+        delete twin_;
+
+    }
+
+
+    // returns the K2Tree representing the relation
+    const K2Tree<elem_type>& getForwardTree() const {
+        return *forward_;
+    }
+
+    // returns the K2Tree representing the transposed relation
+    const K2Tree<elem_type>& getTwinTree() const {
+        return *twin_;
+    }
+
+    // returns the memory overhead of the transposed K2Tree (which is included in sizeInBytes())
+    SizeBreakdown getTwinSizeInBytes() const {
+        return twin_->sizeInBytes();
+    }
+
+    void setNull(size_type i, size_type j) override {
+
+        this->checkWritable("setNull");
+
+        forward_->setNull(i, j);
+        if ((j < twin_->getNumRows()) && (i < twin_->getNumCols())) {
+            twin_->setNull(j, i);
+        }
+
+    }
+
+    void compact() override {
+
+        this->checkWritable("compact");
+
+        forward_->compact();
+        twin_->compact();
+
+    }
+
+    SizeBreakdown sizeInBytes() const override {
+
+        SizeBreakdown s = forward_->sizeInBytes();
+        s += twin_->sizeInBytes();
+        s.other += sizeof(*this);
+
+        return s;
+
+    }
+
+
+    size_type getNumRows() const override {
+        return forward_->getNumRows();
+    }
+
+    size_type getNumCols() const override {
+        return forward_->getNumCols();
+    }
+
+    elem_type getNull() const override {
+        return forward_->getNull();
+    }
+
+
+    bool isNotNull(size_type i, size_type j) const override {
+        return forward_->isNotNull(i, j);
+    }
+
+    elem_type getElement(size_type i, size_type j) const override {
+        return forward_->getElement(i, j);
+    }
+
+    void isNotNull(const positions_type& queries, std::vector<bool>& out) const override {
+        forward_->isNotNull(queries, out);
+    }
+
+    void getElement(const positions_type& queries, std::vector<elem_type>& out) const override {
+        forward_->getElement(queries, out);
+    }
+
+    std::vector<elem_type> getSuccessorElements(size_type i) const override {
+        return forward_->getSuccessorElements(i);
+    }
+
+    std::vector<size_type> getSuccessorPositions(size_type i) const override {
+        return forward_->getSuccessorPositions(i);
+    }
+
+    pairs_type getSuccessorValuedPositions(size_type i) const override {
+        return forward_->getSuccessorValuedPositions(i);
+    }
+
+    std::vector<elem_type> getPredecessorElements(size_type j) const override {
+        return inTwin(j) ? twin_->getSuccessorElements(j) : std::vector<elem_type>();
+    }
+
+    std::vector<size_type> getPredecessorPositions(size_type j) const override {
+        return inTwin(j) ? twin_->getSuccessorPositions(j) : std::vector<size_type>();
+    }
+
+    pairs_type getPredecessorValuedPositions(size_type j) const override {
+
+        pairs_type preds;
+        if (inTwin(j)) {
+
+            preds = twin_->getSuccessorValuedPositions(j);
+            transpose(preds);
+
+        }
+
+        return preds;
+
+    }
+
+    std::vector<elem_type> getElementsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
+        return (j1 == j2) ? (inTwin(j1) ? twin_->getElementsInRange(j1, j1, i1, i2) : std::vector<elem_type>()) : forward_->getElementsInRange(i1, i2, j1, j2);
+    }
+
+    positions_type getPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
+
+        if (j1 != j2) {
+            return forward_->getPositionsInRange(i1, i2, j1, j2);
+        }
+
+        positions_type pairs;
+        if (inTwin(j1)) {
+
+            pairs = twin_->getPositionsInRange(j1, j1, i1, i2);
+            transpose(pairs);
+
+        }
+
+        return pairs;
+
+    }
+
+    pairs_type getValuedPositionsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
+
+        if (j1 != j2) {
+            return forward_->getValuedPositionsInRange(i1, i2, j1, j2);
+        }
+
+        pairs_type pairs;
+        if (inTwin(j1)) {
+
+            pairs = twin_->getValuedPositionsInRange(j1, j1, i1, i2);
+            transpose(pairs);
+
+        }
+
+        return pairs;
+
+    }
+
+    std::vector<elem_type> getAllElements() const override {
+        return forward_->getAllElements();
+    }
+
+    positions_type getAllPositions() const override {
+        return forward_->getAllPositions();
+    }
+
+    pairs_type getAllValuedPositions() const override {
+        return forward_->getAllValuedPositions();
+    }
+
+    bool forEachSuccessorPosition(size_type i, const std::function<bool(size_type)>& visitor) const override {
+        return forward_->forEachSuccessorPosition(i, visitor);
+    }
+
+    bool forEachPredecessorPosition(size_type j, const std::function<bool(size_type)>& visitor) const override {
+        return !inTwin(j) || twin_->forEachSuccessorPosition(j, visitor);
+    }
+
+    bool forEachValuedPositionInRange(size_type i1, size_type i2, size_type j1, size_type j2, const std::function<bool(size_type, size_type, elem_type)>& visitor) const override {
+
+        if (j1 != j2) {
+            return forward_->forEachValuedPositionInRange(i1, i2, j1, j2, visitor);
+        }
+
+        return !inTwin(j1) || twin_->forEachValuedPositionInRange(j1, j1, i1, i2, [&visitor](size_type j, size_type i, elem_type val) { return visitor(i, j, val); });
+
+    }
+
+    std::vector<size_type> expandFrontier(const std::vector<size_type>& frontier, std::vector<bool>& visited) const override {
+        return forward_->expandFrontier(frontier, visited);
+    }
+
+    bool containsElement(size_type i1, size_type i2, size_type j1, size_type j2) const override {
+        return forward_->containsElement(i1, i2, j1, j2);
+    }
+
+    size_type countElements() const override {
+        return forward_->countElements();
+    }
+
+    size_type countElementsInRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
+        return forward_->countElementsInRange(i1, i2, j1, j2);
+    }
+
+
+    K2Tree<elem_type>* clone() const override {
+        return new TwinK2Tree<elem_type>(*this);
+    }
+
+    void print(bool all = false) const override {
+
+        std::cout << "### Forward K2Tree ###" << std::endl;
+        forward_->print(all);
+
+        std::cout << "### Transposed K2Tree ###" << std::endl;
+        twin_->print(all);
+
+    }
+
+    void serialize(std::ostream& out) const override {
+
+        writeHeader(out, "TwinK2Tree", sizeof(elem_type));
+
+        forward_->serialize(out);
+        twin_->serialize(out);
+
+    }
+
+    // note: both K2Trees are loaded via their current implementations, which therefore have to match the serialised ones
+    void load(std::istream& in) override {
+
+        this->checkWritable("load");
+
+        readHeader(in, "TwinK2Tree", sizeof(elem_type));
+
+        forward_->load(in);
+        twin_->load(in);
+
+    }
+
+    size_type getFirstSuccessor(size_type i) const override {
+        return forward_->getFirstSuccessor(i);
+    }
+
+
+
+    bool areRelated(size_type i, size_type j) const override {
+        return forward_->areRelated(i, j);
+    }
+
+    std::vector<size_type> getSuccessors(size_type i) const override {
+        return forward_->getSuccessors(i);
+    }
+
+    std::vector<size_type> getPredecessors(size_type j) const override {
+        return inTwin(j) ? twin_->getSuccessors(j) : std::vector<size_type>();
+    }
+
+    positions_type getRange(size_type i1, size_type i2, size_type j1, size_type j2) const override {
+        return getPositionsInRange(i1, i2, j1, j2);
+    }
+
+    bool containsLink(size_type i1, size_type i2, size_type j1, size_type j2) const override {
+        return forward_->containsLink(i1, i2, j1, j2);
+    }
+
+    size_type countLinks() const override {
+        return forward_->countLinks();
+    }
+
+private:
+    K2Tree<elem_type>* forward_; // K2Tree of the relation
+    K2Tree<elem_type>* twin_; // K2Tree of the transposed relation
+
+
+    // checks whether column j of the relation is a row of the transposed K2Tree
+    // (its dimensions may be padded differently than those of the forward one)
+    bool inTwin(size_type j) const {
+        return j < twin_->getNumRows();
+    }
+
+    static void transpose(pairs_type& pairs) {
+        for (auto& p : pairs) {
+            std::swap(p.row, p.col);
+        }
+    }
+
+    static void transpose(positions_type& pairs) {
+        for (auto& p : pairs) {
+            std::swap(p.first, p.second);
+        }
+    }
+
+};
+
+#endif //K2TREES_TWINK2TREE_HPP
@@ -19,6 +19,20 @@
  * PO box 100131, DE-33501 Bielefeld, Germany
  */
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __SSE4_1__
+#include <smmintrin.h>
+#endif
+
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+
 #include "Utility.hpp"
 
 size_type logK(const size_type n, const size_type k) {
@@ -34,7 +48,73 @@ bool isAllZero(const std::vector<bool>& v) {
 }
 
 bool isAllZero(const bit_vector_type& v) {
-    return std::find(v.begin(), v.end(), true) == v.end();
+    return !anyBitSet(v, 0, v.size());
+}
+
+size_type countBits(const bit_vector_type& v, size_type x, size_type len) {
+
+    size_type cnt = 0;
+    for (size_type end = x + len; x < end; x += 64) {
+        cnt += sdsl::bits::cnt(getBits(v, x, std::min(end - x, (size_type) 64)));
+    }
+
+    return cnt;
+
+}
+
+bool anyBitSet(const bit_vector_type& v, size_type x, size_type len) {
+
+    size_type end = x + len;
+
+    // unaligned head, aligned words and unaligned tail
+    size_type head = std::min(end, (x + 63) / 64 * 64);
+    if (getBits(v, x, head - x) != 0) {
+        return true;
+    }
+
+    if (head == end) {
+        return false;
+    }
+
+    const uint64_t* data = v.data();
+    size_type w = head / 64;
+    size_type wEnd = end / 64;
+
+#ifdef __SSE4_1__
+    for (; w + 2 <= wEnd; w += 2) {
+
+        __m128i words = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + w));
+        if (!_mm_testz_si128(words, words)) {
+            return true;
+        }
+
+    }
+#endif
+
+    for (; w < wEnd; w++) {
+        if (data[w] != 0) {
+            return true;
+        }
+    }
+
+    return getBits(v, wEnd * 64, end - wEnd * 64) != 0;
+
+}
+
+size_type findFirstBit(const bit_vector_type& v, size_type x, size_type len) {
+
+    size_type end = x + len;
+    for (; x < end; x += 64) {
+
+        uint64_t w = getBits(v, x, std::min(end - x, (size_type) 64));
+        if (w != 0) {
+            return x + sdsl::bits::lo(w);
+        }
+
+    }
+
+    return end;
+
 }
 
 void printRanks(const rank_type& r) {
@@ -44,6 +124,651 @@ void printRanks(const rank_type& r) {
 
 }
 
+QueryStats& queryStats() {
+
+    static thread_local QueryStats stats;
+    return stats;
+
+}
+
+void printSizeBreakdown(const SizeBreakdown& s) {
+
+    std::cout << "T: " << s.T << " bytes" << std::endl;
+    std::cout << "L: " << s.L << " bytes" << std::endl;
+    std::cout << "rank: " << s.rank << " bytes" << std::endl;
+    std::cout << "auxiliary structures: " << s.aux << " bytes" << std::endl;
+    std::cout << "partitions: " << s.partitions << " bytes" << std::endl;
+    std::cout << "mini trees: " << s.miniTrees << " bytes" << std::endl;
+    std::cout << "other: " << s.other << " bytes" << std::endl;
+    std::cout << "total: " << s.total() << " bytes" << std::endl;
+
+}
+
+// identifies a stream as a serialised data structure of this library
+const char K2TREES_MAGIC[4] = {'K', '2', 'T', 'R'};
+
+void writeHeader(std::ostream& out, const std::string& id, size_type elemSize) {
+
+    out.write(K2TREES_MAGIC, 4);
+    writeValue(out, K2TREES_FORMAT_VERSION);
+    writeValue(out, (size_type) id.size());
+    out.write(id.data(), id.size());
+    writeValue(out, elemSize);
+    writeValue(out, K2TREES_RANK_ID);
+
+}
+
+unsigned int readHeader(std::istream& in, const std::string& id, size_type elemSize) {
+
+    char magic[4];
+    unsigned int version;
+    size_type idLength;
+    size_type size;
+
+    in.read(magic, 4);
+    if (!in || !std::equal(magic, magic + 4, K2TREES_MAGIC)) {
+        throw std::runtime_error("Stream does not contain a serialised data structure of this library.");
+    }
+
+    readValue(in, version);
+    if (version > K2TREES_FORMAT_VERSION) {
+        throw std::runtime_error("Unsupported format version " + std::to_string(version) + " (supported up to " + std::to_string(K2TREES_FORMAT_VERSION) + ").");
+    }
+
+    readValue(in, idLength);
+    std::string storedId(idLength, ' ');
+    in.read(&storedId[0], idLength);
+    readValue(in, size);
+
+    if (!in || (storedId != id) || (size != elemSize)) {
+        throw std::runtime_error("Stream contains a serialised " + storedId + " (value size " + std::to_string(size) + ") instead of " + id + " (value size " + std::to_string(elemSize) + ").");
+    }
+
+    // streams of older versions always use the default rank data structure
+    unsigned int rankId = 0;
+    if (version >= 3) {
+        readValue(in, rankId);
+    }
+
+    if (!in || (rankId != K2TREES_RANK_ID)) {
+        throw std::runtime_error("Stream uses rank data structure " + std::to_string(rankId) + " instead of " + std::to_string(K2TREES_RANK_ID) + " (see K2TREES_RANK_ID).");
+    }
+
+    return version;
+
+}
+
+MappedFile::MappedFile(const std::string& path) {
+
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Could not open " + path + " for mapping.");
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+
+        close(fd);
+        throw std::runtime_error("Could not determine the size of " + path + ".");
+
+    }
+
+    size_ = st.st_size;
+    data_ = 0;
+
+    if (size_ > 0) {
+
+        void* addr = mmap(0, size_, PROT_READ, MAP_SHARED, fd, 0);
+        if (addr == MAP_FAILED) {
+
+            close(fd);
+            throw std::runtime_error("Could not map " + path + " into memory.");
+
+        }
+        data_ = static_cast<const char*>(addr);
+
+    }
+
+    close(fd); // the mapping stays valid after closing the descriptor
+
+}
+
+MappedFile::~MappedFile() {
+
+    if (data_ != 0) {
+        munmap(const_cast<char*>(data_), size_);
+    }
+
+}
+
+const char* MappedFile::data() const {
+    return data_;
+}
+
+size_type MappedFile::size() const {
+    return size_;
+}
+
+MemoryStreamBuffer::MemoryStreamBuffer(const char* data, size_type size) {
+
+    char* p = const_cast<char*>(data); // the get area is never written to
+    setg(p, p, p + size);
+
+}
+
+MemoryStreamBuffer::pos_type MemoryStreamBuffer::seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) {
+
+    char* base = (dir == std::ios_base::beg) ? eback() : ((dir == std::ios_base::cur) ? gptr() : egptr());
+
+    if (!(which & std::ios_base::in) || (base + off < eback()) || (base + off > egptr())) {
+        return pos_type(off_type(-1));
+    }
+
+    setg(eback(), base + off, egptr());
+    return pos_type(gptr() - eback());
+
+}
+
+MemoryStreamBuffer::pos_type MemoryStreamBuffer::seekpos(pos_type pos, std::ios_base::openmode which) {
+    return seekoff(off_type(pos), std::ios_base::beg, which);
+}
+
+LeafDictionary<bool>::LeafDictionary(const bit_vector_type& L, size_type blockSize) : blockSize_(blockSize), size_(L.size()) {
+
+    if ((blockSize == 0) || (L.size() % blockSize != 0)) {
+        throw std::runtime_error("Leaf level of length " + std::to_string(L.size()) + " does not consist of blocks of size " + std::to_string(blockSize) + ".");
+    }
+
+    size_type numBlocks = L.size() / blockSize;
+
+    // compares the blocks a and b word by word (-1, 0 or 1 if a is smaller than, equal to or larger than b)
+    auto compare = [&](size_type a, size_type b) {
+
+        for (size_type off = 0; off < blockSize; off += 64) {
+
+            size_type len = std::min(blockSize - off, (size_type) 64);
+            uint64_t wa = getBits(L, a * blockSize + off, len);
+            uint64_t wb = getBits(L, b * blockSize + off, len);
+
+            if (wa != wb) {
+                return (wa < wb) ? -1 : 1;
+            }
+
+        }
+
+        return 0;
+
+    };
+
+    // group equal blocks by sorting the block numbers by the blocks' contents
+    std::vector<size_type> order(numBlocks);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](size_type a, size_type b) {
+        return compare(a, b) < 0;
+    });
+
+    // distinct blocks as (frequency, first index in order)
+    std::vector<std::pair<size_type, size_type>> distinct;
+    for (size_type x = 0; x < numBlocks; x++) {
+
+        if ((x == 0) || (compare(order[x - 1], order[x]) != 0)) {
+            distinct.push_back(std::pair<size_type, size_type>(0, x));
+        }
+
+        distinct.back().first++;
+
+    }
+
+    std::stable_sort(distinct.begin(), distinct.end(), [](const std::pair<size_type, size_type>& a, const std::pair<size_type, size_type>& b) {
+        return a.first > b.first;
+    });
+
+    std::vector<uint64_t> codes(numBlocks);
+    values_ = bit_vector_type(distinct.size() * blockSize, 0);
+    for (size_type c = 0; c < distinct.size(); c++) {
+
+        size_type block = order[distinct[c].second];
+        for (size_type off = 0; off < blockSize; off += 64) {
+
+            size_type len = std::min(blockSize - off, (size_type) 64);
+            values_.set_int(c * blockSize + off, getBits(L, block * blockSize + off, len), len);
+
+        }
+
+        for (size_type x = distinct[c].second; x < distinct[c].second + distinct[c].first; x++) {
+            codes[order[x]] = c;
+        }
+
+    }
+
+    codes_ = sdsl::dac_vector<>(codes);
+
+}
+
+size_type LeafDictionary<bool>::countBits(size_type x, size_type len) const {
+
+    size_type cnt = 0;
+    forEachPart(x, len, [&](size_type, size_type pos, size_type part) {
+
+        cnt += ::countBits(values_, pos, part);
+        return true;
+
+    });
+
+    return cnt;
+
+}
+
+bool LeafDictionary<bool>::anyBitSet(size_type x, size_type len) const {
+
+    return !forEachPart(x, len, [&](size_type, size_type pos, size_type part) {
+        return !::anyBitSet(values_, pos, part);
+    });
+
+}
+
+size_type LeafDictionary<bool>::findFirstBit(size_type x, size_type len) const {
+
+    size_type res = x + len;
+    forEachPart(x, len, [&](size_type start, size_type pos, size_type part) {
+
+        size_type y = ::findFirstBit(values_, pos, part);
+        if (y == pos + part) {
+            return true;
+        }
+
+        res = start + (y - pos);
+        return false;
+
+    });
+
+    return res;
+
+}
+
+void LeafDictionary<bool>::serialize(std::ostream& out) const {
+
+    writeValue(out, blockSize_);
+    writeValue(out, size_);
+    values_.serialize(out);
+    codes_.serialize(out);
+
+}
+
+void LeafDictionary<bool>::load(std::istream& in) {
+
+    readValue(in, blockSize_);
+    readValue(in, size_);
+    values_.load(in);
+    codes_.load(in);
+
+}
+
+
+void parallelFor(size_type n, size_type numThreads, const std::function<void(size_type)>& f) {
+
+    if ((numThreads <= 1) || (n <= 1)) {
+
+        for (size_type i = 0; i < n; i++) {
+            f(i);
+        }
+        return;
+
+    }
+
+    std::atomic<size_type> next(0);
+    std::exception_ptr error;
+    std::mutex errorMutex;
+
+    auto work = [&]() {
+
+        for (size_type i = next++; i < n; i = next++) {
+
+            try {
+                f(i);
+            } catch (...) {
+
+                std::lock_guard<std::mutex> lock(errorMutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+                next = n; // stop handing out further indices
+
+            }
+
+        }
+
+    };
+
+    std::vector<std::thread> threads;
+    for (size_type t = 1; t < std::min(numThreads, n); t++) {
+        threads.emplace_back(work);
+    }
+    work();
+
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+
+}
+
+WorkerPool::WorkerPool(size_type numThreads) {
+
+    for (size_type w = 1; w < numThreads; w++) {
+        threads_.emplace_back(&WorkerPool::work, this, w);
+    }
+
+}
+
+WorkerPool::~WorkerPool() {
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+
+    for (auto& t : threads_) {
+        t.join();
+    }
+
+}
+
+size_type WorkerPool::size() const {
+    return threads_.size() + 1;
+}
+
+void WorkerPool::run(size_type first, size_type last, const std::function<void(size_type)>& f) {
+
+    std::unique_lock<std::mutex> running(runMutex_, std::try_to_lock);
+
+    if (!running.owns_lock() || threads_.empty() || (last <= first + 1)) {
+
+        for (size_type k = first; k < last; k++) {
+            f(k);
+        }
+        return;
+
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        job_ = &f;
+        first_ = first;
+        last_ = last;
+        pending_ = threads_.size();
+        error_ = std::exception_ptr();
+#ifdef K2TREES_STATS
+        stats_.reset();
+#endif
+        generation_++;
+    }
+    wake_.notify_all();
+
+    execute(0);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [this]() { return pending_ == 0; });
+
+#ifdef K2TREES_STATS
+    queryStats() += stats_;
+#endif
+
+    job_ = 0;
+    if (error_) {
+        std::rethrow_exception(error_);
+    }
+
+}
+
+void WorkerPool::work(size_type w) {
+
+    for (size_type seen = 0; ; ) {
+
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [&]() { return stop_ || (generation_ != seen); });
+
+            if (stop_) {
+                return;
+            }
+            seen = generation_;
+        }
+
+#ifdef K2TREES_STATS
+        queryStats().reset();
+#endif
+
+        execute(w);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+#ifdef K2TREES_STATS
+        stats_ += queryStats();
+#endif
+        if (--pending_ == 0) {
+            done_.notify_one();
+        }
+
+    }
+
+}
+
+void WorkerPool::execute(size_type w) {
+
+    size_type n = size();
+
+    // tasks k with k mod n == w
+    for (size_type k = first_ + (w + n - first_ % n) % n; k < last_; k += n) {
+
+        try {
+            (*job_)(k);
+        } catch (...) {
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!error_) {
+                error_ = std::current_exception();
+            }
+
+        }
+
+    }
+
+}
+
+
+
+
+ShardManifest::ShardManifest() {
+
+    numRows_ = 0;
+    numCols_ = 0;
+    kr_ = 0;
+    kc_ = 0;
+    partitionSize_ = 0;
+    numPartitions_ = 0;
+    byCols_ = false;
+    bounds_ = std::vector<size_type>(1, 0);
+
+}
+
+ShardManifest::ShardManifest(size_type numRows, size_type numCols, size_type kr, size_type kc, size_type numShards) {
+
+    init(numRows, numCols, kr, kc);
+
+    numShards = std::max((size_type) 1, std::min(numShards, numPartitions_));
+    for (size_type s = 0; s <= numShards; s++) {
+        bounds_.push_back((s * numPartitions_) / numShards);
+    }
+
+}
+
+ShardManifest::ShardManifest(size_type numRows, size_type numCols, size_type kr, size_type kc, const std::vector<size_type>& bounds) {
+
+    init(numRows, numCols, kr, kc);
+
+    bool valid = (bounds.size() >= 2) && (bounds.front() == 0) && (bounds.back() == numPartitions_);
+    for (size_type s = 1; valid && s < bounds.size(); s++) {
+        valid = bounds[s - 1] < bounds[s];
+    }
+
+    if (!valid) {
+        throw std::runtime_error("Shard bounds do not cover the " + std::to_string(numPartitions_) + " partitions in strictly increasing order.");
+    }
+
+    bounds_ = bounds;
+
+}
+
+void ShardManifest::init(size_type numRows, size_type numCols, size_type kr, size_type kc) {
+
+    // same partitioning as by the constructors of UnevenKrKcTree
+    kr_ = kr;
+    kc_ = kc;
+
+    size_type hr = std::max((size_type) 1, logK(numRows, kr_));
+    size_type hc = std::max((size_type) 1, logK(numCols, kc_));
+    numRows_ = size_type(pow(kr_, hr));
+    numCols_ = size_type(pow(kc_, hc));
+
+    byCols_ = hc > hr;
+    if (byCols_) {
+
+        partitionSize_ = size_type(pow(kc_, hr));
+        numPartitions_ = numCols_ / partitionSize_;
+
+    } else {
+
+        partitionSize_ = size_type(pow(kr_, hc));
+        numPartitions_ = numRows_ / partitionSize_;
+
+    }
+
+    bounds_.clear();
+
+}
+
+size_type ShardManifest::getNumRows() const {
+    return numRows_;
+}
+
+size_type ShardManifest::getNumCols() const {
+    return numCols_;
+}
+
+size_type ShardManifest::getKr() const {
+    return kr_;
+}
+
+size_type ShardManifest::getKc() const {
+    return kc_;
+}
+
+size_type ShardManifest::getPartitionSize() const {
+    return partitionSize_;
+}
+
+size_type ShardManifest::getNumPartitions() const {
+    return numPartitions_;
+}
+
+bool ShardManifest::isColumnPartitioned() const {
+    return byCols_;
+}
+
+size_type ShardManifest::getNumShards() const {
+    return bounds_.size() - 1;
+}
+
+size_type ShardManifest::getFirstPartition(size_type s) const {
+    return bounds_[s];
+}
+
+size_type ShardManifest::getShard(size_type k) const {
+    return std::upper_bound(bounds_.begin(), bounds_.end(), k) - bounds_.begin() - 1;
+}
+
+std::pair<size_type, size_type> ShardManifest::getRows(size_type s) const {
+    return byCols_ ? std::make_pair((size_type) 0, numRows_ - 1) : std::make_pair(bounds_[s] * partitionSize_, bounds_[s + 1] * partitionSize_ - 1);
+}
+
+std::pair<size_type, size_type> ShardManifest::getCols(size_type s) const {
+    return byCols_ ? std::make_pair(bounds_[s] * partitionSize_, bounds_[s + 1] * partitionSize_ - 1) : std::make_pair((size_type) 0, numCols_ - 1);
+}
+
+size_type ShardManifest::route(size_type i, size_type j) const {
+    return getShard((byCols_ ? j : i) / partitionSize_);
+}
+
+std::vector<ShardQuery> ShardManifest::splitRange(size_type i1, size_type i2, size_type j1, size_type j2) const {
+
+    std::vector<ShardQuery> queries;
+
+    i2 = std::min(i2, numRows_ - 1);
+    j2 = std::min(j2, numCols_ - 1);
+
+    if ((i1 > i2) || (j1 > j2)) {
+        return queries;
+    }
+
+    // range of rows (columns) along which the shards are cut
+    size_type from = byCols_ ? j1 : i1;
+    size_type to = byCols_ ? j2 : i2;
+
+    for (size_type s = getShard(from / partitionSize_); s < getNumShards() && bounds_[s] * partitionSize_ <= to; s++) {
+
+        size_type first = std::max(from, bounds_[s] * partitionSize_);
+        size_type last = std::min(to, bounds_[s + 1] * partitionSize_ - 1);
+
+        queries.push_back(byCols_ ? ShardQuery(s, i1, i2, first, last) : ShardQuery(s, first, last, j1, j2));
+
+    }
+
+    return queries;
+
+}
+
+std::vector<ShardQuery> ShardManifest::splitSuccessors(size_type i) const {
+    return splitRange(i, i, 0, numCols_ - 1);
+}
+
+std::vector<ShardQuery> ShardManifest::splitPredecessors(size_type j) const {
+    return splitRange(0, numRows_ - 1, j, j);
+}
+
+void ShardManifest::serialize(std::ostream& out) const {
+
+    writeHeader(out, "ShardManifest", 0);
+
+    writeValue(out, numRows_);
+    writeValue(out, numCols_);
+    writeValue(out, kr_);
+    writeValue(out, kc_);
+    writeValue(out, partitionSize_);
+    writeValue(out, numPartitions_);
+    writeValue(out, byCols_);
+    writeVector(out, bounds_);
+
+}
+
+void ShardManifest::load(std::istream& in) {
+
+    readHeader(in, "ShardManifest", 0);
+
+    readValue(in, numRows_);
+    readValue(in, numCols_);
+    readValue(in, kr_);
+    readValue(in, kc_);
+    readValue(in, partitionSize_);
+    readValue(in, numPartitions_);
+    readValue(in, byCols_);
+    readVector(in, bounds_);
+
+}
 
 
 
@@ -279,48 +1004,185 @@ Subproblem::Subproblem(size_type fr, size_type lr, size_type fc, size_type lc, s
 
 }
 
+std::vector<size_type> splitLevel(const std::vector<Subproblem>& level, size_type numChunks) {
+
+    std::vector<size_type> bounds(1, 0);
+    if (level.empty()) {
+        return bounds;
+    }
+
+    size_type first = level.front().left;
+    size_type total = level.back().right - first;
+
+    for (size_type c = 1; c < numChunks; c++) {
+
+        // first subproblem starting at or after the c-th fraction of the pairs
+        size_type target = first + (total * c) / numChunks;
+        size_type s = std::lower_bound(level.begin() + bounds.back(), level.end(), target, [](const Subproblem& sp, size_type val) { return sp.left < val; }) - level.begin();
+
+        if ((s > bounds.back()) && (s < level.size())) {
+            bounds.push_back(s);
+        }
+
+    }
+
+    bounds.push_back(level.size());
+
+    return bounds;
+
+}
+
+
+
+
+
+void fenwickAdd(std::vector<size_type>& f, size_type b, size_type delta) {
+    for (b++; b < f.size(); b += b & (~b + 1)) {
+        f[b] += delta;
+    }
+}
+
+size_type fenwickPrefix(const std::vector<size_type>& f, size_type b) {
+
+    size_type res = 0;
+    for (; b > 0; b -= b & (~b + 1)) {
+        res += f[b];
+    }
+
+    return res;
+
+}
+
+std::vector<size_type> fenwickBuild(const std::vector<size_type>& values) {
 
+    std::vector<size_type> f(values.size() + 1, 0);
 
+    for (size_type b = 1; b < f.size(); b++) {
 
+        f[b] += values[b - 1];
+
+        size_type parent = b + (b & (~b + 1));
+        if (parent < f.size()) {
+            f[parent] += f[b];
+        }
+
+    }
+
+    return f;
 
-NaiveDynamicRank::NaiveDynamicRank() {
-    // nothing to do
 }
 
-NaiveDynamicRank::NaiveDynamicRank(const std::vector<bool>& arr) {
+size_type fenwickSearch(const std::vector<size_type>& f, size_type& x) {
+
+    size_type step = 1;
+    while (2 * step < f.size()) {
+        step *= 2;
+    }
+
+    size_type b = 0;
+    for (; step > 0; step /= 2) {
+
+        if ((b + step < f.size()) && (f[b + step] <= x)) {
+
+            b += step;
+            x -= f[b];
+
+        }
 
-    ranks_ = std::vector<size_type>(arr.size() + 1);
-    ranks_[0] = 0;
-    for (auto i = 0; i < arr.size(); i++) {
-        ranks_[i + 1] = ranks_[i] + arr[i];
     }
 
+    return b;
+
 }
 
-size_type NaiveDynamicRank::rank(size_type pos) {
-    return ranks_[pos];
+DynamicRank::DynamicRank() {
+    base_ = 0;
 }
 
-size_type NaiveDynamicRank::rankSafe(size_type pos) {
-    return ranks_[std::min(pos, ranks_.size() - 1)];
+DynamicRank::DynamicRank(const std::vector<bool>& arr) {
+
+    base_ = 0;
+    entries_ = DynamicVector<size_type>(arr.size(), 0);
+
+    for (size_type x = 0; x < arr.size(); x++) {
+        if (arr[x]) entries_[x] = 1;
+    }
+
+    rebuild();
+
 }
 
-void NaiveDynamicRank::increaseFrom(size_type pos, size_type inc) {
+size_type DynamicRank::rank(size_type pos) {
 
-    for (auto i = pos; i < ranks_.size(); i++) {
-        ranks_[i] += inc;
+    if (pos == 0) {
+        return base_;
     }
 
+    size_type o = pos - 1;
+    size_type b = entries_.locate(o);
+    auto& block = entries_.block(b);
+
+    return base_ + fenwickPrefix(sums_, b) + std::accumulate(block.begin(), block.begin() + o + 1, (size_type) 0);
+
+}
+
+size_type DynamicRank::rankSafe(size_type pos) {
+    return rank(std::min(pos, entries_.size()));
 }
 
-void NaiveDynamicRank::decreaseFrom(size_type pos, size_type dec) {
+void DynamicRank::increaseFrom(size_type pos, size_type inc) {
+
+    if (pos == 0) {
+
+        base_ += inc;
+        return;
 
-    for (auto i = pos; i < ranks_.size(); i++) {
-        ranks_[i] = (ranks_[i] > dec) * (ranks_[i] - dec);
     }
 
+    size_type o = pos - 1;
+    size_type b = entries_.locate(o);
+
+    entries_[pos - 1] += inc;
+    fenwickAdd(sums_, b, inc);
+
 }
 
-void NaiveDynamicRank::insert(size_type pos, size_type num) {
-    ranks_.insert(ranks_.begin() + pos, num, (pos > 0) * ranks_[pos - 1]);
+// note: only the entry at pos - 1 is clamped to zero (instead of all ranks from pos on)
+void DynamicRank::decreaseFrom(size_type pos, size_type dec) {
+
+    if (pos == 0) {
+
+        base_ -= std::min(base_, dec);
+        return;
+
+    }
+
+    size_type o = pos - 1;
+    size_type b = entries_.locate(o);
+
+    size_type d = std::min((size_type) entries_[pos - 1], dec);
+    entries_[pos - 1] -= d;
+    fenwickAdd(sums_, b, -d);
+
+}
+
+void DynamicRank::insert(size_type pos, size_type num) {
+
+    if (entries_.insert((pos > 0) ? pos - 1 : 0, num, 0)) {
+        rebuild();
+    } else if (sums_.size() != entries_.numBlocks() + 1) {
+        rebuild(); // first block
+    }
+
+}
+
+void DynamicRank::rebuild() {
+
+    std::vector<size_type> sums(entries_.numBlocks());
+    for (size_type b = 0; b < sums.size(); b++) {
+        sums[b] = std::accumulate(entries_.block(b).begin(), entries_.block(b).end(), (size_type) 0);
+    }
+
+    sums_ = fenwickBuild(sums);
+
 }
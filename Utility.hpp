@@ -24,14 +24,255 @@
 
 #include <algorithm>
 #include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <numeric>
+#include <streambuf>
+#include <stdexcept>
+#include <string>
+#include <thread>
 #include <vector>
 
+#include <sdsl/bit_vector_il.hpp>
+#include <sdsl/dac_vector.hpp>
 #include <sdsl/rank_support_v.hpp>
+#include <sdsl/rank_support_v5.hpp>
 
 typedef unsigned long size_type;
 
 typedef sdsl::bit_vector bit_vector_type;
-typedef sdsl::rank_support_v<> rank_type;
+
+/* Optional instrumentation of the queries (enabled with -DK2TREES_STATS, otherwise without any overhead) */
+
+// counters of the work done by the calling thread since the last reset()
+// (including the work done on its behalf by the workers of a WorkerPool)
+struct QueryStats {
+
+    size_type nodesVisited = 0; // internal nodes (of T) inspected
+    size_type rankCalls = 0; // calls to the rank data structure
+    size_type leafProbes = 0; // accesses to the last level (L)
+    size_type queuePushes = 0; // subrows pushed in the iterative (queue- / stack-based) traversals
+    size_type partitionsTouched = 0; // partitions accessed by UnevenKrKcTree and UnevenKrKcOrMiniTree
+
+    void reset() {
+        *this = QueryStats();
+    }
+
+    QueryStats& operator+=(const QueryStats& other) {
+
+        nodesVisited += other.nodesVisited;
+        rankCalls += other.rankCalls;
+        leafProbes += other.leafProbes;
+        queuePushes += other.queuePushes;
+        partitionsTouched += other.partitionsTouched;
+
+        return *this;
+
+    }
+
+};
+
+// returns the counters of the calling thread (which stay zero unless compiled with -DK2TREES_STATS)
+QueryStats& queryStats();
+
+#ifdef K2TREES_STATS
+#define K2TREES_COUNT(counter) (++queryStats().counter)
+#else
+#define K2TREES_COUNT(counter) ((void) 0)
+#endif
+
+// rank data structure R counting its calls in queryStats()
+template<typename R>
+class CountingRank : public R {
+
+public:
+    using R::R;
+
+    typename R::size_type rank(typename R::size_type i) const {
+
+        K2TREES_COUNT(rankCalls);
+        return R::rank(i);
+
+    }
+
+    typename R::size_type operator()(typename R::size_type i) const {
+        return rank(i);
+    }
+
+};
+
+#ifdef K2TREES_RANK_IL
+
+// number of bits per block of the interleaved representation of T (each block is stored together with its rank sample)
+const size_type K2TREES_IL_BLOCK_SIZE = 512;
+
+// internal levels (T) stored as sdsl::bit_vector_il, i.e. with the rank samples interleaved with the bits,
+// so that a rank query touches only one cache line instead of the bits and a separate sample;
+// T is written as a plain bit vector via begin() and converted by the rank data structure built on it (see InterleavedRank)
+class InterleavedBitVector {
+
+public:
+    typedef sdsl::bit_vector_il<K2TREES_IL_BLOCK_SIZE> interleaved_type;
+    typedef bit_vector_type::iterator iterator;
+
+    InterleavedBitVector() = default;
+
+    InterleavedBitVector(bit_vector_type bits) : bits_(std::move(bits)), size_(bits_.size()) {
+        // nothing to do
+    }
+
+    // access to the plain bits while building T (before the conversion)
+    iterator begin() {
+        return bits_.begin();
+    }
+
+    iterator end() {
+        return bits_.end();
+    }
+
+    size_type size() const {
+        return size_;
+    }
+
+    bool operator[](size_type i) const {
+        return interleaved_[i];
+    }
+
+    // converts the plain bits into the interleaved representation (only once) and returns the latter
+    const interleaved_type& convert() {
+
+        if (bits_.size() == size_) {
+
+            interleaved_ = interleaved_type(bits_);
+            bits_ = bit_vector_type();
+
+        }
+
+        return interleaved_;
+
+    }
+
+    size_type serialize(std::ostream& out, sdsl::structure_tree_node* v = nullptr, std::string name = "") const {
+        return interleaved_.serialize(out, v, name);
+    }
+
+    void load(std::istream& in) {
+
+        interleaved_.load(in);
+        bits_ = bit_vector_type();
+        size_ = interleaved_.size();
+
+    }
+
+private:
+    bit_vector_type bits_; // plain bits (only until the conversion)
+    interleaved_type interleaved_; // interleaved representation (after the conversion)
+    size_type size_ = 0; // number of bits
+
+};
+
+// rank data structure on an InterleavedBitVector, which it converts first
+class InterleavedRank : public sdsl::rank_support_il<1, K2TREES_IL_BLOCK_SIZE> {
+
+public:
+    typedef sdsl::rank_support_il<1, K2TREES_IL_BLOCK_SIZE> base_type;
+
+    explicit InterleavedRank(InterleavedBitVector* v = nullptr) : base_type((v != nullptr) ? &v->convert() : nullptr) {
+        // nothing to do
+    }
+
+    void load(std::istream& in, InterleavedBitVector* v) {
+        base_type::load(in, &v->convert());
+    }
+
+};
+
+#endif
+
+// representation of the internal levels (T) and rank data structure used for navigating them in all tree implementations,
+// selected at build time (the library and the code using it have to be compiled with the same selection):
+//  - by default sdsl::bit_vector with sdsl::rank_support_v<>, which needs 25% extra space on top of T
+//  - with -DK2TREES_RANK_V5 sdsl::rank_support_v5<>, which only needs 6.25% extra space, but is somewhat slower
+//  - with -DK2TREES_RANK_IL sdsl::bit_vector_il<> with sdsl::rank_support_il<> (12.5% extra space), whose rank samples
+//    are interleaved with the bits, i.e. one cache miss per level instead of two
+// bit_rank_type is the rank data structure used on other (plain) bit vectors, e.g. the non-empty rows of RowIndexedK2Tree;
+// with -DK2TREES_STATS, the selected data structures are wrapped into a CountingRank (without changing the binary format)
+#if defined(K2TREES_RANK_IL)
+typedef InterleavedBitVector level_vector_type;
+typedef InterleavedRank base_rank_type;
+typedef sdsl::rank_support_v<> base_bit_rank_type;
+const unsigned int K2TREES_RANK_ID = 2;
+#elif defined(K2TREES_RANK_V5)
+typedef bit_vector_type level_vector_type;
+typedef sdsl::rank_support_v5<> base_rank_type;
+typedef base_rank_type base_bit_rank_type;
+const unsigned int K2TREES_RANK_ID = 1;
+#else
+typedef bit_vector_type level_vector_type;
+typedef sdsl::rank_support_v<> base_rank_type;
+typedef base_rank_type base_bit_rank_type;
+const unsigned int K2TREES_RANK_ID = 0;
+#endif
+
+#ifdef K2TREES_STATS
+typedef CountingRank<base_rank_type> rank_type;
+typedef CountingRank<base_bit_rank_type> bit_rank_type;
+#else
+typedef base_rank_type rank_type;
+typedef base_bit_rank_type bit_rank_type;
+#endif
+
+// memory footprint of a data structure in bytes, broken down by component (see sizeInBytes() of K2Tree and RowTree);
+// for partitioned data structures, the components of all (loaded) partitions are added up
+struct SizeBreakdown {
+
+    size_type T = 0; // internal levels
+    size_type L = 0; // last level (plain or compressed)
+    size_type rank = 0; // rank data structure on T
+    size_type aux = 0; // optional auxiliary structures (emptied-subtree marks, counting index, table of top-level nodes)
+    size_type partitions = 0; // directory of the partitions (pointers and positions of partitions not yet deserialised) or of the rows of a RowIndexedK2Tree
+    size_type miniTrees = 0; // pairs / elements stored explicitly by MiniK2Trees and MiniRowTrees
+    size_type other = 0; // the objects themselves (parameters and handles) and all remaining buffers
+
+    size_type total() const {
+        return T + L + rank + aux + partitions + miniTrees + other;
+    }
+
+    SizeBreakdown& operator+=(const SizeBreakdown& other) {
+
+        T += other.T;
+        L += other.L;
+        rank += other.rank;
+        aux += other.aux;
+        partitions += other.partitions;
+        miniTrees += other.miniTrees;
+        this->other += other.other;
+
+        return *this;
+
+    }
+
+};
+
+// returns the number of bytes allocated by v
+template<typename T>
+size_type vectorBytes(const std::vector<T>& v) {
+    return v.capacity() * sizeof(T);
+}
+
+// prints the breakdown of a memory footprint (one component per line)
+void printSizeBreakdown(const SizeBreakdown& s);
+
+// number of entries of L covered by one sample of the (optional) counting index of the K2Tree implementations
+const size_type K2TREES_COUNT_SAMPLE_RATE = 256;
+
+// the (optional) lookup table of BasicK2Tree and HybridK2Tree may take at most this many times the space of T and its rank data structure
+const size_type K2TREES_LOOKUP_TABLE_MAX_RATIO = 1;
 
 /**
  * Position in a matrix plus an associated weight / value of type T.
@@ -134,23 +375,732 @@ struct ExtendedSubrowInfo {
 
     }
 
-};
+};
+
+// helper method for computation of log_k(n)
+size_type logK(const size_type n, const size_type k);
+
+// binary logarithm of a power of two k, usable in constant expressions (e.g. for compile-time arities)
+constexpr size_type logTwo(const size_type k) {
+    return (k <= 1) ? 0 : 1 + logTwo(k / 2);
+}
+
+// helper method for checking whether all elements of a vector have a certain value
+template<typename T>
+bool isAll(const std::vector<T>& v, const T val) {
+    return std::all_of(v.begin(), v.end(), [&val](const T& elem) {return val == elem;});
+}
+
+// helper methods for checking whether all bits are zero
+bool isAllZero(const std::vector<bool>& v);
+bool isAllZero(const bit_vector_type& v);
+
+// helper methods for scanning v[x..x+len) word by word instead of bit by bit
+// (used for the leaf chunks and rows of the bool specialisations)
+
+// returns v[x..x+len) (len <= 64) as the low-order bits of a word, i.e. bit i of the word is v[x + i]
+inline uint64_t getBits(const bit_vector_type& v, size_type x, size_type len) {
+    return (len == 0) ? 0 : v.get_int(x, len);
+}
+
+// returns the number of set bits in v[x..x+len)
+size_type countBits(const bit_vector_type& v, size_type x, size_type len);
+
+// checks whether v[x..x+len) contains a set bit (testing two aligned words at once with SSE4.1, if available)
+bool anyBitSet(const bit_vector_type& v, size_type x, size_type len);
+
+// returns the position of the first set bit in v[x..x+len) resp. x + len if there is none
+size_type findFirstBit(const bit_vector_type& v, size_type x, size_type len);
+
+// calls visitor(y) for the positions y of all set bits in v[x..x+len) (in ascending order) until it returns false,
+// returns false iff the scan has been stopped by the visitor
+template<typename F>
+bool forEachSetBit(const bit_vector_type& v, size_type x, size_type len, F visitor) {
+
+    for (size_type end = x + len; x < end; x += 64) {
+
+        for (uint64_t w = getBits(v, x, std::min(end - x, (size_type) 64)); w != 0; w &= w - 1) {
+            if (!visitor(x + sdsl::bits::lo(w))) return false;
+        }
+
+    }
+
+    return true;
+
+}
+
+// helper method for printing contents of a rank data structure
+void printRanks(const rank_type& r);
+
+
+
+/* Helper methods for writing / reading the binary representation of the data structures */
+
+// version of the binary format written by the serialize() methods
+// (version 2: valued BasicK2Tree, KrKcTree and HybridK2Tree additionally store their optionally compressed leaves,
+// version 3: the header additionally identifies the rank data structure, see K2TREES_RANK_ID,
+// version 4: BasicK2Tree, KrKcTree, HybridK2Tree, BasicRowTree and HybridRowTree additionally store their emptied-subtree marks,
+// version 5: UnevenKrKcTree and UnevenKrKcOrMiniTree prefix each of their partitions with its length, which mapFile() needs for locating them,
+// version 6: BasicK2Tree<bool>, KrKcTree<bool> and HybridK2Tree<bool> additionally store their optionally compressed leaves)
+const unsigned int K2TREES_FORMAT_VERSION = 6;
+
+// writes the header of a serialised data structure
+// (magic number, format version, identifier of the data structure, size of its values and identifier of the rank data structure)
+void writeHeader(std::ostream& out, const std::string& id, size_type elemSize);
+
+// reads and checks a header written by writeHeader() and returns the format version of the stream,
+// throws a std::runtime_error if it does not match the expected data structure
+unsigned int readHeader(std::istream& in, const std::string& id, size_type elemSize);
+
+// helper methods for writing / reading a single value of a trivially copyable type
+template<typename T>
+void writeValue(std::ostream& out, const T& val) {
+    out.write(reinterpret_cast<const char*>(&val), sizeof(T));
+}
+
+template<typename T>
+void readValue(std::istream& in, T& val) {
+    in.read(reinterpret_cast<char*>(&val), sizeof(T));
+}
+
+// helper methods for writing / reading an array of a trivially copyable type (without its length)
+template<typename T>
+void writeArray(std::ostream& out, const T* arr, size_type len) {
+    out.write(reinterpret_cast<const char*>(arr), len * sizeof(T));
+}
+
+template<typename T>
+void readArray(std::istream& in, T* arr, size_type len) {
+    in.read(reinterpret_cast<char*>(arr), len * sizeof(T));
+}
+
+// helper methods for writing / reading a vector of a trivially copyable type (preceded by its length)
+template<typename T>
+void writeVector(std::ostream& out, const std::vector<T>& v) {
+
+    writeValue(out, (size_type) v.size());
+    writeArray(out, v.data(), v.size());
+
+}
+
+template<typename T>
+void readVector(std::istream& in, std::vector<T>& v) {
+
+    size_type len;
+    readValue(in, len);
+
+    v = std::vector<T>(len);
+    readArray(in, v.data(), len);
+
+}
+
+// read-only, shared memory mapping of a whole file (throws a std::runtime_error if the file cannot be mapped)
+class MappedFile {
+
+public:
+    MappedFile(const std::string& path);
+
+    ~MappedFile();
+
+    const char* data() const;
+
+    size_type size() const;
+
+
+private:
+    const char* data_; // start of the mapped region
+    size_type size_; // length of the mapped region (in bytes)
+
+    MappedFile(const MappedFile& other); // not copyable
+    MappedFile& operator=(const MappedFile& other); // not copyable
+
+};
+
+// stream buffer reading directly from a memory region (e.g. a MappedFile) without copying it
+class MemoryStreamBuffer : public std::streambuf {
+
+public:
+    MemoryStreamBuffer(const char* data, size_type size);
+
+
+protected:
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which = std::ios_base::in) override;
+
+    pos_type seekpos(pos_type pos, std::ios_base::openmode which = std::ios_base::in) override;
+
+};
+
+// replaces the contents of the data structure with those of a file written by its serialize() method,
+// reading via a shared memory mapping of the file instead of copying it through a file stream
+template<typename T>
+void loadFromMappedFile(T& ds, const std::string& path) {
+
+    MappedFile file(path);
+    MemoryStreamBuffer buf(file.data(), file.size());
+    std::istream in(&buf);
+
+    ds.load(in);
+
+}
+
+
+
+/* Compressed representation of the last level (leaves) of K2Trees */
+
+// represents a leaf level L, consisting of blocks of blockSize consecutive values, by a dictionary of its distinct blocks
+// (sorted by decreasing frequency) and the dictionary index of every block as directly addressable code (DAC),
+// so that frequent blocks get the shortest codes; supports random access like the plain vector
+template<typename E>
+class LeafDictionary {
+
+public:
+    LeafDictionary() : blockSize_(0), size_(0) {
+        // nothing to do
+    }
+
+    LeafDictionary(const std::vector<E>& L, size_type blockSize) : blockSize_(blockSize), size_(L.size()) {
+
+        if ((blockSize == 0) || (L.size() % blockSize != 0)) {
+            throw std::runtime_error("Leaf level of length " + std::to_string(L.size()) + " does not consist of blocks of size " + std::to_string(blockSize) + ".");
+        }
+
+        size_type numBlocks = L.size() / blockSize;
+
+        // group equal blocks by sorting the block numbers lexicographically (by the blocks' contents)
+        std::vector<size_type> order(numBlocks);
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&](size_type a, size_type b) {
+            return std::lexicographical_compare(L.begin() + a * blockSize, L.begin() + (a + 1) * blockSize, L.begin() + b * blockSize, L.begin() + (b + 1) * blockSize);
+        });
+
+        // distinct blocks as (frequency, first index in order)
+        std::vector<std::pair<size_type, size_type>> distinct;
+        for (size_type x = 0; x < numBlocks; x++) {
+
+            if ((x == 0) || !std::equal(L.begin() + order[x - 1] * blockSize, L.begin() + (order[x - 1] + 1) * blockSize, L.begin() + order[x] * blockSize)) {
+                distinct.push_back(std::pair<size_type, size_type>(0, x));
+            }
+
+            distinct.back().first++;
+
+        }
+
+        std::stable_sort(distinct.begin(), distinct.end(), [](const std::pair<size_type, size_type>& a, const std::pair<size_type, size_type>& b) {
+            return a.first > b.first;
+        });
+
+        std::vector<uint64_t> codes(numBlocks);
+        values_.reserve(distinct.size() * blockSize);
+        for (size_type c = 0; c < distinct.size(); c++) {
+
+            size_type block = order[distinct[c].second];
+            values_.insert(values_.end(), L.begin() + block * blockSize, L.begin() + (block + 1) * blockSize);
+
+            for (size_type x = distinct[c].second; x < distinct[c].second + distinct[c].first; x++) {
+                codes[order[x]] = c;
+            }
+
+        }
+
+        codes_ = sdsl::dac_vector<>(codes);
+
+    }
+
+    // returns the value at position x of the represented leaf level
+    inline E operator[](size_type x) const {
+        return values_[codes_[x / blockSize_] * blockSize_ + x % blockSize_];
+    }
+
+    // length of the represented leaf level
+    size_type size() const {
+        return size_;
+    }
+
+    bool empty() const {
+        return size_ == 0;
+    }
+
+    size_type getNumDistinctBlocks() const {
+        return (blockSize_ == 0) ? 0 : values_.size() / blockSize_;
+    }
+
+    // returns the number of bytes allocated for the represented leaf level
+    size_type sizeInBytes() const {
+        return vectorBytes(values_) + sdsl::size_in_bytes(codes_);
+    }
+
+    void serialize(std::ostream& out) const {
+
+        writeValue(out, blockSize_);
+        writeValue(out, size_);
+        writeVector(out, values_);
+        codes_.serialize(out);
+
+    }
+
+    void load(std::istream& in) {
+
+        readValue(in, blockSize_);
+        readValue(in, size_);
+        readVector(in, values_);
+        codes_.load(in);
+
+    }
+
+
+private:
+    size_type blockSize_; // number of values per block
+    size_type size_; // length of the represented leaf level
+    // contents of the distinct blocks (one after another, by decreasing frequency); kept as plain vector since values of
+    // arbitrary type E cannot be put into a dac_vector (unsigned integers only) and the dictionary is the small part of the representation
+    std::vector<E> values_;
+    sdsl::dac_vector<> codes_; // dictionary index of every block of the leaf level
+
+};
+
+// variant for the bit-valued leaf levels of the bool specialisations (the "vocabulary" of leaf blocks of Brisaboa et al.),
+// whose distinct blocks are stored one after another in a bit vector; besides random access, it supports the word-wise
+// operations on ranges of the last level (see countBits(), anyBitSet(), findFirstBit() and forEachSetBit())
+template<>
+class LeafDictionary<bool> {
+
+public:
+    LeafDictionary() : blockSize_(0), size_(0) {
+        // nothing to do
+    }
+
+    LeafDictionary(const bit_vector_type& L, size_type blockSize);
+
+    // returns the bit at position x of the represented leaf level
+    inline bool operator[](size_type x) const {
+        return values_[codes_[x / blockSize_] * blockSize_ + x % blockSize_];
+    }
+
+    // length of the represented leaf level
+    size_type size() const {
+        return size_;
+    }
+
+    bool empty() const {
+        return size_ == 0;
+    }
+
+    size_type getNumDistinctBlocks() const {
+        return (blockSize_ == 0) ? 0 : values_.size() / blockSize_;
+    }
+
+    // returns the number of bytes allocated for the represented leaf level
+    size_type sizeInBytes() const {
+        return sdsl::size_in_bytes(values_) + sdsl::size_in_bytes(codes_);
+    }
+
+    // returns the number of set bits in [x, x + len)
+    size_type countBits(size_type x, size_type len) const;
+
+    // checks whether there is a set bit in [x, x + len)
+    bool anyBitSet(size_type x, size_type len) const;
+
+    // returns the position of the first set bit in [x, x + len) (x + len if there is none)
+    size_type findFirstBit(size_type x, size_type len) const;
+
+    // calls visitor(y) for the positions y of all set bits in [x, x + len) in increasing order
+    // until visitor returns false (then false is returned, otherwise true)
+    template<typename F>
+    bool forEachSetBit(size_type x, size_type len, F visitor) const {
+
+        return forEachPart(x, len, [&](size_type start, size_type pos, size_type part) {
+            return ::forEachSetBit(values_, pos, part, [&](size_type y) { return visitor(start + (y - pos)); });
+        });
+
+    }
+
+    void serialize(std::ostream& out) const;
+
+    void load(std::istream& in);
+
+
+private:
+    size_type blockSize_; // number of bits per block
+    size_type size_; // length of the represented leaf level
+    bit_vector_type values_; // contents of the distinct blocks (one after another, by decreasing frequency)
+    sdsl::dac_vector<> codes_; // dictionary index of every block of the leaf level
+
+    // splits [x, x + len) at the block boundaries and calls f(start, pos, part) for every piece [start, start + part)
+    // (stored at values_[pos..pos+part)) in increasing order until f returns false (then false is returned, otherwise true)
+    template<typename F>
+    bool forEachPart(size_type x, size_type len, F f) const {
+
+        for (size_type end = x + len; x < end; ) {
+
+            size_type offset = x % blockSize_;
+            size_type part = std::min(end - x, blockSize_ - offset);
+
+            if (!f(x, codes_[x / blockSize_] * blockSize_ + offset, part)) {
+                return false;
+            }
+
+            x += part;
+
+        }
+
+        return true;
+
+    }
+
+};
+
+
+
+/* Sequential, buffered reading of relation pairs for the streaming construction of the data structures */
+
+// reads records (row, column, value) of type ValuedPosition<T> from a stream, either as binary records
+// (row and column as size_type followed by the value) or as whitespace-separated text;
+// for T = bool, a record only consists of row and column and its value is always true
+template<typename T>
+class PairReader {
+
+public:
+    PairReader(std::istream& in, const bool binary = false, const size_type bufferSize = 1 << 16) : in_(in) {
+
+        binary_ = binary;
+        bufferSize_ = std::max(bufferSize, (size_type) 1);
+        pos_ = 0;
+        consumed_ = 0;
+
+    }
+
+    // returns true iff there is a (further) record
+    bool hasNext() {
+
+        if (pos_ == buffer_.size()) {
+            refill();
+        }
+
+        return pos_ < buffer_.size();
+
+    }
+
+    // returns the current record (only valid if hasNext() returned true)
+    const ValuedPosition<T>& peek() const {
+        return buffer_[pos_];
+    }
+
+    // moves on to the next record
+    void next() {
+
+        pos_++;
+        consumed_++;
+
+    }
+
+    // returns the number of records consumed so far
+    size_type getConsumed() const {
+        return consumed_;
+    }
+
+
+private:
+    std::istream& in_; // source of the records
+    bool binary_; // whether the records are stored in binary or text form
+    size_type bufferSize_; // maximum number of records read ahead
+    std::vector<ValuedPosition<T>> buffer_; // records read ahead
+    size_type pos_; // position of the current record in buffer_
+    size_type consumed_; // number of records consumed so far
+
+    void refill() {
+
+        buffer_.clear();
+        pos_ = 0;
+
+        ValuedPosition<T> rec;
+        while ((buffer_.size() < bufferSize_) && readRecord(rec)) {
+            buffer_.push_back(rec);
+        }
+
+    }
+
+    bool readRecord(ValuedPosition<T>& rec) {
+
+        if (binary_) {
+
+            readValue(in_, rec.row);
+            readValue(in_, rec.col);
+
+        } else {
+            in_ >> rec.row >> rec.col;
+        }
+        readRecordValue(rec.val);
+
+        return !in_.fail();
+
+    }
+
+    void readRecordValue(T& val) {
+
+        if (binary_) {
+            readValue(in_, val);
+        } else {
+            in_ >> val;
+        }
+
+    }
+
+};
+
+template<>
+inline void PairReader<bool>::readRecordValue(bool& val) {
+    val = true;
+}
+
+
+
+/* Helper methods for parallel construction and queries */
+
+// calls f(0), ..., f(n - 1) using up to numThreads threads (sequentially in the calling thread if numThreads <= 1)
+// indices are handed out one at a time so that tasks of varying size are balanced,
+// the first exception thrown by f is rethrown in the calling thread once all threads have finished
+void parallelFor(size_type n, size_type numThreads, const std::function<void(size_type)>& f);
+
+// Fixed set of threads for fanning out short tasks (e.g. the partitions touched by a query) without creating threads per call.
+// run() hands task k always to the same worker (k mod size(), the calling thread being worker 0), so that repeated queries
+// find "their" partitions in the cache of that worker. Only one run() is executed at a time, concurrent (or nested) calls
+// do not wait for the workers, but execute their tasks sequentially in the calling thread.
+// With -DK2TREES_STATS, the counters of the workers are added to the queryStats() of the calling thread.
+class WorkerPool {
+
+public:
+    // creates numThreads - 1 worker threads (the calling thread of run() takes part in every job)
+    WorkerPool(size_type numThreads);
+
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    // returns the number of threads executing a job (including the calling thread)
+    size_type size() const;
+
+    // calls f(first), ..., f(last - 1) and returns once all calls have finished,
+    // the first exception thrown by f is rethrown in the calling thread
+    void run(size_type first, size_type last, const std::function<void(size_type)>& f);
+
+private:
+    std::vector<std::thread> threads_;
+
+    std::mutex runMutex_; // held by the caller of the running job
+    std::mutex mutex_; // guards the description and the state of the current job
+    std::condition_variable wake_; // signals a new job (or the shutdown) to the workers
+    std::condition_variable done_; // signals the completion of the current job to its caller
+
+    const std::function<void(size_type)>* job_ = 0;
+    size_type first_ = 0;
+    size_type last_ = 0;
+    size_type generation_ = 0; // number of jobs started so far
+    size_type pending_ = 0; // number of workers still executing the current job
+    bool stop_ = false;
+    std::exception_ptr error_;
+#ifdef K2TREES_STATS
+    QueryStats stats_; // counters of the workers for the current job
+#endif
+
+    void work(size_type w);
+
+    void execute(size_type w);
+
+};
+
+
+
+/* Horizontal sharding of partitioned K2Trees (UnevenKrKcTree) */
+
+// subquery of a query split by a ShardManifest: the part [i1, i2] x [j1, j2] of the query that falls into shard
+struct ShardQuery {
+
+    size_type shard; // number / index of the shard
+    size_type i1; // first row
+    size_type i2; // last row
+    size_type j1; // first column
+    size_type j2; // last column
+
+    ShardQuery() {
+        // nothing to do
+    }
+
+    ShardQuery(size_type s, size_type r1, size_type r2, size_type c1, size_type c2) {
+
+        shard = s;
+        i1 = r1;
+        i2 = r2;
+        j1 = c1;
+        j2 = c2;
+
+    }
+
+};
+
+// Routing information of a relation whose UnevenKrKcTree is split into shards, shard s consisting of the consecutive partitions
+// getFirstPartition(s), ..., getFirstPartition(s + 1) - 1 (i.e. of a range of columns if isColumnPartitioned(), otherwise of a range of rows).
+// Every shard is an UnevenKrKcTree with the dimensions of the whole relation, in which the partitions of the other shards are empty,
+// so that the shards answer queries with the positions of the whole relation: concatenating the answers of the subqueries returned by
+// splitRange(), splitSuccessors() and splitPredecessors() in their order (see mergeShardAnswers()) yields the answer of the whole relation.
+class ShardManifest {
+
+public:
+    ShardManifest();
+
+    // sharding of the UnevenKrKcTree with arities kr, kc for a relation with (at most) numRows rows and numCols columns
+    // into numShards shards of (almost) equally many partitions (into fewer shards if there are less partitions)
+    ShardManifest(size_type numRows, size_type numCols, size_type kr, size_type kc, size_type numShards);
+
+    // same, but shard s consists of the partitions bounds[s], ..., bounds[s + 1] - 1
+    // (throws a std::runtime_error unless bounds starts with 0, strictly increases and ends with getNumPartitions())
+    ShardManifest(size_type numRows, size_type numCols, size_type kr, size_type kc, const std::vector<size_type>& bounds);
+
+    // returns the number of rows (columns) of the relation matrix as represented by the UnevenKrKcTree
+    size_type getNumRows() const;
+
+    size_type getNumCols() const;
+
+    // returns the arities of the UnevenKrKcTree
+    size_type getKr() const;
+
+    size_type getKc() const;
+
+    // returns the number of columns (rows) per partition if isColumnPartitioned() (otherwise)
+    size_type getPartitionSize() const;
+
+    size_type getNumPartitions() const;
+
+    // returns whether the partitions cover ranges of columns (otherwise they cover ranges of rows)
+    bool isColumnPartitioned() const;
+
+    size_type getNumShards() const;
+
+    // returns the first partition of shard s (getNumPartitions() for s = getNumShards())
+    size_type getFirstPartition(size_type s) const;
+
+    // returns the shard the k-th partition belongs to
+    size_type getShard(size_type k) const;
+
+    // returns the first and the last row (column) covered by shard s
+    std::pair<size_type, size_type> getRows(size_type s) const;
+
+    std::pair<size_type, size_type> getCols(size_type s) const;
+
+    // returns the shard responsible for position (i, j)
+    size_type route(size_type i, size_type j) const;
+
+    // splits the range query [i1, i2] x [j1, j2] into subqueries (getRange(), getPositionsInRange() etc. on the shards),
+    // parts of the range outside of the relation matrix are dropped
+    std::vector<ShardQuery> splitRange(size_type i1, size_type i2, size_type j1, size_type j2) const;
+
+    // splits the successor query of row i (predecessor query of column j) into subqueries asking
+    // the same query (getSuccessors(i), getPredecessors(j) etc.) of the shards
+    std::vector<ShardQuery> splitSuccessors(size_type i) const;
+
+    std::vector<ShardQuery> splitPredecessors(size_type j) const;
+
+    void serialize(std::ostream& out) const;
+
+    void load(std::istream& in);
+
+
+private:
+    size_type numRows_; // number of rows of the represented relation matrix
+    size_type numCols_; // number of columns of the represented relation matrix
+    size_type kr_; // row arity of the UnevenKrKcTree
+    size_type kc_; // column arity of the UnevenKrKcTree
+    size_type partitionSize_; // number of columns (rows) per partition if byCols_ (otherwise)
+    size_type numPartitions_; // number of partitions
+    bool byCols_; // whether the partitions cover ranges of columns
+    std::vector<size_type> bounds_; // first partition of every shard (and number of partitions)
+
+    // determines the partitioning as done by UnevenKrKcTree for the given dimensions and arities
+    void init(size_type numRows, size_type numCols, size_type kr, size_type kc);
+
+};
+
+// concatenates the answers of the subqueries of a ShardManifest (in the order of the subqueries) to the answer of the whole query
+template<typename V>
+V mergeShardAnswers(const std::vector<V>& answers) {
+
+    size_type num = 0;
+    for (auto& a : answers) {
+        num += a.size();
+    }
+
+    V res;
+    res.reserve(num);
+    for (auto& a : answers) {
+        res.insert(res.end(), a.begin(), a.end());
+    }
+
+    return res;
+
+}
+
+
+
+/* Helper methods for set operations between K2Trees */
+
+enum SetOperation {
+    SET_UNION, SET_INTERSECTION, SET_DIFFERENCE
+};
+
+// removes the blocks of children (of size blockSize) that only contain null elements,
+// the corresponding bits in parent (one set bit per block of children) are cleared
+template<typename T>
+void pruneEmptyBlocks(std::vector<bool>& parent, std::vector<T>& children, const size_type blockSize, const T null) {
+
+    size_type block = 0;
+    size_type kept = 0;
+
+    for (size_type x = 0; x < parent.size(); x++) {
+
+        if (parent[x]) {
+
+            bool empty = true;
+            for (size_type i = block * blockSize; i < (block + 1) * blockSize && empty; i++) {
+                empty = (children[i] == null);
+            }
+
+            if (empty) {
+                parent[x] = false;
+            } else {
+
+                for (size_type i = 0; i < blockSize; i++) {
+                    children[kept * blockSize + i] = children[block * blockSize + i];
+                }
+                kept++;
+
+            }
+
+            block++;
+
+        }
+
+    }
+
+    children.resize(kept * blockSize);
 
-// helper method for computation of log_k(n)
-size_type logK(const size_type n, const size_type k);
+}
 
-// helper method for checking whether all elements of a vector have a certain value
+// removes all empty subtrees from a level-wise representation of a K2Tree (internal levels and leaves, bottom-up)
 template<typename T>
-bool isAll(const std::vector<T>& v, const T val) {
-    return std::all_of(v.begin(), v.end(), [&val](const T& elem) {return val == elem;});
-}
+void pruneEmptyBlocks(std::vector<std::vector<bool>>& levels, std::vector<T>& leaves, const size_type blockSize, const T null) {
 
-// helper methods for checking whether all bits are zero
-bool isAllZero(const std::vector<bool>& v);
-bool isAllZero(const bit_vector_type& v);
+    if (levels.empty()) {
+        return;
+    }
 
-// helper method for printing contents of a rank data structure
-void printRanks(const rank_type& r);
+    pruneEmptyBlocks(levels.back(), leaves, blockSize, null);
+
+    for (size_type l = levels.size() - 1; l > 0; l--) {
+        pruneEmptyBlocks(levels[l - 1], levels[l], blockSize, false);
+    }
+
+}
 
 
 
@@ -597,23 +1547,44 @@ size_type countElemsMat(std::vector<std::vector<T>>& mat, T null = T()) {
 
 /* Representation of nodes in intermediate tree representation of k^2-trees */
 
+// All nodes of a tree and their children arrays are allocated from an arena owned by the root (i.e. the node created via new),
+// so that the tree is built without one allocation per node and freed at once when the root is deleted.
 template<typename T>
 class Node {
+
+    struct Arena;
+
 public:
     Node(T lab) {
+
+        lab_ = lab;
+        arena_ = new Arena();
+        ownsArena_ = true;
+
+    }
+
+    Node(T lab, Arena* arena) {
+
         lab_ = lab;
+        arena_ = arena;
+        ownsArena_ = false;
+
     }
 
+    Node(const Node&) = delete;
+
+    Node& operator=(const Node&) = delete;
+
     ~Node() {
 
-        for (auto c : children_) {
-            delete c;
+        if (ownsArena_) {
+            delete arena_;
         }
 
     }
 
     bool isLeaf() {
-        return children_.size() == 0;
+        return arity_ == 0;
     }
 
     T getLabel() {
@@ -621,17 +1592,17 @@ public:
     }
 
     bool hasChild(size_type i) {
-        return (i < children_.size()) && (children_[i] != 0);
+        return (i < arity_) && (children_[i] != 0);
     }
 
     Node* getChild(size_type i) {
-        return (i < children_.size()) ? children_[i] : 0;
+        return (i < arity_) ? children_[i] : 0;
     }
 
     Node* addChild(size_type i, T lab) {
 
         if (children_[i] == 0) {
-            children_[i] = new Node(lab);
+            children_[i] = arena_->newNode(lab);
         } else {
             children_[i]->lab_ = lab;
         }
@@ -641,23 +1612,60 @@ public:
 
     void turnInternal(size_type arity, bool f) {
 
-        children_ = std::vector<Node*>(arity);
+        children_ = arena_->newChildren(arity);
+        arity_ = arity;
 
         if (f) {
             for (auto i = 0; i < arity; i++) {
-                children_[i] = new Node(T());
+                children_[i] = arena_->newNode(T());
             }
         }
 
     }
 
     size_type getArity() {
-        return children_.size();
+        return arity_;
     }
 
 private:
+    // nodes and children arrays are carved out of large chunks, which are never moved or freed before the arena itself
+    struct Arena {
+
+        static const size_type chunkSize = 1 << 16;
+
+        std::deque<Node> nodes;
+        std::vector<std::vector<Node*>> children; // chunks of children arrays
+        size_type used = 0; // used entries of the last chunk of children arrays
+
+        Node* newNode(T lab) {
+
+            nodes.emplace_back(lab, this);
+            return &nodes.back();
+
+        }
+
+        Node** newChildren(size_type arity) {
+
+            if (children.empty() || (used + arity > children.back().size())) {
+
+                children.emplace_back(std::max((size_type) chunkSize, arity), (Node*) 0);
+                used = 0;
+
+            }
+
+            used += arity;
+            return &children.back()[used - arity];
+
+        }
+
+    };
+
     T lab_;
-    std::vector<Node*> children_;
+    Node** children_ = 0;
+    size_type arity_ = 0;
+
+    Arena* arena_;
+    bool ownsArena_;
 
 };
 
@@ -680,15 +1688,509 @@ struct Subproblem {
 
 };
 
+// per-worker state of the level-wise inplace construction: the contribution of the worker to the current level
+// and scratch space for reordering the pairs that is reused across all subproblems handled by the worker
+template<typename P, typename V>
+struct LevelBuildState {
+
+    std::vector<Subproblem> next; // subproblems of the next level
+    std::vector<bool> T; // bits appended to T
+    std::vector<V> L; // values appended to L
+
+    std::vector<std::pair<size_type, size_type>> intervals; // intervals of the children of the last sorted subproblem
+    std::vector<size_type> counts; // key counts / starting indices
+    P tmpPairs; // buffer for reordering the pairs of a subproblem
+
+};
+
+// stable counting sort of pairs[left, right) by key(pair) (from [0, sup)) using up to numThreads threads,
+// afterwards intervals[k] is the interval of the pairs with key k (relative to left), counts and tmpPairs are reusable scratch space
+template<typename P, typename K>
+void countingSortByKey(P& pairs, size_type left, size_type right, size_type sup, K key, std::vector<std::pair<size_type, size_type>>& intervals, std::vector<size_type>& counts, P& tmpPairs, size_type numThreads) {
+
+    const size_type minBlockSize = 1 << 16; // smaller ranges are not worth additional threads
+
+    size_type n = right - left;
+    size_type blocks = std::max((size_type) 1, std::min(numThreads, n / minBlockSize));
+
+    counts.assign(blocks * sup, 0);
+    intervals.resize(sup);
+    if (tmpPairs.size() < n) {
+        tmpPairs.resize(n);
+    }
+
+    auto blockStart = [&](size_type b) {
+        return left + (n * b) / blocks;
+    };
+
+    // determine key frequencies (per block)
+    parallelFor(blocks, blocks, [&](size_type b) {
+
+        size_type* c = &counts[b * sup];
+        for (size_type i = blockStart(b); i < blockStart(b + 1); i++) {
+            c[key(pairs[i])]++;
+        }
+
+    });
+
+    // determine starting index for each key (and block)
+    size_type total = 0;
+    size_type tmp;
+
+    for (size_type k = 0; k < sup; k++) {
+
+        intervals[k].first = total;
+
+        for (size_type b = 0; b < blocks; b++) {
+
+            tmp = counts[b * sup + k];
+            counts[b * sup + k] = total;
+            total += tmp;
+
+        }
+
+        intervals[k].second = total;
+
+    }
+
+    // reorder pairs of the range
+    parallelFor(blocks, blocks, [&](size_type b) {
+
+        size_type* c = &counts[b * sup];
+        for (size_type i = blockStart(b); i < blockStart(b + 1); i++) {
+            tmpPairs[c[key(pairs[i])]++] = pairs[i];
+        }
+
+    });
+
+    parallelFor(blocks, blocks, [&](size_type b) {
+        std::copy(tmpPairs.begin() + (blockStart(b) - left), tmpPairs.begin() + (blockStart(b + 1) - left), pairs.begin() + blockStart(b));
+    });
+
+}
+
+// splits the subproblems of one level (ordered and covering consecutive intervals of the pairs)
+// into at most numChunks consecutive chunks with roughly the same number of pairs, chunk c consists of level[bounds[c]] to level[bounds[c + 1] - 1]
+std::vector<size_type> splitLevel(const std::vector<Subproblem>& level, size_type numChunks);
+
+// processes all subproblems of one level by calling process(state, subproblem, sortThreads) with up to numThreads threads (one chunk of the level per state)
+// and appends the contributions of the chunks in order, so that T, L and the next level are the same as in a sequential breadth-first traversal
+// (if the level has fewer chunks than threads, the remaining threads are handed to the chunks via sortThreads, e.g. for countingSortByKey())
+template<typename P, typename V, typename F>
+void processLevel(std::vector<Subproblem>& level, std::vector<LevelBuildState<P, V>>& states, size_type numThreads, std::vector<bool>& T, std::vector<V>& L, F process) {
+
+    auto bounds = splitLevel(level, states.size());
+    size_type sortThreads = std::max((size_type) 1, numThreads / (bounds.size() - 1));
+
+    parallelFor(bounds.size() - 1, numThreads, [&](size_type c) {
+
+        auto& state = states[c];
+        state.next.clear();
+        state.T.clear();
+        state.L.clear();
+
+        for (size_type s = bounds[c]; s < bounds[c + 1]; s++) {
+            process(state, level[s], sortThreads);
+        }
+
+    });
+
+    level.clear();
+    for (size_type c = 0; c + 1 < bounds.size(); c++) {
+
+        auto& state = states[c];
+
+        T.insert(T.end(), state.T.begin(), state.T.end());
+        L.insert(L.end(), state.L.begin(), state.L.end());
+
+        if (level.empty()) {
+            level.swap(state.next); // avoids copying in the sequential case
+        } else {
+            level.insert(level.end(), state.next.begin(), state.next.end());
+        }
+
+    }
+
+}
+
+
+/* Construction from pairs sorted by their mixed-radix keys */
+
+// accessors for both representations of the pairs (the positions of a relation are related, i.e. have the value true)
+inline size_type pairRow(const std::pair<size_type, size_type>& p) {
+    return p.first;
+}
+
+inline size_type pairCol(const std::pair<size_type, size_type>& p) {
+    return p.second;
+}
+
+inline bool pairValue(const std::pair<size_type, size_type>&) {
+    return true;
+}
+
+template<typename T>
+inline size_type pairRow(const ValuedPosition<T>& p) {
+    return p.row;
+}
+
+template<typename T>
+inline size_type pairCol(const ValuedPosition<T>& p) {
+    return p.col;
+}
+
+template<typename T>
+inline T pairValue(const ValuedPosition<T>& p) {
+    return p.val;
+}
+
+// stable LSD radix sort of items by key(item) (from [0, maxKey]) with 8-bit digits using up to numThreads threads (tmp is scratch space),
+// i.e. ceil(log_256(maxKey + 1)) passes over the items
+template<typename V, typename K>
+void radixSortByKey(std::vector<V>& items, K key, uint64_t maxKey, std::vector<V>& tmp, size_type numThreads) {
+
+    const size_type digitBits = 8;
+    const size_type radix = 1 << digitBits;
+    const size_type minBlockSize = 1 << 16; // smaller ranges are not worth additional threads
+
+    size_type n = items.size();
+    size_type blocks = std::max((size_type) 1, std::min(numThreads, n / minBlockSize));
+    std::vector<size_type> counts(blocks * radix);
+    tmp.resize(n);
+
+    auto blockStart = [&](size_type b) {
+        return (n * b) / blocks;
+    };
+
+    for (size_type shift = 0; (shift < 64) && ((maxKey >> shift) != 0); shift += digitBits) {
+
+        std::fill(counts.begin(), counts.end(), 0);
+
+        // determine digit frequencies (per block)
+        parallelFor(blocks, blocks, [&](size_type b) {
+
+            size_type* c = &counts[b * radix];
+            for (size_type i = blockStart(b); i < blockStart(b + 1); i++) {
+                c[(key(items[i]) >> shift) & (radix - 1)]++;
+            }
+
+        });
+
+        // determine starting index for each digit (and block)
+        size_type total = 0;
+        for (size_type d = 0; d < radix; d++) {
+            for (size_type b = 0; b < blocks; b++) {
+
+                size_type cnt = counts[b * radix + d];
+                counts[b * radix + d] = total;
+                total += cnt;
+
+            }
+        }
+
+        parallelFor(blocks, blocks, [&](size_type b) {
+
+            size_type* c = &counts[b * radix];
+            for (size_type i = blockStart(b); i < blockStart(b + 1); i++) {
+                tmp[c[(key(items[i]) >> shift) & (radix - 1)]++] = items[i];
+            }
+
+        });
+
+        items.swap(tmp);
+
+    }
+
+}
+
+// builds the levels of a k^2-tree with arities kr[l] x kc[l] on level l (from the root) over a matrix with the product of the kr as number of rows
+// and the product of the kc as number of columns from pairs (which remain unchanged) and appends them to T (all but the last level) and L (last level,
+// filled with null), the number of ones on each level is stored in levelOnes (if not nullptr)
+//
+// Instead of partitioning the pairs level by level, the mixed-radix key of each pair (the concatenation of the child indices on its path
+// from the root, a generalisation of the Z-order) is computed once, all keys are radix-sorted and the levels are emitted in a single sweep:
+// in key order, the nodes of each level occur in breadth-first order, and a pair starts new nodes on all levels below the first child index
+// in which its key differs from the previous one.
+// Returns false without changing T and L if the keys do not fit into 64 bits.
+template<typename P, typename V>
+bool buildLevelsFromSortedKeys(const P& pairs, const std::vector<size_type>& kr, const std::vector<size_type>& kc, const V null, std::vector<bool>& T, std::vector<V>& L,
+                               size_type numThreads, std::vector<size_type>* levelOnes = nullptr) {
+
+    size_type h = kr.size();
+
+    // weights of the child indices in the key (from the root) and the sizes of the submatrices of each level
+    std::vector<uint64_t> weights(h);
+    std::vector<size_type> rows(h), cols(h);
+    uint64_t maxKey = 1;
+    size_type numRows = 1, numCols = 1;
+
+    for (size_type l = h; l-- > 0;) {
+
+        rows[l] = numRows;
+        cols[l] = numCols;
+        weights[l] = maxKey;
+
+        uint64_t numChildren = kr[l] * kc[l];
+        if (maxKey > std::numeric_limits<uint64_t>::max() / numChildren) {
+            return false;
+        }
+
+        maxKey *= numChildren;
+        numRows *= kr[l];
+        numCols *= kc[l];
+
+    }
+    maxKey--;
+
+    // compute the keys
+    size_type blocks = std::max((size_type) 1, numThreads);
+    std::vector<std::pair<uint64_t, V>> items(pairs.size());
+    parallelFor(blocks, blocks, [&](size_type b) {
+
+        for (size_type x = (pairs.size() * b) / blocks; x < (pairs.size() * (b + 1)) / blocks; x++) {
+
+            size_type i = pairRow(pairs[x]);
+            size_type j = pairCol(pairs[x]);
+            uint64_t key = 0;
+
+            for (size_type l = 0; l < h; l++) {
+
+                key += ((i / rows[l]) * kc[l] + j / cols[l]) * weights[l];
+                i %= rows[l];
+                j %= cols[l];
+
+            }
+
+            items[x] = std::make_pair(key, V(pairValue(pairs[x])));
+
+        }
+
+    });
+
+    {
+        std::vector<std::pair<uint64_t, V>> tmp;
+        radixSortByKey(items, [](const std::pair<uint64_t, V>& item) { return item.first; }, maxKey, tmp, numThreads);
+    }
+
+    // emit the levels in one sweep over the sorted keys
+    std::vector<std::vector<bool>> levels(h - 1);
+    std::vector<size_type> blockStart(h); // position of the current node of each level
+    std::vector<size_type> prev(h), cur(h); // child indices of the previous and the current key
+    std::vector<size_type> ones(h, 0);
+
+    for (size_type x = 0; x < items.size(); x++) {
+
+        for (size_type l = 0; l < h; l++) {
+            cur[l] = (items[x].first / weights[l]) % (kr[l] * kc[l]);
+        }
+
+        // first level in which the path differs from the one of the previous key
+        size_type d = 0;
+        for (; (x != 0) && (d < h) && (cur[d] == prev[d]); d++) { }
+
+        for (size_type l = d; l < h; l++) {
+
+            bool newNode = (x == 0) || (l > d);
+            ones[l]++;
+
+            if (l + 1 < h) {
+
+                if (newNode) {
+
+                    blockStart[l] = levels[l].size();
+                    levels[l].resize(levels[l].size() + kr[l] * kc[l], false);
+
+                }
+
+                levels[l][blockStart[l] + cur[l]] = true;
+
+            } else if (newNode) {
+
+                blockStart[l] = L.size();
+                L.resize(L.size() + kr[l] * kc[l], null);
+
+            }
+
+        }
+
+        // duplicates overwrite the previous value (like in the level-wise construction)
+        L[blockStart[h - 1] + cur[h - 1]] = items[x].second;
+        std::swap(prev, cur);
+
+    }
+
+    items.clear();
+    items.shrink_to_fit();
+
+    for (auto& level : levels) {
+        T.insert(T.end(), level.begin(), level.end());
+    }
+
+    if (levelOnes != nullptr) {
+        *levelOnes = ones;
+    }
+
+    return true;
+
+}
+
+
+/* Dynamic sequences for intermediate steps (construction via dynamic bitmaps) */
+
+// Fenwick tree over f[1..n] (f[0] is unused): adds delta to value b (0-based) resp. returns the sum of the first b values
+void fenwickAdd(std::vector<size_type>& f, size_type b, size_type delta);
+
+size_type fenwickPrefix(const std::vector<size_type>& f, size_type b);
+
+// builds the Fenwick tree of the given values in linear time
+std::vector<size_type> fenwickBuild(const std::vector<size_type>& values);
+
+// returns the largest number of values whose sum is at most x and subtracts that sum from x
+size_type fenwickSearch(const std::vector<size_type>& f, size_type& x);
+
+// Sequence with insertions at arbitrary positions: the entries are kept in blocks of about blockSize entries,
+// a Fenwick tree over the sizes of the blocks locates an entry in logarithmic time, so that an insertion only shifts
+// the entries of one block (instead of all following ones, as std::vector::insert does).
+template<typename V>
+class DynamicVector {
+
+public:
+    static const size_type blockSize = 1024; // blocks are split once they have grown to twice this size
+
+    DynamicVector() {
+        size_ = 0;
+    }
+
+    DynamicVector(size_type n, const V& val = V()) {
+
+        size_ = n;
+        for (size_type x = 0; x < n; x += blockSize) {
+            blocks_.push_back(std::vector<V>(std::min(n - x, (size_type) blockSize), val));
+        }
+
+        rebuild();
+
+    }
+
+    size_type size() const {
+        return size_;
+    }
+
+    bool empty() const {
+        return size_ == 0;
+    }
+
+    typename std::vector<V>::reference operator[](size_type x) {
+
+        size_type b = locate(x);
+        return blocks_[b][x];
+
+    }
+
+    V operator[](size_type x) const {
+
+        size_type b = locate(x);
+        return blocks_[b][x];
+
+    }
+
+    // inserts num copies of val in front of entry x (or behind the last entry if x == size()),
+    // returns whether a block has been split (which changes the numbering of the blocks)
+    bool insert(size_type x, size_type num, const V& val) {
+
+        if (blocks_.empty()) {
+
+            blocks_.push_back(std::vector<V>());
+            rebuild();
+
+        }
+
+        size_type b;
+        if (x < size_) {
+            b = locate(x);
+        } else {
+
+            b = blocks_.size() - 1;
+            x = blocks_[b].size();
+
+        }
+
+        blocks_[b].insert(blocks_[b].begin() + x, num, val);
+        size_ += num;
 
-/* Dynamic, but naive rank data structure for intermediate steps. */
+        if (blocks_[b].size() < 2 * blockSize) {
 
-class NaiveDynamicRank {
+            fenwickAdd(sizes_, b, num);
+            return false;
+
+        }
+
+        std::vector<std::vector<V>> parts;
+        for (size_type y = 0; y < blocks_[b].size(); y += blockSize) {
+            parts.push_back(std::vector<V>(blocks_[b].begin() + y, blocks_[b].begin() + std::min(y + blockSize, (size_type) blocks_[b].size())));
+        }
+
+        blocks_.erase(blocks_.begin() + b);
+        blocks_.insert(blocks_.begin() + b, parts.begin(), parts.end());
+        rebuild();
+
+        return true;
+
+    }
+
+    // writes all entries (in order) to out and returns the iterator behind the last one
+    template<typename I>
+    I copyTo(I out) const {
+
+        for (auto& block : blocks_) {
+            out = std::copy(block.begin(), block.end(), out);
+        }
+
+        return out;
+
+    }
+
+    // returns the block containing entry x (< size()) and replaces x by its offset in the block
+    size_type locate(size_type& x) const {
+        return fenwickSearch(sizes_, x);
+    }
+
+    size_type numBlocks() const {
+        return blocks_.size();
+    }
+
+    const std::vector<V>& block(size_type b) const {
+        return blocks_[b];
+    }
+
+private:
+    std::vector<std::vector<V>> blocks_; // entries (by block)
+    std::vector<size_type> sizes_; // Fenwick tree over the sizes of the blocks
+    size_type size_; // number of entries
+
+    void rebuild() {
+
+        std::vector<size_type> sizes(blocks_.size());
+        for (size_type b = 0; b < blocks_.size(); b++) {
+            sizes[b] = blocks_[b].size();
+        }
+
+        sizes_ = fenwickBuild(sizes);
+
+    }
+
+};
+
+// Dynamic rank data structure with logarithmic updates: rank(pos) is the number of ones among the first pos bits of a dynamic
+// bit sequence, increaseFrom(pos, inc) adds inc to bit pos - 1 (i.e. to all ranks from pos on) and insert(pos, num) inserts num zeros
+// behind the first pos - 1 bits (so that the ranks up to pos remain unchanged). In addition to the DynamicVector of the bits,
+// a Fenwick tree over the sums of its blocks counts the ones in front of a block, only the block of pos itself is scanned.
+class DynamicRank {
 
 public:
-    NaiveDynamicRank();
+    DynamicRank();
 
-    NaiveDynamicRank(const std::vector<bool>& arr);
+    DynamicRank(const std::vector<bool>& arr);
 
     size_type rank(size_type pos);
 
@@ -702,7 +2204,11 @@ public:
 
 
 private:
-    std::vector<size_type> ranks_;
+    DynamicVector<size_type> entries_; // the bit sequence (entries greater than one after increaseFrom() with inc > 1)
+    std::vector<size_type> sums_; // Fenwick tree over the sums of the blocks of entries_
+    size_type base_; // rank(0)
+
+    void rebuild();
 
 };
 
@@ -0,0 +1,935 @@
+/*
+ * Copyright (C) 2017 Robert Mueller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Contact: Robert Mueller <romueller@techfak.uni-bielefeld.de>
+ * Faculty of Technology, Bielefeld University,
+ * PO box 100131, DE-33501 Bielefeld, Germany
+ */
+
+/**
+ * Benchmark harness for the K2Tree and RowTree implementations (built by "make bench").
+ *
+ * Generates a synthetic relation (or reads an edge list), builds every selected data structure
+ * with each of its construction methods and times all queries of K2Tree<bool> / RowTree<bool>,
+ * the memory footprint (see sizeInBytes()) and the query throughput of several concurrent readers.
+ *
+ * The results are written as CSV (one line per measurement), see usage() for the options.
+ * All random choices depend on the seed only, so runs with the same options are reproducible.
+ */
+
+#include <array>
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <random>
+#include <set>
+#include <sstream>
+#include <thread>
+
+#include "StaticBasicRectangularTree.hpp"
+#include "StaticBasicTree.hpp"
+#include "StaticHybridRowTree.hpp"
+#include "StaticHybridTree.hpp"
+#include "StaticMiniRowTree.hpp"
+#include "StaticRowTree.hpp"
+#include "StaticUnevenRectangularOrMiniTree.hpp"
+#include "StaticUnevenRectangularTree.hpp"
+
+
+/* Options */
+
+struct Options {
+
+    std::string relation = "uniform"; // uniform, powerlaw, clustered, rectangular or file
+    std::string file; // edge list (one pair "i j" per line, lines starting with '#' or '%' are ignored)
+    size_type rows = 1 << 16;
+    size_type cols = 1 << 16;
+    size_type pairs = 1 << 20;
+    size_type seed = 42;
+
+    std::set<std::string> structures = {"basic", "krkc", "hybrid", "uneven", "unevenmini", "basicrow", "hybridrow", "minirow"};
+    size_type k = 2;
+    size_type kr = 2;
+    size_type kc = 4;
+    size_type upperK = 4;
+    size_type upperH = 2;
+    size_type lowerK = 2;
+    size_type mb = 1000;
+
+    size_type queries = 10000; // number of random queries per query type
+    size_type threads = std::max(1u, std::thread::hardware_concurrency()); // maximum number of threads for the throughput measurements
+    size_type maxMatrixCells = 1 << 26; // the matrix-based constructors are only used for smaller relations
+
+    std::string output; // CSV file (standard output if empty)
+
+};
+
+void usage() {
+
+    std::cerr << "Usage: k2trees_bench [options]" << std::endl
+              << "  --relation <uniform|powerlaw|clustered|rectangular|file>  kind of relation (default: uniform)" << std::endl
+              << "  --file <path>          edge list used by --relation file" << std::endl
+              << "  --rows <n>             number of rows of the synthetic relation (default: 65536)" << std::endl
+              << "  --cols <n>             number of columns of the synthetic relation (default: 65536)" << std::endl
+              << "  --pairs <n>            number of generated pairs, before removing duplicates (default: 1048576)" << std::endl
+              << "  --seed <n>             seed of the random number generator (default: 42)" << std::endl
+              << "  --structures <a,b,..>  subset of basic,krkc,hybrid,uneven,unevenmini,basicrow,hybridrow,minirow (default: all)" << std::endl
+              << "  --k, --kr, --kc, --upper-k, --upper-h, --lower-k, --mb <n>  parameters of the data structures" << std::endl
+              << "  --queries <n>          number of random queries per query type (default: 10000)" << std::endl
+              << "  --threads <n>          maximum number of threads for the throughput measurements (default: all cores)" << std::endl
+              << "  --max-matrix-cells <n> largest relation built via the matrix-based constructors (default: 67108864)" << std::endl
+              << "  --output <path>        CSV file for the results (default: standard output)" << std::endl;
+
+}
+
+Options parseOptions(int argc, const char* argv[]) {
+
+    Options opts;
+
+    for (int i = 1; i < argc; i++) {
+
+        std::string arg = argv[i];
+
+        if (arg == "--help" || arg == "-h") {
+
+            usage();
+            exit(0);
+
+        }
+
+        if (i + 1 >= argc) {
+            throw std::runtime_error("Missing value of option " + arg + ".");
+        }
+
+        std::string val = argv[++i];
+
+        if (arg == "--relation") {
+            opts.relation = val;
+        } else if (arg == "--file") {
+            opts.file = val;
+        } else if (arg == "--output") {
+            opts.output = val;
+        } else if (arg == "--structures") {
+
+            opts.structures.clear();
+            std::stringstream ss(val);
+            for (std::string s; std::getline(ss, s, ',');) {
+                opts.structures.insert(s);
+            }
+
+        } else {
+
+            std::map<std::string, size_type*> numeric = {
+                    {"--rows", &opts.rows}, {"--cols", &opts.cols}, {"--pairs", &opts.pairs}, {"--seed", &opts.seed},
+                    {"--k", &opts.k}, {"--kr", &opts.kr}, {"--kc", &opts.kc},
+                    {"--upper-k", &opts.upperK}, {"--upper-h", &opts.upperH}, {"--lower-k", &opts.lowerK}, {"--mb", &opts.mb},
+                    {"--queries", &opts.queries}, {"--threads", &opts.threads}, {"--max-matrix-cells", &opts.maxMatrixCells}
+            };
+
+            auto iter = numeric.find(arg);
+            if (iter == numeric.end()) {
+                throw std::runtime_error("Unknown option " + arg + ".");
+            }
+
+            *(iter->second) = std::stoul(val);
+
+        }
+
+    }
+
+    return opts;
+
+}
+
+
+/* Relations */
+
+struct Relation {
+
+    std::string name;
+    size_type numRows = 0;
+    size_type numCols = 0;
+    RelationPairs pairs; // sorted, without duplicates
+
+};
+
+void normalise(Relation& rel) {
+
+    std::sort(rel.pairs.begin(), rel.pairs.end());
+    rel.pairs.erase(std::unique(rel.pairs.begin(), rel.pairs.end()), rel.pairs.end());
+
+    // the pair-based constructors derive the matrix size from the largest row and column,
+    // so the relation is cut down to them to keep all queries inside every data structure
+    rel.numRows = 0;
+    rel.numCols = 0;
+    for (auto& p : rel.pairs) {
+        rel.numRows = std::max(rel.numRows, p.first + 1);
+        rel.numCols = std::max(rel.numCols, p.second + 1);
+    }
+
+}
+
+Relation generateRelation(const Options& opts, std::mt19937_64& gen) {
+
+    Relation rel;
+    rel.name = opts.relation;
+    rel.numRows = std::max((size_type) 1, opts.rows);
+    rel.numCols = std::max((size_type) 1, opts.cols);
+
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    rel.pairs.reserve(opts.pairs);
+
+    if (opts.relation == "uniform") {
+
+        std::uniform_int_distribution<size_type> row(0, rel.numRows - 1);
+        std::uniform_int_distribution<size_type> col(0, rel.numCols - 1);
+
+        for (size_type x = 0; x < opts.pairs; x++) {
+            rel.pairs.push_back(std::make_pair(row(gen), col(gen)));
+        }
+
+    } else if (opts.relation == "powerlaw") {
+
+        // skewed degrees: small row and column numbers are much more likely (hubs)
+        for (size_type x = 0; x < opts.pairs; x++) {
+            rel.pairs.push_back(std::make_pair(
+                    std::min(rel.numRows - 1, size_type(rel.numRows * std::pow(unit(gen), 3.0))),
+                    std::min(rel.numCols - 1, size_type(rel.numCols * std::pow(unit(gen), 2.0)))
+            ));
+        }
+
+    } else if (opts.relation == "clustered") {
+
+        // dense square blocks (of up to 64 x 64 cells) at random positions
+        size_type numClusters = std::max((size_type) 1, opts.pairs / 512);
+        size_type side = std::min({(size_type) 64, rel.numRows, rel.numCols});
+        std::uniform_int_distribution<size_type> row(0, rel.numRows - side);
+        std::uniform_int_distribution<size_type> col(0, rel.numCols - side);
+        std::uniform_int_distribution<size_type> offset(0, side - 1);
+
+        std::vector<std::pair<size_type, size_type>> clusters(numClusters);
+        for (auto& c : clusters) {
+            c = std::make_pair(row(gen), col(gen));
+        }
+
+        std::uniform_int_distribution<size_type> cluster(0, numClusters - 1);
+        for (size_type x = 0; x < opts.pairs; x++) {
+
+            auto& c = clusters[cluster(gen)];
+            rel.pairs.push_back(std::make_pair(c.first + offset(gen), c.second + offset(gen)));
+
+        }
+
+    } else if (opts.relation == "rectangular") {
+
+        // uniformly distributed pairs in a very wide relation matrix
+        rel.numRows = std::max((size_type) 16, rel.numRows / 256);
+        rel.numCols *= 256;
+
+        std::uniform_int_distribution<size_type> row(0, rel.numRows - 1);
+        std::uniform_int_distribution<size_type> col(0, rel.numCols - 1);
+
+        for (size_type x = 0; x < opts.pairs; x++) {
+            rel.pairs.push_back(std::make_pair(row(gen), col(gen)));
+        }
+
+    } else {
+        throw std::runtime_error("Unknown kind of relation " + opts.relation + ".");
+    }
+
+    normalise(rel);
+
+    return rel;
+
+}
+
+Relation readRelation(const std::string& path) {
+
+    std::ifstream in(path);
+    if (!in) {
+        throw std::runtime_error("Cannot open edge list " + path + ".");
+    }
+
+    Relation rel;
+    rel.name = path;
+
+    for (std::string line; std::getline(in, line);) {
+
+        if (line.empty() || line[0] == '#' || line[0] == '%') {
+            continue;
+        }
+
+        std::stringstream ss(line);
+        size_type i, j;
+        if (ss >> i >> j) {
+
+            rel.pairs.push_back(std::make_pair(i, j));
+        }
+
+    }
+
+    if (rel.pairs.empty()) {
+        throw std::runtime_error("Edge list " + path + " does not contain any pairs.");
+    }
+
+    normalise(rel);
+
+    return rel;
+
+}
+
+
+/* Measurements */
+
+typedef std::chrono::steady_clock Clock;
+
+// prevents the compiler from discarding the results of the timed operations
+size_type checksum = 0;
+
+// counts the bytes written to it (for determining the size of the serialised representation)
+class CountingBuffer : public std::streambuf {
+
+public:
+    size_type count = 0;
+
+protected:
+    int_type overflow(int_type c) override {
+
+        count++;
+        return c;
+
+    }
+
+    std::streamsize xsputn(const char*, std::streamsize n) override {
+
+        count += n;
+        return n;
+
+    }
+
+};
+
+class Reporter {
+
+public:
+    Reporter(std::ostream& out, const std::string& relation) : out_(out), relation_(relation) {
+        // nothing to do
+    }
+
+    void header() {
+        out_ << "relation,structure,operation,threads,operations,seconds,ops_per_second,bytes" << std::endl;
+    }
+
+    void report(const std::string& structure, const std::string& operation, size_type threads, size_type ops, double seconds, size_type bytes = 0) {
+
+        out_ << relation_ << "," << structure << "," << operation << "," << threads << "," << ops << ","
+             << seconds << "," << ((seconds > 0) ? ops / seconds : 0) << "," << bytes << std::endl;
+
+    }
+
+    // runs f once and reports its running time as ops operations
+    template<typename F>
+    void time(const std::string& structure, const std::string& operation, size_type ops, F f) {
+
+        auto start = Clock::now();
+        f();
+        std::chrono::duration<double> elapsed = Clock::now() - start;
+
+        report(structure, operation, 1, ops, elapsed.count());
+
+    }
+
+private:
+    std::ostream& out_;
+    std::string relation_;
+
+};
+
+// random queries, shared by all data structures built for the same relation
+struct Queries {
+
+    RelationPairs positions; // half of them are pairs of the relation
+    std::vector<size_type> rows;
+    std::vector<size_type> cols;
+    std::vector<std::array<size_type, 4>> ranges; // i1, i2, j1, j2
+    std::vector<std::vector<size_type>> frontiers;
+
+};
+
+Queries generateQueries(const Relation& rel, const Options& opts, std::mt19937_64& gen) {
+
+    Queries qs;
+
+    std::uniform_int_distribution<size_type> row(0, rel.numRows - 1);
+    std::uniform_int_distribution<size_type> col(0, rel.numCols - 1);
+    std::uniform_int_distribution<size_type> pair(0, rel.pairs.size() - 1);
+
+    // ranges cover about 1% of the rows and columns
+    size_type rowExtent = std::max((size_type) 1, rel.numRows / 100);
+    size_type colExtent = std::max((size_type) 1, rel.numCols / 100);
+
+    for (size_type x = 0; x < opts.queries; x++) {
+
+        qs.positions.push_back((x % 2 == 0) ? rel.pairs[pair(gen)] : std::make_pair(row(gen), col(gen)));
+        qs.rows.push_back(row(gen));
+        qs.cols.push_back(col(gen));
+
+        size_type i1 = row(gen);
+        size_type j1 = col(gen);
+        qs.ranges.push_back({{i1, std::min(rel.numRows - 1, i1 + rowExtent - 1), j1, std::min(rel.numCols - 1, j1 + colExtent - 1)}});
+
+    }
+
+    // frontiers of 64 rows each
+    for (size_type x = 0; x < std::max((size_type) 1, opts.queries / 64); x++) {
+
+        std::vector<size_type> frontier;
+        for (size_type y = 0; y < 64; y++) {
+            frontier.push_back(row(gen));
+        }
+        qs.frontiers.push_back(frontier);
+
+    }
+
+    return qs;
+
+}
+
+// runs f(x) for x = 0, ..., n - 1 distributed over numThreads concurrent threads and returns the elapsed time in seconds
+template<typename F>
+double concurrently(size_type n, size_type numThreads, F f) {
+
+    std::vector<size_type> sums(numThreads, 0);
+    std::vector<std::thread> threads;
+
+    auto start = Clock::now();
+
+    for (size_type t = 0; t < numThreads; t++) {
+        threads.emplace_back([&, t]() {
+            for (size_type x = t; x < n; x += numThreads) {
+                sums[t] += f(x);
+            }
+        });
+    }
+
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    std::chrono::duration<double> elapsed = Clock::now() - start;
+
+    for (auto s : sums) {
+        checksum += s;
+    }
+
+    return elapsed.count();
+
+}
+
+std::vector<size_type> threadCounts(size_type maxThreads) {
+
+    std::vector<size_type> counts;
+    for (size_type t = 1; t < maxThreads; t *= 2) {
+        counts.push_back(t);
+    }
+    counts.push_back(std::max((size_type) 1, maxThreads));
+
+    return counts;
+
+}
+
+template<typename T>
+size_type serialisedSize(const T& tree) {
+
+    CountingBuffer buf;
+    std::ostream out(&buf);
+    tree.serialize(out);
+
+    return buf.count;
+
+}
+
+// reports the memory footprint of the data structure (in total, by component and when serialised)
+template<typename T>
+void reportMemory(Reporter& rep, const std::string& name, const T& tree) {
+
+    auto s = tree.sizeInBytes();
+
+    rep.report(name, "memory", 1, 1, 0, s.total());
+    rep.report(name, "memory(T)", 1, 1, 0, s.T);
+    rep.report(name, "memory(L)", 1, 1, 0, s.L);
+    rep.report(name, "memory(rank)", 1, 1, 0, s.rank);
+    rep.report(name, "memory(aux)", 1, 1, 0, s.aux);
+    rep.report(name, "memory(partitions)", 1, 1, 0, s.partitions);
+    rep.report(name, "memory(miniTrees)", 1, 1, 0, s.miniTrees);
+    rep.report(name, "memory(other)", 1, 1, 0, s.other);
+    rep.report(name, "memory(serialised)", 1, 1, 0, serialisedSize(tree));
+
+}
+
+template<typename T>
+void benchmarkK2Tree(Reporter& rep, const std::string& name, const T& tree, const Queries& qs, const Options& opts) {
+
+    size_type n = qs.positions.size();
+
+    reportMemory(rep, name, tree);
+
+    /* single queries */
+
+    rep.time(name, "isNotNull", n, [&]() {
+        for (auto& p : qs.positions) checksum += tree.isNotNull(p.first, p.second);
+    });
+    rep.time(name, "getElement", n, [&]() {
+        for (auto& p : qs.positions) checksum += tree.getElement(p.first, p.second);
+    });
+    rep.time(name, "isNotNull(batch)", n, [&]() {
+        std::vector<bool> out;
+        tree.isNotNull(qs.positions, out);
+        checksum += std::count(out.begin(), out.end(), true);
+    });
+    rep.time(name, "getElement(batch)", n, [&]() {
+        std::vector<bool> out;
+        tree.getElement(qs.positions, out);
+        checksum += std::count(out.begin(), out.end(), true);
+    });
+
+    /* rows and columns */
+
+    rep.time(name, "getSuccessorElements", n, [&]() {
+        for (auto i : qs.rows) checksum += tree.getSuccessorElements(i).size();
+    });
+    rep.time(name, "getSuccessorPositions", n, [&]() {
+        for (auto i : qs.rows) checksum += tree.getSuccessorPositions(i).size();
+    });
+    rep.time(name, "getSuccessorValuedPositions", n, [&]() {
+        for (auto i : qs.rows) checksum += tree.getSuccessorValuedPositions(i).size();
+    });
+    rep.time(name, "forEachSuccessorPosition", n, [&]() {
+        for (auto i : qs.rows) tree.forEachSuccessorPosition(i, [](size_type j) { checksum += j; return true; });
+    });
+    rep.time(name, "getFirstSuccessor", n, [&]() {
+        for (auto i : qs.rows) checksum += tree.getFirstSuccessor(i);
+    });
+    rep.time(name, "getPredecessorElements", n, [&]() {
+        for (auto j : qs.cols) checksum += tree.getPredecessorElements(j).size();
+    });
+    rep.time(name, "getPredecessorPositions", n, [&]() {
+        for (auto j : qs.cols) checksum += tree.getPredecessorPositions(j).size();
+    });
+    rep.time(name, "getPredecessorValuedPositions", n, [&]() {
+        for (auto j : qs.cols) checksum += tree.getPredecessorValuedPositions(j).size();
+    });
+    rep.time(name, "forEachPredecessorPosition", n, [&]() {
+        for (auto j : qs.cols) tree.forEachPredecessorPosition(j, [](size_type i) { checksum += i; return true; });
+    });
+    rep.time(name, "expandFrontier", qs.frontiers.size(), [&]() {
+        for (auto& f : qs.frontiers) checksum += tree.expandFrontier(f).size();
+    });
+
+    /* ranges */
+
+    rep.time(name, "getElementsInRange", n, [&]() {
+        for (auto& r : qs.ranges) checksum += tree.getElementsInRange(r[0], r[1], r[2], r[3]).size();
+    });
+    rep.time(name, "getPositionsInRange", n, [&]() {
+        for (auto& r : qs.ranges) checksum += tree.getPositionsInRange(r[0], r[1], r[2], r[3]).size();
+    });
+    rep.time(name, "getValuedPositionsInRange", n, [&]() {
+        for (auto& r : qs.ranges) checksum += tree.getValuedPositionsInRange(r[0], r[1], r[2], r[3]).size();
+    });
+    rep.time(name, "forEachValuedPositionInRange", n, [&]() {
+        for (auto& r : qs.ranges) tree.forEachValuedPositionInRange(r[0], r[1], r[2], r[3], [](size_type i, size_type j, bool) { checksum += i + j; return true; });
+    });
+    rep.time(name, "containsElement", n, [&]() {
+        for (auto& r : qs.ranges) checksum += tree.containsElement(r[0], r[1], r[2], r[3]);
+    });
+    rep.time(name, "countElementsInRange", n, [&]() {
+        for (auto& r : qs.ranges) checksum += tree.countElementsInRange(r[0], r[1], r[2], r[3]);
+    });
+
+    /* whole relation */
+
+    rep.time(name, "getAllElements", 1, [&]() {
+        checksum += tree.getAllElements().size();
+    });
+    rep.time(name, "getAllPositions", 1, [&]() {
+        checksum += tree.getAllPositions().size();
+    });
+    rep.time(name, "getAllValuedPositions", 1, [&]() {
+        checksum += tree.getAllValuedPositions().size();
+    });
+    rep.time(name, "countElements", 1, [&]() {
+        checksum += tree.countElements();
+    });
+
+    /* serialisation */
+
+    std::stringstream ss;
+    rep.time(name, "serialize", 1, [&]() {
+        tree.serialize(ss);
+    });
+    rep.time(name, "load", 1, [&]() {
+        T copy;
+        copy.load(ss);
+        checksum += copy.getNumRows();
+    });
+
+    /* throughput of concurrent readers (the query methods are const and may be called concurrently) */
+
+    for (auto t : threadCounts(opts.threads)) {
+
+        rep.report(name, "isNotNull(concurrent)", t, n, concurrently(n, t, [&](size_type x) {
+            return (size_type) tree.isNotNull(qs.positions[x].first, qs.positions[x].second);
+        }));
+
+        rep.report(name, "getSuccessorPositions(concurrent)", t, n, concurrently(n, t, [&](size_type x) {
+            return tree.getSuccessorPositions(qs.rows[x]).size();
+        }));
+
+        rep.report(name, "getPositionsInRange(concurrent)", t, n, concurrently(n, t, [&](size_type x) {
+            auto& r = qs.ranges[x];
+            return tree.getPositionsInRange(r[0], r[1], r[2], r[3]).size();
+        }));
+
+    }
+
+}
+
+template<typename T>
+void benchmarkRowTree(Reporter& rep, const std::string& name, const T& tree, const RelationList& elems, const Options& opts, std::mt19937_64& gen) {
+
+    size_type length = tree.getLength();
+    std::uniform_int_distribution<size_type> pos(0, length - 1);
+    std::uniform_int_distribution<size_type> elem(0, elems.size() - 1);
+
+    std::vector<size_type> positions;
+    std::vector<std::pair<size_type, size_type>> ranges;
+    size_type extent = std::max((size_type) 1, length / 100);
+
+    for (size_type x = 0; x < opts.queries; x++) {
+
+        positions.push_back((x % 2 == 0) ? elems[elem(gen)] : pos(gen));
+
+        size_type l = pos(gen);
+        ranges.push_back(std::make_pair(l, std::min(length - 1, l + extent - 1)));
+
+    }
+
+    size_type n = positions.size();
+
+    reportMemory(rep, name, tree);
+
+    rep.time(name, "isNotNull", n, [&]() {
+        for (auto i : positions) checksum += tree.isNotNull(i);
+    });
+    rep.time(name, "getElement", n, [&]() {
+        for (auto i : positions) checksum += tree.getElement(i);
+    });
+    rep.time(name, "getFirst", 1, [&]() {
+        checksum += tree.getFirst();
+    });
+    rep.time(name, "getElementsInRange", n, [&]() {
+        for (auto& r : ranges) checksum += tree.getElementsInRange(r.first, r.second).size();
+    });
+    rep.time(name, "getPositionsInRange", n, [&]() {
+        for (auto& r : ranges) checksum += tree.getPositionsInRange(r.first, r.second).size();
+    });
+    rep.time(name, "getValuedPositionsInRange", n, [&]() {
+        for (auto& r : ranges) checksum += tree.getValuedPositionsInRange(r.first, r.second).size();
+    });
+    rep.time(name, "containsElement", n, [&]() {
+        for (auto& r : ranges) checksum += tree.containsElement(r.first, r.second);
+    });
+    rep.time(name, "getAllElements", 1, [&]() {
+        checksum += tree.getAllElements().size();
+    });
+    rep.time(name, "getAllPositions", 1, [&]() {
+        checksum += tree.getAllPositions().size();
+    });
+    rep.time(name, "getAllValuedPositions", 1, [&]() {
+        checksum += tree.getAllValuedPositions().size();
+    });
+    rep.time(name, "countElements", 1, [&]() {
+        checksum += tree.countElements();
+    });
+
+    for (auto t : threadCounts(opts.threads)) {
+        rep.report(name, "isNotNull(concurrent)", t, n, concurrently(n, t, [&](size_type x) {
+            return (size_type) tree.isNotNull(positions[x]);
+        }));
+    }
+
+}
+
+
+/* Construction */
+
+// number of cells of the relation matrix after padding it to kr^h x kc^h
+double paddedCells(size_type numRows, size_type numCols, size_type kr, size_type kc) {
+
+    size_type h = std::max({(size_type) 1, logK(numRows, kr), logK(numCols, kc)});
+    return std::pow(kr, h) * std::pow(kc, h);
+
+}
+
+// builds the data structure via build() and reports the construction time
+// (the relation is passed as a copy, since some constructors reorder their input)
+template<typename T, typename B>
+T construct(Reporter& rep, const std::string& name, const std::string& method, size_type numPairs, B build) {
+
+    auto start = Clock::now();
+    T tree = build();
+    std::chrono::duration<double> elapsed = Clock::now() - start;
+
+    rep.report(name, "construct(" + method + ")", 1, numPairs, elapsed.count());
+
+    return tree;
+
+}
+
+void benchmarkK2Trees(Reporter& rep, const Relation& rel, const Queries& qs, const Options& opts) {
+
+    size_type m = rel.pairs.size();
+
+    // the matrix-based constructors (and the list-based ones in mode 0) visit every cell of the padded relation matrix
+    auto useMatrix = [&](size_type kr, size_type kc) {
+        return paddedCells(rel.numRows, rel.numCols, kr, kc) <= opts.maxMatrixCells;
+    };
+
+    RelationPairs tmp(rel.pairs);
+    RelationLists lists = boolPairsToList(tmp, rel.numRows);
+
+    RelationMatrix mat;
+    if (rel.numRows * rel.numCols <= opts.maxMatrixCells) {
+        mat = boolPairsToMatrix(tmp, rel.numRows, rel.numCols);
+    }
+
+    if (opts.structures.count("basic")) {
+
+        std::string name = "BasicK2Tree(k=" + std::to_string(opts.k) + ")";
+
+        if (useMatrix(opts.k, opts.k)) {
+            construct<BasicK2Tree<bool>>(rep, name, "matrix", m, [&]() { return BasicK2Tree<bool>(mat, opts.k); });
+        }
+        for (int mode = useMatrix(opts.k, opts.k) ? 0 : 1; mode <= 2; mode++) {
+            construct<BasicK2Tree<bool>>(rep, name, "lists,mode=" + std::to_string(mode), m, [&]() { return BasicK2Tree<bool>(lists, opts.k, mode); });
+        }
+        for (auto t : threadCounts(opts.threads)) {
+            construct<BasicK2Tree<bool>>(rep, name, "pairs,threads=" + std::to_string(t), m, [&]() { RelationPairs p(rel.pairs); return BasicK2Tree<bool>(p, opts.k, t); });
+        }
+
+        RelationPairs p(rel.pairs);
+        BasicK2Tree<bool> tree(p, opts.k);
+        benchmarkK2Tree(rep, name, tree, qs, opts);
+
+    }
+
+    if (opts.structures.count("krkc")) {
+
+        std::string name = "KrKcTree(kr=" + std::to_string(opts.kr) + ",kc=" + std::to_string(opts.kc) + ")";
+
+        if (useMatrix(opts.kr, opts.kc)) {
+            construct<KrKcTree<bool>>(rep, name, "matrix", m, [&]() { return KrKcTree<bool>(mat, opts.kr, opts.kc); });
+        }
+        for (int mode = useMatrix(opts.kr, opts.kc) ? 0 : 1; mode <= 2; mode++) {
+            construct<KrKcTree<bool>>(rep, name, "lists,mode=" + std::to_string(mode), m, [&]() { return KrKcTree<bool>(lists, opts.kr, opts.kc, mode); });
+        }
+        for (auto t : threadCounts(opts.threads)) {
+            construct<KrKcTree<bool>>(rep, name, "pairs,threads=" + std::to_string(t), m, [&]() { RelationPairs p(rel.pairs); return KrKcTree<bool>(p, opts.kr, opts.kc, t); });
+        }
+
+        RelationPairs p(rel.pairs);
+        KrKcTree<bool> tree(p, opts.kr, opts.kc);
+        benchmarkK2Tree(rep, name, tree, qs, opts);
+
+    }
+
+    if (opts.structures.count("hybrid")) {
+
+        std::string name = "HybridK2Tree(upperK=" + std::to_string(opts.upperK) + ",upperH=" + std::to_string(opts.upperH) + ",lowerK=" + std::to_string(opts.lowerK) + ")";
+
+        if (useMatrix(opts.lowerK, opts.lowerK)) {
+            construct<HybridK2Tree<bool>>(rep, name, "matrix", m, [&]() { return HybridK2Tree<bool>(mat, opts.upperK, opts.upperH, opts.lowerK); });
+        }
+        for (int mode = useMatrix(opts.lowerK, opts.lowerK) ? 0 : 1; mode <= 2; mode++) {
+            construct<HybridK2Tree<bool>>(rep, name, "lists,mode=" + std::to_string(mode), m, [&]() { return HybridK2Tree<bool>(lists, opts.upperK, opts.upperH, opts.lowerK, mode); });
+        }
+        for (auto t : threadCounts(opts.threads)) {
+            construct<HybridK2Tree<bool>>(rep, name, "pairs,threads=" + std::to_string(t), m, [&]() { RelationPairs p(rel.pairs); return HybridK2Tree<bool>(p, opts.upperK, opts.upperH, opts.lowerK, t); });
+        }
+
+        RelationPairs p(rel.pairs);
+        HybridK2Tree<bool> tree(p, opts.upperK, opts.upperH, opts.lowerK);
+        benchmarkK2Tree(rep, name, tree, qs, opts);
+
+    }
+
+    if (opts.structures.count("uneven")) {
+
+        std::string name = "UnevenKrKcTree(kr=" + std::to_string(opts.kr) + ",kc=" + std::to_string(opts.kc) + ")";
+
+        if (rel.numRows * rel.numCols <= opts.maxMatrixCells) {
+            construct<UnevenKrKcTree<bool>>(rep, name, "matrix", m, [&]() { return UnevenKrKcTree<bool>(mat, opts.kr, opts.kc); });
+        }
+        for (int mode = 0; mode <= 2; mode++) {
+            construct<UnevenKrKcTree<bool>>(rep, name, "lists,mode=" + std::to_string(mode), m, [&]() { return UnevenKrKcTree<bool>(lists, opts.kr, opts.kc, mode); });
+        }
+        for (auto t : threadCounts(opts.threads)) {
+            construct<UnevenKrKcTree<bool>>(rep, name, "pairs,threads=" + std::to_string(t), m, [&]() { RelationPairs p(rel.pairs); return UnevenKrKcTree<bool>(p, opts.kr, opts.kc, t); });
+        }
+
+        RelationPairs p(rel.pairs);
+        UnevenKrKcTree<bool> tree(p, opts.kr, opts.kc);
+        benchmarkK2Tree(rep, name, tree, qs, opts);
+
+    }
+
+    if (opts.structures.count("unevenmini")) {
+
+        std::string name = "UnevenKrKcOrMiniTree(kr=" + std::to_string(opts.kr) + ",kc=" + std::to_string(opts.kc) + ",mb=" + std::to_string(opts.mb) + ")";
+
+        for (auto t : threadCounts(opts.threads)) {
+            construct<UnevenKrKcOrMiniTree<bool>>(rep, name, "pairs,threads=" + std::to_string(t), m, [&]() { RelationPairs p(rel.pairs); return UnevenKrKcOrMiniTree<bool>(p, opts.kr, opts.kc, opts.mb, t); });
+        }
+
+        RelationPairs p(rel.pairs);
+        UnevenKrKcOrMiniTree<bool> tree(p, opts.kr, opts.kc, opts.mb);
+        benchmarkK2Tree(rep, name, tree, qs, opts);
+
+    }
+
+}
+
+void benchmarkRowTrees(Reporter& rep, const Relation& rel, const Options& opts, std::mt19937_64& gen) {
+
+    // the RowTrees represent the set of all column numbers occurring in the relation
+    RelationList elems;
+    for (auto& p : rel.pairs) {
+        elems.push_back(p.second);
+    }
+    std::sort(elems.begin(), elems.end());
+    elems.erase(std::unique(elems.begin(), elems.end()), elems.end());
+
+    size_type m = elems.size();
+    bool useVector = (rel.numCols <= opts.maxMatrixCells);
+
+    bit_vector_type vec;
+    if (useVector) {
+
+        vec = bit_vector_type(elems.back() + 1, 0);
+        for (auto e : elems) {
+            vec[e] = 1;
+        }
+
+    }
+
+    if (opts.structures.count("basicrow")) {
+
+        std::string name = "BasicRowTree(k=" + std::to_string(opts.k) + ")";
+
+        if (useVector) {
+            construct<BasicRowTree<bool>>(rep, name, "vector", m, [&]() { return BasicRowTree<bool>(vec, opts.k); });
+        }
+        for (int mode = 0; mode <= 2; mode++) {
+            construct<BasicRowTree<bool>>(rep, name, "list,mode=" + std::to_string(mode), m, [&]() { return BasicRowTree<bool>(elems, opts.k, mode); });
+        }
+        construct<BasicRowTree<bool>>(rep, name, "pairs", m, [&]() { RelationList l(elems); return BasicRowTree<bool>(l, opts.k); });
+
+        RelationList l(elems);
+        BasicRowTree<bool> tree(l, opts.k);
+        benchmarkRowTree(rep, name, tree, elems, opts, gen);
+
+    }
+
+    if (opts.structures.count("hybridrow")) {
+
+        std::string name = "HybridRowTree(upperK=" + std::to_string(opts.upperK) + ",upperH=" + std::to_string(opts.upperH) + ",lowerK=" + std::to_string(opts.lowerK) + ")";
+
+        if (useVector) {
+            construct<HybridRowTree<bool>>(rep, name, "vector", m, [&]() { return HybridRowTree<bool>(vec, opts.upperK, opts.upperH, opts.lowerK); });
+        }
+        for (int mode = 0; mode <= 2; mode++) {
+            construct<HybridRowTree<bool>>(rep, name, "list,mode=" + std::to_string(mode), m, [&]() { return HybridRowTree<bool>(elems, opts.upperK, opts.upperH, opts.lowerK, mode); });
+        }
+        construct<HybridRowTree<bool>>(rep, name, "pairs", m, [&]() { RelationList l(elems); return HybridRowTree<bool>(l, opts.upperK, opts.upperH, opts.lowerK); });
+
+        RelationList l(elems);
+        HybridRowTree<bool> tree(l, opts.upperK, opts.upperH, opts.lowerK);
+        benchmarkRowTree(rep, name, tree, elems, opts, gen);
+
+    }
+
+    if (opts.structures.count("minirow")) {
+
+        std::string name = "MiniRowTree";
+
+        if (useVector) {
+            construct<MiniRowTree<bool>>(rep, name, "vector", m, [&]() { return MiniRowTree<bool>(vec); });
+        }
+        construct<MiniRowTree<bool>>(rep, name, "list", m, [&]() { return MiniRowTree<bool>(elems); });
+
+        MiniRowTree<bool> tree(elems);
+        benchmarkRowTree(rep, name, tree, elems, opts, gen);
+
+    }
+
+}
+
+
+int main(int argc, const char* argv[]) {
+
+    try {
+
+        Options opts = parseOptions(argc, argv);
+        std::mt19937_64 gen(opts.seed);
+
+        Relation rel = (opts.relation == "file") ? readRelation(opts.file) : generateRelation(opts, gen);
+        if (rel.pairs.empty()) {
+            throw std::runtime_error("The relation does not contain any pairs.");
+        }
+
+        Queries qs = generateQueries(rel, opts, gen);
+
+        std::ofstream file;
+        if (!opts.output.empty()) {
+
+            file.open(opts.output);
+            if (!file) {
+                throw std::runtime_error("Cannot open output file " + opts.output + ".");
+            }
+
+        }
+
+        Reporter rep(opts.output.empty() ? std::cout : file, rel.name);
+        rep.header();
+        rep.report("relation", "pairs", 1, rel.pairs.size(), 0);
+
+        benchmarkK2Trees(rep, rel, qs, opts);
+        benchmarkRowTrees(rep, rel, opts, gen);
+
+        std::cerr << "checksum: " << checksum << std::endl;
+
+    } catch (const std::exception& e) {
+
+        std::cerr << "Error: " << e.what() << std::endl;
+        usage();
+        return 1;
+
+    }
+
+    return 0;
+
+}
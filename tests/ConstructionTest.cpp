@@ -0,0 +1,196 @@
+/*
+ * Copyright (C) 2017 Robert Mueller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Contact: Robert Mueller <romueller@techfak.uni-bielefeld.de>
+ * Faculty of Technology, Bielefeld University,
+ * PO box 100131, DE-33501 Bielefeld, Germany
+ */
+
+/**
+ * Test of the construction from radix-sorted keys (built and run by "make test").
+ *
+ * Compares the serialisation of the Basic, KrKc and Hybrid trees (bool and valued with a non-default null) built by
+ * the list-of-pairs-based constructors (one and several threads) with the serialisation of the same relation
+ * built level by level by buildFromListsInplace(), which compact() uses for rebuilding a tree:
+ * the latter trees are built with an additional pair, which is removed by setNull() and compact() afterwards.
+ * The relations contain duplicates and include trees of height 1.
+ */
+
+#include <functional>
+#include <iostream>
+#include <random>
+#include <sstream>
+
+#include "StaticBasicRectangularTree.hpp"
+#include "StaticBasicTree.hpp"
+#include "StaticHybridTree.hpp"
+
+typedef std::vector<ValuedPosition<int>> ValuedPairs;
+
+size_type failures = 0;
+
+#define CHECK(cond, msg) \
+    if (!(cond)) { \
+        failures++; \
+        std::cerr << "FAILED: " << msg << std::endl; \
+    }
+
+const int NULL_VALUE = -1;
+
+// value of the pair (i, j) in the valued relations (0 is a proper value, the null element is -1)
+int valueOf(size_type i, size_type j) {
+    return (i * 7 + j) % 5;
+}
+
+template<typename T>
+std::string serialise(const T& tree) {
+
+    std::stringstream out;
+    tree.serialize(out);
+
+    return out.str();
+
+}
+
+// compares the trees built by build() from pairs (with one and three threads) with the one built by buildFromListsInplace()
+// (via compact()) from withExtra, i.e. pairs plus (extraRow, extraCol), after removing the additional pair
+template<typename T, typename P>
+void checkConstruction(const std::function<T*(P&, size_type)>& build, const P& pairs, const P& withExtra,
+                       size_type extraRow, size_type extraCol, const std::string& name) {
+
+    P tmp(withExtra);
+    T* reference = build(tmp, 1);
+    reference->setNull(extraRow, extraCol);
+    reference->compact();
+    std::string expected = serialise(*reference);
+    delete reference;
+
+    for (size_type numThreads : {1, 3}) {
+
+        tmp = pairs;
+        T* tree = build(tmp, numThreads);
+        CHECK(serialise(*tree) == expected, name << ", " << numThreads << " thread(s): serialize() differs from buildFromListsInplace()");
+        delete tree;
+
+    }
+
+}
+
+int main() {
+
+    std::mt19937 gen(25);
+
+    for (auto dims : std::vector<std::pair<size_type, size_type>>{{2, 2}, {4, 4}, {3, 5}, {37, 37}, {64, 64}, {20, 90}, {90, 20}}) {
+
+        for (size_type density : {2, 10}) {
+
+            // an additional pair, which is not part of the relation
+            std::pair<size_type, size_type> extra(gen() % dims.first, gen() % dims.second);
+
+            // random relation (with duplicates) within dims, whose last row and column are both used,
+            // so that the additional pair does not change the size of the matrix
+            RelationPairs positions;
+            for (size_type i = 0; i < dims.first; i++) {
+                for (size_type j = 0; j < dims.second; j++) {
+
+                    if ((gen() % density == 0) && (std::make_pair(i, j) != extra)) {
+
+                        positions.push_back(std::make_pair(i, j));
+
+                        if (gen() % 4 == 0) {
+                            positions.push_back(std::make_pair(i, j));
+                        }
+
+                    }
+
+                }
+            }
+            positions.push_back(std::make_pair(dims.first - 1, (extra.second + 1) % dims.second));
+            positions.push_back(std::make_pair((extra.first + 1) % dims.first, dims.second - 1));
+
+            RelationPairs positionsWithExtra(positions);
+            positionsWithExtra.push_back(extra);
+
+            ValuedPairs values, valuesWithExtra;
+            for (auto& p : positions) {
+                values.push_back(ValuedPosition<int>(p.first, p.second, valueOf(p.first, p.second)));
+            }
+            valuesWithExtra = values;
+            valuesWithExtra.push_back(ValuedPosition<int>(extra.first, extra.second, valueOf(extra.first, extra.second)));
+
+            std::stringstream name;
+            name << dims.first << "x" << dims.second << ", density 1/" << density;
+
+            if (dims.first == dims.second) {
+
+                for (size_type k : {2, 3, 4, 5}) {
+
+                    std::string suffix = " k=" + std::to_string(k) + " " + name.str();
+
+                    checkConstruction<BasicK2Tree<bool>, RelationPairs>(
+                        [k](RelationPairs& p, size_type t) { return new BasicK2Tree<bool>(p, k, t); },
+                        positions, positionsWithExtra, extra.first, extra.second, "BasicK2Tree<bool>" + suffix
+                    );
+                    checkConstruction<BasicK2Tree<int>, ValuedPairs>(
+                        [k](ValuedPairs& p, size_type t) { return new BasicK2Tree<int>(p, k, NULL_VALUE, t); },
+                        values, valuesWithExtra, extra.first, extra.second, "BasicK2Tree<int>" + suffix
+                    );
+
+                }
+
+                for (auto config : std::vector<std::vector<size_type>>{{2, 1, 2}, {3, 2, 2}, {4, 1, 3}, {2, 2, 4}, {2, 3, 2}}) {
+
+                    size_type upperK = config[0], upperH = config[1], lowerK = config[2];
+                    std::string suffix = " " + std::to_string(upperK) + "/" + std::to_string(upperH) + "/" + std::to_string(lowerK) + " " + name.str();
+
+                    checkConstruction<HybridK2Tree<bool>, RelationPairs>(
+                        [=](RelationPairs& p, size_type t) { return new HybridK2Tree<bool>(p, upperK, upperH, lowerK, t); },
+                        positions, positionsWithExtra, extra.first, extra.second, "HybridK2Tree<bool>" + suffix
+                    );
+                    checkConstruction<HybridK2Tree<int>, ValuedPairs>(
+                        [=](ValuedPairs& p, size_type t) { return new HybridK2Tree<int>(p, upperK, upperH, lowerK, NULL_VALUE, t); },
+                        values, valuesWithExtra, extra.first, extra.second, "HybridK2Tree<int>" + suffix
+                    );
+
+                }
+
+            }
+
+            for (auto arities : std::vector<std::pair<size_type, size_type>>{{2, 2}, {2, 3}, {3, 2}, {4, 2}, {2, 5}}) {
+
+                size_type kr = arities.first, kc = arities.second;
+                std::string suffix = " " + std::to_string(kr) + "x" + std::to_string(kc) + " " + name.str();
+
+                checkConstruction<KrKcTree<bool>, RelationPairs>(
+                    [=](RelationPairs& p, size_type t) { return new KrKcTree<bool>(p, kr, kc, t); },
+                    positions, positionsWithExtra, extra.first, extra.second, "KrKcTree<bool>" + suffix
+                );
+                checkConstruction<KrKcTree<int>, ValuedPairs>(
+                    [=](ValuedPairs& p, size_type t) { return new KrKcTree<int>(p, kr, kc, NULL_VALUE, t); },
+                    values, valuesWithExtra, extra.first, extra.second, "KrKcTree<int>" + suffix
+                );
+
+            }
+
+        }
+
+    }
+
+    std::cout << "ConstructionTest: " << failures << " failure(s)" << std::endl;
+
+    return (failures == 0) ? 0 : 1;
+
+}
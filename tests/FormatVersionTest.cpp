@@ -0,0 +1,242 @@
+/*
+ * Copyright (C) 2017 Robert Mueller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Contact: Robert Mueller <romueller@techfak.uni-bielefeld.de>
+ * Faculty of Technology, Bielefeld University,
+ * PO box 100131, DE-33501 Bielefeld, Germany
+ */
+
+/**
+ * Test of reading older format versions (built and run by "make test").
+ *
+ * Rewrites the serialisation of UnevenKrKcTrees and UnevenKrKcOrMiniTrees into format version 4
+ * (without the lengths of the partitions and the compressed leaves of bool partitions) and checks that load() and mapFile() (which then deserialises eagerly)
+ * reproduce the relation, and that the current format is still mapped lazily.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+
+#include "StaticUnevenRectangularOrMiniTree.hpp"
+#include "StaticUnevenRectangularTree.hpp"
+
+size_type failures = 0;
+
+#define CHECK(cond, msg) \
+    if (!(cond)) { \
+        failures++; \
+        std::cerr << "FAILED: " << msg << std::endl; \
+    }
+
+const std::string PATH = "FormatVersionTest.bin";
+
+// returns the length of the header written by writeHeader() at the beginning of bytes
+size_type headerLength(const std::string& bytes) {
+
+    size_type idLength;
+    std::memcpy(&idLength, bytes.data() + 4 + sizeof(unsigned int), sizeof(size_type));
+
+    return 4 + sizeof(unsigned int) + sizeof(size_type) + idLength + sizeof(size_type) + sizeof(unsigned int);
+
+}
+
+// sets the format version stored in the header at the beginning of bytes
+void setVersion(std::string& bytes, unsigned int version) {
+    std::memcpy(&bytes[4], &version, sizeof(unsigned int));
+}
+
+// removes the (empty) compressed leaves following T and L from the serialisation of a KrKcTree<bool>
+std::string stripLeafDictionary(const std::string& bytes) {
+
+    KrKcTree<bool> tree;
+    {
+        std::stringstream in(bytes);
+        tree.load(in);
+    }
+
+    LeafDictionary<bool> empty;
+    std::stringstream dict;
+    empty.serialize(dict);
+
+    SizeBreakdown s = tree.sizeInBytes();
+    size_type pos = headerLength(bytes) + 5 * sizeof(size_type) + sizeof(bool) + s.T + s.L - empty.sizeInBytes();
+    CHECK(bytes.compare(pos, dict.str().size(), dict.str()) == 0, "compressed leaves of a KrKcTree<bool> partition located");
+
+    return bytes.substr(0, pos) + bytes.substr(pos + dict.str().size());
+
+}
+
+// converts the serialisation of an uneven tree (with values of size elemSize) into format version 4,
+// i.e. removes the length preceding each partition (and the compressed leaves of KrKcTree<bool> partitions)
+// and marks the tree and its partitions as version 4
+std::string toVersion4(const std::string& bytes, size_type elemSize) {
+
+    size_type pos = headerLength(bytes) + 8 * sizeof(size_type) + elemSize;
+
+    size_type numPartitions;
+    std::memcpy(&numPartitions, bytes.data() + pos - elemSize - sizeof(size_type), sizeof(size_type));
+
+    std::string res = bytes.substr(0, pos);
+    setVersion(res, 4);
+
+    for (size_type k = 0; k < numPartitions; k++) {
+
+        char present = bytes[pos++];
+        res += present;
+
+        if (present != 0) {
+
+            size_type length;
+            std::memcpy(&length, bytes.data() + pos, sizeof(size_type));
+            pos += sizeof(size_type);
+
+            std::string partition = bytes.substr(pos, length);
+            if ((present == 1) && (elemSize == sizeof(bool))) {
+                partition = stripLeafDictionary(partition);
+            }
+            setVersion(partition, 4);
+            res += partition;
+            pos += length;
+
+        }
+
+    }
+
+    return res;
+
+}
+
+// checks that a version-4 file of tree is read correctly by load() and mapFile() and that the current format is still mapped lazily
+template<typename Tree, typename E>
+void checkVersions(const Tree& tree, std::vector<std::vector<E>> mat, E null, const std::string& name) {
+
+    std::stringstream current;
+    tree.serialize(current);
+    std::string old = toVersion4(current.str(), sizeof(E));
+
+    Tree loaded;
+    {
+        std::stringstream in(old);
+        loaded.load(in);
+
+        CHECK(loaded.compare(mat, null, true), name << ": load() of version 4");
+    }
+
+    {
+        std::ofstream out(PATH, std::ios::binary);
+        out.write(old.data(), old.size());
+    }
+
+    {
+        Tree mapped;
+        mapped.mapFile(PATH);
+
+        CHECK(mapped.sizeInBytes().total() == loaded.sizeInBytes().total(), name << ": mapFile() of version 4 deserialises eagerly");
+        CHECK(mapped.compare(mat, null, true), name << ": mapFile() of version 4");
+
+        std::stringstream reserialised;
+        mapped.serialize(reserialised);
+        CHECK(reserialised.str() == current.str(), name << ": serialize() after mapFile() of version 4");
+    }
+
+    {
+        std::ofstream out(PATH, std::ios::binary);
+        tree.serialize(out);
+    }
+
+    {
+        Tree mapped;
+        mapped.mapFile(PATH);
+
+        CHECK((tree.countElements() == 0) || (mapped.sizeInBytes().total() < loaded.sizeInBytes().total()), name << ": mapFile() of the current version deserialises lazily");
+        CHECK(mapped.compare(mat, null, true), name << ": mapFile() of the current version");
+    }
+
+    std::remove(PATH.c_str());
+
+}
+
+template<typename E>
+std::vector<std::vector<E>> pad(std::vector<std::vector<E>> mat, size_type numRows, size_type numCols) {
+
+    mat.resize(numRows);
+    for (auto& row : mat) {
+        row.resize(numCols);
+    }
+
+    return mat;
+
+}
+
+int main() {
+
+    std::mt19937 gen(7);
+
+    for (size_type rep = 0; rep < 3; rep++) {
+
+        for (auto dims : std::vector<std::pair<size_type, size_type>>{{4, 32}, {32, 4}, {16, 16}}) {
+
+            std::vector<std::vector<int>> values(dims.first, std::vector<int>(dims.second));
+            std::vector<std::vector<bool>> bits(dims.first, std::vector<bool>(dims.second));
+
+            for (size_type i = 0; i < dims.first; i++) {
+                for (size_type j = 0; j < dims.second; j++) {
+
+                    if (gen() % 4 == 0) {
+                        values[i][j] = gen() % 9 + 1;
+                    }
+                    bits[i][j] = (values[i][j] != 0);
+
+                }
+            }
+
+            std::string dimName = std::to_string(dims.first) + "x" + std::to_string(dims.second);
+
+            {
+                UnevenKrKcTree<int> tree(values, 2, 2, 0);
+                checkVersions(tree, pad(values, tree.getNumRows(), tree.getNumCols()), 0, "UnevenKrKcTree<int> " + dimName);
+            }
+
+            {
+                UnevenKrKcTree<bool> tree(bits, 2, 2);
+                checkVersions(tree, pad(bits, tree.getNumRows(), tree.getNumCols()), false, "UnevenKrKcTree<bool> " + dimName);
+            }
+
+            {
+                auto pairs = boolMatrixToPairs(bits);
+                UnevenKrKcOrMiniTree<bool> tree(pairs, 2, 2, 4);
+                checkVersions(tree, pad(bits, tree.getNumRows(), tree.getNumCols()), false, "UnevenKrKcOrMiniTree<bool> " + dimName);
+            }
+
+            {
+                auto pairs = matrixToPairs(values, 0);
+                UnevenKrKcOrMiniTree<int> tree(pairs, 2, 2, 4, 0);
+                checkVersions(tree, pad(values, tree.getNumRows(), tree.getNumCols()), 0, "UnevenKrKcOrMiniTree<int> " + dimName);
+            }
+
+        }
+
+    }
+
+    std::cout << "FormatVersionTest: " << failures << " failure(s)" << std::endl;
+
+    return (failures == 0) ? 0 : 1;
+
+}
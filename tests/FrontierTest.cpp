@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) 2017 Robert Mueller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Contact: Robert Mueller <romueller@techfak.uni-bielefeld.de>
+ * Faculty of Technology, Bielefeld University,
+ * PO box 100131, DE-33501 Bielefeld, Germany
+ */
+
+/**
+ * Test of expandFrontier() (built and run by "make test").
+ *
+ * Compares the specialised expandFrontier() of the valued Basic, KrKc and Hybrid trees with the generic one of K2Tree
+ * (which expands the rows one by one) on random relations, before and after compressLeaves()
+ * and on serialised / loaded, cloned and copied trees.
+ */
+
+#include <iostream>
+#include <random>
+#include <sstream>
+
+#include "StaticBasicRectangularTree.hpp"
+#include "StaticBasicTree.hpp"
+#include "StaticHybridTree.hpp"
+
+typedef std::vector<ValuedPosition<int>> ValuedPairs;
+
+size_type failures = 0;
+
+#define CHECK(cond, msg) \
+    if (!(cond)) { \
+        failures++; \
+        std::cerr << "FAILED: " << msg << std::endl; \
+    }
+
+// compares the specialised expandFrontier() of tree with the generic one on random frontiers (with and without visited bitmap)
+void checkFrontiers(const K2Tree<int>& tree, std::mt19937& gen, const std::string& name) {
+
+    for (size_type q = 0; q < 50; q++) {
+
+        std::vector<size_type> frontier(gen() % 20);
+        for (auto& i : frontier) {
+            i = gen() % (tree.getNumRows() + 2);
+        }
+
+        CHECK(tree.expandFrontier(frontier) == tree.K2Tree<int>::expandFrontier(frontier), name << ": expandFrontier(frontier)");
+
+        std::vector<bool> visited(tree.getNumCols()), expectedVisited(tree.getNumCols());
+        for (size_type j = 0; j < visited.size(); j++) {
+            visited[j] = expectedVisited[j] = (gen() % 4 == 0);
+        }
+
+        auto cols = tree.expandFrontier(frontier, visited);
+        auto expected = tree.K2Tree<int>::expandFrontier(frontier, expectedVisited);
+        CHECK(cols == expected && visited == expectedVisited, name << ": expandFrontier(frontier, visited)");
+
+    }
+
+}
+
+// checks tree before and after compressLeaves(), the loaded, cloned and copied compressed tree
+template<typename T>
+void checkTree(T& tree, std::mt19937& gen, const std::string& name) {
+
+    checkFrontiers(tree, gen, name);
+
+    tree.compressLeaves();
+    checkFrontiers(tree, gen, name + " (compressed)");
+
+    std::stringstream buffer;
+    tree.serialize(buffer);
+    T loaded;
+    loaded.load(buffer);
+    checkFrontiers(loaded, gen, name + " (compressed, loaded)");
+
+    K2Tree<int>* clone = tree.clone();
+    checkFrontiers(*clone, gen, name + " (compressed, cloned)");
+    delete clone;
+
+    T copy(tree);
+    checkFrontiers(copy, gen, name + " (compressed, copied)");
+
+}
+
+int main() {
+
+    std::mt19937 gen(42);
+
+    for (auto dims : std::vector<std::pair<size_type, size_type>>{{1, 1}, {37, 37}, {100, 100}, {20, 300}, {300, 20}}) {
+
+        for (size_type density : {2, 10, 50}) {
+
+            ValuedPairs pairs;
+            for (size_type i = 0; i < dims.first; i++) {
+                for (size_type j = 0; j < dims.second; j++) {
+                    if (gen() % density == 0) {
+                        pairs.push_back(ValuedPosition<int>(i, j, 1 + gen() % 3));
+                    }
+                }
+            }
+
+            if (pairs.empty()) {
+                pairs.push_back(ValuedPosition<int>(0, 0, 1));
+            }
+
+            std::stringstream name;
+            name << dims.first << "x" << dims.second << ", density 1/" << density;
+
+            if (dims.first == dims.second) {
+
+                for (size_type k : {2, 3}) {
+
+                    ValuedPairs tmp(pairs);
+                    BasicK2Tree<int> basic(tmp, k);
+                    checkTree(basic, gen, "BasicK2Tree " + name.str());
+
+                }
+
+                ValuedPairs tmp(pairs);
+                HybridK2Tree<int> hybrid(tmp, 3, 2, 2);
+                checkTree(hybrid, gen, "HybridK2Tree " + name.str());
+
+            }
+
+            ValuedPairs tmp(pairs);
+            KrKcTree<int> krkc(tmp, 2, 3);
+            checkTree(krkc, gen, "KrKcTree " + name.str());
+
+        }
+
+    }
+
+    std::cout << "expandFrontier: " << failures << " failure(s)" << std::endl;
+
+    return (failures == 0) ? 0 : 1;
+
+}
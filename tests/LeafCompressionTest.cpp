@@ -0,0 +1,244 @@
+/*
+ * Copyright (C) 2017 Robert Mueller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Contact: Robert Mueller <romueller@techfak.uni-bielefeld.de>
+ * Faculty of Technology, Bielefeld University,
+ * PO box 100131, DE-33501 Bielefeld, Germany
+ */
+
+/**
+ * Test of compressLeaves() of the bool Basic, KrKc and Hybrid trees (built and run by "make test").
+ *
+ * Compares the queries of the trees with a naive representation of random relations before and after compressLeaves(),
+ * with counting index and lookup table, and on serialised / loaded, cloned, copied and compacted trees,
+ * and checks that the compressed leaves of a relation with few distinct leaf blocks are smaller.
+ */
+
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <set>
+#include <sstream>
+
+#include "StaticBasicRectangularTree.hpp"
+#include "StaticBasicTree.hpp"
+#include "StaticHybridTree.hpp"
+
+size_type failures = 0;
+
+#define CHECK(cond, msg) \
+    if (!(cond)) { \
+        failures++; \
+        std::cerr << "FAILED: " << msg << std::endl; \
+    }
+
+typedef std::set<std::pair<size_type, size_type>> PairSet;
+
+// compares the queries of tree with the relation given by expected on random rows, columns and ranges
+void checkQueries(const K2Tree<bool>& tree, const PairSet& expected, std::mt19937& gen, const std::string& name) {
+
+    size_type numRows = tree.getNumRows();
+    size_type numCols = tree.getNumCols();
+
+    RelationPairs all = tree.getAllPositions();
+    std::sort(all.begin(), all.end());
+    CHECK(all == RelationPairs(expected.begin(), expected.end()), name << ": getAllPositions()");
+    CHECK(tree.countLinks() == expected.size(), name << ": countLinks()");
+
+    for (size_type q = 0; q < 30; q++) {
+
+        size_type i = gen() % numRows;
+        size_type j = gen() % numCols;
+
+        CHECK(tree.areRelated(i, j) == (expected.count(std::make_pair(i, j)) != 0), name << ": areRelated(" << i << ", " << j << ")");
+
+        std::vector<size_type> succs, preds;
+        for (auto& p : expected) {
+            if (p.first == i) succs.push_back(p.second);
+            if (p.second == j) preds.push_back(p.first);
+        }
+
+        auto res = tree.getSuccessors(i);
+        std::sort(res.begin(), res.end());
+        CHECK(res == succs, name << ": getSuccessors(" << i << ")");
+        CHECK(tree.getFirstSuccessor(i) == (succs.empty() ? numCols : succs[0]), name << ": getFirstSuccessor(" << i << ")");
+
+        res = tree.getPredecessors(j);
+        std::sort(res.begin(), res.end());
+        CHECK(res == preds, name << ": getPredecessors(" << j << ")");
+
+        size_type i1 = gen() % numRows, i2 = gen() % numRows;
+        size_type j1 = gen() % numCols, j2 = gen() % numCols;
+        if (i1 > i2) std::swap(i1, i2);
+        if (j1 > j2) std::swap(j1, j2);
+
+        RelationPairs range;
+        for (auto& p : expected) {
+            if (i1 <= p.first && p.first <= i2 && j1 <= p.second && p.second <= j2) range.push_back(p);
+        }
+
+        auto pairs = tree.getRange(i1, i2, j1, j2);
+        std::sort(pairs.begin(), pairs.end());
+        CHECK(pairs == range, name << ": getRange(" << i1 << ", " << i2 << ", " << j1 << ", " << j2 << ")");
+        CHECK(tree.containsLink(i1, i2, j1, j2) == !range.empty(), name << ": containsLink()");
+        CHECK(tree.countLinksInRange(i1, i2, j1, j2) == range.size(), name << ": countLinksInRange()");
+
+    }
+
+}
+
+// checks tree against expected before and after compressLeaves(), with counting index,
+// and the loaded, cloned and copied compressed tree
+template<typename T>
+void checkTree(T& tree, const PairSet& expected, std::mt19937& gen, const std::string& name) {
+
+    checkQueries(tree, expected, gen, name);
+
+    tree.compressLeaves();
+    CHECK(tree.hasCompressedLeaves() == (expected.size() != 0), name << ": hasCompressedLeaves()");
+    checkQueries(tree, expected, gen, name + " (compressed)");
+
+    tree.buildCountingIndex();
+    checkQueries(tree, expected, gen, name + " (compressed, counting index)");
+
+    std::stringstream buffer;
+    tree.serialize(buffer);
+    T loaded;
+    loaded.load(buffer);
+    CHECK(loaded.hasCompressedLeaves() == tree.hasCompressedLeaves(), name << ": hasCompressedLeaves() after load()");
+    checkQueries(loaded, expected, gen, name + " (compressed, loaded)");
+
+    K2Tree<bool>* clone = tree.clone();
+    checkQueries(*clone, expected, gen, name + " (compressed, cloned)");
+    delete clone;
+
+    T copy(tree);
+    checkQueries(copy, expected, gen, name + " (compressed, copied)");
+
+    if (tree.hasCompressedLeaves()) {
+
+        bool thrown = false;
+        try {
+            tree.setNull(0, 0);
+        } catch (std::runtime_error&) {
+            thrown = true;
+        }
+        CHECK(thrown, name << ": setNull() after compressLeaves() throws");
+
+    }
+
+}
+
+// checks that compact() keeps the leaves compressed when setNull() preceded compressLeaves()
+template<typename T>
+void checkCompact(T& tree, PairSet expected, std::mt19937& gen, const std::string& name) {
+
+    for (size_type r = 0; r < 5 && !expected.empty(); r++) {
+
+        auto it = expected.begin();
+        std::advance(it, gen() % expected.size());
+        tree.setNull(it->first, it->second);
+        expected.erase(it);
+
+    }
+
+    tree.compressLeaves();
+    checkQueries(tree, expected, gen, name + " (emptied, compressed)");
+
+    tree.compact();
+    CHECK(tree.hasCompressedLeaves() == (expected.size() != 0), name << ": hasCompressedLeaves() after compact()");
+    checkQueries(tree, expected, gen, name + " (emptied, compressed, compacted)");
+
+}
+
+int main() {
+
+    std::mt19937 gen(17);
+
+    for (auto dims : std::vector<std::pair<size_type, size_type>>{{1, 1}, {37, 37}, {64, 64}, {20, 90}, {90, 20}}) {
+
+        for (size_type density : {2, 10, 50}) {
+
+            PairSet expected;
+            for (size_type i = 0; i < dims.first; i++) {
+                for (size_type j = 0; j < dims.second; j++) {
+                    if (gen() % density == 0) {
+                        expected.insert(std::make_pair(i, j));
+                    }
+                }
+            }
+
+            std::stringstream name;
+            name << dims.first << "x" << dims.second << ", density 1/" << density;
+
+            if (dims.first == dims.second) {
+
+                for (size_type k : {2, 3, 4}) {
+
+                    RelationPairs pairs(expected.begin(), expected.end());
+                    BasicK2Tree<bool> basic(pairs, k);
+                    basic.buildLookupTable(basic.getMaxLookupTableLevels());
+                    checkTree(basic, expected, gen, "BasicK2Tree k=" + std::to_string(k) + " " + name.str());
+
+                    pairs.assign(expected.begin(), expected.end());
+                    BasicK2Tree<bool> emptied(pairs, k);
+                    checkCompact(emptied, expected, gen, "BasicK2Tree k=" + std::to_string(k) + " " + name.str());
+
+                }
+
+                RelationPairs pairs(expected.begin(), expected.end());
+                HybridK2Tree<bool> hybrid(pairs, 3, 2, 2);
+                checkTree(hybrid, expected, gen, "HybridK2Tree " + name.str());
+
+                pairs.assign(expected.begin(), expected.end());
+                HybridK2Tree<bool> emptied(pairs, 3, 2, 2);
+                checkCompact(emptied, expected, gen, "HybridK2Tree " + name.str());
+
+            }
+
+            RelationPairs pairs(expected.begin(), expected.end());
+            KrKcTree<bool> krkc(pairs, 2, 3);
+            checkTree(krkc, expected, gen, "KrKcTree " + name.str());
+
+            pairs.assign(expected.begin(), expected.end());
+            KrKcTree<bool> emptied(pairs, 2, 3);
+            checkCompact(emptied, expected, gen, "KrKcTree " + name.str());
+
+        }
+
+    }
+
+    // few distinct leaf blocks: every 4x4 block on the diagonal has the same pattern
+    {
+        RelationPairs pairs;
+        for (size_type b = 0; b < 256; b++) {
+            for (size_type x = 0; x < 4; x++) {
+                pairs.push_back(std::make_pair(4 * b + x, 4 * b + (x + 1) % 4));
+            }
+        }
+
+        RelationPairs tmp(pairs);
+        BasicK2Tree<bool> basic(tmp, 4);
+        size_type plain = basic.sizeInBytes().L;
+        basic.compressLeaves();
+        CHECK(basic.sizeInBytes().L < plain, "BasicK2Tree: compressed leaves (" << basic.sizeInBytes().L << " bytes) smaller than plain ones (" << plain << " bytes)");
+    }
+
+    std::cout << "LeafCompressionTest: " << failures << " failure(s)" << std::endl;
+
+    return (failures == 0) ? 0 : 1;
+
+}
@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2017 Robert Mueller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Contact: Robert Mueller <romueller@techfak.uni-bielefeld.de>
+ * Faculty of Technology, Bielefeld University,
+ * PO box 100131, DE-33501 Bielefeld, Germany
+ */
+
+/**
+ * Test of the modes of the list-based constructors (built and run by "make test").
+ *
+ * Compares the serialisation of the Basic, KrKc, Hybrid and row trees (bool and valued) built from lists
+ * via a temporary matrix (mode 0), via a temporary tree (mode 1) and via dynamic bitmaps (mode 2).
+ */
+
+#include <functional>
+#include <iostream>
+#include <random>
+#include <sstream>
+
+#include "StaticBasicRectangularTree.hpp"
+#include "StaticBasicTree.hpp"
+#include "StaticHybridRowTree.hpp"
+#include "StaticHybridTree.hpp"
+#include "StaticRowTree.hpp"
+
+typedef std::vector<std::vector<std::pair<size_type, int>>> ValuedLists;
+
+size_type failures = 0;
+
+#define CHECK(cond, msg) \
+    if (!(cond)) { \
+        failures++; \
+        std::cerr << "FAILED: " << msg << std::endl; \
+    }
+
+template<typename T>
+std::string serialise(const T& tree) {
+
+    std::stringstream out;
+    tree.serialize(out);
+
+    return out.str();
+
+}
+
+// compares the trees built by build() in modes 1 and 2 with the one built in mode 0
+template<typename T>
+void checkModes(const std::function<T(int)>& build, const std::string& name) {
+
+    std::string expected = serialise(build(0));
+
+    for (int mode : {1, 2}) {
+        CHECK(serialise(build(mode)) == expected, name << ": serialize() in mode " << mode << " differs from mode 0");
+    }
+
+}
+
+int main() {
+
+    std::mt19937 gen(21);
+
+    for (size_type n : {5, 16, 37, 64}) {
+
+        for (size_type density : {2, 10}) {
+
+            // random relation whose last row contains the last column (so that no list is empty and the trees have the intended height)
+            RelationLists lists(n);
+            ValuedLists values(n);
+            for (size_type i = 0; i < n; i++) {
+                for (size_type j = 0; j < n; j++) {
+
+                    if ((gen() % density == 0) || (i == n - 1 && j == n - 1)) {
+
+                        lists[i].push_back(j);
+                        values[i].push_back(std::make_pair(j, int(1 + gen() % 3)));
+
+                    }
+
+                }
+            }
+
+            std::stringstream name;
+            name << n << "x" << n << ", density 1/" << density;
+
+            // const, as the list-of-pairs-based constructors of the row trees would be chosen for modifiable lists
+            const RelationList& row = lists[n - 1];
+            const std::vector<std::pair<size_type, int>>& valuedRow = values[n - 1];
+
+            for (size_type k : {2, 3, 4}) {
+
+                std::string suffix = " k=" + std::to_string(k) + " " + name.str();
+
+                checkModes<BasicK2Tree<bool>>([&](int mode) { return BasicK2Tree<bool>(lists, k, mode); }, "BasicK2Tree<bool>" + suffix);
+                checkModes<BasicK2Tree<int>>([&](int mode) { return BasicK2Tree<int>(values, k, mode); }, "BasicK2Tree<int>" + suffix);
+                checkModes<BasicRowTree<bool>>([&](int mode) { return BasicRowTree<bool>(row, k, mode); }, "BasicRowTree<bool>" + suffix);
+                checkModes<BasicRowTree<int>>([&](int mode) { return BasicRowTree<int>(valuedRow, k, mode); }, "BasicRowTree<int>" + suffix);
+
+            }
+
+            for (auto arities : std::vector<std::pair<size_type, size_type>>{{2, 3}, {3, 2}}) {
+
+                size_type kr = arities.first, kc = arities.second;
+                std::string suffix = " " + std::to_string(kr) + "x" + std::to_string(kc) + " " + name.str();
+
+                checkModes<KrKcTree<bool>>([&](int mode) { return KrKcTree<bool>(lists, kr, kc, mode); }, "KrKcTree<bool>" + suffix);
+                checkModes<KrKcTree<int>>([&](int mode) { return KrKcTree<int>(values, kr, kc, mode); }, "KrKcTree<int>" + suffix);
+
+            }
+
+            for (auto config : std::vector<std::vector<size_type>>{{2, 1, 2}, {3, 2, 2}, {4, 1, 3}, {2, 2, 4}, {2, 3, 2}}) {
+
+                size_type upperK = config[0], upperH = config[1], lowerK = config[2];
+                std::string suffix = " " + std::to_string(upperK) + "/" + std::to_string(upperH) + "/" + std::to_string(lowerK) + " " + name.str();
+
+                checkModes<HybridK2Tree<bool>>([&](int mode) { return HybridK2Tree<bool>(lists, upperK, upperH, lowerK, mode); }, "HybridK2Tree<bool>" + suffix);
+                checkModes<HybridK2Tree<int>>([&](int mode) { return HybridK2Tree<int>(values, upperK, upperH, lowerK, mode); }, "HybridK2Tree<int>" + suffix);
+                checkModes<HybridRowTree<bool>>([&](int mode) { return HybridRowTree<bool>(row, upperK, upperH, lowerK, mode); }, "HybridRowTree<bool>" + suffix);
+                checkModes<HybridRowTree<int>>([&](int mode) { return HybridRowTree<int>(valuedRow, upperK, upperH, lowerK, mode); }, "HybridRowTree<int>" + suffix);
+
+            }
+
+        }
+
+    }
+
+    std::cout << "ListModeTest: " << failures << " failure(s)" << std::endl;
+
+    return (failures == 0) ? 0 : 1;
+
+}
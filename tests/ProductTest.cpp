@@ -0,0 +1,204 @@
+/*
+ * Copyright (C) 2017 Robert Mueller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Contact: Robert Mueller <romueller@techfak.uni-bielefeld.de>
+ * Faculty of Technology, Bielefeld University,
+ * PO box 100131, DE-33501 Bielefeld, Germany
+ */
+
+/**
+ * Test of getProductPositions() and getProduct() (built and run by "make test").
+ *
+ * Compares the boolean matrix product of BasicK2Trees and (also rectangular) KrKcTrees of several arities and heights
+ * with a naive implementation on sets of pairs, with one and several threads,
+ * also for operands modified by setNull() and / or compressLeaves().
+ */
+
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <random>
+#include <set>
+#include <sstream>
+
+#include "StaticBasicRectangularTree.hpp"
+#include "StaticBasicTree.hpp"
+
+typedef std::set<std::pair<size_type, size_type>> PairSet;
+
+size_type failures = 0;
+
+#define CHECK(cond, msg) \
+    if (!(cond)) { \
+        failures++; \
+        std::cerr << "FAILED: " << msg << std::endl; \
+    }
+
+// random relation on a numRows x numCols matrix containing its last entry (so that the K2Trees have the intended height)
+PairSet randomRelation(size_type numRows, size_type numCols, size_type density, std::mt19937& gen) {
+
+    PairSet rel;
+    for (size_type i = 0; i < numRows; i++) {
+        for (size_type j = 0; j < numCols; j++) {
+            if (gen() % density == 0) {
+                rel.insert(std::make_pair(i, j));
+            }
+        }
+    }
+    rel.insert(std::make_pair(numRows - 1, numCols - 1));
+
+    return rel;
+
+}
+
+// removes a few pairs via setNull() (variant & 1, the last entry is kept) and / or compresses the leaves (variant & 2)
+template<typename T>
+void modify(T& tree, PairSet& rel, size_type variant, std::mt19937& gen) {
+
+    if (variant & 1) {
+
+        for (size_type r = 0; r < 3 && rel.size() > 1; r++) {
+
+            auto it = rel.begin();
+            std::advance(it, gen() % (rel.size() - 1));
+            tree.setNull(it->first, it->second);
+            rel.erase(it);
+
+        }
+
+    }
+
+    if (variant & 2) {
+        tree.compressLeaves();
+    }
+
+}
+
+// naive product of r and s
+PairSet naiveProduct(const PairSet& r, const PairSet& s) {
+
+    std::map<size_type, std::vector<size_type>> succs;
+    for (auto& p : s) {
+        succs[p.first].push_back(p.second);
+    }
+
+    PairSet res;
+    for (auto& p : r) {
+
+        auto it = succs.find(p.second);
+        if (it != succs.end()) {
+            for (auto j : it->second) {
+                res.insert(std::make_pair(p.first, j));
+            }
+        }
+
+    }
+
+    return res;
+
+}
+
+// compares the product of a and b (representing ra and rb) with the naive one
+template<typename T>
+void checkProduct(const T& a, const T& b, const PairSet& ra, const PairSet& rb, const std::string& name) {
+
+    PairSet expected = naiveProduct(ra, rb);
+
+    for (size_type numThreads : {1, 3}) {
+
+        std::stringstream suffix;
+        suffix << ", " << numThreads << " thread(s)";
+
+        RelationPairs pairs = a.getProductPositions(b, numThreads);
+        std::sort(pairs.begin(), pairs.end());
+        CHECK(pairs == RelationPairs(expected.begin(), expected.end()), name << suffix.str() << ": getProductPositions()");
+
+        T product = a.getProduct(b, numThreads);
+        pairs = product.getAllPositions();
+        std::sort(pairs.begin(), pairs.end());
+        CHECK(pairs == RelationPairs(expected.begin(), expected.end()), name << suffix.str() << ": getProduct()");
+        CHECK(product.getNumRows() == a.getNumRows() && product.getNumCols() == b.getNumCols(), name << suffix.str() << ": size of getProduct()");
+
+    }
+
+}
+
+int main() {
+
+    std::mt19937 gen(19);
+
+    for (size_type density : {3, 12}) {
+
+        for (size_type k : {2, 3, 4}) {
+            for (size_type h = 1; h <= 3; h++) {
+
+                size_type n = size_type(pow(k, h));
+
+                for (size_type va = 0; va < 4; va++) {
+                    for (size_type vb = 0; vb < 4; vb++) {
+
+                        PairSet ra = randomRelation(n, n, density, gen);
+                        PairSet rb = randomRelation(n, n, density, gen);
+                        RelationPairs pa(ra.begin(), ra.end()), pb(rb.begin(), rb.end());
+                        BasicK2Tree<bool> a(pa, k), b(pb, k);
+                        modify(a, ra, va, gen);
+                        modify(b, rb, vb, gen);
+
+                        std::stringstream name;
+                        name << "BasicK2Tree k=" << k << " h=" << h << " density 1/" << density << " variants " << va << "/" << vb;
+                        checkProduct(a, b, ra, rb, name.str());
+
+                    }
+                }
+
+            }
+        }
+
+        // (row arity of R, column arity of R = row arity of S, column arity of S)
+        for (auto arities : std::vector<std::vector<size_type>>{{2, 2, 2}, {2, 3, 2}, {3, 2, 4}, {2, 4, 3}, {4, 2, 2}}) {
+            for (size_type h = 1; h <= 3; h++) {
+
+                size_type numRows = size_type(pow(arities[0], h));
+                size_type numInner = size_type(pow(arities[1], h));
+                size_type numCols = size_type(pow(arities[2], h));
+
+                for (size_type va = 0; va < 4; va++) {
+                    for (size_type vb = 0; vb < 4; vb++) {
+
+                        PairSet ra = randomRelation(numRows, numInner, density, gen);
+                        PairSet rb = randomRelation(numInner, numCols, density, gen);
+                        RelationPairs pa(ra.begin(), ra.end()), pb(rb.begin(), rb.end());
+                        KrKcTree<bool> a(pa, arities[0], arities[1]), b(pb, arities[1], arities[2]);
+                        modify(a, ra, va, gen);
+                        modify(b, rb, vb, gen);
+
+                        std::stringstream name;
+                        name << "KrKcTree " << arities[0] << "x" << arities[1] << " * " << arities[1] << "x" << arities[2] << " h=" << h << " density 1/" << density << " variants " << va << "/" << vb;
+                        checkProduct(a, b, ra, rb, name.str());
+
+                    }
+                }
+
+            }
+        }
+
+    }
+
+    std::cout << "ProductTest: " << failures << " failure(s)" << std::endl;
+
+    return (failures == 0) ? 0 : 1;
+
+}
@@ -0,0 +1,283 @@
+/*
+ * Copyright (C) 2017 Robert Mueller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Contact: Robert Mueller <romueller@techfak.uni-bielefeld.de>
+ * Faculty of Technology, Bielefeld University,
+ * PO box 100131, DE-33501 Bielefeld, Germany
+ */
+
+/**
+ * Test of getUnion(), getIntersection() and getDifference() (built and run by "make test").
+ *
+ * Compares the set operations of the bool and valued Basic and KrKc trees of several arities and heights
+ * with a naive implementation on maps of pairs, also for operands modified by setNull() and / or compressLeaves().
+ */
+
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+
+#include "StaticBasicRectangularTree.hpp"
+#include "StaticBasicTree.hpp"
+
+typedef std::vector<ValuedPosition<int>> ValuedPairs;
+
+template<typename E>
+using Relation = std::map<std::pair<size_type, size_type>, E>;
+
+size_type failures = 0;
+
+#define CHECK(cond, msg) \
+    if (!(cond)) { \
+        failures++; \
+        std::cerr << "FAILED: " << msg << std::endl; \
+    }
+
+// random relation on a numRows x numCols matrix containing its last entry (so that the K2Trees have the intended height)
+template<typename E>
+Relation<E> randomRelation(size_type numRows, size_type numCols, size_type density, std::mt19937& gen) {
+
+    Relation<E> rel;
+    for (size_type i = 0; i < numRows; i++) {
+        for (size_type j = 0; j < numCols; j++) {
+            if (gen() % density == 0) {
+                rel[std::make_pair(i, j)] = E(1 + gen() % 3);
+            }
+        }
+    }
+    rel[std::make_pair(numRows - 1, numCols - 1)] = E(1);
+
+    return rel;
+
+}
+
+RelationPairs toPairs(const Relation<bool>& rel) {
+
+    RelationPairs pairs;
+    for (auto& e : rel) {
+        pairs.push_back(e.first);
+    }
+
+    return pairs;
+
+}
+
+ValuedPairs toPairs(const Relation<int>& rel) {
+
+    ValuedPairs pairs;
+    for (auto& e : rel) {
+        pairs.push_back(ValuedPosition<int>(e.first.first, e.first.second, e.second));
+    }
+
+    return pairs;
+
+}
+
+template<typename E>
+Relation<E> toRelation(const K2Tree<E>& tree) {
+
+    Relation<E> rel;
+    for (auto& p : tree.getAllValuedPositions()) {
+        rel[std::make_pair(p.row, p.col)] = p.val;
+    }
+
+    return rel;
+
+}
+
+BasicK2Tree<bool>* newBasic(const Relation<bool>& rel, size_type k) {
+    RelationPairs pairs = toPairs(rel);
+    return new BasicK2Tree<bool>(pairs, k);
+}
+
+BasicK2Tree<int>* newBasic(const Relation<int>& rel, size_type k) {
+    ValuedPairs pairs = toPairs(rel);
+    return new BasicK2Tree<int>(pairs, k);
+}
+
+KrKcTree<bool>* newKrKc(const Relation<bool>& rel, size_type kr, size_type kc) {
+    RelationPairs pairs = toPairs(rel);
+    return new KrKcTree<bool>(pairs, kr, kc);
+}
+
+KrKcTree<int>* newKrKc(const Relation<int>& rel, size_type kr, size_type kc) {
+    ValuedPairs pairs = toPairs(rel);
+    return new KrKcTree<int>(pairs, kr, kc);
+}
+
+// removes a few pairs via setNull() (variant & 1, the last entry is kept) and / or compresses the leaves (variant & 2)
+template<typename T, typename E>
+void modify(T& tree, Relation<E>& rel, size_type variant, std::mt19937& gen) {
+
+    if (variant & 1) {
+
+        for (size_type r = 0; r < 3 && rel.size() > 1; r++) {
+
+            auto it = rel.begin();
+            std::advance(it, gen() % (rel.size() - 1));
+            tree.setNull(it->first.first, it->first.second);
+            rel.erase(it);
+
+        }
+
+    }
+
+    if (variant & 2) {
+        tree.compressLeaves();
+    }
+
+}
+
+// naive set operations (values of pairs contained in both relations are taken from a)
+template<typename E>
+Relation<E> naiveUnion(const Relation<E>& a, const Relation<E>& b) {
+
+    Relation<E> res(b);
+    for (auto& e : a) {
+        res[e.first] = e.second;
+    }
+
+    return res;
+
+}
+
+template<typename E>
+Relation<E> naiveIntersection(const Relation<E>& a, const Relation<E>& b) {
+
+    Relation<E> res;
+    for (auto& e : a) {
+        if (b.count(e.first) != 0) {
+            res.insert(e);
+        }
+    }
+
+    return res;
+
+}
+
+template<typename E>
+Relation<E> naiveDifference(const Relation<E>& a, const Relation<E>& b) {
+
+    Relation<E> res;
+    for (auto& e : a) {
+        if (b.count(e.first) == 0) {
+            res.insert(e);
+        }
+    }
+
+    return res;
+
+}
+
+// compares the set operations of a and b (representing ra and rb) with the naive ones
+template<typename T, typename E>
+void checkOperations(const T& a, const T& b, const Relation<E>& ra, const Relation<E>& rb, const std::string& name) {
+
+    T res = a.getUnion(b);
+    CHECK(toRelation(res) == naiveUnion(ra, rb), name << ": getUnion()");
+    CHECK(res.getNumRows() == a.getNumRows() && res.getNumCols() == a.getNumCols(), name << ": size of getUnion()");
+
+    res = a.getIntersection(b);
+    CHECK(toRelation(res) == naiveIntersection(ra, rb), name << ": getIntersection()");
+
+    res = a.getDifference(b);
+    CHECK(toRelation(res) == naiveDifference(ra, rb), name << ": getDifference()");
+
+    res = b.getDifference(a);
+    CHECK(toRelation(res) == naiveDifference(rb, ra), name << ": getDifference() (swapped)");
+
+}
+
+// checks the set operations of the Basic and KrKc trees of relations of type E for all combinations of the variants of modify()
+template<typename E>
+void checkFamilies(size_type density, std::mt19937& gen, const std::string& type) {
+
+    for (size_type k : {2, 3, 4}) {
+        for (size_type h = 1; h <= 3; h++) {
+
+            size_type n = size_type(pow(k, h));
+
+            for (size_type va = 0; va < 4; va++) {
+                for (size_type vb = 0; vb < 4; vb++) {
+
+                    Relation<E> ra = randomRelation<E>(n, n, density, gen);
+                    Relation<E> rb = randomRelation<E>(n, n, density, gen);
+                    BasicK2Tree<E>* a = newBasic(ra, k);
+                    BasicK2Tree<E>* b = newBasic(rb, k);
+                    modify(*a, ra, va, gen);
+                    modify(*b, rb, vb, gen);
+
+                    std::stringstream name;
+                    name << "BasicK2Tree<" << type << "> k=" << k << " h=" << h << " density 1/" << density << " variants " << va << "/" << vb;
+                    checkOperations(*a, *b, ra, rb, name.str());
+
+                    delete a;
+                    delete b;
+
+                }
+            }
+
+        }
+    }
+
+    for (auto arities : std::vector<std::pair<size_type, size_type>>{{2, 2}, {2, 3}, {3, 2}, {4, 2}}) {
+        for (size_type h = 1; h <= 3; h++) {
+
+            size_type kr = arities.first, kc = arities.second;
+            size_type numRows = size_type(pow(kr, h)), numCols = size_type(pow(kc, h));
+
+            for (size_type va = 0; va < 4; va++) {
+                for (size_type vb = 0; vb < 4; vb++) {
+
+                    Relation<E> ra = randomRelation<E>(numRows, numCols, density, gen);
+                    Relation<E> rb = randomRelation<E>(numRows, numCols, density, gen);
+                    KrKcTree<E>* a = newKrKc(ra, kr, kc);
+                    KrKcTree<E>* b = newKrKc(rb, kr, kc);
+                    modify(*a, ra, va, gen);
+                    modify(*b, rb, vb, gen);
+
+                    std::stringstream name;
+                    name << "KrKcTree<" << type << "> " << kr << "x" << kc << " h=" << h << " density 1/" << density << " variants " << va << "/" << vb;
+                    checkOperations(*a, *b, ra, rb, name.str());
+
+                    delete a;
+                    delete b;
+
+                }
+            }
+
+        }
+    }
+
+}
+
+int main() {
+
+    std::mt19937 gen(18);
+
+    for (size_type density : {2, 8}) {
+
+        checkFamilies<bool>(density, gen, "bool");
+        checkFamilies<int>(density, gen, "int");
+
+    }
+
+    std::cout << "SetOperationTest: " << failures << " failure(s)" << std::endl;
+
+    return (failures == 0) ? 0 : 1;
+
+}
@@ -0,0 +1,234 @@
+/*
+ * Copyright (C) 2017 Robert Mueller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Contact: Robert Mueller <romueller@techfak.uni-bielefeld.de>
+ * Faculty of Technology, Bielefeld University,
+ * PO box 100131, DE-33501 Bielefeld, Germany
+ */
+
+/**
+ * Test of the sharding of UnevenKrKcTrees (built and run by "make test").
+ *
+ * Builds all shards of random (row- and column-partitioned) relations via the sharding constructor and serializeShard(),
+ * loads them via load() and mapFile() and compares the answers merged by mergeShardAnswers() from the subqueries of
+ * splitRange(), splitSuccessors() and splitPredecessors() with the answers of the unsharded UnevenKrKcTree.
+ */
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <tuple>
+
+#include "StaticUnevenRectangularTree.hpp"
+
+typedef std::vector<ValuedPosition<int>> ValuedPairs;
+
+size_type failures = 0;
+
+#define CHECK(cond, msg) \
+    if (!(cond)) { \
+        failures++; \
+        std::cerr << "FAILED: " << msg << std::endl; \
+    }
+
+template<typename E>
+using Answer = std::vector<std::tuple<size_type, size_type, E>>;
+
+template<typename E>
+Answer<E> toAnswer(const std::vector<ValuedPosition<E>>& pairs) {
+
+    Answer<E> res;
+    for (auto& p : pairs) {
+        res.push_back(std::make_tuple(p.row, p.col, p.val));
+    }
+
+    return res;
+
+}
+
+RelationPairs toPairs(const RelationPairs& pairs, bool) {
+    return pairs;
+}
+
+ValuedPairs toPairs(const RelationPairs& pairs, int) {
+
+    ValuedPairs res;
+    for (auto& p : pairs) {
+        res.push_back(ValuedPosition<int>(p.first, p.second, int((p.first + p.second) % 4)));
+    }
+
+    return res;
+
+}
+
+UnevenKrKcTree<bool>* newTree(RelationPairs& pairs, size_type kr, size_type kc, bool) {
+    return new UnevenKrKcTree<bool>(pairs, kr, kc);
+}
+
+UnevenKrKcTree<int>* newTree(ValuedPairs& pairs, size_type kr, size_type kc, int null) {
+    return new UnevenKrKcTree<int>(pairs, kr, kc, null);
+}
+
+UnevenKrKcTree<bool>* newShard(RelationPairs& pairs, const ShardManifest& manifest, size_type s, bool) {
+    return new UnevenKrKcTree<bool>(pairs, manifest, s);
+}
+
+UnevenKrKcTree<int>* newShard(ValuedPairs& pairs, const ShardManifest& manifest, size_type s, int null) {
+    return new UnevenKrKcTree<int>(pairs, manifest, s, null);
+}
+
+// compares the merged answers of the shards with the answers of tree on random queries
+template<typename E>
+void checkQueries(const UnevenKrKcTree<E>& tree, const std::vector<UnevenKrKcTree<E>*>& shards, const ShardManifest& manifest,
+                  std::mt19937& gen, const std::string& name) {
+
+    size_type numRows = tree.getNumRows();
+    size_type numCols = tree.getNumCols();
+
+    for (size_type q = 0; q < 20; q++) {
+
+        size_type i1 = gen() % numRows, i2 = gen() % numRows;
+        size_type j1 = gen() % numCols, j2 = gen() % numCols;
+        if (i1 > i2) std::swap(i1, i2);
+        if (j1 > j2) std::swap(j1, j2);
+
+        std::vector<Answer<E>> answers;
+        std::vector<RelationPairs> ranges;
+        for (auto& sq : manifest.splitRange(i1, i2, j1, j2)) {
+            answers.push_back(toAnswer(shards[sq.shard]->getValuedPositionsInRange(sq.i1, sq.i2, sq.j1, sq.j2)));
+            ranges.push_back(shards[sq.shard]->getPositionsInRange(sq.i1, sq.i2, sq.j1, sq.j2));
+        }
+        CHECK(mergeShardAnswers(answers) == toAnswer(tree.getValuedPositionsInRange(i1, i2, j1, j2)), name << ": splitRange(" << i1 << ", " << i2 << ", " << j1 << ", " << j2 << ") (valued)");
+        CHECK(mergeShardAnswers(ranges) == tree.getPositionsInRange(i1, i2, j1, j2), name << ": splitRange(" << i1 << ", " << i2 << ", " << j1 << ", " << j2 << ")");
+
+        size_type i = gen() % numRows;
+        std::vector<std::vector<size_type>> succs;
+        for (auto& sq : manifest.splitSuccessors(i)) {
+            succs.push_back(shards[sq.shard]->getSuccessorPositions(i));
+        }
+        CHECK(mergeShardAnswers(succs) == tree.getSuccessorPositions(i), name << ": splitSuccessors(" << i << ")");
+
+        size_type j = gen() % numCols;
+        std::vector<std::vector<size_type>> preds;
+        for (auto& sq : manifest.splitPredecessors(j)) {
+            preds.push_back(shards[sq.shard]->getPredecessorPositions(j));
+        }
+        CHECK(mergeShardAnswers(preds) == tree.getPredecessorPositions(j), name << ": splitPredecessors(" << j << ")");
+
+    }
+
+}
+
+const std::string PATH = "ShardTest.bin";
+
+// builds and checks all shards of the relation given by positions (values as by toPairs()) for several numbers of shards
+template<typename E>
+void checkSharding(const RelationPairs& positions, size_type numRows, size_type numCols, size_type kr, size_type kc, E null,
+                   std::mt19937& gen, const std::string& name) {
+
+    auto pairs = toPairs(positions, null);
+    auto tmp = pairs;
+    UnevenKrKcTree<E>* tree = newTree(tmp, kr, kc, null);
+
+    for (size_type numShards : {1, 2, 3, 7}) {
+
+        ShardManifest manifest(numRows, numCols, kr, kc, numShards);
+        std::stringstream shardName;
+        shardName << name << ", " << manifest.getNumShards() << " shard(s) of " << manifest.getNumPartitions() << " partitions ("
+                  << (manifest.isColumnPartitioned() ? "columns" : "rows") << ")";
+
+        std::vector<UnevenKrKcTree<E>*> built, loaded, mapped;
+        for (size_type s = 0; s < manifest.getNumShards(); s++) {
+
+            tmp = pairs;
+            built.push_back(newShard(tmp, manifest, s, null));
+
+            std::stringstream fromBuilt, fromTree;
+            built.back()->serialize(fromBuilt);
+            tree->serializeShard(fromTree, manifest, s);
+            CHECK(fromBuilt.str() == fromTree.str(), shardName.str() << ": sharding constructor and serializeShard() of shard " << s);
+
+            loaded.push_back(new UnevenKrKcTree<E>());
+            loaded.back()->load(fromTree);
+
+            std::string path = PATH + "." + std::to_string(s);
+            {
+                std::ofstream out(path, std::ios::binary);
+                tree->serializeShard(out, manifest, s);
+            }
+            mapped.push_back(new UnevenKrKcTree<E>());
+            mapped.back()->mapFile(path);
+
+        }
+
+        checkQueries(*tree, built, manifest, gen, shardName.str() + " (built)");
+        checkQueries(*tree, loaded, manifest, gen, shardName.str() + " (loaded)");
+        checkQueries(*tree, mapped, manifest, gen, shardName.str() + " (mapped)");
+
+        for (size_type s = 0; s < manifest.getNumShards(); s++) {
+
+            delete built[s];
+            delete loaded[s];
+            delete mapped[s];
+            std::remove((PATH + "." + std::to_string(s)).c_str());
+
+        }
+
+    }
+
+    delete tree;
+
+}
+
+int main() {
+
+    std::mt19937 gen(29);
+
+    for (auto dims : std::vector<std::pair<size_type, size_type>>{{8, 64}, {64, 8}, {16, 16}, {5, 100}, {100, 5}}) {
+
+        for (size_type density : {3, 20}) {
+
+            RelationPairs positions;
+            for (size_type i = 0; i < dims.first; i++) {
+                for (size_type j = 0; j < dims.second; j++) {
+                    if (gen() % density == 0) {
+                        positions.push_back(std::make_pair(i, j));
+                    }
+                }
+            }
+            positions.push_back(std::make_pair(dims.first - 1, dims.second - 1));
+
+            for (auto arities : std::vector<std::pair<size_type, size_type>>{{2, 2}, {2, 3}, {3, 2}}) {
+
+                std::stringstream name;
+                name << dims.first << "x" << dims.second << " " << arities.first << "x" << arities.second << ", density 1/" << density;
+
+                checkSharding(positions, dims.first, dims.second, arities.first, arities.second, false, gen, "UnevenKrKcTree<bool> " + name.str());
+                checkSharding(positions, dims.first, dims.second, arities.first, arities.second, -1, gen, "UnevenKrKcTree<int> " + name.str());
+
+            }
+
+        }
+
+    }
+
+    std::cout << "ShardTest: " << failures << " failure(s)" << std::endl;
+
+    return (failures == 0) ? 0 : 1;
+
+}
@@ -0,0 +1,126 @@
+/*
+ * Copyright (C) 2017 Robert Mueller
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Contact: Robert Mueller <romueller@techfak.uni-bielefeld.de>
+ * Faculty of Technology, Bielefeld University,
+ * PO box 100131, DE-33501 Bielefeld, Germany
+ */
+
+/**
+ * Test of tuneK2Tree() (built and run by "make test").
+ *
+ * Builds all candidate configurations for clustered relations (dense blocks at random positions, as in the benchmark harness)
+ * and checks that their estimated sizes are close to the real ones and that tuneK2Tree(MIN_SPACE) selects a configuration
+ * whose real size is (up to 1%) the smallest one.
+ */
+
+#include <iostream>
+#include <random>
+
+#include "K2TreeFactory.hpp"
+
+size_type failures = 0;
+
+#define CHECK(cond, msg) \
+    if (!(cond)) { \
+        failures++; \
+        std::cerr << "FAILED: " << msg << std::endl; \
+    }
+
+// returns a numRows x numCols relation (or its transpose) of (up to) numPairs pairs in dense side x side blocks at random positions
+RelationPairs clusteredRelation(size_type numRows, size_type numCols, size_type numPairs, size_type side, bool transposed, size_type seed) {
+
+    std::mt19937_64 gen(seed);
+
+    size_type numClusters = std::max((size_type) 1, numPairs / 512);
+    std::uniform_int_distribution<size_type> row(0, numRows - side);
+    std::uniform_int_distribution<size_type> col(0, numCols - side);
+    std::uniform_int_distribution<size_type> offset(0, side - 1);
+
+    std::vector<std::pair<size_type, size_type>> clusters(numClusters);
+    for (auto& c : clusters) {
+        c = std::make_pair(row(gen), col(gen));
+    }
+
+    RelationPairs pairs;
+    std::uniform_int_distribution<size_type> cluster(0, numClusters - 1);
+    for (size_type x = 0; x < numPairs; x++) {
+
+        auto& c = clusters[cluster(gen)];
+        size_type i = c.first + offset(gen);
+        size_type j = c.second + offset(gen);
+        pairs.push_back(transposed ? std::make_pair(j, i) : std::make_pair(i, j));
+
+    }
+
+    std::sort(pairs.begin(), pairs.end());
+    pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+
+    return pairs;
+
+}
+
+// returns the real size of the K2Tree built for config
+double realBytes(const RelationPairs& pairs, const K2TreeConfig& config) {
+
+    RelationPairs tmp(pairs);
+    K2Tree<bool>* tree = buildK2Tree(tmp, config);
+    double bytes = tree->sizeInBytes().total();
+    delete tree;
+
+    return bytes;
+
+}
+
+void checkTuning(const RelationPairs& pairs, const std::string& name) {
+
+    TuningOptions opts;
+
+    // the same sample as drawn by tuneK2Tree()
+    size_type numRows, numCols;
+    auto sample = samplePositions(pairs.size(), opts.sampleSize, opts.seed, [&](size_type x) {
+        return pairs[x];
+    }, numRows, numCols);
+
+    double smallest = 0;
+    for (auto& config : estimateK2TreeConfigs(sample, pairs.size(), numRows, numCols, 0, opts)) {
+
+        double bytes = realBytes(pairs, config);
+        smallest = (smallest == 0) ? bytes : std::min(smallest, bytes);
+
+        CHECK((2 * bytes <= 3 * config.bytes) && (2 * config.bytes <= 3 * bytes),
+              name << ": " << toString(config) << " estimated with " << config.bytes << " bytes, but has " << bytes << " bytes");
+
+    }
+
+    auto selected = tuneK2Tree(pairs, opts);
+    double bytes = realBytes(pairs, selected);
+    CHECK(bytes <= 1.01 * smallest, name << ": selected " << toString(selected) << " with " << bytes << " bytes, but the smallest candidate has " << smallest << " bytes");
+
+}
+
+int main() {
+
+    checkTuning(clusteredRelation(20000, 20000, 20000, 64, false, 1), "20000 x 20000, 20000 pairs in 64 x 64 blocks");
+    checkTuning(clusteredRelation(20000, 20000, 200000, 32, false, 1), "20000 x 20000, 200000 pairs in 32 x 32 blocks");
+    checkTuning(clusteredRelation(20000, 20000, 400000, 32, false, 1), "20000 x 20000, 400000 pairs in 32 x 32 blocks");
+    checkTuning(clusteredRelation(20000, 20000, 400000, 32, true, 1), "20000 x 20000, 400000 pairs in 32 x 32 blocks (transposed)");
+
+    std::cout << "tuneK2Tree: " << failures << " failure(s)" << std::endl;
+
+    return (failures == 0) ? 0 : 1;
+
+}